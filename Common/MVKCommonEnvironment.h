@@ -60,6 +60,16 @@ extern "C" {
 #    endif
 #endif
 
+/** Building with Xcode 12 or later, whose SDKs include the Metal APIs introduced in macOS 11 and iOS 14. */
+#ifndef MVK_XCODE_12
+#    if (defined(__MAC_OS_X_VERSION_MAX_ALLOWED) && __MAC_OS_X_VERSION_MAX_ALLOWED >= 110000) || \
+        (defined(__IPHONE_OS_VERSION_MAX_ALLOWED) && __IPHONE_OS_VERSION_MAX_ALLOWED >= 140000)
+#        define MVK_XCODE_12     1
+#    else
+#        define MVK_XCODE_12     0
+#    endif
+#endif
+
 /** Directive to identify public symbols. */
 #define MVK_PUBLIC_SYMBOL        __attribute__((visibility("default")))
 
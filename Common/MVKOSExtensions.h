@@ -63,6 +63,34 @@ double mvkGetElapsedMilliseconds(uint64_t startTimestamp = 0, uint64_t endTimest
 void mvkDispatchToMainAndWait(dispatch_block_t block);
 
 
+#pragma mark -
+#pragma mark Signposts
+
+/** The MoltenVK activities that can be marked as os_signpost intervals for Instruments. */
+typedef enum : uint8_t {
+	kMVKSignpostVulkanCall,					/**< A Vulkan API call. */
+	kMVKSignpostQueueSubmissionExecute,		/**< Encoding and committing a queue submission. */
+	kMVKSignpostQueueSubmissionCommit,		/**< Committing a MTLCommandBuffer of a queue submission. */
+	kMVKSignpostQueueSubmissionFinish,		/**< Finishing a queue submission once the GPU has completed it. */
+	kMVKSignpostMetalCompile,				/**< Compiling a Metal library, function, or pipeline state. */
+	kMVKSignpostDrawableAcquisition,		/**< Acquiring a CAMetalDrawable from a CAMetalLayer. */
+} MVKSignpostActivity;
+
+/**
+ * If signposts are enabled by the MVK_CONFIG_SIGNPOSTS runtime environment variable or build
+ * setting, begins an os_signpost interval for the activity, and returns a non-zero identifier
+ * that must be passed to mvkSignpostEnd() to end the interval. The optional detail string is
+ * attached to the beginning of the interval. Returns zero if signposts are not enabled.
+ */
+uint64_t mvkSignpostBegin(MVKSignpostActivity activity, const char* detail = nullptr);
+
+/**
+ * Ends the os_signpost interval for the activity, identified by the value returned from
+ * the corresponding call to mvkSignpostBegin(). Does nothing if signpostID is zero.
+ */
+void mvkSignpostEnd(MVKSignpostActivity activity, uint64_t signpostID);
+
+
 #pragma mark -
 #pragma mark Process environment
 
@@ -135,3 +163,6 @@ uint64_t mvkGetAvailableMemorySize();
 /** Returns the amount of memory currently used by this process. */
 uint64_t mvkGetUsedMemorySize();
 
+/** Returns the size of a page of host memory on this platform. */
+uint64_t mvkGetHostMemoryPageSize();
+
@@ -23,6 +23,8 @@
 #include <mach/mach_time.h>
 #include <mach/task.h>
 #include <os/proc.h>
+#include <os/signpost.h>
+#include <unistd.h>
 
 #import <Foundation/Foundation.h>
 
@@ -76,6 +78,66 @@ void mvkDispatchToMainAndWait(dispatch_block_t block) {
 }
 
 
+#pragma mark -
+#pragma mark Signposts
+
+#ifndef MVK_CONFIG_SIGNPOSTS
+#   define MVK_CONFIG_SIGNPOSTS    0
+#endif
+
+// Returns the log to which signposts are emitted, or nil if signposts are not enabled.
+// A mode of 1 emits to a MoltenVK category, and a mode of 2 emits to the Points of Interest category.
+// We do this once lazily instead of in a library constructor function to
+// ensure the NSProcessInfo environment is available when called upon.
+static os_log_t mvkGetSignpostLog() {
+	static os_log_t _mvkSignpostLog = [](){
+		int32_t mode;
+		MVK_SET_FROM_ENV_OR_BUILD_INT32(mode, MVK_CONFIG_SIGNPOSTS);
+		if (mode <= 0 || !mvkOSVersionIsAtLeast(MVK_MACOS ? 10.14 : 12.0)) { return (os_log_t)nil; }
+		return os_log_create("com.khronos.MoltenVK", mode >= 2 ? OS_LOG_CATEGORY_POINTS_OF_INTEREST : "MoltenVK");	// retained
+	}();
+	return _mvkSignpostLog;
+}
+
+// The name of an os_signpost interval must be a string literal.
+#define MVK_SIGNPOST_INTERVAL_CASE(spAct, spName, spFunc, ...)		\
+	case spAct:														\
+		spFunc(spLog, spID, spName, ##__VA_ARGS__);					\
+		break
+
+uint64_t mvkSignpostBegin(MVKSignpostActivity activity, const char* detail) {
+	os_log_t spLog = mvkGetSignpostLog();
+	if ( !spLog || !os_signpost_enabled(spLog) ) { return 0; }
+
+	os_signpost_id_t spID = os_signpost_id_generate(spLog);
+	if ( !detail ) { detail = ""; }
+	switch (activity) {
+		MVK_SIGNPOST_INTERVAL_CASE(kMVKSignpostVulkanCall, "Vulkan Call", os_signpost_interval_begin, "%{public}s", detail);
+		MVK_SIGNPOST_INTERVAL_CASE(kMVKSignpostQueueSubmissionExecute, "Queue Submission Execute", os_signpost_interval_begin, "%{public}s", detail);
+		MVK_SIGNPOST_INTERVAL_CASE(kMVKSignpostQueueSubmissionCommit, "Queue Submission Commit", os_signpost_interval_begin, "%{public}s", detail);
+		MVK_SIGNPOST_INTERVAL_CASE(kMVKSignpostQueueSubmissionFinish, "Queue Submission Finish", os_signpost_interval_begin, "%{public}s", detail);
+		MVK_SIGNPOST_INTERVAL_CASE(kMVKSignpostMetalCompile, "Metal Compile", os_signpost_interval_begin, "%{public}s", detail);
+		MVK_SIGNPOST_INTERVAL_CASE(kMVKSignpostDrawableAcquisition, "Drawable Acquisition", os_signpost_interval_begin, "%{public}s", detail);
+	}
+	return spID;
+}
+
+void mvkSignpostEnd(MVKSignpostActivity activity, uint64_t signpostID) {
+	if ( !signpostID ) { return; }
+
+	os_log_t spLog = mvkGetSignpostLog();
+	os_signpost_id_t spID = signpostID;
+	switch (activity) {
+		MVK_SIGNPOST_INTERVAL_CASE(kMVKSignpostVulkanCall, "Vulkan Call", os_signpost_interval_end);
+		MVK_SIGNPOST_INTERVAL_CASE(kMVKSignpostQueueSubmissionExecute, "Queue Submission Execute", os_signpost_interval_end);
+		MVK_SIGNPOST_INTERVAL_CASE(kMVKSignpostQueueSubmissionCommit, "Queue Submission Commit", os_signpost_interval_end);
+		MVK_SIGNPOST_INTERVAL_CASE(kMVKSignpostQueueSubmissionFinish, "Queue Submission Finish", os_signpost_interval_end);
+		MVK_SIGNPOST_INTERVAL_CASE(kMVKSignpostMetalCompile, "Metal Compile", os_signpost_interval_end);
+		MVK_SIGNPOST_INTERVAL_CASE(kMVKSignpostDrawableAcquisition, "Drawable Acquisition", os_signpost_interval_end);
+	}
+}
+
+
 #pragma mark -
 #pragma mark Process environment
 
@@ -135,3 +197,5 @@ uint64_t mvkGetUsedMemorySize() {
 	return 0;
 }
 
+uint64_t mvkGetHostMemoryPageSize() { return sysconf(_SC_PAGESIZE); }
+
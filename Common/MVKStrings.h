@@ -21,6 +21,7 @@
 
 #include <string>
 #include <streambuf>
+#include <algorithm>
 
 namespace mvk {
 
@@ -70,6 +71,12 @@ namespace mvk {
 			setg(p, p, p + n);
 			setp(p, p + n);
 		}
+
+		/** Advances the read position past the specified number of characters, without reading them. */
+		void skip(size_t n) { setg(eback(), gptr() + std::min<size_t>(n, egptr() - gptr()), egptr()); }
+
+		/** Returns the current read position. */
+		const char* getReadPosition() { return gptr(); }
 	};
 
 	/** A character counting stream buffer. */
@@ -55,7 +55,7 @@ typedef unsigned long MTLLanguageVersion;
 #define MVK_MAKE_VERSION(major, minor, patch)    (((major) * 10000) + ((minor) * 100) + (patch))
 #define MVK_VERSION     MVK_MAKE_VERSION(MVK_VERSION_MAJOR, MVK_VERSION_MINOR, MVK_VERSION_PATCH)
 
-#define VK_MVK_MOLTENVK_SPEC_VERSION            25
+#define VK_MVK_MOLTENVK_SPEC_VERSION            27
 #define VK_MVK_MOLTENVK_EXTENSION_NAME          "VK_MVK_moltenvk"
 
 /**
@@ -137,12 +137,21 @@ typedef unsigned long MTLLanguageVersion;
  *     Xcode user interface.
  *       0: No automatic GPU capture.
  *       1: Capture all GPU commands issued during the lifetime of the VkDevice.
+ *       2: Capture the frame that follows each frame that takes longer than the number of
+ *          milliseconds in MVK_CONFIG_AUTO_GPU_CAPTURE_SLOW_FRAME_THRESHOLD (default 50), either
+ *          as the CPU interval between presentations on the VkQueue, or as GPU busy time, up to
+ *          MVK_CONFIG_AUTO_GPU_CAPTURE_MAX_FRAME_COUNT (default 1) captures. A frame is the work
+ *          submitted to a VkQueue between presentations on it. A slow frame is only identified
+ *          once it has ended, so the frame that is captured is the one after it, which is useful
+ *          for catching hitches that persist, such as those caused by a change of content, and
+ *          frames that are captured are not themselves considered to be slow.
  *     If MVK_CONFIG_AUTO_GPU_CAPTURE_OUTPUT_FILE is also set, it is a filename where the automatic
  *     GPU capture should be saved. In this case, the Xcode scheme need not have Metal GPU capture
  *     enabled, and in fact the app need not be run under Xcode's control at all. This is useful
  *     in case the app cannot be run under Xcode's control. A path starting with '~' can be used
  *     to place it in a user's home directory, as in the shell. This feature requires Metal 3.0
- *     (macOS 10.15, iOS 13).
+ *     (macOS 10.15, iOS 13). When capturing slow frames, a sequence number is appended to the
+ *     name of each file, before its extension, as in "trace-1.gputrace".
  *     If none of these is set, no automatic GPU capture will occur.
  *
  * 6.  The MVK_CONFIG_TEXTURE_1D_AS_2D runtime environment variable or MoltenVK compile-time build
@@ -190,6 +199,275 @@ typedef unsigned long MTLLanguageVersion;
  *     MVK_CONFIG_PERFORMANCE_LOGGING_FRAME_COUNT environment variable or MoltenVK
  *     compile-time build setting. This setting is disabled by default, and activity
  *     performance will be logged only when frame activity is logged.
+ *
+ * 11. The MVK_CONFIG_PARALLEL_SUBMIT_ENCODING runtime environment variable or MoltenVK compile-time
+ *     build setting controls whether MoltenVK should encode the command buffers in a single
+ *     vkQueueSubmit() onto Metal in parallel. If this setting is enabled, and a VkSubmitInfo
+ *     contains more than one command buffer, each command buffer is encoded on a separate thread
+ *     into its own MTLCommandBuffer, and the MTLCommandBuffers are enqueued in submission order,
+ *     so that GPU execution order is unchanged. If this setting is disabled, the command buffers
+ *     are encoded one after another on the queue's submission thread. This setting is disabled
+ *     by default, and MoltenVK will encode the command buffers in each submission serially.
+ *
+ * 12. The MVK_CONFIG_USE_COMMAND_ARENA runtime environment variable or MoltenVK compile-time
+ *     build setting controls whether MoltenVK should hold the commands recorded into each
+ *     command buffer in a linear memory arena owned by that command buffer. If this setting is
+ *     enabled, commands are stored contiguously in recording order, and all of the commands in
+ *     a command buffer are released together when the command buffer is reset. The arena memory
+ *     is retained for re-recording, and is released back to the system when the command buffer
+ *     is reset with VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT, or freed. If this setting is
+ *     disabled, commands are managed as determined by MVK_CONFIG_USE_COMMAND_POOLING.
+ *     This setting is disabled by default, and MoltenVK will not use command arenas.
+ *
+ * 13. The MVK_CONFIG_REPLAY_REUSABLE_COMMAND_BUFFERS runtime environment variable or MoltenVK
+ *     compile-time build setting controls whether MoltenVK should record sequences of draw
+ *     commands in reusable command buffers into a MTLIndirectCommandBuffer, and replay it when
+ *     the command buffer is submitted again. If this setting is enabled, and the device supports
+ *     MTLIndirectCommandBuffers, each long enough run of consecutive vkCmdDraw() or vkCmdDrawIndexed()
+ *     commands, in a command buffer that was not recorded with VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+ *     or VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT, is encoded into a MTLIndirectCommandBuffer the
+ *     first time the command buffer is submitted, and that MTLIndirectCommandBuffer is executed on each
+ *     subsequent submission. Enabling this setting causes non-tessellation graphics pipelines to
+ *     be created with support for MTLIndirectCommandBuffers. This setting is disabled by default,
+ *     and MoltenVK will encode each draw command each time a command buffer is submitted.
+ *
+ * 14. The MVK_CONFIG_USE_TRANSIENT_BUFFER_RING runtime environment variable or MoltenVK compile-time
+ *     build setting controls whether MoltenVK should suballocate transient data, such as push constants,
+ *     inline uniform data, and vkCmdUpdateBuffer() content, from a ring buffer owned by each command pool.
+ *     If this setting is enabled, each MTLCommandBuffer reserves blocks of the ring as it is encoded,
+ *     suballocates its transient data from those blocks with aligned bumps, and returns all of its
+ *     blocks to the ring together when it completes. If the ring is full, transient data falls back
+ *     to individually pooled allocations. This setting is disabled by default, and MoltenVK will
+ *     use individually pooled allocations, sized to the next power-of-two, for all transient data.
+ *
+ * 15. The MVK_CONFIG_MERGE_SUBPASSES runtime environment variable or MoltenVK compile-time build
+ *     setting controls whether MoltenVK should merge consecutive subpasses of a render pass into a
+ *     single Metal render pass, when the subpasses render to the same color and depth/stencil
+ *     attachments, have no resolve attachments, read only the current pixel of their own color
+ *     attachments as input attachments, and depend on each other only by region. Input attachments
+ *     in merged subpasses are read through framebuffer fetch, which avoids storing and reloading
+ *     the attachments between subpasses. This setting is only available on iOS, where it is
+ *     enabled by default. If disabled, each subpass will use its own Metal render pass.
+ *
+ * 16. The MVK_CONFIG_MULTI_DRAW_INDIRECT_ON_GPU runtime environment variable or MoltenVK compile-time
+ *     build setting controls whether MoltenVK should encode the draws of a non-tessellated
+ *     vkCmdDrawIndirect() or vkCmdDrawIndexedIndirect() command, whose drawCount is greater than one,
+ *     into a MTLIndirectCommandBuffer, using a compute shader that reads the Vulkan indirect buffer,
+ *     and execute all of those draws with a single Metal command. The MTLIndirectCommandBuffer is
+ *     populated before the render pass begins. This setting is only available if the device supports
+ *     MTLIndirectCommandBuffers, where it is enabled by default. If disabled, MoltenVK will encode
+ *     a separate Metal indirect draw for each draw in the Vulkan indirect buffer.
+ *
+ * 17. The MVK_CONFIG_ASYNC_PIPELINE_COMPILATION runtime environment variable or MoltenVK compile-time
+ *     build setting controls whether MoltenVK should compile the Metal pipeline states of a VkPipeline
+ *     in the background, allowing vkCreateGraphicsPipelines() and vkCreateComputePipelines() to return
+ *     before compilation is complete. Conversion of the shaders to MSL still occurs during pipeline
+ *     creation. Use vkGetPipelineCompilationStatusMVK() or vkSetPipelineCompilationCallbackMVK()
+ *     to determine when compilation is complete. A pipeline that is used by a command buffer before
+ *     its compilation is complete will cause the submission of that command buffer to wait until
+ *     compilation is complete. Compilation errors are reported by those functions, rather than by
+ *     the pipeline creation functions. This setting is disabled by default.
+ *
+ * 18. The MVK_CONFIG_PARALLEL_PIPELINE_CREATION runtime environment variable or MoltenVK compile-time
+ *     build setting controls whether MoltenVK should create the pipelines passed to a single call to
+ *     vkCreateGraphicsPipelines() or vkCreateComputePipelines() in parallel, across the CPU cores.
+ *     This setting is enabled by default. If disabled, the pipelines are created one after another.
+ *
+ * 19. The MVK_CONFIG_SHADER_DISK_CACHE_PATH runtime environment variable or MoltenVK compile-time
+ *     build setting identifies a directory in which MoltenVK should cache the MSL source code
+ *     converted from SPIR-V shader code. Cache entries are identified by the shader code, the shader
+ *     conversion configuration, and the revision of the shader converter, and can be retrieved by
+ *     any VkDevice, and by later runs of the app, even if the app does not use a VkPipelineCache.
+ *     A path starting with '~' can be used to place the directory in a user's home directory.
+ *     The MVK_CONFIG_SHADER_DISK_CACHE_MAX_SIZE runtime environment variable or MoltenVK compile-time
+ *     build setting limits the total size of the cache, in bytes, and defaults to 64 MB. When the
+ *     limit is exceeded, the least recently used cache entries are removed. If no directory is
+ *     set, which is the default, MoltenVK will not cache converted shader code on disk.
+ *
+ * 20. The MVK_CONFIG_USE_METAL_ARGUMENT_BUFFERS runtime environment variable or MoltenVK compile-time
+ *     build setting controls whether MoltenVK should encode the contents of descriptor sets into
+ *     Metal argument buffers, and bind each descriptor set to a shader as a single Metal buffer.
+ *     This is only available on devices that support Tier 2 Metal argument buffers, and applies only
+ *     to pipeline layouts whose descriptor set layouts contain no push descriptors, dynamic buffers,
+ *     or inline uniform blocks. Other pipeline layouts continue to bind each descriptor individually.
+ *     Shaders that rely on emulated image view swizzling, or that query the length of a runtime-sized
+ *     storage buffer array, are not supported in this mode. This setting is disabled by default.
+ *
+ * 21. The MVK_CONFIG_USE_CONSTEXPR_IMMUTABLE_SAMPLERS runtime environment variable or MoltenVK compile-time
+ *     build setting controls whether MoltenVK should hardcode immutable samplers into shaders as MSL
+ *     constexpr samplers, when the sampler state can be expressed in MSL and the descriptor set layout
+ *     binding holds a single sampler. Such samplers occupy no Metal sampler slot, and are not bound
+ *     when descriptor sets are bound. Immutable samplers that use a depth compare operation on devices
+ *     that do not support dynamic depth compare samplers are always hardcoded, regardless of this setting.
+ *     This setting is enabled by default.
+ *
+ * 22. The MVK_CONFIG_SUBALLOCATE_DEVICE_MEMORY runtime environment variable or MoltenVK compile-time
+ *     build setting controls whether MoltenVK should place small VkDeviceMemory allocations within
+ *     larger Metal heaps or Metal buffers that are shared between allocations of the same memory type,
+ *     instead of creating a Metal heap or Metal buffer for each allocation. Dedicated allocations and
+ *     exported memory are never shared. This setting is enabled by default.
+ *
+ * 23. The MVK_CONFIG_TRACK_DIRTY_MAPPED_MEMORY runtime environment variable or MoltenVK compile-time
+ *     build setting controls whether MoltenVK should track the memory pages flushed by the app in
+ *     vkFlushMappedMemoryRanges() on non-coherent memory, coalesce them across calls, and sync them to
+ *     the GPU only when the next queue submission executes. When enabled, vkUnmapMemory() syncs only
+ *     the pages the app has flushed, instead of the entire mapped range. This setting is disabled by default.
+ *
+ * 24. The MVK_CONFIG_PREFETCH_DRAWABLES runtime environment variable or MoltenVK compile-time build
+ *     setting controls whether each swapchain should acquire the CAMetalDrawable of a swapchain image
+ *     on a background thread as soon as the app acquires that image, so that rendering to the image and
+ *     presenting it do not block waiting for CAMetalLayer to provide a drawable. This setting is disabled
+ *     by default.
+ *
+ * 25. The MVK_CONFIG_CONCURRENT_COMPUTE_DISPATCH runtime environment variable or MoltenVK compile-time
+ *     build setting controls whether MoltenVK should encode the compute dispatches of the app into Metal
+ *     compute encoders that use MTLDispatchTypeConcurrent, with Metal memory barriers encoded only where
+ *     the app records pipeline barriers or event waits. Dispatches that are not separated by a barrier
+ *     may then execute concurrently, as Vulkan permits. Compute work internal to MoltenVK continues to
+ *     use serial dispatch. This is only available on macOS 10.14 or iOS 12, and above. This setting is
+ *     disabled by default.
+ *
+ * 26. The MVK_CONFIG_FENCE_HAZARD_TRACKING runtime environment variable or MoltenVK compile-time build
+ *     setting controls whether MoltenVK should disable Metal hazard tracking of the buffers and images
+ *     of the app, and instead order the Metal encoders using MTLFences, derived from the pipeline
+ *     barriers, event waits, and external subpass dependencies recorded by the app. Metal encoders
+ *     that are not separated by any of these may then execute concurrently, as Vulkan permits.
+ *     Resources internal to MoltenVK, and swapchain images, remain tracked by Metal. This is only
+ *     available on platforms that support MTLFence. This setting is disabled by default.
+ *
+ * 27. The MVK_CONFIG_EARLY_COMMIT_COMMAND_COUNT and MVK_CONFIG_EARLY_COMMIT_INTERVAL runtime environment
+ *     variables or MoltenVK compile-time build settings control whether MoltenVK should commit the Metal
+ *     command buffer of a queue submission before all of its commands have been encoded, so the GPU can
+ *     start executing while encoding continues on a new Metal command buffer. The Metal command buffer
+ *     is committed between commands, outside of any render pass, once the specified number of commands,
+ *     or the specified number of microseconds, respectively, have elapsed since it began. This does not
+ *     apply to command buffers that are prefilled, or encoded in parallel. Both settings default to
+ *     zero, which disables the corresponding trigger.
+ *
+ * 28. The MVK_CONFIG_SIGNPOSTS runtime environment variable or MoltenVK compile-time build setting
+ *     causes MoltenVK to mark each Vulkan call, the execution, commit, and completion of each queue
+ *     submission, each Metal compile, and each CAMetalDrawable acquisition, as an os_signpost interval,
+ *     so Instruments can correlate CPU activity within MoltenVK with the Metal System Trace. Signposts
+ *     require macOS 10.14 or iOS 12, and are only emitted while Instruments is recording them.
+ *     The signposts are controlled by setting the value of MVK_CONFIG_SIGNPOSTS as follows:
+ *         0: No signposts.
+ *         1: Emit signposts to the "MoltenVK" category of the "com.khronos.MoltenVK" subsystem,
+ *            for display with the os_signpost instrument.
+ *         2: Same as option 1, but emit the signposts to the Points of Interest category,
+ *            for display with the Points of Interest instrument.
+ *     If none of these is set, no signposts are emitted.
+ *
+ * 29. The MVK_CONFIG_PERFORMANCE_REPORT_FILE runtime environment variable or MoltenVK compile-time
+ *     build setting identifies a file to which MoltenVK appends a machine-readable summary of the
+ *     performance statistics and resource statistics of each VkDevice, when that VkDevice is destroyed.
+ *     Each summary is written as a single line of JSON, identifying the MoltenVK version and GPU,
+ *     and the count, average, latest, minimum, maximum, and percentile durations of each activity,
+ *     so that the results of successive runs of a benchmark or app can be collected and compared
+ *     between MoltenVK releases. The report is only written when performance tracking is enabled
+ *     via MVK_CONFIG_PERFORMANCE_TRACKING. Tilde paths may be used to place the file in a user's
+ *     home directory. If this is not set, no performance report is written.
+ *
+ * 30. The MVK_CONFIG_SLOW_COMPILE_THRESHOLD runtime environment variable or MoltenVK compile-time
+ *     build setting identifies a number of milliseconds. When the SPIR-V to MSL conversion, MSL
+ *     compilation, and function specialization of the shader stages of a pipeline, together with
+ *     the compilation of the Metal pipeline state, take longer than this, MoltenVK logs a single
+ *     line of JSON identifying the pipeline type, and the shader module hash, stage, entry point,
+ *     conversion configuration hash, and phase durations of each shader stage. If the
+ *     MVK_CONFIG_SLOW_COMPILE_REPORT_FILE runtime environment variable or MoltenVK compile-time
+ *     build setting is also set, MoltenVK appends a JSON summary of the slowest of these pipeline
+ *     compilations to that file when each VkDevice is destroyed, to identify the shaders that most
+ *     benefit from offline precompilation. Tilde paths may be used to place the file in a user's
+ *     home directory. If MVK_CONFIG_SLOW_COMPILE_THRESHOLD is not set, or is zero, slow pipeline
+ *     compilations are not reported.
+ *
+ * 31. The MVK_CONFIG_CALL_RECORD_FILE runtime environment variable or MoltenVK compile-time build
+ *     setting identifies a file to which MoltenVK writes a compact binary recording of the Vulkan
+ *     calls made over a range of frames, identifying the function, calling thread, frame, start time,
+ *     and duration of each call, so that the CPU cost of the same frames can be compared between
+ *     MoltenVK releases. Frames are delimited by calls to vkQueuePresentKHR(). The first frame to
+ *     record is set by MVK_CONFIG_CALL_RECORD_START_FRAME, where frame zero starts with the first
+ *     Vulkan call, and defaults to zero. The number of frames to record is set by
+ *     MVK_CONFIG_CALL_RECORD_FRAME_COUNT, and defaults to one. The file is written once the frames
+ *     have been recorded, or when the VkInstance is destroyed, if that occurs first. The parameters
+ *     of the calls that record and submit commands during the recorded frames are recorded, as are
+ *     the parameters of the calls that create, destroy, and update Vulkan objects from the creation
+ *     of the VkDevice, so that the MoltenVKCallReplayer tool, built with 'make replayer', can replay
+ *     the recorded frames. The contents of memory are identified by hashes, and are not recorded.
+ *     Tilde paths may be used to place the file in a user's home directory.
+ *     If MVK_CONFIG_CALL_RECORD_FILE is not set, Vulkan calls are not recorded.
+ *
+ * 32. The MVK_CONFIG_PERFORMANCE_HUD runtime environment variable or MoltenVK compile-time build
+ *     setting causes MoltenVK to overlay a performance HUD in the top-left corner of each presented
+ *     swapchain image, while performance tracking is enabled via MVK_CONFIG_PERFORMANCE_TRACKING.
+ *     The HUD graphs the most recent 128 frames, newest on the right. From top to bottom, it shows
+ *     the CPU frame interval (green, turning yellow above 1/60 and red above 1/30 of a second), the
+ *     GPU busy time (blue), the number of queue submissions (cyan), markers for frames containing
+ *     shader or pipeline compilations (magenta), markers for frames that stalled waiting for a
+ *     MTLCommandBuffer or CAMetalDrawable (orange), and a bar showing the Metal memory in use as a
+ *     fraction of the recommended working set size of the device. This setting is disabled by default.
+ *
+ * 33. The MVK_CONFIG_PREENCODE_SECONDARY_COMMAND_BUFFERS runtime environment variable or MoltenVK
+ *     compile-time build setting controls whether MoltenVK should encode the runs of draw commands in
+ *     secondary command buffers into MTLIndirectCommandBuffers when vkEndCommandBuffer() is called,
+ *     on the thread that recorded the secondary command buffer. If this setting is enabled, and the
+ *     device supports MTLIndirectCommandBuffers, each long enough run of consecutive vkCmdDraw() or
+ *     vkCmdDrawIndexed() commands, in a secondary command buffer that was not recorded with
+ *     VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT, is encoded into a MTLIndirectCommandBuffer, and
+ *     vkCmdExecuteCommands() executes that MTLIndirectCommandBuffer with a single Metal command,
+ *     instead of the draws being encoded individually while the primary command buffer is encoded.
+ *     Runs whose primitive topology is dynamic are encoded when the primary command buffer is encoded.
+ *     Enabling this setting causes non-tessellation graphics pipelines to be created with support for
+ *     MTLIndirectCommandBuffers. This setting is disabled by default, and MoltenVK will encode each
+ *     draw command in a secondary command buffer while encoding the primary command buffer.
+ *
+ * 34. The MVK_CONFIG_PARALLEL_DESCRIPTOR_SET_UPDATES runtime environment variable or MoltenVK
+ *     compile-time build setting controls whether MoltenVK should perform the writes passed to a
+ *     single call to vkUpdateDescriptorSets() in parallel, across the CPU cores, when there are
+ *     many of them, and they target more than one descriptor set. The writes to each descriptor
+ *     set are performed in order, on a single thread. This setting is enabled by default.
+ *     If disabled, the writes are performed one after another, on the calling thread.
+ *
+ * 35. The MVK_CONFIG_RETAIN_DESCRIPTOR_RESOURCES runtime environment variable or MoltenVK
+ *     compile-time build setting controls whether descriptors should retain the VkBuffer,
+ *     VkImageView, VkBufferView and VkSampler objects written to them. As Vulkan requires, the
+ *     app must not destroy these objects while a descriptor set that references them is in use.
+ *     Disabling this setting relies on the app also not destroying these objects before it frees,
+ *     resets or updates the descriptor sets that reference them, or destroys their descriptor pool,
+ *     and removes the atomic reference counting from descriptor updates, which is contended when
+ *     descriptor sets are updated on several threads. Immutable samplers are always retained.
+ *     Metal resources bound by command buffers are not retained, regardless of this setting.
+ *     This setting is enabled by default, and descriptors retain the Vulkan objects written to them.
+ *
+ * 36. The MVK_CONFIG_INFER_LOAD_STORE_ACTIONS runtime environment variable or MoltenVK compile-time
+ *     build setting controls whether MoltenVK should examine the commands of a primary command buffer
+ *     when vkEndCommandBuffer() is called, to identify render pass attachments whose contents need
+ *     not be stored by the Metal render pass, because the next render pass in the command buffer that
+ *     uses the same image subresources replaces their entire contents, and no command between the two
+ *     render passes can read them, or need not be loaded, because their contents are undefined, as
+ *     a result of the initial layout of the attachment, or of the store op of the same image
+ *     subresources in the previous render pass. On tile-based GPUs, this avoids transferring those
+ *     contents between tile memory and device memory. Only pipeline barriers, events, queries, debug
+ *     markers and state commands between the two render passes allow the comparison. This setting
+ *     is disabled by default, and the load and store actions are determined from each render pass.
+ *
+ * 37. The MVK_CONFIG_SWAPCHAIN_UPSCALE_FILTER runtime environment variable or MoltenVK compile-time
+ *     build setting controls the filter used to upscale a swapchain image, when it is presented, if
+ *     the app rendered only a region of the image, as set by vkSetSwapchainImageRenderExtentMVK().
+ *     This allows the app to vary its rendering resolution from frame to frame, without recreating
+ *     the swapchain. A value of 1 selects bilinear filtering, and a value of 2 selects two-lobe
+ *     Lanczos filtering, which is sharper, but reads sixteen texels for each pixel. Enabling this
+ *     setting prevents the CAMetalLayer from using framebuffer-only textures, because the rendered
+ *     region is copied out of the swapchain image before it is upscaled. This setting is disabled
+ *     (set to 0) by default, and swapchain images are presented at their full extent.
+ *
+ * 38. The MVK_CONFIG_PREWARM_PIPELINES runtime environment variable or MoltenVK compile-time build
+ *     setting controls whether a VkPipelineCache should record which shader libraries are used by the
+ *     pipelines the app binds, in the order they are first bound, and include that record in the data
+ *     returned by vkGetPipelineCacheData(). When a pipeline cache is later created from that data, the
+ *     recorded shader libraries are compiled on a low-priority background thread, in the same order,
+ *     so that they are ready by the time the app creates the pipelines that use them. The Metal
+ *     pipeline states themselves are not prewarmed, but are retrieved from the compiled pipelines
+ *     held in the pipeline cache data, where supported. This setting is disabled by default.
  */
 typedef struct {
 
@@ -297,6 +575,11 @@ typedef struct {
 	 * is required per command buffer queue submission, which may be significantly less than the
 	 * number of Vulkan command buffers.
 	 *
+	 * When a queue holds this many active Metal command buffers, vkQueueSubmit() and vkQueuePresentKHR()
+	 * wait for some of them to complete, before the submission is dispatched for execution. The number
+	 * of active Metal command buffers, and the time spent waiting, are included in the performance
+	 * statistics, as defined by the MVKPerformanceStatistics structure.
+	 *
 	 * The value of this parameter must be changed before creating a VkDevice,
 	 * for the change to take effect.
 	 *
@@ -555,6 +838,16 @@ typedef struct {
 
 } MVKConfiguration;
 
+/** Identifies the points in a Metal command stream at which GPU counters, such as timestamps, can be sampled. */
+typedef enum MVKCounterSamplingBits {
+	MVK_COUNTER_SAMPLING_AT_DRAW        = 0x00000001,	/**< Counters can be sampled between draw calls within a render encoder. */
+	MVK_COUNTER_SAMPLING_AT_DISPATCH    = 0x00000002,	/**< Counters can be sampled between dispatches within a compute encoder. */
+	MVK_COUNTER_SAMPLING_AT_BLIT        = 0x00000004,	/**< Counters can be sampled between commands within a BLIT encoder. */
+	MVK_COUNTER_SAMPLING_AT_STAGE       = 0x00000008,	/**< Counters can be sampled at the start and end of each Metal encoder. */
+	MVK_COUNTER_SAMPLING_MAX_ENUM       = 0x7FFFFFFF
+} MVKCounterSamplingBits;
+typedef VkFlags MVKCounterSamplingFlags;
+
 /**
  * Features provided by the current implementation of Metal on the current device. You can
  * retrieve a copy of this structure using the vkGetPhysicalDeviceMetalFeaturesMVK() function.
@@ -610,6 +903,12 @@ typedef struct {
 	VkBool32 nativeTextureSwizzle;				/**< If true, component swizzle is supported natively, without manual swizzling in shaders. */
 	VkBool32 placementHeaps;					/**< If true, MTLHeap objects support placement of resources. */
 	VkDeviceSize pushConstantSizeAlignment;     /**< The alignment used internally when allocating memory for push constants. Must be PoT. */
+	VkBool32 indirectCommandBuffers;			/**< If true, draw commands can be encoded into a MTLIndirectCommandBuffer. */
+	VkBool32 argumentBuffers;					/**< If true, Tier 2 Metal argument buffers are supported. */
+	MVKCounterSamplingFlags counterSamplingPoints;	/**< Identifies the points at which GPU counters can be sampled for timestamp and pipeline statistics queries. If zero, timestamp queries use host timestamps. */
+	uint64_t peerGroupID;						/**< The ID of the Metal peer group of GPUs, connected for direct transfers, that this device belongs to, or zero if this device is not in a peer group. */
+	uint32_t peerIndex;							/**< The index of this device within its Metal peer group. Physical devices in the same peer group are enumerated consecutively, in peer index order. */
+	uint32_t peerCount;							/**< The number of GPUs in the Metal peer group of this device, or one if this device is not in a peer group. */
 } MVKPhysicalDeviceMetalFeatures;
 
 /** MoltenVK performance of a particular type of activity. */
@@ -632,6 +931,7 @@ typedef struct {
     MVKPerformanceTracker functionSpecialization;		/** Specialize a retrieved MTLFunction. */
     MVKPerformanceTracker pipelineCompile;				/** Compile MTLFunctions into a pipeline. */
 	MVKPerformanceTracker glslToSPRIV;					/** Convert GLSL to SPIR-V code. */
+	MVKPerformanceTracker functionFromCache;			/** Retrieve a MTLFunction previously resolved with the same specialization constant values. */
 } MVKShaderCompilationPerformance;
 
 /** MoltenVK performance of pipeline cache activities. */
@@ -647,8 +947,56 @@ typedef struct {
 	MVKPerformanceTracker mtlCommandBufferCompletion;   /** Completion of a MTLCommandBuffer on the GPU, from commit to completion callback. */
 	MVKPerformanceTracker nextCAMetalDrawable;			/** Retrieve next CAMetalDrawable from CAMetalLayer during presentation. */
 	MVKPerformanceTracker frameInterval;				/** Frame presentation interval (1000/FPS). */
+	MVKPerformanceTracker mtlCommandBufferFlowWait;		/** Wait during a queue submission for active MTLCommandBuffers to complete, when a queue holds the maximum number. */
+	uint32_t activeMTLCommandBufferCount;				/** The number of MTLCommandBuffers currently active, across all queues. */
+	uint32_t maxActiveMTLCommandBufferCount;			/** The highest number of MTLCommandBuffers that have been active at once on any queue. */
+	MVKPerformanceTracker queueSubmit;					/** CPU time spent within vkQueueSubmit(), including encoding when command buffers are encoded on the submitting thread. */
 } MVKQueuePerformance;
 
+/** MoltenVK performance of encoding recorded Vulkan commands into Metal, by type of command. */
+typedef struct {
+	MVKPerformanceTracker renderPass;					/** Encode vkCmdBeginRenderPass(), vkCmdNextSubpass(), and vkCmdEndRenderPass(). */
+	MVKPerformanceTracker draw;							/** Encode a draw command, or a run of draw commands replayed from a MTLIndirectCommandBuffer. */
+	MVKPerformanceTracker dispatch;						/** Encode vkCmdDispatch() or vkCmdDispatchIndirect(). */
+	MVKPerformanceTracker transfer;						/** Encode a copy, blit, resolve, fill, update, or clear command, or a run of coalesced transfer commands. */
+	MVKPerformanceTracker synchronization;				/** Encode vkCmdPipelineBarrier(), vkCmdWaitEvents(), vkCmdSetEvent(), or vkCmdResetEvent(). */
+	MVKPerformanceTracker bindPipeline;					/** Encode vkCmdBindPipeline(). */
+	MVKPerformanceTracker state;						/** Encode a command that sets dynamic state, vertex or index buffers, or push constants. */
+	MVKPerformanceTracker query;						/** Encode a query command. */
+	MVKPerformanceTracker debugMarker;					/** Encode a debug marker or debug label command. */
+} MVKCommandEncodingPerformance;
+
+/** MoltenVK performance of descriptor set activities. */
+typedef struct {
+	MVKPerformanceTracker bindDescriptorSets;			/** Encode vkCmdBindDescriptorSets(), vkCmdPushDescriptorSetKHR(), or vkCmdPushDescriptorSetWithTemplateKHR(). */
+	MVKPerformanceTracker updateDescriptorSets;			/** Update descriptor sets in vkUpdateDescriptorSets() or vkUpdateDescriptorSetWithTemplate(). */
+} MVKDescriptorPerformance;
+
+/** MoltenVK performance of MTLCommandBuffers on the GPU, as reported by Metal on completion of each MTLCommandBuffer. */
+typedef struct {
+	MVKPerformanceTracker mtlCommandBufferExecution;	/** Execution of a MTLCommandBuffer on the GPU, from GPUStartTime to GPUEndTime. */
+	MVKPerformanceTracker mtlCommandBufferScheduling;	/** Scheduling of a MTLCommandBuffer by the CPU, from kernelStartTime to kernelEndTime. */
+	MVKPerformanceTracker mtlCommandBufferQueueLatency;	/** Wait by a scheduled MTLCommandBuffer for the GPU, from kernelEndTime to GPUStartTime. */
+	MVKPerformanceTracker frameGPUBusyTime;				/** Time the GPU spent executing the MTLCommandBuffers of a queue during one frame. */
+} MVKGPUPerformance;
+
+#define kMVKPerformanceHistogramBucketCount		48
+#define kMVKPerformanceHistogramCapacity		64
+
+/**
+ * Log-scale histogram of the durations of a particular type of activity, and the percentiles derived from it.
+ *
+ * The upper bound of bucket N is 2^(N/2) microseconds, and the last bucket holds all longer durations.
+ * Percentiles are reported as the upper bound of the bucket containing them, limited to the maximum duration.
+ */
+typedef struct {
+	uint32_t trackerOffset;								/** The byte offset of the MVKPerformanceTracker described by this histogram, within MVKPerformanceStatistics. Compare with offsetof(). */
+	uint32_t bucketCounts[kMVKPerformanceHistogramBucketCount];	/** The number of activities with durations within each bucket. */
+	double p50Duration;									/** The median duration of the activity, in milliseconds. */
+	double p95Duration;									/** The 95th percentile duration of the activity, in milliseconds. */
+	double p99Duration;									/** The 99th percentile duration of the activity, in milliseconds. */
+} MVKPerformanceHistogram;
+
 /**
  * MoltenVK performance. You can retrieve a copy of this structure using the vkGetPerformanceStatisticsMVK() function.
  *
@@ -666,8 +1014,77 @@ typedef struct {
 	MVKShaderCompilationPerformance shaderCompilation;	/** Shader compilations activities. */
 	MVKPipelineCachePerformance pipelineCache;			/** Pipeline cache activities. */
 	MVKQueuePerformance queue;          				/** Queue activities. */
+	MVKCommandEncodingPerformance commandEncoding;		/** Command encoding activities. */
+	MVKDescriptorPerformance descriptors;				/** Descriptor set activities. */
+	uint32_t histogramCount;							/** The number of valid entries in histograms. */
+	MVKPerformanceHistogram histograms[kMVKPerformanceHistogramCapacity];	/** A duration histogram for each MVKPerformanceTracker in this structure, identified by its trackerOffset. */
+	MVKGPUPerformance gpu;								/** GPU execution activities. */
 } MVKPerformanceStatistics;
 
+/** The current and highest count of a particular type of resource. */
+typedef struct {
+	uint64_t current;						/** The current count. */
+	uint64_t highWaterMark;					/** The highest count since the VkDevice was created. */
+} MVKResourceCount;
+
+/** Counts of bytes of Metal memory, by MTLStorageMode. */
+typedef struct {
+	MVKResourceCount shared;				/** Bytes of MTLStorageModeShared memory. */
+	MVKResourceCount managed;				/** Bytes of MTLStorageModeManaged memory. */
+	MVKResourceCount privateStorage;		/** Bytes of MTLStorageModePrivate memory. */
+	MVKResourceCount memoryless;			/** Bytes of MTLStorageModeMemoryless memory. */
+} MVKStorageModeByteCounts;
+
+/**
+ * MoltenVK resource usage. You can retrieve a copy of this structure using the vkGetResourceStatisticsMVK() function.
+ *
+ * This structure may be extended as new features are added to MoltenVK. If you are linking to
+ * an implementation of MoltenVK that was compiled from a different VK_MVK_MOLTENVK_SPEC_VERSION
+ * than your app was, the size of this structure in your app may be larger or smaller than the
+ * struct in MoltenVK. See the description of the vkGetResourceStatisticsMVK() function for
+ * information about how to handle this.
+ *
+ * TO SUPPORT DYNAMIC LINKING TO THIS STRUCTURE AS DESCRIBED ABOVE, THIS STRUCTURE SHOULD NOT
+ * BE CHANGED EXCEPT TO ADD ADDITIONAL MEMBERS ON THE END. EXISTING MEMBERS, AND THEIR ORDER,
+ * SHOULD NOT BE CHANGED.
+ */
+typedef struct {
+	MVKResourceCount buffers;						/** Live VkBuffers. */
+	MVKResourceCount images;						/** Live VkImages, including swapchain images. */
+	MVKResourceCount deviceMemoryAllocations;		/** Live VkDeviceMemory allocations. */
+	MVKResourceCount samplers;						/** Live VkSamplers. */
+	MVKResourceCount commandPools;					/** Live VkCommandPools. */
+	MVKResourceCount commandBuffers;				/** Allocated VkCommandBuffers. */
+	MVKResourceCount pooledCommands;				/** Command objects held by all command pools, whether in use by command buffers, or waiting for reuse. The high-water mark is the highest value sampled when retrieving these statistics. */
+	MVKResourceCount residentPooledCommands;		/** Command objects waiting for reuse in all command pools. The high-water mark is the highest value sampled when retrieving these statistics. */
+	MVKResourceCount descriptorPools;				/** Live VkDescriptorPools. */
+	MVKResourceCount descriptorSets;				/** VkDescriptorSets allocated from all descriptor pools. */
+	MVKResourceCount descriptorSetCapacity;			/** The total maxSets of all live descriptor pools. Compare with descriptorSets for occupancy. */
+	MVKStorageModeByteCounts deviceMemoryBytes;		/** Bytes of VkDeviceMemory allocations, by the storage mode of their memory type. */
+	MVKStorageModeByteCounts imageTextureBytes;		/** Bytes of MTLTextures created for VkImages outside any VkDeviceMemory MTLBuffer or MTLHeap, as reported by Metal. */
+	MVKResourceCount internalMTLBufferBytes;		/** Bytes of MTLBuffers allocated by MoltenVK for internal use, such as staging and temporary buffers. */
+} MVKResourceStatistics;
+
+#define kMVKGPUFrameTimeCapacity	16
+
+/**
+ * GPU execution times of the MTLCommandBuffers of one frame on a VkQueue. A frame on a queue
+ * ends with each vkQueuePresentKHR() on that queue, and includes the presentation itself.
+ * You can retrieve the times of recent frames using the vkGetQueueGPUFrameTimesMVK() function.
+ *
+ * All times are in milliseconds. Start and end times are in the host time base used by
+ * CACurrentMediaTime() and the MTLCommandBuffer GPUStartTime and GPUEndTime properties.
+ */
+typedef struct {
+	uint64_t frameIndex;					/** The index of the frame, counted from the first frame on the queue. */
+	uint32_t mtlCommandBufferCount;			/** The number of MTLCommandBuffers executed in the frame. */
+	double gpuStartTime;					/** The time the GPU started executing the first MTLCommandBuffer of the frame. */
+	double gpuEndTime;						/** The time the GPU finished executing the last MTLCommandBuffer of the frame. */
+	double gpuBusyTime;						/** The time the GPU spent executing the MTLCommandBuffers of the frame, excluding gaps between them. */
+	double maxQueueLatency;					/** The longest time a MTLCommandBuffer of the frame waited for the GPU, after being scheduled. */
+	double gpuUtilization;					/** The fraction of the time between the GPU end of the previous frame and the GPU end of this frame, that the GPU was busy with this frame. */
+} MVKGPUFrameTime;
+
 
 #pragma mark -
 #pragma mark Function types
@@ -676,7 +1093,15 @@ typedef VkResult (VKAPI_PTR *PFN_vkGetMoltenVKConfigurationMVK)(VkInstance insta
 typedef VkResult (VKAPI_PTR *PFN_vkSetMoltenVKConfigurationMVK)(VkInstance instance, MVKConfiguration* pConfiguration, size_t* pConfigurationSize);
 typedef VkResult (VKAPI_PTR *PFN_vkGetPhysicalDeviceMetalFeaturesMVK)(VkPhysicalDevice physicalDevice, MVKPhysicalDeviceMetalFeatures* pMetalFeatures, size_t* pMetalFeaturesSize);
 typedef VkResult (VKAPI_PTR *PFN_vkGetPerformanceStatisticsMVK)(VkDevice device, MVKPerformanceStatistics* pPerf, size_t* pPerfSize);
+typedef VkResult (VKAPI_PTR *PFN_vkGetResourceStatisticsMVK)(VkDevice device, MVKResourceStatistics* pRezStats, size_t* pRezStatsSize);
+typedef VkResult (VKAPI_PTR *PFN_vkGetQueueGPUFrameTimesMVK)(VkQueue queue, uint32_t* pFrameTimeCount, MVKGPUFrameTime* pFrameTimes);
 typedef void (VKAPI_PTR *PFN_vkGetVersionStringsMVK)(char* pMoltenVersionStringBuffer, uint32_t moltenVersionStringBufferLength, char* pVulkanVersionStringBuffer, uint32_t vulkanVersionStringBufferLength);
+typedef void (VKAPI_PTR *PFN_vkPipelineCompiledMVK)(VkPipeline pipeline, VkResult result, void* pUserData);
+typedef VkResult (VKAPI_PTR *PFN_vkGetPipelineCompilationStatusMVK)(VkDevice device, VkPipeline pipeline);
+typedef void (VKAPI_PTR *PFN_vkSetPipelineCompilationCallbackMVK)(VkDevice device, VkPipeline pipeline, PFN_vkPipelineCompiledMVK pfnCallback, void* pUserData);
+typedef void (VKAPI_PTR *PFN_vkSetWorkgroupSizeTunableMVK)(VkShaderModule shaderModule, VkBool32 isTunable);
+typedef void (VKAPI_PTR *PFN_vkGetPipelineWorkgroupSizeMVK)(VkPipeline pipeline, uint32_t* pX, uint32_t* pY, uint32_t* pZ);
+typedef void (VKAPI_PTR *PFN_vkSetSwapchainImageRenderExtentMVK)(VkSwapchainKHR swapchain, uint32_t imageIndex, const VkExtent2D* pRenderExtent);
 
 #ifdef __OBJC__
 typedef void (VKAPI_PTR *PFN_vkGetMTLDeviceMVK)(VkPhysicalDevice physicalDevice, id<MTLDevice>* pMTLDevice);
@@ -840,6 +1265,65 @@ VKAPI_ATTR VkResult VKAPI_CALL vkGetPerformanceStatisticsMVK(
 	MVKPerformanceStatistics*            		pPerf,
 	size_t*                                     pPerfSize);
 
+/**
+ * Populates the pRezStats structure with the current counts of the resources of the VkDevice,
+ * along with the highest counts reached since the VkDevice was created.
+ *
+ * If you are linking to an implementation of MoltenVK that was compiled from a different
+ * VK_MVK_MOLTENVK_SPEC_VERSION than your app was, the size of the MVKResourceStatistics
+ * structure in your app may be larger or smaller than the same struct as expected by MoltenVK.
+ *
+ * When calling this function, set the value of *pRezStatsSize to sizeof(MVKResourceStatistics),
+ * to tell MoltenVK the limit of the size of your MVKResourceStatistics structure. Upon return from
+ * this function, the value of *pRezStatsSize will hold the actual number of bytes copied into your
+ * passed MVKResourceStatistics structure, which will be the smaller of what your app thinks is the
+ * size of MVKResourceStatistics, and what MoltenVK thinks it is. This represents the safe access
+ * area within the structure for both MoltenVK and your app.
+ *
+ * If the size that MoltenVK expects for MVKResourceStatistics is different than the value passed
+ * in *pRezStatsSize, this function will return VK_INCOMPLETE, otherwise it will return VK_SUCCESS.
+ *
+ * Although it is not necessary, you can use this function to determine in advance the value
+ * that MoltenVK expects the size of MVKResourceStatistics to be by setting the value of
+ * pRezStats to NULL. In that case, this function will set *pRezStatsSize to the size that
+ * MoltenVK expects MVKResourceStatistics to be.
+ *
+ * This function is not supported by the Vulkan SDK Loader and Layers framework.
+ * The VkDevice object you provide here must have been retrieved directly from
+ * MoltenVK, and not through the Vulkan SDK Loader and Layers framework. Opaque Vulkan
+ * objects are often changed by layers, and passing them from one layer to another,
+ * or from a layer directly to MoltenVK, will result in undefined behaviour.
+ */
+VKAPI_ATTR VkResult VKAPI_CALL vkGetResourceStatisticsMVK(
+	VkDevice                                    device,
+	MVKResourceStatistics*                      pRezStats,
+	size_t*                                     pRezStatsSize);
+
+/**
+ * Populates the pFrameTimes array with the GPU execution times of the most recent completed frames
+ * on the VkQueue, oldest first. Up to kMVKGPUFrameTimeCapacity recent frames are retained per queue.
+ * A frame is complete once all of its MTLCommandBuffers, including its presentation, have completed.
+ *
+ * If pFrameTimes is NULL, *pFrameTimeCount is set to the number of completed frames available.
+ * Otherwise, on input *pFrameTimeCount must be the number of elements in the pFrameTimes array,
+ * and on output it is set to the number of elements populated. If fewer elements were populated
+ * than the number of completed frames available, this function returns VK_INCOMPLETE, otherwise
+ * it returns VK_SUCCESS.
+ *
+ * The GPU times are reported by Metal on macOS 10.15 and iOS 10.3, and later. On earlier OS versions,
+ * the frame times will contain only the frame index and MTLCommandBuffer count.
+ *
+ * This function is not supported by the Vulkan SDK Loader and Layers framework.
+ * The VkQueue object you provide here must have been retrieved directly from
+ * MoltenVK, and not through the Vulkan SDK Loader and Layers framework. Opaque Vulkan
+ * objects are often changed by layers, and passing them from one layer to another,
+ * or from a layer directly to MoltenVK, will result in undefined behaviour.
+ */
+VKAPI_ATTR VkResult VKAPI_CALL vkGetQueueGPUFrameTimesMVK(
+	VkQueue                                     queue,
+	uint32_t*                                   pFrameTimeCount,
+	MVKGPUFrameTime*                            pFrameTimes);
+
 /**
  * Returns a human readable version of the MoltenVK and Vulkan versions.
  *
@@ -872,6 +1356,103 @@ VKAPI_ATTR void VKAPI_CALL vkSetWorkgroupSizeMVK(
     uint32_t                                    y,
     uint32_t                                    z);
 
+/**
+ * Returns the status of the compilation of the Metal pipeline states of a VkPipeline.
+ *
+ * Compilation occurs in the background only if the MVK_CONFIG_ASYNC_PIPELINE_COMPILATION
+ * setting is enabled. Otherwise, compilation is complete once the pipeline has been created.
+ *
+ * Returns:
+ *   - VK_SUCCESS if compilation is complete, and the pipeline can be used without waiting.
+ *   - VK_NOT_READY if compilation is still in progress.
+ *   - VK_ERROR_INITIALIZATION_FAILED if compilation failed. Draws or dispatches that use
+ *     the pipeline will be skipped.
+ *
+ * This function is not supported by the Vulkan SDK Loader and Layers framework.
+ * The VkPipeline object you provide here must have been retrieved directly from
+ * MoltenVK, and not through the Vulkan SDK Loader and Layers framework. Opaque Vulkan
+ * objects are often changed by layers, and passing them from one layer to another,
+ * or from a layer directly to MoltenVK, will result in undefined behaviour.
+ */
+VKAPI_ATTR VkResult VKAPI_CALL vkGetPipelineCompilationStatusMVK(
+    VkDevice                                    device,
+    VkPipeline                                  pipeline);
+
+/**
+ * Registers a callback function that will be called, on an arbitrary thread, once the compilation
+ * of the Metal pipeline states of a VkPipeline is complete. The callback function is passed the
+ * compilation result, as would be returned by vkGetPipelineCompilationStatusMVK(), along with the
+ * pUserData value. If compilation is already complete, the callback function is called immediately,
+ * on the calling thread. The pipeline will not be deleted until the callback function has returned.
+ *
+ * This function is not supported by the Vulkan SDK Loader and Layers framework.
+ * The VkPipeline object you provide here must have been retrieved directly from
+ * MoltenVK, and not through the Vulkan SDK Loader and Layers framework. Opaque Vulkan
+ * objects are often changed by layers, and passing them from one layer to another,
+ * or from a layer directly to MoltenVK, will result in undefined behaviour.
+ */
+VKAPI_ATTR void VKAPI_CALL vkSetPipelineCompilationCallbackMVK(
+    VkDevice                                    device,
+    VkPipeline                                  pipeline,
+    PFN_vkPipelineCompiledMVK                   pfnCallback,
+    void*                                       pUserData);
+
+/**
+ * Sets whether compute pipelines created from the shader module after this call may choose the
+ * number of threads in each workgroup, to suit the GPU, instead of using the number specified by
+ * the app. This applies only to workgroups that are one-dimensional, and whose width is set by a
+ * specialization constant, which is then ignored if it is included in the specialization info of
+ * the pipeline. Because the number of workgroups in each dispatch depends on the width of each
+ * workgroup, the app must retrieve the width chosen for each pipeline, using the
+ * vkGetPipelineWorkgroupSizeMVK() function, and size its dispatches accordingly.
+ *
+ * This function is not supported by the Vulkan SDK Loader and Layers framework.
+ * The VkShaderModule object you provide here must have been retrieved directly from
+ * MoltenVK, and not through the Vulkan SDK Loader and Layers framework. Opaque Vulkan
+ * objects are often changed by layers, and passing them from one layer to another,
+ * or from a layer directly to MoltenVK, will result in undefined behaviour.
+ */
+VKAPI_ATTR void VKAPI_CALL vkSetWorkgroupSizeTunableMVK(
+    VkShaderModule                              shaderModule,
+    VkBool32                                    isTunable);
+
+/**
+ * Returns, in pX, pY and pZ, the number of threads per workgroup, in each dimension, used by
+ * dispatches with the compute pipeline, including a width chosen by MoltenVK, if permitted via
+ * vkSetWorkgroupSizeTunableMVK(). Returns zero in each dimension if the pipeline is not a compute pipeline.
+ *
+ * This function is not supported by the Vulkan SDK Loader and Layers framework.
+ * The VkPipeline object you provide here must have been retrieved directly from
+ * MoltenVK, and not through the Vulkan SDK Loader and Layers framework. Opaque Vulkan
+ * objects are often changed by layers, and passing them from one layer to another,
+ * or from a layer directly to MoltenVK, will result in undefined behaviour.
+ */
+VKAPI_ATTR void VKAPI_CALL vkGetPipelineWorkgroupSizeMVK(
+    VkPipeline                                  pipeline,
+    uint32_t*                                   pX,
+    uint32_t*                                   pY,
+    uint32_t*                                   pZ);
+
+/**
+ * Sets the extent of the region, at the origin of the swapchain image at the specified index,
+ * that the app renders for subsequent presentations of that image. When the image is presented,
+ * if MVK_CONFIG_SWAPCHAIN_UPSCALE_FILTER is enabled, and the extent is smaller than the image,
+ * the region is upscaled to cover the entire image, before any overlays, such as the performance
+ * HUD, are rendered. The extent applies to each presentation of the image, from the next call
+ * to vkQueuePresentKHR() until it is changed. If pRenderExtent is null, or has a zero width or
+ * height, the entire image is presented without upscaling.
+ *
+ * This function is not supported by the Vulkan SDK Loader and Layers framework.
+ * The VkSwapchainKHR object you provide here must have been retrieved directly from
+ * MoltenVK, and not through the Vulkan SDK Loader and Layers framework. Opaque Vulkan
+ * objects are often changed by layers, and passing them from one layer to another,
+ * or from a layer directly to MoltenVK, will result in undefined behaviour.
+ */
+VKAPI_ATTR void VKAPI_CALL vkSetSwapchainImageRenderExtentMVK(
+    VkSwapchainKHR                              swapchain,
+    uint32_t                                    imageIndex,
+    const VkExtent2D*                           pRenderExtent);
+
 #ifdef __OBJC__
 
 /**
@@ -34,6 +34,8 @@ public:
 
 	~MVKCmdDebugMarker() override;
 
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryDebugMarker; }
+
 protected:
 	NSString* _markerName = nil;
 };
@@ -64,6 +66,7 @@ public:
 	VkResult setContent(MVKCommandBuffer* cmdBuff);
 
 	void encode(MVKCommandEncoder* cmdEncoder) override;
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryDebugMarker; }
 
 protected:
 	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
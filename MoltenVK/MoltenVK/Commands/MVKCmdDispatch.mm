@@ -45,22 +45,11 @@ VkResult MVKCmdDispatch::setContent(MVKCommandBuffer* cmdBuff,
 void MVKCmdDispatch::encode(MVKCommandEncoder* cmdEncoder) {
 //    MVKLogDebug("vkCmdDispatch() dispatching (%d, %d, %d) threadgroups.", _x, _y, _z);
 
-	MTLRegion mtlThreadgroupCount = MTLRegionMake3D(_baseGroupX, _baseGroupY, _baseGroupZ, _groupCountX, _groupCountY, _groupCountZ);
 	cmdEncoder->finalizeDispatchState();	// Ensure all updated state has been submitted to Metal
 	id<MTLComputeCommandEncoder> mtlEncoder = cmdEncoder->getMTLComputeEncoder(kMVKCommandUseDispatch);
 	auto* pipeline = (MVKComputePipeline*)cmdEncoder->_computePipelineState.getPipeline();
-	if (pipeline->allowsDispatchBase()) {
-		if ([mtlEncoder respondsToSelector: @selector(setStageInRegion:)]) {
-			// We'll use the stage-input region to pass the base along to the shader.
-			// Hopefully Metal won't complain that we didn't set up a stage-input descriptor.
-			[mtlEncoder setStageInRegion: mtlThreadgroupCount];
-		} else {
-			// We have to pass the base group in a buffer.
-			uint32_t base[3] = {(uint32_t)mtlThreadgroupCount.origin.x, (uint32_t)mtlThreadgroupCount.origin.y, (uint32_t)mtlThreadgroupCount.origin.z};
-			cmdEncoder->setComputeBytes(mtlEncoder, base, sizeof(base), pipeline->getIndirectParamsIndex().stages[kMVKShaderStageCompute]);
-		}
-	}
-	[mtlEncoder dispatchThreadgroups: mtlThreadgroupCount.size
+	cmdEncoder->setComputeDispatchBase(pipeline, MTLOriginMake(_baseGroupX, _baseGroupY, _baseGroupZ));
+	[mtlEncoder dispatchThreadgroups: MTLSizeMake(_groupCountX, _groupCountY, _groupCountZ)
 			   threadsPerThreadgroup: cmdEncoder->_mtlThreadgroupSize];
 }
 
@@ -80,8 +69,11 @@ void MVKCmdDispatchIndirect::encode(MVKCommandEncoder* cmdEncoder) {
 //    MVKLogDebug("vkCmdDispatchIndirect() dispatching indirectly.");
 
     cmdEncoder->finalizeDispatchState();	// Ensure all updated state has been submitted to Metal
-    [cmdEncoder->getMTLComputeEncoder(kMVKCommandUseDispatch) dispatchThreadgroupsWithIndirectBuffer: _mtlIndirectBuffer
-																				indirectBufferOffset: _mtlIndirectBufferOffset
-																			   threadsPerThreadgroup: cmdEncoder->_mtlThreadgroupSize];
+	id<MTLComputeCommandEncoder> mtlEncoder = cmdEncoder->getMTLComputeEncoder(kMVKCommandUseDispatch);
+	auto* pipeline = (MVKComputePipeline*)cmdEncoder->_computePipelineState.getPipeline();
+	cmdEncoder->setComputeDispatchBase(pipeline, MTLOriginMake(0, 0, 0));	// Indirect dispatches have no base
+    [mtlEncoder dispatchThreadgroupsWithIndirectBuffer: _mtlIndirectBuffer
+								  indirectBufferOffset: _mtlIndirectBufferOffset
+								 threadsPerThreadgroup: cmdEncoder->_mtlThreadgroupSize];
 }
 
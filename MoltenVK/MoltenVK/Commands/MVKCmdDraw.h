@@ -70,6 +70,10 @@ public:
 
 	void encode(MVKCommandEncoder* cmdEncoder) override;
 
+	bool gatherIndirectDrawConversions(MVKIndirectDrawConversionBatch& batch) override;
+
+	void gatherIndirectDrawRunState(MVKIndirectDrawRunState& state) override;
+
 protected:
 	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
 
@@ -91,6 +95,11 @@ public:
 						uint32_t firstInstance);
 
     void encode(MVKCommandEncoder* cmdEncoder) override;
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryDraw; }
+
+	bool canEncodeIndirectly(MVKGraphicsPipeline* pipeline) override;
+
+	void encodeIndirectly(const MVKIndirectDrawRunState& state, id<MTLIndirectRenderCommand> mtlIndRendCmd) override;
 
 protected:
 	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
@@ -117,6 +126,11 @@ public:
 						uint32_t firstInstance);
 
 	void encode(MVKCommandEncoder* cmdEncoder) override;
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryDraw; }
+
+	bool canEncodeIndirectly(MVKGraphicsPipeline* pipeline) override;
+
+	void encodeIndirectly(const MVKIndirectDrawRunState& state, id<MTLIndirectRenderCommand> mtlIndRendCmd) override;
 
 protected:
 	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
@@ -143,6 +157,9 @@ public:
 						uint32_t stride);
 
 	void encode(MVKCommandEncoder* cmdEncoder) override;
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryDraw; }
+
+	bool gatherIndirectDrawConversions(MVKIndirectDrawConversionBatch& batch) override;
 
 protected:
 	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
@@ -168,6 +185,9 @@ public:
 						uint32_t stride);
 
 	void encode(MVKCommandEncoder* cmdEncoder) override;
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryDraw; }
+
+	bool gatherIndirectDrawConversions(MVKIndirectDrawConversionBatch& batch) override;
 
 protected:
 	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
@@ -69,6 +69,7 @@ VkResult MVKCmdBindIndexBuffer::setContent(MVKCommandBuffer* cmdBuff,
 										   VkIndexType indexType) {
 	MVKBuffer* mvkBuffer = (MVKBuffer*)buffer;
 	_binding.mtlBuffer = mvkBuffer->getMTLBuffer();
+	_binding.mvkBuffer = mvkBuffer;
 	_binding.offset = mvkBuffer->getMTLBufferOffset() + offset;
 	_binding.mtlIndexType = mvkMTLIndexTypeFromVkIndexType(indexType);
 
@@ -79,6 +80,15 @@ void MVKCmdBindIndexBuffer::encode(MVKCommandEncoder* cmdEncoder) {
     cmdEncoder->_graphicsResourcesState.bindIndexBuffer(_binding);
 }
 
+bool MVKCmdBindIndexBuffer::gatherIndirectDrawConversions(MVKIndirectDrawConversionBatch& batch) {
+	batch.indexBuffer = _binding;
+	return true;
+}
+
+void MVKCmdBindIndexBuffer::gatherIndirectDrawRunState(MVKIndirectDrawRunState& state) {
+	state.indexBuffer = _binding;
+}
+
 
 #pragma mark -
 #pragma mark MVKCmdDraw
@@ -136,7 +146,7 @@ void MVKCmdDraw::encode(MVKCommandEncoder* cmdEncoder) {
 		switch (stage) {
             case kMVKGraphicsStageVertex:
                 if (pipeline->needsVertexOutputBuffer()) {
-                    vtxOutBuff = cmdEncoder->getTempMTLBuffer(_vertexCount * _instanceCount * 4 * cmdEncoder->_pDeviceProperties->limits.maxVertexOutputComponents);
+                    vtxOutBuff = cmdEncoder->getTessellationScratchBuffer(kMVKTessScratchVertexOutput, _vertexCount * _instanceCount * pipeline->getVertexOutputStride());
                     [cmdEncoder->_mtlRenderEncoder setVertexBuffer: vtxOutBuff->_mtlBuffer
                                                             offset: vtxOutBuff->_offset
                                                            atIndex: pipeline->getOutputBufferIndex().stages[kMVKShaderStageVertex]];
@@ -171,18 +181,18 @@ void MVKCmdDraw::encode(MVKCommandEncoder* cmdEncoder) {
             case kMVKGraphicsStageTessControl:
                 mtlTessCtlEncoder = cmdEncoder->getMTLComputeEncoder(kMVKCommandUseTessellationControl);
                 if (pipeline->needsTessCtlOutputBuffer()) {
-                    tcOutBuff = cmdEncoder->getTempMTLBuffer(outControlPointCount * patchCount * _instanceCount * 4 * cmdEncoder->_pDeviceProperties->limits.maxTessellationControlPerVertexOutputComponents);
+                    tcOutBuff = cmdEncoder->getTessellationScratchBuffer(kMVKTessScratchTessCtlOutput, outControlPointCount * patchCount * _instanceCount * pipeline->getTessCtlOutputStride());
                     [mtlTessCtlEncoder setBuffer: tcOutBuff->_mtlBuffer
                                           offset: tcOutBuff->_offset
                                          atIndex: pipeline->getOutputBufferIndex().stages[kMVKShaderStageTessCtl]];
                 }
                 if (pipeline->needsTessCtlPatchOutputBuffer()) {
-                    tcPatchOutBuff = cmdEncoder->getTempMTLBuffer(_instanceCount * patchCount * 4 * cmdEncoder->_pDeviceProperties->limits.maxTessellationControlPerPatchOutputComponents);
+                    tcPatchOutBuff = cmdEncoder->getTessellationScratchBuffer(kMVKTessScratchTessCtlPatchOutput, _instanceCount * patchCount * pipeline->getTessCtlPatchOutputStride());
                     [mtlTessCtlEncoder setBuffer: tcPatchOutBuff->_mtlBuffer
                                           offset: tcPatchOutBuff->_offset
                                          atIndex: pipeline->getTessCtlPatchOutputBufferIndex()];
                 }
-                tcLevelBuff = cmdEncoder->getTempMTLBuffer(_instanceCount * patchCount * sizeof(MTLQuadTessellationFactorsHalf));
+                tcLevelBuff = cmdEncoder->getTessellationScratchBuffer(kMVKTessScratchTessCtlLevel, _instanceCount * patchCount * sizeof(MTLQuadTessellationFactorsHalf));
                 [mtlTessCtlEncoder setBuffer: tcLevelBuff->_mtlBuffer
                                       offset: tcLevelBuff->_offset
                                      atIndex: pipeline->getTessCtlLevelBufferIndex()];
@@ -267,6 +277,24 @@ void MVKCmdDraw::encode(MVKCommandEncoder* cmdEncoder) {
     }
 }
 
+// Returns whether a non-tessellated draw can be encoded into a MTLIndirectCommandBuffer, given the bound
+// pipeline. All other state is inherited by the indirect command from the MTLRenderCommandEncoder.
+static bool mvkCanEncodeDrawIndirectly(MVKGraphicsPipeline* pipeline) {
+	return pipeline && !pipeline->isTessellationPipeline() && pipeline->hasValidMTLPipelineStates();
+}
+
+bool MVKCmdDraw::canEncodeIndirectly(MVKGraphicsPipeline* pipeline) {
+	return mvkCanEncodeDrawIndirectly(pipeline);
+}
+
+void MVKCmdDraw::encodeIndirectly(const MVKIndirectDrawRunState& state, id<MTLIndirectRenderCommand> mtlIndRendCmd) {
+	[mtlIndRendCmd drawPrimitives: state.mtlPrimitiveType
+					  vertexStart: _firstVertex
+					  vertexCount: _vertexCount
+					instanceCount: _instanceCount
+					 baseInstance: _firstInstance];
+}
+
 
 #pragma mark -
 #pragma mark MVKCmdDrawIndexed
@@ -314,7 +342,9 @@ void MVKCmdDrawIndexed::encode(MVKCommandEncoder* cmdEncoder) {
     const MVKMTLBufferAllocation* tcOutBuff = nullptr;
     const MVKMTLBufferAllocation* tcPatchOutBuff = nullptr;
     const MVKMTLBufferAllocation* tcLevelBuff = nullptr;
-    const MVKMTLBufferAllocation* tcIndexBuff = nullptr;
+    id<MTLBuffer> tcIndexMTLBuff = nil;
+    NSUInteger tcIndexMTLBuffOffset = 0;
+    bool needsIndexConversion = false;
     uint32_t patchCount = 0;
     uint32_t inControlPointCount = 0, outControlPointCount = 0;
     if (pipeline->isTessellationPipeline()) {
@@ -331,15 +361,37 @@ void MVKCmdDrawIndexed::encode(MVKCommandEncoder* cmdEncoder) {
             // to handle instancing. Do it now, before finalizing draw state, or the
             // pipeline will get overridden.
             // Yeah, this sucks. But there aren't many good ways for dealing with this issue.
+            // If the content of the index buffer can only change through commands that we can track,
+            // the converted indices can be reused by later draws, until the content changes.
+            NSUInteger tcIndexLength = _instanceCount * patchCount * outControlPointCount * idxSize;
+            needsIndexConversion = true;
+            if (ibb.mvkBuffer && ibb.mvkBuffer->canTrackContentChanges()) {
+                MVKConvertedIndexBufferKey cibKey;
+                mvkClear(&cibKey);
+                cibKey.contentGeneration = ibb.mvkBuffer->getContentGeneration();
+                cibKey.offset = ibb.offset;
+                cibKey.firstIndex = _firstIndex;
+                cibKey.indexCount = _indexCount;
+                cibKey.instanceCount = _instanceCount;
+                cibKey.mtlIndexType = ibb.mtlIndexType;
+                cibKey.inControlPointCount = inControlPointCount;
+                cibKey.outControlPointCount = outControlPointCount;
+                tcIndexMTLBuff = cmdEncoder->getConvertedIndexMTLBuffer(cibKey, tcIndexLength, tcIndexMTLBuffOffset, needsIndexConversion);
+            } else {
+                const MVKMTLBufferAllocation* tcIndexBuff = cmdEncoder->getTempMTLBuffer(tcIndexLength);
+                tcIndexMTLBuff = tcIndexBuff->_mtlBuffer;
+                tcIndexMTLBuffOffset = tcIndexBuff->_offset;
+            }
+        }
+        if (stage == kMVKGraphicsStageTessControl && needsIndexConversion) {
             mtlTessCtlEncoder = cmdEncoder->getMTLComputeEncoder(kMVKCommandUseTessellationControl);
-            tcIndexBuff = cmdEncoder->getTempMTLBuffer(_instanceCount * patchCount * outControlPointCount * idxSize);
             id<MTLComputePipelineState> mtlCopyIndexState = cmdEncoder->getCommandEncodingPool()->getCmdDrawIndexedCopyIndexBufferMTLComputePipelineState((MTLIndexType)ibb.mtlIndexType);
             [mtlTessCtlEncoder setComputePipelineState: mtlCopyIndexState];
             [mtlTessCtlEncoder setBuffer: ibb.mtlBuffer
                                   offset: ibb.offset
                                  atIndex: 0];
-            [mtlTessCtlEncoder setBuffer: tcIndexBuff->_mtlBuffer
-                                  offset: tcIndexBuff->_offset
+            [mtlTessCtlEncoder setBuffer: tcIndexMTLBuff
+                                  offset: tcIndexMTLBuffOffset
                                  atIndex: 1];
             cmdEncoder->setComputeBytes(mtlTessCtlEncoder,
                                         &inControlPointCount,
@@ -368,7 +420,7 @@ void MVKCmdDrawIndexed::encode(MVKCommandEncoder* cmdEncoder) {
         switch (stage) {
             case kMVKGraphicsStageVertex:
                 if (pipeline->needsVertexOutputBuffer()) {
-                    vtxOutBuff = cmdEncoder->getTempMTLBuffer(_indexCount * _instanceCount * 4 * cmdEncoder->_pDeviceProperties->limits.maxVertexOutputComponents);
+                    vtxOutBuff = cmdEncoder->getTessellationScratchBuffer(kMVKTessScratchVertexOutput, _indexCount * _instanceCount * pipeline->getVertexOutputStride());
                     [cmdEncoder->_mtlRenderEncoder setVertexBuffer: vtxOutBuff->_mtlBuffer
                                                             offset: vtxOutBuff->_offset
                                                            atIndex: pipeline->getOutputBufferIndex().stages[kMVKShaderStageVertex]];
@@ -406,18 +458,18 @@ void MVKCmdDrawIndexed::encode(MVKCommandEncoder* cmdEncoder) {
             case kMVKGraphicsStageTessControl:
                 mtlTessCtlEncoder = cmdEncoder->getMTLComputeEncoder(kMVKCommandUseTessellationControl);
                 if (pipeline->needsTessCtlOutputBuffer()) {
-                    tcOutBuff = cmdEncoder->getTempMTLBuffer(outControlPointCount * patchCount * _instanceCount * 4 * cmdEncoder->_pDeviceProperties->limits.maxTessellationControlPerVertexOutputComponents);
+                    tcOutBuff = cmdEncoder->getTessellationScratchBuffer(kMVKTessScratchTessCtlOutput, outControlPointCount * patchCount * _instanceCount * pipeline->getTessCtlOutputStride());
                     [mtlTessCtlEncoder setBuffer: tcOutBuff->_mtlBuffer
                                           offset: tcOutBuff->_offset
                                          atIndex: pipeline->getOutputBufferIndex().stages[kMVKShaderStageTessCtl]];
                 }
                 if (pipeline->needsTessCtlPatchOutputBuffer()) {
-                    tcPatchOutBuff = cmdEncoder->getTempMTLBuffer(_instanceCount * patchCount * 4 * cmdEncoder->_pDeviceProperties->limits.maxTessellationControlPerPatchOutputComponents);
+                    tcPatchOutBuff = cmdEncoder->getTessellationScratchBuffer(kMVKTessScratchTessCtlPatchOutput, _instanceCount * patchCount * pipeline->getTessCtlPatchOutputStride());
                     [mtlTessCtlEncoder setBuffer: tcPatchOutBuff->_mtlBuffer
                                           offset: tcPatchOutBuff->_offset
                                          atIndex: pipeline->getTessCtlPatchOutputBufferIndex()];
                 }
-                tcLevelBuff = cmdEncoder->getTempMTLBuffer(_instanceCount * patchCount * sizeof(MTLQuadTessellationFactorsHalf));
+                tcLevelBuff = cmdEncoder->getTessellationScratchBuffer(kMVKTessScratchTessCtlLevel, _instanceCount * patchCount * sizeof(MTLQuadTessellationFactorsHalf));
                 [mtlTessCtlEncoder setBuffer: tcLevelBuff->_mtlBuffer
                                       offset: tcLevelBuff->_offset
                                      atIndex: pipeline->getTessCtlLevelBufferIndex()];
@@ -432,8 +484,8 @@ void MVKCmdDrawIndexed::encode(MVKCommandEncoder* cmdEncoder) {
                     [mtlTessCtlEncoder setStageInRegion: MTLRegionMake1D(0, _instanceCount * std::max(_indexCount, outControlPointCount * patchCount))];
                 }
                 if (outControlPointCount > inControlPointCount || _instanceCount > 1) {
-                    [mtlTessCtlEncoder setBuffer: tcIndexBuff->_mtlBuffer
-                                          offset: tcIndexBuff->_offset
+                    [mtlTessCtlEncoder setBuffer: tcIndexMTLBuff
+                                          offset: tcIndexMTLBuffOffset
                                          atIndex: kMVKTessCtlIndexBufferIndex];
                 } else {
                     [mtlTessCtlEncoder setBuffer: ibb.mtlBuffer
@@ -502,6 +554,23 @@ void MVKCmdDrawIndexed::encode(MVKCommandEncoder* cmdEncoder) {
     }
 }
 
+bool MVKCmdDrawIndexed::canEncodeIndirectly(MVKGraphicsPipeline* pipeline) {
+	return mvkCanEncodeDrawIndirectly(pipeline);
+}
+
+void MVKCmdDrawIndexed::encodeIndirectly(const MVKIndirectDrawRunState& state, id<MTLIndirectRenderCommand> mtlIndRendCmd) {
+	const MVKIndexMTLBufferBinding& ibb = state.indexBuffer;
+	size_t idxSize = mvkMTLIndexTypeSizeInBytes((MTLIndexType)ibb.mtlIndexType);
+	[mtlIndRendCmd drawIndexedPrimitives: state.mtlPrimitiveType
+							  indexCount: _indexCount
+							   indexType: (MTLIndexType)ibb.mtlIndexType
+							 indexBuffer: ibb.mtlBuffer
+					   indexBufferOffset: ibb.offset + (_firstIndex * idxSize)
+						   instanceCount: _instanceCount
+							  baseVertex: _vertexOffset
+							baseInstance: _firstInstance];
+}
+
 
 #pragma mark -
 #pragma mark MVKCmdDrawIndirect
@@ -534,14 +603,26 @@ VkResult MVKCmdDrawIndirect::setContent(MVKCommandBuffer* cmdBuff,
 // require yet more munging of the indirect buffers...
 static const uint32_t kMVKDrawIndirectVertexCountUpperBound = 131072;
 
+bool MVKCmdDrawIndirect::gatherIndirectDrawConversions(MVKIndirectDrawConversionBatch& batch) {
+	batch.addDraws(this, false, _mtlIndirectBuffer, _mtlIndirectBufferOffset, _mtlIndirectBufferStride, _drawCount);
+	return true;
+}
+
 void MVKCmdDrawIndirect::encode(MVKCommandEncoder* cmdEncoder) {
 
+    // If the draws have already been encoded into a MTLIndirectCommandBuffer on the GPU, execute them all at once.
+    if (cmdEncoder->getIndirectDrawConversions().encodeMultiDraws(this, cmdEncoder)) { return; }
+
     auto* pipeline = (MVKGraphicsPipeline*)cmdEncoder->_graphicsPipelineState.getPipeline();
     // The indirect calls for dispatchThreadgroups:... and drawPatches:... have different formats.
     // We have to convert from the drawPrimitives:... format to them.
     // While we're at it, we can create the temporary output buffers once and reuse them
     // for each draw.
     const MVKMTLBufferAllocation* tcIndirectBuff = nullptr;
+    id<MTLBuffer> mtlTCIndBuff = nil;
+    VkDeviceSize mtlTCIndBuffStartOfst = 0;
+    NSUInteger tcIndirectArgsSize = 0, tcStageInArgsSize = 0;
+    bool isTCIndirectBuffConverted = false;
     const MVKMTLBufferAllocation* vtxOutBuff = nullptr;
     const MVKMTLBufferAllocation* tcOutBuff = nullptr;
     const MVKMTLBufferAllocation* tcPatchOutBuff = nullptr;
@@ -558,21 +639,26 @@ void MVKCmdDrawIndirect::encode(MVKCommandEncoder* cmdEncoder) {
         outControlPointCount = pipeline->getOutputControlPointCount();
         vertexCount = kMVKDrawIndirectVertexCountUpperBound;
         patchCount = mvkCeilingDivide(vertexCount, inControlPointCount);
-        VkDeviceSize indirectSize = (sizeof(MTLDispatchThreadgroupsIndirectArguments) + sizeof(MTLDrawPatchIndirectArguments)) * _drawCount;
-        if (cmdEncoder->_pDeviceMetalFeatures->mslVersion >= 20100) {
-            indirectSize += sizeof(MTLStageInRegionIndirectArguments) * _drawCount;
+        tcIndirectArgsSize = MVKIndirectDrawConversionBatch::getConvertedArgumentsSize(cmdEncoder->_pDeviceMetalFeatures);
+        tcStageInArgsSize = tcIndirectArgsSize - (sizeof(MTLDispatchThreadgroupsIndirectArguments) + sizeof(MTLDrawPatchIndirectArguments));
+        // If the indirect arguments were already converted before the render pass began, use them.
+        // Otherwise, they must be converted here, using a temporary buffer.
+        isTCIndirectBuffConverted = cmdEncoder->getIndirectDrawConversions().getConvertedArguments(this, pipeline, mtlTCIndBuff, mtlTCIndBuffStartOfst);
+        if ( !isTCIndirectBuffConverted ) {
+            tcIndirectBuff = cmdEncoder->getTempMTLBuffer(tcIndirectArgsSize * _drawCount);
+            mtlTCIndBuff = tcIndirectBuff->_mtlBuffer;
+            mtlTCIndBuffStartOfst = tcIndirectBuff->_offset;
         }
-        tcIndirectBuff = cmdEncoder->getTempMTLBuffer(indirectSize);
         if (pipeline->needsVertexOutputBuffer()) {
-            vtxOutBuff = cmdEncoder->getTempMTLBuffer(vertexCount * 4 * cmdEncoder->_pDeviceProperties->limits.maxVertexOutputComponents);
+            vtxOutBuff = cmdEncoder->getTessellationScratchBuffer(kMVKTessScratchVertexOutput, vertexCount * pipeline->getVertexOutputStride());
         }
         if (pipeline->needsTessCtlOutputBuffer()) {
-            tcOutBuff = cmdEncoder->getTempMTLBuffer(outControlPointCount * patchCount * 4 * cmdEncoder->_pDeviceProperties->limits.maxTessellationControlPerVertexOutputComponents);
+            tcOutBuff = cmdEncoder->getTessellationScratchBuffer(kMVKTessScratchTessCtlOutput, outControlPointCount * patchCount * pipeline->getTessCtlOutputStride());
         }
         if (pipeline->needsTessCtlPatchOutputBuffer()) {
-            tcPatchOutBuff = cmdEncoder->getTempMTLBuffer(patchCount * 4 * cmdEncoder->_pDeviceProperties->limits.maxTessellationControlPerPatchOutputComponents);
+            tcPatchOutBuff = cmdEncoder->getTessellationScratchBuffer(kMVKTessScratchTessCtlPatchOutput, patchCount * pipeline->getTessCtlPatchOutputStride());
         }
-        tcLevelBuff = cmdEncoder->getTempMTLBuffer(patchCount * sizeof(MTLQuadTessellationFactorsHalf));
+        tcLevelBuff = cmdEncoder->getTessellationScratchBuffer(kMVKTessScratchTessCtlLevel, patchCount * sizeof(MTLQuadTessellationFactorsHalf));
         if (outControlPointCount > inControlPointCount) {
             // In this case, we use an index buffer to avoid stepping over some of the input points.
             tcIndexBuff = cmdEncoder->getTempMTLBuffer(patchCount * outControlPointCount * 4);
@@ -592,12 +678,14 @@ void MVKCmdDrawIndirect::encode(MVKCommandEncoder* cmdEncoder) {
     pipeline->getStages(stages);
 
     VkDeviceSize mtlIndBuffOfst = _mtlIndirectBufferOffset;
-    VkDeviceSize mtlTCIndBuffOfst = tcIndirectBuff ? tcIndirectBuff->_offset : 0;
     for (uint32_t drawIdx = 0; drawIdx < _drawCount; drawIdx++) {
+        // The converted arguments of each draw consist of optional stage-in region
+        // arguments, followed by tess. control dispatch and draw-patches arguments.
+        VkDeviceSize mtlTCIndBuffOfst = mtlTCIndBuffStartOfst + drawIdx * tcIndirectArgsSize + tcStageInArgsSize;
         for (uint32_t s : stages) {
             auto stage = MVKGraphicsStage(s);
             id<MTLComputeCommandEncoder> mtlTessCtlEncoder = nil;
-            if (drawIdx == 0 && stage == kMVKGraphicsStageTessControl) {
+            if (drawIdx == 0 && stage == kMVKGraphicsStageTessControl && !isTCIndirectBuffConverted) {
                 // We need the indirect buffers now. This must be done before finalizing
                 // draw state, or the pipeline will get overridden. This is a good time
                 // to do it, since it will require switching to compute anyway. Do it all
@@ -683,10 +771,9 @@ void MVKCmdDrawIndirect::encode(MVKCommandEncoder* cmdEncoder) {
                                              atIndex: kMVKTessCtlInputBufferIndex];
                         if ([mtlTessCtlEncoder respondsToSelector: @selector(setStageInRegionWithIndirectBuffer:indirectBufferOffset:)]) {
                             // setStageInRegionWithIndirectBuffer appears to be broken. We have a 1D linear region anyway, so size is irrelevant
-                            //[mtlTessCtlEncoder setStageInRegionWithIndirectBuffer: tcIndirectBuff->_mtlBuffer
-                            //                                 indirectBufferOffset: mtlTCIndBuffOfst];
+                            //[mtlTessCtlEncoder setStageInRegionWithIndirectBuffer: mtlTCIndBuff
+                            //                                 indirectBufferOffset: mtlTCIndBuffOfst - tcStageInArgsSize];
                             [mtlTessCtlEncoder setStageInRegion: MTLRegionMake1D(0, std::max(inControlPointCount, outControlPointCount) * patchCount)];
-                            mtlTCIndBuffOfst += sizeof(MTLStageInRegionIndirectArguments);
                         } else {
                             // We must assume we can read up to the maximum number of vertices.
                             [mtlTessCtlEncoder setStageInRegion: MTLRegionMake1D(0, std::max(inControlPointCount, outControlPointCount) * patchCount)];
@@ -697,7 +784,7 @@ void MVKCmdDrawIndirect::encode(MVKCommandEncoder* cmdEncoder) {
                                               offset: tcIndexBuff->_offset
                                              atIndex: kMVKTessCtlIndexBufferIndex];
                     }
-                    [mtlTessCtlEncoder dispatchThreadgroupsWithIndirectBuffer: tcIndirectBuff->_mtlBuffer
+                    [mtlTessCtlEncoder dispatchThreadgroupsWithIndirectBuffer: mtlTCIndBuff
                                                          indirectBufferOffset: mtlTCIndBuffOfst
                                                         threadsPerThreadgroup: MTLSizeMake(std::max(inControlPointCount, outControlPointCount), 1, 1)];
                     mtlTCIndBuffOfst += sizeof(MTLDispatchThreadgroupsIndirectArguments);
@@ -726,9 +813,8 @@ void MVKCmdDrawIndirect::encode(MVKCommandEncoder* cmdEncoder) {
                         [cmdEncoder->_mtlRenderEncoder drawPatches: outControlPointCount
                                                   patchIndexBuffer: nil
                                             patchIndexBufferOffset: 0
-                                                    indirectBuffer: tcIndirectBuff->_mtlBuffer
+                                                    indirectBuffer: mtlTCIndBuff
                                               indirectBufferOffset: mtlTCIndBuffOfst];
-                        mtlTCIndBuffOfst += sizeof(MTLDrawPatchIndirectArguments);
                         // Mark pipeline, resources, and tess control push constants as dirty
                         // so I apply them during the next stage.
                         cmdEncoder->_graphicsPipelineState.beginMetalRenderPass();
@@ -772,8 +858,16 @@ VkResult MVKCmdDrawIndexedIndirect::setContent(MVKCommandBuffer* cmdBuff,
 	return VK_SUCCESS;
 }
 
+bool MVKCmdDrawIndexedIndirect::gatherIndirectDrawConversions(MVKIndirectDrawConversionBatch& batch) {
+	batch.addDraws(this, true, _mtlIndirectBuffer, _mtlIndirectBufferOffset, _mtlIndirectBufferStride, _drawCount);
+	return true;
+}
+
 void MVKCmdDrawIndexedIndirect::encode(MVKCommandEncoder* cmdEncoder) {
 
+    // If the draws have already been encoded into a MTLIndirectCommandBuffer on the GPU, execute them all at once.
+    if (cmdEncoder->getIndirectDrawConversions().encodeMultiDraws(this, cmdEncoder)) { return; }
+
     MVKIndexMTLBufferBinding& ibb = cmdEncoder->_graphicsResourcesState._mtlIndexBufferBinding;
     size_t idxSize = mvkMTLIndexTypeSizeInBytes((MTLIndexType)ibb.mtlIndexType);
     auto* pipeline = (MVKGraphicsPipeline*)cmdEncoder->_graphicsPipelineState.getPipeline();
@@ -782,6 +876,10 @@ void MVKCmdDrawIndexedIndirect::encode(MVKCommandEncoder* cmdEncoder) {
     // While we're at it, we can create the temporary output buffers once and reuse them
     // for each draw.
     const MVKMTLBufferAllocation* tcIndirectBuff = nullptr;
+    id<MTLBuffer> mtlTCIndBuff = nil;
+    VkDeviceSize mtlTCIndBuffStartOfst = 0;
+    NSUInteger tcIndirectArgsSize = 0, tcStageInArgsSize = 0;
+    bool isTCIndirectBuffConverted = false;
     const MVKMTLBufferAllocation* vtxOutBuff = nullptr;
     const MVKMTLBufferAllocation* tcOutBuff = nullptr;
     const MVKMTLBufferAllocation* tcPatchOutBuff = nullptr;
@@ -798,21 +896,26 @@ void MVKCmdDrawIndexedIndirect::encode(MVKCommandEncoder* cmdEncoder) {
         outControlPointCount = pipeline->getOutputControlPointCount();
         vertexCount = kMVKDrawIndirectVertexCountUpperBound;
         patchCount = mvkCeilingDivide(vertexCount, inControlPointCount);
-        VkDeviceSize indirectSize = (sizeof(MTLDispatchThreadgroupsIndirectArguments) + sizeof(MTLDrawPatchIndirectArguments)) * _drawCount;
-        if (cmdEncoder->_pDeviceMetalFeatures->mslVersion >= 20100) {
-            indirectSize += sizeof(MTLStageInRegionIndirectArguments) * _drawCount;
+        tcIndirectArgsSize = MVKIndirectDrawConversionBatch::getConvertedArgumentsSize(cmdEncoder->_pDeviceMetalFeatures);
+        tcStageInArgsSize = tcIndirectArgsSize - (sizeof(MTLDispatchThreadgroupsIndirectArguments) + sizeof(MTLDrawPatchIndirectArguments));
+        // If the indirect arguments were already converted before the render pass began, use them.
+        // Otherwise, they must be converted here, using a temporary buffer.
+        isTCIndirectBuffConverted = cmdEncoder->getIndirectDrawConversions().getConvertedArguments(this, pipeline, mtlTCIndBuff, mtlTCIndBuffStartOfst);
+        if ( !isTCIndirectBuffConverted ) {
+            tcIndirectBuff = cmdEncoder->getTempMTLBuffer(tcIndirectArgsSize * _drawCount);
+            mtlTCIndBuff = tcIndirectBuff->_mtlBuffer;
+            mtlTCIndBuffStartOfst = tcIndirectBuff->_offset;
         }
-        tcIndirectBuff = cmdEncoder->getTempMTLBuffer(indirectSize);
         if (pipeline->needsVertexOutputBuffer()) {
-            vtxOutBuff = cmdEncoder->getTempMTLBuffer(vertexCount * 4 * cmdEncoder->_pDeviceProperties->limits.maxVertexOutputComponents);
+            vtxOutBuff = cmdEncoder->getTessellationScratchBuffer(kMVKTessScratchVertexOutput, vertexCount * pipeline->getVertexOutputStride());
         }
         if (pipeline->needsTessCtlOutputBuffer()) {
-            tcOutBuff = cmdEncoder->getTempMTLBuffer(outControlPointCount * patchCount * 4 * cmdEncoder->_pDeviceProperties->limits.maxTessellationControlPerVertexOutputComponents);
+            tcOutBuff = cmdEncoder->getTessellationScratchBuffer(kMVKTessScratchTessCtlOutput, outControlPointCount * patchCount * pipeline->getTessCtlOutputStride());
         }
         if (pipeline->needsTessCtlPatchOutputBuffer()) {
-            tcPatchOutBuff = cmdEncoder->getTempMTLBuffer(patchCount * 4 * cmdEncoder->_pDeviceProperties->limits.maxTessellationControlPerPatchOutputComponents);
+            tcPatchOutBuff = cmdEncoder->getTessellationScratchBuffer(kMVKTessScratchTessCtlPatchOutput, patchCount * pipeline->getTessCtlPatchOutputStride());
         }
-        tcLevelBuff = cmdEncoder->getTempMTLBuffer(patchCount * sizeof(MTLQuadTessellationFactorsHalf));
+        tcLevelBuff = cmdEncoder->getTessellationScratchBuffer(kMVKTessScratchTessCtlLevel, patchCount * sizeof(MTLQuadTessellationFactorsHalf));
         tcIndexBuff = cmdEncoder->getTempMTLBuffer(patchCount * outControlPointCount * idxSize);
     }
 
@@ -820,8 +923,10 @@ void MVKCmdDrawIndexedIndirect::encode(MVKCommandEncoder* cmdEncoder) {
     pipeline->getStages(stages);
 
     VkDeviceSize mtlIndBuffOfst = _mtlIndirectBufferOffset;
-    VkDeviceSize mtlTCIndBuffOfst = tcIndirectBuff ? tcIndirectBuff->_offset : 0;
     for (uint32_t drawIdx = 0; drawIdx < _drawCount; drawIdx++) {
+        // The converted arguments of each draw consist of optional stage-in region
+        // arguments, followed by tess. control dispatch and draw-patches arguments.
+        VkDeviceSize mtlTCIndBuffOfst = mtlTCIndBuffStartOfst + drawIdx * tcIndirectArgsSize + tcStageInArgsSize;
         for (uint32_t s : stages) {
             auto stage = MVKGraphicsStage(s);
             id<MTLComputeCommandEncoder> mtlTessCtlEncoder = nil;
@@ -831,7 +936,7 @@ void MVKCmdDrawIndexedIndirect::encode(MVKCommandEncoder* cmdEncoder) {
                 // draw state, or the pipeline will get overridden. This is a good time
                 // to do it, since it will require switching to compute anyway. Do it all
                 // at once to get it over with.
-                if (drawIdx == 0) {
+                if (drawIdx == 0 && !isTCIndirectBuffConverted) {
                     id<MTLComputePipelineState> mtlConvertState = cmdEncoder->getCommandEncodingPool()->getCmdDrawIndirectConvertBuffersMTLComputePipelineState(true);
                     [mtlTessCtlEncoder setComputePipelineState: mtlConvertState];
                     [mtlTessCtlEncoder setBuffer: _mtlIndirectBuffer
@@ -879,8 +984,8 @@ void MVKCmdDrawIndexedIndirect::encode(MVKCommandEncoder* cmdEncoder) {
                                             &outControlPointCount,
                                             sizeof(outControlPointCount),
                                             3);
-                [mtlTessCtlEncoder setBuffer: tcIndirectBuff->_mtlBuffer
-                                      offset: mtlTCIndBuffOfst
+                [mtlTessCtlEncoder setBuffer: _mtlIndirectBuffer
+                                      offset: _mtlIndirectBufferOffset + drawIdx * _mtlIndirectBufferStride
                                      atIndex: 4];
                 [mtlTessCtlEncoder dispatchThreadgroups: MTLSizeMake(1, 1, 1) threadsPerThreadgroup: MTLSizeMake(1, 1, 1)];
             }
@@ -940,10 +1045,9 @@ void MVKCmdDrawIndexedIndirect::encode(MVKCommandEncoder* cmdEncoder) {
                                              atIndex: kMVKTessCtlInputBufferIndex];
                         if ([mtlTessCtlEncoder respondsToSelector: @selector(setStageInRegionWithIndirectBuffer:indirectBufferOffset:)]) {
                             // setStageInRegionWithIndirectBuffer appears to be broken. We have a 1D linear region anyway, so size is irrelevant
-                            //[mtlTessCtlEncoder setStageInRegionWithIndirectBuffer: tcIndirectBuff->_mtlBuffer
-                            //                                 indirectBufferOffset: mtlTCIndBuffOfst];
+                            //[mtlTessCtlEncoder setStageInRegionWithIndirectBuffer: mtlTCIndBuff
+                            //                                 indirectBufferOffset: mtlTCIndBuffOfst - tcStageInArgsSize];
                             [mtlTessCtlEncoder setStageInRegion: MTLRegionMake1D(0, std::max(inControlPointCount, outControlPointCount) * patchCount)];
-                            mtlTCIndBuffOfst += sizeof(MTLStageInRegionIndirectArguments);
                         } else {
                             // We must assume we can read up to the maximum number of vertices.
                             [mtlTessCtlEncoder setStageInRegion: MTLRegionMake1D(0, std::max(inControlPointCount, outControlPointCount) * patchCount)];
@@ -952,7 +1056,7 @@ void MVKCmdDrawIndexedIndirect::encode(MVKCommandEncoder* cmdEncoder) {
                     [mtlTessCtlEncoder setBuffer: tcIndexBuff->_mtlBuffer
                                           offset: tcIndexBuff->_offset
                                          atIndex: kMVKTessCtlIndexBufferIndex];
-                    [mtlTessCtlEncoder dispatchThreadgroupsWithIndirectBuffer: tcIndirectBuff->_mtlBuffer
+                    [mtlTessCtlEncoder dispatchThreadgroupsWithIndirectBuffer: mtlTCIndBuff
                                                          indirectBufferOffset: mtlTCIndBuffOfst
                                                         threadsPerThreadgroup: MTLSizeMake(std::max(inControlPointCount, outControlPointCount), 1, 1)];
                     mtlTCIndBuffOfst += sizeof(MTLDispatchThreadgroupsIndirectArguments);
@@ -981,9 +1085,8 @@ void MVKCmdDrawIndexedIndirect::encode(MVKCommandEncoder* cmdEncoder) {
                         [cmdEncoder->_mtlRenderEncoder drawPatches: outControlPointCount
                                                   patchIndexBuffer: nil
                                             patchIndexBufferOffset: 0
-                                                    indirectBuffer: tcIndirectBuff->_mtlBuffer
+                                                    indirectBuffer: mtlTCIndBuff
                                               indirectBufferOffset: mtlTCIndBuffOfst];
-                        mtlTCIndBuffOfst += sizeof(MTLDrawPatchIndirectArguments);
                         // Mark pipeline, resources, and tess control push constants as dirty
                         // so I apply them during the next stage.
                         cmdEncoder->_graphicsPipelineState.beginMetalRenderPass();
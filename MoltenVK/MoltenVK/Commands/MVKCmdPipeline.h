@@ -53,10 +53,16 @@ public:
 						const VkImageMemoryBarrier* pImageMemoryBarriers);
 
 	void encode(MVKCommandEncoder* cmdEncoder) override;
+	MVKCommandCategory getCategory() override { return kMVKCommandCategorySynchronization; }
+
+	bool gatherIndirectDrawConversions(MVKIndirectDrawConversionBatch& batch) override;
+
+	bool isPipelineBarrier() override { return true; }
 
 protected:
 	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
 	bool coversTextures();
+	void encodeConcurrentDispatchBarrier(id<MTLComputeCommandEncoder> mtlComputeEncoder);
 
 	MVKVectorInline<MVKPipelineBarrier, N> _barriers;
 	VkPipelineStageFlags _srcStageMask;
@@ -81,6 +87,8 @@ public:
 
 	virtual bool isTessellationPipeline() { return false; };
 
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryBindPipeline; }
+
 protected:
 	MVKPipeline* _pipeline;
 
@@ -96,6 +104,10 @@ class MVKCmdBindGraphicsPipeline : public MVKCmdBindPipeline {
 public:
 	void encode(MVKCommandEncoder* cmdEncoder) override;
 
+	bool gatherIndirectDrawConversions(MVKIndirectDrawConversionBatch& batch) override;
+
+	void gatherIndirectDrawRunState(MVKIndirectDrawRunState& state) override;
+
 	bool isTessellationPipeline() override;
 
 protected:
@@ -138,6 +150,7 @@ public:
 						const VkDescriptorSet* pDescriptorSets);
 
 	void encode(MVKCommandEncoder* cmdEncoder) override;
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryBindDescriptors; }
 
 protected:
 	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
@@ -237,6 +250,7 @@ public:
 						const VkWriteDescriptorSet* pDescriptorWrites);
 
 	void encode(MVKCommandEncoder* cmdEncoder) override;
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryBindDescriptors; }
 
 	~MVKCmdPushDescriptorSet() override;
 
@@ -265,6 +279,7 @@ public:
 						const void* pData);
 
 	void encode(MVKCommandEncoder* cmdEncoder) override;
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryBindDescriptors; }
 
 	~MVKCmdPushDescriptorSetWithTemplate() override;
 
@@ -289,6 +304,8 @@ public:
 						VkEvent event,
 						VkPipelineStageFlags stageMask);
 
+	MVKCommandCategory getCategory() override { return kMVKCommandCategorySynchronization; }
+
 protected:
 	MVKEvent* _mvkEvent;
 
@@ -334,7 +351,7 @@ protected:
  * Template class to balance vector pre-allocations between very common low counts and fewer larger counts.
  */
 template <size_t N>
-class MVKCmdWaitEvents : public MVKCommand {
+class MVKCmdWaitEvents : public MVKCommand, public MVKLoadStoreOverrideMixin {
 
 public:
 	VkResult setContent(MVKCommandBuffer* cmdBuff,
@@ -350,6 +367,7 @@ public:
 						const VkImageMemoryBarrier* pImageMemoryBarriers);
 
 	void encode(MVKCommandEncoder* cmdEncoder) override;
+	MVKCommandCategory getCategory() override { return kMVKCommandCategorySynchronization; }
 
 protected:
 	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
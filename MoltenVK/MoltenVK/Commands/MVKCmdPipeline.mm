@@ -61,9 +61,23 @@ VkResult MVKCmdPipelineBarrier<N>::setContent(MVKCommandBuffer* cmdBuff,
 	return VK_SUCCESS;
 }
 
+// Indirect draws that follow a barrier that waits on writes to indirect buffers
+// must not have their arguments converted before the render pass begins.
+template <size_t N>
+bool MVKCmdPipelineBarrier<N>::gatherIndirectDrawConversions(MVKIndirectDrawConversionBatch& batch) {
+	return !mvkIsAnyFlagEnabled(_dstStageMask, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+}
+
 template <size_t N>
 void MVKCmdPipelineBarrier<N>::encode(MVKCommandEncoder* cmdEncoder) {
 
+	// Metal encoders after the barrier wait for those before it, if hazards are tracked using fences.
+	cmdEncoder->markHazardBarrier();
+
+	// Concurrent dispatches only wait for each other where the app records a barrier.
+	id<MTLComputeCommandEncoder> mtlConcComputeEncoder = cmdEncoder->getConcurrentMTLComputeEncoder();
+	if (mtlConcComputeEncoder) { encodeConcurrentDispatchBarrier(mtlConcComputeEncoder); }
+
 #if MVK_MACOS
 	// Calls below invoke MTLBlitCommandEncoder so must apply this first.
 	// Check if pipeline barriers are available and we are in a renderpass.
@@ -144,6 +158,57 @@ bool MVKCmdPipelineBarrier<N>::coversTextures() {
 	return false;
 }
 
+// A barrier whose source stages cannot include compute dispatches does not separate them.
+// Global memory barriers, and barriers with no memory barriers at all, which are pure
+// execution dependencies, separate all subsequent dispatches from all preceding ones.
+// Otherwise, only the buffers and images named by the barriers are waited for.
+template <size_t N>
+void MVKCmdPipelineBarrier<N>::encodeConcurrentDispatchBarrier(id<MTLComputeCommandEncoder> mtlComputeEncoder) {
+	if ( !mvkIsAnyFlagEnabled(_srcStageMask, (VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+											  VK_PIPELINE_STAGE_ALL_COMMANDS_BIT |
+											  VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT)) ) { return; }
+
+	// A pure execution dependency is resolved before sizing the resource array, which must not be empty.
+	if (_barriers.empty()) {
+		[mtlComputeEncoder memoryBarrierWithScope: MTLBarrierScopeBuffers | MTLBarrierScopeTextures];
+		return;
+	}
+
+	id<MTLResource> resources[_barriers.size()];
+	uint32_t rezCnt = 0;
+	MTLBarrierScope scope = MTLBarrierScope(0);
+	bool needsScope = false;
+
+	for (auto& b : _barriers) {
+		switch (b.type) {
+			case MVKPipelineBarrier::Memory:
+				scope |= (mvkMTLBarrierScopeFromVkAccessFlags(b.srcAccessMask) |
+						  mvkMTLBarrierScopeFromVkAccessFlags(b.dstAccessMask));
+				needsScope = true;
+				break;
+
+			case MVKPipelineBarrier::Buffer:
+				resources[rezCnt++] = b.mvkBuffer->getMTLBuffer();
+				break;
+
+			case MVKPipelineBarrier::Image:
+				resources[rezCnt++] = b.mvkImage->getMTLTexture();
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	if (needsScope) {
+		scope &= (MTLBarrierScopeBuffers | MTLBarrierScopeTextures);
+		if ( !scope ) { scope = MTLBarrierScopeBuffers | MTLBarrierScopeTextures; }
+		[mtlComputeEncoder memoryBarrierWithScope: scope];
+	} else if (rezCnt) {
+		[mtlComputeEncoder memoryBarrierWithResources: resources count: rezCnt];
+	}
+}
+
 template class MVKCmdPipelineBarrier<1>;
 template class MVKCmdPipelineBarrier<4>;
 template class MVKCmdPipelineBarrier<32>;
@@ -168,6 +233,15 @@ void MVKCmdBindGraphicsPipeline::encode(MVKCommandEncoder* cmdEncoder) {
 	cmdEncoder->bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline);
 }
 
+bool MVKCmdBindGraphicsPipeline::gatherIndirectDrawConversions(MVKIndirectDrawConversionBatch& batch) {
+	batch.pipeline = (MVKGraphicsPipeline*)_pipeline;
+	return true;
+}
+
+void MVKCmdBindGraphicsPipeline::gatherIndirectDrawRunState(MVKIndirectDrawRunState& state) {
+	state.pipeline = (MVKGraphicsPipeline*)_pipeline;
+}
+
 bool MVKCmdBindGraphicsPipeline::isTessellationPipeline() {
 	return ((MVKGraphicsPipeline*)_pipeline)->isTessellationPipeline();
 }
@@ -395,39 +469,7 @@ VkResult MVKCmdPushDescriptorSetWithTemplate::setContent(MVKCommandBuffer* cmdBu
 	_pipelineLayout = (MVKPipelineLayout*)layout;
 	_set = set;
 	if (_pData) delete[] (char*)_pData;
-	// Work out how big the memory block in pData is.
-	const VkDescriptorUpdateTemplateEntryKHR* pEntry =
-		_descUpdateTemplate->getEntry(_descUpdateTemplate->getNumberOfEntries()-1);
-	size_t size = pEntry->offset;
-	// If we were given a stride, use that; otherwise, assume only one info
-	// struct of the appropriate type.
-	if (pEntry->stride)
-		size += pEntry->stride * pEntry->descriptorCount;
-	else switch (pEntry->descriptorType) {
-
-		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
-		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
-		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
-		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
-			size += sizeof(VkDescriptorBufferInfo);
-			break;
-
-		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
-		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
-		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
-		case VK_DESCRIPTOR_TYPE_SAMPLER:
-		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
-			size += sizeof(VkDescriptorImageInfo);
-			break;
-
-		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
-		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
-			size += sizeof(VkBufferView);
-			break;
-
-		default:
-			break;
-	}
+	size_t size = _descUpdateTemplate->getDataSize();
 	_pData = new char[size];
 	memcpy(_pData, pData, size);
 
@@ -493,15 +535,17 @@ VkResult MVKCmdWaitEvents<N>::setContent(MVKCommandBuffer* cmdBuff,
 	for (uint32_t i = 0; i < eventCount; i++) {
 		_mvkEvents.push_back((MVKEvent*)pEvents[i]);
 	}
+	_loadOverride = false;
+	_storeOverride = false;
+
+	cmdBuff->recordMetalRenderPassRestart(this);
 
 	return VK_SUCCESS;
 }
 
 template <size_t N>
 void MVKCmdWaitEvents<N>::encode(MVKCommandEncoder* cmdEncoder) {
-	for (MVKEvent* mvkEvt : _mvkEvents) {
-		mvkEvt->encodeWait(cmdEncoder->_mtlCmdBuffer);
-	}
+	cmdEncoder->waitEvents(_mvkEvents, _storeOverride);
 }
 
 template class MVKCmdWaitEvents<1>;
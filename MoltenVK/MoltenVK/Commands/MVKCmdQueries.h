@@ -35,6 +35,8 @@ public:
 						VkQueryPool queryPool,
 						uint32_t query);
 
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryQuery; }
+
 protected:
     MVKQueryPool* _queryPool;
     uint32_t _query;
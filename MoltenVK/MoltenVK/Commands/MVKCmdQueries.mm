@@ -20,6 +20,7 @@
 #include "MVKCommandBuffer.h"
 #include "MVKCommandPool.h"
 #include "MVKQueryPool.h"
+#include "MVKBuffer.h"
 
 
 #pragma mark -
@@ -80,7 +81,7 @@ VkResult MVKCmdWriteTimestamp::setContent(MVKCommandBuffer* cmdBuff,
 }
 
 void MVKCmdWriteTimestamp::encode(MVKCommandEncoder* cmdEncoder) {
-    cmdEncoder->markTimestamp(_queryPool, _query);
+    cmdEncoder->markTimestamp((MVKTimestampQueryPool*)_queryPool, _query);
 }
 
 
@@ -128,6 +129,8 @@ VkResult MVKCmdCopyQueryPoolResults::setContent(MVKCommandBuffer* cmdBuff,
 }
 
 void MVKCmdCopyQueryPoolResults::encode(MVKCommandEncoder* cmdEncoder) {
+	_destBuffer->markContentChanged();
+
     // What happens now depends on whether or not I was added before or after the query ended.
     if (!_queryPool->areQueriesDeviceAvailable(_query, _queryCount) && mvkIsAnyFlagEnabled(_flags, VK_QUERY_RESULT_WAIT_BIT)) {
         // Defer this until the queries will be done.
@@ -20,6 +20,7 @@
 
 #include "MVKCommand.h"
 #include "MVKDevice.h"
+#include "MVKRenderPass.h"
 #include "MVKVector.h"
 
 #import <Metal/Metal.h>
@@ -44,6 +45,9 @@ public:
 						VkSubpassContents contents);
 
 	void encode(MVKCommandEncoder* cmdEncoder) override;
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryRenderPass; }
+
+	bool inferLoadStoreActions(MVKLoadStoreActionInference& inference) override;
 
 protected:
 	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
@@ -53,6 +57,7 @@ protected:
 	MVKFramebuffer* _framebuffer;
 	VkRect2D _renderArea;
 	VkSubpassContents _contents;
+	MVKInferredLoadStoreActions _inferredLoadStores;
 };
 
 // Concrete template class implementations.
@@ -64,14 +69,15 @@ typedef MVKCmdBeginRenderPass<9> MVKCmdBeginRenderPassMulti;
 #pragma mark -
 #pragma mark MVKCmdNextSubpass
 
-/** Vulkan command to begin a render pass. */
-class MVKCmdNextSubpass : public MVKCommand {
+/** Vulkan command to begin the next subpass of a render pass. */
+class MVKCmdNextSubpass : public MVKCommand, public MVKLoadStoreOverrideMixin {
 
 public:
 	VkResult setContent(MVKCommandBuffer* cmdBuff,
 						VkSubpassContents contents);
 
 	void encode(MVKCommandEncoder* cmdEncoder) override;
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryRenderPass; }
 
 protected:
 	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
@@ -90,6 +96,11 @@ public:
 	VkResult setContent(MVKCommandBuffer* cmdBuff);
 
 	void encode(MVKCommandEncoder* cmdEncoder) override;
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryRenderPass; }
+
+	bool gatherIndirectDrawConversions(MVKIndirectDrawConversionBatch& batch) override { return false; }
+
+	bool inferLoadStoreActions(MVKLoadStoreActionInference& inference) override;
 
 protected:
 	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
@@ -113,6 +124,9 @@ public:
 						const VkCommandBuffer* pCommandBuffers);
 
 	void encode(MVKCommandEncoder* cmdEncoder) override;
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryExecuteCommands; }
+
+	bool gatherIndirectDrawConversions(MVKIndirectDrawConversionBatch& batch) override { return false; }
 
 protected:
 	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
@@ -332,3 +346,182 @@ protected:
     uint32_t _stencilReference;
 };
 
+
+
+#pragma mark -
+#pragma mark MVKCmdSetCullMode
+
+/** Vulkan command to set the cull mode. */
+class MVKCmdSetCullMode : public MVKCommand {
+
+public:
+	VkResult setContent(MVKCommandBuffer* cmdBuff,
+						VkCullModeFlags cullMode);
+
+    void encode(MVKCommandEncoder* cmdEncoder) override;
+
+protected:
+	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
+
+    VkCullModeFlags _cullMode;
+};
+
+
+#pragma mark -
+#pragma mark MVKCmdSetFrontFace
+
+/** Vulkan command to set the front facing winding. */
+class MVKCmdSetFrontFace : public MVKCommand {
+
+public:
+	VkResult setContent(MVKCommandBuffer* cmdBuff,
+						VkFrontFace frontFace);
+
+    void encode(MVKCommandEncoder* cmdEncoder) override;
+
+protected:
+	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
+
+    VkFrontFace _frontFace;
+};
+
+
+#pragma mark -
+#pragma mark MVKCmdSetPrimitiveTopology
+
+/** Vulkan command to set the primitive topology. */
+class MVKCmdSetPrimitiveTopology : public MVKCommand {
+
+public:
+	VkResult setContent(MVKCommandBuffer* cmdBuff,
+						VkPrimitiveTopology primitiveTopology);
+
+    void encode(MVKCommandEncoder* cmdEncoder) override;
+
+protected:
+	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
+
+    VkPrimitiveTopology _primitiveTopology;
+};
+
+
+#pragma mark -
+#pragma mark MVKCmdSetDepthTestEnable
+
+/** Vulkan command to enable or disable depth testing. */
+class MVKCmdSetDepthTestEnable : public MVKCommand {
+
+public:
+	VkResult setContent(MVKCommandBuffer* cmdBuff,
+						VkBool32 depthTestEnable);
+
+    void encode(MVKCommandEncoder* cmdEncoder) override;
+
+protected:
+	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
+
+    VkBool32 _depthTestEnable;
+};
+
+
+#pragma mark -
+#pragma mark MVKCmdSetDepthWriteEnable
+
+/** Vulkan command to enable or disable depth writing. */
+class MVKCmdSetDepthWriteEnable : public MVKCommand {
+
+public:
+	VkResult setContent(MVKCommandBuffer* cmdBuff,
+						VkBool32 depthWriteEnable);
+
+    void encode(MVKCommandEncoder* cmdEncoder) override;
+
+protected:
+	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
+
+    VkBool32 _depthWriteEnable;
+};
+
+
+#pragma mark -
+#pragma mark MVKCmdSetDepthCompareOp
+
+/** Vulkan command to set the depth compare operation. */
+class MVKCmdSetDepthCompareOp : public MVKCommand {
+
+public:
+	VkResult setContent(MVKCommandBuffer* cmdBuff,
+						VkCompareOp depthCompareOp);
+
+    void encode(MVKCommandEncoder* cmdEncoder) override;
+
+protected:
+	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
+
+    VkCompareOp _depthCompareOp;
+};
+
+
+#pragma mark -
+#pragma mark MVKCmdSetDepthBoundsTestEnable
+
+/** Vulkan command to enable or disable depth bounds testing. */
+class MVKCmdSetDepthBoundsTestEnable : public MVKCommand {
+
+public:
+	VkResult setContent(MVKCommandBuffer* cmdBuff,
+						VkBool32 depthBoundsTestEnable);
+
+    void encode(MVKCommandEncoder* cmdEncoder) override;
+
+protected:
+	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
+
+    VkBool32 _depthBoundsTestEnable;
+};
+
+
+#pragma mark -
+#pragma mark MVKCmdSetStencilTestEnable
+
+/** Vulkan command to enable or disable stencil testing. */
+class MVKCmdSetStencilTestEnable : public MVKCommand {
+
+public:
+	VkResult setContent(MVKCommandBuffer* cmdBuff,
+						VkBool32 stencilTestEnable);
+
+    void encode(MVKCommandEncoder* cmdEncoder) override;
+
+protected:
+	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
+
+    VkBool32 _stencilTestEnable;
+};
+
+
+#pragma mark -
+#pragma mark MVKCmdSetStencilOp
+
+/** Vulkan command to set the stencil operations. */
+class MVKCmdSetStencilOp : public MVKCommand {
+
+public:
+	VkResult setContent(MVKCommandBuffer* cmdBuff,
+						VkStencilFaceFlags faceMask,
+						VkStencilOp failOp,
+						VkStencilOp passOp,
+						VkStencilOp depthFailOp,
+						VkCompareOp compareOp);
+
+    void encode(MVKCommandEncoder* cmdEncoder) override;
+
+protected:
+	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
+
+    VkStencilFaceFlags _faceMask;
+    VkStencilOp _failOp;
+    VkStencilOp _passOp;
+    VkStencilOp _depthFailOp;
+    VkCompareOp _compareOp;
+};
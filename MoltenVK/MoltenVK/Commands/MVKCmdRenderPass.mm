@@ -38,6 +38,7 @@ VkResult MVKCmdBeginRenderPass<N>::setContent(MVKCommandBuffer* cmdBuff,
 	_renderArea = pRenderPassBegin->renderArea;
     _loadOverride = false;
     _storeOverride = false;
+	_inferredLoadStores.reset();
 
 	// Add clear values
 	uint32_t cvCnt = pRenderPassBegin->clearValueCount;
@@ -47,7 +48,7 @@ VkResult MVKCmdBeginRenderPass<N>::setContent(MVKCommandBuffer* cmdBuff,
 		_clearValues.push_back(pRenderPassBegin->pClearValues[i]);
 	}
 
-	cmdBuff->recordBeginRenderPass(this);
+	cmdBuff->recordBeginRenderPass(this, _renderPass);
 
 	return VK_SUCCESS;
 }
@@ -55,7 +56,13 @@ VkResult MVKCmdBeginRenderPass<N>::setContent(MVKCommandBuffer* cmdBuff,
 template <size_t N>
 void MVKCmdBeginRenderPass<N>::encode(MVKCommandEncoder* cmdEncoder) {
 //	MVKLogDebug("Encoding vkCmdBeginRenderPass(). Elapsed time: %.6f ms.", mvkGetElapsedMilliseconds());
-	cmdEncoder->beginRenderpass(_contents, _renderPass, _framebuffer, _renderArea, &_clearValues, _loadOverride, _storeOverride);
+	cmdEncoder->beginRenderpass(_contents, _renderPass, _framebuffer, _renderArea, &_clearValues, _loadOverride, _storeOverride, &_inferredLoadStores);
+}
+
+template <size_t N>
+bool MVKCmdBeginRenderPass<N>::inferLoadStoreActions(MVKLoadStoreActionInference& inference) {
+	inference.beginRenderPass(_renderPass, _framebuffer, _renderArea, _inferredLoadStores);
+	return true;
 }
 
 template class MVKCmdBeginRenderPass<1>;
@@ -69,12 +76,16 @@ template class MVKCmdBeginRenderPass<9>;
 VkResult MVKCmdNextSubpass::setContent(MVKCommandBuffer* cmdBuff,
 									   VkSubpassContents contents) {
 	_contents = contents;
+	_loadOverride = false;
+	_storeOverride = false;
+
+	cmdBuff->recordNextSubpass(this);
 
 	return VK_SUCCESS;
 }
 
 void MVKCmdNextSubpass::encode(MVKCommandEncoder* cmdEncoder) {
-	cmdEncoder->beginNextSubpass(_contents);
+	cmdEncoder->beginNextSubpass(_contents, _storeOverride);
 }
 
 
@@ -91,6 +102,11 @@ void MVKCmdEndRenderPass::encode(MVKCommandEncoder* cmdEncoder) {
 	cmdEncoder->endRenderpass();
 }
 
+bool MVKCmdEndRenderPass::inferLoadStoreActions(MVKLoadStoreActionInference& inference) {
+	inference.endRenderPass();
+	return true;
+}
+
 
 #pragma mark -
 #pragma mark MVKCmdExecuteCommands
@@ -299,3 +315,149 @@ void MVKCmdSetStencilReference::encode(MVKCommandEncoder* cmdEncoder) {
     cmdEncoder->_stencilReferenceValueState.setReferenceValues(_faceMask, _stencilReference);
 }
 
+
+
+#pragma mark -
+#pragma mark MVKCmdSetCullMode
+
+VkResult MVKCmdSetCullMode::setContent(MVKCommandBuffer* cmdBuff,
+									   VkCullModeFlags cullMode) {
+    _cullMode = cullMode;
+
+	return VK_SUCCESS;
+}
+
+void MVKCmdSetCullMode::encode(MVKCommandEncoder* cmdEncoder) {
+    cmdEncoder->_rasterizingState.setCullMode(mvkMTLCullModeFromVkCullModeFlags(_cullMode), true);
+}
+
+
+#pragma mark -
+#pragma mark MVKCmdSetFrontFace
+
+VkResult MVKCmdSetFrontFace::setContent(MVKCommandBuffer* cmdBuff,
+										VkFrontFace frontFace) {
+    _frontFace = frontFace;
+
+	return VK_SUCCESS;
+}
+
+void MVKCmdSetFrontFace::encode(MVKCommandEncoder* cmdEncoder) {
+    cmdEncoder->_rasterizingState.setFrontFacingWinding(mvkMTLWindingFromVkFrontFace(_frontFace), true);
+}
+
+
+#pragma mark -
+#pragma mark MVKCmdSetPrimitiveTopology
+
+VkResult MVKCmdSetPrimitiveTopology::setContent(MVKCommandBuffer* cmdBuff,
+												VkPrimitiveTopology primitiveTopology) {
+    _primitiveTopology = primitiveTopology;
+
+	return VK_SUCCESS;
+}
+
+void MVKCmdSetPrimitiveTopology::encode(MVKCommandEncoder* cmdEncoder) {
+    cmdEncoder->_rasterizingState.setPrimitiveType(mvkMTLPrimitiveTypeFromVkPrimitiveTopology(_primitiveTopology), true);
+}
+
+
+#pragma mark -
+#pragma mark MVKCmdSetDepthTestEnable
+
+VkResult MVKCmdSetDepthTestEnable::setContent(MVKCommandBuffer* cmdBuff,
+											  VkBool32 depthTestEnable) {
+    _depthTestEnable = depthTestEnable;
+
+	return VK_SUCCESS;
+}
+
+void MVKCmdSetDepthTestEnable::encode(MVKCommandEncoder* cmdEncoder) {
+    cmdEncoder->_depthStencilState.setDepthTestEnable(_depthTestEnable);
+}
+
+
+#pragma mark -
+#pragma mark MVKCmdSetDepthWriteEnable
+
+VkResult MVKCmdSetDepthWriteEnable::setContent(MVKCommandBuffer* cmdBuff,
+											   VkBool32 depthWriteEnable) {
+    _depthWriteEnable = depthWriteEnable;
+
+	return VK_SUCCESS;
+}
+
+void MVKCmdSetDepthWriteEnable::encode(MVKCommandEncoder* cmdEncoder) {
+    cmdEncoder->_depthStencilState.setDepthWriteEnable(_depthWriteEnable);
+}
+
+
+#pragma mark -
+#pragma mark MVKCmdSetDepthCompareOp
+
+VkResult MVKCmdSetDepthCompareOp::setContent(MVKCommandBuffer* cmdBuff,
+											 VkCompareOp depthCompareOp) {
+    _depthCompareOp = depthCompareOp;
+
+	return VK_SUCCESS;
+}
+
+void MVKCmdSetDepthCompareOp::encode(MVKCommandEncoder* cmdEncoder) {
+    cmdEncoder->_depthStencilState.setDepthCompareOp(_depthCompareOp);
+}
+
+
+#pragma mark -
+#pragma mark MVKCmdSetDepthBoundsTestEnable
+
+VkResult MVKCmdSetDepthBoundsTestEnable::setContent(MVKCommandBuffer* cmdBuff,
+													VkBool32 depthBoundsTestEnable) {
+    _depthBoundsTestEnable = depthBoundsTestEnable;
+
+    // Validate
+    if (_depthBoundsTestEnable && !cmdBuff->getDevice()->_enabledFeatures.depthBounds) {
+        return reportError(VK_ERROR_FEATURE_NOT_PRESENT, "vkCmdSetDepthBoundsTestEnableEXT(): The current device does not support depth bounds testing.");
+    }
+
+	return VK_SUCCESS;
+}
+
+void MVKCmdSetDepthBoundsTestEnable::encode(MVKCommandEncoder* cmdEncoder) {}
+
+
+#pragma mark -
+#pragma mark MVKCmdSetStencilTestEnable
+
+VkResult MVKCmdSetStencilTestEnable::setContent(MVKCommandBuffer* cmdBuff,
+												VkBool32 stencilTestEnable) {
+    _stencilTestEnable = stencilTestEnable;
+
+	return VK_SUCCESS;
+}
+
+void MVKCmdSetStencilTestEnable::encode(MVKCommandEncoder* cmdEncoder) {
+    cmdEncoder->_depthStencilState.setStencilTestEnable(_stencilTestEnable);
+}
+
+
+#pragma mark -
+#pragma mark MVKCmdSetStencilOp
+
+VkResult MVKCmdSetStencilOp::setContent(MVKCommandBuffer* cmdBuff,
+										VkStencilFaceFlags faceMask,
+										VkStencilOp failOp,
+										VkStencilOp passOp,
+										VkStencilOp depthFailOp,
+										VkCompareOp compareOp) {
+    _faceMask = faceMask;
+    _failOp = failOp;
+    _passOp = passOp;
+    _depthFailOp = depthFailOp;
+    _compareOp = compareOp;
+
+	return VK_SUCCESS;
+}
+
+void MVKCmdSetStencilOp::encode(MVKCommandEncoder* cmdEncoder) {
+    cmdEncoder->_depthStencilState.setStencilOp(_faceMask, _failOp, _passOp, _depthFailOp, _compareOp);
+}
@@ -53,6 +53,8 @@ public:
 
 	void encode(MVKCommandEncoder* cmdEncoder, MVKCommandUse commandUse);
 
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryTransfer; }
+
 protected:
 	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
 
@@ -97,12 +99,17 @@ public:
 						const VkImageBlit* pRegions,
 						VkFilter filter);
 
-	void encode(MVKCommandEncoder* cmdEncoder) override { encode(cmdEncoder, kMVKCommandUseBlitImage); }
+	void encode(MVKCommandEncoder* cmdEncoder) override;
 
 	void encode(MVKCommandEncoder* cmdEncoder, MVKCommandUse commandUse);
 
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryTransfer; }
+
+	bool getMipmapLevelBlit(MVKImage*& mipImage, VkImageSubresourceLayers& srcSubresource) override;
+
 protected:
 	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
+	bool encodeMipmapChain(MVKCommandEncoder* cmdEncoder);
 	bool canCopyFormats();
 	bool canCopy(const VkImageBlit& region);
 	void populateVertices(MVKVertexPosTex* vertices, const VkImageBlit& region);
@@ -146,6 +153,8 @@ public:
 						const VkImageResolve* pRegions);
 
     void encode(MVKCommandEncoder* cmdEncoder) override;
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryTransfer; }
+	bool encodeAsStoreActions(MVKCommandEncoder* cmdEncoder, MVKResolveStoreOverrides& resolveStores) override;
 
 protected:
 	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
@@ -180,9 +189,16 @@ public:
 						const VkBufferCopy* pRegions);
 
 	void encode(MVKCommandEncoder* cmdEncoder) override;
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryTransfer; }
+
+	bool getTransferAccesses(MVKCommandEncoder* cmdEncoder, std::vector<MVKTransferAccess>& accesses) override;
+
+	void encodeTransfer(MVKCommandEncoder* cmdEncoder, MVKTransferEncoderType encoderType) override;
 
 protected:
 	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
+	bool usesComputeCopy(const VkBufferCopy& cpyRgn, VkDeviceSize buffAlign);
+	void encodeRegions(MVKCommandEncoder* cmdEncoder, bool includeBlit, bool includeCompute);
 
 	MVKVectorInline<VkBufferCopy, N> _bufferCopyRegions;
 	MVKBuffer* _srcBuffer;
@@ -214,10 +230,19 @@ public:
 						bool toImage);
 
     void encode(MVKCommandEncoder* cmdEncoder) override;
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryTransfer; }
+
+	bool getTransferAccesses(MVKCommandEncoder* cmdEncoder, std::vector<MVKTransferAccess>& accesses) override;
+
+	void encodeTransfer(MVKCommandEncoder* cmdEncoder, MVKTransferEncoderType encoderType) override;
 
 protected:
 	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
 	bool isArrayTexture();
+	bool usesComputeDecompression(MVKCommandEncoder* cmdEncoder);
+	bool usesDepthConversion();
+	uint32_t getDepthConversion(const VkBufferImageCopy& cpyRgn);
+	bool canCopyRegion(const VkBufferImageCopy& cpyRgn);
 
 	MVKVectorInline<VkBufferImageCopy, N> _bufferImageCopyRegions;
     MVKBuffer* _buffer;
@@ -251,8 +276,12 @@ public:
 						const VkClearRect* pRects);
 
     void encode(MVKCommandEncoder* cmdEncoder) override;
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryTransfer; }
+
+	bool encodeAsLoadActions(MVKCommandEncoder* cmdEncoder, MVKClearLoadOverrides& clearLoads) override;
 
 protected:
+	bool isClearingEntireFramebuffer(MVKCommandEncoder* cmdEncoder);
     void populateVertices(simd::float4* vertices, float attWidth, float attHeight);
 	uint32_t populateVertices(simd::float4* vertices, uint32_t startVertex,
 							  VkClearRect& clearRect, float attWidth, float attHeight);
@@ -331,6 +360,7 @@ public:
 						const VkImageSubresourceRange* pRanges);
 
     void encode(MVKCommandEncoder* cmdEncoder) override;
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryTransfer; }
 
 protected:
     uint32_t populateMetalCopyRegions(const VkImageBlit* pRegion, uint32_t cpyRgnIdx);
@@ -395,6 +425,11 @@ public:
 						uint32_t data);
 
     void encode(MVKCommandEncoder* cmdEncoder) override;
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryTransfer; }
+
+	bool getTransferAccesses(MVKCommandEncoder* cmdEncoder, std::vector<MVKTransferAccess>& accesses) override;
+
+	void encodeTransfer(MVKCommandEncoder* cmdEncoder, MVKTransferEncoderType encoderType) override;
 
 protected:
 	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
@@ -420,6 +455,11 @@ public:
 						const void* pData);
 
     void encode(MVKCommandEncoder* cmdEncoder) override;
+	MVKCommandCategory getCategory() override { return kMVKCommandCategoryTransfer; }
+
+	bool getTransferAccesses(MVKCommandEncoder* cmdEncoder, std::vector<MVKTransferAccess>& accesses) override;
+
+	void encodeTransfer(MVKCommandEncoder* cmdEncoder, MVKTransferEncoderType encoderType) override;
 
 protected:
 	MVKCommandTypePool<MVKCommand>* getTypePool(MVKCommandPool* cmdPool) override;
@@ -88,8 +88,9 @@ void MVKCmdCopyImage<N>::encode(MVKCommandEncoder* cmdEncoder, MVKCommandUse com
 	MTLPixelFormat dstMTLPixFmt = _dstImage->getMTLPixelFormat();
 	bool isDstCompressed = _dstImage->getIsCompressed();
 
-	// If source and destination have different formats and at least one is compressed, use a temporary intermediary buffer
-	bool useTempBuffer = (srcMTLPixFmt != dstMTLPixFmt) && (isSrcCompressed || isDstCompressed);
+	// If source and destination have different formats, and at least one is compressed, or the source
+	// texture does not support a view in the destination format, use a temporary intermediary buffer
+	bool useTempBuffer = (srcMTLPixFmt != dstMTLPixFmt) && (isSrcCompressed || isDstCompressed || !_srcImage->hasPixelFormatViews());
 	if (useTempBuffer) {
 		MVKPixelFormats* pixFmts = cmdEncoder->getPixelFormats();
 		uint32_t copyCnt = (uint32_t)_vkImageCopies.size();
@@ -134,7 +135,7 @@ void MVKCmdCopyImage<N>::encode(MVKCommandEncoder* cmdEncoder, MVKCommandUse com
 		MVKBufferDescriptorData tempBuffData;
 		tempBuffData.size = tmpBuffSize;
 		tempBuffData.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
-		VkBuffer tempBuff = (VkBuffer)cmdEncoder->getCommandEncodingPool()->getTransferMVKBuffer(tempBuffData);
+		VkBuffer tempBuff = (VkBuffer)cmdEncoder->getCommandEncodingPool()->getTransferMVKBuffer(tempBuffData, cmdEncoder->_mtlCmdBuffer);
 
 		MVKCmdBufferImageCopy<N> cpyCmd;
 
@@ -306,6 +307,105 @@ void MVKCmdBlitImage<N>::populateVertices(MVKVertexPosTex* vertices, const VkIma
     pVtx->texCoord.y = (1.0 - srcTR.y);
 }
 
+template <size_t N>
+void MVKCmdBlitImage<N>::encode(MVKCommandEncoder* cmdEncoder) {
+	if ( !encodeMipmapChain(cmdEncoder) ) { encode(cmdEncoder, kMVKCommandUseBlitImage); }
+}
+
+template <size_t N>
+bool MVKCmdBlitImage<N>::getMipmapLevelBlit(MVKImage*& mipImage, VkImageSubresourceLayers& srcSubresource) {
+	if (_srcImage != _dstImage || _filter != VK_FILTER_LINEAR || _vkImageBlits.size() != 1) { return false; }
+	if (_srcImage->getSampleCount() != VK_SAMPLE_COUNT_1_BIT) { return false; }
+
+	const VkImageBlit& vkIB = _vkImageBlits[0];
+	const VkImageSubresourceLayers& srcSR = vkIB.srcSubresource;
+	const VkImageSubresourceLayers& dstSR = vkIB.dstSubresource;
+	if (srcSR.aspectMask != VK_IMAGE_ASPECT_COLOR_BIT ||
+		dstSR.aspectMask != VK_IMAGE_ASPECT_COLOR_BIT ||
+		dstSR.mipLevel != srcSR.mipLevel + 1 ||
+		dstSR.baseArrayLayer != srcSR.baseArrayLayer ||
+		dstSR.layerCount != srcSR.layerCount) { return false; }
+
+	// The region must cover both entire mip levels, without inverting them.
+	VkExtent3D srcExtent = _srcImage->getExtent3D(srcSR.mipLevel);
+	VkExtent3D dstExtent = _dstImage->getExtent3D(dstSR.mipLevel);
+	if ( !(mvkVkOffset3DsAreEqual(vkIB.srcOffsets[0], {0, 0, 0}) &&
+		   mvkVkOffset3DsAreEqual(vkIB.srcOffsets[1], {int32_t(srcExtent.width), int32_t(srcExtent.height), 1}) &&
+		   mvkVkOffset3DsAreEqual(vkIB.dstOffsets[0], {0, 0, 0}) &&
+		   mvkVkOffset3DsAreEqual(vkIB.dstOffsets[1], {int32_t(dstExtent.width), int32_t(dstExtent.height), 1})) ) { return false; }
+
+	mipImage = _srcImage;
+	srcSubresource = srcSR;
+	return true;
+}
+
+// Apps commonly generate a mipmap chain using a series of BLITs, each downsampling one mip level
+// of an image to the next, usually separated by pipeline barriers. If this BLIT begins such a chain,
+// instead of rendering each level of each layer in a separate Metal render pass, Metal generates all
+// of the mip levels of the chain, using a single BLIT command, on a texture view of those levels.
+// The pipeline barriers within the chain are then encoded, and the rest of the chain is skipped.
+template <size_t N>
+bool MVKCmdBlitImage<N>::encodeMipmapChain(MVKCommandEncoder* cmdEncoder) {
+	MVKImage* mipImage;
+	VkImageSubresourceLayers baseSR;
+	if ( !getMipmapLevelBlit(mipImage, baseSR) ) { return false; }
+
+	// Metal can only generate mipmaps for color-renderable and filterable pixel formats.
+	MTLPixelFormat mtlPixFmt = mipImage->getMTLPixelFormat();
+	MTLTextureType mtlTexType = mipImage->getMTLTextureType();
+	if (mtlTexType == MTLTextureType3D) { return false; }
+	if ( !mvkAreAllFlagsEnabled(cmdEncoder->getPixelFormats()->getCapabilities(mtlPixFmt),
+								(kMVKMTLFmtCapsColorAtt | kMVKMTLFmtCapsFilter)) ) { return false; }
+
+	// Find the last BLIT of the chain. Each BLIT must downsample the level written by the BLIT before it.
+	uint32_t levelCnt = 2;
+	MVKCommand* lastBlitCmd = this;
+	for (MVKCommand* cmd = cmdEncoder->getNextCommand(); cmd; cmd = cmd->_next) {
+		if (cmd->isPipelineBarrier()) { continue; }
+
+		MVKImage* cmdImage;
+		VkImageSubresourceLayers cmdSR;
+		if ( !(cmd->getMipmapLevelBlit(cmdImage, cmdSR) &&
+			   cmdImage == mipImage &&
+			   cmdSR.mipLevel == baseSR.mipLevel + levelCnt - 1 &&
+			   cmdSR.baseArrayLayer == baseSR.baseArrayLayer &&
+			   cmdSR.layerCount == baseSR.layerCount) ) { break; }
+
+		levelCnt++;
+		lastBlitCmd = cmd;
+	}
+	if (lastBlitCmd == this) { return false; }		// Not a chain
+
+	id<MTLTexture> mtlTex = mipImage->getMTLTexture();
+	if ( !mtlTex ) { return false; }
+
+	// Unless the chain covers the entire texture, generate mipmaps on a view of only the levels and layers of the chain.
+	if ( !(baseSR.mipLevel == 0 && levelCnt == mipImage->getMipLevelCount() &&
+		   baseSR.baseArrayLayer == 0 && baseSR.layerCount == mipImage->getLayerCount()) ) {
+		bool isCube = (mtlTexType == MTLTextureTypeCube || mtlTexType == MTLTextureTypeCubeArray);
+		id<MTLTexture> mtlTexView = [mtlTex newTextureViewWithPixelFormat: mtlPixFmt
+															  textureType: (isCube ? MTLTextureType2DArray : mtlTexType)
+																   levels: NSMakeRange(baseSR.mipLevel, levelCnt)
+																   slices: NSMakeRange(baseSR.baseArrayLayer, baseSR.layerCount)];	// retained
+
+		// The MTLCommandBuffer may not retain its resources, so retain the view until the MTLCommandBuffer completes.
+		[cmdEncoder->_mtlCmdBuffer addCompletedHandler: ^(id<MTLCommandBuffer> mcb) {
+			[mtlTexView release];
+		}];
+		mtlTex = mtlTexView;
+	}
+
+	[cmdEncoder->getMTLBlitEncoder(kMVKCommandUseBlitImage) generateMipmapsForTexture: mtlTex];
+
+	MVKCommand* nextCmd = lastBlitCmd->_next;
+	for (MVKCommand* cmd = cmdEncoder->getNextCommand(); cmd != nextCmd; cmd = cmd->_next) {
+		if (cmd->isPipelineBarrier()) { cmd->encode(cmdEncoder); }
+	}
+	cmdEncoder->setNextCommand(nextCmd);
+
+	return true;
+}
+
 template <size_t N>
 void MVKCmdBlitImage<N>::encode(MVKCommandEncoder* cmdEncoder, MVKCommandUse commandUse) {
 
@@ -384,6 +484,7 @@ void MVKCmdBlitImage<N>::encode(MVKCommandEncoder* cmdEncoder, MVKCommandUse com
 				mtlColorAttDesc.slice = mvkIBR.region.dstSubresource.baseArrayLayer + layIdx;
 				id<MTLRenderCommandEncoder> mtlRendEnc = [cmdEncoder->_mtlCmdBuffer renderCommandEncoderWithDescriptor: mtlRPD];
 				setLabelIfNotNil(mtlRendEnc, mvkMTLRenderCommandEncoderLabel(commandUse));
+				cmdEncoder->beginMTLRenderEncoderHazardTracking(mtlRendEnc);
 
 				[mtlRendEnc pushDebugGroup: @"vkCmdBlitImage"];
 				[mtlRendEnc setRenderPipelineState: mtlRPS];
@@ -400,6 +501,7 @@ void MVKCmdBlitImage<N>::encode(MVKCommandEncoder* cmdEncoder, MVKCommandUse com
 
 				[mtlRendEnc drawPrimitives: MTLPrimitiveTypeTriangleStrip vertexStart: 0 vertexCount: kMVKBlitVertexCount];
 				[mtlRendEnc popDebugGroup];
+				cmdEncoder->endMTLRenderEncoderHazardTracking(mtlRendEnc);
 				[mtlRendEnc endEncoding];
 			}
 		}
@@ -514,7 +616,7 @@ void MVKCmdResolveImage<N>::encode(MVKCommandEncoder* cmdEncoder) {
 		MVKImageDescriptorData xferImageData;
 		_dstImage->getTransferDescriptorData(xferImageData);
 		xferImageData.samples = _srcImage->getSampleCount();
-		MVKImage* xfrImage = cmdEncoder->getCommandEncodingPool()->getTransferMVKImage(xferImageData);
+		MVKImage* xfrImage = cmdEncoder->getCommandEncodingPool()->getTransferMVKImage(xferImageData, cmdEncoder->_mtlCmdBuffer);
 
 		// Expand the current content of the destination image to the temporary transfer image.
 		MVKCmdBlitImage<N> expCmd;
@@ -553,13 +655,65 @@ void MVKCmdResolveImage<N>::encode(MVKCommandEncoder* cmdEncoder) {
 		mtlColorAttDesc.resolveSlice = rslvSlice.slice;
 		id<MTLRenderCommandEncoder> mtlRendEnc = [cmdEncoder->_mtlCmdBuffer renderCommandEncoderWithDescriptor: mtlRPD];
 		setLabelIfNotNil(mtlRendEnc, mvkMTLRenderCommandEncoderLabel(kMVKCommandUseResolveImage));
+		cmdEncoder->beginMTLRenderEncoderHazardTracking(mtlRendEnc);
 
 		[mtlRendEnc pushDebugGroup: @"vkCmdResolveImage"];
 		[mtlRendEnc popDebugGroup];
+		cmdEncoder->endMTLRenderEncoderHazardTracking(mtlRendEnc);
 		[mtlRendEnc endEncoding];
 	}
 }
 
+// If this resolve immediately follows the end of the render pass, and resolves the entire content
+// of a layer of a multisample color attachment of the last subpass, to an image of the same format,
+// the resolve can be performed by the store action of that attachment, within the Metal render pass,
+// avoiding a separate Metal render pass that loads the multisample content again to resolve it.
+template <size_t N>
+bool MVKCmdResolveImage<N>::encodeAsStoreActions(MVKCommandEncoder* cmdEncoder, MVKResolveStoreOverrides& resolveStores) {
+
+	if ( !cmdEncoder->getDevice()->_pMetalFeatures->combinedStoreResolveAction ) { return false; }
+	if ( !cmdEncoder->isRenderingEntireAttachment() ) { return false; }
+
+	MVKFramebuffer* framebuffer = cmdEncoder->_framebuffer;
+	if (framebuffer->getLayerCount() > 1) { return false; }
+
+	if (_vkImageResolves.size() != 1) { return false; }
+	VkImageResolve& vkIR = _vkImageResolves[0];
+	if (vkIR.srcSubresource.aspectMask != VK_IMAGE_ASPECT_COLOR_BIT ||
+		vkIR.srcSubresource.layerCount != 1 || vkIR.dstSubresource.layerCount != 1) { return false; }
+
+	// The region must cover the entire content of both the source and destination mip levels.
+	VkExtent3D srcImgExt = _srcImage->getExtent3D(vkIR.srcSubresource.mipLevel);
+	VkExtent3D dstImgExt = _dstImage->getExtent3D(vkIR.dstSubresource.mipLevel);
+	if ( !(mvkVkOffset3DsAreEqual(vkIR.srcOffset, {0, 0, 0}) &&
+		   mvkVkOffset3DsAreEqual(vkIR.dstOffset, {0, 0, 0}) &&
+		   mvkVkExtent3DsAreEqual(vkIR.extent, srcImgExt) &&
+		   mvkVkExtent3DsAreEqual(vkIR.extent, dstImgExt) &&
+		   vkIR.extent.depth == 1) ) { return false; }
+
+	// A Metal resolve texture must have the same pixel format as the texture it resolves.
+	MTLPixelFormat mtlPixFmt = _srcImage->getMTLPixelFormat();
+	if (_dstImage->getMTLPixelFormat() != mtlPixFmt) { return false; }
+
+	uint32_t caIdx = cmdEncoder->getSubpass()->getUnresolvedColorAttachmentIndex(framebuffer, _srcImage,
+																				 vkIR.srcSubresource.mipLevel,
+																				 vkIR.srcSubresource.baseArrayLayer,
+																				 mtlPixFmt);
+	if (caIdx >= kMVKCachedColorAttachmentCount || resolveStores.isColorAttachmentResolved(caIdx)) { return false; }
+
+	// The render pass must not also render to the destination image.
+	uint32_t attCnt = framebuffer->getAttachmentCount();
+	for (uint32_t attIdx = 0; attIdx < attCnt; attIdx++) {
+		if (framebuffer->getAttachment(attIdx)->getImage() == _dstImage) { return false; }
+	}
+
+	resolveStores.images[caIdx] = _dstImage;
+	resolveStores.mipLevels[caIdx] = vkIR.dstSubresource.mipLevel;
+	resolveStores.arrayLayers[caIdx] = vkIR.dstSubresource.baseArrayLayer;
+	mvkEnableFlags(resolveStores.colorAttachmentMask, 1U << caIdx);
+	return true;
+}
+
 template class MVKCmdResolveImage<1>;
 template class MVKCmdResolveImage<4>;
 
@@ -595,6 +749,45 @@ VkResult MVKCmdCopyBuffer<N>::setContent(MVKCommandBuffer* cmdBuff,
 
 template <size_t N>
 void MVKCmdCopyBuffer<N>::encode(MVKCommandEncoder* cmdEncoder) {
+	encodeRegions(cmdEncoder, true, true);
+}
+
+template <size_t N>
+bool MVKCmdCopyBuffer<N>::getTransferAccesses(MVKCommandEncoder* cmdEncoder, std::vector<MVKTransferAccess>& accesses) {
+	id<MTLBuffer> srcMTLBuff = _srcBuffer->getMTLBuffer();
+	NSUInteger srcMTLBuffOffset = _srcBuffer->getMTLBufferOffset();
+
+	id<MTLBuffer> dstMTLBuff = _dstBuffer->getMTLBuffer();
+	NSUInteger dstMTLBuffOffset = _dstBuffer->getMTLBufferOffset();
+
+	VkDeviceSize buffAlign = cmdEncoder->getDevice()->_pMetalFeatures->mtlCopyBufferAlignment;
+
+	for (auto& cpyRgn : _bufferCopyRegions) {
+		MVKTransferEncoderType encType = usesComputeCopy(cpyRgn, buffAlign) ? kMVKTransferEncoderTypeCompute : kMVKTransferEncoderTypeBlit;
+		accesses.push_back({ srcMTLBuff, (NSUInteger)(srcMTLBuffOffset + cpyRgn.srcOffset), (NSUInteger)cpyRgn.size, encType, false });
+		accesses.push_back({ dstMTLBuff, (NSUInteger)(dstMTLBuffOffset + cpyRgn.dstOffset), (NSUInteger)cpyRgn.size, encType, true });
+	}
+	return true;
+}
+
+template <size_t N>
+void MVKCmdCopyBuffer<N>::encodeTransfer(MVKCommandEncoder* cmdEncoder, MVKTransferEncoderType encoderType) {
+	encodeRegions(cmdEncoder, encoderType == kMVKTransferEncoderTypeBlit, encoderType == kMVKTransferEncoderTypeCompute);
+}
+
+// Metal BLIT copies require aligned offsets and sizes on some devices. Other copies use a compute shader.
+template <size_t N>
+bool MVKCmdCopyBuffer<N>::usesComputeCopy(const VkBufferCopy& cpyRgn, VkDeviceSize buffAlign) {
+	return buffAlign > 1 && (cpyRgn.srcOffset % buffAlign != 0 ||
+							 cpyRgn.dstOffset % buffAlign != 0 ||
+							 cpyRgn.size      % buffAlign != 0);
+}
+
+// Encodes the copy regions that use a BLIT encoder, a compute encoder, or both.
+template <size_t N>
+void MVKCmdCopyBuffer<N>::encodeRegions(MVKCommandEncoder* cmdEncoder, bool includeBlit, bool includeCompute) {
+	_dstBuffer->markContentChanged();
+
 	id<MTLBuffer> srcMTLBuff = _srcBuffer->getMTLBuffer();
 	NSUInteger srcMTLBuffOffset = _srcBuffer->getMTLBufferOffset();
 
@@ -604,9 +797,9 @@ void MVKCmdCopyBuffer<N>::encode(MVKCommandEncoder* cmdEncoder) {
 	VkDeviceSize buffAlign = cmdEncoder->getDevice()->_pMetalFeatures->mtlCopyBufferAlignment;
 
 	for (auto& cpyRgn : _bufferCopyRegions) {
-		const bool useComputeCopy = buffAlign > 1 && (cpyRgn.srcOffset % buffAlign != 0 ||
-													  cpyRgn.dstOffset % buffAlign != 0 ||
-													  cpyRgn.size      % buffAlign != 0);
+		const bool useComputeCopy = usesComputeCopy(cpyRgn, buffAlign);
+		if (useComputeCopy ? !includeCompute : !includeBlit) { continue; }
+
 		if (useComputeCopy) {
 			MVKAssert(mvkFits<uint32_t>(cpyRgn.srcOffset) && mvkFits<uint32_t>(cpyRgn.dstOffset) && mvkFits<uint32_t>(cpyRgn.size),
 					  "Byte-aligned buffer copy region offsets and size must each fit into a 32-bit unsigned integer.");
@@ -625,12 +818,10 @@ void MVKCmdCopyBuffer<N>::encode(MVKCommandEncoder* cmdEncoder) {
 			[mtlComputeEnc dispatchThreadgroups: MTLSizeMake(1, 1, 1) threadsPerThreadgroup: MTLSizeMake(1, 1, 1)];
 			[mtlComputeEnc popDebugGroup];
 		} else {
-			id<MTLBlitCommandEncoder> mtlBlitEnc = cmdEncoder->getMTLBlitEncoder(kMVKCommandUseCopyBuffer);
-			[mtlBlitEnc copyFromBuffer: srcMTLBuff
-						  sourceOffset: (srcMTLBuffOffset + cpyRgn.srcOffset)
-							  toBuffer: dstMTLBuff
-					 destinationOffset: (dstMTLBuffOffset + cpyRgn.dstOffset)
-								  size: cpyRgn.size];
+			cmdEncoder->encodeBlitCopyBuffer(kMVKCommandUseCopyBuffer,
+											 srcMTLBuff, (srcMTLBuffOffset + cpyRgn.srcOffset),
+											 dstMTLBuff, (dstMTLBuffOffset + cpyRgn.dstOffset),
+											 cpyRgn.size);
 		}
 	}
 }
@@ -657,6 +848,51 @@ typedef struct {
     VkExtent3D extent;
 } MVKCmdCopyBufferToImageInfo;
 
+// Identifies the conversion of depth content between a buffer and the substitute Metal
+// depth format of an image, when the depth component sizes of the formats differ.
+// Matches shader values.
+typedef enum : uint32_t {
+	kMVKDepthConversionNone = 0,
+	kMVKDepthConversionD16UnormToFloat = 1,
+	kMVKDepthConversionFloatToD16Unorm = 2,
+	kMVKDepthConversionD24UnormToFloat = 3,
+	kMVKDepthConversionFloatToD24Unorm = 4,
+} MVKDepthConversion;
+
+// Matches shader struct.
+typedef struct {
+	uint32_t srcRowStride;
+	uint32_t dstRowStride;
+	uint32_t width;
+	uint32_t height;
+	uint32_t conversion;
+} MVKCmdConvertDepthInfo;
+
+// Converts the depth content of each layer of a copy region from one buffer to another.
+static void mvkEncodeDepthConversion(MVKCommandEncoder* cmdEncoder, MVKCommandUse cmdUse,
+									 MVKCmdConvertDepthInfo& info, uint32_t layerCount,
+									 id<MTLBuffer> srcMTLBuff, NSUInteger srcOffset, NSUInteger srcBytesPerImg,
+									 id<MTLBuffer> dstMTLBuff, NSUInteger dstOffset, NSUInteger dstBytesPerImg) {
+
+	id<MTLComputeCommandEncoder> mtlComputeEnc = cmdEncoder->getMTLComputeEncoder(cmdUse);
+	id<MTLComputePipelineState> mtlComputeState = cmdEncoder->getCommandEncodingPool()->getCmdConvertDepthBufferMTLComputePipelineState();
+	[mtlComputeEnc pushDebugGroup: @"vkCmdCopyBufferImageConvertDepth"];
+	[mtlComputeEnc setComputePipelineState: mtlComputeState];
+	cmdEncoder->setComputeBytes(mtlComputeEnc, &info, sizeof(info), 2);
+
+	NSUInteger tgWidth = mtlComputeState.threadExecutionWidth;
+	MTLSize mtlTgrpSize = MTLSizeMake(tgWidth, std::max<NSUInteger>(mtlComputeState.maxTotalThreadsPerThreadgroup / tgWidth, 1), 1);
+	MTLSize mtlGridSize = MTLSizeMake(mvkCeilingDivide<NSUInteger>(info.width, mtlTgrpSize.width),
+									  mvkCeilingDivide<NSUInteger>(info.height, mtlTgrpSize.height),
+									  1);
+	for (uint32_t lyrIdx = 0; lyrIdx < layerCount; lyrIdx++) {
+		[mtlComputeEnc setBuffer: srcMTLBuff offset: (srcOffset + (srcBytesPerImg * lyrIdx)) atIndex: 0];
+		[mtlComputeEnc setBuffer: dstMTLBuff offset: (dstOffset + (dstBytesPerImg * lyrIdx)) atIndex: 1];
+		[mtlComputeEnc dispatchThreadgroups: mtlGridSize threadsPerThreadgroup: mtlTgrpSize];
+	}
+	[mtlComputeEnc popDebugGroup];
+}
+
 template <size_t N>
 VkResult MVKCmdBufferImageCopy<N>::setContent(MVKCommandBuffer* cmdBuff,
 											  VkBuffer buffer,
@@ -678,14 +914,87 @@ VkResult MVKCmdBufferImageCopy<N>::setContent(MVKCommandBuffer* cmdBuff,
     }
 
     // Validate
-    if ( !_image->hasExpectedTexelSize() ) {
-        const char* cmdName = _toImage ? "vkCmdCopyBufferToImage" : "vkCmdCopyImageToBuffer";
-        return reportError(VK_ERROR_FORMAT_NOT_SUPPORTED, "%s(): The image is using Metal format %s as a substitute for Vulkan format %s. Since the pixel size is different, content for the image cannot be copied to or from a buffer.", cmdName, cmdBuff->getPixelFormats()->getName(_image->getMTLPixelFormat()), cmdBuff->getPixelFormats()->getName(_image->getVkFormat()));
+    for (auto& cpyRgn : _bufferImageCopyRegions) {
+        if ( !canCopyRegion(cpyRgn) ) {
+            const char* cmdName = _toImage ? "vkCmdCopyBufferToImage" : "vkCmdCopyImageToBuffer";
+            return reportError(VK_ERROR_FORMAT_NOT_SUPPORTED, "%s(): The image is using Metal format %s as a substitute for Vulkan format %s. Since the pixel size is different, content for the image cannot be copied to or from a buffer.", cmdName, cmdBuff->getPixelFormats()->getName(_image->getMTLPixelFormat()), cmdBuff->getPixelFormats()->getName(_image->getVkFormat()));
+        }
     }
 
+	// Decompressed image content cannot be compressed back into the layout of the compressed format.
+	if ( !_toImage && _image->needsDecompression() ) {
+		return reportError(VK_ERROR_FORMAT_NOT_SUPPORTED, "vkCmdCopyImageToBuffer(): The content of an image using compressed Vulkan format %s is held decompressed, because Metal does not support that format for this image, and cannot be copied to a buffer.", cmdBuff->getPixelFormats()->getName(_image->getVkFormat()));
+	}
+
 	return VK_SUCCESS;
 }
 
+// Buffer-image copies are coalesced only when they use the BLIT encoder alone, and the
+// image does not share memory with a buffer, which would hide hazards with other transfers.
+template <size_t N>
+bool MVKCmdBufferImageCopy<N>::getTransferAccesses(MVKCommandEncoder* cmdEncoder, std::vector<MVKTransferAccess>& accesses) {
+	id<MTLBuffer> mtlBuffer = _buffer->getMTLBuffer();
+	id<MTLTexture> mtlTexture = _image->getMTLTexture();
+	if ( !mtlBuffer || !mtlTexture || mtlTexture.buffer || usesComputeDecompression(cmdEncoder) || usesDepthConversion() ) { return false; }
+
+	MVKTransferAccess buffAcc = { mtlBuffer, _buffer->getMTLBufferOffset(), (NSUInteger)_buffer->getByteCount(), kMVKTransferEncoderTypeBlit, !_toImage };
+	MVKTransferAccess texAcc = { mtlTexture, 0, NSUIntegerMax, kMVKTransferEncoderTypeBlit, _toImage };
+	accesses.push_back(_toImage ? buffAcc : texAcc);
+	accesses.push_back(_toImage ? texAcc : buffAcc);
+	return true;
+}
+
+template <size_t N>
+void MVKCmdBufferImageCopy<N>::encodeTransfer(MVKCommandEncoder* cmdEncoder, MVKTransferEncoderType encoderType) {
+	if (encoderType == kMVKTransferEncoderTypeBlit) { encode(cmdEncoder); }
+}
+
+// Returns whether copying to the image requires decompressing the content with a compute shader.
+template <size_t N>
+bool MVKCmdBufferImageCopy<N>::usesComputeDecompression(MVKCommandEncoder* cmdEncoder) {
+	return _toImage && _image->needsDecompression();
+}
+
+// Returns whether the depth content of any region must be converted with a compute shader.
+template <size_t N>
+bool MVKCmdBufferImageCopy<N>::usesDepthConversion() {
+	if (_image->hasExpectedTexelSize()) { return false; }
+	for (auto& cpyRgn : _bufferImageCopyRegions) {
+		if (getDepthConversion(cpyRgn) != kMVKDepthConversionNone) { return true; }
+	}
+	return false;
+}
+
+// If the image uses a substitute Metal float depth format for a Vulkan unorm depth format,
+// the depth aspect of the buffer content must be converted between the two formats.
+template <size_t N>
+uint32_t MVKCmdBufferImageCopy<N>::getDepthConversion(const VkBufferImageCopy& cpyRgn) {
+	if (cpyRgn.imageSubresource.aspectMask != VK_IMAGE_ASPECT_DEPTH_BIT) { return kMVKDepthConversionNone; }
+
+	MTLPixelFormat mtlPixFmt = _image->getMTLPixelFormat();
+	if ( !(mtlPixFmt == MTLPixelFormatDepth32Float || mtlPixFmt == MTLPixelFormatDepth32Float_Stencil8) ) { return kMVKDepthConversionNone; }
+
+	switch (_image->getVkFormat()) {
+		case VK_FORMAT_D16_UNORM:
+			return _toImage ? kMVKDepthConversionD16UnormToFloat : kMVKDepthConversionFloatToD16Unorm;
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_X8_D24_UNORM_PACK32:
+			return _toImage ? kMVKDepthConversionD24UnormToFloat : kMVKDepthConversionFloatToD24Unorm;
+		default:
+			return kMVKDepthConversionNone;
+	}
+}
+
+// Content can be copied to or from an image that uses a substitute Metal format of a different size
+// only if the depth content is converted, or if only the stencil content is copied, which is always
+// one byte per texel.
+template <size_t N>
+bool MVKCmdBufferImageCopy<N>::canCopyRegion(const VkBufferImageCopy& cpyRgn) {
+	return (_image->hasExpectedTexelSize() ||
+			cpyRgn.imageSubresource.aspectMask == VK_IMAGE_ASPECT_STENCIL_BIT ||
+			getDepthConversion(cpyRgn) != kMVKDepthConversionNone);
+}
+
 template <size_t N>
 void MVKCmdBufferImageCopy<N>::encode(MVKCommandEncoder* cmdEncoder) {
     id<MTLBuffer> mtlBuffer = _buffer->getMTLBuffer();
@@ -693,12 +1002,14 @@ void MVKCmdBufferImageCopy<N>::encode(MVKCommandEncoder* cmdEncoder) {
     if ( !mtlBuffer || !mtlTexture ) { return; }
 
 	NSUInteger mtlBuffOffsetBase = _buffer->getMTLBufferOffset();
+	if ( !_toImage ) { _buffer->markContentChanged(); }
     MTLPixelFormat mtlPixFmt = _image->getMTLPixelFormat();
     MVKCommandUse cmdUse = _toImage ? kMVKCommandUseCopyBufferToImage : kMVKCommandUseCopyImageToBuffer;
 	MVKPixelFormats* pixFmts = cmdEncoder->getPixelFormats();
 
     for (auto& cpyRgn : _bufferImageCopyRegions) {
 
+		id<MTLBuffer> rgnMTLBuffer = mtlBuffer;
 		uint32_t mipLevel = cpyRgn.imageSubresource.mipLevel;
         MTLOrigin mtlTxtOrigin = mvkMTLOriginFromVkOffset3D(cpyRgn.imageOffset);
 		MTLSize mtlTxtSize = mvkClampMTLSize(mvkMTLSizeFromVkExtent3D(cpyRgn.imageExtent),
@@ -712,8 +1023,16 @@ void MVKCmdBufferImageCopy<N>::encode(MVKCommandEncoder* cmdEncoder) {
         uint32_t buffImgHt = cpyRgn.bufferImageHeight;
         if (buffImgHt == 0) { buffImgHt = cpyRgn.imageExtent.height; }
 
-        NSUInteger bytesPerRow = pixFmts->getBytesPerRow(mtlPixFmt, buffImgWd);
-        NSUInteger bytesPerImg = pixFmts->getBytesPerLayer(mtlPixFmt, bytesPerRow, buffImgHt);
+        // If the buffer content is decompressed into the image, the buffer holds the compressed content.
+        NSUInteger bytesPerRow;
+        NSUInteger bytesPerImg;
+        if (usesComputeDecompression(cmdEncoder)) {
+            bytesPerRow = pixFmts->getBytesPerRow(_image->getVkFormat(), buffImgWd);
+            bytesPerImg = pixFmts->getBytesPerLayer(_image->getVkFormat(), bytesPerRow, buffImgHt);
+        } else {
+            bytesPerRow = pixFmts->getBytesPerRow(mtlPixFmt, buffImgWd);
+            bytesPerImg = pixFmts->getBytesPerLayer(mtlPixFmt, bytesPerRow, buffImgHt);
+        }
 
         // If the format combines BOTH depth and stencil, determine whether one or both
         // components are to be copied, and adjust the byte counts and copy options accordingly.
@@ -745,12 +1064,13 @@ void MVKCmdBufferImageCopy<N>::encode(MVKCommandEncoder* cmdEncoder) {
 		}
 #endif
 
-#if MVK_MACOS
-		// If we're copying to a compressed 3D image, the image data need to be decompressed.
-		// If we're copying to mip level 0, we can skip the copy and just decode
-		// directly into the image. Otherwise, we need to use an intermediate buffer.
-        if (_toImage && _image->getIsCompressed() && mtlTexture.textureType == MTLTextureType3D &&
-            !cmdEncoder->getDevice()->_pMetalFeatures->native3DCompressedTextures) {
+		// If we're copying to a compressed image that Metal can't hold natively, the image data need to be
+		// decompressed on the GPU. If we're copying to mip level 0 of a 3D image, we can skip the copy and
+		// just decode directly into the image. Otherwise, we need to use an intermediate buffer, and each
+		// layer of a 2D array image is decoded as one slice of that buffer.
+        if (usesComputeDecompression(cmdEncoder)) {
+            bool is3D = (mtlTexture.textureType == MTLTextureType3D);
+            uint32_t sliceCnt = is3D ? (uint32_t)mtlTxtSize.depth : cpyRgn.imageSubresource.layerCount;
 
             MVKCmdCopyBufferToImageInfo info;
             info.srcRowStride = bytesPerRow & 0xffffffff;
@@ -762,12 +1082,13 @@ void MVKCmdBufferImageCopy<N>::encode(MVKCommandEncoder* cmdEncoder) {
             info.format = _image->getVkFormat();
             info.offset = cpyRgn.imageOffset;
             info.extent = cpyRgn.imageExtent;
-            bool needsTempBuff = mipLevel != 0;
+            info.extent.depth = sliceCnt;
+            bool needsTempBuff = mipLevel != 0 || !is3D;
             id<MTLComputeCommandEncoder> mtlComputeEnc = cmdEncoder->getMTLComputeEncoder(cmdUse);
             id<MTLComputePipelineState> mtlComputeState = cmdEncoder->getCommandEncodingPool()->getCmdCopyBufferToImage3DDecompressMTLComputePipelineState(needsTempBuff);
             [mtlComputeEnc pushDebugGroup: @"vkCmdCopyBufferToImage"];
             [mtlComputeEnc setComputePipelineState: mtlComputeState];
-            [mtlComputeEnc setBuffer: mtlBuffer offset: mtlBuffOffset atIndex: 0];
+            [mtlComputeEnc setBuffer: rgnMTLBuffer offset: mtlBuffOffset atIndex: 0];
             MVKBuffer* tempBuff;
             if (needsTempBuff) {
                 NSUInteger bytesPerDestRow = pixFmts->getBytesPerRow(mtlTexture.pixelFormat, info.extent.width);
@@ -777,16 +1098,16 @@ void MVKCmdBufferImageCopy<N>::encode(MVKCommandEncoder* cmdEncoder) {
                 bytesPerRow = bytesPerDestRow;
                 bytesPerImg = bytesPerDestImg;
                 MVKBufferDescriptorData tempBuffData;
-                tempBuffData.size = bytesPerDestImg * mtlTxtSize.depth;
+                tempBuffData.size = bytesPerDestImg * sliceCnt;
                 tempBuffData.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
-                tempBuff = cmdEncoder->getCommandEncodingPool()->getTransferMVKBuffer(tempBuffData);
-                mtlBuffer = tempBuff->getMTLBuffer();
+                tempBuff = cmdEncoder->getCommandEncodingPool()->getTransferMVKBuffer(tempBuffData, cmdEncoder->_mtlCmdBuffer);
+                rgnMTLBuffer = tempBuff->getMTLBuffer();
                 mtlBuffOffset = tempBuff->getMTLBufferOffset();
                 info.destRowStride = bytesPerDestRow & 0xffffffff;
                 info.destRowStrideHigh = bytesPerDestRow >> 32;
                 info.destDepthStride = bytesPerDestImg & 0xffffffff;
                 info.destDepthStrideHigh = bytesPerDestImg >> 32;
-                [mtlComputeEnc setBuffer: mtlBuffer offset: mtlBuffOffset atIndex: 1];
+                [mtlComputeEnc setBuffer: rgnMTLBuffer offset: mtlBuffOffset atIndex: 1];
             } else {
                 [mtlComputeEnc setTexture: mtlTexture atIndex: 0];
             }
@@ -795,10 +1116,10 @@ void MVKCmdBufferImageCopy<N>::encode(MVKCommandEncoder* cmdEncoder) {
             // Now work out how big to make the grid, and from there, the size and number of threadgroups.
             // One thread is run per block. Each block decompresses to an m x n array of texels.
             // So the size of the grid is (ceil(width/m), ceil(height/n), depth).
-            VkExtent2D blockExtent = pixFmts->getBlockTexelSize(mtlPixFmt);
+            VkExtent2D blockExtent = pixFmts->getBlockTexelSize(_image->getVkFormat());
             MTLSize mtlGridSize = MTLSizeMake(mvkCeilingDivide<NSUInteger>(mtlTxtSize.width, blockExtent.width),
                                               mvkCeilingDivide<NSUInteger>(mtlTxtSize.height, blockExtent.height),
-                                              mtlTxtSize.depth);
+                                              sliceCnt);
             // Use four times the thread execution width as the threadgroup size.
             MTLSize mtlTgrpSize = MTLSizeMake(2, 2, mtlComputeState.threadExecutionWidth);
             // Then the number of threadgroups is (ceil(x/2), ceil(y/2), ceil(z/t)),
@@ -815,17 +1136,52 @@ void MVKCmdBufferImageCopy<N>::encode(MVKCommandEncoder* cmdEncoder) {
 
             if (!needsTempBuff) { continue; }
         }
-#endif
+
+		// If the image uses a float depth format as a substitute for a unorm depth format, the depth
+		// content is copied through a temporary buffer holding float depths, and converted on the GPU,
+		// before it is copied to the image, or after it is copied from the image.
+		uint32_t depthConv = getDepthConversion(cpyRgn);
+		MVKCmdConvertDepthInfo convInfo;
+		NSUInteger buffBytesPerRow = bytesPerRow;
+		NSUInteger buffBytesPerImg = bytesPerImg;
+		NSUInteger buffOffset = mtlBuffOffset;
+		if (depthConv != kMVKDepthConversionNone) {
+			NSUInteger buffBytesPerTexel = (_image->getVkFormat() == VK_FORMAT_D16_UNORM) ? 2 : 4;
+			buffBytesPerRow = buffBytesPerTexel * buffImgWd;
+			buffBytesPerImg = buffBytesPerRow * buffImgHt;
+
+			bytesPerRow = sizeof(float) * mtlTxtSize.width;
+			bytesPerImg = bytesPerRow * mtlTxtSize.height;
+
+			MVKBufferDescriptorData tempBuffData;
+			tempBuffData.size = bytesPerImg * cpyRgn.imageSubresource.layerCount;
+			tempBuffData.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+			MVKBuffer* tempBuff = cmdEncoder->getCommandEncodingPool()->getTransferMVKBuffer(tempBuffData, cmdEncoder->_mtlCmdBuffer);
+			rgnMTLBuffer = tempBuff->getMTLBuffer();
+			mtlBuffOffset = tempBuff->getMTLBufferOffset();
+
+			convInfo.srcRowStride = uint32_t(_toImage ? buffBytesPerRow : bytesPerRow);
+			convInfo.dstRowStride = uint32_t(_toImage ? bytesPerRow : buffBytesPerRow);
+			convInfo.width = uint32_t(mtlTxtSize.width);
+			convInfo.height = uint32_t(mtlTxtSize.height);
+			convInfo.conversion = depthConv;
+			if (_toImage) {
+				mvkEncodeDepthConversion(cmdEncoder, cmdUse, convInfo, cpyRgn.imageSubresource.layerCount,
+										 mtlBuffer, buffOffset, buffBytesPerImg,
+										 rgnMTLBuffer, mtlBuffOffset, bytesPerImg);
+			}
+		}
 
 		// Don't supply bytes per image if not an arrayed texture
+		NSUInteger bytesPerLayer = bytesPerImg;
 		if ( !isArrayTexture() ) { bytesPerImg = 0; }
 
         id<MTLBlitCommandEncoder> mtlBlitEnc = cmdEncoder->getMTLBlitEncoder(cmdUse);
 
         for (uint32_t lyrIdx = 0; lyrIdx < cpyRgn.imageSubresource.layerCount; lyrIdx++) {
             if (_toImage) {
-                [mtlBlitEnc copyFromBuffer: mtlBuffer
-                              sourceOffset: (mtlBuffOffset + (bytesPerImg * lyrIdx))
+                [mtlBlitEnc copyFromBuffer: rgnMTLBuffer
+                              sourceOffset: (mtlBuffOffset + (bytesPerLayer * lyrIdx))
                          sourceBytesPerRow: bytesPerRow
                        sourceBytesPerImage: bytesPerImg
                                 sourceSize: mtlTxtSize
@@ -840,13 +1196,19 @@ void MVKCmdBufferImageCopy<N>::encode(MVKCommandEncoder* cmdEncoder) {
                                 sourceLevel: mipLevel
                                sourceOrigin: mtlTxtOrigin
                                  sourceSize: mtlTxtSize
-                                   toBuffer: mtlBuffer
-                          destinationOffset: (mtlBuffOffset + (bytesPerImg * lyrIdx))
+                                   toBuffer: rgnMTLBuffer
+                          destinationOffset: (mtlBuffOffset + (bytesPerLayer * lyrIdx))
                      destinationBytesPerRow: bytesPerRow
                    destinationBytesPerImage: bytesPerImg
                                     options: blitOptions];
             }
         }
+
+		if (depthConv != kMVKDepthConversionNone && !_toImage) {
+			mvkEncodeDepthConversion(cmdEncoder, cmdUse, convInfo, cpyRgn.imageSubresource.layerCount,
+									 rgnMTLBuffer, mtlBuffOffset, bytesPerLayer,
+									 mtlBuffer, buffOffset, buffBytesPerImg);
+		}
     }
 }
 
@@ -1049,6 +1411,46 @@ void MVKCmdClearAttachments<N>::encode(MVKCommandEncoder* cmdEncoder) {
 	cmdEncoder->_graphicsResourcesState.beginMetalRenderPass();
 }
 
+// Returns whether any of the clear rectangles covers all layers of the entire framebuffer.
+template <size_t N>
+bool MVKCmdClearAttachments<N>::isClearingEntireFramebuffer(MVKCommandEncoder* cmdEncoder) {
+	VkExtent2D fbExtent = cmdEncoder->_framebuffer->getExtent2D();
+	uint32_t fbLayerCnt = cmdEncoder->_framebuffer->getLayerCount();
+	for (auto& rect : _clearRects) {
+		if (mvkVkOffset2DsAreEqual(rect.rect.offset, {0,0}) &&
+			mvkVkExtent2DsAreEqual(rect.rect.extent, fbExtent) &&
+			rect.baseArrayLayer == 0 && rect.layerCount == fbLayerCnt) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// This function is only called before a Metal render pass begins, and before anything has been
+// rendered in the subpass. At that point, clearing the entire framebuffer is equivalent to clearing
+// the attachments with the load actions of the Metal render pass, so fold this command into them.
+template <size_t N>
+bool MVKCmdClearAttachments<N>::encodeAsLoadActions(MVKCommandEncoder* cmdEncoder, MVKClearLoadOverrides& clearLoads) {
+	if ( !cmdEncoder->isRenderingEntireAttachment() || !isClearingEntireFramebuffer(cmdEncoder) ) { return false; }
+
+	uint32_t caCnt = cmdEncoder->getSubpass()->getColorAttachmentCount();
+	for (uint32_t caIdx = 0; caIdx < caCnt; caIdx++) {
+		if (_rpsKey.isAttachmentEnabled(caIdx)) {
+			clearLoads.colorValues[caIdx] = getClearValue(caIdx);
+			mvkEnableFlags(clearLoads.colorAttachmentMask, 1U << caIdx);
+		}
+	}
+	if (_isClearingDepth) {
+		clearLoads.isClearingDepth = true;
+		clearLoads.mtlDepthValue = _mtlDepthVal;
+	}
+	if (_isClearingStencil) {
+		clearLoads.isClearingStencil = true;
+		clearLoads.mtlStencilValue = _mtlStencilValue;
+	}
+	return true;
+}
+
 template class MVKCmdClearAttachments<1>;
 template class MVKCmdClearAttachments<4>;
 
@@ -1168,6 +1570,8 @@ void MVKCmdClearImage<N>::encode(MVKCommandEncoder* cmdEncoder) {
 
                 id<MTLRenderCommandEncoder> mtlRendEnc = [cmdEncoder->_mtlCmdBuffer renderCommandEncoderWithDescriptor: mtlRPDesc];
 				setLabelIfNotNil(mtlRendEnc, mtlRendEncName);
+				cmdEncoder->beginMTLRenderEncoderHazardTracking(mtlRendEnc);
+				cmdEncoder->endMTLRenderEncoderHazardTracking(mtlRendEnc);
                 [mtlRendEnc endEncoding];
             }
         }
@@ -1209,9 +1613,21 @@ VkResult MVKCmdFillBuffer::setContent(MVKCommandBuffer* cmdBuff,
 	return VK_SUCCESS;
 }
 
+bool MVKCmdFillBuffer::getTransferAccesses(MVKCommandEncoder* cmdEncoder, std::vector<MVKTransferAccess>& accesses) {
+	accesses.push_back({ _dstBuffer->getMTLBuffer(), (NSUInteger)(_dstBuffer->getMTLBufferOffset() + _dstOffset),
+						 _wordCount * sizeof(_dataValue), kMVKTransferEncoderTypeCompute, true });
+	return true;
+}
+
+void MVKCmdFillBuffer::encodeTransfer(MVKCommandEncoder* cmdEncoder, MVKTransferEncoderType encoderType) {
+	if (encoderType == kMVKTransferEncoderTypeCompute) { encode(cmdEncoder); }
+}
+
 void MVKCmdFillBuffer::encode(MVKCommandEncoder* cmdEncoder) {
 	if (_wordCount == 0) { return; }
 
+	_dstBuffer->markContentChanged();
+
 	id<MTLBuffer> dstMTLBuff = _dstBuffer->getMTLBuffer();
 	NSUInteger dstMTLBuffOffset = _dstBuffer->getMTLBufferOffset() + _dstOffset;
 
@@ -1268,26 +1684,28 @@ VkResult MVKCmdUpdateBuffer::setContent(MVKCommandBuffer* cmdBuff,
 	return VK_SUCCESS;
 }
 
-void MVKCmdUpdateBuffer::encode(MVKCommandEncoder* cmdEncoder) {
+bool MVKCmdUpdateBuffer::getTransferAccesses(MVKCommandEncoder* cmdEncoder, std::vector<MVKTransferAccess>& accesses) {
+	accesses.push_back({ _dstBuffer->getMTLBuffer(), (NSUInteger)(_dstBuffer->getMTLBufferOffset() + _dstOffset),
+						 (NSUInteger)_dataSize, kMVKTransferEncoderTypeBlit, true });
+	return true;
+}
+
+void MVKCmdUpdateBuffer::encodeTransfer(MVKCommandEncoder* cmdEncoder, MVKTransferEncoderType encoderType) {
+	if (encoderType == kMVKTransferEncoderTypeBlit) { encode(cmdEncoder); }
+}
 
-    id<MTLBlitCommandEncoder> mtlBlitEnc = cmdEncoder->getMTLBlitEncoder(kMVKCommandUseUpdateBuffer);
+void MVKCmdUpdateBuffer::encode(MVKCommandEncoder* cmdEncoder) {
+	_dstBuffer->markContentChanged();
 
     id<MTLBuffer> dstMTLBuff = _dstBuffer->getMTLBuffer();
     NSUInteger dstMTLBuffOffset = _dstBuffer->getMTLBufferOffset() + _dstOffset;
 
-    // Copy data to the source MTLBuffer
-    MVKMTLBufferAllocation* srcMTLBufferAlloc = (MVKMTLBufferAllocation*)cmdEncoder->getCommandEncodingPool()->acquireMTLBufferAllocation(_dataSize);
-    memcpy(srcMTLBufferAlloc->getContents(), _srcDataCache.data(), _dataSize);
-
-    [mtlBlitEnc copyFromBuffer: srcMTLBufferAlloc->_mtlBuffer
-                  sourceOffset: srcMTLBufferAlloc->_offset
-                      toBuffer: dstMTLBuff
-             destinationOffset: dstMTLBuffOffset
-                          size: _dataSize];
+    // Copy data to a transient source MTLBuffer
+    MVKMTLBufferRegion srcMTLBuffRgn = cmdEncoder->copyToTransientMTLBuffer(_srcDataCache.data(), _dataSize);
 
-    // Return the MTLBuffer allocation to the pool once the command buffer is done with it
-    [cmdEncoder->_mtlCmdBuffer addCompletedHandler: ^(id<MTLCommandBuffer> mcb) {
-        srcMTLBufferAlloc->returnToPool();
-    }];
+    cmdEncoder->encodeBlitCopyBuffer(kMVKCommandUseUpdateBuffer,
+                                     srcMTLBuffRgn.mtlBuffer, srcMTLBuffRgn.offset,
+                                     dstMTLBuff, dstMTLBuffOffset,
+                                     _dataSize);
 }
 
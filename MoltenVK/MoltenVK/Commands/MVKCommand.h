@@ -20,10 +20,21 @@
 
 
 #include "MVKObjectPool.h"
+#include "MVKFoundation.h"
+#include <vector>
+
+#import <Metal/Metal.h>
 
 class MVKCommandBuffer;
 class MVKCommandEncoder;
 class MVKCommandPool;
+class MVKImage;
+struct MVKClearLoadOverrides;
+struct MVKResolveStoreOverrides;
+class MVKLoadStoreActionInference;
+class MVKIndirectDrawConversionBatch;
+class MVKGraphicsPipeline;
+struct MVKIndirectDrawRunState;
 
 
 #pragma mark -
@@ -46,6 +57,44 @@ public:
 };
 
 
+#pragma mark -
+#pragma mark MVKTransferAccess
+
+/** The type of Metal encoder used to encode part of a transfer command. */
+typedef enum : uint8_t {
+	kMVKTransferEncoderTypeBlit,
+	kMVKTransferEncoderTypeCompute,
+} MVKTransferEncoderType;
+
+/** Describes a range of a Metal resource that is read or written by part of a transfer command. */
+typedef struct {
+	id<MTLResource> mtlResource;
+	NSUInteger offset;
+	NSUInteger length;
+	MVKTransferEncoderType encoderType;
+	bool isWrite;
+} MVKTransferAccess;
+
+
+#pragma mark -
+#pragma mark MVKCommandCategory
+
+/** The category of a Vulkan command, used to attribute its encoding time in the performance statistics. */
+typedef enum : uint8_t {
+	kMVKCommandCategoryState,				/**< Commands that set dynamic state, or bind vertex or index buffers, or push constants. */
+	kMVKCommandCategoryDraw,				/**< Draw commands. */
+	kMVKCommandCategoryDispatch,			/**< Dispatch commands. */
+	kMVKCommandCategoryTransfer,			/**< Copy, blit, resolve, fill, update, and clear commands. */
+	kMVKCommandCategoryRenderPass,			/**< Commands that begin, advance, or end a render pass. */
+	kMVKCommandCategorySynchronization,		/**< Pipeline barrier and event commands. */
+	kMVKCommandCategoryBindPipeline,		/**< Pipeline binding commands. */
+	kMVKCommandCategoryBindDescriptors,		/**< Descriptor set bind and push commands. */
+	kMVKCommandCategoryQuery,				/**< Query commands. */
+	kMVKCommandCategoryDebugMarker,			/**< Debug marker commands. */
+	kMVKCommandCategoryExecuteCommands,		/**< Secondary command buffer execution, whose commands are tracked individually. */
+} MVKCommandCategory;
+
+
 #pragma mark -
 #pragma mark MVKCommand
 
@@ -67,6 +116,106 @@ public:
 	/** Encodes this command on the specified command encoder. */
 	virtual void encode(MVKCommandEncoder* cmdEncoder) = 0;
 
+	/** Returns the category of this command. Returns kMVKCommandCategoryState by default. */
+	virtual MVKCommandCategory getCategory() { return kMVKCommandCategoryState; }
+
+	/**
+	 * Returns whether this command can be encoded into a MTLIndirectCommandBuffer, instead of
+	 * being encoded by the encode() function, while the specified graphics pipeline is bound
+	 * within a Metal render pass.
+	 *
+	 * Returns false by default. Subclasses that support indirect encoding should override.
+	 */
+	virtual bool canEncodeIndirectly(MVKGraphicsPipeline* pipeline) { return false; }
+
+	/**
+	 * Encodes this command into the MTLIndirectRenderCommand, using the specified state.
+	 * This function is only called if canEncodeIndirectly() returns true for the pipeline.
+	 */
+	virtual void encodeIndirectly(const MVKIndirectDrawRunState& state, id<MTLIndirectRenderCommand> mtlIndRendCmd) {}
+
+	/**
+	 * Called for each command that is not encoded indirectly, in order, when the runs of draw commands
+	 * of a command buffer are encoded into MTLIndirectCommandBuffers before the command buffer itself
+	 * is encoded, to allow the command to update the state that the draws that follow it will use.
+	 *
+	 * Does nothing by default. Subclasses that bind state used by indirect draws should override.
+	 */
+	virtual void gatherIndirectDrawRunState(MVKIndirectDrawRunState& state) {}
+
+	/**
+	 * Returns whether this command is a transfer that can be coalesced with adjacent transfer
+	 * commands, and if so, appends the Metal resource ranges it accesses, in the order it
+	 * accesses them, to the accesses vector.
+	 *
+	 * Returns false by default. Subclasses that support transfer coalescing should override.
+	 */
+	virtual bool getTransferAccesses(MVKCommandEncoder* cmdEncoder, std::vector<MVKTransferAccess>& accesses) { return false; }
+
+	/**
+	 * Encodes only the part of this transfer command that uses the specified type of Metal
+	 * encoder. This function is only called if getTransferAccesses() returns true.
+	 */
+	virtual void encodeTransfer(MVKCommandEncoder* cmdEncoder, MVKTransferEncoderType encoderType) {}
+
+	/**
+	 * If this command can be performed entirely by the load actions of the Metal render pass
+	 * that the command encoder is about to begin, records it into the clear load overrides
+	 * of that render pass, and returns true. If this function returns true, this command
+	 * will not otherwise be encoded.
+	 *
+	 * Returns false by default. Subclasses that support folding into load actions should override.
+	 */
+	virtual bool encodeAsLoadActions(MVKCommandEncoder* cmdEncoder, MVKClearLoadOverrides& clearLoads) { return false; }
+
+	/**
+	 * If this command follows the end of the current render pass, and can be performed entirely
+	 * by the store actions of the last Metal render pass of that render pass, records it into the
+	 * resolve store overrides of that Metal render pass, and returns true. If this function returns
+	 * true, this command will not otherwise be encoded.
+	 *
+	 * Returns false by default. Subclasses that support folding into store actions should override.
+	 */
+	virtual bool encodeAsStoreActions(MVKCommandEncoder* cmdEncoder, MVKResolveStoreOverrides& resolveStores) { return false; }
+
+	/**
+	 * If this command begins or ends a render pass, records the effect of this command into the
+	 * inference of the load and store actions of the render passes of the command buffer, and
+	 * returns true. If this function returns false, the inference is updated from the category
+	 * of this command instead.
+	 *
+	 * Returns false by default. Subclasses that begin or end a render pass should override.
+	 */
+	virtual bool inferLoadStoreActions(MVKLoadStoreActionInference& inference) { return false; }
+
+	/**
+	 * If this command downsamples the entire content of one mip level of an image to the entire
+	 * content of the next mip level of the same image, using linear filtering, returns the image
+	 * in mipImage, and the source mip level and layers in srcSubresource, and returns true.
+	 *
+	 * Returns false by default. Subclasses that BLIT images should override.
+	 */
+	virtual bool getMipmapLevelBlit(MVKImage*& mipImage, VkImageSubresourceLayers& srcSubresource) { return false; }
+
+	/**
+	 * Returns whether this command only establishes execution and memory dependencies between
+	 * the commands before it and the commands after it, and so can be encoded after commands
+	 * that follow it, if those commands are performed before the commands that precede it.
+	 *
+	 * Returns false by default. Pipeline barrier commands should override.
+	 */
+	virtual bool isPipelineBarrier() { return false; }
+
+	/**
+	 * Called for each command in a render pass, in order, before the render pass begins, to allow
+	 * the command to add the conversions of its indirect draw arguments to the batch. Returns whether
+	 * the batch can continue to gather conversions from the commands that follow this command.
+	 *
+	 * Returns true by default. Subclasses that bind pipelines, draw indirectly, end the render pass,
+	 * or otherwise hide the commands that follow them, should override.
+	 */
+	virtual bool gatherIndirectDrawConversions(MVKIndirectDrawConversionBatch& batch) { return true; }
+
 protected:
 	friend MVKCommandBuffer;
 
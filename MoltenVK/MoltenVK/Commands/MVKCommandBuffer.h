@@ -22,9 +22,12 @@
 #include "MVKCommand.h"
 #include "MVKCommandEncoderState.h"
 #include "MVKMTLBufferAllocation.h"
+#include "MVKCommandEncodingPool.h"
 #include "MVKCmdPipeline.h"
 #include "MVKQueryPool.h"
+#include "MVKRenderPass.h"
 #include "MVKVector.h"
+#include "MVKArena.h"
 #include <unordered_map>
 
 class MVKCommandPool;
@@ -36,6 +39,8 @@ class MVKRenderPass;
 class MVKFramebuffer;
 class MVKRenderSubpass;
 class MVKQueryPool;
+class MVKTimestampQueryPool;
+class MVKPipelineStatisticsQueryPool;
 class MVKPipeline;
 class MVKGraphicsPipeline;
 class MVKComputePipeline;
@@ -43,6 +48,84 @@ class MVKLoadStoreOverrideMixin;
 
 typedef uint64_t MVKMTLCommandBufferID;
 
+/** The minimum number of consecutive draw commands that will be replayed from a MTLIndirectCommandBuffer. */
+static const uint32_t kMVKIndirectDrawRunMinDrawCount = 8;
+
+/** The maximum number of consecutive transfer commands that will be analyzed together for coalescing. */
+static const uint32_t kMVKTransferRunMaxCommandCount = 256;
+
+/** A run of consecutive draw commands in a command buffer, that can be replayed from a MTLIndirectCommandBuffer. */
+typedef struct {
+	id<MTLIndirectCommandBuffer> mtlIndirectCommandBuffer = nil;	// Nil if the run is too short to replay
+	id<MTLBuffer> mtlIndexBuffer = nil;								// The index buffer used by indexed draws
+	MVKCommand* nextCommand = nullptr;								// The first command after the run
+	uint32_t drawCount = 0;
+} MVKIndirectDrawRun;
+
+/** The state that the draws in a MVKIndirectDrawRun are encoded with. */
+struct MVKIndirectDrawRunState {
+	MVKGraphicsPipeline* pipeline = nullptr;
+	MVKIndexMTLBufferBinding indexBuffer;
+	MTLPrimitiveType mtlPrimitiveType = MTLPrimitiveTypeTriangle;
+};
+
+#pragma mark -
+#pragma mark MVKLoadStoreActionInference
+
+/**
+ * Infers, from the commands of a command buffer, which attachments of each render pass in the
+ * command buffer need not be loaded when the render pass begins, because their contents are
+ * undefined, or stored when the render pass ends, because the next render pass that uses them
+ * replaces their entire contents, and no command between the render passes can read them.
+ */
+class MVKLoadStoreActionInference {
+
+public:
+
+	/** Records the beginning of a render pass, and populates its inferred load and store actions. */
+	void beginRenderPass(MVKRenderPass* renderPass,
+						 MVKFramebuffer* framebuffer,
+						 const VkRect2D& renderArea,
+						 MVKInferredLoadStoreActions& inferredLoadStores);
+
+	/** Records the end of the current render pass. */
+	void endRenderPass() { _isInRenderPass = false; }
+
+	/** Records a command, of the specified category, that neither begins nor ends a render pass. */
+	void recordCommand(MVKCommandCategory cmdCategory);
+
+protected:
+	bool isRenderingEntireImageView(MVKImageView* imageView, MVKFramebuffer* framebuffer, const VkRect2D& renderArea);
+	bool areSameImageSubresources(MVKImageView* imageView1, MVKImageView* imageView2);
+
+	MVKRenderPass* _prevRenderPass = nullptr;
+	MVKFramebuffer* _prevFramebuffer = nullptr;
+	MVKInferredLoadStoreActions* _pPrevInferredLoadStores = nullptr;
+	VkRect2D _prevRenderArea;
+	bool _isInRenderPass = false;
+};
+
+
+/** A MTLIndirectCommandBuffer that is populated on the GPU from the Vulkan indirect buffer of a multi-draw command. */
+typedef struct {
+	id<MTLIndirectCommandBuffer> mtlIndirectCommandBuffer = nil;
+	id<MTLBuffer> mtlArgumentBuffer = nil;		// Argument buffer that references the MTLIndirectCommandBuffer
+	uint32_t maxDrawCount = 0;
+} MVKMultiDrawIndirectCommandBuffer;
+
+
+#pragma mark -
+#pragma mark MVKTessScratchBufferType
+
+/** Identifies the scratch buffers that pass data between the stages of a tessellated draw. */
+typedef enum : uint8_t {
+	kMVKTessScratchVertexOutput,			/**< Vertex shader output, read by the tess. control stage. */
+	kMVKTessScratchTessCtlOutput,			/**< Tess. control shader per-vertex output. */
+	kMVKTessScratchTessCtlPatchOutput,		/**< Tess. control shader per-patch output. */
+	kMVKTessScratchTessCtlLevel,			/**< Tessellation factors. */
+	kMVKTessScratchCount
+} MVKTessScratchBufferType;
+
 
 #pragma mark -
 #pragma mark MVKCommandBuffer
@@ -71,9 +154,23 @@ public:
 	/** Closes this buffer from receiving commands and prepares for submission to a queue. */
 	VkResult end();
 
+	/**
+	 * Returns a new command instance of the specified type, for adding to this command buffer.
+	 *
+	 * If this command buffer is using a command arena, the command is constructed within the
+	 * arena of this command buffer. Otherwise, the command is acquired from the type pool.
+	 */
+	template <class T>
+	T* acquireCommand(MVKCommandTypePool<T>& typePool) {
+		return _usesCommandArena ? _commandArena.newObject<T>() : typePool.acquireObject();
+	}
+
 	/** Adds the specified execution command at the end of this command buffer. */
 	void addCommand(MVKCommand* command);
 
+	/** Releases the specified command, which was acquired for, but not added to, this command buffer. */
+	void discardCommand(MVKCommand* command);
+
 	/** Returns the number of commands currently in this command buffer. */
 	inline uint32_t getCommandCount() { return _commandCount; }
 
@@ -83,9 +180,33 @@ public:
 	/** Submit the commands in this buffer as part of the queue submission. */
 	void submit(MVKQueueCommandBufferSubmission* cmdBuffSubmit);
 
+	/**
+	 * Prepares this command buffer to be encoded onto its own MTLCommandBuffer, as part of a
+	 * queue submission whose command buffers are being encoded in parallel.
+	 *
+	 * If this command buffer was prefilled, returns the prefilled MTLCommandBuffer and sets
+	 * needsEncoding to false. Otherwise, returns a new MTLCommandBuffer retrieved from the
+	 * queue, and sets needsEncoding to true, indicating that encodeSubmitted() must
+	 * be called before the MTLCommandBuffer is committed. In either case, the returned
+	 * MTLCommandBuffer is retained, and has not been enqueued on the MTLCommandQueue.
+	 * The caller is responsible for enqueuing and committing it, in submission order.
+	 *
+	 * Returns nil if this command buffer cannot be executed.
+	 */
+	id<MTLCommandBuffer> prepareSubmitted(MVKQueue* mvkQueue, bool& needsEncoding);
+
+	/**
+	 * Encodes the commands in this buffer onto the MTLCommandBuffer returned by prepareSubmitted().
+	 * Different command buffers may be encoded concurrently on different threads.
+	 */
+	void encodeSubmitted(id<MTLCommandBuffer> mtlCmdBuff);
+
     /** Returns whether this command buffer can be submitted to a queue more than once. */
     inline bool getIsReusable() { return _isReusable; }
 
+	/** Returns whether this is a secondary command buffer. */
+	inline bool isSecondary() { return _isSecondary; }
+
     /**
      * Metal requires that a visibility buffer is established when a render pass is created, 
      * but Vulkan permits it to be set during a render pass. When the first occlusion query
@@ -99,10 +220,20 @@ public:
 #pragma mark Tessellation constituent command management
 
     /** Preps metadata for recording render pass */
-	void recordBeginRenderPass(MVKLoadStoreOverrideMixin* mvkBeginRenderPass);
+	void recordBeginRenderPass(MVKLoadStoreOverrideMixin* mvkBeginRenderPass, MVKRenderPass* renderPass);
 	
+	/** Update the metadata for recording render pass when it advances to the next subpass */
+	void recordNextSubpass(MVKLoadStoreOverrideMixin* mvkNextSubpass);
+
 	/** Finishes metadata for recording render pass */
 	void recordEndRenderPass();
+
+	/**
+	 * If recording a render pass, records that the command may end the Metal render pass within the current
+	 * subpass, and restart it. The command that began the Metal render pass being ended is marked to store
+	 * the attachment contents, and the command itself is marked to load them.
+	 */
+	void recordMetalRenderPassRestart(MVKLoadStoreOverrideMixin* mvkCmd);
 	
 	/** Update the last recorded pipeline if it will end and start a new Metal render pass (ie, in tessellation) */
 	void recordBindPipeline(MVKCmdBindPipeline* mvkBindPipeline);
@@ -119,10 +250,39 @@ public:
 	/** The most recent recorded multi-pass (ie, tessellation) draw */
 	MVKLoadStoreOverrideMixin* _lastTessellationDraw;
 
+	/** The render pass, subpass, and command that began the Metal render pass, most recently recorded */
+	MVKRenderPass* _lastRenderPass = nullptr;
+	uint32_t _lastSubpassIndex = 0;
+	MVKLoadStoreOverrideMixin* _lastMetalRenderPassBegin = nullptr;
+
+	/**
+	 * Returns the largest length, in bytes, of the scratch buffer of the specified type that has
+	 * been needed by the tessellated draws in any encoding of this command buffer. Encodings use
+	 * this to size each scratch buffer once, up front. This value is retained across resets.
+	 */
+	NSUInteger getTessellationScratchHighWaterMark(MVKTessScratchBufferType scratchType) { return _tessScratchHighWaterMarks[scratchType]; }
+
+	/** Records the length of a scratch buffer of the specified type needed by a tessellated draw. */
+	void recordTessellationScratchLength(MVKTessScratchBufferType scratchType, NSUInteger length);
+
+	/**
+	 * Returns whether the draws of indirect multi-draw commands in this command buffer can be encoded
+	 * into a MTLIndirectCommandBuffer on the GPU. This requires that each such MTLIndirectCommandBuffer
+	 * can be reused by each submission, which is not possible if submissions may execute concurrently.
+	 */
+	bool canEncodeMultiDrawIndirectOnGPU();
+
+	/**
+	 * Returns the MTLIndirectCommandBuffer that the GPU populates with the draws of the specified multi-draw
+	 * command, creating it if needed. The MTLIndirectCommandBuffer is retained until this command buffer is reset.
+	 */
+	MVKMultiDrawIndirectCommandBuffer& getMultiDrawIndirectCommandBuffer(MVKCommand* drawCmd, uint32_t drawCount);
+
 
 #pragma mark Construction
 
-	MVKCommandBuffer(MVKDevice* device) : MVKDeviceTrackingMixin(device) {}
+	MVKCommandBuffer(MVKDevice* device) : MVKDeviceTrackingMixin(device),
+		_usesCommandArena(device->shouldUseCommandArena()) {}
 
 	~MVKCommandBuffer() override;
 
@@ -148,16 +308,28 @@ protected:
 	void propogateDebugName() override {}
 	void init(const VkCommandBufferAllocateInfo* pAllocateInfo);
 	bool canExecute();
+	bool canReplayIndirectDraws();
+	bool canPreencodeIndirectDraws();
+	void preencodeIndirectDraws();
+	void inferLoadStoreActions();
+	MVKIndirectDrawRun& getIndirectDrawRun(MVKCommand* firstCmd, const MVKIndirectDrawRunState& state);
+	void clearIndirectDrawRuns();
 	bool canPrefill();
 	void prefill();
 	void clearPrefilledMTLCommandBuffer();
+	id<MTLCommandBuffer> takePrefilledMTLCommandBuffer();
 	void releaseCommands();
+	void releaseCommand(MVKCommand* command);
 
+	MVKArena _commandArena;
+	std::unordered_map<MVKCommand*, MVKIndirectDrawRun> _indirectDrawRuns;
+	std::unordered_map<MVKCommand*, MVKMultiDrawIndirectCommandBuffer> _multiDrawIndirectCommandBuffers;
 	MVKCommand* _head = nullptr;
 	MVKCommand* _tail = nullptr;
 	uint32_t _commandCount;
 	MVKCommandPool* _commandPool;
 	std::atomic_flag _isExecutingNonConcurrently;
+	std::atomic<NSUInteger> _tessScratchHighWaterMarks[kMVKTessScratchCount] = {};
 	VkCommandBufferInheritanceInfo _secondaryInheritanceInfo;
 	id<MTLCommandBuffer> _prefilledMTLCmdBuffer = nil;
 	bool _isSecondary;
@@ -166,6 +338,124 @@ protected:
 	bool _isReusable;
 	bool _supportsConcurrentExecution;
 	bool _wasExecuted;
+	bool _usesCommandArena;
+};
+
+
+#pragma mark -
+#pragma mark MVKIndirectDrawConversionBatch
+
+/**
+ * Describes the conversion of the Vulkan arguments of a single indirect tessellated draw.
+ * The layout of this structure must match the layout used by the conversion shader.
+ */
+typedef struct {
+	uint32_t srcOffset;				// Offset of the Vulkan arguments, relative to the start of the group
+	uint32_t destOffset;			// Offset of the converted arguments in the destination MTLBuffer
+	uint32_t inControlPointCount;
+	uint32_t outControlPointCount;
+} MVKIndirectDrawConversion;
+
+/**
+ * Describes how to populate a MTLIndirectCommandBuffer from the Vulkan indirect buffer of a multi-draw command.
+ * The layout of this structure must match the layout used by the population shaders.
+ */
+typedef struct {
+	uint32_t srcStride;
+	uint32_t maxDrawCount;
+	uint32_t primitiveType;			// MTLPrimitiveType
+	uint32_t hasCountBuffer;		// If non-zero, the draw count is read from a count buffer
+} MVKMultiDrawIndirectInfo;
+
+/**
+ * Gathers the conversions of the indirect arguments of the indirect draws in a render pass,
+ * so they can all be performed before the render pass begins, instead of interrupting it.
+ *
+ * The arguments of tessellated draws are converted using a single compute dispatch for each
+ * Vulkan indirect buffer. Non-tessellated commands with more than one draw are encoded into a
+ * MTLIndirectCommandBuffer by a compute dispatch, and executed with a single Metal command.
+ */
+class MVKIndirectDrawConversionBatch {
+
+public:
+
+	/** The graphics pipeline that will be bound when the command being gathered is encoded. */
+	MVKGraphicsPipeline* pipeline = nullptr;
+
+	/** The index buffer that will be bound when the command being gathered is encoded. */
+	MVKIndexMTLBufferBinding indexBuffer;
+
+	/**
+	 * Adds conversions for the indirect draws of the command, if they can be performed before the render pass.
+	 * If the count buffer is not nil, the number of draws is read from it, and drawCount is the maximum.
+	 */
+	void addDraws(MVKCommand* drawCmd, bool isIndexed,
+				  id<MTLBuffer> mtlIndirectBuffer, VkDeviceSize offset, uint32_t stride, uint32_t drawCount,
+				  id<MTLBuffer> mtlCountBuffer = nil, VkDeviceSize countOffset = 0);
+
+	/**
+	 * If the conversions of the specified command were performed by this batch, for the specified
+	 * pipeline, populates the MTLBuffer and offset of the converted arguments of its first draw,
+	 * and returns true. Otherwise, returns false, and the command must convert its own arguments.
+	 */
+	bool getConvertedArguments(MVKCommand* drawCmd, MVKGraphicsPipeline* drawPipeline, id<MTLBuffer>& mtlBuffer, VkDeviceSize& offset);
+
+	/**
+	 * If the draws of the specified command were encoded into a MTLIndirectCommandBuffer by this batch,
+	 * for the current pipeline and index buffer, executes them on the command encoder, and returns true.
+	 * Otherwise, returns false, and the command must encode its own draws.
+	 */
+	bool encodeMultiDraws(MVKCommand* drawCmd, MVKCommandEncoder* cmdEncoder);
+
+	/** Encodes the gathered conversions on the command encoder. */
+	void encode(MVKCommandEncoder* cmdEncoder);
+
+	/** Removes all gathered conversions, and sets the pipeline and index buffer that are currently bound. */
+	void reset(MVKCommandEncoder* cmdEncoder);
+
+	/**
+	 * Returns the size of the converted arguments of each indirect tessellated draw, which
+	 * consists of optional stage-in region arguments, followed by threadgroup dispatch
+	 * arguments for the tess. control stage, followed by draw-patches arguments.
+	 */
+	static NSUInteger getConvertedArgumentsSize(const MVKPhysicalDeviceMetalFeatures* pMetalFeatures);
+
+protected:
+	typedef struct {
+		id<MTLBuffer> srcMTLBuffer;
+		VkDeviceSize srcOffset;
+		std::vector<MVKIndirectDrawConversion> conversions;
+	} ConversionGroup;
+
+	typedef struct {
+		MVKGraphicsPipeline* pipeline;
+		uint32_t firstDrawIndex;
+	} DrawCommandInfo;
+
+	typedef struct {
+		MVKCommand* drawCmd;
+		MVKGraphicsPipeline* pipeline;
+		MVKIndexMTLBufferBinding indexBuffer;	// Only has a MTLBuffer for indexed draws
+		id<MTLBuffer> srcMTLBuffer;
+		VkDeviceSize srcOffset;
+		id<MTLBuffer> countMTLBuffer;
+		VkDeviceSize countOffset;
+		MVKMultiDrawIndirectInfo info;
+		id<MTLIndirectCommandBuffer> mtlIndirectCommandBuffer;
+	} MultiDrawInfo;
+
+	void addMultiDraws(MVKCommand* drawCmd, bool isIndexed,
+					   id<MTLBuffer> mtlIndirectBuffer, VkDeviceSize offset, uint32_t stride, uint32_t drawCount,
+					   id<MTLBuffer> mtlCountBuffer, VkDeviceSize countOffset);
+	void encodeMultiDrawPopulation(MVKCommandEncoder* cmdEncoder);
+
+	std::vector<ConversionGroup> _groups;
+	std::unordered_map<MVKCommand*, DrawCommandInfo> _drawCommands;
+	std::vector<MultiDrawInfo> _multiDraws;
+	MVKCommandEncoder* _cmdEncoder = nullptr;
+	const MVKMTLBufferAllocation* _destBuffer = nullptr;
+	NSUInteger _convertedArgumentsSize = 0;
+	uint32_t _drawCount = 0;
 };
 
 
@@ -188,6 +478,14 @@ protected:
 // + vkCmdSetStencilWriteMask() : _depthStencilState
 // + vkCmdSetStencilReference() : _stencilReferenceValueState
 // + vkCmdSetBlendConstants() : _blendColorState
+// + vkCmdSetCullModeEXT() : _rasterizingState
+// + vkCmdSetFrontFaceEXT() : _rasterizingState
+// + vkCmdSetPrimitiveTopologyEXT() : _rasterizingState
+// + vkCmdSetDepthTestEnableEXT() : _depthStencilState
+// + vkCmdSetDepthWriteEnableEXT() : _depthStencilState
+// + vkCmdSetDepthCompareOpEXT() : _depthStencilState
+// + vkCmdSetStencilTestEnableEXT() : _depthStencilState
+// + vkCmdSetStencilOpEXT() : _depthStencilState
 // + vkCmdBeginQuery() : _occlusionQueryState
 // + vkCmdEndQuery() : _occlusionQueryState
 // + vkCmdPipelineBarrier() : handled via textureBarrier and MTLBlitCommandEncoder
@@ -199,11 +497,11 @@ protected:
 
 // The above list of Vulkan commands covers the following corresponding MTLRenderCommandEncoder state:
 // + setBlendColorRed : _blendColorState
-// + setCullMode : _graphicsPipelineState
+// + setCullMode : _rasterizingState
 // + setDepthBias : _depthBiasState
 // + setDepthClipMode : _graphicsPipelineState
 // + setDepthStencilState : _depthStencilState
-// + setFrontFacingWinding : _graphicsPipelineState
+// + setFrontFacingWinding : _rasterizingState
 // + setRenderPipelineState : _graphicsPipelineState
 // + setScissorRect : _scissorState
 // + setStencilFrontReferenceValue : _stencilReferenceValueState
@@ -214,7 +512,7 @@ protected:
 // + setVertexBuffer : _graphicsResourcesState & _vertexPushConstants & _tessEvalPushConstants
 // + setVertexBuffers (unused) : _graphicsResourcesState
 // + setVertexBytes : _vertexPushConstants & _tessEvalPushConstants
-// + setVertexBufferOffset (unused) : _graphicsResourcesState
+// + setVertexBufferOffset : _graphicsResourcesState
 // + setVertexTexture : _graphicsResourcesState
 // + setVertexTextures (unused) : _graphicsResourcesState
 // + setVertexSamplerState : _graphicsResourcesState
@@ -222,7 +520,7 @@ protected:
 // + setFragmentBuffer : _graphicsResourcesState & _fragmentPushConstants
 // + setFragmentBuffers (unused) : _graphicsResourcesState
 // + setFragmentBytes : _fragmentPushConstants
-// + setFragmentBufferOffset (unused) : _graphicsResourcesState
+// + setFragmentBufferOffset : _graphicsResourcesState
 // + setFragmentTexture : _graphicsResourcesState
 // + setFragmentTextures (unused) : _graphicsResourcesState
 // + setFragmentSamplerState : _graphicsResourcesState
@@ -233,7 +531,7 @@ protected:
 // + setBuffer : _computeResourcesState & _computePushConstants & _graphicsResourcesState & _tessCtlPushConstants
 // + setBuffers (unused) : _computeResourcesState & _graphicsResourcesState
 // + setBytes : _computePushConstants & _tessCtlPushConstants
-// + setBufferOffset (unused) : _computeResourcesState & _graphicsResourcesState
+// + setBufferOffset : _computeResourcesState & _graphicsResourcesState
 // + setTexture : _computeResourcesState & _graphicsResourcesState
 // + setTextures (unused) : _computeResourcesState & _graphicsResourcesState
 // + setSamplerState : _computeResourcesState & _graphicsResourcesState
@@ -257,8 +555,12 @@ public:
 	/** Returns the Vulkan API opaque object controlling this object. */
 	MVKVulkanAPIObject* getVulkanAPIObject() override { return _cmdBuffer->getVulkanAPIObject(); };
 
-	/** Encode commands from the command buffer onto the Metal command buffer. */
-	void encode(id<MTLCommandBuffer> mtlCmdBuff);
+	/**
+	 * Encode commands from the command buffer onto the Metal command buffer. If the queue submission
+	 * is provided, and early commits are enabled, the Metal command buffer may be committed through
+	 * the submission before encoding is complete, and encoding continues on a new Metal command buffer.
+	 */
+	void encode(id<MTLCommandBuffer> mtlCmdBuff, MVKQueueCommandBufferSubmission* cmdBuffSubmit = nullptr);
 
 	/** Encode commands from the specified secondary command buffer onto the Metal command buffer. */
 	void encodeSecondary(MVKCommandBuffer* secondaryCmdBuffer);
@@ -270,10 +572,11 @@ public:
 						 VkRect2D& renderArea,
 						 MVKVector<VkClearValue>* clearValues,
 						 bool loadOverride = false,
-						 bool storeOverride = false);
+						 bool storeOverride = false,
+						 MVKInferredLoadStoreActions* pInferredLoadStores = nullptr);
 
 	/** Begins the next render subpass. */
-	void beginNextSubpass(VkSubpassContents renderpassContents);
+	void beginNextSubpass(VkSubpassContents renderpassContents, bool storeOverride = false);
 
 	/** Begins a Metal render pass for the current render subpass. */
 	void beginMetalRenderPass(bool loadOverride = false, bool storeOverride = false);
@@ -281,18 +584,83 @@ public:
 	/** Returns the render subpass that is currently active. */
 	MVKRenderSubpass* getSubpass();
 
+	/**
+	 * Returns the command that will be encoded after the command that is currently being encoded.
+	 * The current command may perform the commands that follow it, and skip over them, by setting
+	 * the next command to be encoded, using setNextCommand().
+	 */
+	inline MVKCommand* getNextCommand() { return _nextCommand; }
+
+	/** Sets the command that will be encoded after the command that is currently being encoded. */
+	inline void setNextCommand(MVKCommand* nextCmd) { _nextCommand = nextCmd; }
+
+	/** Returns the indirect draw argument conversions that were performed before the current render pass began. */
+	MVKIndirectDrawConversionBatch& getIndirectDrawConversions() { return _indirectDrawConversions; }
+
+	/**
+	 * Returns whether the current render subpass renders to the entire area
+	 * of all attachments, and can therefore clear them using load actions.
+	 */
+	inline bool isRenderingEntireAttachment() { return _isRenderingEntireAttachment; }
+
     /** Binds a pipeline to a bind point. */
     void bindPipeline(VkPipelineBindPoint pipelineBindPoint, MVKPipeline* pipeline);
 
-	/** Encodes an operation to signal an event to a status. */
+	/**
+	 * Returns whether the descriptor set is the one most recently bound at the descriptor set
+	 * index using the pipeline layout, in which case the resources of the descriptor set
+	 * are already held by the encoder resource state, and only dynamic offsets can differ.
+	 */
+	bool isBoundDescriptorSet(MVKPipelineLayout* pipelineLayout, uint32_t set, MVKDescriptorSet* descSet);
+
+	/**
+	 * Records the descriptor set as the one most recently bound at the descriptor set index
+	 * using the pipeline layout. Binding using a different pipeline layout forgets all previously
+	 * recorded descriptor sets. A null descriptor set forgets the set at that index.
+	 */
+	void setBoundDescriptorSet(MVKPipelineLayout* pipelineLayout, uint32_t set, MVKDescriptorSet* descSet);
+
+	/**
+	 * Encodes an operation to signal an event to a status. To avoid splitting the current Metal
+	 * encoder, the signal is encoded at the next Metal encoder boundary, which is never later
+	 * than the end of the Metal command buffer.
+	 */
 	void signalEvent(MVKEvent* mvkEvent, bool status);
 
+	/**
+	 * Encodes operations to wait for the events. If an event was set earlier in the current Metal
+	 * command buffer, the wait is satisfied by GPU execution order, and nothing is encoded for it.
+	 * If the Metal render pass is ended to wait and then restarted, the storeOverride parameter
+	 * indicates whether the restarted Metal render pass must store the attachment contents.
+	 */
+	void waitEvents(MVKVector<MVKEvent*>& mvkEvents, bool storeOverride);
+
+	/**
+	 * If hazards are tracked using MTLFences, marks an execution and memory dependency between all
+	 * of the Metal encoders encoded before this call, and all of those encoded after it. Metal
+	 * encoders that are not separated by a call to this function may execute concurrently.
+	 */
+	void markHazardBarrier();
+
+	/**
+	 * If hazards are tracked using MTLFences, encodes the fence waits required by a Metal render
+	 * encoder that a command creates directly on the Metal command buffer, outside of a render pass.
+	 * Each such render encoder must call endMTLRenderEncoderHazardTracking() before it ends encoding.
+	 */
+	void beginMTLRenderEncoderHazardTracking(id<MTLRenderCommandEncoder> mtlRendEnc);
+
+	/** Encodes the fence update of a render encoder that called beginMTLRenderEncoderHazardTracking(). */
+	void endMTLRenderEncoderHazardTracking(id<MTLRenderCommandEncoder> mtlRendEnc);
+
     /**
      * If a pipeline is currently bound, returns whether the current pipeline permits dynamic
      * setting of the specified state. If no pipeline is currently bound, returns true.
      */
     bool supportsDynamicState(VkDynamicState state);
 
+	/** Returns whether the specified extended dynamic state is supported by the currently bound graphics pipeline. */
+	bool supportsDynamicState(MVKExtendedDynamicState state);
+
 	/** Clips the scissor to ensure it fits inside the render area.  */
 	VkRect2D clipToRenderArea(VkRect2D scissor);
 
@@ -322,9 +690,18 @@ public:
 	 *
 	 * If the current encoder is not a compute encoder, this function ends current before 
 	 * beginning compute encoding.
+	 *
+	 * If concurrent compute dispatch is enabled, the compute encoder for app dispatches uses
+	 * concurrent dispatch, and the compute encoder for all other uses uses serial dispatch.
+	 * Switching between them ends the current compute encoder.
 	 */
 	id<MTLComputeCommandEncoder> getMTLComputeEncoder(MVKCommandUse cmdUse);
 
+	/** Returns the current Metal compute encoder if it uses concurrent dispatch, or nil otherwise. */
+	inline id<MTLComputeCommandEncoder> getConcurrentMTLComputeEncoder() {
+		return _isMTLComputeEncoderConcurrent ? _mtlComputeEncoder : nil;
+	}
+
 	/**
 	 * Returns the current Metal BLIT encoder for the specified use,
      * which determines the label assigned to the returned encoder.
@@ -334,6 +711,18 @@ public:
 	 */
 	id<MTLBlitCommandEncoder> getMTLBlitEncoder(MVKCommandUse cmdUse);
 
+	/**
+	 * Encodes a copy between two MTLBuffers on the current Metal BLIT encoder for the specified use.
+	 *
+	 * The copy may be deferred, so that it can be merged with an immediately following copy of
+	 * the adjacent byte range between the same two MTLBuffers. Any deferred copy is encoded
+	 * before any other access to the Metal encoders, and at the end of each run of transfers.
+	 */
+	void encodeBlitCopyBuffer(MVKCommandUse cmdUse,
+							  id<MTLBuffer> srcMTLBuffer, NSUInteger srcOffset,
+							  id<MTLBuffer> dstMTLBuffer, NSUInteger dstOffset,
+							  NSUInteger size);
+
 	/**
 	 * Returns the current Metal encoder, which may be any of the Metal render,
 	 * comupte, or Blit encoders, or nil if no encoding is currently occurring.
@@ -352,9 +741,42 @@ public:
     /** Copy bytes into the Metal encoder at a Metal compute buffer index. */
     void setComputeBytes(id<MTLComputeCommandEncoder> mtlEncoder, const void* bytes, NSUInteger length, uint32_t mtlBuffIndex);
 
+	/**
+	 * If the compute pipeline allows a dispatch base, passes the base workgroup of the dispatches
+	 * that follow to the shader, unless the current Metal compute encoder already holds that base.
+	 */
+	void setComputeDispatchBase(MVKComputePipeline* pipeline, MTLOrigin mtlBaseGroup);
+
     /** Get a temporary MTLBuffer that will be returned to a pool after the command buffer is finished. */
     const MVKMTLBufferAllocation* getTempMTLBuffer(NSUInteger length);
 
+	/**
+	 * Returns a temporary MTLBuffer of at least the specified length, to be used as the scratch buffer
+	 * of the specified type by a tessellated draw. The same MTLBuffer is reused by all subsequent
+	 * tessellated draws encoded into the same MTLCommandBuffer, which rely on Metal hazard tracking
+	 * of the MTLBuffer to order their accesses, and is only replaced if a draw needs a larger buffer.
+	 */
+	const MVKMTLBufferAllocation* getTessellationScratchBuffer(MVKTessScratchBufferType scratchType, NSUInteger length);
+
+	/**
+	 * Returns a MTLBuffer to hold the indices of an indexed tessellated draw, converted from the index buffer
+	 * content identified by the key, and sets the offset parameter to the offset of the indices within it.
+	 * The MTLBuffer is reused by later draws with the same key that are encoded into the same MTLCommandBuffer,
+	 * which rely on Metal hazard tracking to order their reads after the conversion, and is shared with other
+	 * MTLCommandBuffers through the MVKCommandEncodingPool, once this MTLCommandBuffer has completed.
+	 * The needsConversion parameter is set to indicate whether the caller must encode the conversion of
+	 * the indices into the MTLBuffer.
+	 */
+	id<MTLBuffer> getConvertedIndexMTLBuffer(const MVKConvertedIndexBufferKey& key, NSUInteger length, NSUInteger& offset, bool& needsConversion);
+
+	/**
+	 * Copies the bytes into a region of transient MTLBuffer memory that remains valid until
+	 * the command buffer is finished, and returns that region. The memory is suballocated
+	 * from the transient ring buffer of the command pool, if it has one and it has room,
+	 * otherwise it is taken from a temporary MTLBuffer.
+	 */
+	MVKMTLBufferRegion copyToTransientMTLBuffer(const void* bytes, NSUInteger length);
+
     /** Returns the command encoding pool. */
     MVKCommandEncodingPool* getCommandEncodingPool();
 
@@ -366,8 +788,18 @@ public:
     /** Ends the current occulusion query. */
     void endOcclusionQuery(MVKOcclusionQueryPool* pQueryPool, uint32_t query);
 
-    /** Marks a timestamp for the specified query. */
-    void markTimestamp(MVKQueryPool* pQueryPool, uint32_t query);
+    /**
+     * Marks a timestamp for the specified query. If the GPU supports it, the timestamp is sampled
+     * on the GPU at this point in the command stream. Otherwise the host time at which the
+     * Metal command buffer completes is used.
+     */
+    void markTimestamp(MVKTimestampQueryPool* pQueryPool, uint32_t query);
+
+    /** Samples the pipeline statistics counters at the start of the specified query. */
+    void beginPipelineStatisticsQuery(MVKPipelineStatisticsQueryPool* pQueryPool, uint32_t query);
+
+    /** Samples the pipeline statistics counters at the end of the specified query. */
+    void endPipelineStatisticsQuery(MVKPipelineStatisticsQueryPool* pQueryPool, uint32_t query);
 
 #pragma mark Dynamic encoding state accessed directly
 
@@ -413,6 +845,9 @@ public:
     /** Tracks the current blend color state of the encoder. */
     MVKBlendColorCommandEncoderState _blendColorState;
 
+    /** Tracks the current primitive type, cull mode and front facing winding of the encoder. */
+    MVKRasterizingCommandEncoderState _rasterizingState;
+
     /** Tracks the current depth stencil state of the encoder. */
     MVKDepthStencilCommandEncoderState _depthStencilState;
 
@@ -442,9 +877,27 @@ public:
 protected:
     void addActivatedQuery(MVKQueryPool* pQueryPool, uint32_t query);
     void finishQueries();
+	bool sampleCounters(MVKCommandUse cmdUse, id<MTLCounterSampleBuffer> mtlCounterBuff, uint32_t sampleIndex);
+	void encodeCommands(MVKCommandBuffer* cmdBuffer);
+	MVKCommand* encodeIndirectDrawRun(MVKCommandBuffer* cmdBuffer, MVKCommand* firstCmd);
+	MVKCommand* encodeTransferRun(MVKCommand* firstCmd);
+	MVKPerformanceTracker* getEncodingPerformanceTracker(MVKCommand* cmd);
+	bool canGroupTransferAccesses();
+	void encodePendingBlitCopyBuffer();
+	void encodePendingEventSignals();
+	bool isEventSetInMTLCommandBuffer(MVKEvent* mvkEvent);
+	void commitPartialMTLCommandBufferIfNeeded();
+	id<MTLFence> prepareHazardTracking(MVKVector<id<MTLFence>>& mtlWaitFences, bool isRenderPassEncoder);
+	void advanceHazardEpoch();
+	void beginRenderEncoderHazardTracking(id<MTLRenderCommandEncoder> mtlRendEnc, bool isRenderPassEncoder);
+	template<typename E> void beginHazardTracking(E mtlEncoder);
+	template<typename E> void endHazardTracking(E mtlEncoder);
+	void encodeHazardTrackingJoin();
 	void setSubpass(VkSubpassContents subpassContents, uint32_t subpassIndex, bool loadOverride = false, bool storeOverride = false);
+	void encodeNextCommandsAsLoadActions();
+	void encodeCommandsAfterRenderPassAsStoreActions();
+	void encodeIndirectDrawConversions();
 	void clearRenderArea();
-    const MVKMTLBufferAllocation* copyToTempMTLBufferAllocation(const void* bytes, NSUInteger length);
     NSString* getMTLRenderCommandEncoderName();
 
 	VkSubpassContents _subpassContents;
@@ -453,8 +906,19 @@ protected:
 	VkRect2D _renderArea;
     MVKActivatedQueries* _pActivatedQueries;
 	MVKVectorInline<VkClearValue, 8> _clearValues;
+	MVKClearLoadOverrides _clearLoadOverrides;
+	MVKResolveStoreOverrides _resolveStoreOverrides;
+	MVKInferredLoadStoreActions* _pInferredLoadStores = nullptr;
+	MVKIndirectDrawConversionBatch _indirectDrawConversions;
+	MVKPipelineLayout* _boundDescriptorSetsLayout = nullptr;
+	MVKVectorInline<MVKDescriptorSet*, 8> _boundDescriptorSets;
+	MVKCommand* _nextCommand;
 	id<MTLComputeCommandEncoder> _mtlComputeEncoder;
 	MVKCommandUse _mtlComputeEncoderUse;
+	bool _isMTLComputeEncoderConcurrent = false;
+	MTLOrigin _mtlDispatchBase;
+	uint32_t _mtlDispatchBaseBufferIndex;
+	bool _isMTLDispatchBaseSet = false;
 	id<MTLBlitCommandEncoder> _mtlBlitEncoder;
     MVKCommandUse _mtlBlitEncoderUse;
 	MVKPushConstantsCommandEncoderState _vertexPushConstants;
@@ -463,7 +927,36 @@ protected:
 	MVKPushConstantsCommandEncoderState _fragmentPushConstants;
 	MVKPushConstantsCommandEncoderState _computePushConstants;
     MVKOcclusionQueryCommandEncoderState _occlusionQueryState;
+	MVKMTLBufferRingSuballocator _transientMTLBufferSuballocator;
+	std::vector<MVKTransferAccess> _transferAccesses;
+	MVKVectorInline<std::pair<MVKEvent*, bool>, 4> _pendingEventSignals;
+	MVKVectorInline<std::pair<MVKEvent*, bool>, 4> _mtlCmdBufferEventStatus;
+	struct {
+		id<MTLBuffer> srcMTLBuffer = nil;
+		id<MTLBuffer> dstMTLBuffer = nil;
+		NSUInteger srcOffset = 0;
+		NSUInteger dstOffset = 0;
+		NSUInteger size = 0;
+		MVKCommandUse cmdUse = kMVKCommandUseNone;
+	} _pendingBlitCopyBuffer;
+	const MVKMTLBufferAllocation* _tessScratchBuffers[kMVKTessScratchCount] = {};
+	MVKFlatHashMap<MVKConvertedIndexBufferKey, std::pair<id<MTLBuffer>, NSUInteger>> _convertedIndexBuffers;
     uint32_t _flushCount = 0;
+	MVKQueueCommandBufferSubmission* _cmdBuffSubmit = nullptr;
+	uint64_t _partialCommitStartTime = 0;
+	uint32_t _partialCommitCommandCount = 0;
+	id<MTLFence> _mtlEncoderHazardFence = nil;
+	uint32_t _hazardEpoch = 0;
+	uint32_t _hazardEpochEncoderCount = 0;
+	uint32_t _hazardPriorEpochEncoderCount = 0;
+	uint32_t _lastHazardFenceIndex = 0;
+	uint32_t _lastHazardFenceEpoch = 0;
+	uint32_t _renderPassHazardFenceIndex = 0;
+	uint32_t _renderPassHazardFenceEpoch = 0;
+	bool _isHazardTrackingEnabled = false;
+	bool _hazardWaitsForBoundary = false;
+	bool _hazardChainsToLastEncoder = false;
+	bool _hasRenderPassHazardFence = false;
 	bool _isRenderingEntireAttachment;
 };
 
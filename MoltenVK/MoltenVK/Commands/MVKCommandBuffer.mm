@@ -58,15 +58,28 @@ void MVKCommandBuffer::releaseCommands() {
 	MVKCommand* cmd = _head;
 	while (cmd) {
 		MVKCommand* nextCmd = cmd->_next;	// Establish next before returning current to pool.
-		(cmd->getTypePool(getCommandPool()))->returnObject(cmd);
+		releaseCommand(cmd);
 		cmd = nextCmd;
 	}
 	_head = nullptr;
 	_tail = nullptr;
+
+	// All commands in the arena have been destroyed, so it can be rewound in one step.
+	_commandArena.reset();
+}
+
+// Arena commands are destroyed in place. Their memory is reclaimed when the arena is reset.
+void MVKCommandBuffer::releaseCommand(MVKCommand* command) {
+	if (_usesCommandArena) {
+		command->~MVKCommand();
+	} else {
+		(command->getTypePool(getCommandPool()))->returnObject(command);
+	}
 }
 
 VkResult MVKCommandBuffer::reset(VkCommandBufferResetFlags flags) {
 	clearPrefilledMTLCommandBuffer();
+	clearIndirectDrawRuns();
 	releaseCommands();
 	_doesContinueRenderPass = false;
 	_canAcceptCommands = false;
@@ -79,7 +92,7 @@ VkResult MVKCommandBuffer::reset(VkCommandBufferResetFlags flags) {
 	setConfigurationResult(VK_NOT_READY);
 
 	if (mvkAreAllFlagsEnabled(flags, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT)) {
-		// TODO: what are we releasing or returning here?
+		_commandArena.trim();
 	}
 
 	return VK_SUCCESS;
@@ -87,6 +100,8 @@ VkResult MVKCommandBuffer::reset(VkCommandBufferResetFlags flags) {
 
 VkResult MVKCommandBuffer::end() {
 	_canAcceptCommands = false;
+	if ( !_isSecondary && _device->shouldInferLoadStoreActions() ) { inferLoadStoreActions(); }
+	if (canPreencodeIndirectDraws()) { preencodeIndirectDraws(); }
 	prefill();
 	return getConfigurationResult();
 }
@@ -94,6 +109,7 @@ VkResult MVKCommandBuffer::end() {
 void MVKCommandBuffer::addCommand(MVKCommand* command) {
 	if ( !_canAcceptCommands ) {
 		setConfigurationResult(reportError(VK_NOT_READY, "Command buffer cannot accept commands before vkBeginCommandBuffer() is called."));
+		discardCommand(command);
 		return;
 	}
 
@@ -104,15 +120,52 @@ void MVKCommandBuffer::addCommand(MVKCommand* command) {
     _commandCount++;
 }
 
+void MVKCommandBuffer::discardCommand(MVKCommand* command) { releaseCommand(command); }
+
+// Render passes begin and end only in primary command buffers, and the commands of secondary
+// command buffers executed outside a render pass are treated as possibly reading any image.
+void MVKCommandBuffer::inferLoadStoreActions() {
+	MVKLoadStoreActionInference inference;
+	for (MVKCommand* cmd = _head; cmd; cmd = cmd->_next) {
+		if ( !cmd->inferLoadStoreActions(inference) ) { inference.recordCommand(cmd->getCategory()); }
+	}
+}
+
 void MVKCommandBuffer::submit(MVKQueueCommandBufferSubmission* cmdBuffSubmit) {
 	if ( !canExecute() ) { return; }
 
 	if (_prefilledMTLCmdBuffer) {
-		cmdBuffSubmit->setActiveMTLCommandBuffer(_prefilledMTLCmdBuffer);
-		clearPrefilledMTLCommandBuffer();
+		id<MTLCommandBuffer> mtlCmdBuff = takePrefilledMTLCommandBuffer();
+		cmdBuffSubmit->setActiveMTLCommandBuffer(mtlCmdBuff);
+		[mtlCmdBuff release];
 	} else {
 		MVKCommandEncoder encoder(this);
-		encoder.encode(cmdBuffSubmit->getActiveMTLCommandBuffer());
+		encoder.encode(cmdBuffSubmit->getActiveMTLCommandBuffer(), cmdBuffSubmit);
+	}
+
+	if ( !_supportsConcurrentExecution ) { _isExecutingNonConcurrently.clear(); }
+}
+
+id<MTLCommandBuffer> MVKCommandBuffer::prepareSubmitted(MVKQueue* mvkQueue, bool& needsEncoding) {
+	needsEncoding = false;
+	if ( !canExecute() ) { return nil; }
+
+	id<MTLCommandBuffer> mtlCmdBuff;
+	if (_prefilledMTLCmdBuffer) {
+		mtlCmdBuff = takePrefilledMTLCommandBuffer();			// retained
+		if ( !_supportsConcurrentExecution ) { _isExecutingNonConcurrently.clear(); }
+	} else {
+		mtlCmdBuff = [mvkQueue->getMTLCommandBuffer() retain];	// retained
+		needsEncoding = true;
+	}
+	return mtlCmdBuff;
+}
+
+// Wrap in autorelease pool to capture autoreleased Metal encoding activity on worker threads.
+void MVKCommandBuffer::encodeSubmitted(id<MTLCommandBuffer> mtlCmdBuff) {
+	@autoreleasepool {
+		MVKCommandEncoder encoder(this);
+		encoder.encode(mtlCmdBuff);
 	}
 
 	if ( !_supportsConcurrentExecution ) { _isExecutingNonConcurrently.clear(); }
@@ -163,6 +216,81 @@ bool MVKCommandBuffer::canPrefill() {
 	return wantPrefill && !(_isSecondary || _supportsConcurrentExecution);
 }
 
+bool MVKCommandBuffer::canReplayIndirectDraws() {
+	return ((_isReusable && !_supportsConcurrentExecution && _device->shouldReplayReusableCommandBuffers()) ||
+			canPreencodeIndirectDraws());
+}
+
+bool MVKCommandBuffer::canPreencodeIndirectDraws() {
+	return _isSecondary && !_supportsConcurrentExecution && _device->shouldPreencodeSecondaryCommandBuffers();
+}
+
+// Encodes the runs of draw commands into MTLIndirectCommandBuffers on the recording thread, so that
+// executing this secondary command buffer within a primary command buffer executes each run with
+// a single Metal command. Secondary command buffers inherit no pipeline or index buffer state, so
+// the state each run is encoded with is gathered from the commands that precede it. Runs whose
+// primitive type is not known until encoding, because the topology is dynamic, are left to the encoder.
+void MVKCommandBuffer::preencodeIndirectDraws() {
+	MVKIndirectDrawRunState state;
+	MVKCommand* cmd = _head;
+	while (cmd) {
+		MVKGraphicsPipeline* pipeline = state.pipeline;
+		if (pipeline && !pipeline->supportsDynamicState(kMVKDynamicStatePrimitiveTopology) && cmd->canEncodeIndirectly(pipeline)) {
+			state.mtlPrimitiveType = pipeline->getMTLPrimitiveType();
+			cmd = getIndirectDrawRun(cmd, state).nextCommand;
+		} else {
+			cmd->gatherIndirectDrawRunState(state);
+			cmd = cmd->_next;
+		}
+	}
+}
+
+// Returns the run of draw commands that begins with the specified command, encoding the run into
+// a MTLIndirectCommandBuffer, using the specified state, the first time the run is requested.
+MVKIndirectDrawRun& MVKCommandBuffer::getIndirectDrawRun(MVKCommand* firstCmd, const MVKIndirectDrawRunState& state) {
+	auto iter = _indirectDrawRuns.find(firstCmd);
+	if (iter != _indirectDrawRuns.end()) { return iter->second; }
+
+	MVKIndirectDrawRun& run = _indirectDrawRuns[firstCmd];
+
+	MVKCommand* cmd = firstCmd;
+	while (cmd && cmd->canEncodeIndirectly(state.pipeline)) {
+		run.drawCount++;
+		cmd = cmd->_next;
+	}
+	run.nextCommand = cmd;
+
+	if (run.drawCount < kMVKIndirectDrawRunMinDrawCount) { return run; }
+
+	MTLIndirectCommandBufferDescriptor* icbDesc = [MTLIndirectCommandBufferDescriptor new];	// temp retain
+	icbDesc.commandTypes = MTLIndirectCommandTypeDraw | MTLIndirectCommandTypeDrawIndexed;
+	icbDesc.inheritPipelineState = YES;
+	icbDesc.inheritBuffers = YES;
+	run.mtlIndirectCommandBuffer = [getMTLDevice() newIndirectCommandBufferWithDescriptor: icbDesc
+																		 maxCommandCount: run.drawCount
+																				 options: 0];	// retained
+	[icbDesc release];	// temp release
+
+	NSUInteger cmdIdx = 0;
+	for (cmd = firstCmd; cmd != run.nextCommand; cmd = cmd->_next) {
+		cmd->encodeIndirectly(state, [run.mtlIndirectCommandBuffer indirectRenderCommandAtIndex: cmdIdx++]);
+	}
+	run.mtlIndexBuffer = state.indexBuffer.mtlBuffer;	// not retained
+
+	return run;
+}
+
+void MVKCommandBuffer::clearIndirectDrawRuns() {
+	for (auto& runPair : _indirectDrawRuns) { [runPair.second.mtlIndirectCommandBuffer release]; }
+	_indirectDrawRuns.clear();
+
+	for (auto& icbPair : _multiDrawIndirectCommandBuffers) {
+		[icbPair.second.mtlIndirectCommandBuffer release];
+		[icbPair.second.mtlArgumentBuffer release];
+	}
+	_multiDrawIndirectCommandBuffers.clear();
+}
+
 void MVKCommandBuffer::clearPrefilledMTLCommandBuffer() {
 
 	// Metal command buffers do not return to their pool on release, nor do they support the
@@ -179,6 +307,14 @@ void MVKCommandBuffer::clearPrefilledMTLCommandBuffer() {
 	_prefilledMTLCmdBuffer = nil;
 }
 
+// Hands the retained prefilled MTLCommandBuffer over to the caller, without committing it,
+// so the queue submission can enqueue and commit it in submission order.
+id<MTLCommandBuffer> MVKCommandBuffer::takePrefilledMTLCommandBuffer() {
+	id<MTLCommandBuffer> mtlCmdBuff = _prefilledMTLCmdBuffer;
+	_prefilledMTLCmdBuffer = nil;
+	return mtlCmdBuff;
+}
+
 #pragma mark Construction
 
 // Initializes this instance after it has been created or retrieved from a pool.
@@ -197,10 +333,23 @@ MVKCommandBuffer::~MVKCommandBuffer() {
 #pragma mark -
 #pragma mark Tessellation constituent command management
 
-void MVKCommandBuffer::recordBeginRenderPass(MVKLoadStoreOverrideMixin* mvkBeginRenderPass) {
+void MVKCommandBuffer::recordBeginRenderPass(MVKLoadStoreOverrideMixin* mvkBeginRenderPass, MVKRenderPass* renderPass) {
 	_lastBeginRenderPass = mvkBeginRenderPass;
 	_lastTessellationPipeline = nullptr;
 	_lastTessellationDraw = nullptr;
+	_lastRenderPass = renderPass;
+	_lastSubpassIndex = 0;
+	_lastMetalRenderPassBegin = mvkBeginRenderPass;
+}
+
+// A subpass that was merged with the previous subpass continues the Metal render pass of that subpass.
+void MVKCommandBuffer::recordNextSubpass(MVKLoadStoreOverrideMixin* mvkNextSubpass) {
+	if ( !_lastRenderPass ) { return; }
+
+	_lastSubpassIndex++;
+	if ( !_lastRenderPass->getSubpass(_lastSubpassIndex)->continuesPreviousMetalRenderPass() ) {
+		_lastMetalRenderPassBegin = mvkNextSubpass;
+	}
 }
 
 void MVKCommandBuffer::recordEndRenderPass() {
@@ -213,6 +362,21 @@ void MVKCommandBuffer::recordEndRenderPass() {
 	_lastBeginRenderPass = nullptr;
 	_lastTessellationPipeline = nullptr;
 	_lastTessellationDraw = nullptr;
+	_lastRenderPass = nullptr;
+	_lastMetalRenderPassBegin = nullptr;
+}
+
+// The restarted Metal render pass uses the store actions of the subpass, unless it is itself restarted later.
+// A tessellated draw recorded earlier is no longer the last restart, so must keep storing when the render pass ends.
+void MVKCommandBuffer::recordMetalRenderPassRestart(MVKLoadStoreOverrideMixin* mvkCmd) {
+	if ( !_lastMetalRenderPassBegin ) { return; }
+
+	_lastMetalRenderPassBegin->setStoreOverride(true);
+	_lastTessellationDraw = nullptr;
+
+	mvkCmd->setLoadOverride(true);
+	mvkCmd->setStoreOverride(false);
+	_lastMetalRenderPassBegin = mvkCmd;
 }
 
 void MVKCommandBuffer::recordBindPipeline(MVKCmdBindPipeline* mvkBindPipeline) {
@@ -222,44 +386,566 @@ void MVKCommandBuffer::recordBindPipeline(MVKCmdBindPipeline* mvkBindPipeline) {
 		_lastTessellationPipeline = nullptr;
 }
 
+// The high-water mark may be updated by simultaneous encodings of this command buffer.
+void MVKCommandBuffer::recordTessellationScratchLength(MVKTessScratchBufferType scratchType, NSUInteger length) {
+	static const char* scratchNames[] = { "vertex output", "tess. control output", "tess. control patch output", "tessellation level" };
+
+	NSUInteger highWaterMark = _tessScratchHighWaterMarks[scratchType].load();
+	while (length > highWaterMark) {
+		if (_tessScratchHighWaterMarks[scratchType].compare_exchange_weak(highWaterMark, length)) {
+			if (getDevice()->_pMVKConfig->debugMode) {
+				MVKLogInfo("Command buffer %p increased the high-water mark of its tessellation %s scratch buffer to %lu bytes.",
+						   this, scratchNames[scratchType], (unsigned long)length);
+			}
+			break;
+		}
+	}
+}
+
+bool MVKCommandBuffer::canEncodeMultiDrawIndirectOnGPU() {
+	return !_isSecondary && !_supportsConcurrentExecution && _device->shouldEncodeMultiDrawIndirectOnGPU();
+}
+
+MVKMultiDrawIndirectCommandBuffer& MVKCommandBuffer::getMultiDrawIndirectCommandBuffer(MVKCommand* drawCmd, uint32_t drawCount) {
+	MVKMultiDrawIndirectCommandBuffer& mdicb = _multiDrawIndirectCommandBuffers[drawCmd];
+	if (mdicb.mtlIndirectCommandBuffer && mdicb.maxDrawCount >= drawCount) { return mdicb; }
+
+	[mdicb.mtlIndirectCommandBuffer release];
+	[mdicb.mtlArgumentBuffer release];
+
+	id<MTLDevice> mtlDev = getMTLDevice();
+	MTLIndirectCommandBufferDescriptor* icbDesc = [MTLIndirectCommandBufferDescriptor new];	// temp retain
+	icbDesc.commandTypes = MTLIndirectCommandTypeDraw | MTLIndirectCommandTypeDrawIndexed;
+	icbDesc.inheritPipelineState = YES;
+	icbDesc.inheritBuffers = YES;
+	mdicb.mtlIndirectCommandBuffer = [mtlDev newIndirectCommandBufferWithDescriptor: icbDesc
+																	 maxCommandCount: drawCount
+																			 options: MTLResourceStorageModePrivate];	// retained
+	[icbDesc release];	// temp release
+	mdicb.maxDrawCount = drawCount;
+
+	// The population shaders reference the MTLIndirectCommandBuffer through an argument buffer.
+	MTLArgumentDescriptor* argDesc = [MTLArgumentDescriptor argumentDescriptor];
+	argDesc.dataType = MTLDataTypeIndirectCommandBuffer;
+	argDesc.index = 0;
+	argDesc.access = MTLArgumentAccessWriteOnly;
+	id<MTLArgumentEncoder> mtlArgEncoder = [mtlDev newArgumentEncoderWithArguments: @[argDesc]];	// temp retain
+	mdicb.mtlArgumentBuffer = [mtlDev newBufferWithLength: mtlArgEncoder.encodedLength
+												  options: MTLResourceStorageModeShared];	// retained
+	[mtlArgEncoder setArgumentBuffer: mdicb.mtlArgumentBuffer offset: 0];
+	[mtlArgEncoder setIndirectCommandBuffer: mdicb.mtlIndirectCommandBuffer atIndex: 0];
+	[mtlArgEncoder release];	// temp release
+
+	return mdicb;
+}
+
 void MVKCommandBuffer::recordDraw(MVKLoadStoreOverrideMixin* mvkDraw) {
 	if (_lastTessellationPipeline != nullptr) {
 		// If a multi-pass pipeline is bound and we've already drawn something, need to override load actions
 		mvkDraw->setLoadOverride(true);
 		mvkDraw->setStoreOverride(true);
 		_lastTessellationDraw = mvkDraw;
+
+		// The draw also ends the Metal render pass that is active when it is encoded
+		if (_lastMetalRenderPassBegin) {
+			_lastMetalRenderPassBegin->setStoreOverride(true);
+			_lastMetalRenderPassBegin = mvkDraw;
+		}
 	}
 }
 
 
+#pragma mark -
+#pragma mark MVKLoadStoreActionInference
+
+void MVKLoadStoreActionInference::beginRenderPass(MVKRenderPass* renderPass,
+												  MVKFramebuffer* framebuffer,
+												  const VkRect2D& renderArea,
+												  MVKInferredLoadStoreActions& inferredLoadStores) {
+	uint32_t attCnt = renderPass->getAttachmentCount();
+	for (uint32_t attIdx = 0; attIdx < attCnt; attIdx++) {
+		MVKRenderPassAttachment* mvkRPAtt = renderPass->getAttachment(attIdx);
+		MVKImageView* imgView = framebuffer->getAttachment(attIdx);
+		if (mvkRPAtt->hasUndefinedInitialContents()) { inferredLoadStores.setLoadDontCare(attIdx); }
+		if ( !_prevRenderPass ) { continue; }
+
+		// Compare to the attachments of the previous render pass that use the same image subresources.
+		bool replacesContents = mvkRPAtt->replacesContents() && isRenderingEntireImageView(imgView, framebuffer, renderArea);
+		uint32_t prevAttCnt = _prevRenderPass->getAttachmentCount();
+		for (uint32_t prevAttIdx = 0; prevAttIdx < prevAttCnt; prevAttIdx++) {
+			MVKImageView* prevImgView = _prevFramebuffer->getAttachment(prevAttIdx);
+			if ( !areSameImageSubresources(imgView, prevImgView) ) { continue; }
+
+			if (replacesContents) {
+				_pPrevInferredLoadStores->setStoreDontCare(prevAttIdx);
+			} else if (_prevRenderPass->getAttachment(prevAttIdx)->discardsContents() &&
+					   isRenderingEntireImageView(prevImgView, _prevFramebuffer, _prevRenderArea)) {
+				inferredLoadStores.setLoadDontCare(attIdx);
+			}
+		}
+	}
+
+	_prevRenderPass = renderPass;
+	_prevFramebuffer = framebuffer;
+	_prevRenderArea = renderArea;
+	_pPrevInferredLoadStores = &inferredLoadStores;
+	_isInRenderPass = true;
+}
+
+// Commands within a render pass can only access its attachments through the render pass itself.
+// Between render passes, only commands that cannot read the contents of an image allow the
+// attachment contents of the previous render pass to be compared with the next render pass.
+void MVKLoadStoreActionInference::recordCommand(MVKCommandCategory cmdCategory) {
+	if (_isInRenderPass) { return; }
+
+	switch (cmdCategory) {
+		case kMVKCommandCategoryState:
+		case kMVKCommandCategorySynchronization:
+		case kMVKCommandCategoryBindPipeline:
+		case kMVKCommandCategoryBindDescriptors:
+		case kMVKCommandCategoryQuery:
+		case kMVKCommandCategoryDebugMarker:
+			break;
+		default:
+			_prevRenderPass = nullptr;
+			break;
+	}
+}
+
+// The framebuffer may be smaller than the image view, in which case part of the image view is not rendered.
+bool MVKLoadStoreActionInference::isRenderingEntireImageView(MVKImageView* imageView,
+															 MVKFramebuffer* framebuffer,
+															 const VkRect2D& renderArea) {
+	VkExtent2D fbExtent = framebuffer->getExtent2D();
+	if ( !(mvkVkOffset2DsAreEqual(renderArea.offset, {0,0}) && mvkVkExtent2DsAreEqual(renderArea.extent, fbExtent)) ) { return false; }
+
+	const VkImageSubresourceRange& srRange = imageView->getSubresourceRange();
+	VkExtent3D mipExtent = imageView->getImage()->getExtent3D(srRange.baseMipLevel);
+	return (mipExtent.width == fbExtent.width && mipExtent.height == fbExtent.height &&
+			srRange.layerCount <= framebuffer->getLayerCount());
+}
+
+bool MVKLoadStoreActionInference::areSameImageSubresources(MVKImageView* imageView1, MVKImageView* imageView2) {
+	if (imageView1 == imageView2) { return true; }
+	if (imageView1->getImage() != imageView2->getImage()) { return false; }
+
+	const VkImageSubresourceRange& srRange1 = imageView1->getSubresourceRange();
+	const VkImageSubresourceRange& srRange2 = imageView2->getSubresourceRange();
+	return (srRange1.baseMipLevel == srRange2.baseMipLevel &&
+			srRange1.baseArrayLayer == srRange2.baseArrayLayer &&
+			srRange1.layerCount == srRange2.layerCount &&
+			srRange1.aspectMask == srRange2.aspectMask);
+}
+
+
+#pragma mark -
+#pragma mark MVKIndirectDrawConversionBatch
+
+void MVKIndirectDrawConversionBatch::addDraws(MVKCommand* drawCmd,
+											  bool isIndexed,
+											  id<MTLBuffer> mtlIndirectBuffer,
+											  VkDeviceSize offset,
+											  uint32_t stride,
+											  uint32_t drawCount,
+											  id<MTLBuffer> mtlCountBuffer,
+											  VkDeviceSize countOffset) {
+	if ( !(pipeline && drawCount) ) { return; }
+
+	if ( !pipeline->isTessellationPipeline() ) {
+		addMultiDraws(drawCmd, isIndexed, mtlIndirectBuffer, offset, stride, drawCount, mtlCountBuffer, countOffset);
+		return;
+	}
+
+	// Tessellated draws whose count is read from a buffer must convert their own arguments.
+	if (mtlCountBuffer) { return; }
+
+	// Conversions of draws that read from the same MTLBuffer share a dispatch,
+	// as long as their offsets can be expressed relative to the start of the group.
+	VkDeviceSize lastOffset = offset + VkDeviceSize(drawCount - 1) * stride;
+	ConversionGroup* pGroup = nullptr;
+	for (auto& group : _groups) {
+		if (group.srcMTLBuffer == mtlIndirectBuffer && group.srcOffset <= offset &&
+			(lastOffset - group.srcOffset) <= std::numeric_limits<uint32_t>::max()) {
+			pGroup = &group;
+			break;
+		}
+	}
+	if ( !pGroup ) {
+		_groups.push_back({mtlIndirectBuffer, offset, {}});
+		pGroup = &_groups.back();
+	}
+
+	_drawCommands[drawCmd] = {pipeline, _drawCount};
+	_convertedArgumentsSize = getConvertedArgumentsSize(pipeline->getDevice()->_pMetalFeatures);
+
+	uint32_t inControlPointCount = pipeline->getInputControlPointCount();
+	uint32_t outControlPointCount = pipeline->getOutputControlPointCount();
+	for (uint32_t drawIdx = 0; drawIdx < drawCount; drawIdx++) {
+		MVKIndirectDrawConversion conv;
+		conv.srcOffset = uint32_t(offset + VkDeviceSize(drawIdx) * stride - pGroup->srcOffset);
+		conv.destOffset = uint32_t(_drawCount++ * _convertedArgumentsSize);
+		conv.inControlPointCount = inControlPointCount;
+		conv.outControlPointCount = outControlPointCount;
+		pGroup->conversions.push_back(conv);
+	}
+}
+
+// Non-tessellated commands with a single draw are encoded directly, as a single Metal indirect draw.
+void MVKIndirectDrawConversionBatch::addMultiDraws(MVKCommand* drawCmd,
+												   bool isIndexed,
+												   id<MTLBuffer> mtlIndirectBuffer,
+												   VkDeviceSize offset,
+												   uint32_t stride,
+												   uint32_t drawCount,
+												   id<MTLBuffer> mtlCountBuffer,
+												   VkDeviceSize countOffset) {
+	if ( !(drawCount > 1 || mtlCountBuffer) ) { return; }
+	if ( !(_cmdEncoder->_cmdBuffer->canEncodeMultiDrawIndirectOnGPU() && pipeline->hasValidMTLPipelineStates()) ) { return; }
+	if (pipeline->supportsDynamicState(kMVKDynamicStatePrimitiveTopology)) { return; }	// Primitive type not yet known
+	if (isIndexed && !indexBuffer.mtlBuffer) { return; }
+
+	MultiDrawInfo mdInfo;
+	mdInfo.drawCmd = drawCmd;
+	mdInfo.pipeline = pipeline;
+	if (isIndexed) { mdInfo.indexBuffer = indexBuffer; }
+	mdInfo.srcMTLBuffer = mtlIndirectBuffer;
+	mdInfo.srcOffset = offset;
+	mdInfo.countMTLBuffer = mtlCountBuffer;
+	mdInfo.countOffset = countOffset;
+	mdInfo.info.srcStride = stride;
+	mdInfo.info.maxDrawCount = drawCount;
+	mdInfo.info.primitiveType = pipeline->getMTLPrimitiveType();
+	mdInfo.info.hasCountBuffer = mtlCountBuffer ? 1 : 0;
+	mdInfo.mtlIndirectCommandBuffer = nil;
+	_multiDraws.push_back(mdInfo);
+}
+
+bool MVKIndirectDrawConversionBatch::getConvertedArguments(MVKCommand* drawCmd,
+														   MVKGraphicsPipeline* drawPipeline,
+														   id<MTLBuffer>& mtlBuffer,
+														   VkDeviceSize& offset) {
+	if ( !_destBuffer ) { return false; }
+
+	auto iter = _drawCommands.find(drawCmd);
+	if (iter == _drawCommands.end() || iter->second.pipeline != drawPipeline) { return false; }
+
+	mtlBuffer = _destBuffer->_mtlBuffer;
+	offset = _destBuffer->_offset + iter->second.firstDrawIndex * _convertedArgumentsSize;
+	return true;
+}
+
+bool MVKIndirectDrawConversionBatch::encodeMultiDraws(MVKCommand* drawCmd, MVKCommandEncoder* cmdEncoder) {
+	auto* currPipeline = (MVKGraphicsPipeline*)cmdEncoder->_graphicsPipelineState.getPipeline();
+	MVKIndexMTLBufferBinding& ibb = cmdEncoder->_graphicsResourcesState._mtlIndexBufferBinding;
+	for (auto& mdInfo : _multiDraws) {
+		if (mdInfo.drawCmd != drawCmd) { continue; }
+
+		// The draws were encoded with the pipeline primitive type and index buffer
+		// that were expected to be bound, which must match those that are bound.
+		if ( !mdInfo.mtlIndirectCommandBuffer || mdInfo.pipeline != currPipeline ) { return false; }
+		if (mdInfo.indexBuffer.mtlBuffer && (mdInfo.indexBuffer.mtlBuffer != ibb.mtlBuffer ||
+											 mdInfo.indexBuffer.offset != ibb.offset ||
+											 mdInfo.indexBuffer.mtlIndexType != ibb.mtlIndexType)) { return false; }
+
+		cmdEncoder->_depthStencilState.markDirty();
+		cmdEncoder->finalizeDrawState(kMVKGraphicsStageRasterization);	// Ensure all updated state has been submitted to Metal
+
+		if ( !currPipeline->hasValidMTLPipelineStates() ) { return true; }	// Abort if this pipeline stage could not be compiled.
+
+		if (mdInfo.indexBuffer.mtlBuffer) {
+			[cmdEncoder->_mtlRenderEncoder useResource: mdInfo.indexBuffer.mtlBuffer usage: MTLResourceUsageRead];
+		}
+		[cmdEncoder->_mtlRenderEncoder executeCommandsInBuffer: mdInfo.mtlIndirectCommandBuffer
+													 withRange: NSMakeRange(0, mdInfo.info.maxDrawCount)];
+		return true;
+	}
+	return false;
+}
+
+void MVKIndirectDrawConversionBatch::encode(MVKCommandEncoder* cmdEncoder) {
+	encodeMultiDrawPopulation(cmdEncoder);
+
+	if ( !_drawCount ) { return; }
+
+	_destBuffer = cmdEncoder->getTempMTLBuffer(_drawCount * _convertedArgumentsSize);
+
+	id<MTLComputeCommandEncoder> mtlConvertEncoder = cmdEncoder->getMTLComputeEncoder(kMVKCommandUseTessellationControl);
+	id<MTLComputePipelineState> mtlConvertState = cmdEncoder->getCommandEncodingPool()->getCmdDrawIndirectConvertBatchedBuffersMTLComputePipelineState();
+	[mtlConvertEncoder setComputePipelineState: mtlConvertState];
+	[mtlConvertEncoder setBuffer: _destBuffer->_mtlBuffer
+						  offset: _destBuffer->_offset
+						 atIndex: 1];
+	for (auto& group : _groups) {
+		uint32_t convCount = uint32_t(group.conversions.size());
+		[mtlConvertEncoder setBuffer: group.srcMTLBuffer
+							  offset: group.srcOffset
+							 atIndex: 0];
+		cmdEncoder->setComputeBytes(mtlConvertEncoder,
+									group.conversions.data(),
+									convCount * sizeof(MVKIndirectDrawConversion),
+									2);
+		cmdEncoder->setComputeBytes(mtlConvertEncoder,
+									&convCount,
+									sizeof(convCount),
+									3);
+		[mtlConvertEncoder dispatchThreadgroups: MTLSizeMake(mvkCeilingDivide<NSUInteger>(convCount, mtlConvertState.threadExecutionWidth), 1, 1)
+						  threadsPerThreadgroup: MTLSizeMake(mtlConvertState.threadExecutionWidth, 1, 1)];
+	}
+}
+
+// Populates each MTLIndirectCommandBuffer from the Vulkan indirect buffer of its multi-draw command.
+// Draws beyond the count read from a count buffer are reset, so they are skipped when executed.
+void MVKIndirectDrawConversionBatch::encodeMultiDrawPopulation(MVKCommandEncoder* cmdEncoder) {
+	if (_multiDraws.empty()) { return; }
+
+	id<MTLComputeCommandEncoder> mtlPopulateEncoder = cmdEncoder->getMTLComputeEncoder(kMVKCommandUseBeginRenderPass);
+	for (auto& mdInfo : _multiDraws) {
+		bool isIndexed = (mdInfo.indexBuffer.mtlBuffer != nil);
+		MTLIndexType mtlIdxType = (MTLIndexType)mdInfo.indexBuffer.mtlIndexType;
+		MVKMultiDrawIndirectCommandBuffer& mdicb = cmdEncoder->_cmdBuffer->getMultiDrawIndirectCommandBuffer(mdInfo.drawCmd, mdInfo.info.maxDrawCount);
+		if ( !mdicb.mtlIndirectCommandBuffer ) { continue; }
+		mdInfo.mtlIndirectCommandBuffer = mdicb.mtlIndirectCommandBuffer;
+
+		id<MTLComputePipelineState> mtlPopulateState = cmdEncoder->getCommandEncodingPool()->getCmdDrawIndirectPopulateICBMTLComputePipelineState(isIndexed, mtlIdxType);
+		[mtlPopulateEncoder setComputePipelineState: mtlPopulateState];
+		[mtlPopulateEncoder useResource: mdicb.mtlIndirectCommandBuffer usage: MTLResourceUsageWrite];
+		[mtlPopulateEncoder setBuffer: mdInfo.srcMTLBuffer
+							   offset: mdInfo.srcOffset
+							  atIndex: 0];
+		[mtlPopulateEncoder setBuffer: mdicb.mtlArgumentBuffer
+							   offset: 0
+							  atIndex: 1];
+		cmdEncoder->setComputeBytes(mtlPopulateEncoder,
+									&mdInfo.info,
+									sizeof(mdInfo.info),
+									2);
+		// The count buffer is only read if there is one, but a buffer must be bound regardless.
+		[mtlPopulateEncoder setBuffer: mdInfo.countMTLBuffer ? mdInfo.countMTLBuffer : mdInfo.srcMTLBuffer
+							   offset: mdInfo.countMTLBuffer ? mdInfo.countOffset : mdInfo.srcOffset
+							  atIndex: 3];
+		if (isIndexed) {
+			[mtlPopulateEncoder setBuffer: mdInfo.indexBuffer.mtlBuffer
+								   offset: mdInfo.indexBuffer.offset
+								  atIndex: 4];
+		}
+		[mtlPopulateEncoder dispatchThreadgroups: MTLSizeMake(mvkCeilingDivide<NSUInteger>(mdInfo.info.maxDrawCount, mtlPopulateState.threadExecutionWidth), 1, 1)
+						   threadsPerThreadgroup: MTLSizeMake(mtlPopulateState.threadExecutionWidth, 1, 1)];
+	}
+}
+
+void MVKIndirectDrawConversionBatch::reset(MVKCommandEncoder* cmdEncoder) {
+	_cmdEncoder = cmdEncoder;
+	pipeline = (MVKGraphicsPipeline*)cmdEncoder->_graphicsPipelineState.getPipeline();
+	indexBuffer = cmdEncoder->_graphicsResourcesState._mtlIndexBufferBinding;
+	_groups.clear();
+	_drawCommands.clear();
+	_multiDraws.clear();
+	_destBuffer = nullptr;
+	_drawCount = 0;
+}
+
+NSUInteger MVKIndirectDrawConversionBatch::getConvertedArgumentsSize(const MVKPhysicalDeviceMetalFeatures* pMetalFeatures) {
+	NSUInteger size = sizeof(MTLDispatchThreadgroupsIndirectArguments) + sizeof(MTLDrawPatchIndirectArguments);
+	if (pMetalFeatures->mslVersion >= 20100) { size += sizeof(MTLStageInRegionIndirectArguments); }
+	return size;
+}
+
+
 #pragma mark -
 #pragma mark MVKCommandEncoder
 
-void MVKCommandEncoder::encode(id<MTLCommandBuffer> mtlCmdBuff) {
+void MVKCommandEncoder::encode(id<MTLCommandBuffer> mtlCmdBuff, MVKQueueCommandBufferSubmission* cmdBuffSubmit) {
 	_subpassContents = VK_SUBPASS_CONTENTS_INLINE;
 	_renderSubpassIndex = 0;
 	_isUsingLayeredRendering = false;
 
 	_mtlCmdBuffer = mtlCmdBuff;		// not retained
 
+	bool canCommitEarly = _device->getEarlyCommitCommandCount() || _device->getEarlyCommitInterval();
+	_cmdBuffSubmit = canCommitEarly ? cmdBuffSubmit : nullptr;
+	_partialCommitStartTime = canCommitEarly ? mvkGetTimestamp() : 0;
+	_partialCommitCommandCount = 0;
+
+	_boundDescriptorSetsLayout = nullptr;
+	_boundDescriptorSets.clear();
+	_pendingEventSignals.clear();
+	_mtlCmdBufferEventStatus.clear();
+	_convertedIndexBuffers.clear();
+
+	_isHazardTrackingEnabled = _device->shouldUseFenceHazardTracking();
+	_mtlEncoderHazardFence = nil;
+	_hazardEpoch = 0;
+	_hazardEpochEncoderCount = 0;
+	_hazardPriorEpochEncoderCount = 0;
+	_hazardWaitsForBoundary = false;
+	_hazardChainsToLastEncoder = false;
+	_hasRenderPassHazardFence = false;
+
 	setLabelIfNotNil(_mtlCmdBuffer, _cmdBuffer->_debugName);
 
-	MVKCommand* cmd = _cmdBuffer->_head;
-	while (cmd) {
-		cmd->encode(this);
-		cmd = cmd->_next;
-	}
+	encodeCommands(_cmdBuffer);
 
 	endCurrentMetalEncoding();
+	encodeHazardTrackingJoin();
 	finishQueries();
+	_transientMTLBufferSuballocator.returnOnCompletion(_mtlCmdBuffer);
 }
 
 void MVKCommandEncoder::encodeSecondary(MVKCommandBuffer* secondaryCmdBuffer) {
-	MVKCommand* cmd = secondaryCmdBuffer->_head;
+	encodeCommands(secondaryCmdBuffer);
+}
+
+// Encodes the commands in the command buffer. If the command buffer permits, runs of draw
+// commands are replayed from MTLIndirectCommandBuffers, instead of being encoded individually.
+// Runs of transfer commands are coalesced to reduce switching between Metal encoders.
+// Commands may consume the commands that follow them, by advancing _nextCommand while encoding.
+void MVKCommandEncoder::encodeCommands(MVKCommandBuffer* cmdBuffer) {
+	MVKCommand* outerNextCmd = _nextCommand;	// Encoding may be nested for secondary command buffers
+	bool canReplay = cmdBuffer->canReplayIndirectDraws();
+	MVKCommand* cmd = cmdBuffer->_head;
 	while (cmd) {
-		cmd->encode(this);
-		cmd = cmd->_next;
+		_hazardChainsToLastEncoder = false;		// Metal encoders of different commands are ordered only by barriers
+		MVKPerformanceTracker* pPerfTracker = getEncodingPerformanceTracker(cmd);
+		uint64_t startTime = pPerfTracker ? _device->getPerformanceTimestamp() : 0;
+		if (canReplay && _mtlRenderEncoder && cmd->canEncodeIndirectly((MVKGraphicsPipeline*)_graphicsPipelineState.getPipeline())) {
+			cmd = encodeIndirectDrawRun(cmdBuffer, cmd);
+		} else if (cmd->getTransferAccesses(this, _transferAccesses)) {
+			cmd = encodeTransferRun(cmd);
+		} else {
+			_nextCommand = cmd->_next;
+			cmd->encode(this);
+			cmd = _nextCommand;
+		}
+		if (pPerfTracker) { _device->addActivityPerformance(*pPerfTracker, startTime); }
+		if (cmd) { commitPartialMTLCommandBufferIfNeeded(); }
+	}
+	_nextCommand = outerNextCmd;
+}
+
+// Returns the performance tracker for the time taken to encode the specified command, or to encode the
+// run of commands that begins with it, or returns null if performance is not being tracked. Commands
+// that execute secondary command buffers are not tracked, because their commands are tracked individually.
+MVKPerformanceTracker* MVKCommandEncoder::getEncodingPerformanceTracker(MVKCommand* cmd) {
+	if ( !_device->_pMVKConfig->performanceTracking ) { return nullptr; }
+
+	auto& perfStats = _device->_performanceStatistics;
+	switch (cmd->getCategory()) {
+		case kMVKCommandCategoryDraw:				return &perfStats.commandEncoding.draw;
+		case kMVKCommandCategoryDispatch:			return &perfStats.commandEncoding.dispatch;
+		case kMVKCommandCategoryTransfer:			return &perfStats.commandEncoding.transfer;
+		case kMVKCommandCategoryRenderPass:			return &perfStats.commandEncoding.renderPass;
+		case kMVKCommandCategorySynchronization:	return &perfStats.commandEncoding.synchronization;
+		case kMVKCommandCategoryBindPipeline:		return &perfStats.commandEncoding.bindPipeline;
+		case kMVKCommandCategoryBindDescriptors:	return &perfStats.descriptors.bindDescriptorSets;
+		case kMVKCommandCategoryQuery:				return &perfStats.commandEncoding.query;
+		case kMVKCommandCategoryDebugMarker:		return &perfStats.commandEncoding.debugMarker;
+		case kMVKCommandCategoryExecuteCommands:	return nullptr;
+		case kMVKCommandCategoryState:
+		default:									return &perfStats.commandEncoding.state;
+	}
+}
+
+// Encodes the run of draw commands that begins with the specified command, and returns the
+// first command after the run. The state established by the MTLRenderCommandEncoder before
+// the first draw in the run is inherited by all draws in the MTLIndirectCommandBuffer.
+MVKCommand* MVKCommandEncoder::encodeIndirectDrawRun(MVKCommandBuffer* cmdBuffer, MVKCommand* firstCmd) {
+	finalizeDrawState(kMVKGraphicsStageRasterization);	// Establishes the primitive type of the draws in the run
+
+	MVKIndirectDrawRunState state;
+	state.pipeline = (MVKGraphicsPipeline*)_graphicsPipelineState.getPipeline();
+	state.indexBuffer = _graphicsResourcesState._mtlIndexBufferBinding;
+	state.mtlPrimitiveType = _mtlPrimitiveType;
+	MVKIndirectDrawRun& run = cmdBuffer->getIndirectDrawRun(firstCmd, state);
+
+	// Runs that are too short to benefit from replay are encoded normally.
+	if ( !run.mtlIndirectCommandBuffer ) {
+		for (MVKCommand* cmd = firstCmd; cmd != run.nextCommand; cmd = cmd->_next) { cmd->encode(this); }
+		return run.nextCommand;
+	}
+
+	_depthStencilState.markDirty();
+	finalizeDrawState(kMVKGraphicsStageRasterization);	// Ensure all updated state has been submitted to Metal
+
+	if (run.mtlIndexBuffer) { [_mtlRenderEncoder useResource: run.mtlIndexBuffer usage: MTLResourceUsageRead]; }
+	[_mtlRenderEncoder executeCommandsInBuffer: run.mtlIndirectCommandBuffer withRange: NSMakeRange(0, run.drawCount)];
+
+	return run.nextCommand;
+}
+
+// Encodes the run of transfer commands that begins with the specified command, whose accesses
+// have already been collected, and returns the first command after the run. If it is safe to do
+// so, all of the BLIT parts of the transfers in the run are encoded before all of the compute
+// parts, so that the run uses at most one Metal encoder of each type.
+MVKCommand* MVKCommandEncoder::encodeTransferRun(MVKCommand* firstCmd) {
+	MVKCommand* endCmd = firstCmd->_next;
+	uint32_t cmdCnt = 1;
+	while (endCmd && cmdCnt < kMVKTransferRunMaxCommandCount && endCmd->getTransferAccesses(this, _transferAccesses)) {
+		endCmd = endCmd->_next;
+		cmdCnt++;
 	}
+
+	if (canGroupTransferAccesses()) {
+		for (MVKCommand* cmd = firstCmd; cmd != endCmd; cmd = cmd->_next) { cmd->encodeTransfer(this, kMVKTransferEncoderTypeBlit); }
+		for (MVKCommand* cmd = firstCmd; cmd != endCmd; cmd = cmd->_next) { cmd->encodeTransfer(this, kMVKTransferEncoderTypeCompute); }
+	} else {
+		for (MVKCommand* cmd = firstCmd; cmd != endCmd; cmd = cmd->_next) { cmd->encode(this); }
+	}
+	encodePendingBlitCopyBuffer();
+
+	_transferAccesses.clear();
+	return endCmd;
+}
+
+// Returns whether the collected transfer accesses need, and can safely accept, being grouped
+// by encoder type. Grouping moves each BLIT access ahead of any compute accesses that precede
+// it, which is only safe if none of those accesses touch the same resource bytes, with at
+// least one of them writing. Runs that are already grouped are encoded in order.
+bool MVKCommandEncoder::canGroupTransferAccesses() {
+	bool needsGrouping = false;
+	size_t accCnt = _transferAccesses.size();
+	for (size_t cIdx = 0; cIdx < accCnt; cIdx++) {
+		auto& cAcc = _transferAccesses[cIdx];
+		if (cAcc.encoderType != kMVKTransferEncoderTypeCompute) { continue; }
+
+		for (size_t bIdx = cIdx + 1; bIdx < accCnt; bIdx++) {
+			auto& bAcc = _transferAccesses[bIdx];
+			if (bAcc.encoderType != kMVKTransferEncoderTypeBlit) { continue; }
+
+			needsGrouping = true;
+			if (bAcc.mtlResource == cAcc.mtlResource &&
+				(bAcc.isWrite || cAcc.isWrite) &&
+				bAcc.offset < cAcc.offset + cAcc.length &&
+				cAcc.offset < bAcc.offset + bAcc.length) { return false; }
+		}
+	}
+	return needsGrouping;
+}
+
+// If the Metal command buffer is being encoded for a queue submission, and enough commands, or enough
+// time, have accumulated since it began, commits it at this point between commands, outside of any
+// render pass, so that the GPU can start executing while the remaining commands are encoded. State
+// that is only valid within a single Metal command buffer is reset for the new Metal command buffer.
+void MVKCommandEncoder::commitPartialMTLCommandBufferIfNeeded() {
+	if ( !_cmdBuffSubmit || _renderPass ) { return; }
+
+	_partialCommitCommandCount++;
+	uint32_t cmdCntLimit = _device->getEarlyCommitCommandCount();
+	uint32_t intervalLimit = _device->getEarlyCommitInterval();
+	bool isDue = ((cmdCntLimit && _partialCommitCommandCount >= cmdCntLimit) ||
+				  (intervalLimit && mvkGetElapsedMilliseconds(_partialCommitStartTime) * 1000.0 >= intervalLimit));
+	if ( !isDue ) { return; }
+
+	endCurrentMetalEncoding();
+	_transientMTLBufferSuballocator.returnOnCompletion(_mtlCmdBuffer);
+	_mtlCmdBufferEventStatus.clear();
+	for (auto& scratchBuff : _tessScratchBuffers) { scratchBuff = nullptr; }
+	_convertedIndexBuffers.clear();
+
+	_mtlCmdBuffer = _cmdBuffSubmit->commitPartialMTLCommandBuffer();	// not retained
+	setLabelIfNotNil(_mtlCmdBuffer, _cmdBuffer->_debugName);
+
+	_partialCommitStartTime = mvkGetTimestamp();
+	_partialCommitCommandCount = 0;
 }
 
 void MVKCommandEncoder::beginRenderpass(VkSubpassContents subpassContents,
@@ -268,18 +954,32 @@ void MVKCommandEncoder::beginRenderpass(VkSubpassContents subpassContents,
 										VkRect2D& renderArea,
 										MVKVector<VkClearValue>* clearValues,
 										bool loadOverride,
-										bool storeOverride) {
+										bool storeOverride,
+										MVKInferredLoadStoreActions* pInferredLoadStores) {
 	_renderPass = renderPass;
 	_framebuffer = framebuffer;
+	_pInferredLoadStores = pInferredLoadStores;
 	_renderArea = renderArea;
 	_isRenderingEntireAttachment = (mvkVkOffset2DsAreEqual(_renderArea.offset, {0,0}) &&
 									mvkVkExtent2DsAreEqual(_renderArea.extent, _framebuffer->getExtent2D()));
 	_clearValues.assign(clearValues->begin(), clearValues->end());
+	_hasRenderPassHazardFence = false;
+	if (_renderPass->hasExternalSubpassDependency(true)) { markHazardBarrier(); }
+	encodeIndirectDrawConversions();
 	setSubpass(subpassContents, 0, loadOverride, storeOverride);
 }
 
-void MVKCommandEncoder::beginNextSubpass(VkSubpassContents contents) {
-	setSubpass(contents, _renderSubpassIndex + 1);
+// Converts the indirect arguments of all of the indirect draws in the render pass that is
+// beginning, before the render pass begins, so the conversions don't each need their own
+// compute dispatch, each of which interrupts the Metal render pass.
+void MVKCommandEncoder::encodeIndirectDrawConversions() {
+	_indirectDrawConversions.reset(this);
+	for (MVKCommand* cmd = _nextCommand; cmd && cmd->gatherIndirectDrawConversions(_indirectDrawConversions); cmd = cmd->_next) {}
+	_indirectDrawConversions.encode(this);
+}
+
+void MVKCommandEncoder::beginNextSubpass(VkSubpassContents contents, bool storeOverride) {
+	setSubpass(contents, _renderSubpassIndex + 1, false, storeOverride);
 }
 
 // Sets the current render subpass to the subpass with the specified index.
@@ -292,16 +992,52 @@ void MVKCommandEncoder::setSubpass(VkSubpassContents subpassContents, uint32_t s
 								(_device->_pMetalFeatures->multisampleLayeredRendering ||
 								 (getSubpass()->getSampleCount() == VK_SAMPLE_COUNT_1_BIT)));
 
+	// If this subpass was merged with the previous subpass, continue rendering in the
+	// current Metal render pass, and make sure the new subpass pipeline will be bound.
+	if (_mtlRenderEncoder && getSubpass()->continuesPreviousMetalRenderPass()) {
+		_graphicsPipelineState.markDirty();
+		return;
+	}
+
+	if ( !loadOverride ) { encodeNextCommandsAsLoadActions(); }
+	if (getSubpass()->isInLastMetalRenderPass()) { encodeCommandsAfterRenderPassAsStoreActions(); }
+
+	// Each subpass after the first depends on the subpasses before it, unless merged with them.
+	if (subpassIndex > 0) { markHazardBarrier(); }
+
 	beginMetalRenderPass(loadOverride, storeOverride);
 }
 
+// Folds any commands that immediately follow the beginning of the subpass, and that can
+// be performed by the load actions of the Metal render pass, into the clear load overrides
+// of that Metal render pass, and skips over them, so they are not encoded separately.
+void MVKCommandEncoder::encodeNextCommandsAsLoadActions() {
+	while (_nextCommand && _nextCommand->encodeAsLoadActions(this, _clearLoadOverrides)) {
+		_nextCommand = _nextCommand->_next;
+	}
+}
+
+// Folds any commands that immediately follow the end of the render pass, and that can be performed
+// by the store actions of the last Metal render pass, which is about to begin, into the resolve
+// store overrides of that Metal render pass. The folded commands are skipped when the render pass ends.
+void MVKCommandEncoder::encodeCommandsAfterRenderPassAsStoreActions() {
+	_resolveStoreOverrides.reset();
+	MVKCommand* cmd = _nextCommand;
+	while (cmd && cmd->getCategory() != kMVKCommandCategoryRenderPass) { cmd = cmd->_next; }
+	if ( !cmd ) { return; }		// The render pass does not end in this command buffer
+
+	for (cmd = cmd->_next; cmd && cmd->encodeAsStoreActions(this, _resolveStoreOverrides); cmd = cmd->_next) {
+		_resolveStoreOverrides.commandCount++;
+	}
+}
+
 // Creates _mtlRenderEncoder and marks cached render state as dirty so it will be set into the _mtlRenderEncoder.
 void MVKCommandEncoder::beginMetalRenderPass(bool loadOverride, bool storeOverride) {
 
     endCurrentMetalEncoding();
 
-    MTLRenderPassDescriptor* mtlRPDesc = [MTLRenderPassDescriptor renderPassDescriptor];
-    getSubpass()->populateMTLRenderPassDescriptor(mtlRPDesc, _framebuffer, _clearValues, _isRenderingEntireAttachment, loadOverride, storeOverride);
+    MTLRenderPassDescriptor* mtlRPDesc = _framebuffer->getMTLRenderPassDescriptor(getSubpass(), _clearValues, _isRenderingEntireAttachment, loadOverride, storeOverride, &_clearLoadOverrides, &_resolveStoreOverrides, _pInferredLoadStores);
+    _clearLoadOverrides.reset();
     mtlRPDesc.visibilityResultBuffer = _occlusionQueryState.getVisibilityResultMTLBuffer();
 
 	// Only set the layered rendering properties if layered rendering is supported and the framebuffer really has multiple layers
@@ -314,8 +1050,10 @@ void MVKCommandEncoder::beginMetalRenderPass(bool loadOverride, bool storeOverri
 
     _mtlRenderEncoder = [_mtlCmdBuffer renderCommandEncoderWithDescriptor: mtlRPDesc];     // not retained
 	setLabelIfNotNil(_mtlRenderEncoder, getMTLRenderCommandEncoderName());
+	beginRenderEncoderHazardTracking(_mtlRenderEncoder, true);
 
-    if ( !_isRenderingEntireAttachment ) { clearRenderArea(); }
+    // A restarted Metal render pass loads the attachment contents, which must not be cleared again.
+    if ( !_isRenderingEntireAttachment && !loadOverride ) { clearRenderArea(); }
 
     _graphicsPipelineState.beginMetalRenderPass();
     _graphicsResourcesState.beginMetalRenderPass();
@@ -323,6 +1061,7 @@ void MVKCommandEncoder::beginMetalRenderPass(bool loadOverride, bool storeOverri
     _scissorState.beginMetalRenderPass();
     _depthBiasState.beginMetalRenderPass();
     _blendColorState.beginMetalRenderPass();
+    _rasterizingState.beginMetalRenderPass();
     _vertexPushConstants.beginMetalRenderPass();
     _tessCtlPushConstants.beginMetalRenderPass();
     _tessEvalPushConstants.beginMetalRenderPass();
@@ -348,6 +1087,21 @@ NSString* MVKCommandEncoder::getMTLRenderCommandEncoderName() {
 	return mvkMTLRenderCommandEncoderLabel(cmdUse);
 }
 
+bool MVKCommandEncoder::isBoundDescriptorSet(MVKPipelineLayout* pipelineLayout, uint32_t set, MVKDescriptorSet* descSet) {
+	return (pipelineLayout == _boundDescriptorSetsLayout &&
+			set < _boundDescriptorSets.size() &&
+			_boundDescriptorSets[set] == descSet);
+}
+
+void MVKCommandEncoder::setBoundDescriptorSet(MVKPipelineLayout* pipelineLayout, uint32_t set, MVKDescriptorSet* descSet) {
+	if (pipelineLayout != _boundDescriptorSetsLayout) {
+		_boundDescriptorSetsLayout = pipelineLayout;
+		_boundDescriptorSets.clear();
+	}
+	if (set >= _boundDescriptorSets.size()) { _boundDescriptorSets.resize(set + 1, nullptr); }
+	_boundDescriptorSets[set] = descSet;
+}
+
 void MVKCommandEncoder::bindPipeline(VkPipelineBindPoint pipelineBindPoint, MVKPipeline* pipeline) {
     switch (pipelineBindPoint) {
         case VK_PIPELINE_BIND_POINT_GRAPHICS:
@@ -356,6 +1110,8 @@ void MVKCommandEncoder::bindPipeline(VkPipelineBindPoint pipelineBindPoint, MVKP
 
         case VK_PIPELINE_BIND_POINT_COMPUTE:
             _computePipelineState.setPipeline(pipeline);
+            _mtlDispatchBase = MTLOriginMake(0, 0, 0);
+            _isMTLDispatchBaseSet = false;		// The new pipeline may read the base from a different place
             break;
 
         default:
@@ -364,8 +1120,177 @@ void MVKCommandEncoder::bindPipeline(VkPipelineBindPoint pipelineBindPoint, MVKP
 }
 
 void MVKCommandEncoder::signalEvent(MVKEvent* mvkEvent, bool status) {
-	endCurrentMetalEncoding();
-	mvkEvent->encodeSignal(_mtlCmdBuffer, status);
+	_pendingEventSignals.emplace_back(mvkEvent, status);
+
+	// Remember the most recent status of each event signaled within this Metal command buffer.
+	for (auto& evtStat : _mtlCmdBufferEventStatus) {
+		if (evtStat.first == mvkEvent) {
+			evtStat.second = status;
+			return;
+		}
+	}
+	_mtlCmdBufferEventStatus.emplace_back(mvkEvent, status);
+}
+
+// Metal executes the work in a command buffer in order, and tracks the hazards between its encoders,
+// so an event set earlier in the same Metal command buffer needs no GPU wait. A Metal event wait can
+// only be encoded between Metal encoders, so other events end the current encoding before waiting.
+// Within a render pass, the Metal render pass is then restarted, loading the attachment contents,
+// which the ended Metal render pass stores because the command was recorded as restarting it.
+void MVKCommandEncoder::waitEvents(MVKVector<MVKEvent*>& mvkEvents, bool storeOverride) {
+	bool wasRendering = (_mtlRenderEncoder != nil);
+	bool isWaiting = false;
+	for (MVKEvent* mvkEvent : mvkEvents) {
+		if (isEventSetInMTLCommandBuffer(mvkEvent)) { continue; }
+		if ( !isWaiting ) { endCurrentMetalEncoding(); }
+		mvkEvent->encodeWait(_mtlCmdBuffer);
+		isWaiting = true;
+	}
+
+	if ( !isWaiting ) {
+		// Concurrent dispatches are not ordered, so the wait must still separate them.
+		id<MTLComputeCommandEncoder> mtlConcEnc = getConcurrentMTLComputeEncoder();
+		if (mtlConcEnc) { [mtlConcEnc memoryBarrierWithScope: MTLBarrierScopeBuffers | MTLBarrierScopeTextures]; }
+	}
+	markHazardBarrier();
+	if (isWaiting && wasRendering) { beginMetalRenderPass(true, storeOverride); }
+}
+
+bool MVKCommandEncoder::isEventSetInMTLCommandBuffer(MVKEvent* mvkEvent) {
+	for (auto& evtStat : _mtlCmdBufferEventStatus) {
+		if (evtStat.first == mvkEvent) { return evtStat.second; }
+	}
+	return false;
+}
+
+// Encodes the event signals that were deferred until the current Metal encoding ended.
+void MVKCommandEncoder::encodePendingEventSignals() {
+	for (auto& evtSig : _pendingEventSignals) {
+		evtSig.first->encodeSignal(_mtlCmdBuffer, evtSig.second);
+	}
+	_pendingEventSignals.clear();
+}
+
+// When app resources are not tracked by Metal, hazards between Metal encoders are tracked using
+// MTLFences, in epochs separated by barriers. Each Metal encoder updates its own fence when it ends,
+// and waits for the fences of the encoders of the previous epoch, which themselves waited for the
+// epoch before them. Encoders of the same epoch run concurrently, unless they belong to the same
+// command or Metal render pass. Fence zero joins the final epochs of each Metal command buffer,
+// and ordering against earlier Metal command buffers waits for it. The other fences alternate
+// between epochs, so that a fence is only reused once no later encoder will wait for it.
+
+// The maximum number of Metal encoders in an epoch, beyond which a new epoch begins,
+// to bound the number of fences, and the number of fence waits of each Metal encoder.
+static const uint32_t kMVKHazardEpochMaxEncoderCount = 16;
+
+// Returns the index of the fence updated by the Metal encoder at the position within the epoch.
+static inline uint32_t mvkHazardFenceIndex(uint32_t epoch, uint32_t encoderIndex) {
+	return 1 + (encoderIndex * 2) + (epoch & 1);
+}
+
+void MVKCommandEncoder::markHazardBarrier() {
+	if ( !_isHazardTrackingEnabled ) { return; }
+
+	_hazardWaitsForBoundary = true;
+	advanceHazardEpoch();
+}
+
+// Begins a new epoch, unless no Metal encoder has joined the current epoch yet.
+void MVKCommandEncoder::advanceHazardEpoch() {
+	if (_hazardEpochEncoderCount == 0) { return; }
+
+	_hazardPriorEpochEncoderCount = _hazardEpochEncoderCount;
+	_hazardEpochEncoderCount = 0;
+	_hazardEpoch++;
+}
+
+// Adds the fences that a new Metal encoder must wait for, and returns the fence it must update.
+id<MTLFence> MVKCommandEncoder::prepareHazardTracking(MVKVector<id<MTLFence>>& mtlWaitFences, bool isRenderPassEncoder) {
+	if (_hazardEpochEncoderCount >= kMVKHazardEpochMaxEncoderCount) { advanceHazardEpoch(); }
+
+	id<MTLCommandQueue> mtlCmdQueue = _mtlCmdBuffer.commandQueue;
+	if (_hazardWaitsForBoundary) { mtlWaitFences.push_back(_device->getHazardTrackingMTLFence(mtlCmdQueue, 0)); }
+	for (uint32_t encIdx = 0; encIdx < _hazardPriorEpochEncoderCount; encIdx++) {
+		mtlWaitFences.push_back(_device->getHazardTrackingMTLFence(mtlCmdQueue, mvkHazardFenceIndex(_hazardEpoch - 1, encIdx)));
+	}
+
+	// Encoders of earlier epochs are already covered by the waits for the previous epoch.
+	bool chainsToLast = _hazardChainsToLastEncoder && _lastHazardFenceEpoch == _hazardEpoch;
+	if (chainsToLast) {
+		mtlWaitFences.push_back(_device->getHazardTrackingMTLFence(mtlCmdQueue, _lastHazardFenceIndex));
+	}
+	if (isRenderPassEncoder && _hasRenderPassHazardFence && _renderPassHazardFenceEpoch == _hazardEpoch &&
+		!(chainsToLast && _renderPassHazardFenceIndex == _lastHazardFenceIndex)) {
+		mtlWaitFences.push_back(_device->getHazardTrackingMTLFence(mtlCmdQueue, _renderPassHazardFenceIndex));
+	}
+
+	uint32_t fenceIdx = mvkHazardFenceIndex(_hazardEpoch, _hazardEpochEncoderCount++);
+	_lastHazardFenceIndex = fenceIdx;
+	_lastHazardFenceEpoch = _hazardEpoch;
+	_hazardChainsToLastEncoder = true;
+	if (isRenderPassEncoder) {
+		_renderPassHazardFenceIndex = fenceIdx;
+		_renderPassHazardFenceEpoch = _hazardEpoch;
+		_hasRenderPassHazardFence = true;
+	}
+	return _device->getHazardTrackingMTLFence(mtlCmdQueue, fenceIdx);
+}
+
+// Render encoders wait before their vertex stage, and update after their fragment stage.
+void MVKCommandEncoder::beginRenderEncoderHazardTracking(id<MTLRenderCommandEncoder> mtlRendEnc, bool isRenderPassEncoder) {
+	if ( !_isHazardTrackingEnabled ) { return; }
+
+	MVKVectorInline<id<MTLFence>, 8> mtlWaitFences;
+	_mtlEncoderHazardFence = prepareHazardTracking(mtlWaitFences, isRenderPassEncoder);
+	for (id<MTLFence> mtlFence : mtlWaitFences) {
+		[mtlRendEnc waitForFence: mtlFence beforeStages: MTLRenderStageVertex];
+	}
+}
+
+void MVKCommandEncoder::beginMTLRenderEncoderHazardTracking(id<MTLRenderCommandEncoder> mtlRendEnc) {
+	beginRenderEncoderHazardTracking(mtlRendEnc, false);
+}
+
+void MVKCommandEncoder::endMTLRenderEncoderHazardTracking(id<MTLRenderCommandEncoder> mtlRendEnc) {
+	if ( !_mtlEncoderHazardFence ) { return; }
+
+	[mtlRendEnc updateFence: _mtlEncoderHazardFence afterStages: MTLRenderStageFragment];
+	_mtlEncoderHazardFence = nil;
+}
+
+template<typename E>
+void MVKCommandEncoder::beginHazardTracking(E mtlEncoder) {
+	if ( !_isHazardTrackingEnabled ) { return; }
+
+	MVKVectorInline<id<MTLFence>, 8> mtlWaitFences;
+	_mtlEncoderHazardFence = prepareHazardTracking(mtlWaitFences, false);
+	for (id<MTLFence> mtlFence : mtlWaitFences) { [mtlEncoder waitForFence: mtlFence]; }
+}
+
+template<typename E>
+void MVKCommandEncoder::endHazardTracking(E mtlEncoder) {
+	if ( !_mtlEncoderHazardFence ) { return; }
+
+	[mtlEncoder updateFence: _mtlEncoderHazardFence];
+	_mtlEncoderHazardFence = nil;
+}
+
+// Encodes an empty BLIT encoder that waits for all of the work in the Metal command buffer,
+// and for the previous join, and updates the join fence of the Metal command queue.
+void MVKCommandEncoder::encodeHazardTrackingJoin() {
+	if ( !_isHazardTrackingEnabled || (_hazardEpochEncoderCount + _hazardPriorEpochEncoderCount) == 0 ) { return; }
+
+	advanceHazardEpoch();
+
+	id<MTLCommandQueue> mtlCmdQueue = _mtlCmdBuffer.commandQueue;
+	id<MTLFence> mtlJoinFence = _device->getHazardTrackingMTLFence(mtlCmdQueue, 0);
+	id<MTLBlitCommandEncoder> mtlBlitEnc = [_mtlCmdBuffer blitCommandEncoder];
+	[mtlBlitEnc waitForFence: mtlJoinFence];
+	for (uint32_t encIdx = 0; encIdx < _hazardPriorEpochEncoderCount; encIdx++) {
+		[mtlBlitEnc waitForFence: _device->getHazardTrackingMTLFence(mtlCmdQueue, mvkHazardFenceIndex(_hazardEpoch - 1, encIdx))];
+	}
+	[mtlBlitEnc updateFence: mtlJoinFence];
+	[mtlBlitEnc endEncoding];
 }
 
 bool MVKCommandEncoder::supportsDynamicState(VkDynamicState state) {
@@ -373,6 +1298,11 @@ bool MVKCommandEncoder::supportsDynamicState(VkDynamicState state) {
     return !gpl || gpl->supportsDynamicState(state);
 }
 
+bool MVKCommandEncoder::supportsDynamicState(MVKExtendedDynamicState state) {
+    MVKGraphicsPipeline* gpl = (MVKGraphicsPipeline*)_graphicsPipelineState.getPipeline();
+    return !gpl || gpl->supportsDynamicState(state);
+}
+
 VkRect2D MVKCommandEncoder::clipToRenderArea(VkRect2D scissor) {
 
 	int32_t raLeft = _renderArea.offset.x;
@@ -395,6 +1325,7 @@ void MVKCommandEncoder::finalizeDrawState(MVKGraphicsStage stage) {
     _scissorState.encode(stage);
     _depthBiasState.encode(stage);
     _blendColorState.encode(stage);
+    _rasterizingState.encode(stage);
     _vertexPushConstants.encode(stage);
     _tessCtlPushConstants.encode(stage);
     _tessEvalPushConstants.encode(stage);
@@ -434,6 +1365,14 @@ void MVKCommandEncoder::finalizeDispatchState() {
 
 void MVKCommandEncoder::endRenderpass() {
 	endMetalRenderEncoding();
+	if (_renderPass->hasExternalSubpassDependency(false)) { markHazardBarrier(); }
+	_hasRenderPassHazardFence = false;
+
+	// Skip the commands that were performed by the store actions of the last Metal render pass.
+	for (uint32_t cmdIdx = 0; cmdIdx < _resolveStoreOverrides.commandCount; cmdIdx++) {
+		_nextCommand = _nextCommand->_next;
+	}
+	_resolveStoreOverrides.reset();
 
 	_renderPass = nullptr;
 	_framebuffer = nullptr;
@@ -442,42 +1381,63 @@ void MVKCommandEncoder::endRenderpass() {
 
 void MVKCommandEncoder::endMetalRenderEncoding() {
 //    MVKLogDebugIf(_mtlRenderEncoder, "Render subpass end MTLRenderCommandEncoder.");
+	if (_mtlRenderEncoder) { endMTLRenderEncoderHazardTracking(_mtlRenderEncoder); }
     [_mtlRenderEncoder endEncoding];
 	_mtlRenderEncoder = nil;    // not retained
 }
 
 void MVKCommandEncoder::endCurrentMetalEncoding() {
+	encodePendingBlitCopyBuffer();
 	endMetalRenderEncoding();
 
 	_computePipelineState.markDirty();
 	_computeResourcesState.markDirty();
 	_computePushConstants.markDirty();
 
+	if (_mtlComputeEncoder) { endHazardTracking(_mtlComputeEncoder); }
 	[_mtlComputeEncoder endEncoding];
 	_mtlComputeEncoder = nil;       // not retained
 	_mtlComputeEncoderUse = kMVKCommandUseNone;
+	_isMTLComputeEncoderConcurrent = false;
 
+	if (_mtlBlitEncoder) { endHazardTracking(_mtlBlitEncoder); }
 	[_mtlBlitEncoder endEncoding];
 	_mtlBlitEncoder = nil;          // not retained
     _mtlBlitEncoderUse = kMVKCommandUseNone;
+
+	encodePendingEventSignals();
 }
 
 id<MTLComputeCommandEncoder> MVKCommandEncoder::getMTLComputeEncoder(MVKCommandUse cmdUse) {
+	encodePendingBlitCopyBuffer();
+
+	// Internal compute work relies on serial dispatch, so only app dispatches may run concurrently.
+	bool isConcurrent = (cmdUse == kMVKCommandUseDispatch) && _device->shouldUseConcurrentComputeDispatch();
+	if (_mtlComputeEncoder && _isMTLComputeEncoderConcurrent != isConcurrent) { endCurrentMetalEncoding(); }
+
 	if ( !_mtlComputeEncoder ) {
 		endCurrentMetalEncoding();
-		_mtlComputeEncoder = [_mtlCmdBuffer computeCommandEncoder];		// not retained
+		_mtlComputeEncoder = (isConcurrent
+							  ? [_mtlCmdBuffer computeCommandEncoderWithDispatchType: MTLDispatchTypeConcurrent]
+							  : [_mtlCmdBuffer computeCommandEncoder]);		// not retained
+		_isMTLComputeEncoderConcurrent = isConcurrent;
+		_isMTLDispatchBaseSet = false;
+		beginHazardTracking(_mtlComputeEncoder);
 	}
 	if (_mtlComputeEncoderUse != cmdUse) {
 		_mtlComputeEncoderUse = cmdUse;
+		_isMTLDispatchBaseSet = false;		// Internal compute work may overwrite the buffer that holds the base
 		setLabelIfNotNil(_mtlComputeEncoder, mvkMTLComputeCommandEncoderLabel(cmdUse));
 	}
 	return _mtlComputeEncoder;
 }
 
 id<MTLBlitCommandEncoder> MVKCommandEncoder::getMTLBlitEncoder(MVKCommandUse cmdUse) {
+	encodePendingBlitCopyBuffer();
 	if ( !_mtlBlitEncoder ) {
 		endCurrentMetalEncoding();
 		_mtlBlitEncoder = [_mtlCmdBuffer blitCommandEncoder];   // not retained
+		beginHazardTracking(_mtlBlitEncoder);
 	}
     if (_mtlBlitEncoderUse != cmdUse) {
         _mtlBlitEncoderUse = cmdUse;
@@ -486,7 +1446,46 @@ id<MTLBlitCommandEncoder> MVKCommandEncoder::getMTLBlitEncoder(MVKCommandUse cmd
 	return _mtlBlitEncoder;
 }
 
+// If the copy is a continuation of the deferred copy between the same two MTLBuffers, extend
+// the deferred copy. Otherwise, encode the deferred copy, and defer this copy in its place.
+// Copies within a single MTLBuffer are never merged, because merging could overlap them.
+void MVKCommandEncoder::encodeBlitCopyBuffer(MVKCommandUse cmdUse,
+											 id<MTLBuffer> srcMTLBuffer, NSUInteger srcOffset,
+											 id<MTLBuffer> dstMTLBuffer, NSUInteger dstOffset,
+											 NSUInteger size) {
+	auto& pbc = _pendingBlitCopyBuffer;
+	if (pbc.size && pbc.cmdUse == cmdUse && srcMTLBuffer != dstMTLBuffer &&
+		pbc.srcMTLBuffer == srcMTLBuffer && pbc.srcOffset + pbc.size == srcOffset &&
+		pbc.dstMTLBuffer == dstMTLBuffer && pbc.dstOffset + pbc.size == dstOffset) {
+		pbc.size += size;
+		return;
+	}
+
+	getMTLBlitEncoder(cmdUse);		// Encodes any pending copy, and ensures a BLIT encoder
+
+	pbc.srcMTLBuffer = srcMTLBuffer;
+	pbc.srcOffset = srcOffset;
+	pbc.dstMTLBuffer = dstMTLBuffer;
+	pbc.dstOffset = dstOffset;
+	pbc.size = size;
+	pbc.cmdUse = cmdUse;
+}
+
+void MVKCommandEncoder::encodePendingBlitCopyBuffer() {
+	auto& pbc = _pendingBlitCopyBuffer;
+	if ( !pbc.size ) { return; }
+
+	NSUInteger size = pbc.size;
+	pbc.size = 0;
+	[getMTLBlitEncoder(pbc.cmdUse) copyFromBuffer: pbc.srcMTLBuffer
+									 sourceOffset: pbc.srcOffset
+										 toBuffer: pbc.dstMTLBuffer
+								destinationOffset: pbc.dstOffset
+											 size: size];
+}
+
 id<MTLCommandEncoder> MVKCommandEncoder::getMTLEncoder(){
+	encodePendingBlitCopyBuffer();
 	if (_mtlRenderEncoder) { return _mtlRenderEncoder; }
 	if (_mtlComputeEncoder) { return _mtlComputeEncoder; }
 	if (_mtlBlitEncoder) { return _mtlBlitEncoder; }
@@ -513,8 +1512,8 @@ void MVKCommandEncoder::setVertexBytes(id<MTLRenderCommandEncoder> mtlEncoder,
     if (_pDeviceMetalFeatures->dynamicMTLBufferSize && length <= _pDeviceMetalFeatures->dynamicMTLBufferSize) {
         [mtlEncoder setVertexBytes: bytes length: length atIndex: mtlBuffIndex];
     } else {
-        const MVKMTLBufferAllocation* mtlBuffAlloc = copyToTempMTLBufferAllocation(bytes, length);
-        [mtlEncoder setVertexBuffer: mtlBuffAlloc->_mtlBuffer offset: mtlBuffAlloc->_offset atIndex: mtlBuffIndex];
+        MVKMTLBufferRegion mtlBuffRgn = copyToTransientMTLBuffer(bytes, length);
+        [mtlEncoder setVertexBuffer: mtlBuffRgn.mtlBuffer offset: mtlBuffRgn.offset atIndex: mtlBuffIndex];
     }
 }
 
@@ -525,8 +1524,8 @@ void MVKCommandEncoder::setFragmentBytes(id<MTLRenderCommandEncoder> mtlEncoder,
     if (_pDeviceMetalFeatures->dynamicMTLBufferSize && length <= _pDeviceMetalFeatures->dynamicMTLBufferSize) {
         [mtlEncoder setFragmentBytes: bytes length: length atIndex: mtlBuffIndex];
     } else {
-        const MVKMTLBufferAllocation* mtlBuffAlloc = copyToTempMTLBufferAllocation(bytes, length);
-        [mtlEncoder setFragmentBuffer: mtlBuffAlloc->_mtlBuffer offset: mtlBuffAlloc->_offset atIndex: mtlBuffIndex];
+        MVKMTLBufferRegion mtlBuffRgn = copyToTransientMTLBuffer(bytes, length);
+        [mtlEncoder setFragmentBuffer: mtlBuffRgn.mtlBuffer offset: mtlBuffRgn.offset atIndex: mtlBuffIndex];
     }
 }
 
@@ -537,11 +1536,37 @@ void MVKCommandEncoder::setComputeBytes(id<MTLComputeCommandEncoder> mtlEncoder,
     if (_pDeviceMetalFeatures->dynamicMTLBufferSize && length <= _pDeviceMetalFeatures->dynamicMTLBufferSize) {
         [mtlEncoder setBytes: bytes length: length atIndex: mtlBuffIndex];
     } else {
-        const MVKMTLBufferAllocation* mtlBuffAlloc = copyToTempMTLBufferAllocation(bytes, length);
-        [mtlEncoder setBuffer: mtlBuffAlloc->_mtlBuffer offset: mtlBuffAlloc->_offset atIndex: mtlBuffIndex];
+        MVKMTLBufferRegion mtlBuffRgn = copyToTransientMTLBuffer(bytes, length);
+        [mtlEncoder setBuffer: mtlBuffRgn.mtlBuffer offset: mtlBuffRgn.offset atIndex: mtlBuffIndex];
     }
 }
 
+// The shader reads the base either from the origin of the stage-input region, or from a buffer,
+// if the Metal version does not support the grid origin. Both persist in the Metal compute encoder
+// until another compute pipeline is bound, so dispatches with the same base, including indirect
+// dispatches, whose base is zero, set nothing.
+void MVKCommandEncoder::setComputeDispatchBase(MVKComputePipeline* pipeline, MTLOrigin mtlBaseGroup) {
+	if ( !pipeline->allowsDispatchBase() ) { return; }
+
+	uint32_t mtlBuffIdx = (pipeline->needsDispatchBaseBuffer()
+						   ? pipeline->getIndirectParamsIndex().stages[kMVKShaderStageCompute]
+						   : kMVKUndefinedLargeUInt32);
+	if (_isMTLDispatchBaseSet && _mtlDispatchBaseBufferIndex == mtlBuffIdx &&
+		_mtlDispatchBase.x == mtlBaseGroup.x && _mtlDispatchBase.y == mtlBaseGroup.y && _mtlDispatchBase.z == mtlBaseGroup.z) { return; }
+
+	id<MTLComputeCommandEncoder> mtlEncoder = getMTLComputeEncoder(kMVKCommandUseDispatch);
+	if (mtlBuffIdx == kMVKUndefinedLargeUInt32) {
+		// Metal does not validate the stage-input region against a stage-input descriptor.
+		[mtlEncoder setStageInRegion: MTLRegionMake3D(mtlBaseGroup.x, mtlBaseGroup.y, mtlBaseGroup.z, 1, 1, 1)];
+	} else {
+		uint32_t base[3] = {(uint32_t)mtlBaseGroup.x, (uint32_t)mtlBaseGroup.y, (uint32_t)mtlBaseGroup.z};
+		setComputeBytes(mtlEncoder, base, sizeof(base), mtlBuffIdx);
+	}
+	_mtlDispatchBase = mtlBaseGroup;
+	_mtlDispatchBaseBufferIndex = mtlBuffIdx;
+	_isMTLDispatchBaseSet = true;
+}
+
 const MVKMTLBufferAllocation* MVKCommandEncoder::getTempMTLBuffer(NSUInteger length) {
     const MVKMTLBufferAllocation* mtlBuffAlloc = getCommandEncodingPool()->acquireMTLBufferAllocation(length);
 	MVKMTLBufferAllocationPool* pool = mtlBuffAlloc->getPool();
@@ -554,17 +1579,54 @@ const MVKMTLBufferAllocation* MVKCommandEncoder::getTempMTLBuffer(NSUInteger len
     return mtlBuffAlloc;
 }
 
+// Scratch buffers are retained by this encoder only for the MTLCommandBuffer it encodes,
+// and are sized to the largest length previously needed by any encoding of the command buffer.
+const MVKMTLBufferAllocation* MVKCommandEncoder::getTessellationScratchBuffer(MVKTessScratchBufferType scratchType, NSUInteger length) {
+	const MVKMTLBufferAllocation*& scratchBuff = _tessScratchBuffers[scratchType];
+	if ( !scratchBuff || scratchBuff->_length < length ) {
+		_cmdBuffer->recordTessellationScratchLength(scratchType, length);
+		scratchBuff = getTempMTLBuffer(std::max(length, _cmdBuffer->getTessellationScratchHighWaterMark(scratchType)));
+	}
+	return scratchBuff;
+}
+
+// If another MTLCommandBuffer is still converting the same indices, they are converted again into a temporary
+// MTLBuffer, because that conversion may execute after this MTLCommandBuffer, on another queue, or never.
+id<MTLBuffer> MVKCommandEncoder::getConvertedIndexMTLBuffer(const MVKConvertedIndexBufferKey& key, NSUInteger length, NSUInteger& offset, bool& needsConversion) {
+	auto iter = _convertedIndexBuffers.find(key);
+	if (iter != _convertedIndexBuffers.end()) {
+		needsConversion = false;
+		offset = iter->second.second;
+		return iter->second.first;
+	}
+
+	offset = 0;
+	id<MTLBuffer> mtlBuff = getCommandEncodingPool()->getConvertedIndexMTLBuffer(key, length, _mtlCmdBuffer, needsConversion);
+	if ( !mtlBuff ) {
+		const MVKMTLBufferAllocation* tempBuff = getTempMTLBuffer(length);
+		mtlBuff = tempBuff->_mtlBuffer;
+		offset = tempBuff->_offset;
+		needsConversion = true;
+	}
+	_convertedIndexBuffers.emplace(key, std::make_pair(mtlBuff, offset));
+	return mtlBuff;
+}
+
 MVKCommandEncodingPool* MVKCommandEncoder::getCommandEncodingPool() {
 	return _cmdBuffer->getCommandPool()->getCommandEncodingPool();
 }
 
-// Copies the specified bytes into a temporary allocation within a pooled MTLBuffer, and returns the MTLBuffer allocation.
-const MVKMTLBufferAllocation* MVKCommandEncoder::copyToTempMTLBufferAllocation(const void* bytes, NSUInteger length) {
-    const MVKMTLBufferAllocation* mtlBuffAlloc = getTempMTLBuffer(length);
-    void* pBuffData = mtlBuffAlloc->getContents();
-    memcpy(pBuffData, bytes, length);
+MVKMTLBufferRegion MVKCommandEncoder::copyToTransientMTLBuffer(const void* bytes, NSUInteger length) {
+	MVKMTLBufferRegion mtlBuffRgn;
+	if ( !_transientMTLBufferSuballocator.allocate(length, _pDeviceMetalFeatures->mtlBufferAlignment, mtlBuffRgn) ) {
+		const MVKMTLBufferAllocation* mtlBuffAlloc = getTempMTLBuffer(length);
+		mtlBuffRgn.mtlBuffer = mtlBuffAlloc->_mtlBuffer;
+		mtlBuffRgn.offset = mtlBuffAlloc->_offset;
+		mtlBuffRgn.length = length;
+	}
+	memcpy(mtlBuffRgn.getContents(), bytes, length);
 
-    return mtlBuffAlloc;
+	return mtlBuffRgn;
 }
 
 
@@ -579,10 +1641,66 @@ void MVKCommandEncoder::endOcclusionQuery(MVKOcclusionQueryPool* pQueryPool, uin
     _occlusionQueryState.endOcclusionQuery(pQueryPool, query);
 }
 
-void MVKCommandEncoder::markTimestamp(MVKQueryPool* pQueryPool, uint32_t query) {
+void MVKCommandEncoder::markTimestamp(MVKTimestampQueryPool* pQueryPool, uint32_t query) {
+	pQueryPool->setIsGPUTimestamp(query, sampleCounters(kMVKCommandUseWriteTimestamp, pQueryPool->getMTLCounterBuffer(), query));
     addActivatedQuery(pQueryPool, query);
 }
 
+void MVKCommandEncoder::beginPipelineStatisticsQuery(MVKPipelineStatisticsQueryPool* pQueryPool, uint32_t query) {
+	pQueryPool->setIsSampled(query, sampleCounters(kMVKCommandUseBeginQuery, pQueryPool->getMTLCounterBuffer(), pQueryPool->getBeginSampleIndex(query)));
+	addActivatedQuery(pQueryPool, query);
+}
+
+void MVKCommandEncoder::endPipelineStatisticsQuery(MVKPipelineStatisticsQueryPool* pQueryPool, uint32_t query) {
+	if ( !sampleCounters(kMVKCommandUseEndQuery, pQueryPool->getMTLCounterBuffer(), pQueryPool->getEndSampleIndex(query)) ) {
+		pQueryPool->setIsSampled(query, false);
+	}
+}
+
+// Samples the GPU counters into the sample buffer, at the finest boundary the GPU supports
+// within the current Metal encoder, or at the start of a new BLIT encoder if the GPU only
+// supports sampling at encoder boundaries. Within a render pass, if the GPU cannot sample
+// between draws, this returns false, so the caller falls back to host time. Ending the Metal
+// render pass for the sample would flush the tile memory, and its store actions, chosen when
+// it began, may discard the attachment contents that the restarted Metal render pass loads.
+bool MVKCommandEncoder::sampleCounters(MVKCommandUse cmdUse, id<MTLCounterSampleBuffer> mtlCounterBuff, uint32_t sampleIndex) {
+#if MVK_XCODE_12
+	if ( !mtlCounterBuff ) { return false; }
+
+	MVKCounterSamplingFlags sampPts = _pDeviceMetalFeatures->counterSamplingPoints;
+	if (_mtlRenderEncoder) {
+		if ( !mvkIsAnyFlagEnabled(sampPts, MVK_COUNTER_SAMPLING_AT_DRAW) ) { return false; }
+		[_mtlRenderEncoder sampleCountersInBuffer: mtlCounterBuff atSampleIndex: sampleIndex withBarrier: YES];
+		return true;
+	}
+	if (_mtlComputeEncoder && mvkIsAnyFlagEnabled(sampPts, MVK_COUNTER_SAMPLING_AT_DISPATCH)) {
+		[_mtlComputeEncoder sampleCountersInBuffer: mtlCounterBuff atSampleIndex: sampleIndex withBarrier: YES];
+		return true;
+	}
+	if (mvkIsAnyFlagEnabled(sampPts, MVK_COUNTER_SAMPLING_AT_BLIT)) {
+		[getMTLBlitEncoder(cmdUse) sampleCountersInBuffer: mtlCounterBuff atSampleIndex: sampleIndex withBarrier: YES];
+		return true;
+	}
+	if (mvkIsAnyFlagEnabled(sampPts, MVK_COUNTER_SAMPLING_AT_STAGE)) {
+		endCurrentMetalEncoding();
+
+		MTLBlitPassDescriptor* mtlBlitPassDesc = [MTLBlitPassDescriptor blitPassDescriptor];
+		MTLBlitPassSampleBufferAttachmentDescriptor* mtlSampAttDesc = mtlBlitPassDesc.sampleBufferAttachments[0];
+		mtlSampAttDesc.sampleBuffer = mtlCounterBuff;
+		mtlSampAttDesc.startOfEncoderSampleIndex = sampleIndex;
+		mtlSampAttDesc.endOfEncoderSampleIndex = MTLCounterDontSample;
+
+		// Subsequent BLIT commands can continue in this encoder.
+		_mtlBlitEncoder = [_mtlCmdBuffer blitCommandEncoderWithDescriptor: mtlBlitPassDesc];		// not retained
+		beginHazardTracking(_mtlBlitEncoder);
+		_mtlBlitEncoderUse = cmdUse;
+		setLabelIfNotNil(_mtlBlitEncoder, mvkMTLBlitCommandEncoderLabel(cmdUse));
+		return true;
+	}
+#endif
+	return false;
+}
+
 // Marks the specified query as activated
 void MVKCommandEncoder::addActivatedQuery(MVKQueryPool* pQueryPool, uint32_t query) {
     if ( !_pActivatedQueries ) { _pActivatedQueries = new MVKActivatedQueries(); }
@@ -615,6 +1733,7 @@ MVKCommandEncoder::MVKCommandEncoder(MVKCommandBuffer* cmdBuffer) : MVKBaseDevic
         _scissorState(this),
         _depthBiasState(this),
         _blendColorState(this),
+        _rasterizingState(this),
         _vertexPushConstants(this, VK_SHADER_STAGE_VERTEX_BIT),
         _tessCtlPushConstants(this, VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT),
         _tessEvalPushConstants(this, VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT),
@@ -624,13 +1743,15 @@ MVKCommandEncoder::MVKCommandEncoder(MVKCommandBuffer* cmdBuffer) : MVKBaseDevic
         _stencilReferenceValueState(this),
         _graphicsResourcesState(this),
         _computeResourcesState(this),
-        _occlusionQueryState(this) {
+        _occlusionQueryState(this),
+        _transientMTLBufferSuballocator(cmdBuffer->getCommandPool()->getCommandEncodingPool()->getTransientMTLBufferRing()) {
 
             _pDeviceFeatures = &_device->_enabledFeatures;
             _pDeviceMetalFeatures = _device->_pMetalFeatures;
             _pDeviceProperties = _device->_pProperties;
             _pDeviceMemoryProperties = _device->_pMemoryProperties;
             _pActivatedQueries = nullptr;
+            _nextCommand = nullptr;
             _mtlCmdBuffer = nil;
             _mtlRenderEncoder = nil;
             _mtlComputeEncoder = nil;
@@ -668,6 +1789,9 @@ NSString* mvkMTLBlitCommandEncoderLabel(MVKCommandUse cmdUse) {
         case kMVKCommandUseUpdateBuffer:        return @"vkCmdUpdateBuffer BlitEncoder";
         case kMVKCommandUseResetQueryPool:      return @"vkCmdResetQueryPool BlitEncoder";
         case kMVKCommandUseCopyQueryPoolResults:return @"vkCmdCopyQueryPoolResults BlitEncoder";
+        case kMVKCommandUseWriteTimestamp:      return @"vkCmdWriteTimestamp BlitEncoder";
+        case kMVKCommandUseBeginQuery:          return @"vkCmdBeginQuery BlitEncoder";
+        case kMVKCommandUseEndQuery:            return @"vkCmdEndQuery BlitEncoder";
         default:                                return @"Unknown Use BlitEncoder";
     }
 }
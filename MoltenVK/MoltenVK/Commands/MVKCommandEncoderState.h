@@ -22,6 +22,7 @@
 #include "MVKCommandResourceFactory.h"
 #include "MVKDevice.h"
 #include "MVKVector.h"
+#include "MVKFlatHashMap.h"
 #include <unordered_map>
 
 class MVKCommandEncoder;
@@ -196,8 +197,11 @@ public:
     /** Sets the specified push constants. */
     void setPushConstants(uint32_t offset, MVKVector<char>& pushConstants);
 
-    /** Sets the index of the Metal buffer used to hold the push constants. */
-    void setMTLBufferIndex(uint32_t mtlBufferIndex);
+    /**
+     * Sets the index of the Metal buffer used to hold the push constants, and whether the
+     * shader function of the current pipeline for this stage reads the push constants.
+     */
+    void setMTLBufferIndex(uint32_t mtlBufferIndex, bool pipelineStageUsesPushConstants);
 
     /** Constructs this instance for the specified command encoder. */
     MVKPushConstantsCommandEncoderState(MVKCommandEncoder* cmdEncoder,
@@ -212,12 +216,18 @@ protected:
     MVKVectorInline<char, 128> _pushConstants;
     VkShaderStageFlagBits _shaderStage;
     uint32_t _mtlBufferIndex = 0;
+    bool _pipelineStageUsesPushConstants = true;
 };
 
 
 #pragma mark -
 #pragma mark MVKDepthStencilCommandEncoderState
 
+/** The initial Vulkan stencil state, which matches the default Metal stencil descriptor. */
+static const VkStencilOpState kMVKVkStencilOpStateDefault = {
+	VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP, VK_COMPARE_OP_ALWAYS, 0xFFFFFFFF, 0xFFFFFFFF, 0
+};
+
 /** Holds encoder state established by depth stencil commands. */
 class MVKDepthStencilCommandEncoderState : public MVKCommandEncoderState {
 
@@ -238,6 +248,25 @@ public:
      */
     void setStencilWriteMask(VkStencilFaceFlags faceMask, uint32_t stencilWriteMask);
 
+	/** Sets whether depth testing is enabled, from explicit dynamic command. */
+	void setDepthTestEnable(VkBool32 depthTestEnable);
+
+	/** Sets whether depth writing is enabled, from explicit dynamic command. */
+	void setDepthWriteEnable(VkBool32 depthWriteEnable);
+
+	/** Sets the depth compare operation, from explicit dynamic command. */
+	void setDepthCompareOp(VkCompareOp depthCompareOp);
+
+	/** Sets whether stencil testing is enabled, from explicit dynamic command. */
+	void setStencilTestEnable(VkBool32 stencilTestEnable);
+
+	/** Sets the stencil operations of the indicated faces, from explicit dynamic command. */
+	void setStencilOp(VkStencilFaceFlags faceMask,
+					  VkStencilOp failOp,
+					  VkStencilOp passOp,
+					  VkStencilOp depthFailOp,
+					  VkCompareOp compareOp);
+
 	void beginMetalRenderPass() override;
 
     /** Constructs this instance for the specified command encoder. */
@@ -247,11 +276,21 @@ public:
 protected:
     void encodeImpl(uint32_t stage) override;
     void resetImpl() override;
+    void setStencilOpState(VkStencilOpState& vkStencil, const VkStencilOpState& vkSrcStencil);
     void setStencilState(MVKMTLStencilDescriptorData& stencilInfo,
                          const VkStencilOpState& vkStencil,
                          bool enabled);
+    void updateDepthStencilData();
 
+    // The Vulkan depth stencil state is retained, so that any part of it can be set
+    // dynamically, and _depthStencilData is derived from it whenever it changes.
     MVKMTLDepthStencilDescriptorData _depthStencilData = kMVKMTLDepthStencilDescriptorDataDefault;
+    VkStencilOpState _frontFaceStencil = kMVKVkStencilOpStateDefault;
+    VkStencilOpState _backFaceStencil = kMVKVkStencilOpStateDefault;
+    VkCompareOp _depthCompareOp = VK_COMPARE_OP_LESS;
+    bool _depthTestEnabled = false;
+    bool _depthWriteEnabled = false;
+    bool _stencilTestEnabled = false;
 	bool _hasDepthAttachment = false;
 	bool _hasStencilAttachment = false;
 };
@@ -343,6 +382,40 @@ protected:
 };
 
 
+#pragma mark -
+#pragma mark MVKRasterizingCommandEncoderState
+
+/**
+ * Holds encoder state established by pipeline binding, that can otherwise
+ * be set by the dynamic commands of the VK_EXT_extended_dynamic_state extension.
+ */
+class MVKRasterizingCommandEncoderState : public MVKCommandEncoderState {
+
+public:
+
+    /** Sets the primitive type, either as part of pipeline binding, or dynamically. */
+    void setPrimitiveType(MTLPrimitiveType mtlPrimitiveType, bool isDynamic);
+
+    /** Sets the cull mode, either as part of pipeline binding, or dynamically. */
+    void setCullMode(MTLCullMode mtlCullMode, bool isDynamic);
+
+    /** Sets the front facing winding, either as part of pipeline binding, or dynamically. */
+    void setFrontFacingWinding(MTLWinding mtlFrontWinding, bool isDynamic);
+
+    /** Constructs this instance for the specified command encoder. */
+    MVKRasterizingCommandEncoderState(MVKCommandEncoder* cmdEncoder)
+        : MVKCommandEncoderState(cmdEncoder) {}
+
+protected:
+    void encodeImpl(uint32_t stage) override;
+    void resetImpl() override;
+
+    MTLPrimitiveType _mtlPrimitiveType = MTLPrimitiveTypePoint;
+    MTLCullMode _mtlCullMode = MTLCullModeNone;
+    MTLWinding _mtlFrontWinding = MTLWindingClockwise;
+};
+
+
 #pragma mark -
 #pragma mark MVKResourcesCommandEncoderState
 
@@ -364,26 +437,146 @@ protected:
     }
 
     // Template function that updates an existing binding or adds a new binding to a vector
-    // of bindings, and marks the binding, the vector, and this instance as dirty
+    // of bindings, and marks the binding, the vector, and this instance as dirty.
+    // Rebinding the same content to an index is redundant, and is ignored.
     template<class T, class U>
     void bind(const T& b, U& bindings, bool& bindingsDirtyFlag) {
 
         if ( !b.mtlResource ) { return; }
 
         T db = b;   // Copy that can be marked dirty
-        MVKCommandEncoderState::markDirty();
-        bindingsDirtyFlag = true;
         db.isDirty = true;
 
         for (auto iter = bindings.begin(), end = bindings.end(); iter != end; ++iter) {
             if( iter->index == db.index ) {
+                if (isSameBinding(*iter, db)) { return; }
                 *iter = db;
+                MVKCommandEncoderState::markDirty();
+                bindingsDirtyFlag = true;
                 return;
             }
         }
         bindings.push_back(db);
+        MVKCommandEncoderState::markDirty();
+        bindingsDirtyFlag = true;
     }
 
+	// Buffer bindings additionally recognize when only the offset of a buffer that is already
+	// encoded has changed, in which case only the offset needs to be encoded again.
+	template<class U>
+	void bind(const MVKMTLBufferBinding& b, U& bindings, bool& bindingsDirtyFlag) {
+
+		if ( !b.mtlResource ) { return; }
+
+		for (auto iter = bindings.begin(), end = bindings.end(); iter != end; ++iter) {
+			if( iter->index == b.index ) {
+				if (isSameBinding(*iter, b)) { return; }
+				bool isOffsetOnly = (!iter->isDirty && !iter->isInline && !b.isInline &&
+									 iter->mtlBuffer == b.mtlBuffer && iter->size == b.size);
+				*iter = b;
+				iter->isDirty = !isOffsetOnly;
+				iter->isOffsetDirty = isOffsetOnly;
+				MVKCommandEncoderState::markDirty();
+				bindingsDirtyFlag = true;
+				return;
+			}
+		}
+		MVKMTLBufferBinding db = b;   // Copy that can be marked dirty
+		db.isDirty = true;
+		db.isOffsetDirty = false;
+		bindings.push_back(db);
+		MVKCommandEncoderState::markDirty();
+		bindingsDirtyFlag = true;
+	}
+
+	// Template function that binds a contiguous range of bindings, assigning them consecutive indexes
+	// starting at firstIndex. If no existing binding falls within the range, which is common when a
+	// descriptor set is bound after the encoder state has been reset, the range is appended in one
+	// pass, without searching the vector for each index. Otherwise, each binding is bound individually.
+	template<class T, class U>
+	void bindRange(const T* pBindings, uint32_t count, uint32_t firstIndex, U& bindings, bool& bindingsDirtyFlag) {
+
+		if ( !count ) { return; }
+
+		if (isAnyIndexBound(bindings, firstIndex, count)) {
+			for (uint32_t i = 0; i < count; i++) {
+				T b = pBindings[i];
+				b.index = firstIndex + i;
+				bind(b, bindings, bindingsDirtyFlag);
+			}
+			return;
+		}
+
+		bool wasBound = false;
+		for (uint32_t i = 0; i < count; i++) {
+			if ( !pBindings[i].mtlResource ) { continue; }
+
+			T db = pBindings[i];   // Copy that can be marked dirty
+			db.index = firstIndex + i;
+			clearBindingDirtyState(db);
+			db.isDirty = true;
+			bindings.push_back(db);
+			wasBound = true;
+		}
+		if (wasBound) {
+			MVKCommandEncoderState::markDirty();
+			bindingsDirtyFlag = true;
+		}
+	}
+
+	// Returns whether any binding in the vector has an index within the range.
+	template<class U>
+	bool isAnyIndexBound(U& bindings, uint32_t firstIndex, uint32_t count) {
+		for (auto& b : bindings) {
+			if (b.index >= firstIndex && b.index < firstIndex + count) { return true; }
+		}
+		return false;
+	}
+
+	// Clears any dirty state, other than the dirty flag, that a new binding must not carry.
+	void clearBindingDirtyState(MVKMTLBufferBinding& b) { b.isOffsetDirty = false; }
+	void clearBindingDirtyState(MVKMTLTextureBinding& b) {}
+	void clearBindingDirtyState(MVKMTLSamplerStateBinding& b) {}
+
+	// For texture bindings, we also keep track of whether any bindings need a texture swizzle
+	void bindRange(const MVKMTLTextureBinding* pBindings, uint32_t count, uint32_t firstIndex,
+				   MVKVector<MVKMTLTextureBinding>& texBindings, bool& bindingsDirtyFlag, bool& needsSwizzleFlag) {
+		bindRange(pBindings, count, firstIndex, texBindings, bindingsDirtyFlag);
+		for (uint32_t i = 0; i < count; i++) {
+			if (pBindings[i].mtlTexture && pBindings[i].swizzle != 0) { needsSwizzleFlag = true; }
+		}
+	}
+
+	// Adds the resource usage to a vector of resource usages, and marks the usage, the vector,
+	// and this instance as dirty. Using a resource that is already in the vector only marks it
+	// as dirty if the usage adds access that was not previously declared. Argument buffers can
+	// reference many resources, so the index of each resource in the vector is held in a map,
+	// instead of searching the vector each time a resource is used.
+	void use(const MVKMTLResourceUsage& ru,
+			 MVKVector<MVKMTLResourceUsage>& usages,
+			 MVKFlatHashMap<id<MTLResource>, uint32_t>& usageIndexes,
+			 bool& usagesDirtyFlag) {
+
+		if ( !ru.mtlResource ) { return; }
+
+		auto iter = usageIndexes.find(ru.mtlResource);
+		if (iter != usageIndexes.end()) {
+			auto& u = usages[iter->second];
+			if ((u.mtlUsage | ru.mtlUsage) == u.mtlUsage) { return; }
+			u.mtlUsage = MTLResourceUsage(u.mtlUsage | ru.mtlUsage);
+			u.isDirty = true;
+			MVKCommandEncoderState::markDirty();
+			usagesDirtyFlag = true;
+			return;
+		}
+		MVKMTLResourceUsage dru = ru;   // Copy that can be marked dirty
+		dru.isDirty = true;
+		usageIndexes.emplace(ru.mtlResource, uint32_t(usages.size()));
+		usages.push_back(dru);
+		MVKCommandEncoderState::markDirty();
+		usagesDirtyFlag = true;
+	}
+
 	// For texture bindings, we also keep track of whether any bindings need a texture swizzle
 	void bind(const MVKMTLTextureBinding& tb, MVKVector<MVKMTLTextureBinding>& texBindings,
 			  bool& bindingsDirtyFlag, bool& needsSwizzleFlag) {
@@ -391,22 +584,47 @@ protected:
 		if (tb.swizzle != 0) { needsSwizzleFlag = true; }
 	}
 
-    // Template function that executes a lambda expression on each dirty element of
-    // a vector of bindings, and marks the bindings and the vector as no longer dirty.
-    template<class T>
-    void encodeBinding(MVKVector<T>& bindings,
-                       bool& bindingsDirtyFlag,
-                       std::function<void(MVKCommandEncoder* cmdEncoder, T& b)> mtlOperation) {
-        if (bindingsDirtyFlag) {
-            bindingsDirtyFlag = false;
-            for (auto& b : bindings) {
-                if (b.isDirty) {
-                    mtlOperation(_cmdEncoder, b);
-                    b.isDirty = false;
-                }
-            }
-        }
-    }
+	// Returns whether the bindings refer to the same content. Inline buffer content can change
+	// behind the same pointer, so inline buffers are never considered the same.
+	bool isSameBinding(const MVKMTLTextureBinding& b1, const MVKMTLTextureBinding& b2) {
+		return b1.mtlTexture == b2.mtlTexture && b1.swizzle == b2.swizzle;
+	}
+	bool isSameBinding(const MVKMTLSamplerStateBinding& b1, const MVKMTLSamplerStateBinding& b2) {
+		return b1.mtlSamplerState == b2.mtlSamplerState;
+	}
+	bool isSameBinding(const MVKMTLBufferBinding& b1, const MVKMTLBufferBinding& b2) {
+		return (!b1.isInline && !b2.isInline &&
+				b1.mtlBuffer == b2.mtlBuffer && b1.offset == b2.offset && b1.size == b2.size);
+	}
+
+	// Encodes the dirty buffer bindings, and marks the bindings and the vector as no longer dirty.
+	// Inline buffers are encoded individually using mtlOperation. Other dirty buffers are encoded
+	// using mtlRangeOperation, once for each range of contiguous binding indexes. Buffers whose
+	// offset alone has changed join the range of any adjacent dirty buffers, and are otherwise
+	// encoded individually using mtlOffsetOperation.
+	void encodeBufferBindings(MVKVector<MVKMTLBufferBinding>& bindings,
+							  bool& bindingsDirtyFlag,
+							  std::function<void(MVKCommandEncoder*, MVKMTLBufferBinding&)> mtlOperation,
+							  std::function<void(MVKCommandEncoder*, const id<MTLBuffer>*, const NSUInteger*, NSRange)> mtlRangeOperation,
+							  std::function<void(MVKCommandEncoder*, MVKMTLBufferBinding&)> mtlOffsetOperation);
+
+	// Encodes the dirty texture bindings, once for each range of contiguous binding indexes,
+	// and marks the bindings and the vector as no longer dirty.
+	void encodeTextureBindings(MVKVector<MVKMTLTextureBinding>& bindings,
+							   bool& bindingsDirtyFlag,
+							   std::function<void(MVKCommandEncoder*, const id<MTLTexture>*, NSRange)> mtlRangeOperation);
+
+	// Encodes the dirty sampler state bindings, once for each range of contiguous binding indexes,
+	// and marks the bindings and the vector as no longer dirty.
+	void encodeSamplerStateBindings(MVKVector<MVKMTLSamplerStateBinding>& bindings,
+									bool& bindingsDirtyFlag,
+									std::function<void(MVKCommandEncoder*, const id<MTLSamplerState>*, NSRange)> mtlRangeOperation);
+
+	// Declares the dirty resource usages using mtlOperation, and marks the resource usages
+	// and the vector as no longer dirty.
+	void encodeResourceUsages(MVKVector<MVKMTLResourceUsage>& usages,
+							  bool& usagesDirtyFlag,
+							  std::function<void(MVKCommandEncoder*, id<MTLResource>, MTLResourceUsage)> mtlOperation);
 
 	void updateImplicitBuffer(MVKVector<uint32_t> &contents, uint32_t index, uint32_t value);
 	void assertMissingSwizzles(bool needsSwizzle, const char* stageName, MVKVector<MVKMTLTextureBinding>& texBindings);
@@ -431,6 +649,18 @@ public:
     /** Binds the specified sampler state for the specified shader stage. */
     void bindSamplerState(MVKShaderStage stage, const MVKMTLSamplerStateBinding& binding);
 
+    /** Binds the specified number of buffers for the specified shader stage, at consecutive indexes starting at firstIndex. */
+    void bindBuffers(MVKShaderStage stage, const MVKMTLBufferBinding* pBindings, uint32_t count, uint32_t firstIndex);
+
+    /** Binds the specified number of textures for the specified shader stage, at consecutive indexes starting at firstIndex. */
+    void bindTextures(MVKShaderStage stage, const MVKMTLTextureBinding* pBindings, uint32_t count, uint32_t firstIndex);
+
+    /** Binds the specified number of sampler states for the specified shader stage, at consecutive indexes starting at firstIndex. */
+    void bindSamplerStates(MVKShaderStage stage, const MVKMTLSamplerStateBinding* pBindings, uint32_t count, uint32_t firstIndex);
+
+    /** Declares that the specified shader stage accesses the resource through a Metal argument buffer. */
+    void useResource(MVKShaderStage stage, const MVKMTLResourceUsage& usage);
+
     /** The type of index that will be used to render primitives. Exposed directly. */
     MVKIndexMTLBufferBinding _mtlIndexBufferBinding;
 
@@ -457,9 +687,12 @@ public:
                         const char* pStageName,
                         bool fullImageViewSwizzle,
                         std::function<void(MVKCommandEncoder*, MVKMTLBufferBinding&)> bindBuffer,
+                        std::function<void(MVKCommandEncoder*, const id<MTLBuffer>*, const NSUInteger*, NSRange)> bindBuffers,
+                        std::function<void(MVKCommandEncoder*, MVKMTLBufferBinding&)> bindBufferOffset,
                         std::function<void(MVKCommandEncoder*, MVKMTLBufferBinding&, MVKVector<uint32_t>&)> bindImplicitBuffer,
-                        std::function<void(MVKCommandEncoder*, MVKMTLTextureBinding&)> bindTexture,
-                        std::function<void(MVKCommandEncoder*, MVKMTLSamplerStateBinding&)> bindSampler);
+                        std::function<void(MVKCommandEncoder*, const id<MTLTexture>*, NSRange)> bindTextures,
+                        std::function<void(MVKCommandEncoder*, const id<MTLSamplerState>*, NSRange)> bindSamplers,
+                        std::function<void(MVKCommandEncoder*, id<MTLResource>, MTLResourceUsage)> useResource);
 
 #pragma mark Construction
     
@@ -475,6 +708,8 @@ protected:
         MVKVectorInline<MVKMTLBufferBinding, 8> bufferBindings;
         MVKVectorInline<MVKMTLTextureBinding, 8> textureBindings;
         MVKVectorInline<MVKMTLSamplerStateBinding, 8> samplerStateBindings;
+        MVKVectorInline<MVKMTLResourceUsage, 8> resourceUsages;
+        MVKFlatHashMap<id<MTLResource>, uint32_t> resourceUsageIndexes;
         MVKVectorInline<uint32_t, 8> swizzleConstants;
         MVKVectorInline<uint32_t, 8> bufferSizes;
         MVKMTLBufferBinding swizzleBufferBinding;
@@ -483,6 +718,7 @@ protected:
         bool areBufferBindingsDirty = false;
         bool areTextureBindingsDirty = false;
         bool areSamplerStateBindingsDirty = false;
+        bool areResourceUsagesDirty = false;
 
         bool needsSwizzle = false;
     };
@@ -508,6 +744,18 @@ public:
     /** Binds the specified sampler state. */
     void bindSamplerState(const MVKMTLSamplerStateBinding& binding);
 
+    /** Binds the specified number of buffers, at consecutive indexes starting at firstIndex. */
+    void bindBuffers(const MVKMTLBufferBinding* pBindings, uint32_t count, uint32_t firstIndex);
+
+    /** Binds the specified number of textures, at consecutive indexes starting at firstIndex. */
+    void bindTextures(const MVKMTLTextureBinding* pBindings, uint32_t count, uint32_t firstIndex);
+
+    /** Binds the specified number of sampler states, at consecutive indexes starting at firstIndex. */
+    void bindSamplerStates(const MVKMTLSamplerStateBinding* pBindings, uint32_t count, uint32_t firstIndex);
+
+    /** Declares that the compute shader accesses the resource through a Metal argument buffer. */
+    void useResource(const MVKMTLResourceUsage& usage);
+
     /** Sets the current swizzle buffer state. */
     void bindSwizzleBuffer(const MVKShaderImplicitRezBinding& binding, bool needSwizzleBuffer);
 
@@ -528,6 +776,8 @@ protected:
     MVKVectorInline<MVKMTLBufferBinding, 4> _bufferBindings;
     MVKVectorInline<MVKMTLTextureBinding, 4> _textureBindings;
     MVKVectorInline<MVKMTLSamplerStateBinding, 4> _samplerStateBindings;
+    MVKVectorInline<MVKMTLResourceUsage, 4> _resourceUsages;
+    MVKFlatHashMap<id<MTLResource>, uint32_t> _resourceUsageIndexes;
     MVKVectorInline<uint32_t, 4> _swizzleConstants;
     MVKVectorInline<uint32_t, 4> _bufferSizes;
     MVKMTLBufferBinding _swizzleBufferBinding;
@@ -536,6 +786,7 @@ protected:
     bool _areBufferBindingsDirty = false;
     bool _areTextureBindingsDirty = false;
     bool _areSamplerStateBindingsDirty = false;
+    bool _areResourceUsagesDirty = false;
 
     bool _needsSwizzle = false;
 };
@@ -23,6 +23,7 @@
 #include "MVKPipeline.h"
 #include "MVKQueryPool.h"
 #include "MVKLogging.h"
+#include <algorithm>
 
 using namespace std;
 
@@ -171,12 +172,21 @@ void MVKPushConstantsCommandEncoderState:: setPushConstants(uint32_t offset, MVK
 	size_t pcSizeAlign = _cmdEncoder->getDevice()->_pMetalFeatures->pushConstantSizeAlignment;
     size_t pcSize = pushConstants.size();
 	size_t pcBuffSize = mvkAlignByteCount(offset + pcSize, pcSizeAlign);
+	bool isResized = _pushConstants.size() < pcBuffSize;
     mvkEnsureSize(_pushConstants, pcBuffSize);
-    copy(pushConstants.begin(), pushConstants.end(), _pushConstants.begin() + offset);
+
+	// Don't encode the push constants again if the content of the range has not changed.
+	auto pcDst = _pushConstants.begin() + offset;
+	if ( !isResized && equal(pushConstants.begin(), pushConstants.end(), pcDst) ) { return; }
+
+    copy(pushConstants.begin(), pushConstants.end(), pcDst);
     if (pcBuffSize > 0) { markDirty(); }
 }
 
-void MVKPushConstantsCommandEncoderState::setMTLBufferIndex(uint32_t mtlBufferIndex) {
+// Binding a pipeline whose shader function for this stage does not read the push constants
+// does not require them to be encoded, but they must be encoded for the next pipeline that does.
+void MVKPushConstantsCommandEncoderState::setMTLBufferIndex(uint32_t mtlBufferIndex, bool pipelineStageUsesPushConstants) {
+	_pipelineStageUsesPushConstants = pipelineStageUsesPushConstants;
     if (mtlBufferIndex != _mtlBufferIndex) {
         _mtlBufferIndex = mtlBufferIndex;
         markDirty();
@@ -191,6 +201,8 @@ void MVKPushConstantsCommandEncoderState::encodeImpl(uint32_t stage) {
 
 	_isDirty = true;	// Stay dirty until I actually decide to make a change to the encoder
 
+	if ( !_pipelineStageUsesPushConstants ) { return; }
+
     switch (_shaderStage) {
         case VK_SHADER_STAGE_VERTEX_BIT:
             if (stage == (isTessellating() ? kMVKGraphicsStageVertex : kMVKGraphicsStageRasterization)) {
@@ -254,18 +266,57 @@ void MVKPushConstantsCommandEncoderState::resetImpl() {
 #pragma mark -
 #pragma mark MVKDepthStencilCommandEncoderState
 
+// Each part of the depth stencil state is taken from the pipeline, unless it is set dynamically.
 void MVKDepthStencilCommandEncoderState:: setDepthStencilState(const VkPipelineDepthStencilStateCreateInfo& vkDepthStencilInfo) {
 
-    if (vkDepthStencilInfo.depthTestEnable) {
-        _depthStencilData.depthCompareFunction = mvkMTLCompareFunctionFromVkCompareOp(vkDepthStencilInfo.depthCompareOp);
-        _depthStencilData.depthWriteEnabled = vkDepthStencilInfo.depthWriteEnable;
+    if ( !_cmdEncoder->supportsDynamicState(kMVKDynamicStateDepthTestEnable) ) {
+        _depthTestEnabled = vkDepthStencilInfo.depthTestEnable;
+    }
+    if ( !_cmdEncoder->supportsDynamicState(kMVKDynamicStateDepthWriteEnable) ) {
+        _depthWriteEnabled = vkDepthStencilInfo.depthWriteEnable;
+    }
+    if ( !_cmdEncoder->supportsDynamicState(kMVKDynamicStateDepthCompareOp) ) {
+        _depthCompareOp = vkDepthStencilInfo.depthCompareOp;
+    }
+    if ( !_cmdEncoder->supportsDynamicState(kMVKDynamicStateStencilTestEnable) ) {
+        _stencilTestEnabled = vkDepthStencilInfo.stencilTestEnable;
+    }
+    setStencilOpState(_frontFaceStencil, vkDepthStencilInfo.front);
+    setStencilOpState(_backFaceStencil, vkDepthStencilInfo.back);
+
+    updateDepthStencilData();
+}
+
+// Copies the parts of the stencil state of the pipeline that are not set dynamically.
+void MVKDepthStencilCommandEncoderState::setStencilOpState(VkStencilOpState& vkStencil,
+                                                           const VkStencilOpState& vkSrcStencil) {
+    if ( !_cmdEncoder->supportsDynamicState(kMVKDynamicStateStencilOp) ) {
+        vkStencil.failOp = vkSrcStencil.failOp;
+        vkStencil.passOp = vkSrcStencil.passOp;
+        vkStencil.depthFailOp = vkSrcStencil.depthFailOp;
+        vkStencil.compareOp = vkSrcStencil.compareOp;
+    }
+    if ( !_cmdEncoder->supportsDynamicState(VK_DYNAMIC_STATE_STENCIL_COMPARE_MASK) ) {
+        vkStencil.compareMask = vkSrcStencil.compareMask;
+    }
+    if ( !_cmdEncoder->supportsDynamicState(VK_DYNAMIC_STATE_STENCIL_WRITE_MASK) ) {
+        vkStencil.writeMask = vkSrcStencil.writeMask;
+    }
+}
+
+// Derives the Metal depth stencil state from the Vulkan depth stencil state, and marks this instance dirty.
+void MVKDepthStencilCommandEncoderState::updateDepthStencilData() {
+
+    if (_depthTestEnabled) {
+        _depthStencilData.depthCompareFunction = mvkMTLCompareFunctionFromVkCompareOp(_depthCompareOp);
+        _depthStencilData.depthWriteEnabled = _depthWriteEnabled;
     } else {
         _depthStencilData.depthCompareFunction = kMVKMTLDepthStencilDescriptorDataDefault.depthCompareFunction;
         _depthStencilData.depthWriteEnabled = kMVKMTLDepthStencilDescriptorDataDefault.depthWriteEnabled;
     }
 
-    setStencilState(_depthStencilData.frontFaceStencilData, vkDepthStencilInfo.front, vkDepthStencilInfo.stencilTestEnable);
-    setStencilState(_depthStencilData.backFaceStencilData, vkDepthStencilInfo.back, vkDepthStencilInfo.stencilTestEnable);
+    setStencilState(_depthStencilData.frontFaceStencilData, _frontFaceStencil, _stencilTestEnabled);
+    setStencilState(_depthStencilData.backFaceStencilData, _backFaceStencil, _stencilTestEnabled);
 
     markDirty();
 }
@@ -283,12 +334,8 @@ void MVKDepthStencilCommandEncoderState::setStencilState(MVKMTLStencilDescriptor
     stencilInfo.stencilFailureOperation = mvkMTLStencilOperationFromVkStencilOp(vkStencil.failOp);
     stencilInfo.depthFailureOperation = mvkMTLStencilOperationFromVkStencilOp(vkStencil.depthFailOp);
     stencilInfo.depthStencilPassOperation = mvkMTLStencilOperationFromVkStencilOp(vkStencil.passOp);
-
-    bool useCompareMask = !_cmdEncoder->supportsDynamicState(VK_DYNAMIC_STATE_STENCIL_COMPARE_MASK);
-    if (useCompareMask) { stencilInfo.readMask = vkStencil.compareMask; }
-
-    bool useWriteMask = !_cmdEncoder->supportsDynamicState(VK_DYNAMIC_STATE_STENCIL_WRITE_MASK);
-    if (useWriteMask) { stencilInfo.writeMask = vkStencil.writeMask; }
+    stencilInfo.readMask = vkStencil.compareMask;
+    stencilInfo.writeMask = vkStencil.writeMask;
 }
 
 void MVKDepthStencilCommandEncoderState::setStencilCompareMask(VkStencilFaceFlags faceMask,
@@ -299,13 +346,13 @@ void MVKDepthStencilCommandEncoderState::setStencilCompareMask(VkStencilFaceFlag
            mvkIsAnyFlagEnabled(faceMask, VK_STENCIL_FRONT_AND_BACK)) ) { return; }
 
     if (mvkAreAllFlagsEnabled(faceMask, VK_STENCIL_FACE_FRONT_BIT)) {
-        _depthStencilData.frontFaceStencilData.readMask = stencilCompareMask;
+        _frontFaceStencil.compareMask = stencilCompareMask;
     }
     if (mvkAreAllFlagsEnabled(faceMask, VK_STENCIL_FACE_BACK_BIT)) {
-        _depthStencilData.backFaceStencilData.readMask = stencilCompareMask;
+        _backFaceStencil.compareMask = stencilCompareMask;
     }
 
-    markDirty();
+    updateDepthStencilData();
 }
 
 void MVKDepthStencilCommandEncoderState::setStencilWriteMask(VkStencilFaceFlags faceMask,
@@ -316,13 +363,65 @@ void MVKDepthStencilCommandEncoderState::setStencilWriteMask(VkStencilFaceFlags
            mvkIsAnyFlagEnabled(faceMask, VK_STENCIL_FRONT_AND_BACK)) ) { return; }
 
     if (mvkAreAllFlagsEnabled(faceMask, VK_STENCIL_FACE_FRONT_BIT)) {
-        _depthStencilData.frontFaceStencilData.writeMask = stencilWriteMask;
+        _frontFaceStencil.writeMask = stencilWriteMask;
     }
     if (mvkAreAllFlagsEnabled(faceMask, VK_STENCIL_FACE_BACK_BIT)) {
-        _depthStencilData.backFaceStencilData.writeMask = stencilWriteMask;
+        _backFaceStencil.writeMask = stencilWriteMask;
     }
 
-    markDirty();
+    updateDepthStencilData();
+}
+
+void MVKDepthStencilCommandEncoderState::setDepthTestEnable(VkBool32 depthTestEnable) {
+    if ( !_cmdEncoder->supportsDynamicState(kMVKDynamicStateDepthTestEnable) ) { return; }
+
+    _depthTestEnabled = depthTestEnable;
+    updateDepthStencilData();
+}
+
+void MVKDepthStencilCommandEncoderState::setDepthWriteEnable(VkBool32 depthWriteEnable) {
+    if ( !_cmdEncoder->supportsDynamicState(kMVKDynamicStateDepthWriteEnable) ) { return; }
+
+    _depthWriteEnabled = depthWriteEnable;
+    updateDepthStencilData();
+}
+
+void MVKDepthStencilCommandEncoderState::setDepthCompareOp(VkCompareOp depthCompareOp) {
+    if ( !_cmdEncoder->supportsDynamicState(kMVKDynamicStateDepthCompareOp) ) { return; }
+
+    _depthCompareOp = depthCompareOp;
+    updateDepthStencilData();
+}
+
+void MVKDepthStencilCommandEncoderState::setStencilTestEnable(VkBool32 stencilTestEnable) {
+    if ( !_cmdEncoder->supportsDynamicState(kMVKDynamicStateStencilTestEnable) ) { return; }
+
+    _stencilTestEnabled = stencilTestEnable;
+    updateDepthStencilData();
+}
+
+void MVKDepthStencilCommandEncoderState::setStencilOp(VkStencilFaceFlags faceMask,
+                                                      VkStencilOp failOp,
+                                                      VkStencilOp passOp,
+                                                      VkStencilOp depthFailOp,
+                                                      VkCompareOp compareOp) {
+
+    // If we can't set the state, or nothing is being set, just leave
+    if ( !(_cmdEncoder->supportsDynamicState(kMVKDynamicStateStencilOp) &&
+           mvkIsAnyFlagEnabled(faceMask, VK_STENCIL_FRONT_AND_BACK)) ) { return; }
+
+    VkStencilOpState* faceStencils[] = { &_frontFaceStencil, &_backFaceStencil };
+    VkStencilFaceFlags faceBits[] = { VK_STENCIL_FACE_FRONT_BIT, VK_STENCIL_FACE_BACK_BIT };
+    for (uint32_t faceIdx = 0; faceIdx < 2; faceIdx++) {
+        if (mvkAreAllFlagsEnabled(faceMask, faceBits[faceIdx])) {
+            faceStencils[faceIdx]->failOp = failOp;
+            faceStencils[faceIdx]->passOp = passOp;
+            faceStencils[faceIdx]->depthFailOp = depthFailOp;
+            faceStencils[faceIdx]->compareOp = compareOp;
+        }
+    }
+
+    updateDepthStencilData();
 }
 
 void MVKDepthStencilCommandEncoderState::beginMetalRenderPass() {
@@ -361,6 +460,12 @@ void MVKDepthStencilCommandEncoderState::encodeImpl(uint32_t stage) {
 
 void MVKDepthStencilCommandEncoderState::resetImpl() {
     _depthStencilData = kMVKMTLDepthStencilDescriptorDataDefault;
+    _frontFaceStencil = kMVKVkStencilOpStateDefault;
+    _backFaceStencil = kMVKVkStencilOpStateDefault;
+    _depthCompareOp = VK_COMPARE_OP_LESS;
+    _depthTestEnabled = false;
+    _depthWriteEnabled = false;
+    _stencilTestEnabled = false;
 	_hasDepthAttachment = false;
 	_hasStencilAttachment = false;
 }
@@ -488,6 +593,57 @@ void MVKBlendColorCommandEncoderState::resetImpl() {
 }
 
 
+#pragma mark -
+#pragma mark MVKRasterizingCommandEncoderState
+
+// Pipeline binding always marks this instance dirty, even if the primitive type is set
+// dynamically, because the pipeline determines whether points are rendered.
+void MVKRasterizingCommandEncoderState::setPrimitiveType(MTLPrimitiveType mtlPrimitiveType, bool isDynamic) {
+    if (_cmdEncoder->supportsDynamicState(kMVKDynamicStatePrimitiveTopology) == isDynamic) {
+        _mtlPrimitiveType = mtlPrimitiveType;
+    }
+    markDirty();
+}
+
+void MVKRasterizingCommandEncoderState::setCullMode(MTLCullMode mtlCullMode, bool isDynamic) {
+
+    // Abort if dynamic allowed but call is not dynamic, or vice-versa
+    if ( !(_cmdEncoder->supportsDynamicState(kMVKDynamicStateCullMode) == isDynamic) ) { return; }
+
+    _mtlCullMode = mtlCullMode;
+    markDirty();
+}
+
+void MVKRasterizingCommandEncoderState::setFrontFacingWinding(MTLWinding mtlFrontWinding, bool isDynamic) {
+
+    // Abort if dynamic allowed but call is not dynamic, or vice-versa
+    if ( !(_cmdEncoder->supportsDynamicState(kMVKDynamicStateFrontFace) == isDynamic) ) { return; }
+
+    _mtlFrontWinding = mtlFrontWinding;
+    markDirty();
+}
+
+// The primitive type is not Metal encoder state, and is used by the draw commands. A dynamic primitive
+// topology must be in the same topology class as the pipeline, so when a pipeline renders points,
+// either from a point topology, or from a point polygon mode, points are always rendered.
+void MVKRasterizingCommandEncoderState::encodeImpl(uint32_t stage) {
+    if (stage != kMVKGraphicsStageRasterization) { return; }
+
+    MVKGraphicsPipeline* gp = (MVKGraphicsPipeline*)_cmdEncoder->_graphicsPipelineState.getPipeline();
+    bool isRenderingPoints = gp && gp->getMTLPrimitiveType() == MTLPrimitiveTypePoint;
+    _cmdEncoder->_mtlPrimitiveType = isRenderingPoints ? MTLPrimitiveTypePoint : _mtlPrimitiveType;
+
+    [_cmdEncoder->_mtlRenderEncoder setCullMode: _mtlCullMode];
+    [_cmdEncoder->_mtlRenderEncoder setFrontFacingWinding: _mtlFrontWinding];
+}
+
+void MVKRasterizingCommandEncoderState::resetImpl() {
+    _mtlPrimitiveType = MTLPrimitiveTypePoint;
+    _mtlCullMode = MTLCullModeNone;
+    _mtlFrontWinding = MTLWindingClockwise;
+}
+
+
 #pragma mark -
 #pragma mark MVKResourcesCommandEncoderState
 
@@ -514,6 +670,151 @@ void MVKResourcesCommandEncoderState::assertMissingSwizzles(bool needsSwizzle, c
 	}
 }
 
+// Inline buffers must be bound individually. All other bindings can be bound as part of a range.
+static inline bool mvkCanBindInRange(const MVKMTLBufferBinding& b) { return !b.isInline; }
+static inline bool mvkCanBindInRange(const MVKMTLTextureBinding& b) { return true; }
+static inline bool mvkCanBindInRange(const MVKMTLSamplerStateBinding& b) { return true; }
+
+// Marks each dirty binding as no longer dirty, and encodes those that cannot be bound as part of
+// a range using singleOp. The remaining dirty bindings are sorted by index, and rangeOp is invoked
+// once for each run of bindings with contiguous indexes.
+template<class T, class S, class R>
+static void mvkEncodeDirtyBindingRanges(MVKVector<T>& bindings, S singleOp, R rangeOp) {
+	MVKVectorInline<T*, 32> dirtyBindings;
+	for (auto& b : bindings) {
+		if (b.isDirty) {
+			b.isDirty = false;
+			if (mvkCanBindInRange(b)) {
+				dirtyBindings.push_back(&b);
+			} else {
+				singleOp(b);
+			}
+		}
+	}
+
+	size_t bindCnt = dirtyBindings.size();
+	if (bindCnt == 0) { return; }
+
+	T** pBindings = dirtyBindings.data();
+	std::sort(pBindings, pBindings + bindCnt, [](T* b1, T* b2) { return b1->index < b2->index; });
+
+	size_t runStart = 0;
+	for (size_t bIdx = 1; bIdx <= bindCnt; bIdx++) {
+		if (bIdx == bindCnt || pBindings[bIdx]->index != pBindings[bIdx - 1]->index + 1) {
+			rangeOp(&pBindings[runStart], NSMakeRange(pBindings[runStart]->index, bIdx - runStart));
+			runStart = bIdx;
+		}
+	}
+}
+
+void MVKResourcesCommandEncoderState::encodeBufferBindings(MVKVector<MVKMTLBufferBinding>& bindings,
+														   bool& bindingsDirtyFlag,
+														   std::function<void(MVKCommandEncoder*, MVKMTLBufferBinding&)> mtlOperation,
+														   std::function<void(MVKCommandEncoder*, const id<MTLBuffer>*, const NSUInteger*, NSRange)> mtlRangeOperation,
+														   std::function<void(MVKCommandEncoder*, MVKMTLBufferBinding&)> mtlOffsetOperation) {
+	if ( !bindingsDirtyFlag ) { return; }
+	bindingsDirtyFlag = false;
+
+	// Buffers whose offset alone has changed are sorted along with the other dirty buffers,
+	// so that buffers rebound together, such as the vertex buffers of a single bind command,
+	// form one run of contiguous indexes, even when some of them only change offset.
+	MVKVectorInline<MVKMTLBufferBinding*, 32> dirtyBindings;
+	for (auto& b : bindings) {
+		if (b.isDirty || b.isOffsetDirty) {
+			if (mvkCanBindInRange(b)) {
+				dirtyBindings.push_back(&b);
+			} else {
+				b.isDirty = false;
+				b.isOffsetDirty = false;
+				mtlOperation(_cmdEncoder, b);
+			}
+		}
+	}
+
+	size_t bindCnt = dirtyBindings.size();
+	if (bindCnt == 0) { return; }
+
+	MVKMTLBufferBinding** pBindings = dirtyBindings.data();
+	std::sort(pBindings, pBindings + bindCnt, [](MVKMTLBufferBinding* b1, MVKMTLBufferBinding* b2) { return b1->index < b2->index; });
+
+	// A run containing any rebound buffer is encoded with one range operation. A run
+	// in which only offsets have changed is encoded using offset-only operations.
+	size_t runStart = 0;
+	bool isRunOffsetOnly = true;
+	for (size_t bIdx = 0; bIdx < bindCnt; bIdx++) {
+		isRunOffsetOnly = isRunOffsetOnly && !pBindings[bIdx]->isDirty;
+		if (bIdx + 1 < bindCnt && pBindings[bIdx + 1]->index == pBindings[bIdx]->index + 1) { continue; }
+
+		NSUInteger runLen = bIdx + 1 - runStart;
+		if (isRunOffsetOnly) {
+			for (size_t rIdx = runStart; rIdx <= bIdx; rIdx++) {
+				pBindings[rIdx]->isOffsetDirty = false;
+				mtlOffsetOperation(_cmdEncoder, *pBindings[rIdx]);
+			}
+		} else {
+			MVKVectorInline<id<MTLBuffer>, 16> mtlBuffs;
+			MVKVectorInline<NSUInteger, 16> offsets;
+			for (size_t rIdx = runStart; rIdx <= bIdx; rIdx++) {
+				pBindings[rIdx]->isDirty = false;
+				pBindings[rIdx]->isOffsetDirty = false;
+				mtlBuffs.push_back(pBindings[rIdx]->mtlBuffer);
+				offsets.push_back(pBindings[rIdx]->offset);
+			}
+			mtlRangeOperation(_cmdEncoder, mtlBuffs.data(), offsets.data(), NSMakeRange(pBindings[runStart]->index, runLen));
+		}
+		runStart = bIdx + 1;
+		isRunOffsetOnly = true;
+	}
+}
+
+void MVKResourcesCommandEncoderState::encodeTextureBindings(MVKVector<MVKMTLTextureBinding>& bindings,
+															bool& bindingsDirtyFlag,
+															std::function<void(MVKCommandEncoder*, const id<MTLTexture>*, NSRange)> mtlRangeOperation) {
+	if ( !bindingsDirtyFlag ) { return; }
+	bindingsDirtyFlag = false;
+
+	mvkEncodeDirtyBindingRanges(bindings,
+								[](MVKMTLTextureBinding& b) {},
+								[&](MVKMTLTextureBinding** pBindings, NSRange range) {
+									MVKVectorInline<id<MTLTexture>, 16> mtlTexs;
+									for (NSUInteger bIdx = 0; bIdx < range.length; bIdx++) {
+										mtlTexs.push_back(pBindings[bIdx]->mtlTexture);
+									}
+									mtlRangeOperation(_cmdEncoder, mtlTexs.data(), range);
+								});
+}
+
+void MVKResourcesCommandEncoderState::encodeSamplerStateBindings(MVKVector<MVKMTLSamplerStateBinding>& bindings,
+																 bool& bindingsDirtyFlag,
+																 std::function<void(MVKCommandEncoder*, const id<MTLSamplerState>*, NSRange)> mtlRangeOperation) {
+	if ( !bindingsDirtyFlag ) { return; }
+	bindingsDirtyFlag = false;
+
+	mvkEncodeDirtyBindingRanges(bindings,
+								[](MVKMTLSamplerStateBinding& b) {},
+								[&](MVKMTLSamplerStateBinding** pBindings, NSRange range) {
+									MVKVectorInline<id<MTLSamplerState>, 16> mtlSamps;
+									for (NSUInteger bIdx = 0; bIdx < range.length; bIdx++) {
+										mtlSamps.push_back(pBindings[bIdx]->mtlSamplerState);
+									}
+									mtlRangeOperation(_cmdEncoder, mtlSamps.data(), range);
+								});
+}
+
+void MVKResourcesCommandEncoderState::encodeResourceUsages(MVKVector<MVKMTLResourceUsage>& usages,
+														   bool& usagesDirtyFlag,
+														   std::function<void(MVKCommandEncoder*, id<MTLResource>, MTLResourceUsage)> mtlOperation) {
+	if ( !usagesDirtyFlag ) { return; }
+	usagesDirtyFlag = false;
+
+	for (auto& u : usages) {
+		if (u.isDirty) {
+			mtlOperation(_cmdEncoder, u.mtlResource, u.mtlUsage);
+			u.isDirty = false;
+		}
+	}
+}
+
 
 #pragma mark -
 #pragma mark MVKGraphicsResourcesCommandEncoderState
@@ -530,6 +831,22 @@ void MVKGraphicsResourcesCommandEncoderState::bindSamplerState(MVKShaderStage st
     bind(binding, _shaderStages[stage].samplerStateBindings, _shaderStages[stage].areSamplerStateBindingsDirty);
 }
 
+void MVKGraphicsResourcesCommandEncoderState::bindBuffers(MVKShaderStage stage, const MVKMTLBufferBinding* pBindings, uint32_t count, uint32_t firstIndex) {
+    bindRange(pBindings, count, firstIndex, _shaderStages[stage].bufferBindings, _shaderStages[stage].areBufferBindingsDirty);
+}
+
+void MVKGraphicsResourcesCommandEncoderState::bindTextures(MVKShaderStage stage, const MVKMTLTextureBinding* pBindings, uint32_t count, uint32_t firstIndex) {
+    bindRange(pBindings, count, firstIndex, _shaderStages[stage].textureBindings, _shaderStages[stage].areTextureBindingsDirty, _shaderStages[stage].needsSwizzle);
+}
+
+void MVKGraphicsResourcesCommandEncoderState::bindSamplerStates(MVKShaderStage stage, const MVKMTLSamplerStateBinding* pBindings, uint32_t count, uint32_t firstIndex) {
+    bindRange(pBindings, count, firstIndex, _shaderStages[stage].samplerStateBindings, _shaderStages[stage].areSamplerStateBindingsDirty);
+}
+
+void MVKGraphicsResourcesCommandEncoderState::useResource(MVKShaderStage stage, const MVKMTLResourceUsage& usage) {
+    use(usage, _shaderStages[stage].resourceUsages, _shaderStages[stage].resourceUsageIndexes, _shaderStages[stage].areResourceUsagesDirty);
+}
+
 void MVKGraphicsResourcesCommandEncoderState::bindSwizzleBuffer(const MVKShaderImplicitRezBinding& binding,
 																bool needVertexSwizzleBuffer,
 																bool needTessCtlSwizzleBuffer,
@@ -562,11 +879,14 @@ void MVKGraphicsResourcesCommandEncoderState::encodeBindings(MVKShaderStage stag
                                                              const char* pStageName,
                                                              bool fullImageViewSwizzle,
                                                              std::function<void(MVKCommandEncoder*, MVKMTLBufferBinding&)> bindBuffer,
+                                                             std::function<void(MVKCommandEncoder*, const id<MTLBuffer>*, const NSUInteger*, NSRange)> bindBuffers,
+                                                             std::function<void(MVKCommandEncoder*, MVKMTLBufferBinding&)> bindBufferOffset,
                                                              std::function<void(MVKCommandEncoder*, MVKMTLBufferBinding&, MVKVector<uint32_t>&)> bindImplicitBuffer,
-                                                             std::function<void(MVKCommandEncoder*, MVKMTLTextureBinding&)> bindTexture,
-                                                             std::function<void(MVKCommandEncoder*, MVKMTLSamplerStateBinding&)> bindSampler) {
+                                                             std::function<void(MVKCommandEncoder*, const id<MTLTexture>*, NSRange)> bindTextures,
+                                                             std::function<void(MVKCommandEncoder*, const id<MTLSamplerState>*, NSRange)> bindSamplers,
+                                                             std::function<void(MVKCommandEncoder*, id<MTLResource>, MTLResourceUsage)> useResource) {
     auto& shaderStage = _shaderStages[stage];
-    encodeBinding<MVKMTLBufferBinding>(shaderStage.bufferBindings, shaderStage.areBufferBindingsDirty, bindBuffer);
+    encodeBufferBindings(shaderStage.bufferBindings, shaderStage.areBufferBindingsDirty, bindBuffer, bindBuffers, bindBufferOffset);
 
     if (shaderStage.swizzleBufferBinding.isDirty) {
 
@@ -588,8 +908,9 @@ void MVKGraphicsResourcesCommandEncoderState::encodeBindings(MVKShaderStage stag
         bindImplicitBuffer(_cmdEncoder, shaderStage.bufferSizeBufferBinding, shaderStage.bufferSizes);
     }
 
-    encodeBinding<MVKMTLTextureBinding>(shaderStage.textureBindings, shaderStage.areTextureBindingsDirty, bindTexture);
-    encodeBinding<MVKMTLSamplerStateBinding>(shaderStage.samplerStateBindings, shaderStage.areSamplerStateBindingsDirty, bindSampler);
+    encodeTextureBindings(shaderStage.textureBindings, shaderStage.areTextureBindingsDirty, bindTextures);
+    encodeSamplerStateBindings(shaderStage.samplerStateBindings, shaderStage.areSamplerStateBindingsDirty, bindSamplers);
+    encodeResourceUsages(shaderStage.resourceUsages, shaderStage.areResourceUsagesDirty, useResource);
 }
 
 // Mark everything as dirty
@@ -599,6 +920,7 @@ void MVKGraphicsResourcesCommandEncoderState::markDirty() {
         MVKResourcesCommandEncoderState::markDirty(_shaderStages[i].bufferBindings, _shaderStages[i].areBufferBindingsDirty);
         MVKResourcesCommandEncoderState::markDirty(_shaderStages[i].textureBindings, _shaderStages[i].areTextureBindingsDirty);
         MVKResourcesCommandEncoderState::markDirty(_shaderStages[i].samplerStateBindings, _shaderStages[i].areSamplerStateBindingsDirty);
+        MVKResourcesCommandEncoderState::markDirty(_shaderStages[i].resourceUsages, _shaderStages[i].areResourceUsagesDirty);
     }
 }
 
@@ -611,15 +933,19 @@ void MVKGraphicsResourcesCommandEncoderState::encodeImpl(uint32_t stage) {
     if (stage == (forTessellation ? kMVKGraphicsStageVertex : kMVKGraphicsStageRasterization)) {
         encodeBindings(kMVKShaderStageVertex, "vertex", fullImageViewSwizzle,
                        [](MVKCommandEncoder* cmdEncoder, MVKMTLBufferBinding& b)->void {
-                           if (b.isInline)
-                               cmdEncoder->setVertexBytes(cmdEncoder->_mtlRenderEncoder,
-                                                          b.mtlBytes,
-                                                          b.size,
-                                                          b.index);
-                           else
-                               [cmdEncoder->_mtlRenderEncoder setVertexBuffer: b.mtlBuffer
-                                                                       offset: b.offset
-                                                                      atIndex: b.index];
+                           cmdEncoder->setVertexBytes(cmdEncoder->_mtlRenderEncoder,
+                                                      b.mtlBytes,
+                                                      b.size,
+                                                      b.index);
+                       },
+                       [](MVKCommandEncoder* cmdEncoder, const id<MTLBuffer>* mtlBuffs, const NSUInteger* offsets, NSRange range)->void {
+                           [cmdEncoder->_mtlRenderEncoder setVertexBuffers: mtlBuffs
+                                                                   offsets: offsets
+                                                                 withRange: range];
+                       },
+                       [](MVKCommandEncoder* cmdEncoder, MVKMTLBufferBinding& b)->void {
+                           [cmdEncoder->_mtlRenderEncoder setVertexBufferOffset: b.offset
+                                                                        atIndex: b.index];
                        },
                        [](MVKCommandEncoder* cmdEncoder, MVKMTLBufferBinding& b, MVKVector<uint32_t>& s)->void {
                            cmdEncoder->setVertexBytes(cmdEncoder->_mtlRenderEncoder,
@@ -627,13 +953,16 @@ void MVKGraphicsResourcesCommandEncoderState::encodeImpl(uint32_t stage) {
                                                       s.size() * sizeof(uint32_t),
                                                       b.index);
                        },
-                       [](MVKCommandEncoder* cmdEncoder, MVKMTLTextureBinding& b)->void {
-                           [cmdEncoder->_mtlRenderEncoder setVertexTexture: b.mtlTexture
-                                                                   atIndex: b.index];
+                       [](MVKCommandEncoder* cmdEncoder, const id<MTLTexture>* mtlTexs, NSRange range)->void {
+                           [cmdEncoder->_mtlRenderEncoder setVertexTextures: mtlTexs
+                                                                  withRange: range];
                        },
-                       [](MVKCommandEncoder* cmdEncoder, MVKMTLSamplerStateBinding& b)->void {
-                           [cmdEncoder->_mtlRenderEncoder setVertexSamplerState: b.mtlSamplerState
-                                                                        atIndex: b.index];
+                       [](MVKCommandEncoder* cmdEncoder, const id<MTLSamplerState>* mtlSamps, NSRange range)->void {
+                           [cmdEncoder->_mtlRenderEncoder setVertexSamplerStates: mtlSamps
+                                                                       withRange: range];
+                       },
+                       [](MVKCommandEncoder* cmdEncoder, id<MTLResource> mtlRez, MTLResourceUsage mtlUsage)->void {
+                           [cmdEncoder->_mtlRenderEncoder useResource: mtlRez usage: mtlUsage];
                        });
 
     }
@@ -641,15 +970,19 @@ void MVKGraphicsResourcesCommandEncoderState::encodeImpl(uint32_t stage) {
     if (stage == kMVKGraphicsStageTessControl) {
         encodeBindings(kMVKShaderStageTessCtl, "tessellation control", fullImageViewSwizzle,
                        [](MVKCommandEncoder* cmdEncoder, MVKMTLBufferBinding& b)->void {
-                           if (b.isInline)
-                               cmdEncoder->setComputeBytes(cmdEncoder->getMTLComputeEncoder(kMVKCommandUseTessellationControl),
-                                                           b.mtlBytes,
-                                                           b.size,
-                                                           b.index);
-                           else
-                               [cmdEncoder->getMTLComputeEncoder(kMVKCommandUseTessellationControl) setBuffer: b.mtlBuffer
-                                                                                                       offset: b.offset
-                                                                                                      atIndex: b.index];
+                           cmdEncoder->setComputeBytes(cmdEncoder->getMTLComputeEncoder(kMVKCommandUseTessellationControl),
+                                                       b.mtlBytes,
+                                                       b.size,
+                                                       b.index);
+                       },
+                       [](MVKCommandEncoder* cmdEncoder, const id<MTLBuffer>* mtlBuffs, const NSUInteger* offsets, NSRange range)->void {
+                           [cmdEncoder->getMTLComputeEncoder(kMVKCommandUseTessellationControl) setBuffers: mtlBuffs
+                                                                                                   offsets: offsets
+                                                                                                 withRange: range];
+                       },
+                       [](MVKCommandEncoder* cmdEncoder, MVKMTLBufferBinding& b)->void {
+                           [cmdEncoder->getMTLComputeEncoder(kMVKCommandUseTessellationControl) setBufferOffset: b.offset
+                                                                                                        atIndex: b.index];
                        },
                        [](MVKCommandEncoder* cmdEncoder, MVKMTLBufferBinding& b, MVKVector<uint32_t>& s)->void {
                            cmdEncoder->setComputeBytes(cmdEncoder->getMTLComputeEncoder(kMVKCommandUseTessellationControl),
@@ -657,13 +990,16 @@ void MVKGraphicsResourcesCommandEncoderState::encodeImpl(uint32_t stage) {
                                                        s.size() * sizeof(uint32_t),
                                                        b.index);
                        },
-                       [](MVKCommandEncoder* cmdEncoder, MVKMTLTextureBinding& b)->void {
-                           [cmdEncoder->getMTLComputeEncoder(kMVKCommandUseTessellationControl) setTexture: b.mtlTexture
-                                                                                                   atIndex: b.index];
+                       [](MVKCommandEncoder* cmdEncoder, const id<MTLTexture>* mtlTexs, NSRange range)->void {
+                           [cmdEncoder->getMTLComputeEncoder(kMVKCommandUseTessellationControl) setTextures: mtlTexs
+                                                                                                  withRange: range];
                        },
-                       [](MVKCommandEncoder* cmdEncoder, MVKMTLSamplerStateBinding& b)->void {
-                           [cmdEncoder->getMTLComputeEncoder(kMVKCommandUseTessellationControl) setSamplerState: b.mtlSamplerState
-                                                                                                        atIndex: b.index];
+                       [](MVKCommandEncoder* cmdEncoder, const id<MTLSamplerState>* mtlSamps, NSRange range)->void {
+                           [cmdEncoder->getMTLComputeEncoder(kMVKCommandUseTessellationControl) setSamplerStates: mtlSamps
+                                                                                                       withRange: range];
+                       },
+                       [](MVKCommandEncoder* cmdEncoder, id<MTLResource> mtlRez, MTLResourceUsage mtlUsage)->void {
+                           [cmdEncoder->getMTLComputeEncoder(kMVKCommandUseTessellationControl) useResource: mtlRez usage: mtlUsage];
                        });
 
     }
@@ -671,15 +1007,19 @@ void MVKGraphicsResourcesCommandEncoderState::encodeImpl(uint32_t stage) {
     if (forTessellation && stage == kMVKGraphicsStageRasterization) {
         encodeBindings(kMVKShaderStageTessEval, "tessellation evaluation", fullImageViewSwizzle,
                        [](MVKCommandEncoder* cmdEncoder, MVKMTLBufferBinding& b)->void {
-                           if (b.isInline)
-                               cmdEncoder->setVertexBytes(cmdEncoder->_mtlRenderEncoder,
-                                                          b.mtlBytes,
-                                                          b.size,
-                                                          b.index);
-                           else
-                               [cmdEncoder->_mtlRenderEncoder setVertexBuffer: b.mtlBuffer
-                                                                       offset: b.offset
-                                                                      atIndex: b.index];
+                           cmdEncoder->setVertexBytes(cmdEncoder->_mtlRenderEncoder,
+                                                      b.mtlBytes,
+                                                      b.size,
+                                                      b.index);
+                       },
+                       [](MVKCommandEncoder* cmdEncoder, const id<MTLBuffer>* mtlBuffs, const NSUInteger* offsets, NSRange range)->void {
+                           [cmdEncoder->_mtlRenderEncoder setVertexBuffers: mtlBuffs
+                                                                   offsets: offsets
+                                                                 withRange: range];
+                       },
+                       [](MVKCommandEncoder* cmdEncoder, MVKMTLBufferBinding& b)->void {
+                           [cmdEncoder->_mtlRenderEncoder setVertexBufferOffset: b.offset
+                                                                        atIndex: b.index];
                        },
                        [](MVKCommandEncoder* cmdEncoder, MVKMTLBufferBinding& b, MVKVector<uint32_t>& s)->void {
                            cmdEncoder->setVertexBytes(cmdEncoder->_mtlRenderEncoder,
@@ -687,13 +1027,16 @@ void MVKGraphicsResourcesCommandEncoderState::encodeImpl(uint32_t stage) {
                                                       s.size() * sizeof(uint32_t),
                                                       b.index);
                        },
-                       [](MVKCommandEncoder* cmdEncoder, MVKMTLTextureBinding& b)->void {
-                           [cmdEncoder->_mtlRenderEncoder setVertexTexture: b.mtlTexture
-                                                                   atIndex: b.index];
+                       [](MVKCommandEncoder* cmdEncoder, const id<MTLTexture>* mtlTexs, NSRange range)->void {
+                           [cmdEncoder->_mtlRenderEncoder setVertexTextures: mtlTexs
+                                                                  withRange: range];
                        },
-                       [](MVKCommandEncoder* cmdEncoder, MVKMTLSamplerStateBinding& b)->void {
-                           [cmdEncoder->_mtlRenderEncoder setVertexSamplerState: b.mtlSamplerState
-                                                                        atIndex: b.index];
+                       [](MVKCommandEncoder* cmdEncoder, const id<MTLSamplerState>* mtlSamps, NSRange range)->void {
+                           [cmdEncoder->_mtlRenderEncoder setVertexSamplerStates: mtlSamps
+                                                                       withRange: range];
+                       },
+                       [](MVKCommandEncoder* cmdEncoder, id<MTLResource> mtlRez, MTLResourceUsage mtlUsage)->void {
+                           [cmdEncoder->_mtlRenderEncoder useResource: mtlRez usage: mtlUsage];
                        });
 
     }
@@ -701,15 +1044,19 @@ void MVKGraphicsResourcesCommandEncoderState::encodeImpl(uint32_t stage) {
     if (stage == kMVKGraphicsStageRasterization) {
         encodeBindings(kMVKShaderStageFragment, "fragment", fullImageViewSwizzle,
                        [](MVKCommandEncoder* cmdEncoder, MVKMTLBufferBinding& b)->void {
-                           if (b.isInline)
-                               cmdEncoder->setFragmentBytes(cmdEncoder->_mtlRenderEncoder,
-                                                            b.mtlBytes,
-                                                            b.size,
-                                                            b.index);
-                           else
-                               [cmdEncoder->_mtlRenderEncoder setFragmentBuffer: b.mtlBuffer
-                                                                         offset: b.offset
-                                                                        atIndex: b.index];
+                           cmdEncoder->setFragmentBytes(cmdEncoder->_mtlRenderEncoder,
+                                                        b.mtlBytes,
+                                                        b.size,
+                                                        b.index);
+                       },
+                       [](MVKCommandEncoder* cmdEncoder, const id<MTLBuffer>* mtlBuffs, const NSUInteger* offsets, NSRange range)->void {
+                           [cmdEncoder->_mtlRenderEncoder setFragmentBuffers: mtlBuffs
+                                                                     offsets: offsets
+                                                                   withRange: range];
+                       },
+                       [](MVKCommandEncoder* cmdEncoder, MVKMTLBufferBinding& b)->void {
+                           [cmdEncoder->_mtlRenderEncoder setFragmentBufferOffset: b.offset
+                                                                          atIndex: b.index];
                        },
                        [](MVKCommandEncoder* cmdEncoder, MVKMTLBufferBinding& b, MVKVector<uint32_t>& s)->void {
                            cmdEncoder->setFragmentBytes(cmdEncoder->_mtlRenderEncoder,
@@ -717,13 +1064,16 @@ void MVKGraphicsResourcesCommandEncoderState::encodeImpl(uint32_t stage) {
                                                         s.size() * sizeof(uint32_t),
                                                         b.index);
                        },
-                       [](MVKCommandEncoder* cmdEncoder, MVKMTLTextureBinding& b)->void {
-                           [cmdEncoder->_mtlRenderEncoder setFragmentTexture: b.mtlTexture
-                                                                     atIndex: b.index];
+                       [](MVKCommandEncoder* cmdEncoder, const id<MTLTexture>* mtlTexs, NSRange range)->void {
+                           [cmdEncoder->_mtlRenderEncoder setFragmentTextures: mtlTexs
+                                                                    withRange: range];
                        },
-                       [](MVKCommandEncoder* cmdEncoder, MVKMTLSamplerStateBinding& b)->void {
-                           [cmdEncoder->_mtlRenderEncoder setFragmentSamplerState: b.mtlSamplerState
-                                                                          atIndex: b.index];
+                       [](MVKCommandEncoder* cmdEncoder, const id<MTLSamplerState>* mtlSamps, NSRange range)->void {
+                           [cmdEncoder->_mtlRenderEncoder setFragmentSamplerStates: mtlSamps
+                                                                         withRange: range];
+                       },
+                       [](MVKCommandEncoder* cmdEncoder, id<MTLResource> mtlRez, MTLResourceUsage mtlUsage)->void {
+                           [cmdEncoder->_mtlRenderEncoder useResource: mtlRez usage: mtlUsage];
                        });
     }
 }
@@ -733,12 +1083,15 @@ void MVKGraphicsResourcesCommandEncoderState::resetImpl() {
         _shaderStages[i].bufferBindings.clear();
         _shaderStages[i].textureBindings.clear();
         _shaderStages[i].samplerStateBindings.clear();
+        _shaderStages[i].resourceUsages.clear();
+        _shaderStages[i].resourceUsageIndexes.clear();
         _shaderStages[i].swizzleConstants.clear();
         _shaderStages[i].bufferSizes.clear();
 
         _shaderStages[i].areBufferBindingsDirty = false;
         _shaderStages[i].areTextureBindingsDirty = false;
         _shaderStages[i].areSamplerStateBindingsDirty = false;
+        _shaderStages[i].areResourceUsagesDirty = false;
         _shaderStages[i].swizzleBufferBinding.isDirty = false;
         _shaderStages[i].bufferSizeBufferBinding.isDirty = false;
 
@@ -762,6 +1115,22 @@ void MVKComputeResourcesCommandEncoderState::bindSamplerState(const MVKMTLSample
     bind(binding, _samplerStateBindings, _areSamplerStateBindingsDirty);
 }
 
+void MVKComputeResourcesCommandEncoderState::bindBuffers(const MVKMTLBufferBinding* pBindings, uint32_t count, uint32_t firstIndex) {
+    bindRange(pBindings, count, firstIndex, _bufferBindings, _areBufferBindingsDirty);
+}
+
+void MVKComputeResourcesCommandEncoderState::bindTextures(const MVKMTLTextureBinding* pBindings, uint32_t count, uint32_t firstIndex) {
+    bindRange(pBindings, count, firstIndex, _textureBindings, _areTextureBindingsDirty, _needsSwizzle);
+}
+
+void MVKComputeResourcesCommandEncoderState::bindSamplerStates(const MVKMTLSamplerStateBinding* pBindings, uint32_t count, uint32_t firstIndex) {
+    bindRange(pBindings, count, firstIndex, _samplerStateBindings, _areSamplerStateBindingsDirty);
+}
+
+void MVKComputeResourcesCommandEncoderState::useResource(const MVKMTLResourceUsage& usage) {
+    use(usage, _resourceUsages, _resourceUsageIndexes, _areResourceUsagesDirty);
+}
+
 void MVKComputeResourcesCommandEncoderState::bindSwizzleBuffer(const MVKShaderImplicitRezBinding& binding,
 															   bool needSwizzleBuffer) {
     _swizzleBufferBinding.index = binding.stages[kMVKShaderStageCompute];
@@ -780,6 +1149,7 @@ void MVKComputeResourcesCommandEncoderState::markDirty() {
     MVKResourcesCommandEncoderState::markDirty(_bufferBindings, _areBufferBindingsDirty);
     MVKResourcesCommandEncoderState::markDirty(_textureBindings, _areTextureBindingsDirty);
     MVKResourcesCommandEncoderState::markDirty(_samplerStateBindings, _areSamplerStateBindingsDirty);
+    MVKResourcesCommandEncoderState::markDirty(_resourceUsages, _areResourceUsagesDirty);
 }
 
 void MVKComputeResourcesCommandEncoderState::encodeImpl(uint32_t) {
@@ -789,18 +1159,22 @@ void MVKComputeResourcesCommandEncoderState::encodeImpl(uint32_t) {
     if (pipeline)
         fullImageViewSwizzle = pipeline->fullImageViewSwizzle();
 
-    encodeBinding<MVKMTLBufferBinding>(_bufferBindings, _areBufferBindingsDirty,
-									   [](MVKCommandEncoder* cmdEncoder, MVKMTLBufferBinding& b)->void {
-											if (b.isInline)
-												cmdEncoder->setComputeBytes(cmdEncoder->getMTLComputeEncoder(kMVKCommandUseDispatch),
-																			b.mtlBytes,
-																			b.size,
-																			b.index);
-											else
-												[cmdEncoder->getMTLComputeEncoder(kMVKCommandUseDispatch) setBuffer: b.mtlBuffer
-																											 offset: b.offset
-																											atIndex: b.index];
-                                       });
+    encodeBufferBindings(_bufferBindings, _areBufferBindingsDirty,
+                         [](MVKCommandEncoder* cmdEncoder, MVKMTLBufferBinding& b)->void {
+                             cmdEncoder->setComputeBytes(cmdEncoder->getMTLComputeEncoder(kMVKCommandUseDispatch),
+                                                         b.mtlBytes,
+                                                         b.size,
+                                                         b.index);
+                         },
+                         [](MVKCommandEncoder* cmdEncoder, const id<MTLBuffer>* mtlBuffs, const NSUInteger* offsets, NSRange range)->void {
+                             [cmdEncoder->getMTLComputeEncoder(kMVKCommandUseDispatch) setBuffers: mtlBuffs
+                                                                                          offsets: offsets
+                                                                                        withRange: range];
+                         },
+                         [](MVKCommandEncoder* cmdEncoder, MVKMTLBufferBinding& b)->void {
+                             [cmdEncoder->getMTLComputeEncoder(kMVKCommandUseDispatch) setBufferOffset: b.offset
+                                                                                               atIndex: b.index];
+                         });
 
     if (_swizzleBufferBinding.isDirty) {
 
@@ -829,29 +1203,37 @@ void MVKComputeResourcesCommandEncoderState::encodeImpl(uint32_t) {
 
     }
 
-    encodeBinding<MVKMTLTextureBinding>(_textureBindings, _areTextureBindingsDirty,
-                                        [](MVKCommandEncoder* cmdEncoder, MVKMTLTextureBinding& b)->void {
-                                            [cmdEncoder->getMTLComputeEncoder(kMVKCommandUseDispatch) setTexture: b.mtlTexture
-																										 atIndex: b.index];
-                                        });
-
-    encodeBinding<MVKMTLSamplerStateBinding>(_samplerStateBindings, _areSamplerStateBindingsDirty,
-                                             [](MVKCommandEncoder* cmdEncoder, MVKMTLSamplerStateBinding& b)->void {
-                                                 [cmdEncoder->getMTLComputeEncoder(kMVKCommandUseDispatch) setSamplerState: b.mtlSamplerState
-																												   atIndex: b.index];
-                                             });
+    encodeTextureBindings(_textureBindings, _areTextureBindingsDirty,
+                          [](MVKCommandEncoder* cmdEncoder, const id<MTLTexture>* mtlTexs, NSRange range)->void {
+                              [cmdEncoder->getMTLComputeEncoder(kMVKCommandUseDispatch) setTextures: mtlTexs
+                                                                                          withRange: range];
+                          });
+
+    encodeSamplerStateBindings(_samplerStateBindings, _areSamplerStateBindingsDirty,
+                               [](MVKCommandEncoder* cmdEncoder, const id<MTLSamplerState>* mtlSamps, NSRange range)->void {
+                                   [cmdEncoder->getMTLComputeEncoder(kMVKCommandUseDispatch) setSamplerStates: mtlSamps
+                                                                                                    withRange: range];
+                               });
+
+    encodeResourceUsages(_resourceUsages, _areResourceUsagesDirty,
+                         [](MVKCommandEncoder* cmdEncoder, id<MTLResource> mtlRez, MTLResourceUsage mtlUsage)->void {
+                             [cmdEncoder->getMTLComputeEncoder(kMVKCommandUseDispatch) useResource: mtlRez usage: mtlUsage];
+                         });
 }
 
 void MVKComputeResourcesCommandEncoderState::resetImpl() {
     _bufferBindings.clear();
     _textureBindings.clear();
     _samplerStateBindings.clear();
+    _resourceUsages.clear();
+    _resourceUsageIndexes.clear();
     _swizzleConstants.clear();
     _bufferSizes.clear();
 
     _areBufferBindingsDirty = false;
     _areTextureBindingsDirty = false;
     _areSamplerStateBindingsDirty = false;
+    _areResourceUsagesDirty = false;
     _swizzleBufferBinding.isDirty = false;
     _bufferSizeBufferBinding.isDirty = false;
 
@@ -20,7 +20,8 @@
 
 #include "MVKCommandResourceFactory.h"
 #include "MVKMTLBufferAllocation.h"
-#include <unordered_map>
+#include "MVKSync.h"
+#include "MVKFlatHashMap.h"
 #include <mutex>
 
 #import <Metal/Metal.h>
@@ -29,6 +30,155 @@
 class MVKCommandPool;
 
 
+#pragma mark -
+#pragma mark MVKConvertedIndexBufferKey
+
+/**
+ * Identifies the indices of an indexed tessellated draw, converted from the content of an index buffer.
+ * Instances of this structure can be used as a map key.
+ */
+typedef struct MVKConvertedIndexBufferKey {
+	uint64_t contentGeneration;		/**< Identifies the index buffer, and the version of its content. */
+	uint64_t offset;				/**< The offset of the indices within the index buffer. */
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	uint32_t instanceCount;
+	uint32_t mtlIndexType;			/**< The index type (interpreted as MTLIndexType). */
+	uint32_t inControlPointCount;
+	uint32_t outControlPointCount;
+
+	bool operator==(const MVKConvertedIndexBufferKey& rhs) const { return mvkAreEqual(this, &rhs); }
+
+	std::size_t hash() const {
+		return mvkHash(this);
+	}
+
+} __attribute__((aligned(sizeof(uint64_t)))) MVKConvertedIndexBufferKey;
+
+namespace std {
+	template <>
+	struct hash<MVKConvertedIndexBufferKey> {
+		std::size_t operator()(const MVKConvertedIndexBufferKey& k) const { return k.hash(); }
+	};
+}
+
+
+#pragma mark -
+#pragma mark MVKTransferResource
+
+/**
+ * A temporary image or buffer used during transfers, along with the generation of the last
+ * MTLCommandBuffer whose commands use it. The resource can be destroyed once that generation
+ * has been retired by the completion of its MTLCommandBuffer.
+ */
+typedef struct MVKTransferResource {
+	MVKImage* mvkImage = nullptr;
+	MVKBuffer* mvkBuffer = nullptr;
+	MVKDeviceMemory* mvkMemory = nullptr;
+	uint64_t generation = 0;
+	VkDeviceSize byteCount = 0;
+} MVKTransferResource;
+
+
+#pragma mark -
+#pragma mark MVKCommandEncodingCache
+
+/**
+ * A device-wide cache of the Metal pipeline and depth-stencil states used by commands whose
+ * functionality is realized through render or compute pipelines. These states depend only on
+ * their configuration, so they can be shared by all command pools on a device, and each is
+ * created only once, regardless of how many command pools use it.
+ *
+ * Each command encoding pool keeps its own front cache of the states it has retrieved from
+ * this cache, so this cache is only consulted the first time a command pool needs a state.
+ *
+ * The cached states are owned by this cache, and remain valid until the device is destroyed.
+ * Access to the content within this cache is thread-safe.
+ */
+class MVKCommandEncodingCache : public MVKBaseDeviceObject {
+
+public:
+
+	/** Returns the Vulkan API opaque object controlling this object. */
+	MVKVulkanAPIObject* getVulkanAPIObject() override { return _device->getVulkanAPIObject(); };
+
+#pragma mark Command resources
+
+	/** Returns a MTLRenderPipelineState to support certain Vulkan BLIT commands. */
+	id<MTLRenderPipelineState> getCmdBlitImageMTLRenderPipelineState(MVKRPSKeyBlitImg& blitKey,
+																	 MVKVulkanAPIDeviceObject* owner);
+
+	/**
+	 * Returns a MTLRenderPipelineState dedicated to rendering to several attachments
+	 * to support clearing regions of those attachments.
+	 */
+	id<MTLRenderPipelineState> getCmdClearMTLRenderPipelineState(MVKRPSKeyClearAtt& attKey,
+																 MVKVulkanAPIDeviceObject* owner);
+
+	/**
+	 * Returns a MTLDepthStencilState dedicated to rendering to several attachments
+	 * to support clearing regions of those attachments.
+	 */
+	id<MTLDepthStencilState> getMTLDepthStencilState(bool useDepth, bool useStencil);
+
+	/** Returns a MTLDepthStencilState configured from the specified data. */
+	id<MTLDepthStencilState> getMTLDepthStencilState(MVKMTLDepthStencilDescriptorData& dsData);
+
+	/** Returns a MTLComputePipelineState for copying between two buffers with byte-aligned copy regions. */
+	id<MTLComputePipelineState> getCmdCopyBufferBytesMTLComputePipelineState(MVKVulkanAPIDeviceObject* owner);
+
+	/** Returns a MTLComputePipelineState for filling a buffer. */
+	id<MTLComputePipelineState> getCmdFillBufferMTLComputePipelineState(MVKVulkanAPIDeviceObject* owner);
+
+	/** Returns a MTLComputePipelineState for decompressing a buffer into a 3D image. */
+	id<MTLComputePipelineState> getCmdCopyBufferToImage3DDecompressMTLComputePipelineState(bool needsTempBuff,
+																						   MVKVulkanAPIDeviceObject* owner);
+
+	/** Returns a MTLComputePipelineState for converting depth content between buffers holding different depth formats. */
+	id<MTLComputePipelineState> getCmdConvertDepthBufferMTLComputePipelineState(MVKVulkanAPIDeviceObject* owner);
+
+	/** Returns a MTLComputePipelineState for converting an indirect buffer for use in a tessellated draw. */
+	id<MTLComputePipelineState> getCmdDrawIndirectConvertBuffersMTLComputePipelineState(bool indexed,
+																						MVKVulkanAPIDeviceObject* owner);
+
+	/** Returns a MTLComputePipelineState for converting the indirect buffers of many tessellated draws at once. */
+	id<MTLComputePipelineState> getCmdDrawIndirectConvertBatchedBuffersMTLComputePipelineState(MVKVulkanAPIDeviceObject* owner);
+
+	/** Returns a MTLComputePipelineState for populating a MTLIndirectCommandBuffer from an indirect buffer. */
+	id<MTLComputePipelineState> getCmdDrawIndirectPopulateICBMTLComputePipelineState(bool indexed, MTLIndexType type,
+																					 MVKVulkanAPIDeviceObject* owner);
+
+	/** Returns a MTLComputePipelineState for copying an index buffer for use in an indirect tessellated draw. */
+	id<MTLComputePipelineState> getCmdDrawIndexedCopyIndexBufferMTLComputePipelineState(MTLIndexType type,
+																						MVKVulkanAPIDeviceObject* owner);
+
+	/** Returns a MTLComputePipelineState for copying query results to a buffer. */
+	id<MTLComputePipelineState> getCmdCopyQueryPoolResultsMTLComputePipelineState(MVKVulkanAPIDeviceObject* owner);
+
+#pragma mark Construction
+
+	MVKCommandEncodingCache(MVKDevice* device) : MVKBaseDeviceObject(device) {}
+
+	~MVKCommandEncodingCache() override;
+
+protected:
+	MVKSharedMutex _lock;
+	MVKFlatHashMap<MVKRPSKeyBlitImg, id<MTLRenderPipelineState>> _cmdBlitImageMTLRenderPipelineStates;
+	MVKFlatHashMap<MVKRPSKeyClearAtt, id<MTLRenderPipelineState>> _cmdClearMTLRenderPipelineStates;
+	MVKFlatHashMap<MVKMTLDepthStencilDescriptorData, id<MTLDepthStencilState>> _mtlDepthStencilStates;
+	id<MTLDepthStencilState> _cmdClearDepthStencilStates[4] = {nil, nil, nil, nil};
+	id<MTLComputePipelineState> _mtlCopyBufferBytesComputePipelineState = nil;
+	id<MTLComputePipelineState> _mtlFillBufferComputePipelineState = nil;
+	id<MTLComputePipelineState> _mtlCopyBufferToImage3DDecompressComputePipelineState[2] = {nil, nil};
+	id<MTLComputePipelineState> _mtlConvertDepthBufferComputePipelineState = nil;
+	id<MTLComputePipelineState> _mtlDrawIndirectConvertBuffersComputePipelineState[2] = {nil, nil};
+	id<MTLComputePipelineState> _mtlDrawIndirectConvertBatchedBuffersComputePipelineState = nil;
+	id<MTLComputePipelineState> _mtlDrawIndirectPopulateICBComputePipelineState[3] = {nil, nil, nil};
+	id<MTLComputePipelineState> _mtlDrawIndexedCopyIndexBufferComputePipelineState[2] = {nil, nil};
+	id<MTLComputePipelineState> _mtlCopyQueryPoolResultsComputePipelineState = nil;
+};
+
+
 #pragma mark -
 #pragma mark MVKCommandEncodingPool
 
@@ -37,6 +187,9 @@ class MVKCommandPool;
  * onto a queue. This is distinct from a command pool, which contains resources that can
  * be assigned to commands when their content is established.
  *
+ * Metal pipeline and depth-stencil states are retrieved from the device-wide MVKCommandEncodingCache,
+ * and this pool holds unretained references to them, as a front cache that avoids locking that cache.
+ *
  * Access to the content within this pool is thread-safe.
  */
 class MVKCommandEncodingPool : public MVKBaseObject {
@@ -68,6 +221,12 @@ public:
      */
     const MVKMTLBufferAllocation* acquireMTLBufferAllocation(NSUInteger length);
 
+	/**
+	 * Returns the ring buffer from which transient command data can be suballocated,
+	 * or null if transient data should not be suballocated from a ring buffer.
+	 */
+	MVKMTLBufferRing* getTransientMTLBufferRing() { return _transientMTLBufferRing; }
+
 	/**
 	 * Returns a MTLRenderPipelineState dedicated to rendering to several attachments
 	 * to support clearing regions of those attachments.
@@ -80,28 +239,39 @@ public:
     /**
      * Returns an MVKImage configured from the specified MTLTexture configuration,
      * with content held in Private storage. The object returned can be used as a
-     * temporary image during image transfers.
+     * temporary image during image transfers encoded on the specified MTLCommandBuffer.
      *
      * The same image instance will be returned for two calls to this function with
      * the same image descriptor data. This implies that the same image instance could 
      * be used by two transfers within the same encoder or queue. This is acceptable 
      * becuase the content only needs to be valid during the transfer, and it can be
      * reused by subsequent transfers in the same encoding run.
+     *
+     * Transfer images and buffers are limited to a total size. When that size would be
+     * exceeded, those that are no longer in use by an incomplete MTLCommandBuffer are destroyed.
+     * If that does not make enough room, the image is not cached, and is destroyed once the
+     * MTLCommandBuffer completes.
      */
-    MVKImage* getTransferMVKImage(MVKImageDescriptorData& imgData);
+    MVKImage* getTransferMVKImage(MVKImageDescriptorData& imgData, id<MTLCommandBuffer> mtlCmdBuff);
     
     /**
      * Returns an MVKBuffer configured from the specified MTLBuffer configuration,
      * with content held in Private storage. The object returned can be used as a
-     * temporary buffer during buffer-image transfers.
+     * temporary buffer during buffer-image transfers encoded on the specified MTLCommandBuffer.
      *
-     * The same buffer instance will be returned for two calls to this funciton with
-     * the same buffer descriptor data. This implies that the same buffer instance could 
-     * be used by two transfers within the same encoder or queue. This is acceptable 
-     * becuase the content only needs to be valid during the transfer, and it can be 
-     * reused by subsequent transfers in the same encoding run.
+     * Buffers are allocated in power-of-two size classes, and the buffer returned may
+     * be larger than the size requested. The same buffer instance will be returned for
+     * two calls to this function with the same buffer usage and size class. This implies
+     * that the same buffer instance could be used by two transfers within the same encoder
+     * or queue. This is acceptable becuase the content only needs to be valid during the
+     * transfer, and it can be reused by subsequent transfers in the same encoding run.
+     *
+     * Transfer images and buffers are limited to a total size. When that size would be
+     * exceeded, those that are no longer in use by an incomplete MTLCommandBuffer are destroyed.
+     * If that does not make enough room, the buffer is not cached, and is destroyed once the
+     * MTLCommandBuffer completes.
      */
-    MVKBuffer* getTransferMVKBuffer(MVKBufferDescriptorData& buffData);
+    MVKBuffer* getTransferMVKBuffer(MVKBufferDescriptorData& buffData, id<MTLCommandBuffer> mtlCmdBuff);
     
 	/** Returns a MTLComputePipelineState for copying between two buffers with byte-aligned copy regions. */
     id<MTLComputePipelineState> getCmdCopyBufferBytesMTLComputePipelineState();
@@ -112,15 +282,41 @@ public:
 	/** Returns a MTLComputePipelineState for decompressing a buffer into a 3D image. */
 	id<MTLComputePipelineState> getCmdCopyBufferToImage3DDecompressMTLComputePipelineState(bool needsTempBuff);
 
+	/** Returns a MTLComputePipelineState for converting depth content between buffers holding different depth formats. */
+	id<MTLComputePipelineState> getCmdConvertDepthBufferMTLComputePipelineState();
+
 	/** Returns a MTLComputePipelineState for converting an indirect buffer for use in a tessellated draw. */
 	id<MTLComputePipelineState> getCmdDrawIndirectConvertBuffersMTLComputePipelineState(bool indexed);
 
+	/** Returns a MTLComputePipelineState for converting the indirect buffers of many tessellated draws at once. */
+	id<MTLComputePipelineState> getCmdDrawIndirectConvertBatchedBuffersMTLComputePipelineState();
+
+	/** Returns a MTLComputePipelineState for populating a MTLIndirectCommandBuffer from an indirect buffer. */
+	id<MTLComputePipelineState> getCmdDrawIndirectPopulateICBMTLComputePipelineState(bool indexed, MTLIndexType type);
+
 	/** Returns a MTLComputePipelineState for copying an index buffer for use in an indirect tessellated draw. */
 	id<MTLComputePipelineState> getCmdDrawIndexedCopyIndexBufferMTLComputePipelineState(MTLIndexType type);
 
 	/** Returns a MTLComputePipelineState for copying query results to a buffer. */
 	id<MTLComputePipelineState> getCmdCopyQueryPoolResultsMTLComputePipelineState();
 
+	/**
+	 * Returns a MTLBuffer, of at least the specified length, to hold the indices of an indexed tessellated draw,
+	 * converted from the index buffer content identified by the key, and encoded into the MTLCommandBuffer.
+	 *
+	 * If the indices were converted by a MTLCommandBuffer that has since completed, that MTLBuffer is returned,
+	 * and the needsConversion parameter is set to false. If no MTLCommandBuffer is converting them, a new MTLBuffer
+	 * is returned, and the needsConversion parameter is set to true. The caller must then encode the conversion
+	 * into the MTLCommandBuffer, and the MTLBuffer is reused by later draws once that MTLCommandBuffer completes.
+	 * Otherwise, the indices are being converted by a MTLCommandBuffer that has not yet completed, and nil is returned.
+	 *
+	 * The returned MTLBuffer is retained until the MTLCommandBuffer completes.
+	 */
+	id<MTLBuffer> getConvertedIndexMTLBuffer(const MVKConvertedIndexBufferKey& key,
+											 NSUInteger length,
+											 id<MTLCommandBuffer> mtlCmdBuff,
+											 bool& needsConversion);
+
 	/** Deletes all the internal resources. */
 	void clear();
 
@@ -132,16 +328,35 @@ public:
 
 protected:
 	void destroyMetalResources();
+	bool evictTransferResources(VkDeviceSize newByteCount);
+	template<class K> void evictTransferResources(MVKFlatHashMap<K, MVKTransferResource>& xferRezMap, VkDeviceSize newByteCount);
+	void destroyTransferResource(MVKTransferResource& xferRez);
+	void destroyTransferResourceOnCompletion(MVKTransferResource& xferRez, id<MTLCommandBuffer> mtlCmdBuff);
+	uint64_t getTransferGeneration(id<MTLCommandBuffer> mtlCmdBuff);
+	void retireTransferGeneration(uint64_t generation, id<MTLCommandBuffer> mtlCmdBuff);
+	void completeConvertedIndexMTLBuffer(const MVKConvertedIndexBufferKey& key, id<MTLBuffer> mtlBuff, bool isConverted);
+	void clearConvertedIndexMTLBuffers();
+
+	typedef struct {
+		id<MTLBuffer> mtlBuffer;		// retained
+		bool isConverted;
+	} MVKConvertedIndexMTLBuffer;
 
 	MVKCommandPool* _commandPool;
 	std::mutex _lock;
-    std::unordered_map<MVKRPSKeyBlitImg, id<MTLRenderPipelineState>> _cmdBlitImageMTLRenderPipelineStates;
-	std::unordered_map<MVKRPSKeyClearAtt, id<MTLRenderPipelineState>> _cmdClearMTLRenderPipelineStates;
-    std::unordered_map<MVKMTLDepthStencilDescriptorData, id<MTLDepthStencilState>> _mtlDepthStencilStates;
-    std::unordered_map<MVKImageDescriptorData, MVKImage*> _transferImages;
-    std::unordered_map<MVKBufferDescriptorData, MVKBuffer*> _transferBuffers;
-    std::unordered_map<MVKBufferDescriptorData, MVKDeviceMemory*> _transferBufferMemory;
+    MVKFlatHashMap<MVKRPSKeyBlitImg, id<MTLRenderPipelineState>> _cmdBlitImageMTLRenderPipelineStates;
+	MVKFlatHashMap<MVKRPSKeyClearAtt, id<MTLRenderPipelineState>> _cmdClearMTLRenderPipelineStates;
+    MVKFlatHashMap<MVKMTLDepthStencilDescriptorData, id<MTLDepthStencilState>> _mtlDepthStencilStates;
+    MVKFlatHashMap<MVKImageDescriptorData, MVKTransferResource> _transferImages;
+    MVKFlatHashMap<MVKBufferDescriptorData, MVKTransferResource> _transferBuffers;
+	MVKVectorInline<uint64_t, 8> _activeTransferGenerations;
+	id<MTLCommandBuffer> _transferMTLCommandBuffer = nil;		// not retained
+	uint64_t _transferGeneration = 0;
+	VkDeviceSize _transferResourcesByteCount = 0;
+	MVKFlatHashMap<MVKConvertedIndexBufferKey, MVKConvertedIndexMTLBuffer> _convertedIndexMTLBuffers;
+	NSUInteger _convertedIndexMTLBuffersLength = 0;
     MVKMTLBufferAllocator _mtlBufferAllocator;
+	MVKMTLBufferRing* _transientMTLBufferRing = nullptr;
     id<MTLDepthStencilState> _cmdClearDepthOnlyDepthStencilState = nil;
     id<MTLDepthStencilState> _cmdClearStencilOnlyDepthStencilState = nil;
     id<MTLDepthStencilState> _cmdClearDepthAndStencilDepthStencilState = nil;
@@ -149,7 +364,10 @@ protected:
     id<MTLComputePipelineState> _mtlCopyBufferBytesComputePipelineState = nil;
 	id<MTLComputePipelineState> _mtlFillBufferComputePipelineState = nil;
 	id<MTLComputePipelineState> _mtlCopyBufferToImage3DDecompressComputePipelineState[2] = {nil, nil};
+	id<MTLComputePipelineState> _mtlConvertDepthBufferComputePipelineState = nil;
 	id<MTLComputePipelineState> _mtlDrawIndirectConvertBuffersComputePipelineState[2] = {nil, nil};
+	id<MTLComputePipelineState> _mtlDrawIndirectConvertBatchedBuffersComputePipelineState = nil;
+	id<MTLComputePipelineState> _mtlDrawIndirectPopulateICBComputePipelineState[3] = {nil, nil, nil};
 	id<MTLComputePipelineState> _mtlDrawIndexedCopyIndexBufferComputePipelineState[2] = {nil, nil};
 	id<MTLComputePipelineState> _mtlCopyQueryPoolResultsComputePipelineState = nil;
 };
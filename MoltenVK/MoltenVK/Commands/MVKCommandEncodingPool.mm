@@ -23,6 +23,116 @@
 using namespace std;
 
 
+#pragma mark -
+#pragma mark MVKCommandEncodingCache
+
+// Each access function first looks for an existing resource while holding only a shared lock,
+// so that retrievals from many threads don't block each other. If the resource doesn't exist,
+// an exclusive lock is acquired, the resource is tested again, to guard against another thread
+// creating it in the meantime, and if it still does not exist, it is created and cached.
+#define MVK_ENC_CACHE_REZ_ACCESS(rezAccess, rezFactoryFunc)							\
+	{																				\
+		MVKSharedLock lock(_lock);													\
+		auto rez = rezAccess;														\
+		if (rez) { return rez; }													\
+	}																				\
+																					\
+	lock_guard<MVKSharedMutex> lock(_lock);											\
+	auto& rez = rezAccess;															\
+	if ( !rez ) { rez = _device->getCommandResourceFactory()->rezFactoryFunc; }		\
+	return rez
+
+// Looks up a map keyed resource without any lock, because MVKFlatHashMap lookups are lock-free
+// while insertions are serialized by the exclusive lock. A new resource is fully created before
+// it is inserted into the map, so readers never see an entry without its resource.
+#define MVK_ENC_CACHE_MAP_REZ_ACCESS(rezMap, rezKey, rezFactoryFunc)				\
+	auto rez = rezMap.get(rezKey);													\
+	if (rez) { return rez; }														\
+																					\
+	lock_guard<MVKSharedMutex> lock(_lock);											\
+	rez = rezMap.get(rezKey);														\
+	if (rez) { return rez; }														\
+																					\
+	rez = _device->getCommandResourceFactory()->rezFactoryFunc;						\
+	rezMap.emplace(rezKey, rez);													\
+	return rez
+
+id<MTLRenderPipelineState> MVKCommandEncodingCache::getCmdBlitImageMTLRenderPipelineState(MVKRPSKeyBlitImg& blitKey,
+																						  MVKVulkanAPIDeviceObject* owner) {
+	MVK_ENC_CACHE_MAP_REZ_ACCESS(_cmdBlitImageMTLRenderPipelineStates, blitKey, newCmdBlitImageMTLRenderPipelineState(blitKey, owner));
+}
+
+id<MTLRenderPipelineState> MVKCommandEncodingCache::getCmdClearMTLRenderPipelineState(MVKRPSKeyClearAtt& attKey,
+																					  MVKVulkanAPIDeviceObject* owner) {
+	MVK_ENC_CACHE_MAP_REZ_ACCESS(_cmdClearMTLRenderPipelineStates, attKey, newCmdClearMTLRenderPipelineState(attKey, owner));
+}
+
+id<MTLDepthStencilState> MVKCommandEncodingCache::getMTLDepthStencilState(bool useDepth, bool useStencil) {
+	MVK_ENC_CACHE_REZ_ACCESS(_cmdClearDepthStencilStates[(useDepth ? 2 : 0) + (useStencil ? 1 : 0)], newMTLDepthStencilState(useDepth, useStencil));
+}
+
+id<MTLDepthStencilState> MVKCommandEncodingCache::getMTLDepthStencilState(MVKMTLDepthStencilDescriptorData& dsData) {
+	MVK_ENC_CACHE_MAP_REZ_ACCESS(_mtlDepthStencilStates, dsData, newMTLDepthStencilState(dsData));
+}
+
+id<MTLComputePipelineState> MVKCommandEncodingCache::getCmdCopyBufferBytesMTLComputePipelineState(MVKVulkanAPIDeviceObject* owner) {
+	MVK_ENC_CACHE_REZ_ACCESS(_mtlCopyBufferBytesComputePipelineState, newCmdCopyBufferBytesMTLComputePipelineState(owner));
+}
+
+id<MTLComputePipelineState> MVKCommandEncodingCache::getCmdFillBufferMTLComputePipelineState(MVKVulkanAPIDeviceObject* owner) {
+	MVK_ENC_CACHE_REZ_ACCESS(_mtlFillBufferComputePipelineState, newCmdFillBufferMTLComputePipelineState(owner));
+}
+
+id<MTLComputePipelineState> MVKCommandEncodingCache::getCmdCopyBufferToImage3DDecompressMTLComputePipelineState(bool needsTempBuff,
+																												MVKVulkanAPIDeviceObject* owner) {
+	MVK_ENC_CACHE_REZ_ACCESS(_mtlCopyBufferToImage3DDecompressComputePipelineState[needsTempBuff ? 1 : 0], newCmdCopyBufferToImage3DDecompressMTLComputePipelineState(needsTempBuff, owner));
+}
+
+id<MTLComputePipelineState> MVKCommandEncodingCache::getCmdConvertDepthBufferMTLComputePipelineState(MVKVulkanAPIDeviceObject* owner) {
+	MVK_ENC_CACHE_REZ_ACCESS(_mtlConvertDepthBufferComputePipelineState, newCmdConvertDepthBufferMTLComputePipelineState(owner));
+}
+
+id<MTLComputePipelineState> MVKCommandEncodingCache::getCmdDrawIndirectConvertBuffersMTLComputePipelineState(bool indexed,
+																											 MVKVulkanAPIDeviceObject* owner) {
+	MVK_ENC_CACHE_REZ_ACCESS(_mtlDrawIndirectConvertBuffersComputePipelineState[indexed ? 1 : 0], newCmdDrawIndirectConvertBuffersMTLComputePipelineState(indexed, owner));
+}
+
+id<MTLComputePipelineState> MVKCommandEncodingCache::getCmdDrawIndirectConvertBatchedBuffersMTLComputePipelineState(MVKVulkanAPIDeviceObject* owner) {
+	MVK_ENC_CACHE_REZ_ACCESS(_mtlDrawIndirectConvertBatchedBuffersComputePipelineState, newCmdDrawIndirectConvertBatchedBuffersMTLComputePipelineState(owner));
+}
+
+id<MTLComputePipelineState> MVKCommandEncodingCache::getCmdDrawIndirectPopulateICBMTLComputePipelineState(bool indexed, MTLIndexType type,
+																										  MVKVulkanAPIDeviceObject* owner) {
+	MVK_ENC_CACHE_REZ_ACCESS(_mtlDrawIndirectPopulateICBComputePipelineState[indexed ? (type == MTLIndexTypeUInt16 ? 1 : 2) : 0], newCmdDrawIndirectPopulateICBMTLComputePipelineState(indexed, type, owner));
+}
+
+id<MTLComputePipelineState> MVKCommandEncodingCache::getCmdDrawIndexedCopyIndexBufferMTLComputePipelineState(MTLIndexType type,
+																											 MVKVulkanAPIDeviceObject* owner) {
+	MVK_ENC_CACHE_REZ_ACCESS(_mtlDrawIndexedCopyIndexBufferComputePipelineState[type == MTLIndexTypeUInt16 ? 1 : 0], newCmdDrawIndexedCopyIndexBufferMTLComputePipelineState(type, owner));
+}
+
+id<MTLComputePipelineState> MVKCommandEncodingCache::getCmdCopyQueryPoolResultsMTLComputePipelineState(MVKVulkanAPIDeviceObject* owner) {
+	MVK_ENC_CACHE_REZ_ACCESS(_mtlCopyQueryPoolResultsComputePipelineState, newCmdCopyQueryPoolResultsMTLComputePipelineState(owner));
+}
+
+MVKCommandEncodingCache::~MVKCommandEncodingCache() {
+	for (auto& pair : _cmdBlitImageMTLRenderPipelineStates) { [pair.second release]; }
+	for (auto& pair : _cmdClearMTLRenderPipelineStates) { [pair.second release]; }
+	for (auto& pair : _mtlDepthStencilStates) { [pair.second release]; }
+	for (auto& dss : _cmdClearDepthStencilStates) { [dss release]; }
+
+	[_mtlCopyBufferBytesComputePipelineState release];
+	[_mtlFillBufferComputePipelineState release];
+	for (auto& cps : _mtlCopyBufferToImage3DDecompressComputePipelineState) { [cps release]; }
+	[_mtlConvertDepthBufferComputePipelineState release];
+	for (auto& cps : _mtlDrawIndirectConvertBuffersComputePipelineState) { [cps release]; }
+	[_mtlDrawIndirectConvertBatchedBuffersComputePipelineState release];
+	for (auto& cps : _mtlDrawIndirectPopulateICBComputePipelineState) { [cps release]; }
+	for (auto& cps : _mtlDrawIndexedCopyIndexBufferComputePipelineState) { [cps release]; }
+	[_mtlCopyQueryPoolResultsComputePipelineState release];
+}
+
+
 #pragma mark -
 #pragma mark MVKCommandEncodingPool
 
@@ -51,30 +161,58 @@ MVKVulkanAPIObject* MVKCommandEncodingPool::getVulkanAPIObject() { return _comma
 	rezAccess = rez;																\
 	return rez
 
+// Same as MVK_ENC_REZ_ACCESS, but in Step 3, the resource is retrieved from the device-wide
+// MVKCommandEncodingCache, which owns it, instead of being created by this pool.
+#define MVK_ENC_SHARED_REZ_ACCESS(rezAccess, rezCacheFunc)							\
+	auto rez = rezAccess;															\
+	if (rez) { return rez; }														\
+																					\
+	lock_guard<mutex> lock(_lock);													\
+	rez = rezAccess;																\
+	if (rez) { return rez; }														\
+																					\
+	rez = _commandPool->getDevice()->getCommandEncodingCache()->rezCacheFunc;		\
+	rezAccess = rez;																\
+	return rez
+
+// Same as MVK_ENC_SHARED_REZ_ACCESS, for a resource held in a MVKFlatHashMap. The lookup in
+// Step 1 is lock-free, and the resource is inserted into the map only once it is retrieved.
+#define MVK_ENC_SHARED_MAP_REZ_ACCESS(rezMap, rezKey, rezCacheFunc)				\
+	auto rez = rezMap.get(rezKey);													\
+	if (rez) { return rez; }														\
+																					\
+	lock_guard<mutex> lock(_lock);													\
+	rez = rezMap.get(rezKey);														\
+	if (rez) { return rez; }														\
+																					\
+	rez = _commandPool->getDevice()->getCommandEncodingCache()->rezCacheFunc;		\
+	rezMap.emplace(rezKey, rez);													\
+	return rez
+
 
 id<MTLRenderPipelineState> MVKCommandEncodingPool::getCmdClearMTLRenderPipelineState(MVKRPSKeyClearAtt& attKey) {
-	MVK_ENC_REZ_ACCESS(_cmdClearMTLRenderPipelineStates[attKey], newCmdClearMTLRenderPipelineState(attKey, _commandPool));
+	MVK_ENC_SHARED_MAP_REZ_ACCESS(_cmdClearMTLRenderPipelineStates, attKey, getCmdClearMTLRenderPipelineState(attKey, _commandPool));
 }
 
 id<MTLRenderPipelineState> MVKCommandEncodingPool::getCmdBlitImageMTLRenderPipelineState(MVKRPSKeyBlitImg& blitKey) {
-	MVK_ENC_REZ_ACCESS(_cmdBlitImageMTLRenderPipelineStates[blitKey], newCmdBlitImageMTLRenderPipelineState(blitKey, _commandPool));
+	MVK_ENC_SHARED_MAP_REZ_ACCESS(_cmdBlitImageMTLRenderPipelineStates, blitKey, getCmdBlitImageMTLRenderPipelineState(blitKey, _commandPool));
 }
 
 id<MTLDepthStencilState> MVKCommandEncodingPool::getMTLDepthStencilState(bool useDepth, bool useStencil) {
 
     if (useDepth && useStencil) {
-		MVK_ENC_REZ_ACCESS(_cmdClearDepthAndStencilDepthStencilState, newMTLDepthStencilState(useDepth, useStencil));
+		MVK_ENC_SHARED_REZ_ACCESS(_cmdClearDepthAndStencilDepthStencilState, getMTLDepthStencilState(useDepth, useStencil));
     }
 
     if (useDepth) {
-		MVK_ENC_REZ_ACCESS(_cmdClearDepthOnlyDepthStencilState, newMTLDepthStencilState(useDepth, useStencil));
+		MVK_ENC_SHARED_REZ_ACCESS(_cmdClearDepthOnlyDepthStencilState, getMTLDepthStencilState(useDepth, useStencil));
     }
 
     if (useStencil) {
-		MVK_ENC_REZ_ACCESS(_cmdClearStencilOnlyDepthStencilState, newMTLDepthStencilState(useDepth, useStencil));
+		MVK_ENC_SHARED_REZ_ACCESS(_cmdClearStencilOnlyDepthStencilState, getMTLDepthStencilState(useDepth, useStencil));
     }
 
-	MVK_ENC_REZ_ACCESS(_cmdClearDefaultDepthStencilState, newMTLDepthStencilState(useDepth, useStencil));
+	MVK_ENC_SHARED_REZ_ACCESS(_cmdClearDefaultDepthStencilState, getMTLDepthStencilState(useDepth, useStencil));
 }
 
 const MVKMTLBufferAllocation* MVKCommandEncodingPool::acquireMTLBufferAllocation(NSUInteger length) {
@@ -83,39 +221,227 @@ const MVKMTLBufferAllocation* MVKCommandEncodingPool::acquireMTLBufferAllocation
 
 
 id<MTLDepthStencilState> MVKCommandEncodingPool::getMTLDepthStencilState(MVKMTLDepthStencilDescriptorData& dsData) {
-	MVK_ENC_REZ_ACCESS(_mtlDepthStencilStates[dsData], newMTLDepthStencilState(dsData));
+	MVK_ENC_SHARED_MAP_REZ_ACCESS(_mtlDepthStencilStates, dsData, getMTLDepthStencilState(dsData));
 }
 
-MVKImage* MVKCommandEncodingPool::getTransferMVKImage(MVKImageDescriptorData& imgData) {
-	MVK_ENC_REZ_ACCESS(_transferImages[imgData], newMVKImage(imgData));
+// Transfer buffers are allocated in power-of-two size classes, of at least this size,
+// and all transfer images and buffers held by the pool are limited to this total size.
+static const VkDeviceSize kMVKTransferBufferMinSize = (64 * KIBI);
+static const VkDeviceSize kMVKTransferResourcesMaxByteCount = (128 * MEBI);
+
+MVKImage* MVKCommandEncodingPool::getTransferMVKImage(MVKImageDescriptorData& imgData, id<MTLCommandBuffer> mtlCmdBuff) {
+	lock_guard<mutex> lock(_lock);
+
+	auto iter = _transferImages.find(imgData);
+	if (iter != _transferImages.end()) {
+		iter->second.generation = getTransferGeneration(mtlCmdBuff);
+		return iter->second.mvkImage;
+	}
+
+	MVKTransferResource xferRez;
+	xferRez.mvkImage = _commandPool->getDevice()->getCommandResourceFactory()->newMVKImage(imgData);
+	xferRez.byteCount = xferRez.mvkImage->getByteCount() * imgData.samples;
+	if ( !evictTransferResources(xferRez.byteCount) ) {
+		destroyTransferResourceOnCompletion(xferRez, mtlCmdBuff);
+		return xferRez.mvkImage;
+	}
+
+	xferRez.generation = getTransferGeneration(mtlCmdBuff);
+	_transferImages[imgData] = xferRez;
+	_transferResourcesByteCount += xferRez.byteCount;
+	return xferRez.mvkImage;
+}
+
+MVKBuffer* MVKCommandEncodingPool::getTransferMVKBuffer(MVKBufferDescriptorData& buffData, id<MTLCommandBuffer> mtlCmdBuff) {
+	MVKBufferDescriptorData sizeClassData = buffData;
+	sizeClassData.size = mvkEnsurePowerOfTwo(std::max(buffData.size, kMVKTransferBufferMinSize));
+
+	lock_guard<mutex> lock(_lock);
+
+	auto iter = _transferBuffers.find(sizeClassData);
+	if (iter != _transferBuffers.end()) {
+		iter->second.generation = getTransferGeneration(mtlCmdBuff);
+		return iter->second.mvkBuffer;
+	}
+
+	MVKTransferResource xferRez;
+	xferRez.mvkBuffer = _commandPool->getDevice()->getCommandResourceFactory()->newMVKBuffer(sizeClassData, xferRez.mvkMemory);
+	xferRez.byteCount = sizeClassData.size;
+	if ( !evictTransferResources(xferRez.byteCount) ) {
+		destroyTransferResourceOnCompletion(xferRez, mtlCmdBuff);
+		return xferRez.mvkBuffer;
+	}
+
+	xferRez.generation = getTransferGeneration(mtlCmdBuff);
+	_transferBuffers[sizeClassData] = xferRez;
+	_transferResourcesByteCount += xferRez.byteCount;
+	return xferRez.mvkBuffer;
+}
+
+// Returns the generation of the specified MTLCommandBuffer, starting a new generation if the
+// MTLCommandBuffer is not the one most recently seen. Each generation remains active until its
+// MTLCommandBuffer completes. Because the MTLCommandBuffer is not retained, it is forgotten
+// when its generation is retired, before it can be deallocated and its address reused.
+// The lock must be held when calling this function.
+uint64_t MVKCommandEncodingPool::getTransferGeneration(id<MTLCommandBuffer> mtlCmdBuff) {
+	if (mtlCmdBuff == _transferMTLCommandBuffer) { return _transferGeneration; }
+
+	uint64_t generation = ++_transferGeneration;
+	_transferMTLCommandBuffer = mtlCmdBuff;
+	_activeTransferGenerations.push_back(generation);
+	[mtlCmdBuff addCompletedHandler: ^(id<MTLCommandBuffer> mcb) {
+		retireTransferGeneration(generation, mcb);
+	}];
+	return generation;
+}
+
+void MVKCommandEncodingPool::retireTransferGeneration(uint64_t generation, id<MTLCommandBuffer> mtlCmdBuff) {
+	lock_guard<mutex> lock(_lock);
+
+	mvkRemoveAllOccurances(_activeTransferGenerations, generation);
+	if (_transferMTLCommandBuffer == mtlCmdBuff) { _transferMTLCommandBuffer = nil; }
 }
 
-MVKBuffer* MVKCommandEncodingPool::getTransferMVKBuffer(MVKBufferDescriptorData& buffData) {
-	MVK_ENC_REZ_ACCESS(_transferBuffers[buffData], newMVKBuffer(buffData, _transferBufferMemory[buffData]));
+// If adding a resource of the specified size would exceed the total size limit, destroys
+// the transfer resources whose generation has been retired, until the new resource fits
+// within the limit. Resources that are still in use by the GPU are never destroyed.
+// Returns whether the new resource fits within the limit.
+bool MVKCommandEncodingPool::evictTransferResources(VkDeviceSize newByteCount) {
+	evictTransferResources(_transferBuffers, newByteCount);
+	evictTransferResources(_transferImages, newByteCount);
+	return _transferResourcesByteCount + newByteCount <= kMVKTransferResourcesMaxByteCount;
+}
+
+template<class K>
+void MVKCommandEncodingPool::evictTransferResources(MVKFlatHashMap<K, MVKTransferResource>& xferRezMap, VkDeviceSize newByteCount) {
+	for (auto iter = xferRezMap.begin(); iter != xferRezMap.end(); ) {
+		if (_transferResourcesByteCount + newByteCount <= kMVKTransferResourcesMaxByteCount) { return; }
+
+		auto& xferRez = iter->second;
+		if ( !contains(_activeTransferGenerations, xferRez.generation) ) {
+			_transferResourcesByteCount -= xferRez.byteCount;
+			destroyTransferResource(xferRez);
+			iter = xferRezMap.erase(iter);
+		} else {
+			iter++;
+		}
+	}
+}
+
+void MVKCommandEncodingPool::destroyTransferResource(MVKTransferResource& xferRez) {
+	MVKDevice* mvkDev = _commandPool->getDevice();
+	if (xferRez.mvkImage) { mvkDev->destroyImage(xferRez.mvkImage, nullptr); }
+	if (xferRez.mvkBuffer) { mvkDev->destroyBuffer(xferRez.mvkBuffer, nullptr); }
+	if (xferRez.mvkMemory) { mvkDev->freeMemory(xferRez.mvkMemory, nullptr); }
+	xferRez = MVKTransferResource();
+}
+
+// Destroys an uncached transfer resource once the MTLCommandBuffer that uses it completes.
+void MVKCommandEncodingPool::destroyTransferResourceOnCompletion(MVKTransferResource& xferRez, id<MTLCommandBuffer> mtlCmdBuff) {
+	MVKTransferResource tmpXferRez = xferRez;
+	[mtlCmdBuff addCompletedHandler: ^(id<MTLCommandBuffer> mcb) {
+		MVKTransferResource blkXferRez = tmpXferRez;
+		destroyTransferResource(blkXferRez);
+	}];
 }
 
 id<MTLComputePipelineState> MVKCommandEncodingPool::getCmdCopyBufferBytesMTLComputePipelineState() {
-	MVK_ENC_REZ_ACCESS(_mtlCopyBufferBytesComputePipelineState, newCmdCopyBufferBytesMTLComputePipelineState(_commandPool));
+	MVK_ENC_SHARED_REZ_ACCESS(_mtlCopyBufferBytesComputePipelineState, getCmdCopyBufferBytesMTLComputePipelineState(_commandPool));
 }
 
 id<MTLComputePipelineState> MVKCommandEncodingPool::getCmdFillBufferMTLComputePipelineState() {
-	MVK_ENC_REZ_ACCESS(_mtlFillBufferComputePipelineState, newCmdFillBufferMTLComputePipelineState(_commandPool));
+	MVK_ENC_SHARED_REZ_ACCESS(_mtlFillBufferComputePipelineState, getCmdFillBufferMTLComputePipelineState(_commandPool));
 }
 
 id<MTLComputePipelineState> MVKCommandEncodingPool::getCmdCopyBufferToImage3DDecompressMTLComputePipelineState(bool needsTempBuff) {
-	MVK_ENC_REZ_ACCESS(_mtlCopyBufferToImage3DDecompressComputePipelineState[needsTempBuff ? 1 : 0], newCmdCopyBufferToImage3DDecompressMTLComputePipelineState(needsTempBuff, _commandPool));
+	MVK_ENC_SHARED_REZ_ACCESS(_mtlCopyBufferToImage3DDecompressComputePipelineState[needsTempBuff ? 1 : 0], getCmdCopyBufferToImage3DDecompressMTLComputePipelineState(needsTempBuff, _commandPool));
+}
+
+id<MTLComputePipelineState> MVKCommandEncodingPool::getCmdConvertDepthBufferMTLComputePipelineState() {
+	MVK_ENC_SHARED_REZ_ACCESS(_mtlConvertDepthBufferComputePipelineState, getCmdConvertDepthBufferMTLComputePipelineState(_commandPool));
 }
 
 id<MTLComputePipelineState> MVKCommandEncodingPool::getCmdDrawIndirectConvertBuffersMTLComputePipelineState(bool indexed) {
-	MVK_ENC_REZ_ACCESS(_mtlDrawIndirectConvertBuffersComputePipelineState[indexed ? 1 : 0], newCmdDrawIndirectConvertBuffersMTLComputePipelineState(indexed, _commandPool));
+	MVK_ENC_SHARED_REZ_ACCESS(_mtlDrawIndirectConvertBuffersComputePipelineState[indexed ? 1 : 0], getCmdDrawIndirectConvertBuffersMTLComputePipelineState(indexed, _commandPool));
+}
+
+id<MTLComputePipelineState> MVKCommandEncodingPool::getCmdDrawIndirectConvertBatchedBuffersMTLComputePipelineState() {
+	MVK_ENC_SHARED_REZ_ACCESS(_mtlDrawIndirectConvertBatchedBuffersComputePipelineState, getCmdDrawIndirectConvertBatchedBuffersMTLComputePipelineState(_commandPool));
+}
+
+id<MTLComputePipelineState> MVKCommandEncodingPool::getCmdDrawIndirectPopulateICBMTLComputePipelineState(bool indexed, MTLIndexType type) {
+	MVK_ENC_SHARED_REZ_ACCESS(_mtlDrawIndirectPopulateICBComputePipelineState[indexed ? (type == MTLIndexTypeUInt16 ? 1 : 2) : 0], getCmdDrawIndirectPopulateICBMTLComputePipelineState(indexed, type, _commandPool));
 }
 
 id<MTLComputePipelineState> MVKCommandEncodingPool::getCmdDrawIndexedCopyIndexBufferMTLComputePipelineState(MTLIndexType type) {
-	MVK_ENC_REZ_ACCESS(_mtlDrawIndexedCopyIndexBufferComputePipelineState[type == MTLIndexTypeUInt16 ? 1 : 0], newCmdDrawIndexedCopyIndexBufferMTLComputePipelineState(type, _commandPool));
+	MVK_ENC_SHARED_REZ_ACCESS(_mtlDrawIndexedCopyIndexBufferComputePipelineState[type == MTLIndexTypeUInt16 ? 1 : 0], getCmdDrawIndexedCopyIndexBufferMTLComputePipelineState(type, _commandPool));
 }
 
 id<MTLComputePipelineState> MVKCommandEncodingPool::getCmdCopyQueryPoolResultsMTLComputePipelineState() {
-	MVK_ENC_REZ_ACCESS(_mtlCopyQueryPoolResultsComputePipelineState, newCmdCopyQueryPoolResultsMTLComputePipelineState(_commandPool));
+	MVK_ENC_SHARED_REZ_ACCESS(_mtlCopyQueryPoolResultsComputePipelineState, getCmdCopyQueryPoolResultsMTLComputePipelineState(_commandPool));
+}
+
+// The content generation in each key changes whenever the index buffer content changes, so entries for
+// earlier content are never found again. Rather than track them, the cache is emptied when it grows too large.
+static const NSUInteger kMVKConvertedIndexMTLBuffersMaxLength = (64 * MEBI);
+
+// A conversion encoded in one MTLCommandBuffer may execute after a draw encoded in another, or never execute at
+// all, so converted indices are only shared with other MTLCommandBuffers once the conversion has completed. The
+// draws read the index buffer themselves, so the app must order them after the writes that produced that content.
+id<MTLBuffer> MVKCommandEncodingPool::getConvertedIndexMTLBuffer(const MVKConvertedIndexBufferKey& key,
+																  NSUInteger length,
+																  id<MTLCommandBuffer> mtlCmdBuff,
+																  bool& needsConversion) {
+	lock_guard<mutex> lock(_lock);
+
+	id<MTLBuffer> mtlBuff = nil;
+	auto iter = _convertedIndexMTLBuffers.find(key);
+	if (iter != _convertedIndexMTLBuffers.end()) {
+		if ( !iter->second.isConverted ) { return nil; }
+		mtlBuff = iter->second.mtlBuffer;
+		needsConversion = false;
+	} else {
+		if (_convertedIndexMTLBuffersLength + length > kMVKConvertedIndexMTLBuffersMaxLength) { clearConvertedIndexMTLBuffers(); }
+
+		mtlBuff = [_commandPool->getMTLDevice() newBufferWithLength: length
+															options: MTLResourceStorageModePrivate];	// retained
+		_convertedIndexMTLBuffers.emplace(key, {mtlBuff, false});
+		_convertedIndexMTLBuffersLength += length;
+		needsConversion = true;
+	}
+
+	// This pool may release the MTLBuffer while the MTLCommandBuffer is still using it.
+	[mtlBuff retain];
+	bool isConverting = needsConversion;
+	MVKConvertedIndexBufferKey cibKey = key;
+	[mtlCmdBuff addCompletedHandler: ^(id<MTLCommandBuffer> mcb) {
+		if (isConverting) { completeConvertedIndexMTLBuffer(cibKey, mtlBuff, mcb.status == MTLCommandBufferStatusCompleted); }
+		[mtlBuff release];
+	}];
+	return mtlBuff;
+}
+
+// If the MTLCommandBuffer did not complete, the content of the MTLBuffer is unknown, so it is discarded.
+// The entry may already have been replaced, if this pool was emptied in the meantime.
+void MVKCommandEncodingPool::completeConvertedIndexMTLBuffer(const MVKConvertedIndexBufferKey& key, id<MTLBuffer> mtlBuff, bool isConverted) {
+	lock_guard<mutex> lock(_lock);
+
+	auto iter = _convertedIndexMTLBuffers.find(key);
+	if (iter == _convertedIndexMTLBuffers.end() || iter->second.mtlBuffer != mtlBuff) { return; }
+
+	if (isConverted) {
+		iter->second.isConverted = true;
+	} else {
+		_convertedIndexMTLBuffersLength -= mtlBuff.length;
+		[mtlBuff release];
+		_convertedIndexMTLBuffers.erase(iter);
+	}
+}
+
+void MVKCommandEncodingPool::clearConvertedIndexMTLBuffers() {
+	for (auto& pair : _convertedIndexMTLBuffers) { [pair.second.mtlBuffer release]; }
+	_convertedIndexMTLBuffers.clear();
+	_convertedIndexMTLBuffersLength = 0;
 }
 
 void MVKCommandEncodingPool::clear() {
@@ -126,70 +452,60 @@ void MVKCommandEncodingPool::clear() {
 
 #pragma mark Construction
 
+// Each MTLCommandBuffer reserves ring blocks of this length, from a ring of this many blocks.
+static const NSUInteger kMVKTransientMTLBufferRingBlockLength = (64 * KIBI);
+static const uint32_t kMVKTransientMTLBufferRingBlockCount = 32;
+
 MVKCommandEncodingPool::MVKCommandEncodingPool(MVKCommandPool* commandPool) : _commandPool(commandPool),
     _mtlBufferAllocator(commandPool->getDevice(), commandPool->getDevice()->_pMetalFeatures->maxMTLBufferSize, true) {
+
+	MVKDevice* mvkDev = commandPool->getDevice();
+	if (mvkDev->shouldUseTransientMTLBufferRing()) {
+		_transientMTLBufferRing = new MVKMTLBufferRing(mvkDev, kMVKTransientMTLBufferRingBlockLength, kMVKTransientMTLBufferRingBlockCount);
+	}
 }
 
 MVKCommandEncodingPool::~MVKCommandEncodingPool() {
 	destroyMetalResources();
+	if (_transientMTLBufferRing) { _transientMTLBufferRing->destroy(); }
 }
 
-/**  Ensure all cached Metal components are released. */
+/**
+ * Ensure all cached Metal components are released. Pipeline and depth-stencil states
+ * are owned by the device-wide MVKCommandEncodingCache, so only the references are cleared.
+ */
 void MVKCommandEncodingPool::destroyMetalResources() {
-	MVKDevice* mvkDev = _commandPool->getDevice();
-
-    for (auto& pair : _cmdBlitImageMTLRenderPipelineStates) { [pair.second release]; }
     _cmdBlitImageMTLRenderPipelineStates.clear();
-
-    for (auto& pair : _cmdClearMTLRenderPipelineStates) { [pair.second release]; }
     _cmdClearMTLRenderPipelineStates.clear();
-
-    for (auto& pair : _mtlDepthStencilStates) { [pair.second release]; }
     _mtlDepthStencilStates.clear();
 
-    for (auto& pair : _transferImages) { mvkDev->destroyImage(pair.second, nullptr); }
+    for (auto& pair : _transferImages) { destroyTransferResource(pair.second); }
     _transferImages.clear();
 
-    for (auto& pair : _transferBuffers) { mvkDev->destroyBuffer(pair.second, nullptr); }
+    for (auto& pair : _transferBuffers) { destroyTransferResource(pair.second); }
     _transferBuffers.clear();
 
-    for (auto& pair : _transferBufferMemory) { mvkDev->freeMemory(pair.second, nullptr); }
-    _transferBufferMemory.clear();
+    _transferResourcesByteCount = 0;
 
-    [_cmdClearDepthAndStencilDepthStencilState release];
-    _cmdClearDepthAndStencilDepthStencilState = nil;
+    clearConvertedIndexMTLBuffers();
 
-    [_cmdClearDepthOnlyDepthStencilState release];
+    _cmdClearDepthAndStencilDepthStencilState = nil;
     _cmdClearDepthOnlyDepthStencilState = nil;
-
-    [_cmdClearStencilOnlyDepthStencilState release];
     _cmdClearStencilOnlyDepthStencilState = nil;
-
-    [_cmdClearDefaultDepthStencilState release];
     _cmdClearDefaultDepthStencilState = nil;
 
-    [_mtlCopyBufferBytesComputePipelineState release];
     _mtlCopyBufferBytesComputePipelineState = nil;
-
-    [_mtlFillBufferComputePipelineState release];
     _mtlFillBufferComputePipelineState = nil;
-
-    [_mtlCopyBufferToImage3DDecompressComputePipelineState[0] release];
-    [_mtlCopyBufferToImage3DDecompressComputePipelineState[1] release];
     _mtlCopyBufferToImage3DDecompressComputePipelineState[0] = nil;
     _mtlCopyBufferToImage3DDecompressComputePipelineState[1] = nil;
-
-    [_mtlDrawIndirectConvertBuffersComputePipelineState[0] release];
-    [_mtlDrawIndirectConvertBuffersComputePipelineState[1] release];
+    _mtlConvertDepthBufferComputePipelineState = nil;
     _mtlDrawIndirectConvertBuffersComputePipelineState[0] = nil;
     _mtlDrawIndirectConvertBuffersComputePipelineState[1] = nil;
-
-    [_mtlDrawIndexedCopyIndexBufferComputePipelineState[0] release];
-    [_mtlDrawIndexedCopyIndexBufferComputePipelineState[1] release];
+    _mtlDrawIndirectConvertBatchedBuffersComputePipelineState = nil;
+    _mtlDrawIndirectPopulateICBComputePipelineState[0] = nil;
+    _mtlDrawIndirectPopulateICBComputePipelineState[1] = nil;
+    _mtlDrawIndirectPopulateICBComputePipelineState[2] = nil;
     _mtlDrawIndexedCopyIndexBufferComputePipelineState[0] = nil;
     _mtlDrawIndexedCopyIndexBufferComputePipelineState[1] = nil;
-
-    [_mtlCopyQueryPoolResultsComputePipelineState release];
     _mtlCopyQueryPoolResultsComputePipelineState = nil;
 }
-
@@ -20,6 +20,21 @@
 
 #import <Foundation/Foundation.h>
 
+/** A Metal library precompiled from the command shader source below, for one MSL version. */
+typedef struct {
+	uint32_t mslVersion;			/**< The MSL version the library was compiled for, in the form used by MVKPhysicalDeviceMetalFeatures::mslVersion. */
+	const unsigned char* data;		/**< The contents of the library. */
+	size_t size;					/**< The size of the library, in bytes. */
+} MVKStaticCmdShaderLibrary;
+
+// The build may precompile the source below into a Metal library for each MSL version of the target platform.
+#if __has_include("mvkCmdShaderLibraryDerived.h")
+#	include "mvkCmdShaderLibraryDerived.h"
+#else
+static const MVKStaticCmdShaderLibrary* _MVKStaticCmdShaderLibraries = nullptr;
+static const size_t _MVKStaticCmdShaderLibraryCount = 0;
+#endif
+
 
 /** This file contains static MSL source code for the MoltenVK command shaders. */
 
@@ -48,6 +63,8 @@ typedef enum : uint32_t {
     VK_FORMAT_BC2_SRGB_BLOCK = 136,                                                                             \n\
     VK_FORMAT_BC3_UNORM_BLOCK = 137,                                                                            \n\
     VK_FORMAT_BC3_SRGB_BLOCK = 138,                                                                             \n\
+    VK_FORMAT_BC4_UNORM_BLOCK = 139,                                                                            \n\
+    VK_FORMAT_BC5_UNORM_BLOCK = 141,                                                                            \n\
 } VkFormat;                                                                                                     \n\
                                                                                                                 \n\
 typedef struct {                                                                                                \n\
@@ -118,7 +135,7 @@ kernel void cmdCopyBufferToImage3DDecompressDXTn(const device uint8_t* src [[buf
                                                  constant CmdCopyBufferToImageInfo& info [[buffer(2)]],         \n\
                                                  uint3 pos [[thread_position_in_grid]]) {                       \n\
     uint x = pos.x * 4, y = pos.y * 4, z = pos.z;                                                               \n\
-    VkDeviceSize blockByteCount = isBC1Format(info.format) ? 8 : 16;                                            \n\
+    VkDeviceSize blockByteCount = getDXTnBlockByteCount(info.format);                                           \n\
                                                                                                                 \n\
     if (x >= info.extent.width || y >= info.extent.height || z >= info.extent.depth) { return; }                \n\
                                                                                                                 \n\
@@ -127,7 +144,7 @@ kernel void cmdCopyBufferToImage3DDecompressDXTn(const device uint8_t* src [[buf
     blockExtent.width = min(info.extent.width - x, 4u);                                                         \n\
     blockExtent.height = min(info.extent.height - y, 4u);                                                       \n\
     uint pixels[16] = {0};                                                                                      \n\
-    decompressDXTnBlock(src, pixels, blockExtent, 4 * sizeof(uint), info.format);                               \n\
+    decompressBCnBlock(src, pixels, blockExtent, 4 * sizeof(uint), info.format);                                \n\
     for (uint j = 0; j < blockExtent.height; ++j) {                                                             \n\
         for (uint i = 0; i < blockExtent.width; ++i) {                                                          \n\
             // The pixel components are in BGRA order, but texture::write wants them                            \n\
@@ -143,7 +160,7 @@ kernel void cmdCopyBufferToImage3DDecompressTempBufferDXTn(const device uint8_t*
                                                            constant CmdCopyBufferToImageInfo& info [[buffer(2)]],\n\
                                                            uint3 pos [[thread_position_in_grid]]) {             \n\
     uint x = pos.x * 4, y = pos.y * 4, z = pos.z;                                                               \n\
-    VkDeviceSize blockByteCount = isBC1Format(info.format) ? 8 : 16;                                            \n\
+    VkDeviceSize blockByteCount = getDXTnBlockByteCount(info.format);                                           \n\
                                                                                                                 \n\
     if (x >= info.extent.width || y >= info.extent.height || z >= info.extent.depth) { return; }                \n\
                                                                                                                 \n\
@@ -153,7 +170,7 @@ kernel void cmdCopyBufferToImage3DDecompressTempBufferDXTn(const device uint8_t*
     blockExtent.width = min(info.extent.width - x, 4u);                                                         \n\
     blockExtent.height = min(info.extent.height - y, 4u);                                                       \n\
     uint pixels[16] = {0};                                                                                      \n\
-    decompressDXTnBlock(src, pixels, blockExtent, 4 * sizeof(uint), info.format);                               \n\
+    decompressBCnBlock(src, pixels, blockExtent, 4 * sizeof(uint), info.format);                                \n\
     device uint* destPixel = (device uint*)dest;                                                                \n\
     for (uint j = 0; j < blockExtent.height; ++j) {                                                             \n\
         for (uint i = 0; i < blockExtent.width; ++i) {                                                          \n\
@@ -162,6 +179,38 @@ kernel void cmdCopyBufferToImage3DDecompressTempBufferDXTn(const device uint8_t*
     }                                                                                                           \n\
 }                                                                                                               \n\
                                                                                                                 \n\
+typedef struct {                                                                                                \n\
+    uint32_t srcRowStride;                                                                                      \n\
+    uint32_t dstRowStride;                                                                                      \n\
+    uint32_t width;                                                                                             \n\
+    uint32_t height;                                                                                            \n\
+    uint32_t conversion;                                                                                        \n\
+} CmdConvertDepthInfo;                                                                                          \n\
+                                                                                                                \n\
+kernel void cmdConvertDepthBuffer(const device uint8_t* src [[buffer(0)]],                                      \n\
+                                  device uint8_t* dst [[buffer(1)]],                                            \n\
+                                  constant CmdConvertDepthInfo& info [[buffer(2)]],                             \n\
+                                  uint2 pos [[thread_position_in_grid]]) {                                      \n\
+    if (pos.x >= info.width || pos.y >= info.height) { return; }                                                \n\
+                                                                                                                \n\
+    src += pos.y * info.srcRowStride;                                                                           \n\
+    dst += pos.y * info.dstRowStride;                                                                           \n\
+    switch (info.conversion) {                                                                                  \n\
+        case 1:     // 16-bit unorm to float                                                                    \n\
+            ((device float*)dst)[pos.x] = float(((const device ushort*)src)[pos.x]) / 65535.0;                  \n\
+            break;                                                                                              \n\
+        case 2:     // Float to 16-bit unorm                                                                    \n\
+            ((device ushort*)dst)[pos.x] = ushort(rint(saturate(((const device float*)src)[pos.x]) * 65535.0)); \n\
+            break;                                                                                              \n\
+        case 3:     // 24-bit unorm, in the low bits of 32 bits, to float                                       \n\
+            ((device float*)dst)[pos.x] = float(((const device uint*)src)[pos.x] & 0xFFFFFF) / 16777215.0;      \n\
+            break;                                                                                              \n\
+        case 4:     // Float to 24-bit unorm, in the low bits of 32 bits                                        \n\
+            ((device uint*)dst)[pos.x] = uint(rint(saturate(((const device float*)src)[pos.x]) * 16777215.0));  \n\
+            break;                                                                                              \n\
+    }                                                                                                           \n\
+}                                                                                                               \n\
+                                                                                                                \n\
 #if __METAL_VERSION__ >= 210                                                                                    \n\
 // This structure is missing from the MSL headers. :/                                                           \n\
 struct MTLStageInRegionIndirectArguments {                                                                      \n\
@@ -180,7 +229,11 @@ kernel void cmdDrawIndirectConvertBuffers(const device char* srcBuff [[buffer(0)
                                           uint idx [[thread_position_in_grid]]) {                               \n\
     if (idx >= drawCount) { return; }                                                                           \n\
     const device auto& src = *reinterpret_cast<const device MTLDrawPrimitivesIndirectArguments*>(srcBuff + idx * srcStride);\n\
-    device char* dest = destBuff + idx * (sizeof(MTLDispatchThreadgroupsIndirectArguments) + sizeof(MTLDrawPatchIndirectArguments));\n\
+    device char* dest = destBuff + idx * (sizeof(MTLDispatchThreadgroupsIndirectArguments) + sizeof(MTLDrawPatchIndirectArguments)\n\
+#if __METAL_VERSION__ >= 210                                                                                    \n\
+                                          + sizeof(MTLStageInRegionIndirectArguments)                           \n\
+#endif                                                                                                          \n\
+                                          );                                                                    \n\
 #if __METAL_VERSION__ >= 210                                                                                    \n\
     device auto& destSI = *(device MTLStageInRegionIndirectArguments*)dest;                                     \n\
     dest += sizeof(MTLStageInRegionIndirectArguments);                                                          \n\
@@ -208,7 +261,11 @@ kernel void cmdDrawIndexedIndirectConvertBuffers(const device char* srcBuff [[bu
                                                  uint idx [[thread_position_in_grid]]) {                        \n\
     if (idx >= drawCount) { return; }                                                                           \n\
     const device auto& src = *reinterpret_cast<const device MTLDrawIndexedPrimitivesIndirectArguments*>(srcBuff + idx * srcStride);\n\
-    device char* dest = destBuff + idx * (sizeof(MTLDispatchThreadgroupsIndirectArguments) + sizeof(MTLDrawPatchIndirectArguments));\n\
+    device char* dest = destBuff + idx * (sizeof(MTLDispatchThreadgroupsIndirectArguments) + sizeof(MTLDrawPatchIndirectArguments)\n\
+#if __METAL_VERSION__ >= 210                                                                                    \n\
+                                          + sizeof(MTLStageInRegionIndirectArguments)                           \n\
+#endif                                                                                                          \n\
+                                          );                                                                    \n\
 #if __METAL_VERSION__ >= 210                                                                                    \n\
     device auto& destSI = *(device MTLStageInRegionIndirectArguments*)dest;                                     \n\
     dest += sizeof(MTLStageInRegionIndirectArguments);                                                          \n\
@@ -227,6 +284,112 @@ kernel void cmdDrawIndexedIndirectConvertBuffers(const device char* srcBuff [[bu
 #endif                                                                                                          \n\
 }                                                                                                               \n\
                                                                                                                 \n\
+// Describes the conversion of the indirect arguments of a single tessellated draw.                             \n\
+// This must match the MVKIndirectDrawConversion structure in MVKCommandBuffer.h.                               \n\
+typedef struct {                                                                                                \n\
+    uint32_t srcOffset;                                                                                         \n\
+    uint32_t destOffset;                                                                                        \n\
+    uint32_t inControlPointCount;                                                                               \n\
+    uint32_t outControlPointCount;                                                                              \n\
+} MVKIndirectDrawConversion;                                                                                    \n\
+                                                                                                                \n\
+// Converts the indirect arguments of many draws, possibly with different pipelines, in a single dispatch.      \n\
+// The vertex or index count, and the instance count, are the first two members of both the indexed and         \n\
+// non-indexed Vulkan indirect draw argument structures, so both kinds of draws can be converted here.          \n\
+kernel void cmdDrawIndirectConvertBatchedBuffers(const device char* srcBuff [[buffer(0)]],                      \n\
+                                                 device char* destBuff [[buffer(1)]],                           \n\
+                                                 constant MVKIndirectDrawConversion* conversions [[buffer(2)]], \n\
+                                                 constant uint32_t& conversionCount [[buffer(3)]],              \n\
+                                                 uint idx [[thread_position_in_grid]]) {                        \n\
+    if (idx >= conversionCount) { return; }                                                                     \n\
+    constant auto& conv = conversions[idx];                                                                     \n\
+    const device uint32_t* src = reinterpret_cast<const device uint32_t*>(srcBuff + conv.srcOffset);            \n\
+    uint32_t vertexCount = src[0];                                                                              \n\
+    uint32_t instanceCount = src[1];                                                                            \n\
+    device char* dest = destBuff + conv.destOffset;                                                             \n\
+#if __METAL_VERSION__ >= 210                                                                                    \n\
+    device auto& destSI = *(device MTLStageInRegionIndirectArguments*)dest;                                     \n\
+    dest += sizeof(MTLStageInRegionIndirectArguments);                                                          \n\
+#endif                                                                                                          \n\
+    device auto& destTC = *(device MTLDispatchThreadgroupsIndirectArguments*)dest;                              \n\
+    device auto& destTE = *(device MTLDrawPatchIndirectArguments*)(dest + sizeof(MTLDispatchThreadgroupsIndirectArguments));\n\
+    destTC.threadgroupsPerGrid[0] = (vertexCount * instanceCount + conv.inControlPointCount - 1) / conv.inControlPointCount;\n\
+    destTC.threadgroupsPerGrid[1] = destTC.threadgroupsPerGrid[2] = 1;                                          \n\
+    destTE.patchCount = destTC.threadgroupsPerGrid[0];                                                          \n\
+    destTE.instanceCount = 1;                                                                                   \n\
+    destTE.patchStart = destTE.baseInstance = 0;                                                                \n\
+#if __METAL_VERSION__ >= 210                                                                                    \n\
+    destSI.stageInOrigin[0] = destSI.stageInOrigin[1] = destSI.stageInOrigin[2] = 0;                            \n\
+    destSI.stageInSize[0] = instanceCount * max(vertexCount, conv.outControlPointCount * destTE.patchCount);    \n\
+    destSI.stageInSize[1] = destSI.stageInSize[2] = 1;                                                          \n\
+#endif                                                                                                          \n\
+}                                                                                                               \n\
+                                                                                                                \n\
+#if __METAL_VERSION__ >= 210                                                                                    \n\
+// Describes how to populate a MTLIndirectCommandBuffer from a Vulkan indirect buffer.                          \n\
+// This must match the MVKMultiDrawIndirectInfo structure in MVKCommandBuffer.h.                                \n\
+typedef struct {                                                                                                \n\
+    uint32_t srcStride;                                                                                         \n\
+    uint32_t maxDrawCount;                                                                                      \n\
+    uint32_t primitiveType;                                                                                     \n\
+    uint32_t hasCountBuffer;                                                                                    \n\
+} MVKMultiDrawIndirectInfo;                                                                                     \n\
+                                                                                                                \n\
+typedef struct {                                                                                                \n\
+    command_buffer cmdBuffer [[id(0)]];                                                                         \n\
+} MVKMultiDrawIndirectCommandBuffer;                                                                            \n\
+                                                                                                                \n\
+// Returns the number of draws to encode, which may be read from a count buffer.                                \n\
+static inline uint32_t getMultiDrawCount(constant MVKMultiDrawIndirectInfo& info, const device uint32_t* countBuff) {\n\
+    return info.hasCountBuffer ? min(*countBuff, info.maxDrawCount) : info.maxDrawCount;                        \n\
+}                                                                                                               \n\
+                                                                                                                \n\
+kernel void cmdDrawIndirectPopulateICB(const device char* srcBuff [[buffer(0)]],                                \n\
+                                       device MVKMultiDrawIndirectCommandBuffer& icb [[buffer(1)]],             \n\
+                                       constant MVKMultiDrawIndirectInfo& info [[buffer(2)]],                   \n\
+                                       const device uint32_t* countBuff [[buffer(3)]],                          \n\
+                                       uint idx [[thread_position_in_grid]]) {                                  \n\
+    if (idx >= info.maxDrawCount) { return; }                                                                   \n\
+    render_command cmd(icb.cmdBuffer, idx);                                                                     \n\
+    if (idx >= getMultiDrawCount(info, countBuff)) { cmd.reset(); return; }                                     \n\
+    const device auto& src = *reinterpret_cast<const device MTLDrawPrimitivesIndirectArguments*>(srcBuff + idx * info.srcStride);\n\
+    cmd.draw_primitives(primitive_type(info.primitiveType), src.vertexStart, src.vertexCount, src.instanceCount, src.baseInstance);\n\
+}                                                                                                               \n\
+                                                                                                                \n\
+template<typename T>                                                                                            \n\
+static inline void populateIndexedICB(const device char* srcBuff,                                               \n\
+                                      device MVKMultiDrawIndirectCommandBuffer& icb,                            \n\
+                                      constant MVKMultiDrawIndirectInfo& info,                                  \n\
+                                      const device uint32_t* countBuff,                                         \n\
+                                      device T* indexBuff,                                                      \n\
+                                      uint idx) {                                                               \n\
+    if (idx >= info.maxDrawCount) { return; }                                                                   \n\
+    render_command cmd(icb.cmdBuffer, idx);                                                                     \n\
+    if (idx >= getMultiDrawCount(info, countBuff)) { cmd.reset(); return; }                                     \n\
+    const device auto& src = *reinterpret_cast<const device MTLDrawIndexedPrimitivesIndirectArguments*>(srcBuff + idx * info.srcStride);\n\
+    cmd.draw_indexed_primitives(primitive_type(info.primitiveType), src.indexCount, indexBuff + src.indexStart, \n\
+                                src.instanceCount, src.baseVertex, src.baseInstance);                           \n\
+}                                                                                                               \n\
+                                                                                                                \n\
+kernel void cmdDrawIndexedIndirectPopulateICB16(const device char* srcBuff [[buffer(0)]],                       \n\
+                                                device MVKMultiDrawIndirectCommandBuffer& icb [[buffer(1)]],    \n\
+                                                constant MVKMultiDrawIndirectInfo& info [[buffer(2)]],          \n\
+                                                const device uint32_t* countBuff [[buffer(3)]],                 \n\
+                                                device uint16_t* indexBuff [[buffer(4)]],                       \n\
+                                                uint idx [[thread_position_in_grid]]) {                         \n\
+    populateIndexedICB(srcBuff, icb, info, countBuff, indexBuff, idx);                                          \n\
+}                                                                                                               \n\
+                                                                                                                \n\
+kernel void cmdDrawIndexedIndirectPopulateICB32(const device char* srcBuff [[buffer(0)]],                       \n\
+                                                device MVKMultiDrawIndirectCommandBuffer& icb [[buffer(1)]],    \n\
+                                                constant MVKMultiDrawIndirectInfo& info [[buffer(2)]],          \n\
+                                                const device uint32_t* countBuff [[buffer(3)]],                 \n\
+                                                device uint32_t* indexBuff [[buffer(4)]],                       \n\
+                                                uint idx [[thread_position_in_grid]]) {                         \n\
+    populateIndexedICB(srcBuff, icb, info, countBuff, indexBuff, idx);                                          \n\
+}                                                                                                               \n\
+#endif                                                                                                          \n\
+                                                                                                                \n\
 kernel void cmdDrawIndexedCopyIndex16Buffer(const device uint16_t* srcBuff [[buffer(0)]],                       \n\
                                             device uint16_t* destBuff [[buffer(1)]],                            \n\
                                             constant uint32_t& inControlPointCount [[buffer(2)]],               \n\
@@ -291,20 +454,22 @@ kernel void cmdCopyQueryPoolResultsToBuffer(const device VisibilityBuffer* src [
                                             constant uint& numQueries [[buffer(3)]],                            \n\
                                             constant uint& flags [[buffer(4)]],                                 \n\
                                             constant QueryStatus* availability [[buffer(5)]],                   \n\
+                                            constant uint& numElements [[buffer(6)]],                           \n\
                                             uint query [[thread_position_in_grid]]) {                           \n\
     if (query >= numQueries) { return; }                                                                        \n\
     device uint32_t* destCount = (device uint32_t*)(dest + stride * query);                                     \n\
+    uint eltSize = (flags & VK_QUERY_RESULT_64_BIT) ? 2 : 1;                                                    \n\
     if (availability[query] != Initial || flags & VK_QUERY_RESULT_PARTIAL_BIT) {                                \n\
-        destCount[0] = src[query].count;                                                                        \n\
-        if (flags & VK_QUERY_RESULT_64_BIT) { destCount[1] = src[query].countHigh; }                            \n\
+        for (uint elt = 0; elt < numElements; elt++) {                                                          \n\
+            destCount[elt * eltSize] = src[query * numElements + elt].count;                                    \n\
+            if (flags & VK_QUERY_RESULT_64_BIT) {                                                               \n\
+                destCount[elt * eltSize + 1] = src[query * numElements + elt].countHigh;                        \n\
+            }                                                                                                   \n\
+        }                                                                                                       \n\
     }                                                                                                           \n\
     if (flags & VK_QUERY_RESULT_WITH_AVAILABILITY_BIT) {                                                        \n\
-        if (flags & VK_QUERY_RESULT_64_BIT) {                                                                   \n\
-            destCount[2] = availability[query] != Initial ? 1 : 0;                                              \n\
-            destCount[3] = 0;                                                                                   \n\
-        } else {                                                                                                \n\
-            destCount[1] = availability[query] != Initial ? 1 : 0;                                              \n\
-        }                                                                                                       \n\
+        destCount[numElements * eltSize] = availability[query] != Initial ? 1 : 0;                              \n\
+        if (flags & VK_QUERY_RESULT_64_BIT) { destCount[numElements * eltSize + 1] = 0; }                       \n\
     }                                                                                                           \n\
 }                                                                                                               \n\
                                                                                                                 \n\
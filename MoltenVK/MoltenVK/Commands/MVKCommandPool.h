@@ -87,6 +87,9 @@ public:
 	/** Release any held but unused memory back to the system. */
 	void trim();
 
+	/** Returns the sums of the counts of the command objects held by the command type pools of this pool. */
+	MVKObjectPoolCounts getCommandCounts();
+
 
 #pragma mark Construction
 
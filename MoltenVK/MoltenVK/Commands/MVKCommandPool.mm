@@ -56,6 +56,7 @@ VkResult MVKCommandPool::allocateCommandBuffers(const VkCommandBufferAllocateInf
 		mvkCmdBuff->init(pAllocateInfo);
 		_allocatedCommandBuffers.insert(mvkCmdBuff);
         pCmdBuffer[cbIdx] = mvkCmdBuff->getVkCommandBuffer();
+		_device->updateResourceCount(_device->_resourceStatistics.commandBuffers, 1);
 
 		// Command buffers start out in a VK_NOT_READY config result
 		VkResult cbRslt = mvkCmdBuff->getConfigurationResult();
@@ -69,6 +70,7 @@ void MVKCommandPool::freeCommandBuffers(uint32_t commandBufferCount,
 	for (uint32_t cbIdx = 0; cbIdx < commandBufferCount; cbIdx++) {
 		MVKCommandBuffer* mvkCmdBuff = MVKCommandBuffer::getMVKCommandBuffer(pCommandBuffers[cbIdx]);
 		if (_allocatedCommandBuffers.erase(mvkCmdBuff)) {
+			_device->updateResourceCount(_device->_resourceStatistics.commandBuffers, -1);
 			mvkCmdBuff->reset(VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT);
 			_commandBufferPool.returnObject(mvkCmdBuff);
 		}
@@ -76,7 +78,7 @@ void MVKCommandPool::freeCommandBuffers(uint32_t commandBufferCount,
 }
 
 id<MTLCommandBuffer> MVKCommandPool::newMTLCommandBuffer(uint32_t queueIndex) {
-	return [[_device->getQueue(_queueFamilyIndex, queueIndex)->getMTLCommandQueue() commandBuffer] retain];
+	return [_device->getQueue(_queueFamilyIndex, queueIndex)->getMTLCommandBuffer(true) retain];
 }
 
 // Clear the command type pool member variables.
@@ -85,6 +87,19 @@ void MVKCommandPool::trim() {
 #	include "MVKCommandTypePools.def"
 }
 
+// Sum the counts of the command type pool member variables.
+MVKObjectPoolCounts MVKCommandPool::getCommandCounts() {
+	MVKObjectPoolCounts cmdCounts;
+	MVKObjectPoolCounts typeCounts;
+#	define MVK_CMD_TYPE_POOL(cmdType)				\
+	typeCounts = _cmd ##cmdType ##Pool.getCounts();	\
+	cmdCounts.created += typeCounts.created;		\
+	cmdCounts.alive += typeCounts.alive;			\
+	cmdCounts.resident += typeCounts.resident;
+#	include "MVKCommandTypePools.def"
+	return cmdCounts;
+}
+
 
 #pragma mark Construction
 
@@ -104,6 +119,7 @@ MVKCommandPool::MVKCommandPool(MVKDevice* device,
 {}
 
 MVKCommandPool::~MVKCommandPool() {
+	_device->updateResourceCount(_device->_resourceStatistics.commandBuffers, -int64_t(_allocatedCommandBuffers.size()));
 	for (auto& mvkCB : _allocatedCommandBuffers) {
 		_commandBufferPool.returnObject(mvkCB);
 	}
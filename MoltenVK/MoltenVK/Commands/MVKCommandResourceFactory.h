@@ -20,6 +20,7 @@
 
 #include "MVKDevice.h"
 #include "MVKFoundation.h"
+#include "MVKFlatHashMap.h"
 #include "mvk_datatypes.hpp"
 #include <string>
 
@@ -211,7 +212,7 @@ typedef struct MVKMTLDepthStencilDescriptorData {
 	bool operator==(const MVKMTLDepthStencilDescriptorData& rhs) const { return mvkAreEqual(this, &rhs); }
 
 	std::size_t hash() const {
-		return mvkHash((uint64_t*)this, sizeof(*this) / sizeof(uint64_t));
+		return mvkHash(this);
 	}
 
 	/** Disable depth and/or stencil testing. */
@@ -246,6 +247,47 @@ namespace std {
 }
 
 
+#pragma mark -
+#pragma mark MVKMTLSamplerDescriptorData
+
+/**
+ * A structure to hold the normalized configuration data of an MTLSamplerDescriptor instance.
+ * Samplers whose descriptors produce the same data are interchangeable, and instances of this
+ * structure are used as the key when sharing MTLSamplerState instances across a device.
+ */
+typedef struct MVKMTLSamplerDescriptorData {
+	uint8_t minFilter;					/**< The minification filter (interpreted as MTLSamplerMinMagFilter). */
+	uint8_t magFilter;					/**< The magnification filter (interpreted as MTLSamplerMinMagFilter). */
+	uint8_t mipFilter;					/**< The mipmap filter (interpreted as MTLSamplerMipFilter). */
+	uint8_t sAddressMode;				/**< The width address mode (interpreted as MTLSamplerAddressMode). */
+	uint8_t tAddressMode;				/**< The height address mode (interpreted as MTLSamplerAddressMode). */
+	uint8_t rAddressMode;				/**< The depth address mode (interpreted as MTLSamplerAddressMode). */
+	uint8_t compareFunction;			/**< The depth compare function (interpreted as MTLCompareFunction). */
+	uint8_t borderColor;				/**< The border color (interpreted as MTLSamplerBorderColor). */
+	uint16_t maxAnisotropy;				/**< The maximum anisotropy. */
+	bool normalizedCoordinates;			/**< Indicates whether texture coordinates are normalized. */
+	bool supportArgumentBuffers;		/**< Indicates whether the sampler can be encoded into an argument buffer. */
+	float lodMinClamp;					/**< The minimum level of detail. */
+	float lodMaxClamp;					/**< The maximum level of detail. */
+
+	bool operator==(const MVKMTLSamplerDescriptorData& rhs) const { return mvkAreEqual(this, &rhs); }
+
+	std::size_t hash() const {
+		return mvkHash(this);
+	}
+
+	MVKMTLSamplerDescriptorData() { mvkClear(this); }
+
+} __attribute__((aligned(sizeof(uint64_t)))) MVKMTLSamplerDescriptorData;
+
+namespace std {
+	template <>
+	struct hash<MVKMTLSamplerDescriptorData> {
+		std::size_t operator()(const MVKMTLSamplerDescriptorData& k) const { return k.hash(); }
+	};
+}
+
+
 #pragma mark -
 #pragma mark MVKImageDescriptorData
 
@@ -267,7 +309,7 @@ typedef struct MVKImageDescriptorData {
     bool operator==(const MVKImageDescriptorData& rhs) const { return mvkAreEqual(this, &rhs); }
 
 	std::size_t hash() const {
-		return mvkHash((uint64_t*)this, sizeof(*this) / sizeof(uint64_t));
+		return mvkHash(this);
 	}
 
     MVKImageDescriptorData() { mvkClear(this); }
@@ -302,7 +344,7 @@ typedef struct MVKBufferDescriptorData {
     bool operator==(const MVKBufferDescriptorData& rhs) const { return mvkAreEqual(this, &rhs); }
 
 	std::size_t hash() const {
-		return mvkHash((uint64_t*)this, sizeof(*this) / sizeof(uint64_t));
+		return mvkHash(this);
 	}
 
     MVKBufferDescriptorData() { mvkClear(this); }
@@ -369,10 +411,19 @@ public:
 																	 MVKVulkanAPIDeviceObject* owner);
 
 	/**
-	 * Returns a new MTLSamplerState dedicated to rendering to a texture using the
-	 * specified min/mag filter value to support certain Vulkan BLIT commands.
+	 * Returns a MTLSamplerState configured from the specified descriptor, which is shared by all
+	 * samplers on this device whose descriptors are equivalent, and adds a reference to it.
+	 *
+	 * The caller must not release the returned sampler state, and must instead call
+	 * releaseMTLSamplerState() when it is no longer needed. This function is thread-safe.
+	 */
+	id<MTLSamplerState> getMTLSamplerState(MTLSamplerDescriptor* mtlSampDesc);
+
+	/**
+	 * Removes a reference to a MTLSamplerState returned by getMTLSamplerState(),
+	 * and releases it once no references remain. This function is thread-safe.
 	 */
-	id<MTLSamplerState> newCmdBlitImageMTLSamplerState(MTLSamplerMinMagFilter mtlFilter);
+	void releaseMTLSamplerState(id<MTLSamplerState> mtlSamplerState);
 
 	/**
 	 * Returns a new MTLRenderPipelineState dedicated to rendering to several 
@@ -417,10 +468,21 @@ public:
 	id<MTLComputePipelineState> newCmdCopyBufferToImage3DDecompressMTLComputePipelineState(bool needTempBuf,
 																						   MVKVulkanAPIDeviceObject* owner);
 
+	/** Returns a new MTLComputePipelineState for converting depth content between buffers holding different depth formats. */
+	id<MTLComputePipelineState> newCmdConvertDepthBufferMTLComputePipelineState(MVKVulkanAPIDeviceObject* owner);
+
 	/** Returns a new MTLComputePipelineState for converting an indirect buffer for use in a tessellated draw. */
 	id<MTLComputePipelineState> newCmdDrawIndirectConvertBuffersMTLComputePipelineState(bool indexed,
 																						MVKVulkanAPIDeviceObject* owner);
 
+	/** Returns a new MTLComputePipelineState for converting the indirect buffers of many tessellated draws at once. */
+	id<MTLComputePipelineState> newCmdDrawIndirectConvertBatchedBuffersMTLComputePipelineState(MVKVulkanAPIDeviceObject* owner);
+
+	/** Returns a new MTLComputePipelineState for populating a MTLIndirectCommandBuffer from an indirect buffer. */
+	id<MTLComputePipelineState> newCmdDrawIndirectPopulateICBMTLComputePipelineState(bool indexed,
+																					 MTLIndexType type,
+																					 MVKVulkanAPIDeviceObject* owner);
+
 	/** Returns a new MTLComputePipelineState for copying an index buffer for use in a tessellated draw. */
 	id<MTLComputePipelineState> newCmdDrawIndexedCopyIndexBufferMTLComputePipelineState(MTLIndexType type,
 																						MVKVulkanAPIDeviceObject* owner);
@@ -438,6 +500,7 @@ public:
 protected:
 	void initMTLLibrary();
 	void initImageDeviceMemory();
+	MVKMTLSamplerDescriptorData getMTLSamplerDescriptorData(MTLSamplerDescriptor* mtlSampDesc);
 	id<MTLFunction> newBlitFragFunction(MVKRPSKeyBlitImg& blitKey);
 	id<MTLFunction> newClearVertFunction(MVKRPSKeyClearAtt& attKey);
 	id<MTLFunction> newClearFragFunction(MVKRPSKeyClearAtt& attKey);
@@ -449,7 +512,15 @@ protected:
 	id<MTLComputePipelineState> newMTLComputePipelineState(const char* funcName,
 														   MVKVulkanAPIDeviceObject* owner);
 
+	struct MVKSharedMTLSamplerState {
+		id<MTLSamplerState> mtlSamplerState;
+		uint32_t refCount;
+	};
+
 	id<MTLLibrary> _mtlLibrary;
 	MVKDeviceMemory* _transferImageMemory;
+	MVKFlatHashMap<MVKMTLSamplerDescriptorData, MVKSharedMTLSamplerState> _mtlSamplerStates;
+	MVKFlatHashMap<void*, MVKMTLSamplerDescriptorData> _mtlSamplerStateKeys;
+	std::mutex _mtlSamplerStateLock;
 };
 
@@ -23,6 +23,7 @@
 #include "MVKBuffer.h"
 #include "NSString+MoltenVK.h"
 #include "MTLRenderPipelineDescriptor+MoltenVK.h"
+#include "MTLSamplerDescriptor+MoltenVK.h"
 #include "MVKLogging.h"
 
 using namespace std;
@@ -82,22 +83,68 @@ id<MTLRenderPipelineState> MVKCommandResourceFactory::newCmdBlitImageMTLRenderPi
 	return rps;
 }
 
-id<MTLSamplerState> MVKCommandResourceFactory::newCmdBlitImageMTLSamplerState(MTLSamplerMinMagFilter mtlFilter) {
+id<MTLSamplerState> MVKCommandResourceFactory::getMTLSamplerState(MTLSamplerDescriptor* mtlSampDesc) {
+	MVKMTLSamplerDescriptorData sampData = getMTLSamplerDescriptorData(mtlSampDesc);
 
-    MTLSamplerDescriptor* sDesc = [MTLSamplerDescriptor new];					// temp retain
-    sDesc.rAddressMode = MTLSamplerAddressModeClampToZero;
-    sDesc.sAddressMode = MTLSamplerAddressModeClampToZero;
-    sDesc.tAddressMode = MTLSamplerAddressModeClampToZero;
-    sDesc.mipFilter = MTLSamplerMipFilterNotMipmapped;
-    sDesc.normalizedCoordinates = YES;
-    sDesc.minFilter = mtlFilter;
-    sDesc.magFilter = mtlFilter;
+	lock_guard<mutex> lock(_mtlSamplerStateLock);
 
-	id<MTLSamplerState> ss = [getMTLDevice() newSamplerStateWithDescriptor: sDesc];
+	auto iter = _mtlSamplerStates.find(sampData);
+	if (iter != _mtlSamplerStates.end()) {
+		iter->second.refCount++;
+		return iter->second.mtlSamplerState;
+	}
+
+	id<MTLSamplerState> mtlSamplerState = [getMTLDevice() newSamplerStateWithDescriptor: mtlSampDesc];	// retained
+	if ( !mtlSamplerState ) { return nil; }
+
+	_mtlSamplerStates.emplace(sampData, { mtlSamplerState, 1 });
+	_mtlSamplerStateKeys.emplace((void*)mtlSamplerState, sampData);
+	return mtlSamplerState;
+}
 
-	[sDesc release];															// temp release
+void MVKCommandResourceFactory::releaseMTLSamplerState(id<MTLSamplerState> mtlSamplerState) {
+	if ( !mtlSamplerState ) { return; }
 
-	return ss;
+	lock_guard<mutex> lock(_mtlSamplerStateLock);
+
+	auto keyIter = _mtlSamplerStateKeys.find((void*)mtlSamplerState);
+	if (keyIter == _mtlSamplerStateKeys.end()) { return; }
+
+	auto iter = _mtlSamplerStates.find(keyIter->second);
+	if (--iter->second.refCount == 0) {
+		[iter->second.mtlSamplerState release];
+		_mtlSamplerStates.erase(iter);
+		_mtlSamplerStateKeys.erase(keyIter);
+	}
+}
+
+// Returns the data that identifies the sampler state that will be created from the descriptor.
+// Properties that do not affect sampling, such as a border color that is never used, are
+// normalized, so that samplers that only differ in those properties share a sampler state.
+MVKMTLSamplerDescriptorData MVKCommandResourceFactory::getMTLSamplerDescriptorData(MTLSamplerDescriptor* mtlSampDesc) {
+	MVKMTLSamplerDescriptorData sampData;
+	sampData.minFilter = mtlSampDesc.minFilter;
+	sampData.magFilter = mtlSampDesc.magFilter;
+	sampData.mipFilter = mtlSampDesc.mipFilter;
+	sampData.sAddressMode = mtlSampDesc.sAddressMode;
+	sampData.tAddressMode = mtlSampDesc.tAddressMode;
+	sampData.rAddressMode = mtlSampDesc.rAddressMode;
+	sampData.compareFunction = mtlSampDesc.compareFunctionMVK;
+	sampData.maxAnisotropy = mtlSampDesc.maxAnisotropy;
+	sampData.normalizedCoordinates = mtlSampDesc.normalizedCoordinates;
+	sampData.supportArgumentBuffers = _device->shouldUseMetalArgumentBuffers() && mtlSampDesc.supportArgumentBuffers;
+	sampData.lodMinClamp = mtlSampDesc.lodMinClamp;
+	sampData.lodMaxClamp = mtlSampDesc.lodMaxClamp;
+
+#if MVK_MACOS
+	if (sampData.sAddressMode == MTLSamplerAddressModeClampToBorderColor ||
+		sampData.tAddressMode == MTLSamplerAddressModeClampToBorderColor ||
+		sampData.rAddressMode == MTLSamplerAddressModeClampToBorderColor) {
+		sampData.borderColor = mtlSampDesc.borderColorMVK;
+	}
+#endif
+
+	return sampData;
 }
 
 id<MTLRenderPipelineState> MVKCommandResourceFactory::newCmdClearMTLRenderPipelineState(MVKRPSKeyClearAtt& attKey,
@@ -417,6 +464,10 @@ id<MTLComputePipelineState> MVKCommandResourceFactory::newCmdCopyBufferToImage3D
 									  : "cmdCopyBufferToImage3DDecompressDXTn", owner);
 }
 
+id<MTLComputePipelineState> MVKCommandResourceFactory::newCmdConvertDepthBufferMTLComputePipelineState(MVKVulkanAPIDeviceObject* owner) {
+	return newMTLComputePipelineState("cmdConvertDepthBuffer", owner);
+}
+
 id<MTLComputePipelineState> MVKCommandResourceFactory::newCmdDrawIndirectConvertBuffersMTLComputePipelineState(bool indexed,
 																											   MVKVulkanAPIDeviceObject* owner) {
 	return newMTLComputePipelineState(indexed
@@ -424,6 +475,19 @@ id<MTLComputePipelineState> MVKCommandResourceFactory::newCmdDrawIndirectConvert
 									  : "cmdDrawIndirectConvertBuffers", owner);
 }
 
+id<MTLComputePipelineState> MVKCommandResourceFactory::newCmdDrawIndirectConvertBatchedBuffersMTLComputePipelineState(MVKVulkanAPIDeviceObject* owner) {
+	return newMTLComputePipelineState("cmdDrawIndirectConvertBatchedBuffers", owner);
+}
+
+id<MTLComputePipelineState> MVKCommandResourceFactory::newCmdDrawIndirectPopulateICBMTLComputePipelineState(bool indexed,
+																											MTLIndexType type,
+																											MVKVulkanAPIDeviceObject* owner) {
+	if ( !indexed ) { return newMTLComputePipelineState("cmdDrawIndirectPopulateICB", owner); }
+	return newMTLComputePipelineState(type == MTLIndexTypeUInt16
+									  ? "cmdDrawIndexedIndirectPopulateICB16"
+									  : "cmdDrawIndexedIndirectPopulateICB32", owner);
+}
+
 id<MTLComputePipelineState> MVKCommandResourceFactory::newCmdDrawIndexedCopyIndexBufferMTLComputePipelineState(MTLIndexType type,
 																											   MVKVulkanAPIDeviceObject* owner) {
 	return newMTLComputePipelineState(type == MTLIndexTypeUInt16
@@ -503,15 +567,45 @@ MVKCommandResourceFactory::MVKCommandResourceFactory(MVKDevice* device) : MVKBas
 }
 
 // Initializes the Metal shaders used for command activity.
+// Loads the library precompiled for this platform during the build, if available,
+// and falls back to compiling the shaders from MSL source at runtime otherwise.
 void MVKCommandResourceFactory::initMTLLibrary() {
     @autoreleasepool {
         NSError* err = nil;
 		uint64_t startTime = _device->getPerformanceTimestamp();
-        _mtlLibrary = [getMTLDevice() newLibraryWithSource: _MVKStaticCmdShaderSource
-                                                   options: getDevice()->getMTLCompileOptions()
-                                                     error: &err];    // retained
-		MVKAssert( !err, "Could not compile command shaders (Error code %li):\n%s", (long)err.code, err.localizedDescription.UTF8String);
-		_device->addActivityPerformance(_device->_performanceStatistics.shaderCompilation.mslCompile, startTime);
+
+		// The command shaders, and the host structures shared with them, depend on the MSL version,
+		// so a precompiled library can only be used if it was compiled for the MSL version of this device.
+		const MVKStaticCmdShaderLibrary* pStaticLib = nullptr;
+		uint32_t mslVersion = _device->_pMetalFeatures->mslVersion;
+		for (size_t libIdx = 0; libIdx < _MVKStaticCmdShaderLibraryCount; libIdx++) {
+			if (_MVKStaticCmdShaderLibraries[libIdx].mslVersion == mslVersion) {
+				pStaticLib = &_MVKStaticCmdShaderLibraries[libIdx];
+				break;
+			}
+		}
+		if (pStaticLib) {
+			// The library data is static, so wrap it without copying.
+			dispatch_data_t mtlLibData = dispatch_data_create(pStaticLib->data,
+															  pStaticLib->size,
+															  NULL, ^{});						// temp retain
+			_mtlLibrary = [getMTLDevice() newLibraryWithData: mtlLibData error: &err];	// retained
+			[mtlLibData release];														// temp release
+			_device->addActivityPerformance(_device->_performanceStatistics.shaderCompilation.mslLoad, startTime);
+			if ( !_mtlLibrary ) {
+				MVKLogInfo("Could not load precompiled command shaders (Error code %li). They will be compiled from MSL source.\n%s",
+						   (long)err.code, err.localizedDescription.UTF8String);
+				err = nil;
+			}
+		}
+		if ( !_mtlLibrary ) {
+			startTime = _device->getPerformanceTimestamp();
+			_mtlLibrary = [getMTLDevice() newLibraryWithSource: _MVKStaticCmdShaderSource
+													   options: getDevice()->getMTLCompileOptions()
+														 error: &err];    // retained
+			MVKAssert( !err, "Could not compile command shaders (Error code %li):\n%s", (long)err.code, err.localizedDescription.UTF8String);
+			_device->addActivityPerformance(_device->_performanceStatistics.shaderCompilation.mslCompile, startTime);
+		}
     }
 }
 
@@ -527,6 +621,7 @@ void MVKCommandResourceFactory::initImageDeviceMemory() {
 }
 
 MVKCommandResourceFactory::~MVKCommandResourceFactory() {
+	for (auto& pair : _mtlSamplerStates) { [pair.second.mtlSamplerState release]; }
 	[_mtlLibrary release];
 	_mtlLibrary = nil;
 	if (_transferImageMemory) { _transferImageMemory->destroy(); }
@@ -23,6 +23,8 @@
 #include "MVKObjectPool.h"
 #include "MVKDevice.h"
 #include "MVKVector.h"
+#include <mutex>
+#include <vector>
 
 class MVKMTLBufferAllocationPool;
 
@@ -74,8 +76,12 @@ protected:
  *
  * To return a MVKMTLBufferAllocation retrieved from this pool, back to this pool, 
  * call the returnToPool() function on the MVKMTLBufferAllocation instance.
+ *
+ * Allocations are typically acquired by command recording threads and returned from
+ * MTLCommandBuffer completion handlers, so this pool uses per-thread caching to avoid
+ * contention between those threads.
  */
-class MVKMTLBufferAllocationPool : public MVKObjectPool<MVKMTLBufferAllocation> {
+class MVKMTLBufferAllocationPool : public MVKThreadCachedObjectPool<MVKMTLBufferAllocation> {
 
 public:
 
@@ -135,7 +141,8 @@ public:
      * maximum size. Because MVKMTLBufferRegions are created with a power-of-two size,
      * the largest size of a MVKMTLBufferAllocation dispensed by this instance will be the
      * next power-of-two value that is at least as big as the specified maximum size.
-	 * If makeThreadSafe is true, a lock will be applied when an allocation is acquired.
+	 * Allocations are always acquired and returned in a thread-safe manner. The makeThreadSafe
+	 * parameter is retained for compatibility, and has no further effect.
      */
     MVKMTLBufferAllocator(MVKDevice* device, NSUInteger maxRegionLength, bool makeThreadSafe = false);
 
@@ -148,3 +155,104 @@ protected:
 
 };
 
+
+#pragma mark -
+#pragma mark MVKMTLBufferRegion
+
+/** Defines a contiguous region of bytes within a MTLBuffer, that is not tracked as a separate allocation. */
+typedef struct MVKMTLBufferRegion {
+	id<MTLBuffer> mtlBuffer = nil;
+	NSUInteger offset = 0;
+	NSUInteger length = 0;
+
+	/** Returns a pointer to the begining of this region, taking into consideration the offset into the MTLBuffer. */
+	inline void* getContents() const { return (void*)((uintptr_t)mtlBuffer.contents + offset); }
+
+} MVKMTLBufferRegion;
+
+
+#pragma mark -
+#pragma mark MVKMTLBufferRing
+
+/**
+ * A single MTLBuffer, divided into fixed-length blocks that are reserved in ring order
+ * by MVKMTLBufferRingSuballocator instances, and returned once the GPU is done with them.
+ *
+ * A block that has not yet been returned is never skipped over. If the next block in the
+ * ring is still in use, no block is reserved, and the caller should fall back to another
+ * source of memory. Blocks are reserved and returned in a thread-safe manner.
+ */
+class MVKMTLBufferRing : public MVKBaseDeviceObject {
+
+public:
+
+	/** Returns the Vulkan API opaque object controlling this object. */
+	MVKVulkanAPIObject* getVulkanAPIObject() override { return _device->getVulkanAPIObject(); };
+
+	/** Returns the length of each block in this ring. */
+	NSUInteger getBlockLength() { return _blockLength; }
+
+	/** Returns the MTLBuffer underlying this ring. */
+	id<MTLBuffer> getMTLBuffer() { return _mtlBuffer; }
+
+	/**
+	 * Reserves the next block in this ring, and returns its index in blockIndex.
+	 * Returns false if the next block is still in use.
+	 */
+	bool reserveBlock(uint32_t& blockIndex);
+
+	/** Returns the blocks with the specified indexes to this ring. */
+	void returnBlocks(const uint32_t* blockIndexes, uint32_t blockCount);
+
+	/** Configures this instance to hold the specified number of blocks of the specified length. */
+	MVKMTLBufferRing(MVKDevice* device, NSUInteger blockLength, uint32_t blockCount);
+
+	~MVKMTLBufferRing() override;
+
+protected:
+	std::mutex _lock;
+	std::vector<bool> _blocksInUse;
+	id<MTLBuffer> _mtlBuffer;
+	NSUInteger _blockLength;
+	uint32_t _nextBlockIndex;
+};
+
+
+#pragma mark -
+#pragma mark MVKMTLBufferRingSuballocator
+
+/**
+ * Suballocates transient memory for a single MTLCommandBuffer from a MVKMTLBufferRing,
+ * using aligned bumps within the blocks it has reserved from the ring. All of the blocks
+ * are returned to the ring together, once the MTLCommandBuffer has completed.
+ *
+ * This class is not thread-safe, and is intended to be used by a single command encoder.
+ */
+class MVKMTLBufferRingSuballocator {
+
+public:
+
+	/**
+	 * Populates the region with a suballocation of the specified length and alignment,
+	 * and returns whether the suballocation was successful. If the length is larger
+	 * than a ring block, or the ring has no free blocks, returns false.
+	 */
+	bool allocate(NSUInteger length, NSUInteger alignment, MVKMTLBufferRegion& region);
+
+	/**
+	 * Arranges for the ring blocks used by this instance to be returned to the ring once the
+	 * MTLCommandBuffer has completed, and resets this instance for use with another MTLCommandBuffer.
+	 */
+	void returnOnCompletion(id<MTLCommandBuffer> mtlCmdBuff);
+
+	/** Constructs this instance to suballocate from the ring, which may be null to disable suballocation. */
+	MVKMTLBufferRingSuballocator(MVKMTLBufferRing* ring = nullptr) : _ring(ring) {}
+
+	~MVKMTLBufferRingSuballocator();
+
+protected:
+	MVKMTLBufferRing* _ring;
+	std::vector<uint32_t> _blockIndexes;
+	NSUInteger _nextOffset = 0;
+	NSUInteger _blockEnd = 0;
+};
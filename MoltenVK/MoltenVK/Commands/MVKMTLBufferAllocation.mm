@@ -19,6 +19,8 @@
 #include "MVKMTLBufferAllocation.h"
 #include "MVKLogging.h"
 
+using namespace std;
+
 
 #pragma mark -
 #pragma mark MVKMTLBufferAllocation
@@ -47,12 +49,13 @@ MVKMTLBufferAllocation* MVKMTLBufferAllocationPool::newObject() {
 void MVKMTLBufferAllocationPool::addMTLBuffer() {
     MTLResourceOptions mbOpts = MTLResourceStorageModeShared | MTLResourceCPUCacheModeDefaultCache;
     _mtlBuffers.push_back([_device->getMTLDevice() newBufferWithLength: _mtlBufferLength options: mbOpts]);
+    _device->updateResourceCount(_device->_resourceStatistics.internalMTLBufferBytes, _mtlBufferLength);
     _nextOffset = 0;
 }
 
 
 MVKMTLBufferAllocationPool::MVKMTLBufferAllocationPool(MVKDevice* device, NSUInteger allocationLength)
-        : MVKObjectPool<MVKMTLBufferAllocation>(true) {
+        : MVKThreadCachedObjectPool<MVKMTLBufferAllocation>(true) {
     _device = device;
     _allocationLength = allocationLength;
     _mtlBufferLength = _allocationLength * calcMTLBufferAllocationCount();
@@ -70,6 +73,7 @@ uint32_t MVKMTLBufferAllocationPool::calcMTLBufferAllocationCount() {
 }
 
 MVKMTLBufferAllocationPool::~MVKMTLBufferAllocationPool() {
+    _device->updateResourceCount(_device->_resourceStatistics.internalMTLBufferBytes, -int64_t(_mtlBufferLength * _mtlBuffers.size()));
     mvkReleaseContainerContents(_mtlBuffers);
 }
 
@@ -106,3 +110,84 @@ MVKMTLBufferAllocator::~MVKMTLBufferAllocator() {
     mvkDestroyContainerContents(_regionPools);
 }
 
+
+
+#pragma mark -
+#pragma mark MVKMTLBufferRing
+
+// Blocks are reserved in strict ring order, so an in-use block ahead blocks reservation.
+bool MVKMTLBufferRing::reserveBlock(uint32_t& blockIndex) {
+	lock_guard<mutex> lock(_lock);
+	if (_blocksInUse[_nextBlockIndex]) { return false; }
+
+	blockIndex = _nextBlockIndex;
+	_blocksInUse[blockIndex] = true;
+	_nextBlockIndex = (_nextBlockIndex + 1) % _blocksInUse.size();
+	return true;
+}
+
+void MVKMTLBufferRing::returnBlocks(const uint32_t* blockIndexes, uint32_t blockCount) {
+	lock_guard<mutex> lock(_lock);
+	for (uint32_t bIdx = 0; bIdx < blockCount; bIdx++) { _blocksInUse[blockIndexes[bIdx]] = false; }
+}
+
+MVKMTLBufferRing::MVKMTLBufferRing(MVKDevice* device, NSUInteger blockLength, uint32_t blockCount)
+		: MVKBaseDeviceObject(device), _blocksInUse(blockCount, false) {
+	_blockLength = blockLength;
+	_nextBlockIndex = 0;
+
+	MTLResourceOptions mbOpts = MTLResourceStorageModeShared | MTLResourceCPUCacheModeDefaultCache;
+	_mtlBuffer = [_device->getMTLDevice() newBufferWithLength: _blockLength * blockCount options: mbOpts];	// retained
+	_device->updateResourceCount(_device->_resourceStatistics.internalMTLBufferBytes, _mtlBuffer.length);
+}
+
+MVKMTLBufferRing::~MVKMTLBufferRing() {
+	_device->updateResourceCount(_device->_resourceStatistics.internalMTLBufferBytes, -int64_t(_mtlBuffer.length));
+	[_mtlBuffer release];
+}
+
+
+#pragma mark -
+#pragma mark MVKMTLBufferRingSuballocator
+
+bool MVKMTLBufferRingSuballocator::allocate(NSUInteger length, NSUInteger alignment, MVKMTLBufferRegion& region) {
+	if ( !_ring || length > _ring->getBlockLength() ) { return false; }
+
+	// If the allocation does not fit in the current block, reserve the next block from the ring
+	NSUInteger offset = mvkAlignByteCount(_nextOffset, alignment);
+	if (_blockIndexes.empty() || offset + length > _blockEnd) {
+		uint32_t blockIdx;
+		if ( !_ring->reserveBlock(blockIdx) ) { return false; }
+
+		_blockIndexes.push_back(blockIdx);
+		offset = blockIdx * _ring->getBlockLength();
+		_blockEnd = offset + _ring->getBlockLength();
+	}
+	_nextOffset = offset + length;
+
+	region.mtlBuffer = _ring->getMTLBuffer();
+	region.offset = offset;
+	region.length = length;
+	return true;
+}
+
+void MVKMTLBufferRingSuballocator::returnOnCompletion(id<MTLCommandBuffer> mtlCmdBuff) {
+	if (_blockIndexes.empty()) { return; }
+
+	MVKMTLBufferRing* ring = _ring;
+	vector<uint32_t> blockIndexes(std::move(_blockIndexes));
+	_blockIndexes.clear();
+	[mtlCmdBuff addCompletedHandler: ^(id<MTLCommandBuffer> mcb) {
+		ring->returnBlocks(blockIndexes.data(), (uint32_t)blockIndexes.size());
+	}];
+
+	_nextOffset = 0;
+	_blockEnd = 0;
+}
+
+// Blocks that were never attached to a MTLCommandBuffer were never used by the GPU.
+MVKMTLBufferRingSuballocator::~MVKMTLBufferRingSuballocator() {
+	if (_ring && !_blockIndexes.empty()) {
+		_ring->returnBlocks(_blockIndexes.data(), (uint32_t)_blockIndexes.size());
+	}
+}
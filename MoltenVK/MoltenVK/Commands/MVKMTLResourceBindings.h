@@ -50,12 +50,21 @@ typedef struct {
     uint32_t size = 0;
 	uint16_t index = 0;
     bool isDirty = true;
+    bool isOffsetDirty = false;     // Only the offset has changed since the buffer was last encoded
     bool isInline = false;
 } MVKMTLBufferBinding;
 
+/** Describes a MTLResource that is accessed indirectly by a shader, through a Metal argument buffer. */
+typedef struct {
+    id<MTLResource> mtlResource = nil;
+    MTLResourceUsage mtlUsage = MTLResourceUsageRead;
+    bool isDirty = true;
+} MVKMTLResourceUsage;
+
 /** Describes a MTLBuffer resource binding as used for an index buffer. */
 typedef struct {
     union { id<MTLBuffer> mtlBuffer = nil; id<MTLBuffer> mtlResource; }; // aliases
+    MVKBuffer* mvkBuffer = nullptr;
     VkDeviceSize offset = 0;
     uint8_t mtlIndexType = 0;		// MTLIndexType
     bool isDirty = true;
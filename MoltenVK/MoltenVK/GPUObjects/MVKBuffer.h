@@ -68,6 +68,29 @@ public:
     /** Returns the intended usage of this buffer. */
     VkBufferUsageFlags getUsage() const { return _usage; }
 
+	/**
+	 * Returns whether all changes to the content of this buffer are visible to MoltenVK, and are
+	 * recorded by markContentChanged(). This is the case if the buffer is not accessible from the
+	 * host, is not used as a storage buffer, and does not share its memory with another resource,
+	 * so its content can only change through transfers to this buffer.
+	 */
+	bool canTrackContentChanges();
+
+	/**
+	 * Returns a value that identifies the current content of this buffer. Each value is unique
+	 * across all buffers, and is replaced whenever markContentChanged() is called. This is only
+	 * meaningful if canTrackContentChanges() returns true.
+	 */
+	uint64_t getContentGeneration() { return _contentGeneration; }
+
+	/**
+	 * Marks that the content of this buffer is being changed by an encoded command. Since this is
+	 * called as the command is encoded, the content generation follows the order in which commands are
+	 * encoded, and any content derived from it that is shared across MTLCommandBuffers must only be used
+	 * once the MTLCommandBuffer that derived it has completed.
+	 */
+	void markContentChanged();
+
 
 #pragma mark Metal
 
@@ -75,7 +98,7 @@ public:
 	id<MTLBuffer> getMTLBuffer();
 
 	/** Returns the offset at which the contents of this instance starts within the underlying Metal buffer. */
-	inline NSUInteger getMTLBufferOffset() { return !_deviceMemory || _deviceMemory->getMTLHeap() || _isHostCoherentTexelBuffer ? 0 : _deviceMemoryOffset; }
+	inline NSUInteger getMTLBufferOffset() { return !_deviceMemory || _deviceMemory->getMTLHeap() || _isHostCoherentTexelBuffer ? 0 : _deviceMemory->getMTLBufferOffset() + _deviceMemoryOffset; }
 
 
 #pragma mark Construction
@@ -98,11 +121,44 @@ protected:
 	void initExternalMemory(VkExternalMemoryHandleTypeFlags handleTypes);
 
 	VkBufferUsageFlags _usage;
+	std::atomic<uint64_t> _contentGeneration;
 	bool _isHostCoherentTexelBuffer = false;
 	id<MTLBuffer> _mtlBuffer = nil;
 };
 
 
+#pragma mark MVKTexelBufferTextureKey
+
+/**
+ * Identifies the MTLTexture that overlays a range of a MTLBuffer for a texel buffer view.
+ * Instances of this structure can be used as a map key.
+ */
+typedef struct MVKTexelBufferTextureKey {
+	uint64_t mtlBuffer;			/**< The MTLBuffer that the texture overlays (interpreted as id<MTLBuffer>). */
+	uint64_t offset;
+	uint64_t bytesPerRow;
+	uint32_t width;
+	uint32_t height;
+	uint32_t mtlPixelFormat;	/**< The pixel format of the texture (interpreted as MTLPixelFormat). */
+	uint32_t mtlUsage;			/**< The usage of the texture (interpreted as MTLTextureUsage). */
+
+	bool operator==(const MVKTexelBufferTextureKey& rhs) const { return mvkAreEqual(this, &rhs); }
+
+	std::size_t hash() const {
+		return mvkHash(this);
+	}
+
+} __attribute__((aligned(sizeof(uint64_t)))) MVKTexelBufferTextureKey;
+
+namespace std {
+	template <>
+	struct hash<MVKTexelBufferTextureKey> {
+		std::size_t operator()(const MVKTexelBufferTextureKey& k) const { return k.hash(); }
+	};
+}
+
+
+#pragma mark -
 #pragma mark MVKBufferView
 
 /** Represents a Vulkan buffer view. */
@@ -129,7 +185,8 @@ public:
     ~MVKBufferView() override;
 
 protected:
-	void propogateDebugName() override;
+	// The MTLTexture may be shared with other buffer views through the texel buffer texture cache, so it is not labeled.
+	void propogateDebugName() override {}
 
     MVKBuffer* _buffer;
 	id<MTLTexture> _mtlTexture;
@@ -137,6 +194,48 @@ protected:
     NSUInteger _mtlBufferOffset;
 	NSUInteger _mtlBytesPerRow;
     VkExtent2D _textureSize;
+	MVKTexelBufferTextureKey _mtlTextureKey;
+	std::mutex _lock;
+};
+
+
+#pragma mark -
+#pragma mark MVKTexelBufferTextureCache
+
+/**
+ * A device-wide cache of the MTLTextures that overlay MTLBuffers for texel buffer views,
+ * so that buffer views with the same layout over the same MTLBuffer, such as those that
+ * are recreated each frame, share a single MTLTexture. Each MTLTexture is reference
+ * counted by the buffer views using it, and is released when the last of them is destroyed.
+ */
+class MVKTexelBufferTextureCache : public MVKBaseDeviceObject {
+
+public:
+
+	/** Returns the Vulkan API opaque object controlling this object. */
+	MVKVulkanAPIObject* getVulkanAPIObject() override { return _device->getVulkanAPIObject(); };
+
+	/**
+	 * Returns a MTLTexture with the layout of the key, overlaying the MTLBuffer identified by the key,
+	 * creating it if needed, or returns nil if it could not be created. The MTLTexture is owned by this
+	 * cache, and each successful call must be balanced by a call to releaseMTLTexture() with the same key.
+	 */
+	id<MTLTexture> retainMTLTexture(id<MTLBuffer> mtlBuffer, const MVKTexelBufferTextureKey& key);
+
+	/** Releases a use of the MTLTexture with the key, and frees it if it is no longer used. */
+	void releaseMTLTexture(const MVKTexelBufferTextureKey& key);
+
+	MVKTexelBufferTextureCache(MVKDevice* device) : MVKBaseDeviceObject(device) {}
+
+	~MVKTexelBufferTextureCache() override;
+
+protected:
+	typedef struct {
+		id<MTLTexture> mtlTexture;
+		uint32_t useCount;
+	} MVKTexelBufferTexture;
+
+	std::unordered_map<MVKTexelBufferTextureKey, MVKTexelBufferTexture> _mtlTextures;
 	std::mutex _lock;
 };
 
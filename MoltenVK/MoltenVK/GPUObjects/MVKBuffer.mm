@@ -170,7 +170,7 @@ id<MTLBuffer> MVKBuffer::getMTLBuffer() {
 		if (_deviceMemory->getMTLHeap()) {
 			_mtlBuffer = [_deviceMemory->getMTLHeap() newBufferWithLength: getByteCount()
 																  options: _deviceMemory->getMTLResourceOptions()
-																   offset: _deviceMemoryOffset];	// retained
+																   offset: _deviceMemory->getMTLHeapOffset() + _deviceMemoryOffset];	// retained
 			propogateDebugName();
 			return _mtlBuffer;
 #if MVK_MACOS
@@ -178,7 +178,8 @@ id<MTLBuffer> MVKBuffer::getMTLBuffer() {
 			// According to the Vulkan spec, buffers, like linear images, can always use host-coherent memory.
 			// But texel buffers on Mac cannot use shared memory. So we need to use host-cached memory here.
 			_mtlBuffer = [_device->getMTLDevice() newBufferWithLength: getByteCount()
-															  options: MTLResourceStorageModeManaged];	// retained
+															  options: (MTLResourceStorageModeManaged |
+																		_device->getMTLResourceHazardTrackingOptions())];	// retained
 			propogateDebugName();
 			return _mtlBuffer;
 #endif
@@ -190,9 +191,27 @@ id<MTLBuffer> MVKBuffer::getMTLBuffer() {
 }
 
 
+#pragma mark Content tracking
+
+// Shared by all buffers, so that each content generation value identifies a single buffer.
+static std::atomic<uint64_t> _mvkNextBufferContentGeneration(1);
+
+bool MVKBuffer::canTrackContentChanges() {
+	return (_deviceMemory && !isMemoryHostAccessible() && !_externalMemoryHandleTypes &&
+			!mvkIsAnyFlagEnabled(_usage, (VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+										  VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT)) &&
+			!_deviceMemory->hasOverlappingResource(this));
+}
+
+void MVKBuffer::markContentChanged() {
+	_contentGeneration = _mvkNextBufferContentGeneration++;
+}
+
+
 #pragma mark Construction
 
 MVKBuffer::MVKBuffer(MVKDevice* device, const VkBufferCreateInfo* pCreateInfo) : MVKResource(device), _usage(pCreateInfo->usage) {
+	markContentChanged();
     _byteAlignment = _device->_pMetalFeatures->mtlBufferAlignment;
     _byteCount = pCreateInfo->size;
 
@@ -214,8 +233,10 @@ void MVKBuffer::initExternalMemory(VkExternalMemoryHandleTypeFlags handleTypes)
 		_externalMemoryHandleTypes = handleTypes;
 		auto& xmProps = _device->getPhysicalDevice()->getExternalBufferProperties(VK_EXTERNAL_MEMORY_HANDLE_TYPE_MTLBUFFER_BIT_KHR);
 		_requiresDedicatedMemoryAllocation = _requiresDedicatedMemoryAllocation || mvkIsAnyFlagEnabled(xmProps.externalMemoryFeatures, VK_EXTERNAL_MEMORY_FEATURE_DEDICATED_ONLY_BIT);
+	} else if (mvkIsOnlyAnyFlagEnabled(handleTypes, VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT)) {
+		_externalMemoryHandleTypes = handleTypes;
 	} else {
-		setConfigurationResult(reportError(VK_ERROR_FEATURE_NOT_PRESENT, "vkCreateBuffer(): Only external memory handle type VK_EXTERNAL_MEMORY_HANDLE_TYPE_MTLBUFFER_BIT_KHR is supported."));
+		setConfigurationResult(reportError(VK_ERROR_FEATURE_NOT_PRESENT, "vkCreateBuffer(): Only external memory handle types VK_EXTERNAL_MEMORY_HANDLE_TYPE_MTLBUFFER_BIT_KHR or VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT are supported."));
 	}
 }
 
@@ -228,10 +249,6 @@ MVKBuffer::~MVKBuffer() {
 #pragma mark -
 #pragma mark MVKBufferView
 
-void MVKBufferView::propogateDebugName() {
-	setLabelIfNotNil(_mtlTexture, _debugName);
-}
-
 #pragma mark Metal
 
 id<MTLTexture> MVKBufferView::getMTLTexture() {
@@ -246,25 +263,18 @@ id<MTLTexture> MVKBufferView::getMTLTexture() {
             usage |= MTLTextureUsageShaderWrite;
         }
         id<MTLBuffer> mtlBuff = _buffer->getMTLBuffer();
-        MTLTextureDescriptor* mtlTexDesc;
-        if ( _device->_pMetalFeatures->textureBuffers ) {
-            mtlTexDesc = [MTLTextureDescriptor textureBufferDescriptorWithPixelFormat: _mtlPixelFormat
-                                                                                width: _textureSize.width
-                                                                      resourceOptions: (mtlBuff.cpuCacheMode << MTLResourceCPUCacheModeShift) | (mtlBuff.storageMode << MTLResourceStorageModeShift)
-                                                                                usage: usage];
-        } else {
-            mtlTexDesc = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat: _mtlPixelFormat
-                                                                            width: _textureSize.width
-                                                                           height: _textureSize.height
-                                                                        mipmapped: NO];
-            mtlTexDesc.storageMode = mtlBuff.storageMode;
-            mtlTexDesc.cpuCacheMode = mtlBuff.cpuCacheMode;
-            mtlTexDesc.usage = usage;
-        }
-		_mtlTexture = [mtlBuff newTextureWithDescriptor: mtlTexDesc
-												 offset: _mtlBufferOffset
-											bytesPerRow: _mtlBytesPerRow];
-		propogateDebugName();
+		_mtlTextureKey.mtlBuffer = (uint64_t)mtlBuff;
+		_mtlTextureKey.offset = _mtlBufferOffset;
+		_mtlTextureKey.bytesPerRow = _mtlBytesPerRow;
+		_mtlTextureKey.width = _textureSize.width;
+		_mtlTextureKey.height = _textureSize.height;
+		_mtlTextureKey.mtlPixelFormat = _mtlPixelFormat;
+		_mtlTextureKey.mtlUsage = (uint32_t)usage;
+		_mtlTexture = _device->getTexelBufferTextureCache()->retainMTLTexture(mtlBuff, _mtlTextureKey);
+		if ( !_mtlTexture ) {
+			reportError(VK_ERROR_FORMAT_NOT_SUPPORTED, "Could not create a MTLTexture of format %s overlaying the MTLBuffer at offset %lu with %lu bytes per row.",
+						getPixelFormats()->getName(_mtlPixelFormat), (unsigned long)_mtlBufferOffset, (unsigned long)_mtlBytesPerRow);
+		}
     }
     return _mtlTexture;
 }
@@ -312,7 +322,63 @@ MVKBufferView::MVKBufferView(MVKDevice* device, const VkBufferViewCreateInfo* pC
 }
 
 MVKBufferView::~MVKBufferView() {
-    [_mtlTexture release];
+	if (_mtlTexture) { _device->getTexelBufferTextureCache()->releaseMTLTexture(_mtlTextureKey); }
     _mtlTexture = nil;
 }
 
+
+#pragma mark -
+#pragma mark MVKTexelBufferTextureCache
+
+id<MTLTexture> MVKTexelBufferTextureCache::retainMTLTexture(id<MTLBuffer> mtlBuffer, const MVKTexelBufferTextureKey& key) {
+	lock_guard<mutex> lock(_lock);
+
+	auto iter = _mtlTextures.find(key);
+	if (iter != _mtlTextures.end()) {
+		iter->second.useCount++;
+		return iter->second.mtlTexture;
+	}
+
+	MTLPixelFormat mtlPixFmt = (MTLPixelFormat)key.mtlPixelFormat;
+	MTLTextureUsage usage = (MTLTextureUsage)key.mtlUsage;
+	MTLTextureDescriptor* mtlTexDesc;
+	if ( _device->_pMetalFeatures->textureBuffers ) {
+		mtlTexDesc = [MTLTextureDescriptor textureBufferDescriptorWithPixelFormat: mtlPixFmt
+																			width: key.width
+																  resourceOptions: (mtlBuffer.cpuCacheMode << MTLResourceCPUCacheModeShift) | (mtlBuffer.storageMode << MTLResourceStorageModeShift)
+																			usage: usage];
+	} else {
+		mtlTexDesc = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat: mtlPixFmt
+																		width: key.width
+																	   height: key.height
+																	mipmapped: NO];
+		mtlTexDesc.storageMode = mtlBuffer.storageMode;
+		mtlTexDesc.cpuCacheMode = mtlBuffer.cpuCacheMode;
+		mtlTexDesc.usage = usage;
+	}
+
+	// The MTLTexture retains the MTLBuffer, so the MTLBuffer cannot be freed, and its address reused
+	// in another key, while the MTLTexture is in this cache.
+	id<MTLTexture> mtlTex = [mtlBuffer newTextureWithDescriptor: mtlTexDesc
+														  offset: key.offset
+													 bytesPerRow: key.bytesPerRow];		// retained
+	if (mtlTex) { _mtlTextures[key] = { mtlTex, 1 }; }
+	return mtlTex;
+}
+
+void MVKTexelBufferTextureCache::releaseMTLTexture(const MVKTexelBufferTextureKey& key) {
+	lock_guard<mutex> lock(_lock);
+
+	auto iter = _mtlTextures.find(key);
+	if (iter == _mtlTextures.end()) { return; }
+
+	if (--iter->second.useCount == 0) {
+		[iter->second.mtlTexture release];
+		_mtlTextures.erase(iter);
+	}
+}
+
+MVKTexelBufferTextureCache::~MVKTexelBufferTextureCache() {
+	for (auto& texPair : _mtlTextures) { [texPair.second.mtlTexture release]; }
+}
+
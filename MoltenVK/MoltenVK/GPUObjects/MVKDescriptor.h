@@ -80,6 +80,9 @@ public:
 	/** Returns the immutable sampler at the index, or nullptr if immutable samplers are not used. */
 	MVKSampler* getImmutableSampler(uint32_t index);
 
+	/** Returns whether the immutable samplers of this layout are hardcoded into the shader MSL, and are never bound. */
+	inline bool usesConstExprSampler() { return _usesConstExprSampler; }
+
 	/**
 	 * Encodes the descriptors in the descriptor set that are specified by this layout,
 	 * starting with the descriptor at the index, on the the command encoder.
@@ -102,10 +105,32 @@ public:
               const void* pData,
               MVKShaderResourceBinding& dslMTLRezIdxOffsets);
 
-	/** Populates the specified shader converter context, at the specified descriptor set binding. */
+	/**
+	 * Declares to the command encoder the Metal resources of the descriptors in the descriptor set
+	 * that are specified by this layout, starting with the descriptor at the index, and which are
+	 * accessed through the Metal argument buffer of the descriptor set.
+	 * Returns the number of descriptors that were declared.
+	 */
+	uint32_t useMetalResources(MVKCommandEncoder* cmdEncoder,
+							   MVKDescriptorSet* descSet,
+							   uint32_t descStartIndex);
+
+	/**
+	 * Assigns the Metal argument buffer indexes used by this binding, starting at the specified
+	 * index, and adds a Metal argument descriptor for each resource type used by this binding
+	 * to the array. Returns the Metal argument buffer index following those used by this binding.
+	 */
+	uint32_t addMTLArgumentDescriptors(NSMutableArray<MTLArgumentDescriptor*>* mtlArgDescs, uint32_t argIndex);
+
+	/**
+	 * Populates the specified shader converter context, at the specified descriptor set binding.
+	 * If useMetalArgumentBuffer is true, the Metal argument buffer indexes of this binding are
+	 * used, and the dslMTLRezIdxOffsets are ignored.
+	 */
 	void populateShaderConverterContext(mvk::SPIRVToMSLConversionConfiguration& context,
                                         MVKShaderResourceBinding& dslMTLRezIdxOffsets,
-                                        uint32_t dslIndex);
+                                        uint32_t dslIndex,
+                                        bool useMetalArgumentBuffer);
 
 	MVKDescriptorSetLayoutBinding(MVKDevice* device,
 								  MVKDescriptorSetLayout* layout,
@@ -116,16 +141,23 @@ public:
 	~MVKDescriptorSetLayoutBinding() override;
 
 protected:
+	friend class MVKDescriptorSetLayout;
+
 	void initMetalResourceIndexOffsets(MVKShaderStageResourceBinding* pBindingIndexes,
 									   MVKShaderStageResourceBinding* pDescSetCounts,
 									   const VkDescriptorSetLayoutBinding* pBinding);
+	void initMetalResourceSlots(MVKShaderStageResourceBinding* pDescSetSlotCounts);
 	bool validate(MVKSampler* mvkSampler);
 
 	MVKDescriptorSetLayout* _layout;
 	VkDescriptorSetLayoutBinding _info;
 	std::vector<MVKSampler*> _immutableSamplers;
 	MVKShaderResourceBinding _mtlResourceIndexOffsets;
+	MVKShaderStageResourceBinding _mtlResourceSlotOffsets;
+	MVKShaderStageResourceBinding _mtlResourceSlotCounts;
+	MVKShaderStageResourceBinding _mtlArgumentBufferIndexes;
 	bool _applyToStage[kMVKShaderStageMax];
+	bool _usesConstExprSampler;
 };
 
 
@@ -179,6 +211,34 @@ public:
 					  VkBufferView* pTexelBufferView,
 					  VkWriteDescriptorSetInlineUniformBlockEXT* inlineUniformBlock) = 0;
 
+	/**
+	 * Encodes the Metal resources of this descriptor into the Metal argument buffer currently
+	 * attached to the Metal argument encoder, at the argument buffer indexes of the layout
+	 * binding, offset by the index of this descriptor within the layout binding.
+	 */
+	virtual void encodeToMetalArgumentBuffer(id<MTLArgumentEncoder> mtlArgEncoder,
+											 VkDescriptorType descriptorType,
+											 uint32_t descriptorIndex,
+											 MVKShaderStageResourceBinding& argIndexes) {}
+
+	/**
+	 * Populates the flat Metal resource bindings of the descriptor set with the Metal resources
+	 * of this descriptor, at the resource slots of the layout binding, offset by the index of
+	 * this descriptor within the layout binding.
+	 */
+	virtual void populateMetalResourceBindings(MVKDescriptorSet* descSet,
+											   VkDescriptorType descriptorType,
+											   uint32_t descriptorIndex,
+											   MVKShaderStageResourceBinding& slots) {}
+
+	/**
+	 * Declares to the command encoder that the shader stages will access the Metal
+	 * resources of this descriptor indirectly, through a Metal argument buffer.
+	 */
+	virtual void useMetalResources(MVKCommandEncoder* cmdEncoder,
+								   VkDescriptorType descriptorType,
+								   bool stages[]) {}
+
 	/** Sets the binding layout. */
 	virtual void setLayout(MVKDescriptorSetLayoutBinding* dslBinding, uint32_t index) {}
 
@@ -187,6 +247,11 @@ public:
 
 	~MVKDescriptor() { reset(); }
 
+protected:
+	void useMetalResource(MVKCommandEncoder* cmdEncoder, bool stages[],
+						  id<MTLResource> mtlResource, MTLResourceUsage mtlUsage);
+
+	bool _retainsResources = true;
 };
 
 
@@ -219,6 +284,20 @@ public:
 			  VkBufferView* pTexelBufferView,
 			  VkWriteDescriptorSetInlineUniformBlockEXT* inlineUniformBlock) override;
 
+	void populateMetalResourceBindings(MVKDescriptorSet* descSet,
+									   VkDescriptorType descriptorType,
+									   uint32_t descriptorIndex,
+									   MVKShaderStageResourceBinding& slots) override;
+
+	void encodeToMetalArgumentBuffer(id<MTLArgumentEncoder> mtlArgEncoder,
+									 VkDescriptorType descriptorType,
+									 uint32_t descriptorIndex,
+									 MVKShaderStageResourceBinding& argIndexes) override;
+
+	void useMetalResources(MVKCommandEncoder* cmdEncoder,
+						   VkDescriptorType descriptorType,
+						   bool stages[]) override;
+
 	void reset() override;
 
 	~MVKBufferDescriptor() { reset(); }
@@ -297,6 +376,11 @@ public:
 			  VkBufferView* pTexelBufferView,
 			  VkWriteDescriptorSetInlineUniformBlockEXT* inlineUniformBlock) override;
 
+	void populateMetalResourceBindings(MVKDescriptorSet* descSet,
+									   VkDescriptorType descriptorType,
+									   uint32_t descriptorIndex,
+									   MVKShaderStageResourceBinding& slots) override;
+
 	void reset() override;
 
 	~MVKInlineUniformBlockDescriptor() { reset(); }
@@ -336,11 +420,27 @@ public:
 			  VkBufferView* pTexelBufferView,
 			  VkWriteDescriptorSetInlineUniformBlockEXT* inlineUniformBlock) override;
 
+	void populateMetalResourceBindings(MVKDescriptorSet* descSet,
+									   VkDescriptorType descriptorType,
+									   uint32_t descriptorIndex,
+									   MVKShaderStageResourceBinding& slots) override;
+
+	void encodeToMetalArgumentBuffer(id<MTLArgumentEncoder> mtlArgEncoder,
+									 VkDescriptorType descriptorType,
+									 uint32_t descriptorIndex,
+									 MVKShaderStageResourceBinding& argIndexes) override;
+
+	void useMetalResources(MVKCommandEncoder* cmdEncoder,
+						   VkDescriptorType descriptorType,
+						   bool stages[]) override;
+
 	void reset() override;
 
 	~MVKImageDescriptor() { reset(); }
 
 protected:
+	void getMTLResourceBindings(VkDescriptorType descriptorType, MVKMTLTextureBinding& tb, MVKMTLBufferBinding& bb);
+
 	MVKImageView* _mvkImageView = nullptr;
 	VkImageLayout _imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 };
@@ -408,6 +508,16 @@ protected:
 			  VkBufferView* pTexelBufferView,
 			  VkWriteDescriptorSetInlineUniformBlockEXT* inlineUniformBlock);
 
+	void populateMetalResourceBindings(MVKDescriptorSet* descSet,
+									   VkDescriptorType descriptorType,
+									   uint32_t descriptorIndex,
+									   MVKShaderStageResourceBinding& slots);
+
+	void encodeToMetalArgumentBuffer(id<MTLArgumentEncoder> mtlArgEncoder,
+									 VkDescriptorType descriptorType,
+									 uint32_t descriptorIndex,
+									 MVKShaderStageResourceBinding& argIndexes);
+
 	void setLayout(MVKDescriptorSetLayoutBinding* dslBinding, uint32_t index);
 
 	void reset();
@@ -416,6 +526,8 @@ protected:
 
 	MVKSampler* _mvkSampler = nullptr;
 	bool _hasDynamicSampler = true;
+	bool _usesConstExprSampler = false;
+	bool _retainsDynamicSampler = true;
 };
 
 
@@ -450,6 +562,16 @@ public:
 			  VkBufferView* pTexelBufferView,
 			  VkWriteDescriptorSetInlineUniformBlockEXT* inlineUniformBlock) override;
 
+	void populateMetalResourceBindings(MVKDescriptorSet* descSet,
+									   VkDescriptorType descriptorType,
+									   uint32_t descriptorIndex,
+									   MVKShaderStageResourceBinding& slots) override;
+
+	void encodeToMetalArgumentBuffer(id<MTLArgumentEncoder> mtlArgEncoder,
+									 VkDescriptorType descriptorType,
+									 uint32_t descriptorIndex,
+									 MVKShaderStageResourceBinding& argIndexes) override;
+
 	void setLayout(MVKDescriptorSetLayoutBinding* dslBinding, uint32_t index) override;
 
 	void reset() override;
@@ -490,6 +612,20 @@ public:
 			  VkBufferView* pTexelBufferView,
 			  VkWriteDescriptorSetInlineUniformBlockEXT* inlineUniformBlock) override;
 
+	void populateMetalResourceBindings(MVKDescriptorSet* descSet,
+									   VkDescriptorType descriptorType,
+									   uint32_t descriptorIndex,
+									   MVKShaderStageResourceBinding& slots) override;
+
+	void encodeToMetalArgumentBuffer(id<MTLArgumentEncoder> mtlArgEncoder,
+									 VkDescriptorType descriptorType,
+									 uint32_t descriptorIndex,
+									 MVKShaderStageResourceBinding& argIndexes) override;
+
+	void useMetalResources(MVKCommandEncoder* cmdEncoder,
+						   VkDescriptorType descriptorType,
+						   bool stages[]) override;
+
 	void setLayout(MVKDescriptorSetLayoutBinding* dslBinding, uint32_t index) override;
 
 	void reset() override;
@@ -528,11 +664,27 @@ public:
 			  VkBufferView* pTexelBufferView,
 			  VkWriteDescriptorSetInlineUniformBlockEXT* inlineUniformBlock) override;
 
+	void populateMetalResourceBindings(MVKDescriptorSet* descSet,
+									   VkDescriptorType descriptorType,
+									   uint32_t descriptorIndex,
+									   MVKShaderStageResourceBinding& slots) override;
+
+	void encodeToMetalArgumentBuffer(id<MTLArgumentEncoder> mtlArgEncoder,
+									 VkDescriptorType descriptorType,
+									 uint32_t descriptorIndex,
+									 MVKShaderStageResourceBinding& argIndexes) override;
+
+	void useMetalResources(MVKCommandEncoder* cmdEncoder,
+						   VkDescriptorType descriptorType,
+						   bool stages[]) override;
+
 	void reset() override;
 
 	~MVKTexelBufferDescriptor() { reset(); }
 
 protected:
+	void getMTLResourceBindings(VkDescriptorType descriptorType, MVKMTLTextureBinding& tb, MVKMTLBufferBinding& bb);
+
 	MVKBufferView* _mvkBufferView = nullptr;
 };
 
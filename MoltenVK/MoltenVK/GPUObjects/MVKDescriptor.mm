@@ -90,11 +90,75 @@ uint32_t MVKDescriptorSetLayoutBinding::bind(MVKCommandEncoder* cmdEncoder,
     MVKShaderResourceBinding mtlIdxs = _mtlResourceIndexOffsets + dslMTLRezIdxOffsets;
 
 	uint32_t descCnt = _info.descriptorCount;
-    for (uint32_t descIdx = 0; descIdx < descCnt; descIdx++) {
+
+	// Descriptors whose Metal resources may have changed since they were written are bound individually.
+	if (descSet->hasVolatileMTLResources()) {
+		for (uint32_t descIdx = 0; descIdx < descCnt; descIdx++) {
+			MVKDescriptor* mvkDesc = descSet->getDescriptor(descStartIndex + descIdx);
+			mvkDesc->bind(cmdEncoder, _info.descriptorType, descIdx, _applyToStage,
+						  mtlIdxs, pDynamicOffsets, pDynamicOffsetIndex);
+		}
+		return descCnt;
+	}
+
+	// Dynamic offsets are consumed once per descriptor, and apply to that descriptor in all stages.
+	uint32_t dynOffsetStartIdx = 0;
+	bool hasDynamicOffsets = (pDynamicOffsets &&
+							  (_info.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC ||
+							   _info.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC));
+	if (hasDynamicOffsets) {
+		dynOffsetStartIdx = *pDynamicOffsetIndex;
+		*pDynamicOffsetIndex += descCnt;	// Feedback to caller
+	}
+
+	if ( !cmdEncoder ) { return descCnt; }
+
+	// The ranges of Metal resources of this binding are bound to each stage in one operation per resource type.
+	uint32_t buffCnt = _mtlResourceSlotCounts.bufferIndex;
+	uint32_t texCnt = _mtlResourceSlotCounts.textureIndex;
+	uint32_t samplerCnt = _mtlResourceSlotCounts.samplerIndex;
+	const MVKMTLBufferBinding* pBuffBindings = buffCnt ? &descSet->getMTLBufferBinding(_mtlResourceSlotOffsets.bufferIndex) : nullptr;
+	const MVKMTLTextureBinding* pTexBindings = texCnt ? &descSet->getMTLTextureBinding(_mtlResourceSlotOffsets.textureIndex) : nullptr;
+	const MVKMTLSamplerStateBinding* pSamplerBindings = samplerCnt ? &descSet->getMTLSamplerStateBinding(_mtlResourceSlotOffsets.samplerIndex) : nullptr;
+
+	// Dynamic offsets are applied to a copy of the buffer bindings, which is shared by all stages.
+	MVKVectorInline<MVKMTLBufferBinding, 8> dynBuffBindings;
+	if (hasDynamicOffsets) {
+		dynBuffBindings.reserve(buffCnt);
+		for (uint32_t slotIdx = 0; slotIdx < buffCnt; slotIdx++) {
+			MVKMTLBufferBinding bb = pBuffBindings[slotIdx];
+			if (bb.mtlBuffer) { bb.offset += (*pDynamicOffsets)[dynOffsetStartIdx + slotIdx]; }
+			dynBuffBindings.push_back(bb);
+		}
+		pBuffBindings = dynBuffBindings.data();
+	}
+
+	for (uint32_t i = kMVKShaderStageVertex; i < kMVKShaderStageMax; i++) {
+		if ( !_applyToStage[i] ) { continue; }
+
+		MVKShaderStageResourceBinding& stageIdxs = mtlIdxs.stages[i];
+		if (i == kMVKShaderStageCompute) {
+			cmdEncoder->_computeResourcesState.bindBuffers(pBuffBindings, buffCnt, stageIdxs.bufferIndex);
+			cmdEncoder->_computeResourcesState.bindTextures(pTexBindings, texCnt, stageIdxs.textureIndex);
+			cmdEncoder->_computeResourcesState.bindSamplerStates(pSamplerBindings, samplerCnt, stageIdxs.samplerIndex);
+		} else {
+			MVKShaderStage stage = MVKShaderStage(i);
+			cmdEncoder->_graphicsResourcesState.bindBuffers(stage, pBuffBindings, buffCnt, stageIdxs.bufferIndex);
+			cmdEncoder->_graphicsResourcesState.bindTextures(stage, pTexBindings, texCnt, stageIdxs.textureIndex);
+			cmdEncoder->_graphicsResourcesState.bindSamplerStates(stage, pSamplerBindings, samplerCnt, stageIdxs.samplerIndex);
+		}
+	}
+	return descCnt;
+}
+
+uint32_t MVKDescriptorSetLayoutBinding::useMetalResources(MVKCommandEncoder* cmdEncoder,
+														  MVKDescriptorSet* descSet,
+														  uint32_t descStartIndex) {
+	uint32_t descCnt = _info.descriptorCount;
+	for (uint32_t descIdx = 0; descIdx < descCnt; descIdx++) {
 		MVKDescriptor* mvkDesc = descSet->getDescriptor(descStartIndex + descIdx);
-		mvkDesc->bind(cmdEncoder, _info.descriptorType, descIdx, _applyToStage,
-					  mtlIdxs, pDynamicOffsets, pDynamicOffsetIndex);
-    }
+		mvkDesc->useMetalResources(cmdEncoder, _info.descriptorType, _applyToStage);
+	}
 	return descCnt;
 }
 
@@ -103,6 +167,33 @@ static const T& get(const void* pData, size_t stride, uint32_t index) {
     return *(T*)((const char*)pData + stride * index);
 }
 
+// Returns the packed swizzle to apply to the texture of the image view, for descriptor types that
+// sample the image view. Other descriptor types access the texture without a swizzle.
+static uint32_t getImageViewSwizzle(MVKImageView* imageView, VkDescriptorType descriptorType) {
+	switch (descriptorType) {
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+			return imageView ? imageView->getPackedSwizzle() : 0;
+
+		default:
+			return 0;
+	}
+}
+
+// Populates the buffer binding with the buffer underlying the texture of a storage image or storage
+// texel buffer, which is bound alongside the texture. The binding is empty if there is no texture.
+static void populateStorageTextureBufferBinding(id<MTLTexture> mtlTex, MVKMTLBufferBinding& bb) {
+	bb.mtlBuffer = nil;
+	bb.offset = 0;
+	bb.size = 0;
+	if ( !mtlTex ) { return; }
+
+	if (mtlTex.parentTexture) { mtlTex = mtlTex.parentTexture; }
+	bb.mtlBuffer = mtlTex.buffer;
+	bb.offset = mtlTex.bufferOffset;
+	bb.size = (uint32_t)(mtlTex.height * mtlTex.bufferBytesPerRow);
+}
+
 // A null cmdEncoder can be passed to perform a validation pass
 void MVKDescriptorSetLayoutBinding::push(MVKCommandEncoder* cmdEncoder,
                                          uint32_t& dstArrayElement,
@@ -186,17 +277,9 @@ void MVKDescriptorSetLayoutBinding::push(MVKCommandEncoder* cmdEncoder,
                 const auto& imageInfo = get<VkDescriptorImageInfo>(pData, stride, rezIdx - dstArrayElement);
                 MVKImageView* imageView = (MVKImageView*)imageInfo.imageView;
                 tb.mtlTexture = imageView->getMTLTexture();
-                if (_info.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE) {
-                    tb.swizzle = imageView->getPackedSwizzle();
-                } else {
-                    tb.swizzle = 0;
-                }
+                tb.swizzle = getImageViewSwizzle(imageView, _info.descriptorType);
                 if (_info.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE) {
-                    id<MTLTexture> mtlTex = tb.mtlTexture;
-                    if (mtlTex.parentTexture) { mtlTex = mtlTex.parentTexture; }
-                    bb.mtlBuffer = mtlTex.buffer;
-                    bb.offset = mtlTex.bufferOffset;
-                    bb.size = (uint32_t)(mtlTex.height * mtlTex.bufferBytesPerRow);
+                    populateStorageTextureBufferBinding(tb.mtlTexture, bb);
                 }
                 for (uint32_t i = kMVKShaderStageVertex; i < kMVKShaderStageMax; i++) {
                     if (_applyToStage[i]) {
@@ -225,10 +308,7 @@ void MVKDescriptorSetLayoutBinding::push(MVKCommandEncoder* cmdEncoder,
                 tb.mtlTexture = bufferView->getMTLTexture();
                 tb.swizzle = 0;
                 if (_info.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER) {
-                    id<MTLTexture> mtlTex = tb.mtlTexture;
-                    bb.mtlBuffer = mtlTex.buffer;
-                    bb.offset = mtlTex.bufferOffset;
-                    bb.size = (uint32_t)(mtlTex.height * mtlTex.bufferBytesPerRow);
+                    populateStorageTextureBufferBinding(tb.mtlTexture, bb);
                 }
                 for (uint32_t i = kMVKShaderStageVertex; i < kMVKShaderStageMax; i++) {
                     if (_applyToStage[i]) {
@@ -252,6 +332,7 @@ void MVKDescriptorSetLayoutBinding::push(MVKCommandEncoder* cmdEncoder,
             }
 
             case VK_DESCRIPTOR_TYPE_SAMPLER: {
+				if (_usesConstExprSampler) { break; }	// Hardcoded in the shader
                 MVKSampler* sampler;
 				if (_immutableSamplers.empty()) {
                     sampler = (MVKSampler*)get<VkDescriptorImageInfo>(pData, stride, rezIdx - dstArrayElement).sampler;
@@ -277,11 +358,7 @@ void MVKDescriptorSetLayoutBinding::push(MVKCommandEncoder* cmdEncoder,
                 const auto& imageInfo = get<VkDescriptorImageInfo>(pData, stride, rezIdx - dstArrayElement);
                 MVKImageView* imageView = (MVKImageView*)imageInfo.imageView;
                 tb.mtlTexture = imageView->getMTLTexture();
-                if (imageView) {
-                    tb.swizzle = imageView->getPackedSwizzle();
-                } else {
-                    tb.swizzle = 0;
-                }
+                tb.swizzle = getImageViewSwizzle(imageView, _info.descriptorType);
 				MVKSampler* sampler;
 				if (_immutableSamplers.empty()) {
 					sampler = (MVKSampler*)imageInfo.sampler;
@@ -296,10 +373,10 @@ void MVKDescriptorSetLayoutBinding::push(MVKCommandEncoder* cmdEncoder,
                         sb.index = mtlIdxs.stages[i].samplerIndex + rezIdx;
                         if (i == kMVKShaderStageCompute) {
 							if (cmdEncoder) { cmdEncoder->_computeResourcesState.bindTexture(tb); }
-							if (cmdEncoder) { cmdEncoder->_computeResourcesState.bindSamplerState(sb); }
+							if (cmdEncoder && !_usesConstExprSampler) { cmdEncoder->_computeResourcesState.bindSamplerState(sb); }
                         } else {
 							if (cmdEncoder) { cmdEncoder->_graphicsResourcesState.bindTexture(MVKShaderStage(i), tb); }
-							if (cmdEncoder) { cmdEncoder->_graphicsResourcesState.bindSamplerState(MVKShaderStage(i), sb); }
+							if (cmdEncoder && !_usesConstExprSampler) { cmdEncoder->_graphicsResourcesState.bindSamplerState(MVKShaderStage(i), sb); }
                         }
                     }
                 }
@@ -329,14 +406,86 @@ bool MVKDescriptorSetLayoutBinding::validate(MVKSampler* mvkSampler) {
 	return true;
 }
 
+// Adds a Metal argument descriptor for an array of the specified number of resources to the array.
+static void mvkAddMTLArgumentDescriptor(NSMutableArray<MTLArgumentDescriptor*>* mtlArgDescs,
+										MTLDataType mtlDataType,
+										MTLArgumentAccess mtlAccess,
+										uint32_t argIndex,
+										uint32_t count) {
+	MTLArgumentDescriptor* mtlArgDesc = [MTLArgumentDescriptor new];	// temp retain
+	mtlArgDesc.dataType = mtlDataType;
+	mtlArgDesc.access = mtlAccess;
+	mtlArgDesc.index = argIndex;
+	mtlArgDesc.arrayLength = (count > 1) ? count : 0;
+	[mtlArgDescs addObject: mtlArgDesc];
+	[mtlArgDesc release];												// temp release
+}
+
+// The Metal argument buffer indexes of all resource types share a single index space, in which
+// each binding is assigned one argument index for each descriptor of each resource type it uses.
+uint32_t MVKDescriptorSetLayoutBinding::addMTLArgumentDescriptors(NSMutableArray<MTLArgumentDescriptor*>* mtlArgDescs,
+																  uint32_t argIndex) {
+	uint32_t descCnt = _info.descriptorCount;
+	switch (_info.descriptorType) {
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+			_mtlArgumentBufferIndexes.bufferIndex = argIndex;
+			mvkAddMTLArgumentDescriptor(mtlArgDescs, MTLDataTypePointer, MTLArgumentAccessReadOnly, argIndex, descCnt);
+			argIndex += descCnt;
+			break;
+
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+			_mtlArgumentBufferIndexes.bufferIndex = argIndex;
+			mvkAddMTLArgumentDescriptor(mtlArgDescs, MTLDataTypePointer, MTLArgumentAccessReadWrite, argIndex, descCnt);
+			argIndex += descCnt;
+			break;
+
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+			_mtlArgumentBufferIndexes.textureIndex = argIndex;
+			mvkAddMTLArgumentDescriptor(mtlArgDescs, MTLDataTypeTexture, MTLArgumentAccessReadOnly, argIndex, descCnt);
+			argIndex += descCnt;
+			break;
+
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+			_mtlArgumentBufferIndexes.textureIndex = argIndex;
+			mvkAddMTLArgumentDescriptor(mtlArgDescs, MTLDataTypeTexture, MTLArgumentAccessReadWrite, argIndex, descCnt);
+			argIndex += descCnt;
+			break;
+
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+			_mtlArgumentBufferIndexes.textureIndex = argIndex;
+			mvkAddMTLArgumentDescriptor(mtlArgDescs, MTLDataTypeTexture, MTLArgumentAccessReadOnly, argIndex, descCnt);
+			argIndex += descCnt;
+			// fallthrough
+		case VK_DESCRIPTOR_TYPE_SAMPLER:
+			_mtlArgumentBufferIndexes.samplerIndex = argIndex;
+			mvkAddMTLArgumentDescriptor(mtlArgDescs, MTLDataTypeSampler, MTLArgumentAccessReadOnly, argIndex, descCnt);
+			argIndex += descCnt;
+			break;
+
+		default:
+			break;
+	}
+	return argIndex;
+}
+
 void MVKDescriptorSetLayoutBinding::populateShaderConverterContext(mvk::SPIRVToMSLConversionConfiguration& context,
                                                                    MVKShaderResourceBinding& dslMTLRezIdxOffsets,
-                                                                   uint32_t dslIndex) {
+                                                                   uint32_t dslIndex,
+                                                                   bool useMetalArgumentBuffer) {
 
-	MVKSampler* mvkSamp = !_immutableSamplers.empty() ? _immutableSamplers.front() : nullptr;
+	MVKSampler* mvkSamp = _usesConstExprSampler ? _immutableSamplers.front() : nullptr;
 
     // Establish the resource indices to use, by combining the offsets of the DSL and this DSL binding.
+    // Resources in a Metal argument buffer use the same argument indexes in all shader stages.
     MVKShaderResourceBinding mtlIdxs = _mtlResourceIndexOffsets + dslMTLRezIdxOffsets;
+    if (useMetalArgumentBuffer) {
+        for (uint32_t i = kMVKShaderStageVertex; i < kMVKShaderStageMax; i++) {
+            mtlIdxs.stages[i] = _mtlArgumentBufferIndexes;
+        }
+    }
 
     static const spv::ExecutionModel models[] = {
         spv::ExecutionModelVertex,
@@ -361,16 +510,6 @@ MVKDescriptorSetLayoutBinding::MVKDescriptorSetLayoutBinding(MVKDevice* device,
 															 MVKDescriptorSetLayout* layout,
                                                              const VkDescriptorSetLayoutBinding* pBinding) : MVKBaseDeviceObject(device), _layout(layout) {
 
-	for (uint32_t i = kMVKShaderStageVertex; i < kMVKShaderStageMax; i++) {
-        // Determine if this binding is used by this shader stage
-        _applyToStage[i] = mvkAreAllFlagsEnabled(pBinding->stageFlags, mvkVkShaderStageFlagBitsFromMVKShaderStage(MVKShaderStage(i)));
-	    // If this binding is used by the shader, set the Metal resource index
-        if (_applyToStage[i]) {
-            initMetalResourceIndexOffsets(&_mtlResourceIndexOffsets.stages[i],
-                                          &layout->_mtlResourceCounts.stages[i], pBinding);
-        }
-    }
-
     // If immutable samplers are defined, copy them in
     if ( pBinding->pImmutableSamplers &&
         (pBinding->descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER ||
@@ -382,14 +521,40 @@ MVKDescriptorSetLayoutBinding::MVKDescriptorSetLayoutBinding(MVKDevice* device,
             }
         }
 
+	// A single immutable sampler is hardcoded into the shader MSL if its state can be expressed there.
+	// An MSL constexpr sampler applies to the whole binding, so an array of immutable samplers is only
+	// hardcoded if it must be, in which case the first sampler stands in for all of them.
+	_usesConstExprSampler = false;
+	if ( !_immutableSamplers.empty() ) {
+		MVKSampler* mvkSamp = _immutableSamplers.front();
+		_usesConstExprSampler = (mvkSamp->getRequiresConstExprSampler() ||
+								 (pBinding->descriptorCount == 1 && mvkSamp->getCanUseConstExprSampler()));
+	}
+
+	for (uint32_t i = kMVKShaderStageVertex; i < kMVKShaderStageMax; i++) {
+        // Determine if this binding is used by this shader stage
+        _applyToStage[i] = mvkAreAllFlagsEnabled(pBinding->stageFlags, mvkVkShaderStageFlagBitsFromMVKShaderStage(MVKShaderStage(i)));
+	    // If this binding is used by the shader, set the Metal resource index
+        if (_applyToStage[i]) {
+            initMetalResourceIndexOffsets(&_mtlResourceIndexOffsets.stages[i],
+                                          &layout->_mtlResourceCounts.stages[i], pBinding);
+        }
+    }
+
     _info = *pBinding;
     _info.pImmutableSamplers = nullptr;     // Remove dangling pointer
+
+	initMetalResourceSlots(&layout->_mtlResourceSlotCounts);
 }
 
 MVKDescriptorSetLayoutBinding::MVKDescriptorSetLayoutBinding(const MVKDescriptorSetLayoutBinding& binding) :
 	MVKBaseDeviceObject(binding._device), _layout(binding._layout),
 	_info(binding._info), _immutableSamplers(binding._immutableSamplers),
-	_mtlResourceIndexOffsets(binding._mtlResourceIndexOffsets) {
+	_mtlResourceIndexOffsets(binding._mtlResourceIndexOffsets),
+	_mtlResourceSlotOffsets(binding._mtlResourceSlotOffsets),
+	_mtlResourceSlotCounts(binding._mtlResourceSlotCounts),
+	_mtlArgumentBufferIndexes(binding._mtlArgumentBufferIndexes),
+	_usesConstExprSampler(binding._usesConstExprSampler) {
 
 	for (uint32_t i = kMVKShaderStageVertex; i < kMVKShaderStageMax; i++) {
         _applyToStage[i] = binding._applyToStage[i];
@@ -413,7 +578,7 @@ void MVKDescriptorSetLayoutBinding::initMetalResourceIndexOffsets(MVKShaderStage
     switch (pBinding->descriptorType) {
         case VK_DESCRIPTOR_TYPE_SAMPLER:
             pBindingIndexes->samplerIndex = pDescSetCounts->samplerIndex;
-            pDescSetCounts->samplerIndex += pBinding->descriptorCount;
+            if ( !_usesConstExprSampler ) { pDescSetCounts->samplerIndex += pBinding->descriptorCount; }
 
 			if (pBinding->descriptorCount > 1 && !_device->_pMetalFeatures->arrayOfSamplers) {
 				_layout->setConfigurationResult(reportError(VK_ERROR_FEATURE_NOT_PRESENT, "Device %s does not support arrays of samplers.", _device->getName()));
@@ -424,7 +589,7 @@ void MVKDescriptorSetLayoutBinding::initMetalResourceIndexOffsets(MVKShaderStage
             pBindingIndexes->textureIndex = pDescSetCounts->textureIndex;
             pDescSetCounts->textureIndex += pBinding->descriptorCount;
             pBindingIndexes->samplerIndex = pDescSetCounts->samplerIndex;
-            pDescSetCounts->samplerIndex += pBinding->descriptorCount;
+            if ( !_usesConstExprSampler ) { pDescSetCounts->samplerIndex += pBinding->descriptorCount; }
 
 			if (pBinding->descriptorCount > 1) {
 				if ( !_device->_pMetalFeatures->arrayOfTextures ) {
@@ -466,6 +631,66 @@ void MVKDescriptorSetLayoutBinding::initMetalResourceIndexOffsets(MVKShaderStage
     }
 }
 
+// Assigns the slots of each Metal resource type used by this binding, within the flat Metal resource
+// arrays of the descriptor sets. Slots are assigned in the same order as the Metal resource indexes
+// of a shader stage, but across all bindings, so each binding occupies a stage-independent range.
+void MVKDescriptorSetLayoutBinding::initMetalResourceSlots(MVKShaderStageResourceBinding* pDescSetSlotCounts) {
+	uint16_t descCnt = _info.descriptorCount;
+	switch (_info.descriptorType) {
+		case VK_DESCRIPTOR_TYPE_SAMPLER:
+			_mtlResourceSlotCounts.samplerIndex = _usesConstExprSampler ? 0 : descCnt;
+			break;
+
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+			_mtlResourceSlotCounts.textureIndex = descCnt;
+			_mtlResourceSlotCounts.samplerIndex = _usesConstExprSampler ? 0 : descCnt;
+			break;
+
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+			_mtlResourceSlotCounts.bufferIndex = descCnt;
+			// fallthrough
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+			_mtlResourceSlotCounts.textureIndex = descCnt;
+			break;
+
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+		case VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT:
+			_mtlResourceSlotCounts.bufferIndex = descCnt;
+			break;
+
+		default:
+			break;
+	}
+	_mtlResourceSlotOffsets = *pDescSetSlotCounts;
+	*pDescSetSlotCounts += _mtlResourceSlotCounts;
+}
+
+
+#pragma mark -
+#pragma mark MVKDescriptor
+
+void MVKDescriptor::useMetalResource(MVKCommandEncoder* cmdEncoder, bool stages[],
+									 id<MTLResource> mtlResource, MTLResourceUsage mtlUsage) {
+	MVKMTLResourceUsage ru;
+	ru.mtlResource = mtlResource;
+	ru.mtlUsage = mtlUsage;
+	for (uint32_t i = kMVKShaderStageVertex; i < kMVKShaderStageMax; i++) {
+		if (stages[i]) {
+			if (i == kMVKShaderStageCompute) {
+				if (cmdEncoder) { cmdEncoder->_computeResourcesState.useResource(ru); }
+			} else {
+				if (cmdEncoder) { cmdEncoder->_graphicsResourcesState.useResource(MVKShaderStage(i), ru); }
+			}
+		}
+	}
+}
+
 
 #pragma mark -
 #pragma mark MVKBufferDescriptor
@@ -514,6 +739,30 @@ void MVKBufferDescriptor::bind(MVKCommandEncoder* cmdEncoder,
 	}
 }
 
+void MVKBufferDescriptor::populateMetalResourceBindings(MVKDescriptorSet* descSet,
+														VkDescriptorType descriptorType,
+														uint32_t descriptorIndex,
+														MVKShaderStageResourceBinding& slots) {
+	switch (descriptorType) {
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER: {
+			MVKMTLBufferBinding& bb = descSet->getMTLBufferBinding(slots.bufferIndex + descriptorIndex);
+			bb = MVKMTLBufferBinding();
+			if (_mvkBuffer) {
+				bb.mtlBuffer = _mvkBuffer->getMTLBuffer();
+				bb.offset = _mvkBuffer->getMTLBufferOffset() + _buffOffset;
+				bb.size = (uint32_t)_mvkBuffer->getByteCount();
+			}
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
 void MVKBufferDescriptor::write(MVKDescriptorSet* mvkDescSet,
 								VkDescriptorType descriptorType,
 								uint32_t srcIndex,
@@ -531,8 +780,11 @@ void MVKBufferDescriptor::write(MVKDescriptorSet* mvkDescSet,
 			_buffOffset = pBuffInfo->offset;
 			_buffRange = pBuffInfo->range;
 
-			if (_mvkBuffer) { _mvkBuffer->retain(); }
-			if (oldBuff) { oldBuff->release(); }
+			_retainsResources = mvkDescSet->getDevice()->shouldRetainDescriptorResources();
+			if (_retainsResources) {
+				if (_mvkBuffer) { _mvkBuffer->retain(); }
+				if (oldBuff) { oldBuff->release(); }
+			}
 			break;
 		}
 
@@ -565,8 +817,52 @@ void MVKBufferDescriptor::read(MVKDescriptorSet* mvkDescSet,
 	}
 }
 
+void MVKBufferDescriptor::encodeToMetalArgumentBuffer(id<MTLArgumentEncoder> mtlArgEncoder,
+													   VkDescriptorType descriptorType,
+													   uint32_t descriptorIndex,
+													   MVKShaderStageResourceBinding& argIndexes) {
+	switch (descriptorType) {
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER: {
+			id<MTLBuffer> mtlBuff = nil;
+			NSUInteger mtlBuffOffset = 0;
+			if (_mvkBuffer) {
+				mtlBuff = _mvkBuffer->getMTLBuffer();
+				mtlBuffOffset = _mvkBuffer->getMTLBufferOffset() + _buffOffset;
+			}
+			[mtlArgEncoder setBuffer: mtlBuff
+							  offset: mtlBuffOffset
+							 atIndex: argIndexes.bufferIndex + descriptorIndex];
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
+void MVKBufferDescriptor::useMetalResources(MVKCommandEncoder* cmdEncoder,
+											VkDescriptorType descriptorType,
+											bool stages[]) {
+	if ( !_mvkBuffer ) { return; }
+
+	switch (descriptorType) {
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+			useMetalResource(cmdEncoder, stages, _mvkBuffer->getMTLBuffer(), MTLResourceUsageRead);
+			break;
+
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+			useMetalResource(cmdEncoder, stages, _mvkBuffer->getMTLBuffer(),
+							 MTLResourceUsage(MTLResourceUsageRead | MTLResourceUsageWrite));
+			break;
+
+		default:
+			break;
+	}
+}
+
 void MVKBufferDescriptor::reset() {
-	if (_mvkBuffer) { _mvkBuffer->release(); }
+	if (_mvkBuffer && _retainsResources) { _mvkBuffer->release(); }
 	_mvkBuffer = nullptr;
 	_buffOffset = 0;
 	_buffRange = 0;
@@ -609,6 +905,24 @@ void MVKInlineUniformBlockDescriptor::bind(MVKCommandEncoder* cmdEncoder,
 	}
 }
 
+void MVKInlineUniformBlockDescriptor::populateMetalResourceBindings(MVKDescriptorSet* descSet,
+																	VkDescriptorType descriptorType,
+																	uint32_t descriptorIndex,
+																	MVKShaderStageResourceBinding& slots) {
+	switch (descriptorType) {
+		case VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT: {
+			MVKMTLBufferBinding& bb = descSet->getMTLBufferBinding(slots.bufferIndex + descriptorIndex);
+			bb = MVKMTLBufferBinding();
+			bb.mtlBuffer = _mtlBuffer;
+			bb.size = _dataSize;
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
 void MVKInlineUniformBlockDescriptor::write(MVKDescriptorSet* mvkDescSet,
 									   VkDescriptorType descriptorType,
 									   uint32_t srcIndex,
@@ -674,6 +988,18 @@ void MVKInlineUniformBlockDescriptor::reset() {
 #pragma mark -
 #pragma mark MVKImageDescriptor
 
+// Populates the texture binding, and for storage images, the buffer binding, with the Metal resources
+// of this descriptor. Used both to bind this descriptor, and to populate the descriptor set from it.
+void MVKImageDescriptor::getMTLResourceBindings(VkDescriptorType descriptorType,
+												MVKMTLTextureBinding& tb,
+												MVKMTLBufferBinding& bb) {
+	tb.mtlTexture = _mvkImageView ? _mvkImageView->getMTLTexture() : nil;
+	tb.swizzle = tb.mtlTexture ? getImageViewSwizzle(_mvkImageView, descriptorType) : 0;
+	if (descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE) {
+		populateStorageTextureBufferBinding(tb.mtlTexture, bb);
+	}
+}
+
 // A null cmdEncoder can be passed to perform a validation pass
 void MVKImageDescriptor::bind(MVKCommandEncoder* cmdEncoder,
 							  VkDescriptorType descriptorType,
@@ -689,22 +1015,7 @@ void MVKImageDescriptor::bind(MVKCommandEncoder* cmdEncoder,
 		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
 		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
 		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: {
-			if (_mvkImageView) {
-				tb.mtlTexture = _mvkImageView->getMTLTexture();
-			}
-			if ((descriptorType == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE || descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) &&
-				tb.mtlTexture) {
-				tb.swizzle = _mvkImageView->getPackedSwizzle();
-			} else {
-				tb.swizzle = 0;
-			}
-			if (descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE && tb.mtlTexture) {
-				id<MTLTexture> mtlTex = tb.mtlTexture;
-				if (mtlTex.parentTexture) { mtlTex = mtlTex.parentTexture; }
-				bb.mtlBuffer = mtlTex.buffer;
-				bb.offset = mtlTex.bufferOffset;
-				bb.size = (uint32_t)(mtlTex.height * mtlTex.bufferBytesPerRow);
-			}
+			getMTLResourceBindings(descriptorType, tb, bb);
 			for (uint32_t i = kMVKShaderStageVertex; i < kMVKShaderStageMax; i++) {
 				if (stages[i]) {
 					tb.index = mtlIndexes.stages[i].textureIndex + descriptorIndex;
@@ -731,6 +1042,32 @@ void MVKImageDescriptor::bind(MVKCommandEncoder* cmdEncoder,
 	}
 }
 
+void MVKImageDescriptor::populateMetalResourceBindings(MVKDescriptorSet* descSet,
+													   VkDescriptorType descriptorType,
+													   uint32_t descriptorIndex,
+													   MVKShaderStageResourceBinding& slots) {
+	switch (descriptorType) {
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: {
+			uint32_t texSlot = slots.textureIndex + descriptorIndex;
+			MVKMTLTextureBinding& tb = descSet->getMTLTextureBinding(texSlot);
+			MVKMTLBufferBinding bb;
+			tb = MVKMTLTextureBinding();
+			getMTLResourceBindings(descriptorType, tb, bb);
+			if (descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE) {
+				descSet->getMTLBufferBinding(slots.bufferIndex + descriptorIndex) = bb;
+			}
+			descSet->setVolatileMTLTexture(texSlot, _mvkImageView && _mvkImageView->hasVolatileMTLTexture());
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
 void MVKImageDescriptor::write(MVKDescriptorSet* mvkDescSet,
 							   VkDescriptorType descriptorType,
 							   uint32_t srcIndex,
@@ -747,8 +1084,11 @@ void MVKImageDescriptor::write(MVKDescriptorSet* mvkDescSet,
 			_mvkImageView = (MVKImageView*)pImgInfo->imageView;
 			_imageLayout = pImgInfo->imageLayout;
 
-			if (_mvkImageView) { _mvkImageView->retain(); }
-			if (oldImgView) { oldImgView->release(); }
+			_retainsResources = mvkDescSet->getDevice()->shouldRetainDescriptorResources();
+			if (_retainsResources) {
+				if (_mvkImageView) { _mvkImageView->retain(); }
+				if (oldImgView) { oldImgView->release(); }
+			}
 
 			break;
 		}
@@ -781,8 +1121,49 @@ void MVKImageDescriptor::read(MVKDescriptorSet* mvkDescSet,
 	}
 }
 
+void MVKImageDescriptor::encodeToMetalArgumentBuffer(id<MTLArgumentEncoder> mtlArgEncoder,
+													  VkDescriptorType descriptorType,
+													  uint32_t descriptorIndex,
+													  MVKShaderStageResourceBinding& argIndexes) {
+	switch (descriptorType) {
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: {
+			[mtlArgEncoder setTexture: _mvkImageView ? _mvkImageView->getMTLTexture() : nil
+							  atIndex: argIndexes.textureIndex + descriptorIndex];
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
+void MVKImageDescriptor::useMetalResources(MVKCommandEncoder* cmdEncoder,
+										   VkDescriptorType descriptorType,
+										   bool stages[]) {
+	if ( !_mvkImageView ) { return; }
+
+	switch (descriptorType) {
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+			useMetalResource(cmdEncoder, stages, _mvkImageView->getMTLTexture(), MTLResourceUsageRead);
+			break;
+
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+			useMetalResource(cmdEncoder, stages, _mvkImageView->getMTLTexture(),
+							 MTLResourceUsage(MTLResourceUsageRead | MTLResourceUsageWrite));
+			break;
+
+		default:
+			break;
+	}
+}
+
 void MVKImageDescriptor::reset() {
-	if (_mvkImageView) { _mvkImageView->release(); }
+	if (_mvkImageView && _retainsResources) { _mvkImageView->release(); }
 	_mvkImageView = nullptr;
 	_imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	MVKDescriptor::reset();
@@ -804,6 +1185,7 @@ void MVKSamplerDescriptorMixin::bind(MVKCommandEncoder* cmdEncoder,
 	switch (descriptorType) {
 		case VK_DESCRIPTOR_TYPE_SAMPLER:
 		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: {
+			if (_usesConstExprSampler) { break; }	// Hardcoded in the shader
 			if (_mvkSampler) {
 				sb.mtlSamplerState = _mvkSampler->getMTLSamplerState();
 			}
@@ -825,6 +1207,27 @@ void MVKSamplerDescriptorMixin::bind(MVKCommandEncoder* cmdEncoder,
 	}
 }
 
+void MVKSamplerDescriptorMixin::populateMetalResourceBindings(MVKDescriptorSet* descSet,
+															   VkDescriptorType descriptorType,
+															   uint32_t descriptorIndex,
+															   MVKShaderStageResourceBinding& slots) {
+	switch (descriptorType) {
+		case VK_DESCRIPTOR_TYPE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: {
+			if (_usesConstExprSampler) { break; }	// Hardcoded in the shader, and has no slot
+			MVKMTLSamplerStateBinding& sb = descSet->getMTLSamplerStateBinding(slots.samplerIndex + descriptorIndex);
+			sb = MVKMTLSamplerStateBinding();
+			if (_mvkSampler) {
+				sb.mtlSamplerState = _mvkSampler->getMTLSamplerState();
+			}
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
 void MVKSamplerDescriptorMixin::write(MVKDescriptorSet* mvkDescSet,
 									  VkDescriptorType descriptorType,
 									  uint32_t srcIndex,
@@ -842,8 +1245,11 @@ void MVKSamplerDescriptorMixin::write(MVKDescriptorSet* mvkDescSet,
 					_mvkSampler->reportError(VK_ERROR_FEATURE_NOT_PRESENT, "vkUpdateDescriptorSets(): Depth texture samplers using a compare operation can only be used as immutable samplers on this device.");
 				}
 
-				if (_mvkSampler) { _mvkSampler->retain(); }
-				if (oldSamp) { oldSamp->release(); }
+				_retainsDynamicSampler = mvkDescSet->getDevice()->shouldRetainDescriptorResources();
+				if (_retainsDynamicSampler) {
+					if (_mvkSampler) { _mvkSampler->retain(); }
+					if (oldSamp) { oldSamp->release(); }
+				}
 			}
 			break;
 		}
@@ -873,11 +1279,34 @@ void MVKSamplerDescriptorMixin::read(MVKDescriptorSet* mvkDescSet,
 	}
 }
 
+void MVKSamplerDescriptorMixin::encodeToMetalArgumentBuffer(id<MTLArgumentEncoder> mtlArgEncoder,
+															 VkDescriptorType descriptorType,
+															 uint32_t descriptorIndex,
+															 MVKShaderStageResourceBinding& argIndexes) {
+	switch (descriptorType) {
+		case VK_DESCRIPTOR_TYPE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: {
+			// A sampler that is hardcoded into the shader is not part of the argument buffer.
+			if (_usesConstExprSampler || (_mvkSampler && _mvkSampler->getRequiresConstExprSampler())) { break; }
+
+			[mtlArgEncoder setSamplerState: _mvkSampler ? _mvkSampler->getMTLSamplerState() : nil
+								   atIndex: argIndexes.samplerIndex + descriptorIndex];
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
+// Immutable samplers are always retained, because the app may destroy the
+// descriptor set layout, which also retains them, while the descriptor is in use.
 void MVKSamplerDescriptorMixin::setLayout(MVKDescriptorSetLayoutBinding* dslBinding, uint32_t index) {
-	auto* oldSamp = _mvkSampler;
+	auto* oldSamp = (_hasDynamicSampler && !_retainsDynamicSampler) ? nullptr : _mvkSampler;
 
 	_mvkSampler = nullptr;
 	_hasDynamicSampler = true;
+	_usesConstExprSampler = dslBinding->usesConstExprSampler();
 
 	switch (dslBinding->getDescriptorType()) {
 		case VK_DESCRIPTOR_TYPE_SAMPLER:
@@ -901,9 +1330,10 @@ void MVKSamplerDescriptorMixin::setLayout(MVKDescriptorSetLayoutBinding* dslBind
 }
 
 void MVKSamplerDescriptorMixin::reset() {
-	if (_mvkSampler) { _mvkSampler->release(); }
+	if (_mvkSampler && ( !_hasDynamicSampler || _retainsDynamicSampler)) { _mvkSampler->release(); }
 	_mvkSampler = nullptr;
 	_hasDynamicSampler = true;
+	_usesConstExprSampler = false;
 }
 
 
@@ -965,6 +1395,36 @@ void MVKSamplerDescriptor::read(MVKDescriptorSet* mvkDescSet,
 	}
 }
 
+void MVKSamplerDescriptor::populateMetalResourceBindings(MVKDescriptorSet* descSet,
+														  VkDescriptorType descriptorType,
+														  uint32_t descriptorIndex,
+														  MVKShaderStageResourceBinding& slots) {
+	switch (descriptorType) {
+		case VK_DESCRIPTOR_TYPE_SAMPLER: {
+			MVKSamplerDescriptorMixin::populateMetalResourceBindings(descSet, descriptorType, descriptorIndex, slots);
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
+void MVKSamplerDescriptor::encodeToMetalArgumentBuffer(id<MTLArgumentEncoder> mtlArgEncoder,
+														VkDescriptorType descriptorType,
+														uint32_t descriptorIndex,
+														MVKShaderStageResourceBinding& argIndexes) {
+	switch (descriptorType) {
+		case VK_DESCRIPTOR_TYPE_SAMPLER: {
+			MVKSamplerDescriptorMixin::encodeToMetalArgumentBuffer(mtlArgEncoder, descriptorType, descriptorIndex, argIndexes);
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
 void MVKSamplerDescriptor::setLayout(MVKDescriptorSetLayoutBinding* dslBinding, uint32_t index) {
 	MVKDescriptor::setLayout(dslBinding, index);
 	MVKSamplerDescriptorMixin::setLayout(dslBinding, index);
@@ -1039,6 +1499,52 @@ void MVKCombinedImageSamplerDescriptor::read(MVKDescriptorSet* mvkDescSet,
 	}
 }
 
+void MVKCombinedImageSamplerDescriptor::populateMetalResourceBindings(MVKDescriptorSet* descSet,
+																	   VkDescriptorType descriptorType,
+																	   uint32_t descriptorIndex,
+																	   MVKShaderStageResourceBinding& slots) {
+	switch (descriptorType) {
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: {
+			MVKImageDescriptor::populateMetalResourceBindings(descSet, descriptorType, descriptorIndex, slots);
+			MVKSamplerDescriptorMixin::populateMetalResourceBindings(descSet, descriptorType, descriptorIndex, slots);
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
+void MVKCombinedImageSamplerDescriptor::encodeToMetalArgumentBuffer(id<MTLArgumentEncoder> mtlArgEncoder,
+																	 VkDescriptorType descriptorType,
+																	 uint32_t descriptorIndex,
+																	 MVKShaderStageResourceBinding& argIndexes) {
+	switch (descriptorType) {
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: {
+			MVKImageDescriptor::encodeToMetalArgumentBuffer(mtlArgEncoder, descriptorType, descriptorIndex, argIndexes);
+			MVKSamplerDescriptorMixin::encodeToMetalArgumentBuffer(mtlArgEncoder, descriptorType, descriptorIndex, argIndexes);
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
+void MVKCombinedImageSamplerDescriptor::useMetalResources(MVKCommandEncoder* cmdEncoder,
+														  VkDescriptorType descriptorType,
+														  bool stages[]) {
+	switch (descriptorType) {
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: {
+			MVKImageDescriptor::useMetalResources(cmdEncoder, descriptorType, stages);
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
 void MVKCombinedImageSamplerDescriptor::setLayout(MVKDescriptorSetLayoutBinding* dslBinding, uint32_t index) {
 	MVKImageDescriptor::setLayout(dslBinding, index);
 	MVKSamplerDescriptorMixin::setLayout(dslBinding, index);
@@ -1053,6 +1559,18 @@ void MVKCombinedImageSamplerDescriptor::reset() {
 #pragma mark -
 #pragma mark MVKTexelBufferDescriptor
 
+// Populates the texture binding, and for storage texel buffers, the buffer binding, with the Metal resources
+// of this descriptor. Used both to bind this descriptor, and to populate the descriptor set from it.
+void MVKTexelBufferDescriptor::getMTLResourceBindings(VkDescriptorType descriptorType,
+													  MVKMTLTextureBinding& tb,
+													  MVKMTLBufferBinding& bb) {
+	tb.mtlTexture = _mvkBufferView ? _mvkBufferView->getMTLTexture() : nil;
+	tb.swizzle = 0;
+	if (descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER) {
+		populateStorageTextureBufferBinding(tb.mtlTexture, bb);
+	}
+}
+
 // A null cmdEncoder can be passed to perform a validation pass
 void MVKTexelBufferDescriptor::bind(MVKCommandEncoder* cmdEncoder,
 									VkDescriptorType descriptorType,
@@ -1066,15 +1584,7 @@ void MVKTexelBufferDescriptor::bind(MVKCommandEncoder* cmdEncoder,
 	switch (descriptorType) {
 		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
 		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER: {
-			if (_mvkBufferView) {
-				tb.mtlTexture = _mvkBufferView->getMTLTexture();
-				if (descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER) {
-					id<MTLTexture> mtlTex = tb.mtlTexture;
-					bb.mtlBuffer = mtlTex.buffer;
-					bb.offset = mtlTex.bufferOffset;
-					bb.size = (uint32_t)(mtlTex.height * mtlTex.bufferBytesPerRow);
-				}
-			}
+			getMTLResourceBindings(descriptorType, tb, bb);
 			for (uint32_t i = kMVKShaderStageVertex; i < kMVKShaderStageMax; i++) {
 				if (stages[i]) {
 					tb.index = mtlIndexes.stages[i].textureIndex + descriptorIndex;
@@ -1101,6 +1611,28 @@ void MVKTexelBufferDescriptor::bind(MVKCommandEncoder* cmdEncoder,
 	}
 }
 
+void MVKTexelBufferDescriptor::populateMetalResourceBindings(MVKDescriptorSet* descSet,
+															 VkDescriptorType descriptorType,
+															 uint32_t descriptorIndex,
+															 MVKShaderStageResourceBinding& slots) {
+	switch (descriptorType) {
+		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER: {
+			MVKMTLTextureBinding& tb = descSet->getMTLTextureBinding(slots.textureIndex + descriptorIndex);
+			MVKMTLBufferBinding bb;
+			tb = MVKMTLTextureBinding();
+			getMTLResourceBindings(descriptorType, tb, bb);
+			if (descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER) {
+				descSet->getMTLBufferBinding(slots.bufferIndex + descriptorIndex) = bb;
+			}
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
 void MVKTexelBufferDescriptor::write(MVKDescriptorSet* mvkDescSet,
 									 VkDescriptorType descriptorType,
 									 uint32_t srcIndex,
@@ -1114,8 +1646,11 @@ void MVKTexelBufferDescriptor::write(MVKDescriptorSet* mvkDescSet,
 			const auto* pBuffView = &get<VkBufferView>(pData, stride, srcIndex);
 			_mvkBufferView = (MVKBufferView*)*pBuffView;
 
-			if (_mvkBufferView) { _mvkBufferView->retain(); }
-			if (oldBuffView) { oldBuffView->release(); }
+			_retainsResources = mvkDescSet->getDevice()->shouldRetainDescriptorResources();
+			if (_retainsResources) {
+				if (_mvkBufferView) { _mvkBufferView->retain(); }
+				if (oldBuffView) { oldBuffView->release(); }
+			}
 
 			break;
 		}
@@ -1144,8 +1679,45 @@ void MVKTexelBufferDescriptor::read(MVKDescriptorSet* mvkDescSet,
 	}
 }
 
+void MVKTexelBufferDescriptor::encodeToMetalArgumentBuffer(id<MTLArgumentEncoder> mtlArgEncoder,
+															VkDescriptorType descriptorType,
+															uint32_t descriptorIndex,
+															MVKShaderStageResourceBinding& argIndexes) {
+	switch (descriptorType) {
+		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER: {
+			[mtlArgEncoder setTexture: _mvkBufferView ? _mvkBufferView->getMTLTexture() : nil
+							  atIndex: argIndexes.textureIndex + descriptorIndex];
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
+void MVKTexelBufferDescriptor::useMetalResources(MVKCommandEncoder* cmdEncoder,
+												 VkDescriptorType descriptorType,
+												 bool stages[]) {
+	if ( !_mvkBufferView ) { return; }
+
+	switch (descriptorType) {
+		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+			useMetalResource(cmdEncoder, stages, _mvkBufferView->getMTLTexture(), MTLResourceUsageRead);
+			break;
+
+		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+			useMetalResource(cmdEncoder, stages, _mvkBufferView->getMTLTexture(),
+							 MTLResourceUsage(MTLResourceUsageRead | MTLResourceUsageWrite));
+			break;
+
+		default:
+			break;
+	}
+}
+
 void MVKTexelBufferDescriptor::reset() {
-	if (_mvkBufferView) { _mvkBufferView->release(); }
+	if (_mvkBufferView && _retainsResources) { _mvkBufferView->release(); }
 	_mvkBufferView = nullptr;
 	MVKDescriptor::reset();
 }
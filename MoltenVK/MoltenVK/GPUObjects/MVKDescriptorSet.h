@@ -19,9 +19,11 @@
 #pragma once
 
 #include "MVKDescriptor.h"
+#include "MVKFlatHashMap.h"
+#include "MVKArena.h"
 #include <unordered_set>
-#include <unordered_map>
 #include <vector>
+#include <mutex>
 
 class MVKDescriptorPool;
 class MVKPipelineLayout;
@@ -50,6 +52,28 @@ public:
                            uint32_t* pDynamicOffsetIndex);
 
 
+	/**
+	 * Rebinds only the dynamic buffer descriptors of a descriptor set that is already bound
+	 * on the specified command encoder, applying the specified dynamic offsets.
+	 */
+	void bindDynamicOffsets(MVKCommandEncoder* cmdEncoder,
+							MVKDescriptorSet* descSet,
+							MVKShaderResourceBinding& dslMTLRezIdxOffsets,
+							MVKVector<uint32_t>* pDynamicOffsets,
+							uint32_t* pDynamicOffsetIndex);
+
+	/** Returns whether this layout contains dynamic uniform or storage buffer descriptors. */
+	bool hasDynamicOffsets() const { return !_dynamicBindingIndexes.empty(); }
+
+	/**
+	 * Binds the Metal argument buffer of the specified descriptor set on the specified command encoder,
+	 * and declares the Metal resources that are accessed through it. The Metal argument buffer is bound
+	 * to each shader stage at the Metal buffer index identified by dslMTLRezIdxOffsets.
+	 */
+	void bindMetalArgumentBuffer(MVKCommandEncoder* cmdEncoder,
+								 MVKDescriptorSet* descSet,
+								 MVKShaderResourceBinding& dslMTLRezIdxOffsets);
+
 	/** Encodes this descriptor set layout and the specified descriptor updates on the specified command encoder immediately. */
 	void pushDescriptorSet(MVKCommandEncoder* cmdEncoder,
 						   MVKVector<VkWriteDescriptorSet>& descriptorWrites,
@@ -63,33 +87,56 @@ public:
 						   MVKShaderResourceBinding& dslMTLRezIdxOffsets);
 
 
-	/** Populates the specified shader converter context, at the specified DSL index. */
+	/**
+	 * Populates the specified shader converter context, at the specified DSL index.
+	 * If useMetalArgumentBuffer is true, the resources are placed in the Metal argument buffer
+	 * of the descriptor set, instead of at the Metal resource indexes of dslMTLRezIdxOffsets.
+	 */
 	void populateShaderConverterContext(mvk::SPIRVToMSLConversionConfiguration& context,
                                         MVKShaderResourceBinding& dslMTLRezIdxOffsets,
-                                        uint32_t dslIndex);
+                                        uint32_t dslIndex,
+                                        bool useMetalArgumentBuffer);
 
 	/** Returns true if this layout is for push descriptors only. */
 	bool isPushDescriptorLayout() const { return _isPushDescriptorLayout; }
 
+	/** Returns true if the descriptor sets of this layout hold their content in a Metal argument buffer. */
+	bool isUsingMetalArgumentBuffer() const { return _isUsingMetalArgumentBuffer; }
+
 	MVKDescriptorSetLayout(MVKDevice* device, const VkDescriptorSetLayoutCreateInfo* pCreateInfo);
 
+	~MVKDescriptorSetLayout() override;
+
 protected:
 
 	friend class MVKDescriptorSetLayoutBinding;
 	friend class MVKPipelineLayout;
 	friend class MVKDescriptorSet;
 	friend class MVKDescriptorPool;
+	friend class MVKDescriptorUpdateTemplate;
 
 	void propogateDebugName() override {}
 	inline uint32_t getDescriptorCount() { return _descriptorCount; }
 	uint32_t getDescriptorIndex(uint32_t binding, uint32_t elementIndex);
-	inline MVKDescriptorSetLayoutBinding* getBinding(uint32_t binding) { return &_bindings[_bindingToIndex[binding]]; }
+	inline MVKDescriptorSetLayoutBinding* getBinding(uint32_t binding) { return &_bindings[_bindingToIndex.get(binding)]; }
+	void initMTLArgumentEncoder();
+	void encodeToMetalArgumentBuffer(MVKDescriptorSet* descSet, uint32_t descStartIndex, uint32_t descCount);
+	void populateMetalResourceBindings(MVKDescriptorSet* descSet, uint32_t descStartIndex, uint32_t descCount);
+	template<typename F>
+	void forEachDescriptor(MVKDescriptorSet* descSet, uint32_t descStartIndex, uint32_t descCount, F func);
 
 	std::vector<MVKDescriptorSetLayoutBinding> _bindings;
-	std::unordered_map<uint32_t, uint32_t> _bindingToIndex;
+	MVKFlatHashMap<uint32_t, uint32_t> _bindingToIndex;
+	MVKVectorInline<uint32_t, 4> _dynamicBindingIndexes;
+	MVKVectorInline<uint32_t, 4> _dynamicBindingDescriptorIndexes;
 	MVKShaderResourceBinding _mtlResourceCounts;
+	MVKShaderStageResourceBinding _mtlResourceSlotCounts;
+	id<MTLArgumentEncoder> _mtlArgumentEncoder = nil;
+	std::mutex _mtlArgumentEncodingLock;
 	uint32_t _descriptorCount;
 	bool _isPushDescriptorLayout;
+	bool _isUsingMetalArgumentBuffer;
+	bool _applyToStage[kMVKShaderStageMax];
 };
 
 
@@ -114,6 +161,9 @@ public:
 	template<typename DescriptorAction>
 	void write(const DescriptorAction* pDescriptorAction, size_t stride, const void* pData);
 
+	/** Updates the resource bindings in this instance from the precompiled writes of the descriptor update template. */
+	void write(MVKDescriptorUpdateTemplate* descUpdateTemplate, const void* pData);
+
 	/** 
 	 * Reads the resource bindings defined in the specified content 
 	 * from this instance into the specified collection of bindings.
@@ -124,20 +174,49 @@ public:
 			  VkBufferView* pTexelBufferView,
 			  VkWriteDescriptorSetInlineUniformBlockEXT* pInlineUniformBlock);
 
+	/** Returns the Metal buffer binding at the resource slot of this descriptor set. */
+	inline MVKMTLBufferBinding& getMTLBufferBinding(uint32_t slot) { return _mtlBufferBindings[slot]; }
+
+	/** Returns the Metal texture binding at the resource slot of this descriptor set. */
+	inline MVKMTLTextureBinding& getMTLTextureBinding(uint32_t slot) { return _mtlTextureBindings[slot]; }
+
+	/** Returns the Metal sampler state binding at the resource slot of this descriptor set. */
+	inline MVKMTLSamplerStateBinding& getMTLSamplerStateBinding(uint32_t slot) { return _mtlSamplerStateBindings[slot]; }
+
+	/**
+	 * Sets whether the Metal texture at the resource slot of this descriptor set may change after
+	 * the descriptor is written, such as the texture of a swapchain image. While any slot holds
+	 * such a texture, this descriptor set is encoded from its descriptors each time it is bound.
+	 */
+	void setVolatileMTLTexture(uint32_t slot, bool isVolatile);
+
+	/** Returns whether any Metal resource of this descriptor set may change after its descriptor was written. */
+	inline bool hasVolatileMTLResources() { return _volatileMTLTextureCount > 0; }
+
 	MVKDescriptorSet(MVKDescriptorSetLayout* layout, MVKDescriptorPool* pool);
 
 	~MVKDescriptorSet() override;
 
 protected:
+	friend class MVKDescriptorSetLayout;
 	friend class MVKDescriptorSetLayoutBinding;
 	friend class MVKDescriptorPool;
 
 	void propogateDebugName() override {}
 	inline MVKDescriptor* getDescriptor(uint32_t index) { return _descriptors[index]; }
+	void writeDescriptors(uint32_t descStartIndex, uint32_t descCount, VkDescriptorType descType,
+						  size_t stride, const void* pData);
 
 	MVKDescriptorSetLayout* _layout;
 	MVKDescriptorPool* _pool;
-	std::vector<MVKDescriptor*> _descriptors;
+	MVKDescriptor** _descriptors = nullptr;
+	uint32_t _descriptorCount = 0;
+	std::vector<MVKMTLBufferBinding> _mtlBufferBindings;
+	std::vector<MVKMTLTextureBinding> _mtlTextureBindings;
+	std::vector<MVKMTLSamplerStateBinding> _mtlSamplerStateBindings;
+	std::vector<bool> _volatileMTLTextureSlots;
+	id<MTLBuffer> _mtlArgumentBuffer = nil;
+	uint32_t _volatileMTLTextureCount = 0;
 };
 
 
@@ -160,12 +239,11 @@ protected:
 	friend class MVKPreallocatedDescriptors;
 
 	VkResult allocateDescriptor(MVKDescriptor** pMVKDesc);
-	bool findDescriptor(uint32_t endIndex, MVKDescriptor** pMVKDesc);
 	void freeDescriptor(MVKDescriptor* mvkDesc);
 	void reset();
 
 	std::vector<DescriptorClass> _descriptors;
-	std::vector<bool> _availability;
+	std::vector<uint32_t> _freedIndices;
 	uint32_t _nextAvailableIndex;
 	bool _supportAvailability;
 };
@@ -231,6 +309,9 @@ public:
 	/** Destoys all currently allocated descriptor sets. */
 	VkResult reset(VkDescriptorPoolResetFlags flags);
 
+	/** Returns the maximum number of descriptor sets that can be allocated from this pool. */
+	uint32_t getMaxSets() { return _maxSets; }
+
 	MVKDescriptorPool(MVKDevice* device, const VkDescriptorPoolCreateInfo* pCreateInfo);
 
 	~MVKDescriptorPool() override;
@@ -239,13 +320,18 @@ protected:
 	friend class MVKDescriptorSet;
 
 	void propogateDebugName() override {}
+	size_t getAllocatedSetCount() { return _descriptorSetArena ? _arenaSets.size() : _allocatedSets.size(); }
 	VkResult allocateDescriptorSet(MVKDescriptorSetLayout* mvkDSL, VkDescriptorSet* pVKDS);
 	void freeDescriptorSet(MVKDescriptorSet* mvkDS);
 	VkResult allocateDescriptor(VkDescriptorType descriptorType, MVKDescriptor** pMVKDesc);
 	void freeDescriptor(MVKDescriptor* mvkDesc);
+	MVKDescriptor** allocateDescriptorArray(uint32_t count);
+	void freeDescriptorArray(MVKDescriptor** descriptors);
 
 	uint32_t _maxSets;
 	std::unordered_set<MVKDescriptorSet*> _allocatedSets;
+	std::vector<MVKDescriptorSet*> _arenaSets;
+	MVKArena* _descriptorSetArena;
 	MVKPreallocatedDescriptors* _preallocatedDescriptors;
 };
 
@@ -253,6 +339,32 @@ protected:
 #pragma mark -
 #pragma mark MVKDescriptorUpdateTemplate
 
+/**
+ * A write of a run of descriptors in a descriptor set, resolved from a descriptor update template entry
+ * against the descriptor set layout of the template. The content of the descriptors is found in the
+ * template data at dataOffset, and each subsequent descriptor is found stride bytes after the previous.
+ */
+typedef struct {
+	size_t dataOffset;
+	size_t stride;
+	uint32_t descriptorIndex;
+	uint32_t descriptorCount;
+	VkDescriptorType descriptorType;
+} MVKDescriptorUpdateTemplateWrite;
+
+/**
+ * A push of descriptors to a single binding of a push descriptor set layout, resolved from
+ * a descriptor update template entry against the descriptor set layout of the template.
+ */
+typedef struct {
+	size_t dataOffset;
+	size_t stride;
+	uint32_t bindingIndex;
+	uint32_t dstArrayElement;
+	uint32_t descriptorCount;
+	VkDescriptorType descriptorType;
+} MVKDescriptorUpdateTemplatePush;
+
 /** Represents a Vulkan descriptor update template. */
 class MVKDescriptorUpdateTemplate : public MVKVulkanAPIDeviceObject {
 
@@ -273,6 +385,15 @@ public:
 	/** Get the type of this template. */
 	VkDescriptorUpdateTemplateTypeKHR getType() const;
 
+	/** Returns the descriptor set writes compiled from the entries of this template. */
+	MVKVector<MVKDescriptorUpdateTemplateWrite>& getWrites() { return _writes; }
+
+	/** Returns the descriptor pushes compiled from the entries of this template. */
+	MVKVector<MVKDescriptorUpdateTemplatePush>& getPushes() { return _pushes; }
+
+	/** Returns the size of the data consumed by this template, in bytes. */
+	size_t getDataSize() const { return _dataSize; }
+
 	/** Constructs an instance for the specified device. */
 	MVKDescriptorUpdateTemplate(MVKDevice* device, const VkDescriptorUpdateTemplateCreateInfoKHR* pCreateInfo);
 
@@ -281,9 +402,14 @@ public:
 
 protected:
 	void propogateDebugName() override {}
+	void addWrite(MVKDescriptorSetLayout* dsl, const VkDescriptorUpdateTemplateEntryKHR& entry);
+	void addPushes(MVKDescriptorSetLayout* dsl, const VkDescriptorUpdateTemplateEntryKHR& entry);
 
 	VkDescriptorUpdateTemplateTypeKHR _type;
 	MVKVectorInline<VkDescriptorUpdateTemplateEntryKHR, 1> _entries;
+	MVKVectorInline<MVKDescriptorUpdateTemplateWrite, 1> _writes;
+	MVKVectorInline<MVKDescriptorUpdateTemplatePush, 1> _pushes;
+	size_t _dataSize = 0;
 };
 
 #pragma mark -
@@ -17,6 +17,8 @@
  */
 
 #include "MVKDescriptorSet.h"
+#include "MVKCommandBuffer.h"
+#include "MVKPipeline.h"
 #include "MVKOSExtensions.h"
 
 
@@ -51,6 +53,112 @@ void MVKDescriptorSetLayout::bindDescriptorSet(MVKCommandEncoder* cmdEncoder,
     }
 }
 
+// Dynamic offsets are consumed in binding order, and only dynamic bindings consume them,
+// so the dynamic bindings can be rebound alone, skipping all other bindings.
+void MVKDescriptorSetLayout::bindDynamicOffsets(MVKCommandEncoder* cmdEncoder,
+												MVKDescriptorSet* descSet,
+												MVKShaderResourceBinding& dslMTLRezIdxOffsets,
+												MVKVector<uint32_t>* pDynamicOffsets,
+												uint32_t* pDynamicOffsetIndex) {
+	if (_isPushDescriptorLayout) return;
+
+	clearConfigurationResult();
+	size_t dynBindCnt = _dynamicBindingIndexes.size();
+	for (size_t dynIdx = 0; dynIdx < dynBindCnt; dynIdx++) {
+		_bindings[_dynamicBindingIndexes[dynIdx]].bind(cmdEncoder, descSet, _dynamicBindingDescriptorIndexes[dynIdx],
+													   dslMTLRezIdxOffsets, pDynamicOffsets,
+													   pDynamicOffsetIndex);
+	}
+}
+
+void MVKDescriptorSetLayout::bindMetalArgumentBuffer(MVKCommandEncoder* cmdEncoder,
+													 MVKDescriptorSet* descSet,
+													 MVKShaderResourceBinding& dslMTLRezIdxOffsets) {
+	if (_isPushDescriptorLayout) return;
+
+	clearConfigurationResult();
+
+	MVKMTLBufferBinding bb;
+	bb.mtlBuffer = descSet->_mtlArgumentBuffer;
+	bb.size = (uint32_t)descSet->_mtlArgumentBuffer.length;
+	for (uint32_t i = kMVKShaderStageVertex; i < kMVKShaderStageMax; i++) {
+		if (_applyToStage[i]) {
+			bb.index = dslMTLRezIdxOffsets.stages[i].bufferIndex;
+			if (i == kMVKShaderStageCompute) {
+				if (cmdEncoder) { cmdEncoder->_computeResourcesState.bindBuffer(bb); }
+			} else {
+				if (cmdEncoder) { cmdEncoder->_graphicsResourcesState.bindBuffer(MVKShaderStage(i), bb); }
+			}
+		}
+	}
+
+	// The resources referenced by the argument buffer must be declared to the Metal encoder.
+	uint32_t bindCnt = (uint32_t)_bindings.size();
+	for (uint32_t descIdx = 0, bindIdx = 0; bindIdx < bindCnt; bindIdx++) {
+		descIdx += _bindings[bindIdx].useMetalResources(cmdEncoder, descSet, descIdx);
+	}
+}
+
+// Invokes the function on each descriptor of the descriptor set in the range of descriptor indexes,
+// along with the layout binding holding the descriptor, and the index of the descriptor within that
+// layout binding. The range may span more than one layout binding.
+template<typename F>
+void MVKDescriptorSetLayout::forEachDescriptor(MVKDescriptorSet* descSet,
+											   uint32_t descStartIndex,
+											   uint32_t descCount,
+											   F func) {
+	uint32_t descEndIndex = std::min(descStartIndex + descCount, descSet->_descriptorCount);
+	uint32_t bindStartIdx = 0;
+	for (auto& dslBind : _bindings) {
+		if (bindStartIdx >= descEndIndex) { break; }
+
+		uint32_t bindEndIdx = bindStartIdx + dslBind.getDescriptorCount();
+		uint32_t firstIdx = std::max(descStartIndex, bindStartIdx);
+		uint32_t lastIdx = std::min(descEndIndex, bindEndIdx);
+		for (uint32_t descIdx = firstIdx; descIdx < lastIdx; descIdx++) {
+			func(dslBind, descSet->getDescriptor(descIdx), descIdx - bindStartIdx);
+		}
+		bindStartIdx = bindEndIdx;
+	}
+}
+
+// Encodes the descriptors in the range of descriptor indexes into the Metal argument buffer of the
+// descriptor set. The range may span more than one layout binding, each of which is encoded using
+// its own descriptor type and Metal argument buffer indexes. The Metal argument encoder is shared
+// by all descriptor sets of this layout, and is guarded against updates from multiple threads.
+void MVKDescriptorSetLayout::encodeToMetalArgumentBuffer(MVKDescriptorSet* descSet,
+														 uint32_t descStartIndex,
+														 uint32_t descCount) {
+	if ( !descSet->_mtlArgumentBuffer ) { return; }
+
+	std::lock_guard<std::mutex> lock(_mtlArgumentEncodingLock);
+
+	[_mtlArgumentEncoder setArgumentBuffer: descSet->_mtlArgumentBuffer offset: 0];
+
+	forEachDescriptor(descSet, descStartIndex, descCount, [&](MVKDescriptorSetLayoutBinding& dslBind,
+															  MVKDescriptor* mvkDesc,
+															  uint32_t bindDescIdx) {
+		mvkDesc->encodeToMetalArgumentBuffer(_mtlArgumentEncoder, dslBind.getDescriptorType(),
+											 bindDescIdx, dslBind._mtlArgumentBufferIndexes);
+	});
+}
+
+// Populates the flat Metal resource bindings of the descriptor set from the descriptors in the range
+// of descriptor indexes. Like encoding to a Metal argument buffer, the range may span more than one
+// layout binding, each of which places its Metal resources at its own resource slots.
+void MVKDescriptorSetLayout::populateMetalResourceBindings(MVKDescriptorSet* descSet,
+														   uint32_t descStartIndex,
+														   uint32_t descCount) {
+	if (descSet->_mtlArgumentBuffer) { return; }
+
+	forEachDescriptor(descSet, descStartIndex, descCount, [&](MVKDescriptorSetLayoutBinding& dslBind,
+															  MVKDescriptor* mvkDesc,
+															  uint32_t bindDescIdx) {
+		mvkDesc->populateMetalResourceBindings(descSet, dslBind.getDescriptorType(),
+											   bindDescIdx, dslBind._mtlResourceSlotOffsets);
+	});
+}
+
 static const void* getWriteParameters(VkDescriptorType type, const VkDescriptorImageInfo* pImageInfo,
                                       const VkDescriptorBufferInfo* pBufferInfo, const VkBufferView* pTexelBufferView,
                                       const VkWriteDescriptorSetInlineUniformBlockEXT* pInlineUniformBlock,
@@ -124,12 +232,13 @@ void MVKDescriptorSetLayout::pushDescriptorSet(MVKCommandEncoder* cmdEncoder,
         // Note: This will result in us walking off the end of the array
         // in case there are too many updates... but that's ill-defined anyway.
         for (; descriptorCount; dstBinding++) {
-            if (!_bindingToIndex.count(dstBinding)) continue;
+            auto bindIdxIter = _bindingToIndex.find(dstBinding);
+            if (bindIdxIter == _bindingToIndex.end()) continue;
             size_t stride;
             const void* pData = getWriteParameters(descWrite.descriptorType, pImageInfo,
                                                    pBufferInfo, pTexelBufferView, pInlineUniformBlock, stride);
             uint32_t descriptorsPushed = 0;
-            uint32_t bindIdx = _bindingToIndex[dstBinding];
+            uint32_t bindIdx = bindIdxIter->second;
             _bindings[bindIdx].push(cmdEncoder, dstArrayElement, descriptorCount,
                                     descriptorsPushed, descWrite.descriptorType,
                                     stride, pData, dslMTLRezIdxOffsets);
@@ -151,33 +260,24 @@ void MVKDescriptorSetLayout::pushDescriptorSet(MVKCommandEncoder* cmdEncoder,
         return;
 
 	clearConfigurationResult();
-    for (uint32_t i = 0; i < descUpdateTemplate->getNumberOfEntries(); i++) {
-        const VkDescriptorUpdateTemplateEntryKHR* pEntry = descUpdateTemplate->getEntry(i);
-        uint32_t dstBinding = pEntry->dstBinding;
-        uint32_t dstArrayElement = pEntry->dstArrayElement;
-        uint32_t descriptorCount = pEntry->descriptorCount;
-        const void* pCurData = (const char*)pData + pEntry->offset;
-        if (!_bindingToIndex.count(dstBinding)) continue;
-        // Note: This will result in us walking off the end of the array
-        // in case there are too many updates... but that's ill-defined anyway.
-        for (; descriptorCount; dstBinding++) {
-            if (!_bindingToIndex.count(dstBinding)) continue;
-            uint32_t descriptorsPushed = 0;
-            uint32_t bindIdx = _bindingToIndex[dstBinding];
-            _bindings[bindIdx].push(cmdEncoder, dstArrayElement, descriptorCount,
-                                    descriptorsPushed, pEntry->descriptorType,
-                                    pEntry->stride, pCurData, dslMTLRezIdxOffsets);
-            pCurData = (const char*)pCurData + pEntry->stride * descriptorsPushed;
-        }
-    }
+	// The binding pushes were resolved against the layout when the template was created.
+	for (auto& dutPush : descUpdateTemplate->getPushes()) {
+		uint32_t dstArrayElement = dutPush.dstArrayElement;
+		uint32_t descriptorCount = dutPush.descriptorCount;
+		uint32_t descriptorsPushed = 0;
+		_bindings[dutPush.bindingIndex].push(cmdEncoder, dstArrayElement, descriptorCount,
+											 descriptorsPushed, dutPush.descriptorType, dutPush.stride,
+											 (const char*)pData + dutPush.dataOffset, dslMTLRezIdxOffsets);
+	}
 }
 
 void MVKDescriptorSetLayout::populateShaderConverterContext(mvk::SPIRVToMSLConversionConfiguration& context,
                                                             MVKShaderResourceBinding& dslMTLRezIdxOffsets,
-															uint32_t dslIndex) {
+															uint32_t dslIndex,
+															bool useMetalArgumentBuffer) {
 	uint32_t bindCnt = (uint32_t)_bindings.size();
 	for (uint32_t bindIdx = 0; bindIdx < bindCnt; bindIdx++) {
-		_bindings[bindIdx].populateShaderConverterContext(context, dslMTLRezIdxOffsets, dslIndex);
+		_bindings[bindIdx].populateShaderConverterContext(context, dslMTLRezIdxOffsets, dslIndex, useMetalArgumentBuffer);
 	}
 }
 
@@ -193,6 +293,55 @@ MVKDescriptorSetLayout::MVKDescriptorSetLayout(MVKDevice* device,
 		_descriptorCount += _bindings.back().getDescriptorCount();
         _bindingToIndex[pCreateInfo->pBindings[i].binding] = i;
     }
+
+	// Push descriptors, dynamic buffer offsets, and inline uniform blocks
+	// are bound directly to Metal, and cannot use a Metal argument buffer.
+	_isUsingMetalArgumentBuffer = _device->shouldUseMetalArgumentBuffers() && !_isPushDescriptorLayout;
+	for (uint32_t i = kMVKShaderStageVertex; i < kMVKShaderStageMax; i++) { _applyToStage[i] = false; }
+	uint32_t bindCnt = (uint32_t)_bindings.size();
+	for (uint32_t bindIdx = 0, descIdx = 0; bindIdx < bindCnt; bindIdx++) {
+		auto& dslBind = _bindings[bindIdx];
+		switch (dslBind.getDescriptorType()) {
+			case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+			case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+				_dynamicBindingIndexes.push_back(bindIdx);
+				_dynamicBindingDescriptorIndexes.push_back(descIdx);
+				_isUsingMetalArgumentBuffer = false;
+				break;
+			case VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT:
+				_isUsingMetalArgumentBuffer = false;
+				break;
+			default:
+				break;
+		}
+		descIdx += dslBind.getDescriptorCount();
+		for (uint32_t i = kMVKShaderStageVertex; i < kMVKShaderStageMax; i++) {
+			_applyToStage[i] = _applyToStage[i] || dslBind._applyToStage[i];
+		}
+	}
+	if (_isUsingMetalArgumentBuffer) { initMTLArgumentEncoder(); }
+}
+
+// Assigns the Metal argument buffer indexes of the bindings, and creates a Metal argument
+// encoder from the resulting Metal argument descriptors. A layout without any descriptors
+// uses an empty Metal argument buffer, and a descriptor set of this layout will not need one.
+void MVKDescriptorSetLayout::initMTLArgumentEncoder() {
+	NSMutableArray<MTLArgumentDescriptor*>* mtlArgDescs = [[NSMutableArray alloc] initWithCapacity: _bindings.size()];	// temp retain
+	uint32_t argIdx = 0;
+	for (auto& dslBind : _bindings) {
+		argIdx = dslBind.addMTLArgumentDescriptors(mtlArgDescs, argIdx);
+	}
+	if (mtlArgDescs.count > 0) {
+		_mtlArgumentEncoder = [getMTLDevice() newArgumentEncoderWithArguments: mtlArgDescs];	// retained
+		if ( !_mtlArgumentEncoder ) {
+			setConfigurationResult(reportError(VK_ERROR_INITIALIZATION_FAILED, "vkCreateDescriptorSetLayout(): Could not create a Metal argument encoder for the descriptor set layout."));
+		}
+	}
+	[mtlArgDescs release];																	// temp release
+}
+
+MVKDescriptorSetLayout::~MVKDescriptorSetLayout() {
+	[_mtlArgumentEncoder release];
 }
 
 
@@ -211,10 +360,7 @@ void MVKDescriptorSet::write(const DescriptorAction* pDescriptorAction,
 	VkDescriptorType descType = getDescriptorType(pDescriptorAction->dstBinding);
 	uint32_t dstStartIdx = _layout->getDescriptorIndex(pDescriptorAction->dstBinding,
 													   pDescriptorAction->dstArrayElement);
-	uint32_t descCnt = pDescriptorAction->descriptorCount;
-	for (uint32_t descIdx = 0; descIdx < descCnt; descIdx++) {
-		_descriptors[dstStartIdx + descIdx]->write(this, descType, descIdx, stride, pData);
-	}
+	writeDescriptors(dstStartIdx, pDescriptorAction->descriptorCount, descType, stride, pData);
 }
 
 // Create concrete implementations of the three variations of the write() function.
@@ -225,6 +371,25 @@ template void MVKDescriptorSet::write<VkCopyDescriptorSet>(const VkCopyDescripto
 template void MVKDescriptorSet::write<VkDescriptorUpdateTemplateEntryKHR>(const VkDescriptorUpdateTemplateEntryKHR* pDescriptorAction,
 																		  size_t stride, const void *pData);
 
+void MVKDescriptorSet::write(MVKDescriptorUpdateTemplate* descUpdateTemplate, const void* pData) {
+	for (auto& dutWrite : descUpdateTemplate->getWrites()) {
+		writeDescriptors(dutWrite.descriptorIndex, dutWrite.descriptorCount, dutWrite.descriptorType,
+						 dutWrite.stride, (const char*)pData + dutWrite.dataOffset);
+	}
+}
+
+void MVKDescriptorSet::writeDescriptors(uint32_t descStartIndex,
+										uint32_t descCount,
+										VkDescriptorType descType,
+										size_t stride,
+										const void* pData) {
+	for (uint32_t descIdx = 0; descIdx < descCount; descIdx++) {
+		_descriptors[descStartIndex + descIdx]->write(this, descType, descIdx, stride, pData);
+	}
+	_layout->encodeToMetalArgumentBuffer(this, descStartIndex, descCount);
+	_layout->populateMetalResourceBindings(this, descStartIndex, descCount);
+}
+
 void MVKDescriptorSet::read(const VkCopyDescriptorSet* pDescriptorCopy,
 							VkDescriptorImageInfo* pImageInfo,
 							VkDescriptorBufferInfo* pBufferInfo,
@@ -245,7 +410,7 @@ void MVKDescriptorSet::read(const VkCopyDescriptorSet* pDescriptorCopy,
 MVKDescriptorSet::MVKDescriptorSet(MVKDescriptorSetLayout* layout, MVKDescriptorPool* pool) :
 	MVKVulkanAPIDeviceObject(pool->_device), _layout(layout), _pool(pool) {
 
-	_descriptors.reserve(layout->getDescriptorCount());
+	_descriptors = _pool->allocateDescriptorArray(layout->getDescriptorCount());
 	uint32_t bindCnt = (uint32_t)layout->_bindings.size();
 	for (uint32_t bindIdx = 0; bindIdx < bindCnt; bindIdx++) {
 		MVKDescriptorSetLayoutBinding* mvkDSLBind = &layout->_bindings[bindIdx];
@@ -256,14 +421,45 @@ MVKDescriptorSet::MVKDescriptorSet(MVKDescriptorSetLayout* layout, MVKDescriptor
 			if ( !wasConfigurationSuccessful() ) { break; }
 
 			mvkDesc->setLayout(mvkDSLBind, descIdx);
-			_descriptors.push_back(mvkDesc);
+			_descriptors[_descriptorCount++] = mvkDesc;
 		}
 		if ( !wasConfigurationSuccessful() ) { break; }
 	}
+
+	// New Metal buffers are zero-filled, so unwritten descriptors encode as null resources.
+	// Encode all descriptors once, to capture any immutable samplers set by the layout.
+	if (wasConfigurationSuccessful() && layout->_mtlArgumentEncoder) {
+		_mtlArgumentBuffer = [getMTLDevice() newBufferWithLength: layout->_mtlArgumentEncoder.encodedLength
+														 options: MTLResourceStorageModeShared];	// retained
+		layout->encodeToMetalArgumentBuffer(this, 0, layout->getDescriptorCount());
+	}
+
+	// Otherwise, lay out the Metal resources of the descriptors in flat arrays, one per Metal resource
+	// type, in Metal resource index order, so binding the set copies ranges into the encoder state.
+	if (wasConfigurationSuccessful() && !_mtlArgumentBuffer) {
+		_mtlBufferBindings.resize(layout->_mtlResourceSlotCounts.bufferIndex);
+		_mtlTextureBindings.resize(layout->_mtlResourceSlotCounts.textureIndex);
+		_volatileMTLTextureSlots.resize(layout->_mtlResourceSlotCounts.textureIndex);
+		_mtlSamplerStateBindings.resize(layout->_mtlResourceSlotCounts.samplerIndex);
+		layout->populateMetalResourceBindings(this, 0, layout->getDescriptorCount());
+	}
+}
+
+void MVKDescriptorSet::setVolatileMTLTexture(uint32_t slot, bool isVolatile) {
+	if (_volatileMTLTextureSlots[slot] == isVolatile) { return; }
+
+	_volatileMTLTextureSlots[slot] = isVolatile;
+	if (isVolatile) {
+		_volatileMTLTextureCount++;
+	} else {
+		_volatileMTLTextureCount--;
+	}
 }
 
 MVKDescriptorSet::~MVKDescriptorSet() {
-	for (auto mvkDesc : _descriptors) { _pool->freeDescriptor(mvkDesc); }
+	for (uint32_t descIdx = 0; descIdx < _descriptorCount; descIdx++) { _pool->freeDescriptor(_descriptors[descIdx]); }
+	_pool->freeDescriptorArray(_descriptors);
+	[_mtlArgumentBuffer release];
 }
 
 
@@ -291,71 +487,39 @@ static inline bool getMVKPreallocateDescriptors() {
 template<class DescriptorClass>
 VkResult MVKDescriptorTypePreallocation<DescriptorClass>::allocateDescriptor(MVKDescriptor** pMVKDesc) {
 
-	uint32_t descCnt = (uint32_t)_descriptors.size();
-
-	// Preallocated descriptors that CANNOT be freed.
+	// Descriptors are first handed out in order, until all have been used.
 	// Next available index can only monotonically increase towards the limit.
-	if ( !_supportAvailability ) {
-		if (_nextAvailableIndex < descCnt) {
-			*pMVKDesc = &_descriptors[_nextAvailableIndex++];
-			return VK_SUCCESS;
-		} else {
-			return VK_ERROR_OUT_OF_POOL_MEMORY;
-		}
+	if (_nextAvailableIndex < _descriptors.size()) {
+		*pMVKDesc = &_descriptors[_nextAvailableIndex++];
+		return VK_SUCCESS;
 	}
 
-	// Descriptors that CAN be freed.
-	// An available index might exist anywhere in the pool of descriptors.
-	uint32_t origNextAvailPoolIdx = _nextAvailableIndex;
-
-	// First start looking from most recently found available slot
-	if (findDescriptor(descCnt, pMVKDesc)) { return VK_SUCCESS; }
-
-	// Then look from beginning of the collection, in case any previous descriptors were freed
-	_nextAvailableIndex = 0;
-	if (findDescriptor(origNextAvailPoolIdx, pMVKDesc)) { return VK_SUCCESS; }
+	// If descriptors CAN be freed, reuse the most recently freed descriptor, if one exists.
+	if ( !_freedIndices.empty() ) {
+		*pMVKDesc = &_descriptors[_freedIndices.back()];
+		_freedIndices.pop_back();
+		return VK_SUCCESS;
+	}
 
 	return VK_ERROR_OUT_OF_POOL_MEMORY;
 }
 
-// Find a descriptor within a range in a preallocated collection based on availability,
-// and return true if found, false if not
-template<typename DescriptorClass>
-bool MVKDescriptorTypePreallocation<DescriptorClass>::findDescriptor(uint32_t endIndex,
-																	 MVKDescriptor** pMVKDesc) {
-	while (_nextAvailableIndex < endIndex) {
-		if (_availability[_nextAvailableIndex]) {
-			_availability[_nextAvailableIndex] = false;
-			*pMVKDesc = &_descriptors[_nextAvailableIndex];
-			_nextAvailableIndex++;
-			return true;
-		}
-		_nextAvailableIndex++;
-	}
-	return false;
-}
-
-// Reset a descriptor and mark it available, if applicable
+// Reset a descriptor and mark it available, if applicable.
+// The index of the descriptor is determined from its position within the preallocated collection.
 template<typename DescriptorClass>
 void MVKDescriptorTypePreallocation<DescriptorClass>::freeDescriptor(MVKDescriptor* mvkDesc) {
 
 	mvkDesc->reset();
 
 	if (_supportAvailability) {
-		bool found = false;
-		size_t descCnt = _descriptors.size();
-		for (uint32_t descIdx = 0; !found && descIdx < descCnt; descIdx++) {
-			if (&_descriptors[descIdx] == mvkDesc) {
-				found = true;
-				_availability[descIdx] = true;
-			}
-		}
+		_freedIndices.push_back((uint32_t)((DescriptorClass*)mvkDesc - _descriptors.data()));
 	}
 }
 
 template<typename DescriptorClass>
 void MVKDescriptorTypePreallocation<DescriptorClass>::reset() {
 	_nextAvailableIndex = 0;
+	_freedIndices.clear();
 }
 
 template<typename DescriptorClass>
@@ -373,7 +537,7 @@ MVKDescriptorTypePreallocation<DescriptorClass>::MVKDescriptorTypePreallocation(
 
 	// Determine whether we need to track the availability of previously freed descriptors.
 	_supportAvailability = mvkIsAnyFlagEnabled(pCreateInfo->flags, VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
-	if (_supportAvailability) { _availability.resize(descriptorCount, true); }
+	if (_supportAvailability) { _freedIndices.reserve(descriptorCount); }
 	_nextAvailableIndex = 0;
 }
 
@@ -507,7 +671,7 @@ MVKPreallocatedDescriptors::MVKPreallocatedDescriptors(const VkDescriptorPoolCre
 VkResult MVKDescriptorPool::allocateDescriptorSets(uint32_t count,
 												   const VkDescriptorSetLayout* pSetLayouts,
 												   VkDescriptorSet* pDescriptorSets) {
-	if (_allocatedSets.size() + count > _maxSets) {
+	if (getAllocatedSetCount() + count > _maxSets) {
 		if (_device->_enabledExtensions.vk_KHR_maintenance1.enabled) {
 			return VK_ERROR_OUT_OF_POOL_MEMORY;		// Failure is an acceptable test...don't log as error.
 		} else {
@@ -528,29 +692,48 @@ VkResult MVKDescriptorPool::allocateDescriptorSets(uint32_t count,
 
 // Ensure descriptor set was actually allocated, then return to pool
 VkResult MVKDescriptorPool::freeDescriptorSets(uint32_t count, const VkDescriptorSet* pDescriptorSets) {
+
+	// Sets in an arena are only released together when the pool is reset. Freeing individual
+	// sets requires VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT, which disables the arena.
+	if (_descriptorSetArena) { return VK_SUCCESS; }
+
+	int64_t freedCnt = 0;
 	for (uint32_t dsIdx = 0; dsIdx < count; dsIdx++) {
 		MVKDescriptorSet* mvkDS = (MVKDescriptorSet*)pDescriptorSets[dsIdx];
 		freeDescriptorSet(mvkDS);
-		_allocatedSets.erase(mvkDS);
+		freedCnt += _allocatedSets.erase(mvkDS);
 	}
+	_device->updateResourceCount(_device->_resourceStatistics.descriptorSets, -freedCnt);
 	return VK_SUCCESS;
 }
 
-// Destroy all allocated descriptor sets
+// Destroy all allocated descriptor sets.
+// Sets in the arena are destroyed in place, and their memory is reclaimed by rewinding the arena.
 VkResult MVKDescriptorPool::reset(VkDescriptorPoolResetFlags flags) {
+	_device->updateResourceCount(_device->_resourceStatistics.descriptorSets, -int64_t(getAllocatedSetCount()));
 	for (auto& mvkDS : _allocatedSets) { freeDescriptorSet(mvkDS); }
 	_allocatedSets.clear();
+	for (auto& mvkDS : _arenaSets) { freeDescriptorSet(mvkDS); }
+	_arenaSets.clear();
+	if (_descriptorSetArena) { _descriptorSetArena->reset(); }
 	if (_preallocatedDescriptors) { _preallocatedDescriptors->reset(); }
 	return VK_SUCCESS;
 }
 
 VkResult MVKDescriptorPool::allocateDescriptorSet(MVKDescriptorSetLayout* mvkDSL,
 												  VkDescriptorSet* pVKDS) {
-	MVKDescriptorSet* mvkDS = new MVKDescriptorSet(mvkDSL, this);
+	MVKDescriptorSet* mvkDS = (_descriptorSetArena
+							   ? _descriptorSetArena->newObject<MVKDescriptorSet>(mvkDSL, this)
+							   : new MVKDescriptorSet(mvkDSL, this));
 	VkResult rslt = mvkDS->getConfigurationResult();
 
 	if (mvkDS->wasConfigurationSuccessful()) {
-		_allocatedSets.insert(mvkDS);
+		if (_descriptorSetArena) {
+			_arenaSets.push_back(mvkDS);
+		} else {
+			_allocatedSets.insert(mvkDS);
+		}
+		_device->updateResourceCount(_device->_resourceStatistics.descriptorSets, 1);
 		*pVKDS = (VkDescriptorSet)mvkDS;
 	} else {
 		freeDescriptorSet(mvkDS);
@@ -558,7 +741,23 @@ VkResult MVKDescriptorPool::allocateDescriptorSet(MVKDescriptorSetLayout* mvkDSL
 	return rslt;
 }
 
-void MVKDescriptorPool::freeDescriptorSet(MVKDescriptorSet* mvkDS) { mvkDS->destroy(); }
+// Arena memory is not freed here, and is reclaimed when the arena is rewound.
+void MVKDescriptorPool::freeDescriptorSet(MVKDescriptorSet* mvkDS) {
+	if (_descriptorSetArena) {
+		mvkDS->~MVKDescriptorSet();
+	} else {
+		mvkDS->destroy();
+	}
+}
+
+// Allocate an array of descriptor pointers, either from the arena, or from the heap
+MVKDescriptor** MVKDescriptorPool::allocateDescriptorArray(uint32_t count) {
+	return _descriptorSetArena ? _descriptorSetArena->newArray<MVKDescriptor*>(count) : new MVKDescriptor*[count];
+}
+
+void MVKDescriptorPool::freeDescriptorArray(MVKDescriptor** descriptors) {
+	if ( !_descriptorSetArena ) { delete[] descriptors; }
+}
 
 // Allocate a descriptor of the specified type
 VkResult MVKDescriptorPool::allocateDescriptor(VkDescriptorType descriptorType,
@@ -634,15 +833,30 @@ void MVKDescriptorPool::freeDescriptor(MVKDescriptor* mvkDesc) {
 	}
 }
 
+// Returns the size of an arena memory block large enough to hold the maximum content of the descriptor pool.
+static size_t getDescriptorSetArenaBlockSize(const VkDescriptorPoolCreateInfo* pCreateInfo) {
+	size_t descCnt = 0;
+	for (uint32_t poolIdx = 0; poolIdx < pCreateInfo->poolSizeCount; poolIdx++) {
+		descCnt += pCreateInfo->pPoolSizes[poolIdx].descriptorCount;
+	}
+	size_t setSize = mvkAlignByteCount(sizeof(MVKDescriptorSet), alignof(MVKDescriptorSet));
+	return std::max((pCreateInfo->maxSets * setSize) + (descCnt * sizeof(MVKDescriptor*)),
+					MVKArena::kMVKArenaBlockSize);
+}
+
 MVKDescriptorPool::MVKDescriptorPool(MVKDevice* device,
 									 const VkDescriptorPoolCreateInfo* pCreateInfo) : MVKVulkanAPIDeviceObject(device) {
 	_maxSets = pCreateInfo->maxSets;
+	_descriptorSetArena = (mvkIsAnyFlagEnabled(pCreateInfo->flags, VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
+						   ? nullptr : new MVKArena(getDescriptorSetArenaBlockSize(pCreateInfo)));
+	if (_descriptorSetArena) { _arenaSets.reserve(_maxSets); }
 	_preallocatedDescriptors = getMVKPreallocateDescriptors() ? new MVKPreallocatedDescriptors(pCreateInfo) : nullptr;
 }
 
 // Destroy all allocated descriptor sets and preallocated descriptors
 MVKDescriptorPool::~MVKDescriptorPool() {
 	reset(0);
+	if (_descriptorSetArena) { delete _descriptorSetArena; }
 	if (_preallocatedDescriptors) { _preallocatedDescriptors->destroy(); }
 }
 
@@ -662,18 +876,186 @@ VkDescriptorUpdateTemplateTypeKHR MVKDescriptorUpdateTemplate::getType() const {
 	return _type;
 }
 
+// Returns the size of the content of a single descriptor of the specified type in the template data.
+static size_t getDescriptorUpdateTemplateDataSize(VkDescriptorType descType) {
+	switch (descType) {
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+			return sizeof(VkDescriptorBufferInfo);
+
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+		case VK_DESCRIPTOR_TYPE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+			return sizeof(VkDescriptorImageInfo);
+
+		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+			return sizeof(VkBufferView);
+
+		case VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT:
+			return sizeof(VkWriteDescriptorSetInlineUniformBlockEXT);
+
+		default:
+			return 0;
+	}
+}
+
+// Resolves the entry to a run of descriptors in the descriptor set, and appends it to the
+// previous write if the descriptors and their content both follow on from that write.
+void MVKDescriptorUpdateTemplate::addWrite(MVKDescriptorSetLayout* dsl, const VkDescriptorUpdateTemplateEntryKHR& entry) {
+	if ( !dsl->_bindingToIndex.count(entry.dstBinding) ) { return; }
+
+	VkDescriptorType descType = dsl->getBinding(entry.dstBinding)->getDescriptorType();
+	uint32_t descIdx = dsl->getDescriptorIndex(entry.dstBinding, entry.dstArrayElement);
+
+	if ( !_writes.empty() ) {
+		auto& prevWrite = _writes.back();
+		if (prevWrite.descriptorType == descType &&
+			descType != VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT &&
+			prevWrite.stride == entry.stride &&
+			prevWrite.descriptorIndex + prevWrite.descriptorCount == descIdx &&
+			prevWrite.dataOffset + prevWrite.stride * prevWrite.descriptorCount == entry.offset) {
+			prevWrite.descriptorCount += entry.descriptorCount;
+			return;
+		}
+	}
+	_writes.push_back({entry.offset, entry.stride, descIdx, entry.descriptorCount, descType});
+}
+
+// Walks the entry across the push descriptor set layout bindings, in the same way pushing
+// the descriptors would, and records each binding that will actually receive descriptors.
+void MVKDescriptorUpdateTemplate::addPushes(MVKDescriptorSetLayout* dsl, const VkDescriptorUpdateTemplateEntryKHR& entry) {
+	uint32_t dstBinding = entry.dstBinding;
+	if ( !dsl->_bindingToIndex.count(dstBinding) ) { return; }
+
+	uint32_t maxBinding = 0;
+	for (auto& dslBind : dsl->_bindings) { maxBinding = std::max(maxBinding, dslBind.getBinding()); }
+
+	uint32_t dstArrayElement = entry.dstArrayElement;
+	uint32_t descriptorCount = entry.descriptorCount;
+	size_t dataOffset = entry.offset;
+	for (; descriptorCount && dstBinding <= maxBinding; dstBinding++) {
+		auto bindIdxIter = dsl->_bindingToIndex.find(dstBinding);
+		if (bindIdxIter == dsl->_bindingToIndex.end()) { continue; }
+
+		uint32_t bindIdx = bindIdxIter->second;
+		auto& dslBind = dsl->_bindings[bindIdx];
+		uint32_t bindDescCnt = dslBind.getDescriptorCount();
+		if (dstArrayElement >= bindDescCnt) {
+			dstArrayElement -= bindDescCnt;
+			continue;
+		}
+		if (dslBind.getDescriptorType() == entry.descriptorType) {
+			_pushes.push_back({dataOffset, entry.stride, bindIdx, dstArrayElement, descriptorCount, entry.descriptorType});
+		}
+		dstArrayElement = 0;
+		if (bindDescCnt > descriptorCount) {
+			descriptorCount = 0;
+		} else {
+			descriptorCount -= bindDescCnt;
+			dataOffset += entry.stride * bindDescCnt;
+		}
+	}
+}
+
 MVKDescriptorUpdateTemplate::MVKDescriptorUpdateTemplate(MVKDevice* device,
 														 const VkDescriptorUpdateTemplateCreateInfoKHR* pCreateInfo) :
 	MVKVulkanAPIDeviceObject(device), _type(pCreateInfo->templateType) {
 
-	for (uint32_t i = 0; i < pCreateInfo->descriptorUpdateEntryCount; i++)
-		_entries.push_back(pCreateInfo->pDescriptorUpdateEntries[i]);
+	MVKDescriptorSetLayout* dsl = nullptr;
+	if (_type == VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR) {
+		dsl = ((MVKPipelineLayout*)pCreateInfo->pipelineLayout)->getDescriptorSetLayout(pCreateInfo->set);
+	} else {
+		dsl = (MVKDescriptorSetLayout*)pCreateInfo->descriptorSetLayout;
+	}
+
+	for (uint32_t i = 0; i < pCreateInfo->descriptorUpdateEntryCount; i++) {
+		const auto& entry = pCreateInfo->pDescriptorUpdateEntries[i];
+		_entries.push_back(entry);
+
+		// If no stride is given, there is only one info struct of the appropriate type.
+		size_t entryDataSize = entry.offset + getDescriptorUpdateTemplateDataSize(entry.descriptorType);
+		if (entry.descriptorCount) { entryDataSize += entry.stride * (entry.descriptorCount - 1); }
+		_dataSize = std::max(_dataSize, entryDataSize);
+
+		if (_type == VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR) {
+			addPushes(dsl, entry);
+		} else {
+			addWrite(dsl, entry);
+		}
+	}
 }
 
 
 #pragma mark -
 #pragma mark Support functions
 
+// Performs a single write update to a descriptor set, including any inline uniform block data.
+static void writeDescriptorSet(const VkWriteDescriptorSet* pDescWrite) {
+	size_t stride;
+	MVKDescriptorSet* dstSet = (MVKDescriptorSet*)pDescWrite->dstSet;
+
+	const VkWriteDescriptorSetInlineUniformBlockEXT* pInlineUniformBlock = nullptr;
+	if (dstSet->getDevice()->_enabledExtensions.vk_EXT_inline_uniform_block.enabled) {
+		for (const auto* next = (VkBaseInStructure*)pDescWrite->pNext; next; next = next->pNext) {
+			switch (next->sType) {
+			case VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_INLINE_UNIFORM_BLOCK_EXT: {
+				pInlineUniformBlock = (VkWriteDescriptorSetInlineUniformBlockEXT*)next;
+				break;
+			}
+			default:
+				break;
+			}
+		}
+	}
+
+	const void* pData = getWriteParameters(pDescWrite->descriptorType, pDescWrite->pImageInfo,
+										   pDescWrite->pBufferInfo, pDescWrite->pTexelBufferView,
+										   pInlineUniformBlock, stride);
+	dstSet->write(pDescWrite, stride, pData);
+}
+
+// The minimum number of write updates in a single call to vkUpdateDescriptorSets()
+// that are worth distributing across the CPU cores.
+static const uint32_t kMVKMinParallelDescriptorWriteCount = 256;
+
+// Performs the write updates, distributing them across the CPU cores if there are enough of them
+// and they target more than one descriptor set. Each descriptor set is written by a single thread,
+// and its writes are performed in the order in which they were provided, so that later writes to
+// overlapping descriptors override earlier writes, but writes to different sets may occur in any order.
+// Sets that share a layout also share its Metal argument encoder, so when argument buffers are used,
+// their encoding is serialized on the _mtlArgumentEncodingLock of the layout.
+static void writeDescriptorSets(uint32_t writeCount, const VkWriteDescriptorSet* pDescriptorWrites) {
+	if ( !writeCount ) { return; }
+
+	MVKDevice* mvkDev = ((MVKDescriptorSet*)pDescriptorWrites[0].dstSet)->getDevice();
+	if (mvkDev->shouldUpdateDescriptorSetsInParallel() && writeCount >= kMVKMinParallelDescriptorWriteCount) {
+		MVKFlatHashMap<VkDescriptorSet, uint32_t> setGroupIndexes;
+		std::vector<std::vector<uint32_t>> setGroups;
+		for (uint32_t i = 0; i < writeCount; i++) {
+			auto rslt = setGroupIndexes.emplace(pDescriptorWrites[i].dstSet, (uint32_t)setGroups.size());
+			if (rslt.second) { setGroups.emplace_back(); }
+			setGroups[rslt.first->second].push_back(i);
+		}
+
+		if (setGroups.size() > 1) {
+			std::vector<uint32_t>* pSetGroups = setGroups.data();
+			dispatch_apply(setGroups.size(), dispatch_get_global_queue(QOS_CLASS_USER_INTERACTIVE, 0), ^(size_t grpIdx) {
+				@autoreleasepool {
+					for (uint32_t writeIdx : pSetGroups[grpIdx]) { writeDescriptorSet(&pDescriptorWrites[writeIdx]); }
+				}
+			});
+			return;
+		}
+	}
+
+	for (uint32_t i = 0; i < writeCount; i++) { writeDescriptorSet(&pDescriptorWrites[i]); }
+}
+
 // Updates the resource bindings in the descriptor sets inditified in the specified content.
 void mvkUpdateDescriptorSets(uint32_t writeCount,
 							 const VkWriteDescriptorSet* pDescriptorWrites,
@@ -681,30 +1063,7 @@ void mvkUpdateDescriptorSets(uint32_t writeCount,
 							 const VkCopyDescriptorSet* pDescriptorCopies) {
 
 	// Perform the write updates
-	for (uint32_t i = 0; i < writeCount; i++) {
-		const VkWriteDescriptorSet* pDescWrite = &pDescriptorWrites[i];
-		size_t stride;
-		MVKDescriptorSet* dstSet = (MVKDescriptorSet*)pDescWrite->dstSet;
-
-		const VkWriteDescriptorSetInlineUniformBlockEXT* pInlineUniformBlock = nullptr;
-		if (dstSet->getDevice()->_enabledExtensions.vk_EXT_inline_uniform_block.enabled) {
-			for (const auto* next = (VkBaseInStructure*)pDescWrite->pNext; next; next = next->pNext) {
-				switch (next->sType) {
-				case VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_INLINE_UNIFORM_BLOCK_EXT: {
-					pInlineUniformBlock = (VkWriteDescriptorSetInlineUniformBlockEXT*)next;
-					break;
-				}
-				default:
-					break;
-				}
-			}
-		}
-
-		const void* pData = getWriteParameters(pDescWrite->descriptorType, pDescWrite->pImageInfo,
-											   pDescWrite->pBufferInfo, pDescWrite->pTexelBufferView,
-											   pInlineUniformBlock, stride);
-		dstSet->write(pDescWrite, stride, pData);
-	}
+	writeDescriptorSets(writeCount, pDescriptorWrites);
 
 	// Perform the copy updates by reading bindings from one set and writing to other set.
 	for (uint32_t i = 0; i < copyCount; i++) {
@@ -738,12 +1097,7 @@ void mvkUpdateDescriptorSetWithTemplate(VkDescriptorSet descriptorSet,
 	if (pTemplate->getType() != VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET_KHR)
 		return;
 
-	// Perform the updates
-	for (uint32_t i = 0; i < pTemplate->getNumberOfEntries(); i++) {
-		const VkDescriptorUpdateTemplateEntryKHR* pEntry = pTemplate->getEntry(i);
-		const void* pCurData = (const char*)pData + pEntry->offset;
-		dstSet->write(pEntry, pEntry->stride, pCurData);
-	}
+	dstSet->write(pTemplate, pData);
 }
 
 void mvkPopulateShaderConverterContext(mvk::SPIRVToMSLConversionConfiguration& context,
@@ -24,12 +24,16 @@
 #include "MVKLayers.h"
 #include "MVKObjectPool.h"
 #include "MVKVector.h"
+#include "MVKFlatHashMap.h"
 #include "MVKPixelFormats.h"
 #include "MVKOSExtensions.h"
 #include "mvk_datatypes.hpp"
 #include "vk_mvk_moltenvk.h"
 #include <string>
 #include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
 
 #import <Metal/Metal.h>
 #import <QuartzCore/CAMetalLayer.h>
@@ -65,6 +69,9 @@ class MVKRenderPass;
 class MVKCommandPool;
 class MVKCommandEncoder;
 class MVKCommandResourceFactory;
+class MVKCommandEncodingCache;
+class MVKTexelBufferTextureCache;
+class MVKDeviceMemoryAllocator;
 
 
 /** The buffer index to use for vertex content. */
@@ -78,6 +85,26 @@ const static uint32_t kMVKMaxSwapchainImageCount = 3;
 const static uint32_t kMVKCachedViewportScissorCount = 16;
 const static uint32_t kMVKCachedColorAttachmentCount = 8;
 
+/**
+ * Identifies the dynamic states added by the VK_EXT_extended_dynamic_state extension.
+ * Their Vulkan values are not contiguous with the core dynamic states, so they are
+ * tracked using these values, which follow the core dynamic states.
+ */
+typedef enum : uint32_t {
+	kMVKDynamicStateCullMode = VK_DYNAMIC_STATE_STENCIL_REFERENCE + 1,
+	kMVKDynamicStateFrontFace,
+	kMVKDynamicStatePrimitiveTopology,
+	kMVKDynamicStateViewportWithCount,
+	kMVKDynamicStateScissorWithCount,
+	kMVKDynamicStateVertexInputBindingStride,
+	kMVKDynamicStateDepthTestEnable,
+	kMVKDynamicStateDepthWriteEnable,
+	kMVKDynamicStateDepthCompareOp,
+	kMVKDynamicStateDepthBoundsTestEnable,
+	kMVKDynamicStateStencilTestEnable,
+	kMVKDynamicStateStencilOp,
+} MVKExtendedDynamicState;
+
 
 #pragma mark -
 #pragma mark MVKPhysicalDevice
@@ -284,6 +311,12 @@ public:
 	/** Returns whether this is a unified memory device. */
 	bool getHasUnifiedMemory();
 
+	/**
+	 * Adjusts the amount of memory MoltenVK has allocated from the heap used by the
+	 * memory type, by the specified number of bytes. Used to report VK_EXT_memory_budget usage.
+	 */
+	void updateAllocatedMemorySize(uint32_t memoryTypeIndex, int64_t sizeDelta);
+
 	/** Returns the external memory properties supported for buffers for the handle type. */
 	VkExternalMemoryProperties& getExternalBufferProperties(VkExternalMemoryHandleTypeFlagBits handleType);
 
@@ -298,6 +331,18 @@ public:
 
 	/** Returns the underlying Metal device. */
 	inline id<MTLDevice> getMTLDevice() { return _mtlDevice; }
+
+	/** Returns the Metal counter set used to sample GPU timestamps, or nil if the GPU does not expose one. */
+	inline id<MTLCounterSet> getTimestampMTLCounterSet() { return _timestampMTLCounterSet; }
+
+	/** Returns the Metal counter set used to sample pipeline statistics, or nil if the GPU does not expose one. */
+	inline id<MTLCounterSet> getStatisticMTLCounterSet() { return _statisticMTLCounterSet; }
+
+	/**
+	 * Samples the current GPU timestamp into gpuTimestamp, and returns the number of nanoseconds
+	 * per GPU timestamp tick, as measured against the CPU clock since this device was created.
+	 */
+	double sampleGPUTimestamp(uint64_t& gpuTimestamp);
     
     /*** Replaces the underlying Metal device .*/
     inline void replaceMTLDevice(id<MTLDevice> mtlDevice) {
@@ -309,7 +354,13 @@ public:
 
 #pragma mark Construction
 
-	/** Constructs an instance wrapping the specified Vulkan instance and Metal device. */
+	/**
+	 * Constructs an instance wrapping the specified Vulkan instance and Metal device.
+	 *
+	 * Querying the capabilities of the Metal device is deferred until this instance is
+	 * first retrieved from its Vulkan handle, so that creating a VkInstance does not pay
+	 * for detailing physical devices that the app never queries or uses.
+	 */
 	MVKPhysicalDevice(MVKInstance* mvkInstance, id<MTLDevice> mtlDevice);
 
 	/** Default destructor. */
@@ -326,13 +377,16 @@ public:
      * This is the compliment of the getVkPhysicalDevice() method.
      */
     static inline MVKPhysicalDevice* getMVKPhysicalDevice(VkPhysicalDevice vkPhysicalDevice) {
-        return (MVKPhysicalDevice*)getDispatchableObject(vkPhysicalDevice);
+        MVKPhysicalDevice* mvkPD = (MVKPhysicalDevice*)getDispatchableObject(vkPhysicalDevice);
+        if ( !mvkPD->_isInitialized.load(std::memory_order_acquire) ) { mvkPD->initialize(); }
+        return mvkPD;
     }
 
 protected:
 	friend class MVKDevice;
 
 	void propogateDebugName() override {}
+	void initialize();
 	MTLFeatureSet getMaximalMTLFeatureSet();
     void initMetalFeatures();
 	void initFeatures();
@@ -344,6 +398,7 @@ protected:
 	uint64_t getVRAMSize();
 	uint64_t getRecommendedMaxWorkingSetSize();
 	uint64_t getCurrentAllocatedSize();
+	void populateMemoryBudget(VkPhysicalDeviceMemoryBudgetPropertiesEXT* budgetProps);
 	void initExternalMemoryProperties();
 	void initExtensions();
 	MVKVector<MVKQueueFamily*>& getQueueFamilies();
@@ -355,6 +410,8 @@ protected:
 	void logGPUInfo();
 
 	id<MTLDevice> _mtlDevice;
+	id<MTLCounterSet> _timestampMTLCounterSet = nil;
+	id<MTLCounterSet> _statisticMTLCounterSet = nil;
 	MVKInstance* _mvkInstance;
 	const MVKExtensionList _supportedExtensions;
 	VkPhysicalDeviceFeatures _features;
@@ -369,8 +426,14 @@ protected:
 	uint32_t _hostCoherentMemoryTypes;
 	uint32_t _privateMemoryTypes;
 	uint32_t _lazilyAllocatedMemoryTypes;
+	std::atomic<uint64_t> _allocatedHeapSizes[VK_MAX_MEMORY_HEAPS];
 	VkExternalMemoryProperties _mtlBufferExternalMemoryProperties;
 	VkExternalMemoryProperties _mtlTextureExternalMemoryProperties;
+	VkExternalMemoryProperties _hostAllocationExternalMemoryProperties;
+	uint64_t _cpuTimestampBase = 0;
+	uint64_t _gpuTimestampBase = 0;
+	std::mutex _initLock;
+	std::atomic<bool> _isInitialized;
 };
 
 
@@ -382,6 +445,27 @@ typedef struct {
 	id<MTLCommandBuffer> mtlCmdBuffer = nil;
 } MVKMTLBlitEncoder;
 
+/** Identifies a shader stage compiled into a pipeline, and the durations of its compilation phases, in milliseconds. */
+typedef struct MVKShaderStageCompileRecord {
+	std::size_t shaderModuleHash = 0;
+	std::size_t configHash = 0;
+	std::string stage;
+	std::string entryPoint;
+	double spirvToMSL = 0.0;
+	double mslCompile = 0.0;
+	double functionSpecialization = 0.0;
+} MVKShaderStageCompileRecord;
+
+/** The shader stages compiled into a pipeline, and the durations of its compilation phases, in milliseconds. */
+typedef struct MVKPipelineCompileRecord {
+	std::string pipelineType;
+	std::vector<MVKShaderStageCompileRecord> stages;
+	double pipelineCompile = 0.0;
+
+	/** Returns the total duration of all compilation phases, in milliseconds. */
+	double getTotalDuration() const;
+} MVKPipelineCompileRecord;
+
 /** Represents a Vulkan logical GPU device, associated with a physical device. */
 class MVKDevice : public MVKDispatchableVulkanAPIObject {
 
@@ -408,6 +492,15 @@ public:
     /** Returns the common resource factory for creating command resources. */
     inline MVKCommandResourceFactory* getCommandResourceFactory() { return _commandResourceFactory; }
 
+	/** Returns the device-wide cache of command pipeline states, shared by all command pools. */
+	inline MVKCommandEncodingCache* getCommandEncodingCache() { return _commandEncodingCache; }
+
+	/** Returns the device-wide cache of the MTLTextures that overlay MTLBuffers for texel buffer views. */
+	inline MVKTexelBufferTextureCache* getTexelBufferTextureCache() { return _texelBufferTextureCache; }
+
+	/** Returns the allocator that places small device memory allocations within larger memory blocks. */
+	inline MVKDeviceMemoryAllocator* getDeviceMemoryAllocator() { return _deviceMemoryAllocator; }
+
 	/** Returns the function pointer corresponding to the specified named entry point. */
 	PFN_vkVoidFunction getProcAddr(const char* pName);
 
@@ -556,6 +649,11 @@ public:
 	void freeMemory(MVKDeviceMemory* mvkDevMem,
 					const VkAllocationCallbacks* pAllocator);
 
+	/** Populates the memory types that can import the host pointer through VK_EXT_external_memory_host. */
+	VkResult getMemoryHostPointerProperties(VkExternalMemoryHandleTypeFlagBits handleType,
+											const void* pHostPointer,
+											VkMemoryHostPointerPropertiesEXT* pMemHostPtrProps);
+
 
 #pragma mark Operations
 
@@ -587,7 +685,17 @@ public:
     inline void addActivityPerformance(MVKPerformanceTracker& activityTracker,
 									   uint64_t startTime, uint64_t endTime = 0) {
 		if (_pMVKConfig->performanceTracking) {
-			updateActivityPerformance(activityTracker, startTime, endTime);
+			addActivityDuration(activityTracker, mvkGetElapsedMilliseconds(startTime, endTime));
+		}
+	};
+
+	/**
+	 * If performance is being tracked, adds the performance for an activity with
+	 * the given duration, in milliseconds, to the given performance statistics.
+	 */
+	inline void addActivityDuration(MVKPerformanceTracker& activityTracker, double durationMS) {
+		if (_pMVKConfig->performanceTracking) {
+			updateActivityPerformance(activityTracker, durationMS);
 
 			// Log call not locked. Very minor chance that the tracker data will be updated during log call,
 			// resulting in an inconsistent report. Not worth taking lock perf hit for rare inline reporting.
@@ -595,15 +703,45 @@ public:
 		}
 	};
 
+	/**
+	 * Adjusts the number of active MTLCommandBuffers across all queues, in the performance statistics,
+	 * by the specified amount, and tracks the highest number of MTLCommandBuffers active on any queue.
+	 */
+	void updateActiveMTLCommandBufferCount(int32_t delta, uint32_t queueActiveCount);
+
     /** Populates the specified statistics structure from the current activity performance statistics. */
     void getPerformanceStatistics(MVKPerformanceStatistics* pPerf);
 
+	/**
+	 * Adjusts the current count of a resource in the resource statistics
+	 * by the specified amount, and tracks the highest count of the resource.
+	 */
+	void updateResourceCount(MVKResourceCount& rezCount, int64_t delta);
+
+	/**
+	 * Adjusts the current count of bytes of Metal memory of the specified storage mode, in the resource
+	 * statistics, by the specified amount, and tracks the highest count of bytes of that storage mode.
+	 */
+	void updateMTLStorageModeByteCount(MVKStorageModeByteCounts& byteCounts, MTLStorageMode mtlStorageMode, int64_t delta);
+
+	/** Populates the specified statistics structure from the current resource statistics. */
+	void getResourceStatistics(MVKResourceStatistics* pRezStats);
+
 	/** Invalidates the memory regions. */
 	VkResult invalidateMappedMemoryRanges(uint32_t memRangeCount, const VkMappedMemoryRange* pMemRanges);
 
 	/** Log all performance statistics. */
 	void logPerformanceSummary();
 
+	/** Returns whether compilations that exceed the slow compile threshold should be reported. */
+	inline bool isReportingSlowCompiles() { return _slowCompileThreshold > 0.0; }
+
+	/**
+	 * If the total duration of the compilation phases of the pipeline exceeds the slow compile
+	 * threshold, logs the compilation record, and retains it for the slow compile report file.
+	 */
+	void addPipelineCompileRecord(const MVKPipelineCompileRecord& compileRecord);
+
 
 #pragma mark Metal
 
@@ -613,6 +751,116 @@ public:
 	/** Returns standard compilation options to be used when compiling MSL shaders. */
 	inline MTLCompileOptions* getMTLCompileOptions() { return _mtlCompileOptions; }
 
+	/** Returns whether command buffers should hold their commands in a linear arena instead of type pools. */
+	inline bool shouldUseCommandArena() { return _useCommandArena; }
+
+	/** Returns whether draw commands in reusable command buffers should be replayed from a MTLIndirectCommandBuffer. */
+	inline bool shouldReplayReusableCommandBuffers() { return _useIndirectCommandBufferReplay; }
+
+	/** Returns whether draw commands in secondary command buffers should be encoded into a MTLIndirectCommandBuffer when recording ends. */
+	inline bool shouldPreencodeSecondaryCommandBuffers() { return _preencodeSecondaryCommandBuffers; }
+
+	/** Returns whether the command buffers in a queue submission may be encoded onto Metal in parallel. */
+	inline bool shouldEncodeSubmissionsInParallel() { return _useParallelSubmitEncoding; }
+
+	/** Returns whether large batches of descriptor set writes should be performed in parallel. */
+	inline bool shouldUpdateDescriptorSetsInParallel() { return _useParallelDescriptorSetUpdates; }
+
+	/** Returns whether descriptors should retain the buffers, image views, buffer views and samplers written to them. */
+	inline bool shouldRetainDescriptorResources() { return _retainDescriptorResources; }
+
+	/** Returns whether the load and store actions of render passes should be inferred from the commands around them. */
+	inline bool shouldInferLoadStoreActions() { return _inferLoadStoreActions; }
+
+	/**
+	 * Returns the filter used to upscale swapchain images that were rendered at less than their
+	 * full extent, as a MVKSwapchainUpscaleFilter value, or zero if upscaling is disabled.
+	 */
+	inline uint32_t getSwapchainUpscaleFilter() { return _swapchainUpscaleFilter; }
+
+	/**
+	 * Returns whether pipeline caches should record the shader libraries used by bound pipelines,
+	 * and compile the recorded shader libraries in the background when their cache data is loaded.
+	 */
+	inline bool shouldPrewarmPipelines() { return _prewarmPipelines; }
+
+	/** Returns whether transient command data should be suballocated from a ring buffer owned by each command pool. */
+	inline bool shouldUseTransientMTLBufferRing() { return _useTransientMTLBufferRing; }
+
+	/** Returns whether compatible consecutive subpasses should be merged into a single Metal render pass. */
+	inline bool shouldMergeSubpasses() { return _useSubpassMerging; }
+
+	/** Returns whether indirect draws with multiple draws should be encoded into a MTLIndirectCommandBuffer on the GPU. */
+	inline bool shouldEncodeMultiDrawIndirectOnGPU() { return _useGPUMultiDrawIndirect; }
+
+	/** Returns whether the Metal pipeline states of pipelines should be compiled in the background. */
+	inline bool shouldCompilePipelinesAsynchronously() { return _useAsyncPipelineCompilation; }
+
+	/**
+	 * Returns whether swapchains should display a performance HUD over each presented image.
+	 * The HUD displays performance statistics, so is only displayed while performance is tracked.
+	 */
+	inline bool shouldDisplayPerformanceHUD() { return _displayPerformanceHUD && _pMVKConfig->performanceTracking; }
+
+	/** Returns whether the contents of descriptor sets should be encoded into Metal argument buffers. */
+	inline bool shouldUseMetalArgumentBuffers() { return _useMetalArgumentBuffers; }
+
+	/** Returns whether immutable samplers should be hardcoded into shaders as MSL constexpr samplers where possible. */
+	inline bool shouldUseConstExprImmutableSamplers() { return _useConstExprImmutableSamplers; }
+
+	/** Returns whether small device memory allocations should be placed within larger shared memory blocks. */
+	inline bool shouldSubAllocateDeviceMemory() { return _subAllocateDeviceMemory; }
+
+	/** Returns whether flushed ranges of non-coherent memory should be tracked and synced on queue submission. */
+	inline bool shouldTrackDirtyMappedMemory() { return _trackDirtyMappedMemory; }
+
+	/** Returns whether swapchains should acquire the CAMetalDrawables of acquired images on a background thread. */
+	inline bool shouldPrefetchDrawables() { return _prefetchDrawables; }
+
+	/** Returns whether the compute dispatches of the app should be encoded into concurrent Metal compute encoders. */
+	inline bool shouldUseConcurrentComputeDispatch() { return _useConcurrentComputeDispatch; }
+
+	/** Returns whether hazards between the Metal encoders of the app resources should be tracked using MTLFences. */
+	inline bool shouldUseFenceHazardTracking() { return _useFenceHazardTracking; }
+
+	/**
+	 * Returns the number of commands after which the MTLCommandBuffer of a queue submission may be
+	 * committed before all of its commands are encoded, at a safe point, or zero if disabled.
+	 */
+	inline uint32_t getEarlyCommitCommandCount() { return _earlyCommitCommandCount; }
+
+	/**
+	 * Returns the time, in microseconds, after which the MTLCommandBuffer of a queue submission may be
+	 * committed before all of its commands are encoded, at a safe point, or zero if disabled.
+	 */
+	inline uint32_t getEarlyCommitInterval() { return _earlyCommitInterval; }
+
+	/**
+	 * Returns the MTLResourceOptions hazard tracking mode to use for app resources. If hazards are
+	 * tracked using MTLFences, Metal hazard tracking of app resources is disabled. Otherwise, the
+	 * default hazard tracking mode is used.
+	 */
+	MTLResourceOptions getMTLResourceHazardTrackingOptions();
+
+	/**
+	 * Returns the MTLFence with the specified index, used by the command encoders to track hazards
+	 * between the Metal encoders of command buffers submitted to the specified Metal command queue.
+	 * Fences are created as needed, and are retained by this device.
+	 */
+	id<MTLFence> getHazardTrackingMTLFence(id<MTLCommandQueue> mtlCmdQueue, uint32_t fenceIndex);
+
+	/** Registers the device memory as having dirty pages that must be synced before the next queue submission. */
+	void addDirtyDeviceMemory(MVKDeviceMemory* mvkMem);
+
+	/** Unregisters the device memory from the collection of device memory with dirty pages. */
+	void removeDirtyDeviceMemory(MVKDeviceMemory* mvkMem);
+
+	/** Syncs the dirty pages of all registered device memory to the device. */
+	void flushDirtyDeviceMemory();
+
+	/** Returns the listener used to notify host waits on MTLSharedEvents, such as those of timeline semaphores. */
+	id<MTLSharedEventListener> getMTLSharedEventListener();
+
 	/** Returns the Metal vertex buffer index to use for the specified vertex attribute binding number.  */
 	uint32_t getMetalBufferIndexForVertexAttributeBinding(uint32_t binding);
 
@@ -626,13 +874,16 @@ public:
     id<MTLBuffer> getGlobalVisibilityResultMTLBuffer();
 
     /**
-     * Expands the visibility results buffer, used for occlusion queries, by replacing the
-     * existing buffer with a new MTLBuffer that is large enough to accommodate all occlusion
-     * queries created to date, including those defined in the specified query pool.
-     * Returns the previous query count, before the new queries were added, which can
-     * be used by the new query pool to locate its queries within the single large buffer.
+     * Reserves a slice of the global visibility results buffer, used for occlusion queries,
+     * large enough to hold the specified number of queries, and returns the index of the
+     * first query in the slice, which the query pool uses to locate its queries within the
+     * single large buffer. The global buffer is created once, at its maximum size, and is
+     * never replaced, so reserving a slice never affects command buffers that use the buffer.
      */
-    uint32_t expandVisibilityResultMTLBuffer(uint32_t queryCount);
+    uint32_t reserveVisibilityResultMTLBufferSlice(uint32_t queryCount);
+
+    /** Releases a slice of the global visibility results buffer previously reserved by a query pool. */
+    void releaseVisibilityResultMTLBufferSlice(uint32_t firstQuery);
 
     /** Returns the memory type index corresponding to the specified Metal memory storage mode. */
     uint32_t getVulkanMemoryTypeIndex(MTLStorageMode mtlStorageMode);
@@ -652,6 +903,7 @@ public:
 	const VkPhysicalDeviceVariablePointerFeatures _enabledVarPtrFeatures;
 	const VkPhysicalDeviceFragmentShaderInterlockFeaturesEXT _enabledInterlockFeatures;
 	const VkPhysicalDeviceHostQueryResetFeaturesEXT _enabledHostQryResetFeatures;
+	const VkPhysicalDeviceTimelineSemaphoreFeaturesKHR _enabledTimelineSem4Features;
 	const VkPhysicalDeviceScalarBlockLayoutFeaturesEXT _enabledScalarLayoutFeatures;
 	const VkPhysicalDeviceTexelBufferAlignmentFeaturesEXT _enabledTexelBuffAlignFeatures;
 	const VkPhysicalDeviceVertexAttributeDivisorFeaturesEXT _enabledVtxAttrDivFeatures;
@@ -671,6 +923,10 @@ public:
 
     /** Performance statistics. */
     MVKPerformanceStatistics _performanceStatistics;
+	MVKFlatHashMap<uint32_t, uint32_t> _performanceHistogramIndexes;
+
+	/** Resource statistics. */
+	MVKResourceStatistics _resourceStatistics;
 
 
 #pragma mark Construction
@@ -699,6 +955,7 @@ protected:
 	MVKResource* addResource(MVKResource* rez);
 	MVKResource* removeResource(MVKResource* rez);
     void initPerformanceTracking();
+	void initPerformanceTracker(MVKPerformanceTracker& activity);
 	void initPhysicalDevice(MVKPhysicalDevice* physicalDevice, const VkDeviceCreateInfo* pCreateInfo);
 	void initQueues(const VkDeviceCreateInfo* pCreateInfo);
 	void initMTLCompileOptions();
@@ -707,22 +964,65 @@ protected:
 	void enableExtensions(const VkDeviceCreateInfo* pCreateInfo);
     const char* getActivityPerformanceDescription(MVKPerformanceTracker& activity, MVKPerformanceStatistics& perfStats);
 	void logActivityPerformance(MVKPerformanceTracker& activity, MVKPerformanceStatistics& perfStats, bool isInline = false);
-	void updateActivityPerformance(MVKPerformanceTracker& activity, uint64_t startTime, uint64_t endTime);
+	void writePerformanceReport();
+	void writeSlowCompileReport();
+	void updateActivityPerformance(MVKPerformanceTracker& activity, double currInterval);
+	MVKPerformanceHistogram* getActivityPerformanceHistogram(MVKPerformanceTracker& activity, MVKPerformanceStatistics& perfStats);
 
 	MVKPhysicalDevice* _physicalDevice;
     MVKCommandResourceFactory* _commandResourceFactory;
+	MVKCommandEncodingCache* _commandEncodingCache;
+	MVKTexelBufferTextureCache* _texelBufferTextureCache;
+	MVKDeviceMemoryAllocator* _deviceMemoryAllocator;
 	MTLCompileOptions* _mtlCompileOptions;
 	MVKVectorInline<MVKVectorInline<MVKQueue*, kMVKQueueCountPerQueueFamily>, kMVKQueueFamilyCount> _queuesByQueueFamilyIndex;
 	MVKVectorInline<MVKResource*, 256> _resources;
 	std::mutex _rezLock;
     std::mutex _perfLock;
+	std::mutex _rezStatsLock;
+	std::unordered_set<MVKCommandPool*> _commandPools;
+	std::string _performanceReportFile;
+	std::string _slowCompileReportFile;
+	std::vector<MVKPipelineCompileRecord> _slowCompileRecords;
+	std::mutex _slowCompileLock;
+	double _slowCompileThreshold;
     id<MTLBuffer> _globalVisibilityResultMTLBuffer;
-    uint32_t _globalVisibilityQueryCount;
+    MVKVectorInline<std::pair<uint32_t, uint32_t>, 8> _globalVisibilityQuerySlices;	// First query and query count, sorted by first query
     std::mutex _vizLock;
 	bool _useMTLFenceForSemaphores;
 	bool _useMTLEventForSemaphores;
 	bool _useCommandPooling;
+	bool _useCommandArena;
+	bool _useIndirectCommandBufferReplay;
+	bool _preencodeSecondaryCommandBuffers;
 	bool _logActivityPerformanceInline;
+	bool _displayPerformanceHUD;
+	bool _useParallelSubmitEncoding;
+	bool _useTransientMTLBufferRing;
+	bool _useSubpassMerging;
+	bool _useGPUMultiDrawIndirect;
+	bool _useAsyncPipelineCompilation;
+	bool _useParallelPipelineCreation;
+	bool _useParallelDescriptorSetUpdates;
+	bool _retainDescriptorResources;
+	bool _inferLoadStoreActions;
+	bool _useMetalArgumentBuffers;
+	bool _useConstExprImmutableSamplers;
+	bool _subAllocateDeviceMemory;
+	bool _trackDirtyMappedMemory;
+	bool _prefetchDrawables;
+	bool _useConcurrentComputeDispatch;
+	bool _useFenceHazardTracking;
+	uint32_t _earlyCommitCommandCount;
+	uint32_t _earlyCommitInterval;
+	uint32_t _swapchainUpscaleFilter;
+	bool _prewarmPipelines;
+	std::unordered_map<id<MTLCommandQueue>, MVKVectorInline<id<MTLFence>, 16>> _hazardTrackingMTLFences;
+	std::mutex _hazardTrackingFenceLock;
+	MVKVectorInline<MVKDeviceMemory*, 4> _dirtyDeviceMemories;
+	std::mutex _dirtyMemLock;
+	id<MTLSharedEventListener> _mtlSharedEventListener = nil;
+	std::mutex _sharedEventListenerLock;
 };
 
 
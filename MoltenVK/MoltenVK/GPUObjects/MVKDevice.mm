@@ -114,6 +114,11 @@ void MVKPhysicalDevice::getFeatures(VkPhysicalDeviceFeatures2* features) {
 				hostQueryResetFeatures->hostQueryReset = true;
 				break;
 			}
+			case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR: {
+				auto* timelineSem4Features = (VkPhysicalDeviceTimelineSemaphoreFeaturesKHR*)next;
+				timelineSem4Features->timelineSemaphore = _metalFeatures.events;
+				break;
+			}
 			case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SCALAR_BLOCK_LAYOUT_FEATURES_EXT: {
 				auto* scalarLayoutFeatures = (VkPhysicalDeviceScalarBlockLayoutFeaturesEXT*)next;
 				scalarLayoutFeatures->scalarBlockLayout = true;
@@ -150,6 +155,13 @@ void MVKPhysicalDevice::getFeatures(VkPhysicalDeviceFeatures2* features) {
 				inlineUniformBlockFeatures->descriptorBindingInlineUniformBlockUpdateAfterBind = true;
 				break;
 			}
+#ifdef VK_EXT_extended_dynamic_state
+			case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT: {
+				auto* extDynStateFeatures = (VkPhysicalDeviceExtendedDynamicStateFeaturesEXT*)next;
+				extDynStateFeatures->extendedDynamicState = true;
+				break;
+			}
+#endif
 			default:
 				break;
 		}
@@ -199,6 +211,16 @@ void MVKPhysicalDevice::getProperties(VkPhysicalDeviceProperties2* properties) {
 				populate((VkPhysicalDeviceIDProperties*)next);
 				break;
 			}
+			case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_PROPERTIES_KHR: {
+				auto* timelineSem4Props = (VkPhysicalDeviceTimelineSemaphorePropertiesKHR*)next;
+				timelineSem4Props->maxTimelineSemaphoreValueDifference = numeric_limits<uint64_t>::max();
+				break;
+			}
+			case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT: {
+				auto* extMemHostProps = (VkPhysicalDeviceExternalMemoryHostPropertiesEXT*)next;
+				extMemHostProps->minImportedHostPointerAlignment = mvkGetHostMemoryPageSize();
+				break;
+			}
 			case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PORTABILITY_SUBSET_PROPERTIES_EXTX: {
 				auto* portabilityProps = (VkPhysicalDevicePortabilitySubsetPropertiesEXTX*)next;
 				portabilityProps->minVertexInputBindingStrideAlignment = 4;
@@ -487,6 +509,7 @@ static VkExternalMemoryProperties _emptyExtMemProps = {};
 VkExternalMemoryProperties& MVKPhysicalDevice::getExternalBufferProperties(VkExternalMemoryHandleTypeFlagBits handleType) {
 	switch (handleType) {
 		case VK_EXTERNAL_MEMORY_HANDLE_TYPE_MTLBUFFER_BIT_KHR:		return _mtlBufferExternalMemoryProperties;
+		case VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT:	return _hostAllocationExternalMemoryProperties;
 		default: 													return _emptyExtMemProps;
 	}
 }
@@ -675,6 +698,9 @@ VkResult MVKPhysicalDevice::getSurfacePresentModes(MVKSurface* surface,
 		ADD_VK_PRESENT_MODE(VK_PRESENT_MODE_IMMEDIATE_KHR);
 	}
 
+	// Mailbox presentation is synchronized to the display, and drops superseded images itself.
+	ADD_VK_PRESENT_MODE(VK_PRESENT_MODE_MAILBOX_KHR);
+
 	if (pPresentModes && *pCount < presentModesCnt) {
 		return VK_INCOMPLETE;
 	}
@@ -812,15 +838,7 @@ VkResult MVKPhysicalDevice::getMemoryProperties(VkPhysicalDeviceMemoryProperties
 	for (auto* next = (VkBaseOutStructure*)pMemoryProperties->pNext; next; next = next->pNext) {
 		switch (next->sType) {
 			case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT: {
-				auto* budgetProps = (VkPhysicalDeviceMemoryBudgetPropertiesEXT*)next;
-				mvkClear(budgetProps->heapBudget, VK_MAX_MEMORY_HEAPS);
-				mvkClear(budgetProps->heapUsage, VK_MAX_MEMORY_HEAPS);
-				budgetProps->heapBudget[0] = (VkDeviceSize)getRecommendedMaxWorkingSetSize();
-				budgetProps->heapUsage[0] = (VkDeviceSize)getCurrentAllocatedSize();
-				if (!getHasUnifiedMemory()) {
-					budgetProps->heapBudget[1] = (VkDeviceSize)mvkGetAvailableMemorySize();
-					budgetProps->heapUsage[1] = (VkDeviceSize)mvkGetUsedMemorySize();
-				}
+				populateMemoryBudget((VkPhysicalDeviceMemoryBudgetPropertiesEXT*)next);
 				break;
 			}
 			default:
@@ -830,6 +848,46 @@ VkResult MVKPhysicalDevice::getMemoryProperties(VkPhysicalDeviceMemoryProperties
 	return VK_SUCCESS;
 }
 
+// Combines what Metal reports about the device working set with what MoltenVK itself has
+// allocated from each heap. Metal does not account for memory that has been allocated but
+// not yet made resident, so the larger of the two is reported as the heap usage, and the
+// budget is never reported as less than the memory already in use.
+void MVKPhysicalDevice::populateMemoryBudget(VkPhysicalDeviceMemoryBudgetPropertiesEXT* budgetProps) {
+	mvkClear(budgetProps->heapBudget, VK_MAX_MEMORY_HEAPS);
+	mvkClear(budgetProps->heapUsage, VK_MAX_MEMORY_HEAPS);
+
+	// Main heap
+	VkDeviceSize mainUsage = std::max((VkDeviceSize)getCurrentAllocatedSize(), (VkDeviceSize)_allocatedHeapSizes[0]);
+#if MVK_IOS
+	// The working set on iOS is limited by the memory the OS makes available to the app.
+	VkDeviceSize mainBudget = mainUsage + (VkDeviceSize)mvkGetAvailableMemorySize();
+#else
+	VkDeviceSize mainBudget = (VkDeviceSize)getRecommendedMaxWorkingSetSize();
+#endif
+	mainBudget = std::min(mainBudget, _memoryProperties.memoryHeaps[0].size);
+	budgetProps->heapUsage[0] = mainUsage;
+	budgetProps->heapBudget[0] = std::max(mainBudget, mainUsage);
+
+	// Optional shared memory heap
+	if (_memoryProperties.memoryHeapCount > 1) {
+		VkDeviceSize sharedUsage = (VkDeviceSize)_allocatedHeapSizes[1];
+		VkDeviceSize sharedBudget = std::min(sharedUsage + (VkDeviceSize)mvkGetAvailableMemorySize(),
+											 _memoryProperties.memoryHeaps[1].size);
+		budgetProps->heapUsage[1] = sharedUsage;
+		budgetProps->heapBudget[1] = std::max(sharedBudget, sharedUsage);
+	}
+}
+
+void MVKPhysicalDevice::updateAllocatedMemorySize(uint32_t memoryTypeIndex, int64_t sizeDelta) {
+	if (memoryTypeIndex >= _memoryProperties.memoryTypeCount) { return; }
+
+	// Lazily allocated memory is never backed by heap storage.
+	if (mvkIsAnyFlagEnabled(_lazilyAllocatedMemoryTypes, 1U << memoryTypeIndex)) { return; }
+
+	uint32_t heapIdx = _memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+	_allocatedHeapSizes[heapIdx] += (uint64_t)sizeDelta;
+}
+
 
 #pragma mark Construction
 
@@ -837,15 +895,27 @@ MVKPhysicalDevice::MVKPhysicalDevice(MVKInstance* mvkInstance, id<MTLDevice> mtl
 	_mtlDevice([mtlDevice retain]),		// Set first
 	_mvkInstance(mvkInstance),
 	_supportedExtensions(this, true),
-	_pixelFormats(this) {				// Set after _mtlDevice
+	_pixelFormats(this),				// Set after _mtlDevice
+	_isInitialized(false) {}
 
-	initMetalFeatures();        		// Call first.
-	initFeatures();             		// Call second.
-	initProperties();           		// Call third.
-	initExtensions();
-	initMemoryProperties();
-	initExternalMemoryProperties();
-	logGPUInfo();
+// Queries the capabilities of the Metal device, the first time this instance is retrieved
+// from its Vulkan handle. This may be called from multiple threads at once, so it is locked.
+void MVKPhysicalDevice::initialize() {
+	lock_guard<mutex> lock(_initLock);
+	if (_isInitialized.load(memory_order_relaxed)) { return; }
+
+	@autoreleasepool {
+		_pixelFormats.initDeviceCapabilities();
+		initMetalFeatures();        		// Call first.
+		initFeatures();             		// Call second.
+		initProperties();           		// Call third.
+		initExtensions();
+		initMemoryProperties();
+		initExternalMemoryProperties();
+		logGPUInfo();
+	}
+
+	_isInitialized.store(true, memory_order_release);
 }
 
 // Initializes the Metal-specific physical device features of this instance.
@@ -922,6 +992,10 @@ void MVKPhysicalDevice::initMetalFeatures() {
 		_metalFeatures.arrayOfSamplers = true;
 	}
 
+	if (supportsMTLFeatureSet(iOS_GPUFamily3_v4)) {
+		_metalFeatures.indirectCommandBuffers = true;
+	}
+
 	if (supportsMTLFeatureSet(iOS_GPUFamily4_v1)) {
 		_metalFeatures.postDepthCoverage = true;
 	}
@@ -982,6 +1056,7 @@ void MVKPhysicalDevice::initMetalFeatures() {
 	if (supportsMTLFeatureSet(macOS_GPUFamily2_v1)) {
 		_metalFeatures.multisampleLayeredRendering = _metalFeatures.layeredRendering;
 		_metalFeatures.stencilFeedback = true;
+		_metalFeatures.indirectCommandBuffers = true;
 	}
 
 	if ( mvkOSVersionIsAtLeast(10.15) ) {
@@ -995,6 +1070,10 @@ void MVKPhysicalDevice::initMetalFeatures() {
 
 #endif
 
+    if ( [_mtlDevice respondsToSelector: @selector(argumentBuffersSupport)] ) {
+        _metalFeatures.argumentBuffers = _mtlDevice.argumentBuffersSupport >= MTLArgumentBuffersTier2;
+    }
+
     // Note the selector name, which is different from the property name.
     if ( [_mtlDevice respondsToSelector: @selector(areRasterOrderGroupsSupported)] ) {
         _metalFeatures.rasterOrderGroups = _mtlDevice.rasterOrderGroupsSupported;
@@ -1004,6 +1083,47 @@ void MVKPhysicalDevice::initMetalFeatures() {
         _metalFeatures.maxMTLBufferSize = _mtlDevice.maxBufferLength;
     }
 
+	_metalFeatures.peerCount = 1;
+#if MVK_MACOS
+	if ( [_mtlDevice respondsToSelector: @selector(peerGroupID)] && _mtlDevice.peerGroupID ) {
+		_metalFeatures.peerGroupID = _mtlDevice.peerGroupID;
+		_metalFeatures.peerIndex = _mtlDevice.peerIndex;
+		_metalFeatures.peerCount = _mtlDevice.peerCount;
+	}
+#endif
+
+#if MVK_XCODE_12
+	// Timestamp and pipeline statistics queries are sampled on the GPU
+	// when the GPU exposes the corresponding common counter sets.
+	if ( [_mtlDevice respondsToSelector: @selector(supportsCounterSampling:)] ) {
+		for (id<MTLCounterSet> mtlCounterSet in _mtlDevice.counterSets) {
+			if ( !_timestampMTLCounterSet && [mtlCounterSet.name isEqualToString: MTLCommonCounterSetTimestamp] ) {
+				_timestampMTLCounterSet = [mtlCounterSet retain];		// retained
+			}
+			if ( !_statisticMTLCounterSet && [mtlCounterSet.name isEqualToString: MTLCommonCounterSetStatistic] ) {
+				_statisticMTLCounterSet = [mtlCounterSet retain];		// retained
+			}
+		}
+	}
+	if (_timestampMTLCounterSet || _statisticMTLCounterSet) {
+		if ([_mtlDevice supportsCounterSampling: MTLCounterSamplingPointAtDrawBoundary]) {
+			mvkEnableFlags(_metalFeatures.counterSamplingPoints, MVK_COUNTER_SAMPLING_AT_DRAW);
+		}
+		if ([_mtlDevice supportsCounterSampling: MTLCounterSamplingPointAtDispatchBoundary]) {
+			mvkEnableFlags(_metalFeatures.counterSamplingPoints, MVK_COUNTER_SAMPLING_AT_DISPATCH);
+		}
+		if ([_mtlDevice supportsCounterSampling: MTLCounterSamplingPointAtBlitBoundary]) {
+			mvkEnableFlags(_metalFeatures.counterSamplingPoints, MVK_COUNTER_SAMPLING_AT_BLIT);
+		}
+		if ([_mtlDevice supportsCounterSampling: MTLCounterSamplingPointAtStageBoundary]) {
+			mvkEnableFlags(_metalFeatures.counterSamplingPoints, MVK_COUNTER_SAMPLING_AT_STAGE);
+		}
+	}
+	if (_timestampMTLCounterSet) {
+		[_mtlDevice sampleTimestamps: &_cpuTimestampBase gpuTimestamp: &_gpuTimestampBase];
+	}
+#endif
+
     for (uint32_t sc = VK_SAMPLE_COUNT_1_BIT; sc <= VK_SAMPLE_COUNT_64_BIT; sc <<= 1) {
         if ([_mtlDevice supportsTextureSampleCount: mvkSampleCountFromVkSampleCountFlagBits((VkSampleCountFlagBits)sc)]) {
             _metalFeatures.supportedSampleCounts |= sc;
@@ -1069,6 +1189,11 @@ void MVKPhysicalDevice::initFeatures() {
     _features.variableMultisampleRate = true;
     _features.inheritedQueries = true;
 
+	// Pipeline statistics queries must be sampled within render passes, compute work, or between encoders.
+	_features.pipelineStatisticsQuery = (_statisticMTLCounterSet &&
+										 mvkAreAllFlagsEnabled(_metalFeatures.counterSamplingPoints, MVK_COUNTER_SAMPLING_AT_DRAW | MVK_COUNTER_SAMPLING_AT_DISPATCH) &&
+										 mvkIsAnyFlagEnabled(_metalFeatures.counterSamplingPoints, MVK_COUNTER_SAMPLING_AT_BLIT | MVK_COUNTER_SAMPLING_AT_STAGE));
+
 	_features.shaderSampledImageArrayDynamicIndexing = _metalFeatures.arrayOfTextures;
 
     if (_metalFeatures.indirectDrawing && _metalFeatures.baseVertexInstanceDrawing) {
@@ -1162,7 +1287,7 @@ void MVKPhysicalDevice::initFeatures() {
 //    VkBool32    textureCompressionASTC_LDR;                   // done
 //    VkBool32    textureCompressionBC;                         // done
 //    VkBool32    occlusionQueryPrecise;                        // done
-//    VkBool32    pipelineStatisticsQuery;
+//    VkBool32    pipelineStatisticsQuery;                      // done
 //    VkBool32    vertexPipelineStoresAndAtomics;               // done
 //    VkBool32    fragmentStoresAndAtomics;                     // done
 //    VkBool32    shaderTessellationAndGeometryPointSize;       // done
@@ -1860,6 +1985,7 @@ void MVKPhysicalDevice::setMemoryType(uint32_t typeIndex, uint32_t heapIndex, Vk
 void MVKPhysicalDevice::initMemoryProperties() {
 
 	mvkClear(&_memoryProperties);	// Start with everything cleared
+	for (auto& allocSize : _allocatedHeapSizes) { allocSize = 0; }
 
 	// Main heap
 	uint32_t mainHeapIdx = 0;
@@ -1931,6 +2057,25 @@ bool MVKPhysicalDevice::getHasUnifiedMemory() {
 #endif
 }
 
+// The CPU timestamps sampled by Metal are in nanoseconds, so the ratio of elapsed CPU time to
+// elapsed GPU time since the device was created gives the length of each GPU timestamp tick.
+double MVKPhysicalDevice::sampleGPUTimestamp(uint64_t& gpuTimestamp) {
+	double gpuTimestampPeriod = 1.0;
+	gpuTimestamp = 0;
+#if MVK_XCODE_12
+	if (_timestampMTLCounterSet) {
+		MTLTimestamp cpuTS = 0;
+		MTLTimestamp gpuTS = 0;
+		[_mtlDevice sampleTimestamps: &cpuTS gpuTimestamp: &gpuTS];
+		if (gpuTS > _gpuTimestampBase && cpuTS > _cpuTimestampBase) {
+			gpuTimestampPeriod = (double)(cpuTS - _cpuTimestampBase) / (double)(gpuTS - _gpuTimestampBase);
+		}
+		gpuTimestamp = gpuTS;
+	}
+#endif
+	return gpuTimestampPeriod;
+}
+
 uint64_t MVKPhysicalDevice::getVRAMSize() {
 	if (getHasUnifiedMemory()) {
 		return mvkGetSystemMemorySize();
@@ -1983,6 +2128,11 @@ void MVKPhysicalDevice::initExternalMemoryProperties() {
 																  VK_EXTERNAL_MEMORY_FEATURE_DEDICATED_ONLY_BIT);
 	_mtlTextureExternalMemoryProperties.exportFromImportedHandleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_MTLTEXTURE_BIT_KHR;
 	_mtlTextureExternalMemoryProperties.compatibleHandleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_MTLTEXTURE_BIT_KHR;
+
+	// Host allocations, imported into buffers through VK_EXT_external_memory_host
+	_hostAllocationExternalMemoryProperties.externalMemoryFeatures = VK_EXTERNAL_MEMORY_FEATURE_IMPORTABLE_BIT;
+	_hostAllocationExternalMemoryProperties.exportFromImportedHandleTypes = 0;
+	_hostAllocationExternalMemoryProperties.compatibleHandleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
 }
 
 void MVKPhysicalDevice::initExtensions() {
@@ -1992,6 +2142,9 @@ void MVKPhysicalDevice::initExtensions() {
 	if (!_metalFeatures.rasterOrderGroups) {
 		pWritableExtns->vk_EXT_fragment_shader_interlock.enabled = false;
 	}
+	if (!_metalFeatures.events) {
+		pWritableExtns->vk_KHR_timeline_semaphore.enabled = false;
+	}
 	if (!_metalFeatures.postDepthCoverage) {
 		pWritableExtns->vk_EXT_post_depth_coverage.enabled = false;
 	}
@@ -2090,6 +2243,8 @@ void MVKPhysicalDevice::logGPUInfo() {
 
 MVKPhysicalDevice::~MVKPhysicalDevice() {
 	mvkDestroyContainerContents(_queueFamilies);
+	[_timestampMTLCounterSet release];
+	[_statisticMTLCounterSet release];
 	[_mtlDevice release];
 }
 
@@ -2195,14 +2350,18 @@ uint32_t MVKDevice::getVulkanMemoryTypeIndex(MTLStorageMode mtlStorageMode) {
     return 0;
 }
 
+// Only successfully configured resources are counted, both here and when destroyed.
 MVKBuffer* MVKDevice::createBuffer(const VkBufferCreateInfo* pCreateInfo,
 								   const VkAllocationCallbacks* pAllocator) {
-    return (MVKBuffer*)addResource(new MVKBuffer(this, pCreateInfo));
+	MVKBuffer* mvkBuff = new MVKBuffer(this, pCreateInfo);
+	if (mvkBuff->wasConfigurationSuccessful()) { updateResourceCount(_resourceStatistics.buffers, 1); }
+    return (MVKBuffer*)addResource(mvkBuff);
 }
 
 void MVKDevice::destroyBuffer(MVKBuffer* mvkBuff,
 							  const VkAllocationCallbacks* pAllocator) {
 	if (mvkBuff) {
+		if (mvkBuff->wasConfigurationSuccessful()) { updateResourceCount(_resourceStatistics.buffers, -1); }
 		removeResource(mvkBuff);
 		mvkBuff->destroy();
 	}
@@ -2231,15 +2390,17 @@ MVKImage* MVKDevice::createImage(const VkImageCreateInfo* pCreateInfo,
 			break;
 		}
 	}
-	if (swapchainInfo) {
-		return (MVKImage*)addResource(new MVKPeerSwapchainImage(this, pCreateInfo, (MVKSwapchain*)swapchainInfo->swapchain, uint32_t(-1)));
-	}
-	return (MVKImage*)addResource(new MVKImage(this, pCreateInfo));
+	MVKImage* mvkImg = (swapchainInfo
+						? new MVKPeerSwapchainImage(this, pCreateInfo, (MVKSwapchain*)swapchainInfo->swapchain, uint32_t(-1))
+						: new MVKImage(this, pCreateInfo));
+	if (mvkImg->wasConfigurationSuccessful()) { updateResourceCount(_resourceStatistics.images, 1); }
+	return (MVKImage*)addResource(mvkImg);
 }
 
 void MVKDevice::destroyImage(MVKImage* mvkImg,
 							 const VkAllocationCallbacks* pAllocator) {
 	if (mvkImg) {
+		if (mvkImg->wasConfigurationSuccessful()) { updateResourceCount(_resourceStatistics.images, -1); }
 		removeResource(mvkImg);
 		mvkImg->destroy();
 	}
@@ -2269,12 +2430,15 @@ MVKPresentableSwapchainImage* MVKDevice::createPresentableSwapchainImage(const V
 																		 MVKSwapchain* swapchain,
 																		 uint32_t swapchainIndex,
 																		 const VkAllocationCallbacks* pAllocator) {
-	return (MVKPresentableSwapchainImage*)addResource(new MVKPresentableSwapchainImage(this, pCreateInfo, swapchain, swapchainIndex));
+	auto* mvkImg = new MVKPresentableSwapchainImage(this, pCreateInfo, swapchain, swapchainIndex);
+	if (mvkImg->wasConfigurationSuccessful()) { updateResourceCount(_resourceStatistics.images, 1); }
+	return (MVKPresentableSwapchainImage*)addResource(mvkImg);
 }
 
 void MVKDevice::destroyPresentableSwapchainImage(MVKPresentableSwapchainImage* mvkImg,
 												 const VkAllocationCallbacks* pAllocator) {
 	if (mvkImg) {
+		if (mvkImg->wasConfigurationSuccessful()) { updateResourceCount(_resourceStatistics.images, -1); }
 		removeResource(mvkImg);
 		mvkImg->destroy();
 	}
@@ -2292,6 +2456,20 @@ void MVKDevice::destroyFence(MVKFence* mvkFence,
 
 MVKSemaphore* MVKDevice::createSemaphore(const VkSemaphoreCreateInfo* pCreateInfo,
 										 const VkAllocationCallbacks* pAllocator) {
+	for (const auto* next = (const VkBaseInStructure*)pCreateInfo->pNext; next; next = next->pNext) {
+		switch (next->sType) {
+			case VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR: {
+				auto* pTypeCreateInfo = (const VkSemaphoreTypeCreateInfoKHR*)next;
+				if (pTypeCreateInfo->semaphoreType == VK_SEMAPHORE_TYPE_TIMELINE_KHR) {
+					return new MVKTimelineSemaphore(this, pCreateInfo, pTypeCreateInfo);
+				}
+				break;
+			}
+			default:
+				break;
+		}
+	}
+
 	if (_useMTLFenceForSemaphores) {
 		return new MVKSemaphoreMTLFence(this, pCreateInfo);
 	} else if (_useMTLEventForSemaphores) {
@@ -2374,10 +2552,12 @@ VkResult MVKDevice::createPipelines(VkPipelineCache pipelineCache,
                                     const PipelineInfoType* pCreateInfos,
                                     const VkAllocationCallbacks* pAllocator,
                                     VkPipeline* pPipelines) {
-    VkResult rslt = VK_SUCCESS;
     MVKPipelineCache* mvkPLC = (MVKPipelineCache*)pipelineCache;
 
-    for (uint32_t plIdx = 0; plIdx < count; plIdx++) {
+    // Create the pipeline and if creation was successful, insert the new pipeline
+    // in the return array and add it to the pipeline cache (if the cache was specified).
+    // If creation was unsuccessful, insert NULL into the return array, and destroy the broken pipeline.
+    auto createPipeline = [&](uint32_t plIdx) {
         const PipelineInfoType* pCreateInfo = &pCreateInfos[plIdx];
 
         // See if this pipeline has a parent. This can come either directly
@@ -2390,21 +2570,48 @@ VkResult MVKDevice::createPipelines(VkPipelineCache pipelineCache,
             parentPL = vkParentPL ? (MVKPipeline*)vkParentPL : VK_NULL_HANDLE;
         }
 
-        // Create the pipeline and if creation was successful, insert the new pipeline
-        // in the return array and add it to the pipeline cache (if the cache was specified).
-        // If creation was unsuccessful, insert NULL into the return array, change the
-        // result code of this function, and destroy the broken pipeline.
         MVKPipeline* mvkPL = new PipelineType(this, mvkPLC, parentPL, pCreateInfo);
-        VkResult plRslt = mvkPL->getConfigurationResult();
-        if (plRslt == VK_SUCCESS) {
+        if (mvkPL->getConfigurationResult() == VK_SUCCESS) {
             pPipelines[plIdx] = (VkPipeline)mvkPL;
         } else {
-            rslt = plRslt;
             pPipelines[plIdx] = VK_NULL_HANDLE;
-            mvkPL->destroy();
+            return mvkPL;
+        }
+        return (MVKPipeline*)nullptr;
+    };
+
+    // A pipeline that derives from another pipeline in the same batch, via basePipelineIndex,
+    // must be created after its parent, so only create the pipelines in parallel if there are none.
+    bool canCreateInParallel = _useParallelPipelineCreation && count > 1;
+    for (uint32_t plIdx = 0; canCreateInParallel && plIdx < count; plIdx++) {
+        const PipelineInfoType* pCreateInfo = &pCreateInfos[plIdx];
+        if (mvkAreAllFlagsEnabled(pCreateInfo->flags, VK_PIPELINE_CREATE_DERIVATIVE_BIT) &&
+            !pCreateInfo->basePipelineHandle && pCreateInfo->basePipelineIndex >= 0) {
+            canCreateInParallel = false;
         }
     }
 
+    // Pipelines in a batch are created in parallel across the cores, by a concurrent dispatch. Each creation
+    // writes only to its own slots in the output arrays, and the results are then combined in batch order.
+    MVKVectorInline<MVKPipeline*, 8> brokenPLs;
+    brokenPLs.resize(count);
+    if (canCreateInParallel) {
+        MVKPipeline** pBrokenPLs = brokenPLs.data();
+        dispatch_apply(count, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t plIdx) {
+            @autoreleasepool { pBrokenPLs[plIdx] = createPipeline((uint32_t)plIdx); }
+        });
+    } else {
+        for (uint32_t plIdx = 0; plIdx < count; plIdx++) { brokenPLs[plIdx] = createPipeline(plIdx); }
+    }
+
+    // Change the result code of this function to that of the first broken pipeline, and destroy the broken pipelines.
+    VkResult rslt = VK_SUCCESS;
+    for (MVKPipeline* mvkPL : brokenPLs) {
+        if ( !mvkPL ) { continue; }
+        if (rslt == VK_SUCCESS) { rslt = mvkPL->getConfigurationResult(); }
+        mvkPL->destroy();
+    }
+
     return rslt;
 }
 
@@ -2431,12 +2638,17 @@ void MVKDevice::destroyPipeline(MVKPipeline* mvkPL,
 
 MVKSampler* MVKDevice::createSampler(const VkSamplerCreateInfo* pCreateInfo,
 									 const VkAllocationCallbacks* pAllocator) {
-	return new MVKSampler(this, pCreateInfo);
+	MVKSampler* mvkSamp = new MVKSampler(this, pCreateInfo);
+	if (mvkSamp->wasConfigurationSuccessful()) { updateResourceCount(_resourceStatistics.samplers, 1); }
+	return mvkSamp;
 }
 
 void MVKDevice::destroySampler(MVKSampler* mvkSamp,
 							   const VkAllocationCallbacks* pAllocator) {
-	if (mvkSamp) { mvkSamp->destroy(); }
+	if (mvkSamp) {
+		if (mvkSamp->wasConfigurationSuccessful()) { updateResourceCount(_resourceStatistics.samplers, -1); }
+		mvkSamp->destroy();
+	}
 }
 
 MVKDescriptorSetLayout* MVKDevice::createDescriptorSetLayout(const VkDescriptorSetLayoutCreateInfo* pCreateInfo,
@@ -2451,12 +2663,23 @@ void MVKDevice::destroyDescriptorSetLayout(MVKDescriptorSetLayout* mvkDSL,
 
 MVKDescriptorPool* MVKDevice::createDescriptorPool(const VkDescriptorPoolCreateInfo* pCreateInfo,
 												   const VkAllocationCallbacks* pAllocator) {
-	return new MVKDescriptorPool(this, pCreateInfo);
+	MVKDescriptorPool* mvkDP = new MVKDescriptorPool(this, pCreateInfo);
+	if (mvkDP->wasConfigurationSuccessful()) {
+		updateResourceCount(_resourceStatistics.descriptorPools, 1);
+		updateResourceCount(_resourceStatistics.descriptorSetCapacity, pCreateInfo->maxSets);
+	}
+	return mvkDP;
 }
 
 void MVKDevice::destroyDescriptorPool(MVKDescriptorPool* mvkDP,
 									  const VkAllocationCallbacks* pAllocator) {
-	if (mvkDP) { mvkDP->destroy(); }
+	if (mvkDP) {
+		if (mvkDP->wasConfigurationSuccessful()) {
+			updateResourceCount(_resourceStatistics.descriptorPools, -1);
+			updateResourceCount(_resourceStatistics.descriptorSetCapacity, -int64_t(mvkDP->getMaxSets()));
+		}
+		mvkDP->destroy();
+	}
 }
 
 MVKDescriptorUpdateTemplate* MVKDevice::createDescriptorUpdateTemplate(
@@ -2492,22 +2715,60 @@ void MVKDevice::destroyRenderPass(MVKRenderPass* mvkRP,
 
 MVKCommandPool* MVKDevice::createCommandPool(const VkCommandPoolCreateInfo* pCreateInfo,
 											const VkAllocationCallbacks* pAllocator) {
-	return new MVKCommandPool(this, pCreateInfo, _useCommandPooling);
+	MVKCommandPool* mvkCmdPool = new MVKCommandPool(this, pCreateInfo, _useCommandPooling);
+	{
+		lock_guard<mutex> lock(_rezStatsLock);
+		_commandPools.insert(mvkCmdPool);
+	}
+	updateResourceCount(_resourceStatistics.commandPools, 1);
+	return mvkCmdPool;
 }
 
 void MVKDevice::destroyCommandPool(MVKCommandPool* mvkCmdPool,
 								   const VkAllocationCallbacks* pAllocator) {
-	if (mvkCmdPool) { mvkCmdPool->destroy(); }
+	if (mvkCmdPool) {
+		{
+			lock_guard<mutex> lock(_rezStatsLock);
+			_commandPools.erase(mvkCmdPool);
+		}
+		updateResourceCount(_resourceStatistics.commandPools, -1);
+		mvkCmdPool->destroy();
+	}
 }
 
+// Only successful allocations are counted, because failed allocations are never freed.
 MVKDeviceMemory* MVKDevice::allocateMemory(const VkMemoryAllocateInfo* pAllocateInfo,
 										   const VkAllocationCallbacks* pAllocator) {
-	return new MVKDeviceMemory(this, pAllocateInfo, pAllocator);
+	MVKDeviceMemory* mvkDevMem = new MVKDeviceMemory(this, pAllocateInfo, pAllocator);
+	if (mvkDevMem->wasConfigurationSuccessful()) {
+		updateResourceCount(_resourceStatistics.deviceMemoryAllocations, 1);
+		updateMTLStorageModeByteCount(_resourceStatistics.deviceMemoryBytes, mvkDevMem->getMTLStorageMode(), mvkDevMem->getDeviceMemorySize());
+	}
+	return mvkDevMem;
 }
 
 void MVKDevice::freeMemory(MVKDeviceMemory* mvkDevMem,
 						   const VkAllocationCallbacks* pAllocator) {
-	if (mvkDevMem) { mvkDevMem->destroy(); }
+	if (mvkDevMem) {
+		updateResourceCount(_resourceStatistics.deviceMemoryAllocations, -1);
+		updateMTLStorageModeByteCount(_resourceStatistics.deviceMemoryBytes, mvkDevMem->getMTLStorageMode(), -int64_t(mvkDevMem->getDeviceMemorySize()));
+		mvkDevMem->destroy();
+	}
+}
+
+// Imported host memory is wrapped in a MTLBuffer without copying, which requires shared storage.
+VkResult MVKDevice::getMemoryHostPointerProperties(VkExternalMemoryHandleTypeFlagBits handleType,
+												   const void* pHostPointer,
+												   VkMemoryHostPointerPropertiesEXT* pMemHostPtrProps) {
+	if (handleType != VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT) {
+		return reportError(VK_ERROR_INVALID_EXTERNAL_HANDLE, "vkGetMemoryHostPointerPropertiesEXT(): Only external memory handle type VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT is supported.");
+	}
+	uintptr_t pageSize = mvkGetHostMemoryPageSize();
+	if (mvkAlignByteRef((uintptr_t)pHostPointer, pageSize) != (uintptr_t)pHostPointer) {
+		return reportError(VK_ERROR_INVALID_EXTERNAL_HANDLE, "vkGetMemoryHostPointerPropertiesEXT(): The host pointer %p must be aligned to VkPhysicalDeviceExternalMemoryHostPropertiesEXT::minImportedHostPointerAlignment (%lu bytes).", pHostPointer, (unsigned long)pageSize);
+	}
+	pMemHostPtrProps->memoryTypeBits = _physicalDevice->getHostCoherentMemoryTypes();
+	return VK_SUCCESS;
 }
 
 
@@ -2540,10 +2801,29 @@ void MVKDevice::applyMemoryBarrier(VkPipelineStageFlags srcStageMask,
 	}
 }
 
-void MVKDevice::updateActivityPerformance(MVKPerformanceTracker& activity,
-										  uint64_t startTime, uint64_t endTime) {
+// Returns the index of the log-scale histogram bucket holding the duration, in milliseconds.
+// The upper bound of bucket N is 2^(N/2) microseconds.
+static uint32_t mvkGetPerformanceHistogramBucket(double durationMS) {
+	double durationUS = durationMS * 1000.0;
+	if (durationUS <= 1.0) { return 0; }
+	return min((uint32_t)ceil(2.0 * log2(durationUS)), (uint32_t)kMVKPerformanceHistogramBucketCount - 1);
+}
+
+// Returns the upper bound of the histogram bucket holding the specified fraction of the activities,
+// limited to the maximum duration of the activity, in milliseconds.
+static double mvkGetPerformancePercentile(const MVKPerformanceHistogram* pHist, const MVKPerformanceTracker& activity, double fraction) {
+	if ( !pHist || !activity.count ) { return 0.0; }
 
-	double currInterval = mvkGetElapsedMilliseconds(startTime, endTime);
+	uint64_t rank = (uint64_t)ceil(fraction * activity.count);
+	uint64_t cumulativeCount = 0;
+	for (uint32_t bktIdx = 0; bktIdx < kMVKPerformanceHistogramBucketCount; bktIdx++) {
+		cumulativeCount += pHist->bucketCounts[bktIdx];
+		if (cumulativeCount >= rank) { return min(pow(2.0, bktIdx / 2.0) / 1000.0, activity.maximumDuration); }
+	}
+	return activity.maximumDuration;
+}
+
+void MVKDevice::updateActivityPerformance(MVKPerformanceTracker& activity, double currInterval) {
 	lock_guard<mutex> lock(_perfLock);
 
 	activity.latestDuration = currInterval;
@@ -2553,10 +2833,25 @@ void MVKDevice::updateActivityPerformance(MVKPerformanceTracker& activity,
 	activity.maximumDuration = max(currInterval, activity.maximumDuration);
 	double totalInterval = (activity.averageDuration * activity.count++) + currInterval;
 	activity.averageDuration = totalInterval / activity.count;
+
+	MVKPerformanceHistogram* pHist = getActivityPerformanceHistogram(activity, _performanceStatistics);
+	if (pHist) { pHist->bucketCounts[mvkGetPerformanceHistogramBucket(currInterval)]++; }
+}
+
+// Returns the histogram of the activity, identified by the offset of the activity within the statistics,
+// or null if the activity is not part of the statistics, or the histogram capacity was exceeded.
+// The histogram index of each tracker is fixed when the device is created, so the lookup is lock-free.
+MVKPerformanceHistogram* MVKDevice::getActivityPerformanceHistogram(MVKPerformanceTracker& activity, MVKPerformanceStatistics& perfStats) {
+	uintptr_t trackerOffset = (uintptr_t)&activity - (uintptr_t)&perfStats;
+	if (trackerOffset >= sizeof(MVKPerformanceStatistics)) { return nullptr; }
+
+	uint32_t histIdx = _performanceHistogramIndexes.get(uint32_t(trackerOffset), kMVKPerformanceHistogramCapacity);
+	return (histIdx < perfStats.histogramCount) ? &perfStats.histograms[histIdx] : nullptr;
 }
 
 void MVKDevice::logActivityPerformance(MVKPerformanceTracker& activity, MVKPerformanceStatistics& perfStats, bool isInline) {
-	MVKLogInfo("%s%s%s avg: %.3f ms, latest: %.3f ms, min: %.3f ms, max: %.3f ms, count: %d",
+	MVKPerformanceHistogram* pHist = getActivityPerformanceHistogram(activity, perfStats);
+	MVKLogInfo("%s%s%s avg: %.3f ms, latest: %.3f ms, min: %.3f ms, max: %.3f ms, p50: %.3f ms, p95: %.3f ms, p99: %.3f ms, count: %d",
 			   (isInline ? "" : "  "),
 			   getActivityPerformanceDescription(activity, perfStats),
 			   (isInline ? " performance" : ""),
@@ -2564,6 +2859,9 @@ void MVKDevice::logActivityPerformance(MVKPerformanceTracker& activity, MVKPerfo
 			   activity.latestDuration,
 			   activity.minimumDuration,
 			   activity.maximumDuration,
+			   mvkGetPerformancePercentile(pHist, activity, 0.50),
+			   mvkGetPerformancePercentile(pHist, activity, 0.95),
+			   mvkGetPerformancePercentile(pHist, activity, 0.99),
 			   activity.count);
 }
 
@@ -2578,6 +2876,10 @@ void MVKDevice::logPerformanceSummary() {
 	logActivityPerformance(perfStats.queue.nextCAMetalDrawable, perfStats);
 	logActivityPerformance(perfStats.queue.mtlCommandBufferCompletion, perfStats);
 	logActivityPerformance(perfStats.queue.mtlQueueAccess, perfStats);
+	logActivityPerformance(perfStats.queue.queueSubmit, perfStats);
+	logActivityPerformance(perfStats.queue.mtlCommandBufferFlowWait, perfStats);
+	MVKLogInfo("  Active MTLCommandBuffers: %d, maximum active on a queue: %d",
+			   perfStats.queue.activeMTLCommandBufferCount, perfStats.queue.maxActiveMTLCommandBufferCount);
 	logActivityPerformance(perfStats.shaderCompilation.hashShaderCode, perfStats);
 	logActivityPerformance(perfStats.shaderCompilation.spirvToMSL, perfStats);
 	logActivityPerformance(perfStats.shaderCompilation.mslCompile, perfStats);
@@ -2585,10 +2887,211 @@ void MVKDevice::logPerformanceSummary() {
 	logActivityPerformance(perfStats.shaderCompilation.shaderLibraryFromCache, perfStats);
 	logActivityPerformance(perfStats.shaderCompilation.functionRetrieval, perfStats);
 	logActivityPerformance(perfStats.shaderCompilation.functionSpecialization, perfStats);
+	logActivityPerformance(perfStats.shaderCompilation.functionFromCache, perfStats);
 	logActivityPerformance(perfStats.shaderCompilation.pipelineCompile, perfStats);
 	logActivityPerformance(perfStats.pipelineCache.sizePipelineCache, perfStats);
 	logActivityPerformance(perfStats.pipelineCache.readPipelineCache, perfStats);
 	logActivityPerformance(perfStats.pipelineCache.writePipelineCache, perfStats);
+	logActivityPerformance(perfStats.commandEncoding.renderPass, perfStats);
+	logActivityPerformance(perfStats.commandEncoding.draw, perfStats);
+	logActivityPerformance(perfStats.commandEncoding.dispatch, perfStats);
+	logActivityPerformance(perfStats.commandEncoding.transfer, perfStats);
+	logActivityPerformance(perfStats.commandEncoding.synchronization, perfStats);
+	logActivityPerformance(perfStats.commandEncoding.bindPipeline, perfStats);
+	logActivityPerformance(perfStats.commandEncoding.state, perfStats);
+	logActivityPerformance(perfStats.commandEncoding.query, perfStats);
+	logActivityPerformance(perfStats.commandEncoding.debugMarker, perfStats);
+	logActivityPerformance(perfStats.descriptors.bindDescriptorSets, perfStats);
+	logActivityPerformance(perfStats.descriptors.updateDescriptorSets, perfStats);
+	logActivityPerformance(perfStats.gpu.mtlCommandBufferExecution, perfStats);
+	logActivityPerformance(perfStats.gpu.mtlCommandBufferScheduling, perfStats);
+	logActivityPerformance(perfStats.gpu.mtlCommandBufferQueueLatency, perfStats);
+	logActivityPerformance(perfStats.gpu.frameGPUBusyTime, perfStats);
+}
+
+// Appends the performance and resource statistics of this device to the performance report file,
+// as a single line of JSON, so that successive runs can be compared to detect regressions.
+void MVKDevice::writePerformanceReport() {
+	if (_performanceReportFile.empty() || !_pMVKConfig->performanceTracking) { return; }
+
+	@autoreleasepool {
+		NSString* path = [@(_performanceReportFile.c_str()) stringByExpandingTildeInPath];
+		FILE* pFile = fopen(path.UTF8String, "a");
+		if ( !pFile ) {
+			MVKLogError("Could not open performance report file %s.", path.UTF8String);
+			return;
+		}
+
+		MVKPerformanceStatistics perfStats;
+		getPerformanceStatistics(&perfStats);
+		MVKResourceStatistics rezStats;
+		getResourceStatistics(&rezStats);
+
+		fprintf(pFile, "{\"moltenVKVersion\":\"%d.%d.%d\",\"gpu\":\"%s\",\"timestamp\":%.0f,\"activities\":{",
+				MVK_VERSION_MAJOR, MVK_VERSION_MINOR, MVK_VERSION_PATCH,
+				mvkGetJSONEscapedString(_pProperties->deviceName).c_str(), [NSDate date].timeIntervalSince1970);
+
+		const char* sep = "";
+#define MVK_WRITE_ACTIVITY(grp, act)  \
+		do {  \
+			auto& activity = perfStats.grp.act;  \
+			MVKPerformanceHistogram* pHist = getActivityPerformanceHistogram(activity, perfStats);  \
+			fprintf(pFile, "%s\"" #grp "." #act "\":{\"count\":%u,\"avg\":%.6f,\"latest\":%.6f,\"min\":%.6f,\"max\":%.6f,\"p50\":%.6f,\"p95\":%.6f,\"p99\":%.6f}",  \
+					sep, activity.count, activity.averageDuration, activity.latestDuration,  \
+					activity.minimumDuration, activity.maximumDuration,  \
+					pHist ? pHist->p50Duration : 0.0, pHist ? pHist->p95Duration : 0.0, pHist ? pHist->p99Duration : 0.0);  \
+			sep = ",";  \
+		} while(false)
+
+		MVK_WRITE_ACTIVITY(queue, frameInterval);
+		MVK_WRITE_ACTIVITY(queue, nextCAMetalDrawable);
+		MVK_WRITE_ACTIVITY(queue, mtlCommandBufferCompletion);
+		MVK_WRITE_ACTIVITY(queue, mtlQueueAccess);
+		MVK_WRITE_ACTIVITY(queue, queueSubmit);
+		MVK_WRITE_ACTIVITY(queue, mtlCommandBufferFlowWait);
+		MVK_WRITE_ACTIVITY(shaderCompilation, hashShaderCode);
+		MVK_WRITE_ACTIVITY(shaderCompilation, spirvToMSL);
+		MVK_WRITE_ACTIVITY(shaderCompilation, mslCompile);
+		MVK_WRITE_ACTIVITY(shaderCompilation, mslLoad);
+		MVK_WRITE_ACTIVITY(shaderCompilation, shaderLibraryFromCache);
+		MVK_WRITE_ACTIVITY(shaderCompilation, functionRetrieval);
+		MVK_WRITE_ACTIVITY(shaderCompilation, functionSpecialization);
+		MVK_WRITE_ACTIVITY(shaderCompilation, functionFromCache);
+		MVK_WRITE_ACTIVITY(shaderCompilation, pipelineCompile);
+		MVK_WRITE_ACTIVITY(pipelineCache, sizePipelineCache);
+		MVK_WRITE_ACTIVITY(pipelineCache, readPipelineCache);
+		MVK_WRITE_ACTIVITY(pipelineCache, writePipelineCache);
+		MVK_WRITE_ACTIVITY(commandEncoding, renderPass);
+		MVK_WRITE_ACTIVITY(commandEncoding, draw);
+		MVK_WRITE_ACTIVITY(commandEncoding, dispatch);
+		MVK_WRITE_ACTIVITY(commandEncoding, transfer);
+		MVK_WRITE_ACTIVITY(commandEncoding, synchronization);
+		MVK_WRITE_ACTIVITY(commandEncoding, bindPipeline);
+		MVK_WRITE_ACTIVITY(commandEncoding, state);
+		MVK_WRITE_ACTIVITY(commandEncoding, query);
+		MVK_WRITE_ACTIVITY(commandEncoding, debugMarker);
+		MVK_WRITE_ACTIVITY(descriptors, bindDescriptorSets);
+		MVK_WRITE_ACTIVITY(descriptors, updateDescriptorSets);
+		MVK_WRITE_ACTIVITY(gpu, mtlCommandBufferExecution);
+		MVK_WRITE_ACTIVITY(gpu, mtlCommandBufferScheduling);
+		MVK_WRITE_ACTIVITY(gpu, mtlCommandBufferQueueLatency);
+		MVK_WRITE_ACTIVITY(gpu, frameGPUBusyTime);
+#undef MVK_WRITE_ACTIVITY
+
+		fprintf(pFile, "},\"resources\":{");
+		sep = "";
+#define MVK_WRITE_RESOURCE_COUNT(rez)  \
+		do {  \
+			fprintf(pFile, "%s\"" #rez "\":{\"current\":%llu,\"highWaterMark\":%llu}",  \
+					sep, (unsigned long long)rezStats.rez.current, (unsigned long long)rezStats.rez.highWaterMark);  \
+			sep = ",";  \
+		} while(false)
+
+		MVK_WRITE_RESOURCE_COUNT(buffers);
+		MVK_WRITE_RESOURCE_COUNT(images);
+		MVK_WRITE_RESOURCE_COUNT(deviceMemoryAllocations);
+		MVK_WRITE_RESOURCE_COUNT(samplers);
+		MVK_WRITE_RESOURCE_COUNT(commandPools);
+		MVK_WRITE_RESOURCE_COUNT(commandBuffers);
+		MVK_WRITE_RESOURCE_COUNT(pooledCommands);
+		MVK_WRITE_RESOURCE_COUNT(residentPooledCommands);
+		MVK_WRITE_RESOURCE_COUNT(descriptorPools);
+		MVK_WRITE_RESOURCE_COUNT(descriptorSets);
+		MVK_WRITE_RESOURCE_COUNT(descriptorSetCapacity);
+		MVK_WRITE_RESOURCE_COUNT(deviceMemoryBytes.shared);
+		MVK_WRITE_RESOURCE_COUNT(deviceMemoryBytes.managed);
+		MVK_WRITE_RESOURCE_COUNT(deviceMemoryBytes.privateStorage);
+		MVK_WRITE_RESOURCE_COUNT(deviceMemoryBytes.memoryless);
+		MVK_WRITE_RESOURCE_COUNT(imageTextureBytes.shared);
+		MVK_WRITE_RESOURCE_COUNT(imageTextureBytes.managed);
+		MVK_WRITE_RESOURCE_COUNT(imageTextureBytes.privateStorage);
+		MVK_WRITE_RESOURCE_COUNT(imageTextureBytes.memoryless);
+		MVK_WRITE_RESOURCE_COUNT(internalMTLBufferBytes);
+#undef MVK_WRITE_RESOURCE_COUNT
+
+		fprintf(pFile, "}}\n");
+		fclose(pFile);
+	}
+}
+
+double MVKPipelineCompileRecord::getTotalDuration() const {
+	double totalDuration = pipelineCompile;
+	for (auto& stageRec : stages) {
+		totalDuration += stageRec.spirvToMSL + stageRec.mslCompile + stageRec.functionSpecialization;
+	}
+	return totalDuration;
+}
+
+// Returns a single-line JSON description of the pipeline compilation record.
+static string mvkGetPipelineCompileRecordJSON(const MVKPipelineCompileRecord& compileRecord) {
+	char buff[512];
+	snprintf(buff, sizeof(buff), "{\"pipelineType\":\"%s\",\"total\":%.3f,\"pipelineCompile\":%.3f,\"stages\":[",
+			 compileRecord.pipelineType.c_str(), compileRecord.getTotalDuration(), compileRecord.pipelineCompile);
+	string json = buff;
+	const char* sep = "";
+	for (auto& stageRec : compileRecord.stages) {
+		// The entry point name is provided by the app, so it is escaped, and appended without limiting its length.
+		snprintf(buff, sizeof(buff), "%s{\"shaderModuleHash\":\"%016llx\",\"stage\":\"%s\",\"entryPoint\":\"",
+				 sep, (unsigned long long)stageRec.shaderModuleHash, stageRec.stage.c_str());
+		json += buff;
+		json += mvkGetJSONEscapedString(stageRec.entryPoint.c_str());
+		snprintf(buff, sizeof(buff), "\",\"configHash\":\"%016llx\",\"spirvToMSL\":%.3f,\"mslCompile\":%.3f,\"functionSpecialization\":%.3f}",
+				 (unsigned long long)stageRec.configHash, stageRec.spirvToMSL, stageRec.mslCompile, stageRec.functionSpecialization);
+		json += buff;
+		sep = ",";
+	}
+	json += "]}";
+	return json;
+}
+
+// The number of slowest pipeline compilations summarized in the slow compile report file.
+static const size_t kMVKSlowCompileReportCount = 32;
+
+void MVKDevice::addPipelineCompileRecord(const MVKPipelineCompileRecord& compileRecord) {
+	if ( !isReportingSlowCompiles() || compileRecord.getTotalDuration() < _slowCompileThreshold ) { return; }
+
+	MVKLogInfo("Slow pipeline compilation: %s", mvkGetPipelineCompileRecordJSON(compileRecord).c_str());
+
+	if (_slowCompileReportFile.empty()) { return; }
+
+	// Retain only the slowest compilations, trimming the list whenever it doubles in size.
+	lock_guard<mutex> lock(_slowCompileLock);
+	_slowCompileRecords.push_back(compileRecord);
+	if (_slowCompileRecords.size() >= kMVKSlowCompileReportCount * 2) {
+		std::sort(_slowCompileRecords.begin(), _slowCompileRecords.end(),
+				  [](const MVKPipelineCompileRecord& a, const MVKPipelineCompileRecord& b) { return a.getTotalDuration() > b.getTotalDuration(); });
+		_slowCompileRecords.resize(kMVKSlowCompileReportCount);
+	}
+}
+
+// Appends the slowest pipeline compilations of this device to the slow compile report file,
+// as a single line of JSON, identifying the shaders that most need offline precompilation.
+void MVKDevice::writeSlowCompileReport() {
+	lock_guard<mutex> lock(_slowCompileLock);
+
+	if (_slowCompileReportFile.empty() || _slowCompileRecords.empty()) { return; }
+
+	@autoreleasepool {
+		NSString* path = [@(_slowCompileReportFile.c_str()) stringByExpandingTildeInPath];
+		FILE* pFile = fopen(path.UTF8String, "a");
+		if ( !pFile ) {
+			MVKLogError("Could not open slow compile report file %s.", path.UTF8String);
+			return;
+		}
+
+		std::sort(_slowCompileRecords.begin(), _slowCompileRecords.end(),
+				  [](const MVKPipelineCompileRecord& a, const MVKPipelineCompileRecord& b) { return a.getTotalDuration() > b.getTotalDuration(); });
+		size_t recCnt = min(_slowCompileRecords.size(), kMVKSlowCompileReportCount);
+
+		fprintf(pFile, "{\"moltenVKVersion\":\"%d.%d.%d\",\"gpu\":\"%s\",\"timestamp\":%.0f,\"thresholdMS\":%.3f,\"slowestCompiles\":[",
+				MVK_VERSION_MAJOR, MVK_VERSION_MINOR, MVK_VERSION_PATCH,
+				mvkGetJSONEscapedString(_pProperties->deviceName).c_str(), [NSDate date].timeIntervalSince1970, _slowCompileThreshold);
+		for (size_t recIdx = 0; recIdx < recCnt; recIdx++) {
+			fprintf(pFile, "%s%s", (recIdx ? "," : ""), mvkGetPipelineCompileRecordJSON(_slowCompileRecords[recIdx]).c_str());
+		}
+		fprintf(pFile, "]}\n");
+		fclose(pFile);
+	}
 }
 
 const char* MVKDevice::getActivityPerformanceDescription(MVKPerformanceTracker& activity, MVKPerformanceStatistics& perfStats) {
@@ -2599,6 +3102,7 @@ const char* MVKDevice::getActivityPerformanceDescription(MVKPerformanceTracker&
 	if (&activity == &perfStats.shaderCompilation.shaderLibraryFromCache) { return "Retrieve shader library from the cache"; }
 	if (&activity == &perfStats.shaderCompilation.functionRetrieval) { return "Retrieve a MTLFunction from a MTLLibrary"; }
 	if (&activity == &perfStats.shaderCompilation.functionSpecialization) { return "Specialize a retrieved MTLFunction"; }
+	if (&activity == &perfStats.shaderCompilation.functionFromCache) { return "Retrieve a previously resolved MTLFunction from the cache"; }
 	if (&activity == &perfStats.shaderCompilation.pipelineCompile) { return "Compile MTLFunctions into a pipeline"; }
 	if (&activity == &perfStats.pipelineCache.sizePipelineCache) { return "Calculate cache size required to write MSL to pipeline cache"; }
 	if (&activity == &perfStats.pipelineCache.readPipelineCache) { return "Read MSL from pipeline cache"; }
@@ -2607,13 +3111,91 @@ const char* MVKDevice::getActivityPerformanceDescription(MVKPerformanceTracker&
 	if (&activity == &perfStats.queue.mtlCommandBufferCompletion) { return "Complete MTLCommandBuffer"; }
 	if (&activity == &perfStats.queue.nextCAMetalDrawable) { return "Retrieve a CAMetalDrawable from CAMetalLayer"; }
 	if (&activity == &perfStats.queue.frameInterval) { return "Frame interval"; }
+	if (&activity == &perfStats.queue.mtlCommandBufferFlowWait) { return "Wait for an active MTLCommandBuffer to complete"; }
+	if (&activity == &perfStats.queue.queueSubmit) { return "Submit to a queue in vkQueueSubmit"; }
+	if (&activity == &perfStats.commandEncoding.renderPass) { return "Encode a render pass command"; }
+	if (&activity == &perfStats.commandEncoding.draw) { return "Encode a draw command"; }
+	if (&activity == &perfStats.commandEncoding.dispatch) { return "Encode a dispatch command"; }
+	if (&activity == &perfStats.commandEncoding.transfer) { return "Encode a transfer command"; }
+	if (&activity == &perfStats.commandEncoding.synchronization) { return "Encode a synchronization command"; }
+	if (&activity == &perfStats.commandEncoding.bindPipeline) { return "Encode a pipeline binding command"; }
+	if (&activity == &perfStats.commandEncoding.state) { return "Encode a state setting command"; }
+	if (&activity == &perfStats.commandEncoding.query) { return "Encode a query command"; }
+	if (&activity == &perfStats.commandEncoding.debugMarker) { return "Encode a debug marker command"; }
+	if (&activity == &perfStats.descriptors.bindDescriptorSets) { return "Encode a descriptor set binding command"; }
+	if (&activity == &perfStats.descriptors.updateDescriptorSets) { return "Update descriptor sets"; }
+	if (&activity == &perfStats.gpu.mtlCommandBufferExecution) { return "Execute MTLCommandBuffer on GPU"; }
+	if (&activity == &perfStats.gpu.mtlCommandBufferScheduling) { return "Schedule MTLCommandBuffer on CPU"; }
+	if (&activity == &perfStats.gpu.mtlCommandBufferQueueLatency) { return "Wait for GPU to start scheduled MTLCommandBuffer"; }
+	if (&activity == &perfStats.gpu.frameGPUBusyTime) { return "GPU busy time per frame"; }
 	return "Unknown performance activity";
 }
 
+void MVKDevice::updateActiveMTLCommandBufferCount(int32_t delta, uint32_t queueActiveCount) {
+	lock_guard<mutex> lock(_perfLock);
+
+	auto& qPerf = _performanceStatistics.queue;
+	qPerf.activeMTLCommandBufferCount += delta;
+	qPerf.maxActiveMTLCommandBufferCount = max(qPerf.maxActiveMTLCommandBufferCount, queueActiveCount);
+}
+
+void MVKDevice::updateResourceCount(MVKResourceCount& rezCount, int64_t delta) {
+	lock_guard<mutex> lock(_rezStatsLock);
+
+	rezCount.current += delta;
+	rezCount.highWaterMark = max(rezCount.highWaterMark, rezCount.current);
+}
+
+void MVKDevice::updateMTLStorageModeByteCount(MVKStorageModeByteCounts& byteCounts, MTLStorageMode mtlStorageMode, int64_t delta) {
+	switch (mtlStorageMode) {
+		case MTLStorageModeShared:		updateResourceCount(byteCounts.shared, delta); break;
+#if MVK_MACOS
+		case MTLStorageModeManaged:		updateResourceCount(byteCounts.managed, delta); break;
+#endif
+#if MVK_IOS
+		case MTLStorageModeMemoryless:	updateResourceCount(byteCounts.memoryless, delta); break;
+#endif
+		case MTLStorageModePrivate:
+		default:						updateResourceCount(byteCounts.privateStorage, delta); break;
+	}
+}
+
+// The counts of pooled commands are sampled from the command pools, because the command
+// type pools are not thread-safe, and cannot report each change as it occurs. Each command
+// type pool maintains its counts atomically, so they can be read here from any thread.
+void MVKDevice::getResourceStatistics(MVKResourceStatistics* pRezStats) {
+	lock_guard<mutex> lock(_rezStatsLock);
+
+	uint64_t aliveCmdCnt = 0;
+	uint64_t residentCmdCnt = 0;
+	for (auto* mvkCmdPool : _commandPools) {
+		MVKObjectPoolCounts cmdCounts = mvkCmdPool->getCommandCounts();
+		aliveCmdCnt += cmdCounts.alive;
+		residentCmdCnt += cmdCounts.resident;
+	}
+	auto& pooledCmds = _resourceStatistics.pooledCommands;
+	pooledCmds.current = aliveCmdCnt;
+	pooledCmds.highWaterMark = max(pooledCmds.highWaterMark, aliveCmdCnt);
+	auto& residentCmds = _resourceStatistics.residentPooledCommands;
+	residentCmds.current = residentCmdCnt;
+	residentCmds.highWaterMark = max(residentCmds.highWaterMark, residentCmdCnt);
+
+	if (pRezStats) { *pRezStats = _resourceStatistics; }
+}
+
 void MVKDevice::getPerformanceStatistics(MVKPerformanceStatistics* pPerf) {
     lock_guard<mutex> lock(_perfLock);
 
-    if (pPerf) { *pPerf = _performanceStatistics; }
+    if ( !pPerf ) { return; }
+
+    *pPerf = _performanceStatistics;
+    for (uint32_t histIdx = 0; histIdx < pPerf->histogramCount; histIdx++) {
+        auto& hist = pPerf->histograms[histIdx];
+        auto& activity = *(MVKPerformanceTracker*)((uintptr_t)pPerf + hist.trackerOffset);
+        hist.p50Duration = mvkGetPerformancePercentile(&hist, activity, 0.50);
+        hist.p95Duration = mvkGetPerformancePercentile(&hist, activity, 0.95);
+        hist.p99Duration = mvkGetPerformancePercentile(&hist, activity, 0.99);
+    }
 }
 
 VkResult MVKDevice::invalidateMappedMemoryRanges(uint32_t memRangeCount, const VkMappedMemoryRange* pMemRanges) {
@@ -2656,26 +3238,84 @@ id<MTLBuffer> MVKDevice::getGlobalVisibilityResultMTLBuffer() {
     return _globalVisibilityResultMTLBuffer;
 }
 
-uint32_t MVKDevice::expandVisibilityResultMTLBuffer(uint32_t queryCount) {
+uint32_t MVKDevice::reserveVisibilityResultMTLBufferSlice(uint32_t queryCount) {
     lock_guard<mutex> lock(_vizLock);
 
+    uint32_t maxQueryCount = uint32_t(_pMetalFeatures->maxQueryBufferSize / kMVKQuerySlotSizeInBytes);
+    if ( !_globalVisibilityResultMTLBuffer ) {
+        NSUInteger mtlBuffLen = mvkAlignByteCount(_pMetalFeatures->maxQueryBufferSize, _pMetalFeatures->mtlBufferAlignment);
+        MTLResourceOptions mtlBuffOpts = MTLResourceStorageModeShared | MTLResourceCPUCacheModeDefaultCache;
+        _globalVisibilityResultMTLBuffer = [getMTLDevice() newBufferWithLength: mtlBuffLen options: mtlBuffOpts];     // retained
+    }
+
+    // Find the first gap between the reserved slices that is large enough to hold the queries.
+    uint32_t firstQuery = 0;
+    auto iter = _globalVisibilityQuerySlices.begin();
+    while (iter != _globalVisibilityQuerySlices.end() && iter->first - firstQuery < queryCount) {
+        firstQuery = iter->first + iter->second;
+        iter++;
+    }
+
     // Ensure we don't overflow the maximum number of queries
-    _globalVisibilityQueryCount += queryCount;
-    VkDeviceSize reqBuffLen = (VkDeviceSize)_globalVisibilityQueryCount * kMVKQuerySlotSizeInBytes;
-    VkDeviceSize maxBuffLen = _pMetalFeatures->maxQueryBufferSize;
-    VkDeviceSize newBuffLen = min(reqBuffLen, maxBuffLen);
-    _globalVisibilityQueryCount = uint32_t(newBuffLen / kMVKQuerySlotSizeInBytes);
-
-    if (reqBuffLen > maxBuffLen) {
-        reportError(VK_ERROR_OUT_OF_DEVICE_MEMORY, "vkCreateQueryPool(): A maximum of %d total queries are available on this device in its current configuration. See the API notes for the MVKConfiguration.supportLargeQueryPools configuration parameter for more info.", _globalVisibilityQueryCount);
+    if (firstQuery + queryCount > maxQueryCount) {
+        reportError(VK_ERROR_OUT_OF_DEVICE_MEMORY, "vkCreateQueryPool(): A maximum of %d total queries are available on this device in its current configuration. See the API notes for the MVKConfiguration.supportLargeQueryPools configuration parameter for more info.", maxQueryCount);
+        queryCount = (firstQuery < maxQueryCount) ? maxQueryCount - firstQuery : 0;
     }
 
-    NSUInteger mtlBuffLen = mvkAlignByteCount(newBuffLen, _pMetalFeatures->mtlBufferAlignment);
-    MTLResourceOptions mtlBuffOpts = MTLResourceStorageModeShared | MTLResourceCPUCacheModeDefaultCache;
-    [_globalVisibilityResultMTLBuffer release];
-    _globalVisibilityResultMTLBuffer = [getMTLDevice() newBufferWithLength: mtlBuffLen options: mtlBuffOpts];     // retained
+    _globalVisibilityQuerySlices.insert(iter, make_pair(firstQuery, queryCount));
+    return firstQuery;
+}
+
+void MVKDevice::releaseVisibilityResultMTLBufferSlice(uint32_t firstQuery) {
+    lock_guard<mutex> lock(_vizLock);
 
-    return _globalVisibilityQueryCount - queryCount;     // Might be lower than requested if an overflow occurred
+    for (auto iter = _globalVisibilityQuerySlices.begin(); iter != _globalVisibilityQuerySlices.end(); iter++) {
+        if (iter->first == firstQuery) {
+            _globalVisibilityQuerySlices.erase(iter);
+            return;
+        }
+    }
+}
+
+
+void MVKDevice::addDirtyDeviceMemory(MVKDeviceMemory* mvkMem) {
+	lock_guard<mutex> lock(_dirtyMemLock);
+	_dirtyDeviceMemories.push_back(mvkMem);
+}
+
+void MVKDevice::removeDirtyDeviceMemory(MVKDeviceMemory* mvkMem) {
+	lock_guard<mutex> lock(_dirtyMemLock);
+	mvkRemoveFirstOccurance(_dirtyDeviceMemories, mvkMem);
+}
+
+id<MTLSharedEventListener> MVKDevice::getMTLSharedEventListener() {
+	if (_mtlSharedEventListener) { return _mtlSharedEventListener; }
+
+	// Lock and check again in case another thread has created the listener.
+	lock_guard<mutex> lock(_sharedEventListenerLock);
+	if ( !_mtlSharedEventListener ) {
+		_mtlSharedEventListener = [[MTLSharedEventListener alloc] init];	// retained
+	}
+	return _mtlSharedEventListener;
+}
+
+MTLResourceOptions MVKDevice::getMTLResourceHazardTrackingOptions() {
+	return _useFenceHazardTracking ? MTLResourceHazardTrackingModeUntracked : 0;
+}
+
+id<MTLFence> MVKDevice::getHazardTrackingMTLFence(id<MTLCommandQueue> mtlCmdQueue, uint32_t fenceIndex) {
+	lock_guard<mutex> lock(_hazardTrackingFenceLock);
+	auto& mtlFences = _hazardTrackingMTLFences[mtlCmdQueue];
+	while (mtlFences.size() <= fenceIndex) {
+		mtlFences.push_back([getMTLDevice() newFence]);		// retained
+	}
+	return mtlFences[fenceIndex];
+}
+
+void MVKDevice::flushDirtyDeviceMemory() {
+	lock_guard<mutex> lock(_dirtyMemLock);
+	for (auto* mvkMem : _dirtyDeviceMemories) { mvkMem->flushDirtyPages(); }
+	_dirtyDeviceMemories.clear();
 }
 
 
@@ -2690,6 +3330,7 @@ MVKDevice::MVKDevice(MVKPhysicalDevice* physicalDevice, const VkDeviceCreateInfo
 	_enabledVarPtrFeatures(),
 	_enabledInterlockFeatures(),
 	_enabledHostQryResetFeatures(),
+	_enabledTimelineSem4Features(),
 	_enabledScalarLayoutFeatures(),
 	_enabledTexelBuffAlignFeatures(),
 	_enabledVtxAttrDivFeatures(),
@@ -2698,16 +3339,19 @@ MVKDevice::MVKDevice(MVKPhysicalDevice* physicalDevice, const VkDeviceCreateInfo
 {
 
 	initPerformanceTracking();
+	mvkClear(&_resourceStatistics);
 	initPhysicalDevice(physicalDevice, pCreateInfo);
 	enableFeatures(pCreateInfo);
 	enableExtensions(pCreateInfo);
 
     _globalVisibilityResultMTLBuffer = nil;
-    _globalVisibilityQueryCount = 0;
 
 	initMTLCompileOptions();	// Before command resource factory
 
 	_commandResourceFactory = new MVKCommandResourceFactory(this);
+	_commandEncodingCache = new MVKCommandEncodingCache(this);
+	_texelBufferTextureCache = new MVKTexelBufferTextureCache(this);
+	_deviceMemoryAllocator = new MVKDeviceMemoryAllocator(this);
 
 	initQueues(pCreateInfo);
 
@@ -2752,28 +3396,76 @@ void MVKDevice::initPerformanceTracking() {
 #   	define MVK_CONFIG_PERFORMANCE_LOGGING_INLINE    0
 #	endif
 	MVK_SET_FROM_ENV_OR_BUILD_BOOL(_logActivityPerformanceInline, MVK_CONFIG_PERFORMANCE_LOGGING_INLINE);
+	MVK_SET_FROM_ENV_OR_BUILD_STRING(_performanceReportFile, MVK_CONFIG_PERFORMANCE_REPORT_FILE);
+
+#	ifndef MVK_CONFIG_PERFORMANCE_HUD
+#   	define MVK_CONFIG_PERFORMANCE_HUD    0
+#	endif
+	MVK_SET_FROM_ENV_OR_BUILD_BOOL(_displayPerformanceHUD, MVK_CONFIG_PERFORMANCE_HUD);
+
+	// Compilations of pipelines whose shader conversion, compilation, and pipeline compilation
+	// together take longer than this number of milliseconds are logged, and optionally reported.
+#	ifndef MVK_CONFIG_SLOW_COMPILE_THRESHOLD
+#   	define MVK_CONFIG_SLOW_COMPILE_THRESHOLD    0
+#	endif
+	int32_t slowCompileThreshold;
+	MVK_SET_FROM_ENV_OR_BUILD_INT32(slowCompileThreshold, MVK_CONFIG_SLOW_COMPILE_THRESHOLD);
+	_slowCompileThreshold = max(slowCompileThreshold, 0);
 
-	MVKPerformanceTracker initPerf;
-    initPerf.count = 0;
-    initPerf.averageDuration = 0.0;
-    initPerf.minimumDuration = 0.0;
-    initPerf.maximumDuration = 0.0;
-
-	_performanceStatistics.shaderCompilation.hashShaderCode = initPerf;
-    _performanceStatistics.shaderCompilation.spirvToMSL = initPerf;
-    _performanceStatistics.shaderCompilation.mslCompile = initPerf;
-    _performanceStatistics.shaderCompilation.mslLoad = initPerf;
-	_performanceStatistics.shaderCompilation.shaderLibraryFromCache = initPerf;
-    _performanceStatistics.shaderCompilation.functionRetrieval = initPerf;
-    _performanceStatistics.shaderCompilation.functionSpecialization = initPerf;
-    _performanceStatistics.shaderCompilation.pipelineCompile = initPerf;
-	_performanceStatistics.pipelineCache.sizePipelineCache = initPerf;
-	_performanceStatistics.pipelineCache.writePipelineCache = initPerf;
-	_performanceStatistics.pipelineCache.readPipelineCache = initPerf;
-	_performanceStatistics.queue.mtlQueueAccess = initPerf;
-	_performanceStatistics.queue.mtlCommandBufferCompletion = initPerf;
-	_performanceStatistics.queue.nextCAMetalDrawable = initPerf;
-	_performanceStatistics.queue.frameInterval = initPerf;
+#	ifndef MVK_CONFIG_SLOW_COMPILE_REPORT_FILE
+#   	define MVK_CONFIG_SLOW_COMPILE_REPORT_FILE    ""
+#	endif
+	MVK_SET_FROM_ENV_OR_BUILD_STRING(_slowCompileReportFile, MVK_CONFIG_SLOW_COMPILE_REPORT_FILE);
+
+	mvkClear(&_performanceStatistics);
+
+	initPerformanceTracker(_performanceStatistics.shaderCompilation.hashShaderCode);
+	initPerformanceTracker(_performanceStatistics.shaderCompilation.spirvToMSL);
+	initPerformanceTracker(_performanceStatistics.shaderCompilation.mslCompile);
+	initPerformanceTracker(_performanceStatistics.shaderCompilation.mslLoad);
+	initPerformanceTracker(_performanceStatistics.shaderCompilation.shaderLibraryFromCache);
+	initPerformanceTracker(_performanceStatistics.shaderCompilation.functionRetrieval);
+	initPerformanceTracker(_performanceStatistics.shaderCompilation.functionSpecialization);
+	initPerformanceTracker(_performanceStatistics.shaderCompilation.pipelineCompile);
+	initPerformanceTracker(_performanceStatistics.shaderCompilation.glslToSPRIV);
+	initPerformanceTracker(_performanceStatistics.shaderCompilation.functionFromCache);
+	initPerformanceTracker(_performanceStatistics.pipelineCache.sizePipelineCache);
+	initPerformanceTracker(_performanceStatistics.pipelineCache.writePipelineCache);
+	initPerformanceTracker(_performanceStatistics.pipelineCache.readPipelineCache);
+	initPerformanceTracker(_performanceStatistics.queue.mtlQueueAccess);
+	initPerformanceTracker(_performanceStatistics.queue.mtlCommandBufferCompletion);
+	initPerformanceTracker(_performanceStatistics.queue.nextCAMetalDrawable);
+	initPerformanceTracker(_performanceStatistics.queue.frameInterval);
+	initPerformanceTracker(_performanceStatistics.queue.mtlCommandBufferFlowWait);
+	initPerformanceTracker(_performanceStatistics.queue.queueSubmit);
+	initPerformanceTracker(_performanceStatistics.commandEncoding.renderPass);
+	initPerformanceTracker(_performanceStatistics.commandEncoding.draw);
+	initPerformanceTracker(_performanceStatistics.commandEncoding.dispatch);
+	initPerformanceTracker(_performanceStatistics.commandEncoding.transfer);
+	initPerformanceTracker(_performanceStatistics.commandEncoding.synchronization);
+	initPerformanceTracker(_performanceStatistics.commandEncoding.bindPipeline);
+	initPerformanceTracker(_performanceStatistics.commandEncoding.state);
+	initPerformanceTracker(_performanceStatistics.commandEncoding.query);
+	initPerformanceTracker(_performanceStatistics.commandEncoding.debugMarker);
+	initPerformanceTracker(_performanceStatistics.descriptors.bindDescriptorSets);
+	initPerformanceTracker(_performanceStatistics.descriptors.updateDescriptorSets);
+	initPerformanceTracker(_performanceStatistics.gpu.mtlCommandBufferExecution);
+	initPerformanceTracker(_performanceStatistics.gpu.mtlCommandBufferScheduling);
+	initPerformanceTracker(_performanceStatistics.gpu.mtlCommandBufferQueueLatency);
+	initPerformanceTracker(_performanceStatistics.gpu.frameGPUBusyTime);
+}
+
+// Clears the tracker, and assigns it the next available histogram, identified by the offset of the tracker.
+void MVKDevice::initPerformanceTracker(MVKPerformanceTracker& activity) {
+	mvkClear(&activity);
+
+	uint32_t& histCnt = _performanceStatistics.histogramCount;
+	if (histCnt < kMVKPerformanceHistogramCapacity) {
+		auto& hist = _performanceStatistics.histograms[histCnt];
+		mvkClear(&hist);
+		hist.trackerOffset = uint32_t((uintptr_t)&activity - (uintptr_t)&_performanceStatistics);
+		_performanceHistogramIndexes[hist.trackerOffset] = histCnt++;
+	}
 }
 
 void MVKDevice::initPhysicalDevice(MVKPhysicalDevice* physicalDevice, const VkDeviceCreateInfo* pCreateInfo) {
@@ -2825,6 +3517,183 @@ void MVKDevice::initPhysicalDevice(MVKPhysicalDevice* physicalDevice, const VkDe
 #	endif
 	MVK_SET_FROM_ENV_OR_BUILD_BOOL(_useCommandPooling, MVK_CONFIG_USE_COMMAND_POOLING);
 
+#	ifndef MVK_CONFIG_USE_COMMAND_ARENA
+#   	define MVK_CONFIG_USE_COMMAND_ARENA    0
+#	endif
+	MVK_SET_FROM_ENV_OR_BUILD_BOOL(_useCommandArena, MVK_CONFIG_USE_COMMAND_ARENA);
+
+#	ifndef MVK_CONFIG_USE_TRANSIENT_BUFFER_RING
+#   	define MVK_CONFIG_USE_TRANSIENT_BUFFER_RING    0
+#	endif
+	MVK_SET_FROM_ENV_OR_BUILD_BOOL(_useTransientMTLBufferRing, MVK_CONFIG_USE_TRANSIENT_BUFFER_RING);
+
+	// Indicates whether draw commands in reusable command buffers should be replayed from
+	// a MTLIndirectCommandBuffer. Only available if MTLIndirectCommandBuffers are supported.
+#	ifndef MVK_CONFIG_REPLAY_REUSABLE_COMMAND_BUFFERS
+#   	define MVK_CONFIG_REPLAY_REUSABLE_COMMAND_BUFFERS    0
+#	endif
+	_useIndirectCommandBufferReplay = false;
+	if (_pMetalFeatures->indirectCommandBuffers) {
+		MVK_SET_FROM_ENV_OR_BUILD_BOOL(_useIndirectCommandBufferReplay, MVK_CONFIG_REPLAY_REUSABLE_COMMAND_BUFFERS);
+	}
+
+	// Indicates whether draw commands in secondary command buffers should be encoded into a
+	// MTLIndirectCommandBuffer when recording ends. Only available if MTLIndirectCommandBuffers are supported.
+#	ifndef MVK_CONFIG_PREENCODE_SECONDARY_COMMAND_BUFFERS
+#   	define MVK_CONFIG_PREENCODE_SECONDARY_COMMAND_BUFFERS    0
+#	endif
+	_preencodeSecondaryCommandBuffers = false;
+	if (_pMetalFeatures->indirectCommandBuffers) {
+		MVK_SET_FROM_ENV_OR_BUILD_BOOL(_preencodeSecondaryCommandBuffers, MVK_CONFIG_PREENCODE_SECONDARY_COMMAND_BUFFERS);
+	}
+
+#	ifndef MVK_CONFIG_PARALLEL_SUBMIT_ENCODING
+#   	define MVK_CONFIG_PARALLEL_SUBMIT_ENCODING    0
+#	endif
+	MVK_SET_FROM_ENV_OR_BUILD_BOOL(_useParallelSubmitEncoding, MVK_CONFIG_PARALLEL_SUBMIT_ENCODING);
+
+	// Indicates whether compatible consecutive subpasses should be merged into a single Metal render
+	// pass, reading their input attachments through framebuffer fetch. Only available on iOS.
+#	ifndef MVK_CONFIG_MERGE_SUBPASSES
+#   	define MVK_CONFIG_MERGE_SUBPASSES    1
+#	endif
+	_useSubpassMerging = false;
+#if MVK_IOS
+	MVK_SET_FROM_ENV_OR_BUILD_BOOL(_useSubpassMerging, MVK_CONFIG_MERGE_SUBPASSES);
+#endif
+
+	// Indicates whether indirect draws with more than one draw should be encoded into a
+	// MTLIndirectCommandBuffer by a compute shader, and executed with a single Metal command.
+	// Only available if MTLIndirectCommandBuffers are supported.
+#	ifndef MVK_CONFIG_MULTI_DRAW_INDIRECT_ON_GPU
+#   	define MVK_CONFIG_MULTI_DRAW_INDIRECT_ON_GPU    1
+#	endif
+	_useGPUMultiDrawIndirect = false;
+	if (_pMetalFeatures->indirectCommandBuffers) {
+		MVK_SET_FROM_ENV_OR_BUILD_BOOL(_useGPUMultiDrawIndirect, MVK_CONFIG_MULTI_DRAW_INDIRECT_ON_GPU);
+	}
+
+	// Indicates whether the Metal pipeline states of a pipeline should be compiled in the background,
+	// allowing vkCreateGraphicsPipelines() and vkCreateComputePipelines() to return immediately.
+#	ifndef MVK_CONFIG_ASYNC_PIPELINE_COMPILATION
+#   	define MVK_CONFIG_ASYNC_PIPELINE_COMPILATION    0
+#	endif
+	MVK_SET_FROM_ENV_OR_BUILD_BOOL(_useAsyncPipelineCompilation, MVK_CONFIG_ASYNC_PIPELINE_COMPILATION);
+
+	// Indicates whether the pipelines in a single call to vkCreateGraphicsPipelines()
+	// or vkCreateComputePipelines() should be created in parallel.
+#	ifndef MVK_CONFIG_PARALLEL_PIPELINE_CREATION
+#   	define MVK_CONFIG_PARALLEL_PIPELINE_CREATION    1
+#	endif
+	MVK_SET_FROM_ENV_OR_BUILD_BOOL(_useParallelPipelineCreation, MVK_CONFIG_PARALLEL_PIPELINE_CREATION);
+
+	// Indicates whether large batches of writes in a single call to vkUpdateDescriptorSets()
+	// that target more than one descriptor set should be performed in parallel.
+#	ifndef MVK_CONFIG_PARALLEL_DESCRIPTOR_SET_UPDATES
+#   	define MVK_CONFIG_PARALLEL_DESCRIPTOR_SET_UPDATES    1
+#	endif
+	MVK_SET_FROM_ENV_OR_BUILD_BOOL(_useParallelDescriptorSetUpdates, MVK_CONFIG_PARALLEL_DESCRIPTOR_SET_UPDATES);
+
+	// Indicates whether descriptors should retain the Vulkan objects written to them,
+	// or rely on the app keeping them alive while the descriptor set is in use.
+#	ifndef MVK_CONFIG_RETAIN_DESCRIPTOR_RESOURCES
+#   	define MVK_CONFIG_RETAIN_DESCRIPTOR_RESOURCES    1
+#	endif
+	MVK_SET_FROM_ENV_OR_BUILD_BOOL(_retainDescriptorResources, MVK_CONFIG_RETAIN_DESCRIPTOR_RESOURCES);
+
+	// Indicates whether render pass attachments that need not be loaded or stored, based on the
+	// other commands in the command buffer, should be identified when the command buffer ends.
+#	ifndef MVK_CONFIG_INFER_LOAD_STORE_ACTIONS
+#   	define MVK_CONFIG_INFER_LOAD_STORE_ACTIONS    0
+#	endif
+	MVK_SET_FROM_ENV_OR_BUILD_BOOL(_inferLoadStoreActions, MVK_CONFIG_INFER_LOAD_STORE_ACTIONS);
+
+	// The filter used to upscale swapchain images that were rendered at less than their full
+	// extent, as set by vkSetSwapchainImageRenderExtentMVK(). Zero disables upscaling.
+#	ifndef MVK_CONFIG_SWAPCHAIN_UPSCALE_FILTER
+#   	define MVK_CONFIG_SWAPCHAIN_UPSCALE_FILTER    0
+#	endif
+	int32_t swapchainUpscaleFilter;
+	MVK_SET_FROM_ENV_OR_BUILD_INT32(swapchainUpscaleFilter, MVK_CONFIG_SWAPCHAIN_UPSCALE_FILTER);
+	_swapchainUpscaleFilter = mvkClamp(swapchainUpscaleFilter, 0, 2);
+
+	// Indicates whether pipeline caches should record the shader libraries used by the pipelines
+	// bound by the app, and compile them in the background when the cache data is next loaded.
+#	ifndef MVK_CONFIG_PREWARM_PIPELINES
+#   	define MVK_CONFIG_PREWARM_PIPELINES    0
+#	endif
+	MVK_SET_FROM_ENV_OR_BUILD_BOOL(_prewarmPipelines, MVK_CONFIG_PREWARM_PIPELINES);
+
+	// Indicates whether the contents of descriptor sets should be encoded into Metal argument
+	// buffers. Only available if Tier 2 Metal argument buffers are supported.
+#	ifndef MVK_CONFIG_USE_METAL_ARGUMENT_BUFFERS
+#   	define MVK_CONFIG_USE_METAL_ARGUMENT_BUFFERS    0
+#	endif
+	_useMetalArgumentBuffers = false;
+	if (_pMetalFeatures->argumentBuffers) {
+		MVK_SET_FROM_ENV_OR_BUILD_BOOL(_useMetalArgumentBuffers, MVK_CONFIG_USE_METAL_ARGUMENT_BUFFERS);
+	}
+
+	// Indicates whether immutable samplers whose state can be expressed in MSL
+	// should be hardcoded into shaders as constexpr samplers.
+#	ifndef MVK_CONFIG_USE_CONSTEXPR_IMMUTABLE_SAMPLERS
+#   	define MVK_CONFIG_USE_CONSTEXPR_IMMUTABLE_SAMPLERS    1
+#	endif
+	MVK_SET_FROM_ENV_OR_BUILD_BOOL(_useConstExprImmutableSamplers, MVK_CONFIG_USE_CONSTEXPR_IMMUTABLE_SAMPLERS);
+
+	// Indicates whether small device memory allocations should be
+	// placed within larger Metal heaps or buffers shared between them.
+#	ifndef MVK_CONFIG_SUBALLOCATE_DEVICE_MEMORY
+#   	define MVK_CONFIG_SUBALLOCATE_DEVICE_MEMORY    1
+#	endif
+	MVK_SET_FROM_ENV_OR_BUILD_BOOL(_subAllocateDeviceMemory, MVK_CONFIG_SUBALLOCATE_DEVICE_MEMORY);
+
+	// Indicates whether ranges of non-coherent memory flushed by the app should be tracked
+	// per page and coalesced, and synced to the device only when a queue submission executes.
+#	ifndef MVK_CONFIG_TRACK_DIRTY_MAPPED_MEMORY
+#   	define MVK_CONFIG_TRACK_DIRTY_MAPPED_MEMORY    0
+#	endif
+	MVK_SET_FROM_ENV_OR_BUILD_BOOL(_trackDirtyMappedMemory, MVK_CONFIG_TRACK_DIRTY_MAPPED_MEMORY);
+
+	// Indicates whether swapchains should acquire the CAMetalDrawable of each
+	// acquired swapchain image on a background thread, ahead of its first use.
+#	ifndef MVK_CONFIG_PREFETCH_DRAWABLES
+#   	define MVK_CONFIG_PREFETCH_DRAWABLES    0
+#	endif
+	MVK_SET_FROM_ENV_OR_BUILD_BOOL(_prefetchDrawables, MVK_CONFIG_PREFETCH_DRAWABLES);
+
+	// Indicates whether the compute dispatches of the app should be encoded into concurrent
+	// Metal compute encoders, with Metal memory barriers only where the app records barriers.
+#	ifndef MVK_CONFIG_CONCURRENT_COMPUTE_DISPATCH
+#   	define MVK_CONFIG_CONCURRENT_COMPUTE_DISPATCH    0
+#	endif
+	_useConcurrentComputeDispatch = false;
+	if (mvkOSVersionIsAtLeast(MVK_MTLEVENT_MIN_OS)) {
+		MVK_SET_FROM_ENV_OR_BUILD_BOOL(_useConcurrentComputeDispatch, MVK_CONFIG_CONCURRENT_COMPUTE_DISPATCH);
+	}
+
+	// Indicates whether Metal hazard tracking of app resources should be disabled, and the
+	// hazards between Metal encoders tracked using MTLFences, derived from the app barriers.
+#	ifndef MVK_CONFIG_FENCE_HAZARD_TRACKING
+#   	define MVK_CONFIG_FENCE_HAZARD_TRACKING    0
+#	endif
+	_useFenceHazardTracking = false;
+	if (_pMetalFeatures->fences) {
+		MVK_SET_FROM_ENV_OR_BUILD_BOOL(_useFenceHazardTracking, MVK_CONFIG_FENCE_HAZARD_TRACKING);
+	}
+
+	// The number of commands, and the time in microseconds, after which a MTLCommandBuffer of
+	// a queue submission may be committed early, so the GPU can start while encoding continues.
+#	ifndef MVK_CONFIG_EARLY_COMMIT_COMMAND_COUNT
+#   	define MVK_CONFIG_EARLY_COMMIT_COMMAND_COUNT    0
+#	endif
+	MVK_SET_FROM_ENV_OR_BUILD_INT32(_earlyCommitCommandCount, MVK_CONFIG_EARLY_COMMIT_COMMAND_COUNT);
+
+#	ifndef MVK_CONFIG_EARLY_COMMIT_INTERVAL
+#   	define MVK_CONFIG_EARLY_COMMIT_INTERVAL    0
+#	endif
+	MVK_SET_FROM_ENV_OR_BUILD_INT32(_earlyCommitInterval, MVK_CONFIG_EARLY_COMMIT_INTERVAL);
+
 #if MVK_MACOS
 	// If we have selected a high-power GPU and want to force the window system
 	// to use it, force the window system to use a high-power GPU by calling the
@@ -2851,6 +3720,7 @@ void MVKDevice::enableFeatures(const VkDeviceCreateInfo* pCreateInfo) {
 	mvkClear(&_enabledVarPtrFeatures);
 	mvkClear(&_enabledInterlockFeatures);
 	mvkClear(&_enabledHostQryResetFeatures);
+	mvkClear(&_enabledTimelineSem4Features);
 	mvkClear(&_enabledScalarLayoutFeatures);
 	mvkClear(&_enabledTexelBuffAlignFeatures);
 	mvkClear(&_enabledVtxAttrDivFeatures);
@@ -2873,9 +3743,13 @@ void MVKDevice::enableFeatures(const VkDeviceCreateInfo* pCreateInfo) {
 	pdScalarLayoutFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SCALAR_BLOCK_LAYOUT_FEATURES_EXT;
 	pdScalarLayoutFeatures.pNext = &pdTexelBuffAlignFeatures;
 
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR pdTimelineSem4Features;
+	pdTimelineSem4Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+	pdTimelineSem4Features.pNext = &pdScalarLayoutFeatures;
+
 	VkPhysicalDeviceHostQueryResetFeaturesEXT pdHostQryResetFeatures;
 	pdHostQryResetFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES_EXT;
-	pdHostQryResetFeatures.pNext = &pdScalarLayoutFeatures;
+	pdHostQryResetFeatures.pNext = &pdTimelineSem4Features;
 
 	VkPhysicalDeviceFragmentShaderInterlockFeaturesEXT pdInterlockFeatures;
 	pdInterlockFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FRAGMENT_SHADER_INTERLOCK_FEATURES_EXT;
@@ -2972,6 +3846,13 @@ void MVKDevice::enableFeatures(const VkDeviceCreateInfo* pCreateInfo) {
 							   &pdHostQryResetFeatures.hostQueryReset, 1);
 				break;
 			}
+			case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR: {
+				auto* requestedFeatures = (VkPhysicalDeviceTimelineSemaphoreFeaturesKHR*)next;
+				enableFeatures(&_enabledTimelineSem4Features.timelineSemaphore,
+							   &requestedFeatures->timelineSemaphore,
+							   &pdTimelineSem4Features.timelineSemaphore, 1);
+				break;
+			}
 			case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SCALAR_BLOCK_LAYOUT_FEATURES_EXT: {
 				auto* requestedFeatures = (VkPhysicalDeviceScalarBlockLayoutFeaturesEXT*)next;
 				enableFeatures(&_enabledScalarLayoutFeatures.scalarBlockLayout,
@@ -3052,13 +3933,23 @@ void MVKDevice::initMTLCompileOptions() {
 }
 
 MVKDevice::~MVKDevice() {
+	writePerformanceReport();
+	writeSlowCompileReport();
+
 	for (auto& queues : _queuesByQueueFamilyIndex) {
 		mvkDestroyContainerContents(queues);
 	}
+	_commandEncodingCache->destroy();
+	_texelBufferTextureCache->destroy();
 	_commandResourceFactory->destroy();
+	_deviceMemoryAllocator->destroy();
 
 	[_mtlCompileOptions release];
     [_globalVisibilityResultMTLBuffer release];
+	[_mtlSharedEventListener release];
+	for (auto& queueFences : _hazardTrackingMTLFences) {
+		for (id<MTLFence> mtlFence : queueFences.second) { [mtlFence release]; }
+	}
 
 	if (getInstance()->_autoGPUCaptureScope == MVK_CONFIG_AUTO_GPU_CAPTURE_SCOPE_DEVICE) {
 		[[MTLCaptureManager sharedCaptureManager] stopCapture];
@@ -20,12 +20,14 @@
 
 #include "MVKDevice.h"
 #include "MVKVector.h"
+#include <vector>
 #include <mutex>
 
 #import <Metal/Metal.h>
 
 class MVKBuffer;
 class MVKImage;
+class MVKDeviceMemoryBlock;
 
 // TODO: These are inoperable placeholders until VK_KHR_external_memory_metal defines them properly
 static const VkExternalMemoryHandleTypeFlagBits VK_EXTERNAL_MEMORY_HANDLE_TYPE_MTLBUFFER_BIT_KHR = VK_EXTERNAL_MEMORY_HANDLE_TYPE_FLAG_BITS_MAX_ENUM;
@@ -60,8 +62,14 @@ public:
     /** Returns whether this is a dedicated allocation. */
     inline bool isDedicatedAllocation() { return _isDedicated; }
 
-    /** Returns the memory already committed by this instance. */
-    inline VkDeviceSize getDeviceMemoryCommitment() { return _allocationSize; }
+	/** Returns the size of this memory allocation, in bytes. */
+	inline VkDeviceSize getDeviceMemorySize() { return _allocationSize; }
+
+	/**
+	 * Returns the memory already committed by this instance. Lazily allocated memory is not
+	 * committed, unless an image bound to it has fallen back to private storage.
+	 */
+	VkDeviceSize getDeviceMemoryCommitment();
 
 	/**
 	 * Returns the host memory address of this memory, or NULL if the memory
@@ -102,15 +110,33 @@ public:
 							bool evenIfCoherent = false,
 							MVKMTLBlitEncoder* pBlitEnc = nullptr);
 
+	/**
+	 * If this memory is tracking the pages flushed by the app, syncs the coalesced
+	 * dirty pages to the device, and clears the dirty pages.
+	 */
+	void flushDirtyPages();
+
 
 #pragma mark Metal
 
 	/** Returns the Metal buffer underlying this memory allocation. */
 	inline id<MTLBuffer> getMTLBuffer() { return _mtlBuffer; }
 
+	/**
+	 * Returns the offset at which the contents of this memory allocation start within the
+	 * Metal buffer. This is non-zero if this memory is sub-allocated from a larger block.
+	 */
+	inline NSUInteger getMTLBufferOffset() { return _mtlBufferOffset; }
+
 	/** Returns the Metal heap underlying this memory allocation. */
 	inline id<MTLHeap> getMTLHeap() { return _mtlHeap; }
 
+	/**
+	 * Returns the offset at which the contents of this memory allocation start within the
+	 * Metal heap. This is non-zero if this memory is sub-allocated from a larger block.
+	 */
+	inline NSUInteger getMTLHeapOffset() { return _mtlHeapOffset; }
+
 	/** Returns the Metal storage mode used by this memory allocation. */
 	inline MTLStorageMode getMTLStorageMode() { return _mtlStorageMode; }
 
@@ -118,7 +144,9 @@ public:
 	inline MTLCPUCacheMode getMTLCPUCacheMode() { return _mtlCPUCacheMode; }
 
 	/** Returns the Metal reource options used by this memory allocation. */
-	inline MTLResourceOptions getMTLResourceOptions() { return mvkMTLResourceOptions(_mtlStorageMode, _mtlCPUCacheMode); }
+	inline MTLResourceOptions getMTLResourceOptions() {
+		return mvkMTLResourceOptions(_mtlStorageMode, _mtlCPUCacheMode) | _device->getMTLResourceHazardTrackingOptions();
+	}
 
 
 #pragma mark Construction
@@ -140,12 +168,18 @@ protected:
 	void removeBuffer(MVKBuffer* mvkBuff);
 	VkResult addImage(MVKImage* mvkImg);
 	void removeImage(MVKImage* mvkImg);
+	bool hasOverlappingResource(MVKResource* mvkRez);
 	bool ensureMTLHeap();
 	bool ensureMTLBuffer();
 	bool ensureHostMemory();
 	void freeHostMemory();
 	MVKResource* getDedicatedResource();
 	void initExternalMemory(VkExternalMemoryHandleTypeFlags handleTypes);
+	void importHostPointer(const VkImportMemoryHostPointerInfoEXT* pImportInfo);
+	bool subAllocate(uint32_t memoryTypeIndex);
+	void syncToDevice(VkDeviceSize offset, VkDeviceSize size);
+	void markDirtyPages(VkDeviceSize offset, VkDeviceSize size);
+	void syncDirtyPages();
 
 	MVKVectorInline<MVKBuffer*, 4> _buffers;
 	MVKVectorInline<MVKImage*, 4> _images;
@@ -155,11 +189,125 @@ protected:
 	VkDeviceSize _mapSize = 0;
 	id<MTLBuffer> _mtlBuffer = nil;
 	id<MTLHeap> _mtlHeap = nil;
+	MVKDeviceMemoryBlock* _memoryBlock = nullptr;
+	VkDeviceSize _memoryBlockOffset = 0;
+	NSUInteger _mtlBufferOffset = 0;
+	NSUInteger _mtlHeapOffset = 0;
+	uint32_t _memoryTypeIndex = 0;
+	std::vector<uint64_t> _dirtyPages;
+	std::mutex _dirtyPageLock;
 	void* _pMemory = nullptr;
 	void* _pHostMemory = nullptr;
 	bool _isMapped = false;
 	bool _isDedicated = false;
+	bool _isTrackingDirtyPages = false;
+	bool _isRegisteredDirty = false;
+	MTLStorageMode _mtlStorageMode;
+	MTLCPUCacheMode _mtlCPUCacheMode;
+};
+
+
+#pragma mark -
+#pragma mark MVKDeviceMemoryBlock
+
+/**
+ * A large Metal placement heap or Metal buffer, within which many small VkDeviceMemory
+ * allocations of a single memory type are placed, each at its own offset.
+ * Access to the free ranges of this block is guarded by the MVKDeviceMemoryAllocator.
+ */
+class MVKDeviceMemoryBlock : public MVKBaseDeviceObject {
+
+public:
+
+	/** Returns the Vulkan API opaque object controlling this object. */
+	MVKVulkanAPIObject* getVulkanAPIObject() override { return _device->getVulkanAPIObject(); };
+
+	/** Returns the Metal heap of this block, or nil if this block is backed only by a Metal buffer. */
+	inline id<MTLHeap> getMTLHeap() { return _mtlHeap; }
+
+	/**
+	 * Returns a Metal buffer covering this entire block. If this block is backed by a Metal heap,
+	 * the Metal buffer is created lazily, and overlays the heap. Returns nil on failure.
+	 */
+	id<MTLBuffer> getMTLBuffer();
+
+	/**
+	 * Reserves a range of the specified size within this block, and returns its offset in pOffset.
+	 * Returns false if this block does not contain a free range large enough.
+	 */
+	bool allocate(VkDeviceSize size, VkDeviceSize* pOffset);
+
+	/** Returns a range previously reserved with allocate() to this block. */
+	void free(VkDeviceSize offset, VkDeviceSize size);
+
+	/** Returns whether none of this block is currently allocated. */
+	inline bool isEmpty() { return _freeRanges.size() == 1 && _freeRanges[0].size == _size; }
+
+	/** Returns whether this block was successfully created. */
+	inline bool isValid() { return _mtlHeap || _mtlBuffer; }
+
+	MVKDeviceMemoryBlock(MVKDevice* device, uint32_t memoryTypeIndex, VkDeviceSize size,
+						 MTLStorageMode mtlStorageMode, MTLCPUCacheMode mtlCPUCacheMode);
+
+	~MVKDeviceMemoryBlock() override;
+
+protected:
+	friend class MVKDeviceMemoryAllocator;
+
+	typedef struct {
+		VkDeviceSize offset;
+		VkDeviceSize size;
+	} MVKDeviceMemoryRange;
+
+	std::vector<MVKDeviceMemoryRange> _freeRanges;
+	std::mutex _lock;
+	id<MTLHeap> _mtlHeap = nil;
+	id<MTLBuffer> _mtlBuffer = nil;
+	VkDeviceSize _size;
+	uint32_t _memoryTypeIndex;
 	MTLStorageMode _mtlStorageMode;
 	MTLCPUCacheMode _mtlCPUCacheMode;
 };
 
+
+#pragma mark -
+#pragma mark MVKDeviceMemoryAllocator
+
+/**
+ * Places small VkDeviceMemory allocations within shared MVKDeviceMemoryBlocks, per memory type,
+ * so that an app making many small allocations does not create a Metal heap or Metal buffer
+ * for each allocation, or lose memory to page rounding of each allocation.
+ *
+ * Blocks are created as needed, and destroyed when the last allocation within them is freed.
+ * Access to the content within this allocator is thread-safe.
+ */
+class MVKDeviceMemoryAllocator : public MVKBaseDeviceObject {
+
+public:
+
+	/** Returns the Vulkan API opaque object controlling this object. */
+	MVKVulkanAPIObject* getVulkanAPIObject() override { return _device->getVulkanAPIObject(); };
+
+	/** Returns whether an allocation of the size and storage mode can be sub-allocated. */
+	bool canSubAllocate(VkDeviceSize size, MTLStorageMode mtlStorageMode);
+
+	/**
+	 * Reserves a range of the specified size within a block of the memory type, and returns
+	 * that block in ppBlock, and the offset of the range within the block in pOffset.
+	 * Returns false if the allocation could not be placed within a block.
+	 */
+	bool allocate(uint32_t memoryTypeIndex, VkDeviceSize size,
+				  MTLStorageMode mtlStorageMode, MTLCPUCacheMode mtlCPUCacheMode,
+				  MVKDeviceMemoryBlock** ppBlock, VkDeviceSize* pOffset);
+
+	/** Returns a range previously reserved with allocate(), destroying the block if it is no longer used. */
+	void free(MVKDeviceMemoryBlock* block, VkDeviceSize offset, VkDeviceSize size);
+
+	MVKDeviceMemoryAllocator(MVKDevice* device);
+
+	~MVKDeviceMemoryAllocator() override;
+
+protected:
+	MVKVectorInline<MVKDeviceMemoryBlock*, 8> _blocks;
+	std::mutex _lock;
+};
@@ -30,9 +30,49 @@
 using namespace std;
 
 
+// Returns whether memory of the storage mode can be backed by a Metal placement heap on the device.
+static bool mvkCanUseMTLHeap(MVKDevice* device, MTLStorageMode mtlStorageMode) {
+
+	// Don't bother if we don't have placement heaps.
+	if (!device->_pMetalFeatures->placementHeaps) { return false; }
+
+#if MVK_MACOS
+	// MTLHeaps on macOS must use private storage for now.
+	if (mtlStorageMode != MTLStorageModePrivate) { return false; }
+#endif
+#if MVK_IOS
+	// MTLHeaps on iOS must use private or shared storage for now.
+	if ( !(mtlStorageMode == MTLStorageModePrivate ||
+		   mtlStorageMode == MTLStorageModeShared) ) { return false; }
+#endif
+
+	return true;
+}
+
+// Returns a new placement MTLHeap. The caller must release the returned heap.
+static id<MTLHeap> mvkNewMTLHeap(MVKDevice* device, VkDeviceSize size,
+								 MTLStorageMode mtlStorageMode, MTLCPUCacheMode mtlCPUCacheMode) {
+	MTLHeapDescriptor* heapDesc = [MTLHeapDescriptor new];
+	heapDesc.type = MTLHeapTypePlacement;
+	heapDesc.storageMode = mtlStorageMode;
+	heapDesc.cpuCacheMode = mtlCPUCacheMode;
+	// Resources are tracked by Metal, unless the device tracks hazards using MTLFences derived from the app barriers.
+	heapDesc.hazardTrackingMode = (device->shouldUseFenceHazardTracking()
+								   ? MTLHazardTrackingModeUntracked
+								   : MTLHazardTrackingModeTracked);
+	heapDesc.size = size;
+	id<MTLHeap> mtlHeap = [device->getMTLDevice() newHeapWithDescriptor: heapDesc];	// retained
+	[heapDesc release];
+	return mtlHeap;
+}
+
+
 #pragma mark MVKDeviceMemory
 
+// The Metal objects of a sub-allocated memory are shared with other memory allocations.
 void MVKDeviceMemory::propogateDebugName() {
+	if (_memoryBlock) { return; }
+
 	setLabelIfNotNil(_mtlHeap, _debugName);
 	setLabelIfNotNil(_mtlBuffer, _debugName);
 }
@@ -71,7 +111,13 @@ void MVKDeviceMemory::unmap() {
 	}
 
 	// Coherent memory does not require flushing by app, so we must flush now.
-	flushToDevice(_mapOffset, _mapSize, isMemoryHostCoherent());
+	// If tracking the pages flushed by the app, only sync those pages.
+	if (_isTrackingDirtyPages) {
+		lock_guard<mutex> lock(_dirtyPageLock);
+		syncDirtyPages();
+	} else {
+		flushToDevice(_mapOffset, _mapSize, isMemoryHostCoherent());
+	}
 
 	_mapOffset = 0;
 	_mapSize = 0;
@@ -82,21 +128,94 @@ VkResult MVKDeviceMemory::flushToDevice(VkDeviceSize offset, VkDeviceSize size,
 	// Coherent memory is flushed on unmap(), so it is only flushed if forced
 	VkDeviceSize memSize = adjustMemorySize(size, offset);
 	if (memSize > 0 && isMemoryHostAccessible() && (evenIfCoherent || !isMemoryHostCoherent()) ) {
+		if (_isTrackingDirtyPages && !evenIfCoherent) {
+			markDirtyPages(offset, memSize);
+		} else {
+			syncToDevice(offset, memSize);
+		}
+	}
+	return VK_SUCCESS;
+}
 
+// Syncs the specified memory range to the device. The range must be within this memory allocation.
+void MVKDeviceMemory::syncToDevice(VkDeviceSize offset, VkDeviceSize size) {
 #if MVK_MACOS
-		if (_mtlBuffer && _mtlStorageMode == MTLStorageModeManaged) {
-			[_mtlBuffer didModifyRange: NSMakeRange(offset, memSize)];
-		}
+	if (_mtlBuffer && _mtlStorageMode == MTLStorageModeManaged) {
+		[_mtlBuffer didModifyRange: NSMakeRange(_mtlBufferOffset + offset, size)];
+	}
 #endif
 
-		// If we have an MTLHeap object, there's no need to sync memory manually between images and the buffer.
-		if (!_mtlHeap) {
-			lock_guard<mutex> lock(_rezLock);
-			for (auto& img : _images) { img->flushToDevice(offset, memSize); }
-			for (auto& buf : _buffers) { buf->flushToDevice(offset, memSize); }
+	// If we have an MTLHeap object, there's no need to sync memory manually between images and the buffer.
+	if (!_mtlHeap) {
+		lock_guard<mutex> lock(_rezLock);
+		for (auto& img : _images) { img->flushToDevice(offset, size); }
+		for (auto& buf : _buffers) { buf->flushToDevice(offset, size); }
+	}
+}
+
+// Pages of memory tracked as dirty. Flushed ranges are widened to page boundaries.
+static const VkDeviceSize kMVKDirtyPageSize = 4 * KIBI;
+static const uint32_t kMVKDirtyPagesPerWord = 64;
+
+// Marks the pages covering the specified memory range as dirty, and registers this
+// memory with the device, so the pages are synced before the next queue submission.
+void MVKDeviceMemory::markDirtyPages(VkDeviceSize offset, VkDeviceSize size) {
+	bool needsRegistration = false;
+	{
+		lock_guard<mutex> lock(_dirtyPageLock);
+		if (_dirtyPages.empty()) {
+			VkDeviceSize pageCnt = (_allocationSize + kMVKDirtyPageSize - 1) / kMVKDirtyPageSize;
+			_dirtyPages.resize((pageCnt + kMVKDirtyPagesPerWord - 1) / kMVKDirtyPagesPerWord, 0);
+		}
+		VkDeviceSize endPage = std::min(offset + size, _allocationSize);
+		endPage = (endPage + kMVKDirtyPageSize - 1) / kMVKDirtyPageSize;
+		for (VkDeviceSize page = offset / kMVKDirtyPageSize; page < endPage; page++) {
+			_dirtyPages[page / kMVKDirtyPagesPerWord] |= 1ULL << (page % kMVKDirtyPagesPerWord);
 		}
+		needsRegistration = !_isRegisteredDirty;
+		_isRegisteredDirty = true;
 	}
-	return VK_SUCCESS;
+
+	// Register outside the lock, because the device holds its lock while flushing this memory.
+	if (needsRegistration) { _device->addDirtyDeviceMemory(this); }
+}
+
+// Called by the device, which removes this memory from its dirty collection.
+void MVKDeviceMemory::flushDirtyPages() {
+	if ( !_isTrackingDirtyPages ) { return; }
+
+	lock_guard<mutex> lock(_dirtyPageLock);
+	_isRegisteredDirty = false;
+	syncDirtyPages();
+}
+
+// Syncs each contiguous run of dirty pages to the device as a single range.
+// The dirty page lock must be held when calling this function.
+void MVKDeviceMemory::syncDirtyPages() {
+	VkDeviceSize pageCnt = _dirtyPages.size() * kMVKDirtyPagesPerWord;
+	VkDeviceSize runStart = 0;
+	bool isInRun = false;
+	for (VkDeviceSize page = 0; page <= pageCnt; page++) {
+		bool isDirty = false;
+		if (page < pageCnt) {
+			uint64_t& word = _dirtyPages[page / kMVKDirtyPagesPerWord];
+			if ( !word && !isInRun && (page % kMVKDirtyPagesPerWord) == 0) {
+				page += kMVKDirtyPagesPerWord - 1;	// Skip clean words quickly
+				continue;
+			}
+			isDirty = mvkIsAnyFlagEnabled(word, 1ULL << (page % kMVKDirtyPagesPerWord));
+		}
+		if (isDirty && !isInRun) {
+			runStart = page;
+			isInRun = true;
+		} else if ( !isDirty && isInRun) {
+			VkDeviceSize offset = runStart * kMVKDirtyPageSize;
+			VkDeviceSize size = std::min(page * kMVKDirtyPageSize, _allocationSize) - offset;
+			syncToDevice(offset, size);
+			isInRun = false;
+		}
+	}
+	mvkClear(_dirtyPages.data(), _dirtyPages.size());
 }
 
 VkResult MVKDeviceMemory::pullFromDevice(VkDeviceSize offset,
@@ -112,7 +231,7 @@ VkResult MVKDeviceMemory::pullFromDevice(VkDeviceSize offset,
 
 #if MVK_MACOS
 		if (pBlitEnc && _mtlBuffer && _mtlStorageMode == MTLStorageModeManaged) {
-			if ( !pBlitEnc->mtlCmdBuffer) { pBlitEnc->mtlCmdBuffer = [_device->getAnyQueue()->getMTLCommandQueue() commandBufferWithUnretainedReferences]; }
+			if ( !pBlitEnc->mtlCmdBuffer) { pBlitEnc->mtlCmdBuffer = _device->getAnyQueue()->getMTLCommandBuffer(); }
 			if ( !pBlitEnc->mtlBlitEncoder) { pBlitEnc->mtlBlitEncoder = [pBlitEnc->mtlCmdBuffer blitCommandEncoder]; }
 			[pBlitEnc->mtlBlitEncoder synchronizeResource: _mtlBuffer];
 		}
@@ -171,38 +290,50 @@ void MVKDeviceMemory::removeImage(MVKImage* mvkImg) {
 	mvkRemoveAllOccurances(_images, mvkImg);
 }
 
+VkDeviceSize MVKDeviceMemory::getDeviceMemoryCommitment() {
+#if MVK_IOS
+	if (_mtlStorageMode == MTLStorageModeMemoryless) {
+		lock_guard<mutex> lock(_rezLock);
+		for (auto* img : _images) {
+			if (img->getMTLStorageMode() != MTLStorageModeMemoryless) { return _allocationSize; }
+		}
+		return 0;
+	}
+#endif
+	return _allocationSize;
+}
+
+// Returns whether a buffer or image, other than the specified resource, is currently
+// bound to a range of this memory that overlaps the range bound to the resource.
+bool MVKDeviceMemory::hasOverlappingResource(MVKResource* mvkRez) {
+	lock_guard<mutex> lock(_rezLock);
+
+	VkDeviceSize rezStart = mvkRez->getDeviceMemoryOffset();
+	VkDeviceSize rezEnd = rezStart + mvkRez->getByteCount();
+	auto overlaps = [=](MVKResource* otherRez) {
+		VkDeviceSize otherStart = otherRez->getDeviceMemoryOffset();
+		return otherRez != mvkRez && otherStart < rezEnd && rezStart < otherStart + otherRez->getByteCount();
+	};
+	for (auto* img : _images) { if (overlaps(img)) { return true; } }
+	for (auto* buf : _buffers) { if (overlaps(buf)) { return true; } }
+	return false;
+}
+
 // Ensures that this instance is backed by a MTLHeap object,
 // creating the MTLHeap if needed, and returns whether it was successful.
 bool MVKDeviceMemory::ensureMTLHeap() {
 
 	if (_mtlHeap) { return true; }
 
-	// Don't bother if we don't have placement heaps.
-	if (!getDevice()->_pMetalFeatures->placementHeaps) { return true; }
+	// A sub-allocated memory uses the MTLHeap of its memory block, if it has one.
+	if (_memoryBlock) { return true; }
 
 	// Can't create MTLHeaps of zero size.
 	if (_allocationSize == 0) { return true; }
 
-#if MVK_MACOS
-	// MTLHeaps on macOS must use private storage for now.
-	if (_mtlStorageMode != MTLStorageModePrivate) { return true; }
-#endif
-#if MVK_IOS
-	// MTLHeaps on iOS must use private or shared storage for now.
-	if ( !(_mtlStorageMode == MTLStorageModePrivate ||
-		   _mtlStorageMode == MTLStorageModeShared) ) { return true; }
-#endif
+	if ( !mvkCanUseMTLHeap(_device, _mtlStorageMode) ) { return true; }
 
-	MTLHeapDescriptor* heapDesc = [MTLHeapDescriptor new];
-	heapDesc.type = MTLHeapTypePlacement;
-	heapDesc.storageMode = _mtlStorageMode;
-	heapDesc.cpuCacheMode = _mtlCPUCacheMode;
-	// For now, use tracked resources. Later, we should probably default
-	// to untracked, since Vulkan uses explicit barriers anyway.
-	heapDesc.hazardTrackingMode = MTLHazardTrackingModeTracked;
-	heapDesc.size = _allocationSize;
-	_mtlHeap = [_device->getMTLDevice() newHeapWithDescriptor: heapDesc];	// retained
-	[heapDesc release];
+	_mtlHeap = mvkNewMTLHeap(_device, _allocationSize, _mtlStorageMode, _mtlCPUCacheMode);	// retained
 	if (!_mtlHeap) { return false; }
 
 	propogateDebugName();
@@ -216,6 +347,22 @@ bool MVKDeviceMemory::ensureMTLBuffer() {
 
 	if (_mtlBuffer) { return true; }
 
+	// A sub-allocated memory overlays the MTLBuffer of its memory block, at its offset within the block.
+	// If host memory was already allocated, it is copied into the MTLBuffer, and then released.
+	if (_memoryBlock) {
+		id<MTLBuffer> mtlBlockBuff = _memoryBlock->getMTLBuffer();
+		if (!mtlBlockBuff) { return false; }
+
+		_mtlBuffer = [mtlBlockBuff retain];		// retained
+		_mtlBufferOffset = _memoryBlockOffset;
+		_pMemory = isMemoryHostAccessible() ? (void*)((uintptr_t)_mtlBuffer.contents + _mtlBufferOffset) : nullptr;
+		if (_pHostMemory) {
+			if (_pMemory) { memcpy(_pMemory, _pHostMemory, _allocationSize); }
+			freeHostMemory();
+		}
+		return true;
+	}
+
 	NSUInteger memLen = mvkAlignByteCount(_allocationSize, _device->_pMetalFeatures->mtlBufferAlignment);
 
 	if (memLen > _device->_pMetalFeatures->maxMTLBufferSize) { return false; }
@@ -264,6 +411,22 @@ void MVKDeviceMemory::freeHostMemory() {
 	_pHostMemory = nullptr;
 }
 
+// Places this memory within a larger memory block shared with other small allocations
+// of the same memory type, and returns whether this memory was successfully placed.
+bool MVKDeviceMemory::subAllocate(uint32_t memoryTypeIndex) {
+	MVKDeviceMemoryAllocator* memAllocator = _device->getDeviceMemoryAllocator();
+	if ( !memAllocator->canSubAllocate(_allocationSize, _mtlStorageMode) ) { return false; }
+
+	if ( !memAllocator->allocate(memoryTypeIndex, _allocationSize, _mtlStorageMode, _mtlCPUCacheMode,
+								 &_memoryBlock, &_memoryBlockOffset) ) { return false; }
+
+	if (_memoryBlock->getMTLHeap()) {
+		_mtlHeap = [_memoryBlock->getMTLHeap() retain];		// retained
+		_mtlHeapOffset = _memoryBlockOffset;
+	}
+	return true;
+}
+
 MVKResource* MVKDeviceMemory::getDedicatedResource() {
 	MVKAssert(_isDedicated, "This method should only be called on dedicated allocations!");
 	return _buffers.empty() ? (MVKResource*)_images[0] : (MVKResource*)_buffers[0];
@@ -278,10 +441,15 @@ MVKDeviceMemory::MVKDeviceMemory(MVKDevice* device,
 	_mtlCPUCacheMode = mvkMTLCPUCacheModeFromVkMemoryPropertyFlags(vkMemProps);
 
 	_allocationSize = pAllocateInfo->allocationSize;
+	_memoryTypeIndex = pAllocateInfo->memoryTypeIndex;
+	_isTrackingDirtyPages = (_device->shouldTrackDirtyMappedMemory() &&
+							 isMemoryHostAccessible() && !isMemoryHostCoherent());
+	_device->getPhysicalDevice()->updateAllocatedMemorySize(_memoryTypeIndex, _allocationSize);
 
 	VkImage dedicatedImage = VK_NULL_HANDLE;
 	VkBuffer dedicatedBuffer = VK_NULL_HANDLE;
 	VkExternalMemoryHandleTypeFlags handleTypes = 0;
+	const VkImportMemoryHostPointerInfoEXT* pHostPtrImportInfo = nullptr;
 	for (const auto* next = (const VkBaseInStructure*)pAllocateInfo->pNext; next; next = next->pNext) {
 		switch (next->sType) {
 			case VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO: {
@@ -296,6 +464,10 @@ MVKDeviceMemory::MVKDeviceMemory(MVKDevice* device,
 				handleTypes = pExpMemInfo->handleTypes;
 				break;
 			}
+			case VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT: {
+				pHostPtrImportInfo = (const VkImportMemoryHostPointerInfoEXT*)next;
+				break;
+			}
 			default:
 				break;
 		}
@@ -304,6 +476,24 @@ MVKDeviceMemory::MVKDeviceMemory(MVKDevice* device,
 	initExternalMemory(handleTypes);	// After setting _isDedicated
 
 	// "Dedicated" means this memory can only be used for this image or buffer.
+	// Record it before any early return, so binding can verify the dedicated resource.
+	if (dedicatedImage) { _images.push_back((MVKImage*)dedicatedImage); }
+	if (dedicatedBuffer) { _buffers.push_back((MVKBuffer*)dedicatedBuffer); }
+
+	if (pHostPtrImportInfo) {
+		importHostPointer(pHostPtrImportInfo);
+		return;
+	}
+
+	// Small, non-dedicated, non-exported memory is placed within a larger shared memory block.
+	// Host-accessible memory overlays the MTLBuffer of the block immediately, since it is shared.
+	if ( !_isDedicated && !handleTypes && subAllocate(pAllocateInfo->memoryTypeIndex) ) {
+		if (isMemoryHostAccessible() && !ensureMTLBuffer() ) {
+			setConfigurationResult(reportError(VK_ERROR_OUT_OF_DEVICE_MEMORY, "Could not allocate VkDeviceMemory of size %llu bytes.", _allocationSize));
+		}
+		return;
+	}
+
 	if (dedicatedImage) {
 #if MVK_MACOS
 		if (isMemoryHostCoherent() ) {
@@ -319,14 +509,9 @@ MVKDeviceMemory::MVKDeviceMemory(MVKDevice* device,
 			}
 		}
 #endif
-		_images.push_back((MVKImage*)dedicatedImage);
 		return;
 	}
 
-	if (dedicatedBuffer) {
-		_buffers.push_back((MVKBuffer*)dedicatedBuffer);
-	}
-
 	// If we can, create a MTLHeap. This should happen before creating the buffer, allowing us to map its contents.
 	if ( !_isDedicated ) {
 		if (!ensureMTLHeap()) {
@@ -362,6 +547,37 @@ void MVKDeviceMemory::initExternalMemory(VkExternalMemoryHandleTypeFlags handleT
 	}
 }
 
+// Wraps the app's host allocation in a MTLBuffer without copying it. The app retains ownership of the
+// host allocation, and must keep it alive until this memory is freed, so the MTLBuffer has no deallocator.
+void MVKDeviceMemory::importHostPointer(const VkImportMemoryHostPointerInfoEXT* pImportInfo) {
+	if (pImportInfo->handleType != VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT) {
+		setConfigurationResult(reportError(VK_ERROR_INVALID_EXTERNAL_HANDLE, "vkAllocateMemory(): Only external memory handle type VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT can be imported from a host pointer."));
+		return;
+	}
+
+	uintptr_t pageSize = mvkGetHostMemoryPageSize();
+	uintptr_t hostAddr = (uintptr_t)pImportInfo->pHostPointer;
+	if (mvkAlignByteRef(hostAddr, pageSize) != hostAddr || mvkAlignByteCount(_allocationSize, pageSize) != _allocationSize) {
+		setConfigurationResult(reportError(VK_ERROR_INVALID_EXTERNAL_HANDLE, "vkAllocateMemory(): The imported host pointer %p and allocation size %llu must be aligned to VkPhysicalDeviceExternalMemoryHostPropertiesEXT::minImportedHostPointerAlignment (%lu bytes).", pImportInfo->pHostPointer, _allocationSize, (unsigned long)pageSize));
+		return;
+	}
+
+	if ( !mvkIsAnyFlagEnabled(_device->getPhysicalDevice()->getHostCoherentMemoryTypes(), 1U << _memoryTypeIndex) ) {
+		setConfigurationResult(reportError(VK_ERROR_INVALID_EXTERNAL_HANDLE, "vkAllocateMemory(): Host pointers can only be imported into host-coherent memory types."));
+		return;
+	}
+
+	_mtlBuffer = [getMTLDevice() newBufferWithBytesNoCopy: pImportInfo->pHostPointer
+												   length: _allocationSize
+												  options: getMTLResourceOptions()
+											  deallocator: nil];	// retained
+	if ( !_mtlBuffer ) {
+		setConfigurationResult(reportError(VK_ERROR_OUT_OF_DEVICE_MEMORY, "vkAllocateMemory(): Could not import host pointer %p of size %llu bytes into a MTLBuffer.", pImportInfo->pHostPointer, _allocationSize));
+		return;
+	}
+	_pMemory = _mtlBuffer.contents;
+}
+
 MVKDeviceMemory::~MVKDeviceMemory() {
     // Unbind any resources that are using me. Iterate a copy of the collection,
     // to allow the resource to callback to remove itself from the collection.
@@ -370,11 +586,172 @@ MVKDeviceMemory::~MVKDeviceMemory() {
 	auto imgCopies = _images;
 	for (auto& img : imgCopies) { img->bindDeviceMemory(nullptr, 0); }
 
+	if (_isTrackingDirtyPages) { _device->removeDirtyDeviceMemory(this); }
+
 	[_mtlBuffer release];
 	_mtlBuffer = nil;
 
 	[_mtlHeap release];
 	_mtlHeap = nil;
 
+	if (_memoryBlock) {
+		_device->getDeviceMemoryAllocator()->free(_memoryBlock, _memoryBlockOffset, _allocationSize);
+		_memoryBlock = nullptr;
+	}
+
 	freeHostMemory();
+
+	_device->getPhysicalDevice()->updateAllocatedMemorySize(_memoryTypeIndex, -(int64_t)_allocationSize);
+}
+
+
+#pragma mark -
+#pragma mark MVKDeviceMemoryBlock
+
+// Sub-allocations are aligned so that the resources bound within them retain the alignment
+// they require relative to the start of their memory. Textures placed in a Metal heap require
+// stricter alignment than buffers and linear textures.
+static const VkDeviceSize kMVKDeviceMemoryBlockMTLBufferAlignment = 4 * KIBI;
+static const VkDeviceSize kMVKDeviceMemoryBlockMTLHeapAlignment = 16 * KIBI;
+
+// Only allocations up to this size are sub-allocated within memory blocks of this size.
+static const VkDeviceSize kMVKDeviceMemoryMaxSubAllocationSize = 256 * KIBI;
+static const VkDeviceSize kMVKDeviceMemoryBlockSize = 8 * MEBI;
+
+id<MTLBuffer> MVKDeviceMemoryBlock::getMTLBuffer() {
+	if (_mtlBuffer) { return _mtlBuffer; }
+
+	// Lock and check again in case another thread has created the buffer.
+	lock_guard<mutex> lock(_lock);
+	if (_mtlBuffer) { return _mtlBuffer; }
+
+	MTLResourceOptions mtlRezOpts = mvkMTLResourceOptions(_mtlStorageMode, _mtlCPUCacheMode) | _device->getMTLResourceHazardTrackingOptions();
+	if (_mtlHeap) {
+		_mtlBuffer = [_mtlHeap newBufferWithLength: _size options: mtlRezOpts offset: 0];	// retained
+		[_mtlBuffer makeAliasable];
+	} else {
+		_mtlBuffer = [getMTLDevice() newBufferWithLength: _size options: mtlRezOpts];		// retained
+	}
+	return _mtlBuffer;
+}
+
+// First fit within the free ranges, which are kept sorted by offset.
+bool MVKDeviceMemoryBlock::allocate(VkDeviceSize size, VkDeviceSize* pOffset) {
+	size = mvkAlignByteCount(size, _mtlHeap ? kMVKDeviceMemoryBlockMTLHeapAlignment : kMVKDeviceMemoryBlockMTLBufferAlignment);
+	for (auto iter = _freeRanges.begin(), end = _freeRanges.end(); iter != end; iter++) {
+		if (iter->size >= size) {
+			*pOffset = iter->offset;
+			iter->offset += size;
+			iter->size -= size;
+			if (iter->size == 0) { _freeRanges.erase(iter); }
+			return true;
+		}
+	}
+	return false;
+}
+
+// Inserts the range in offset order, and coalesces it with any adjacent free ranges.
+void MVKDeviceMemoryBlock::free(VkDeviceSize offset, VkDeviceSize size) {
+	size = mvkAlignByteCount(size, _mtlHeap ? kMVKDeviceMemoryBlockMTLHeapAlignment : kMVKDeviceMemoryBlockMTLBufferAlignment);
+	auto iter = _freeRanges.begin();
+	while (iter != _freeRanges.end() && iter->offset < offset) { iter++; }
+	iter = _freeRanges.insert(iter, {offset, size});
+
+	auto next = iter + 1;
+	if (next != _freeRanges.end() && iter->offset + iter->size == next->offset) {
+		iter->size += next->size;
+		_freeRanges.erase(next);
+	}
+	if (iter != _freeRanges.begin()) {
+		auto prev = iter - 1;
+		if (prev->offset + prev->size == iter->offset) {
+			prev->size += iter->size;
+			_freeRanges.erase(iter);
+		}
+	}
+}
+
+MVKDeviceMemoryBlock::MVKDeviceMemoryBlock(MVKDevice* device, uint32_t memoryTypeIndex, VkDeviceSize size,
+										   MTLStorageMode mtlStorageMode, MTLCPUCacheMode mtlCPUCacheMode) :
+	MVKBaseDeviceObject(device),
+	_size(size),
+	_memoryTypeIndex(memoryTypeIndex),
+	_mtlStorageMode(mtlStorageMode),
+	_mtlCPUCacheMode(mtlCPUCacheMode) {
+
+	// Use a placement heap if possible, so images can also be placed within the block.
+	// Otherwise, the block is backed by a MTLBuffer, which is created immediately.
+	if (mvkCanUseMTLHeap(_device, _mtlStorageMode)) {
+		_mtlHeap = mvkNewMTLHeap(_device, _size, _mtlStorageMode, _mtlCPUCacheMode);	// retained
+	} else {
+		getMTLBuffer();
+	}
+	_freeRanges.push_back({0, _size});
+}
+
+MVKDeviceMemoryBlock::~MVKDeviceMemoryBlock() {
+	[_mtlBuffer release];
+	[_mtlHeap release];
+}
+
+
+#pragma mark -
+#pragma mark MVKDeviceMemoryAllocator
+
+// Private memory that cannot be placed in a heap creates no Metal objects until a buffer is bound
+// to it, and images bound to it do not use it, so there is nothing to gain by sub-allocating it.
+bool MVKDeviceMemoryAllocator::canSubAllocate(VkDeviceSize size, MTLStorageMode mtlStorageMode) {
+	if ( !_device->shouldSubAllocateDeviceMemory() ) { return false; }
+	if (size == 0 || size > kMVKDeviceMemoryMaxSubAllocationSize) { return false; }
+#if MVK_IOS
+	if (mtlStorageMode == MTLStorageModeMemoryless) { return false; }
+#endif
+	if (mtlStorageMode == MTLStorageModePrivate && !mvkCanUseMTLHeap(_device, mtlStorageMode)) { return false; }
+	return true;
+}
+
+bool MVKDeviceMemoryAllocator::allocate(uint32_t memoryTypeIndex, VkDeviceSize size,
+										MTLStorageMode mtlStorageMode, MTLCPUCacheMode mtlCPUCacheMode,
+										MVKDeviceMemoryBlock** ppBlock, VkDeviceSize* pOffset) {
+	lock_guard<mutex> lock(_lock);
+
+	for (auto* block : _blocks) {
+		if (block->_memoryTypeIndex == memoryTypeIndex && block->allocate(size, pOffset)) {
+			*ppBlock = block;
+			return true;
+		}
+	}
+
+	auto* block = new MVKDeviceMemoryBlock(_device, memoryTypeIndex, kMVKDeviceMemoryBlockSize,
+										   mtlStorageMode, mtlCPUCacheMode);
+	if ( !block->isValid() || !block->allocate(size, pOffset) ) {
+		block->destroy();
+		return false;
+	}
+	_blocks.push_back(block);
+	*ppBlock = block;
+	return true;
+}
+
+// An empty block is destroyed only if another block of the same memory type remains,
+// to avoid repeatedly creating and destroying a block as a single allocation comes and goes.
+void MVKDeviceMemoryAllocator::free(MVKDeviceMemoryBlock* block, VkDeviceSize offset, VkDeviceSize size) {
+	lock_guard<mutex> lock(_lock);
+
+	block->free(offset, size);
+	if ( !block->isEmpty() ) { return; }
+
+	for (auto* otherBlock : _blocks) {
+		if (otherBlock != block && otherBlock->_memoryTypeIndex == block->_memoryTypeIndex) {
+			mvkRemoveAllOccurances(_blocks, block);
+			block->destroy();
+			return;
+		}
+	}
+}
+
+MVKDeviceMemoryAllocator::MVKDeviceMemoryAllocator(MVKDevice* device) : MVKBaseDeviceObject(device) {}
+
+MVKDeviceMemoryAllocator::~MVKDeviceMemoryAllocator() {
+	mvkDestroyContainerContents(_blocks);
 }
@@ -20,9 +20,50 @@
 
 #include "MVKDevice.h"
 #include "MVKImage.h"
+#include "MVKRenderPass.h"
+#include "MVKFlatHashMap.h"
 #include "MVKVector.h"
+#include <mutex>
 
 
+#pragma mark -
+#pragma mark MVKMTLRenderPassDescriptorKey
+
+/**
+ * Key to use for looking up the MTLRenderPassDescriptor templates cached in a framebuffer.
+ * Identifies the subpass that begins the Metal render pass, and the conditions that affect
+ * the attachments, and their load and store actions, when the Metal render pass begins.
+ */
+typedef struct MVKMTLRenderPassDescriptorKey {
+	MVKRenderSubpass* subpass;
+	uint64_t dontCareLoadAttachmentMask;
+	uint64_t dontCareStoreAttachmentMask;
+	uint32_t clearColorAttachmentMask;
+	bool isClearingDepth;
+	bool isClearingStencil;
+	bool isRenderingEntireAttachment;
+	bool loadOverride;
+	bool storeOverride;
+
+	bool operator==(const MVKMTLRenderPassDescriptorKey& rhs) const { return mvkAreEqual(this, &rhs); }
+
+	std::size_t hash() const {
+		return mvkHash(this);
+	}
+
+	MVKMTLRenderPassDescriptorKey() { mvkClear(this); }
+
+} __attribute__((aligned(sizeof(uint64_t)))) MVKMTLRenderPassDescriptorKey;
+
+namespace std {
+	template <>
+	struct hash<MVKMTLRenderPassDescriptorKey> {
+		std::size_t operator()(const MVKMTLRenderPassDescriptorKey& k) const { return k.hash(); }
+	};
+}
+
+
+#pragma mark -
 #pragma mark MVKFramebuffer
 
 /** Represents a Vulkan framebuffer. */
@@ -45,17 +86,47 @@ public:
 	/** Returns the attachment at the specified index.  */
 	inline MVKImageView* getAttachment(uint32_t index) { return _attachments[index]; }
 
+	/** Returns the number of attachments in this framebuffer. */
+	inline uint32_t getAttachmentCount() { return uint32_t(_attachments.size()); }
+
+	/**
+	 * Returns an autoreleased MTLRenderPassDescriptor for the Metal render pass begun by the
+	 * specified subpass, rendering to the attachments of this framebuffer, and populated from
+	 * the remaining parameters, as described for MVKRenderSubpass::populateMTLRenderPassDescriptor().
+	 *
+	 * The attachments, and their load and store actions, are copied from a template that is
+	 * populated the first time it is needed, and cached in this framebuffer, and only the clear
+	 * values are populated each time. A new descriptor is fully populated each time if any
+	 * attachment changes its Metal texture, or if resolve store overrides are provided.
+	 */
+	MTLRenderPassDescriptor* getMTLRenderPassDescriptor(MVKRenderSubpass* subpass,
+														MVKVector<VkClearValue>& clearValues,
+														bool isRenderingEntireAttachment,
+														bool loadOverride,
+														bool storeOverride,
+														MVKClearLoadOverrides* pClearLoads,
+														MVKResolveStoreOverrides* pResolveStores,
+														MVKInferredLoadStoreActions* pInferredLoadStores);
+
 
 #pragma mark Construction
 
 	/** Constructs an instance for the specified device. */
 	MVKFramebuffer(MVKDevice* device, const VkFramebufferCreateInfo* pCreateInfo);
 
+	~MVKFramebuffer() override;
+
 protected:
 	void propogateDebugName() override {}
+	MTLRenderPassDescriptor* getMTLRenderPassDescriptorTemplate(MVKMTLRenderPassDescriptorKey& rpdKey,
+																MVKClearLoadOverrides* pClearLoads,
+																MVKInferredLoadStoreActions* pInferredLoadStores);
 
 	VkExtent2D _extent;
 	uint32_t _layerCount;
 	MVKVectorInline<MVKImageView*, 4> _attachments;
+	MVKFlatHashMap<MVKMTLRenderPassDescriptorKey, MTLRenderPassDescriptor*> _mtlRenderPassDescriptorTemplates;
+	std::mutex _mtlRenderPassDescriptorTemplatesLock;
+	bool _hasVolatileAttachments;
 };
 
@@ -18,9 +18,81 @@
 
 #include "MVKFramebuffer.h"
 
+using namespace std;
+
 
 #pragma mark MVKFramebuffer
 
+MTLRenderPassDescriptor* MVKFramebuffer::getMTLRenderPassDescriptor(MVKRenderSubpass* subpass,
+																	MVKVector<VkClearValue>& clearValues,
+																	bool isRenderingEntireAttachment,
+																	bool loadOverride,
+																	bool storeOverride,
+																	MVKClearLoadOverrides* pClearLoads,
+																	MVKResolveStoreOverrides* pResolveStores,
+																	MVKInferredLoadStoreActions* pInferredLoadStores) {
+
+	// A template can't be reused if the attachment textures change, or to resolve to arbitrary images.
+	if (_hasVolatileAttachments || (pResolveStores && pResolveStores->colorAttachmentMask)) {
+		MTLRenderPassDescriptor* mtlRPDesc = [MTLRenderPassDescriptor renderPassDescriptor];
+		subpass->populateMTLRenderPassDescriptor(mtlRPDesc, this, clearValues, isRenderingEntireAttachment,
+												 loadOverride, storeOverride, pClearLoads, pResolveStores, pInferredLoadStores);
+		return mtlRPDesc;
+	}
+
+	MVKMTLRenderPassDescriptorKey rpdKey;
+	rpdKey.subpass = subpass;
+	rpdKey.isRenderingEntireAttachment = isRenderingEntireAttachment;
+	rpdKey.loadOverride = loadOverride;
+	rpdKey.storeOverride = storeOverride;
+	if (pClearLoads) {
+		rpdKey.clearColorAttachmentMask = pClearLoads->colorAttachmentMask;
+		rpdKey.isClearingDepth = pClearLoads->isClearingDepth;
+		rpdKey.isClearingStencil = pClearLoads->isClearingStencil;
+	}
+	if (pInferredLoadStores) {
+		rpdKey.dontCareLoadAttachmentMask = pInferredLoadStores->dontCareLoadAttachmentMask;
+		rpdKey.dontCareStoreAttachmentMask = pInferredLoadStores->dontCareStoreAttachmentMask;
+	}
+
+	MTLRenderPassDescriptor* mtlRPDesc = [[getMTLRenderPassDescriptorTemplate(rpdKey, pClearLoads, pInferredLoadStores) copy] autorelease];
+	subpass->populateMTLRenderPassDescriptorClearValues(mtlRPDesc, clearValues, pClearLoads);
+	return mtlRPDesc;
+}
+
+// The maximum number of templates cached by each framebuffer.
+static const size_t kMVKMaxMTLRenderPassDescriptorTemplateCount = 64;
+
+// Returns the cached template for the key, populating and caching it if it doesn't exist yet.
+// Lookups are lock-free, and the lock is only taken when adding a new template. The render pass
+// is retained by each template, so its subpasses remain valid while they are used as keys.
+// Templates can't be evicted while lock-free lookups may be using them, so once the cache is
+// full, new templates are returned without being cached. This bounds both the memory used by
+// the cache, and the destroyed render passes it keeps alive.
+MTLRenderPassDescriptor* MVKFramebuffer::getMTLRenderPassDescriptorTemplate(MVKMTLRenderPassDescriptorKey& rpdKey,
+																			MVKClearLoadOverrides* pClearLoads,
+																			MVKInferredLoadStoreActions* pInferredLoadStores) {
+	MTLRenderPassDescriptor* mtlRPDesc = _mtlRenderPassDescriptorTemplates.get(rpdKey, nil);
+	if (mtlRPDesc) { return mtlRPDesc; }
+
+	lock_guard<mutex> lock(_mtlRenderPassDescriptorTemplatesLock);
+
+	mtlRPDesc = _mtlRenderPassDescriptorTemplates.get(rpdKey, nil);
+	if (mtlRPDesc) { return mtlRPDesc; }
+
+	bool isCacheFull = (_mtlRenderPassDescriptorTemplates.size() >= kMVKMaxMTLRenderPassDescriptorTemplateCount);
+	mtlRPDesc = isCacheFull ? [MTLRenderPassDescriptor renderPassDescriptor] : [MTLRenderPassDescriptor new];	// retained if cached
+	rpdKey.subpass->populateMTLRenderPassDescriptorAttachments(mtlRPDesc, this, rpdKey.isRenderingEntireAttachment,
+															   rpdKey.loadOverride, rpdKey.storeOverride,
+															   pClearLoads, nullptr, pInferredLoadStores);
+	if (isCacheFull) { return mtlRPDesc; }
+
+	rpdKey.subpass->getRenderPass()->retain();
+	_mtlRenderPassDescriptorTemplates.emplace(rpdKey, mtlRPDesc);
+	return mtlRPDesc;
+}
+
+
 #pragma mark Construction
 
 MVKFramebuffer::MVKFramebuffer(MVKDevice* device,
@@ -33,5 +105,17 @@ MVKFramebuffer::MVKFramebuffer(MVKDevice* device,
 	for (uint32_t i = 0; i < pCreateInfo->attachmentCount; i++) {
 		_attachments.push_back((MVKImageView*)pCreateInfo->pAttachments[i]);
 	}
+
+	_hasVolatileAttachments = false;
+	for (auto* imgView : _attachments) {
+		if (imgView->hasVolatileMTLTexture()) { _hasVolatileAttachments = true; }
+	}
+}
+
+MVKFramebuffer::~MVKFramebuffer() {
+	for (auto& pair : _mtlRenderPassDescriptorTemplates) {
+		[pair.second release];
+		pair.first.subpass->getRenderPass()->release();
+	}
 }
 
@@ -25,11 +25,13 @@
 #include <MoltenVKSPIRVToMSLConverter/SPIRVToMSLConverter.h>
 #include <unordered_map>
 #include <mutex>
+#include <atomic>
 
 #import <IOSurface/IOSurfaceRef.h>
 
 class MVKImageView;
 class MVKSwapchain;
+class MVKPresentableSwapchainImage;
 class MVKCommandEncoder;
 
 
@@ -71,6 +73,12 @@ public:
 	/** Returns whether this image is compressed. */
 	bool getIsCompressed();
 
+	/**
+	 * Returns whether the compressed content of this image is decompressed into an uncompressed
+	 * Metal texture, because Metal does not support the compressed format for this image.
+	 */
+	inline bool needsDecompression() { return _needsDecompression; }
+
 	/** 
 	 * Returns the 3D extent of this image at the base mipmap level.
 	 * For 2D or cube images, the Z component will be 1.  
@@ -152,9 +160,22 @@ public:
 	/** Returns the Metal texture underlying this image. */
 	virtual id<MTLTexture> getMTLTexture();
 
-	/** Returns a Metal texture that interprets the pixels in the specified format. */
+	/** Returns whether the Metal texture underlying this image can change over the life of this image. */
+	virtual bool hasVolatileMTLTexture() { return false; }
+
+	/**
+	 * Returns a Metal texture that interprets the pixels in the specified format.
+	 * Unless the pixel format is the format of this image, hasPixelFormatViews() must return true.
+	 */
 	id<MTLTexture> getMTLTexture(MTLPixelFormat mtlPixFmt);
 
+	/**
+	 * Returns whether the Metal texture underlying this image supports views that reinterpret
+	 * its color pixel format. This is only the case if the image was created with a mutable
+	 * format, and any formats listed for its views are different than the image format.
+	 */
+	inline bool hasPixelFormatViews() { return _hasPixelFormatViews; }
+
     /**
      * Sets this image to use the specified MTLTexture.
      *
@@ -235,11 +256,15 @@ protected:
 	VkSampleCountFlagBits validateSamples(const VkImageCreateInfo* pCreateInfo, bool isAttachment);
 	uint32_t validateMipLevels(const VkImageCreateInfo* pCreateInfo, bool isAttachment);
 	bool validateLinear(const VkImageCreateInfo* pCreateInfo, bool isAttachment);
+	bool needsPixelFormatViews(const VkImageCreateInfo* pCreateInfo);
 	bool validateUseTexelBuffer();
 	void initSubresources(const VkImageCreateInfo* pCreateInfo);
 	void initSubresourceLayout(MVKImageSubresource& imgSubRez);
 	void initExternalMemory(VkExternalMemoryHandleTypeFlags handleTypes);
 	id<MTLTexture> newMTLTexture();
+	bool isMTLHeapOffsetAligned();
+	bool isMemorylessAttachment();
+	bool isAliasingMemory();
 	void releaseMTLTexture();
     void releaseIOSurface();
 	MTLTextureDescriptor* newMTLTextureDescriptor();
@@ -253,15 +278,29 @@ protected:
 						   MVKPipelineBarrier& barrier);
 
 	MVKVectorInline<MVKImageSubresource, 1> _subresources;
-	std::unordered_map<NSUInteger, id<MTLTexture>> _mtlTextureViews;
+	id<MTLTexture> getCachedMTLTextureView(MTLPixelFormat mtlPixFmt);
+
+	// Texture views are published lock-free into a small inline array, and only
+	// images needing more views than fit in the array use the overflow map under the lock.
+	static const uint32_t kMVKMaxInlineTextureViews = 4;
+	struct MVKImageTextureView {
+		MTLPixelFormat mtlPixelFormat;
+		id<MTLTexture> mtlTexture;
+	};
+
+	MVKImageTextureView _mtlTextureViews[kMVKMaxInlineTextureViews];
+	std::atomic<uint32_t> _mtlTextureViewCount;
+	std::unordered_map<NSUInteger, id<MTLTexture>> _mtlTextureViewOverflow;
     VkExtent3D _extent;
     uint32_t _mipLevels;
     uint32_t _arrayLayers;
     VkSampleCountFlagBits _samples;
     VkImageUsageFlags _usage;
+	VkFormat _vkFormat;
 	MTLPixelFormat _mtlPixelFormat;
 	MTLTextureType _mtlTextureType;
     id<MTLTexture> _mtlTexture;
+    NSUInteger _mtlTextureByteCount = 0;		// Bytes counted in the device resource statistics
     std::mutex _lock;
     IOSurfaceRef _ioSurface;
 	VkDeviceSize _rowByteAlignment;
@@ -270,8 +309,9 @@ protected:
     bool _hasExpectedTexelSize;
 	bool _usesTexelBuffer;
 	bool _isLinear;
-	bool _is3DCompressed;
+	bool _needsDecompression;
 	bool _isAliasable;
+	bool _hasPixelFormatViews;
 };
 
 
@@ -291,6 +331,9 @@ public:
 	/** Returns the Metal texture used by the CAMetalDrawable underlying this image. */
 	id<MTLTexture> getMTLTexture() override;
 
+	/** The Metal texture changes with each drawable. */
+	bool hasVolatileMTLTexture() override { return true; }
+
 
 #pragma mark Construction
 
@@ -324,6 +367,18 @@ typedef struct MVKSwapchainImageAvailability {
 /** Tracks a semaphore and fence for later signaling. */
 typedef std::pair<MVKSemaphore*, MVKFence*> MVKSwapchainSignaler;
 
+/**
+ * The presentation of a swapchain image, with any VK_GOOGLE_display_timing info provided
+ * by the app, and the extent of the image that was rendered by the app for this presentation.
+ */
+typedef struct MVKImagePresentInfo {
+	MVKPresentableSwapchainImage* presentableImage;
+	uint64_t desiredPresentTime;	/**< Earliest time to display the image, in nanoseconds of host time. Zero if none. */
+	uint32_t presentID;				/**< The app's ID for this presentation. */
+	bool hasPresentTime;			/**< Indicates whether the app provided timing info for this presentation. */
+	VkExtent2D renderExtent;		/**< The region at the origin of the image rendered by the app. Zero if the entire image. */
+} MVKImagePresentInfo;
+
 
 /** Represents a Vulkan swapchain image that can be submitted to the presentation engine. */
 class MVKPresentableSwapchainImage : public MVKSwapchainImage {
@@ -339,8 +394,24 @@ public:
 	 * If mtlCmdBuff is not nil, the contained drawable is scheduled for presentation using
 	 * the presentDrawable: method of the command buffer. If mtlCmdBuff is nil, the contained
 	 * drawable is presented immediately using the present method of the drawable.
+	 *
+	 * If the presentation info includes a desired present time, the drawable is not displayed
+	 * before that time, and if it includes app timing info, the swapchain records the time at
+	 * which the drawable was actually displayed.
+	 */
+	void presentCAMetalDrawable(id<MTLCommandBuffer> mtlCmdBuff, const MVKImagePresentInfo& presentInfo);
+
+	/**
+	 * Sets the extent of the region, at the origin of this image, that the app renders for
+	 * subsequent presentations of this image. If the extent is smaller than this image, and
+	 * swapchain upscaling is enabled, the region is upscaled to cover this entire image when
+	 * it is presented. If pRenderExtent is null, or has a zero width or height, the entire
+	 * image is presented without upscaling.
 	 */
-	void presentCAMetalDrawable(id<MTLCommandBuffer> mtlCmdBuff);
+	void setRenderExtent(const VkExtent2D* pRenderExtent);
+
+	/** Returns the extent set by setRenderExtent(), or a zero extent if the entire image is rendered. */
+	inline VkExtent2D getRenderExtent() { return _renderExtent; }
 
 
 #pragma mark Construction
@@ -357,6 +428,9 @@ protected:
 	friend MVKSwapchain;
 
 	id<CAMetalDrawable> getCAMetalDrawable() override;
+	id<CAMetalDrawable> newCAMetalDrawable();
+	void prefetchCAMetalDrawable();
+	void awaitPrefetchedCAMetalDrawable();
 	void releaseMetalDrawable();
 	MVKSwapchainImageAvailability getAvailability();
 	void makeAvailable();
@@ -368,10 +442,14 @@ protected:
 	void renderWatermark(id<MTLCommandBuffer> mtlCmdBuff);
 
 	id<CAMetalDrawable> _mtlDrawable;
+	std::mutex _drawableLock;
+	std::condition_variable _drawablePrefetched;
+	bool _isPrefetchingDrawable;
 	MVKSwapchainImageAvailability _availability;
 	MVKVectorInline<MVKSwapchainSignaler, 1> _availabilitySignalers;
 	MVKSwapchainSignaler _preSignaler;
 	std::mutex _availabilityLock;
+	VkExtent2D _renderExtent;
 };
 
 
@@ -420,6 +498,9 @@ public:
 	/** Returns the Metal texture underlying this image view. */
 	id<MTLTexture> getMTLTexture();
 
+	/** Returns whether the Metal texture underlying this image view can change over the life of this image view. */
+	inline bool hasVolatileMTLTexture() { return _image && _image->hasVolatileMTLTexture(); }
+
 	/** Returns the Metal pixel format of this image view. */
 	inline MTLPixelFormat getMTLPixelFormat() { return _mtlPixelFormat; }
 
@@ -429,6 +510,12 @@ public:
 	/** Returns the packed component swizzle of this image view. */
 	inline uint32_t getPackedSwizzle() { return _packedSwizzle; }
 
+	/** Returns the image viewed by this image view. */
+	inline MVKImage* getImage() { return _image; }
+
+	/** Returns the range of the subresources of the image that are viewed by this image view. */
+	inline const VkImageSubresourceRange& getSubresourceRange() { return _subresourceRange; }
+
 	/**
 	 * Populates the texture of the specified render pass descriptor
 	 * with the Metal texture underlying this image.
@@ -510,14 +597,17 @@ public:
 	inline id<MTLSamplerState> getMTLSamplerState() { return _mtlSamplerState; }
 
 	/**
-	 * If this sampler requires hardcoding in MSL, populates the hardcoded sampler in the resource binding.
-	 * Returns whether this sampler requires hardcoding in MSL, and the constant sampler was populated.
+	 * If this sampler can be hardcoded in MSL, populates the hardcoded sampler in the resource binding.
+	 * Returns whether this sampler can be hardcoded in MSL, and the constant sampler was populated.
 	 */
 	bool getConstexprSampler(mvk::MSLResourceBinding& resourceBinding);
 
 	/** Returns whether this sampler must be implemented as a hardcoded constant sampler in the shader MSL code. */
 	inline 	bool getRequiresConstExprSampler() { return _requiresConstExprSampler; }
 
+	/** Returns whether this sampler can be implemented as a hardcoded constant sampler in the shader MSL code. */
+	inline 	bool getCanUseConstExprSampler() { return _requiresConstExprSampler || _canUseConstExprSampler; }
+
 	MVKSampler(MVKDevice* device, const VkSamplerCreateInfo* pCreateInfo);
 
 	~MVKSampler() override;
@@ -526,8 +616,11 @@ protected:
 	void propogateDebugName() override {}
 	MTLSamplerDescriptor* newMTLSamplerDescriptor(const VkSamplerCreateInfo* pCreateInfo);
 	void initConstExprSampler(const VkSamplerCreateInfo* pCreateInfo);
+	bool canExpressAsConstExprSampler(const VkSamplerCreateInfo* pCreateInfo);
+	bool needsLODClamp(const VkSamplerCreateInfo* pCreateInfo);
 
 	id<MTLSamplerState> _mtlSamplerState;
 	SPIRV_CROSS_NAMESPACE::MSLConstexprSampler _constExprSampler;
 	bool _requiresConstExprSampler;
+	bool _canUseConstExprSampler;
 };
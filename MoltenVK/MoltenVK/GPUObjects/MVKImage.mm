@@ -39,7 +39,8 @@ void MVKImage::propogateDebugName() { setLabelIfNotNil(_mtlTexture, _debugName);
 
 VkImageType MVKImage::getImageType() { return mvkVkImageTypeFromMTLTextureType(_mtlTextureType); }
 
-VkFormat MVKImage::getVkFormat() { return getPixelFormats()->getVkFormat(_mtlPixelFormat); }
+// A decompressed image uses a substitute uncompressed MTLPixelFormat, which does not map back to the VkFormat.
+VkFormat MVKImage::getVkFormat() { return _needsDecompression ? _vkFormat : getPixelFormats()->getVkFormat(_mtlPixelFormat); }
 
 bool MVKImage::getIsDepthStencil() { return getPixelFormats()->getFormatType(_mtlPixelFormat) == kMVKFormatDepthStencil; }
 
@@ -49,13 +50,20 @@ VkExtent3D MVKImage::getExtent3D(uint32_t mipLevel) {
 	return mvkMipmapLevelSizeFromBaseSize3D(_extent, mipLevel);
 }
 
+// The memory of a decompressed image holds the compressed content, laid out in the compressed VkFormat.
 VkDeviceSize MVKImage::getBytesPerRow(uint32_t mipLevel) {
-    size_t bytesPerRow = getPixelFormats()->getBytesPerRow(_mtlPixelFormat, getExtent3D(mipLevel).width);
+	uint32_t width = getExtent3D(mipLevel).width;
+	size_t bytesPerRow = (_needsDecompression
+						  ? getPixelFormats()->getBytesPerRow(_vkFormat, width)
+						  : getPixelFormats()->getBytesPerRow(_mtlPixelFormat, width));
     return mvkAlignByteCount(bytesPerRow, _rowByteAlignment);
 }
 
 VkDeviceSize MVKImage::getBytesPerLayer(uint32_t mipLevel) {
-    return getPixelFormats()->getBytesPerLayer(_mtlPixelFormat, getBytesPerRow(mipLevel), getExtent3D(mipLevel).height);
+	uint32_t height = getExtent3D(mipLevel).height;
+	return (_needsDecompression
+			? getPixelFormats()->getBytesPerLayer(_vkFormat, getBytesPerRow(mipLevel), height)
+			: getPixelFormats()->getBytesPerLayer(_mtlPixelFormat, getBytesPerRow(mipLevel), height));
 }
 
 VkResult MVKImage::getSubresourceLayout(const VkImageSubresource* pSubresource,
@@ -208,21 +216,42 @@ VkResult MVKImage::bindDeviceMemory2(const VkBindImageMemoryInfo* pBindInfo) {
 	return bindDeviceMemory((MVKDeviceMemory*)pBindInfo->memory, pBindInfo->memoryOffset);
 }
 
+// A linear image bound to host-accessible memory overlays the MTLBuffer of that memory, so host writes through
+// a memory mapping are visible to the GPU directly, without copying memory content into a separate MTLTexture.
+// If the memory does not yet have a MTLBuffer, and is not currently mapped, a MTLBuffer is created for it here.
+// If the image cannot overlay the MTLBuffer, content is copied between the memory and the MTLTexture.
 bool MVKImage::validateUseTexelBuffer() {
 	VkExtent2D blockExt = getPixelFormats()->getBlockTexelSize(_mtlPixelFormat);
 	bool isUncompressed = blockExt.width == 1 && blockExt.height == 1;
 
 	bool useTexelBuffer = _device->_pMetalFeatures->texelBuffers;								// Texel buffers available
 	useTexelBuffer = useTexelBuffer && (isMemoryHostAccessible() || _device->_pMetalFeatures->placementHeaps) && _isLinear && isUncompressed;	// Applicable memory layout
-	useTexelBuffer = useTexelBuffer && _deviceMemory && _deviceMemory->_mtlBuffer;				// Buffer is available to overlay
+	if ( !useTexelBuffer || !_deviceMemory ) { return false; }
 
 #if MVK_MACOS
 	// macOS cannot use shared memory for texel buffers.
 	// Test _deviceMemory->isMemoryHostCoherent() directly because local version overrides.
-	useTexelBuffer = useTexelBuffer && _deviceMemory && !_deviceMemory->isMemoryHostCoherent();
+	if (_deviceMemory->isMemoryHostCoherent()) { return false; }
 #endif
 
-	return useTexelBuffer;
+	const char* fallbackReason = nullptr;
+	if ( !_deviceMemory->_mtlBuffer && isMemoryHostAccessible() && !_deviceMemory->_isMapped ) {
+		_deviceMemory->ensureMTLBuffer();
+	}
+	VkDeviceSize mtlBuffOffset = _deviceMemory->getMTLBufferOffset() + getDeviceMemoryOffset();
+	if ( !_deviceMemory->_mtlBuffer ) {
+		fallbackReason = _deviceMemory->_isMapped ? "the memory was mapped before the image was bound" : "the memory has no MTLBuffer";
+	} else if (mvkAlignByteRef(mtlBuffOffset, _rowByteAlignment) != mtlBuffOffset) {
+		fallbackReason = "the memory offset is not aligned to VkMemoryRequirements::alignment";
+	}
+
+	if (fallbackReason) {
+		if (isMemoryHostAccessible()) {
+			MVKLogInfo("VkImage %p: Linear image content will be copied to a separate MTLTexture, because %s.", this, fallbackReason);
+		}
+		return false;
+	}
+	return true;
 }
 
 bool MVKImage::shouldFlushHostMemory() { return isMemoryHostAccessible() && !_usesTexelBuffer; }
@@ -285,21 +314,66 @@ id<MTLTexture> MVKImage::getMTLTexture() {
 id<MTLTexture> MVKImage::getMTLTexture(MTLPixelFormat mtlPixFmt) {
 	if (mtlPixFmt == _mtlPixelFormat) { return getMTLTexture(); }
 
-	id<MTLTexture> mtlTex = _mtlTextureViews[mtlPixFmt];
+	// Inline views are immutable once published, so they can be searched without locking.
+	uint32_t viewCnt = _mtlTextureViewCount.load(memory_order_acquire);
+	for (uint32_t viewIdx = 0; viewIdx < viewCnt; viewIdx++) {
+		auto& texView = _mtlTextureViews[viewIdx];
+		if (texView.mtlPixelFormat == mtlPixFmt) { return texView.mtlTexture; }
+	}
+
+	// Lock and check again in case another thread has created the view texture.
+	// baseTex retreived outside of lock to avoid deadlock if it too needs to be lazily created.
+	id<MTLTexture> baseTex = getMTLTexture();
+	lock_guard<mutex> lock(_lock);
+	id<MTLTexture> mtlTex = getCachedMTLTextureView(mtlPixFmt);
 	if ( !mtlTex ) {
-		// Lock and check again in case another thread has created the view texture.
-		// baseTex retreived outside of lock to avoid deadlock if it too needs to be lazily created.
-		id<MTLTexture> baseTex = getMTLTexture();
-		lock_guard<mutex> lock(_lock);
-		mtlTex = _mtlTextureViews[mtlPixFmt];
-		if ( !mtlTex ) {
-			mtlTex = [baseTex newTextureViewWithPixelFormat: mtlPixFmt];	// retained
-			_mtlTextureViews[mtlPixFmt] = mtlTex;
+		mtlTex = [baseTex newTextureViewWithPixelFormat: mtlPixFmt];	// retained
+		viewCnt = _mtlTextureViewCount.load(memory_order_relaxed);
+		if (viewCnt < kMVKMaxInlineTextureViews) {
+			_mtlTextureViews[viewCnt] = { mtlPixFmt, mtlTex };
+			_mtlTextureViewCount.store(viewCnt + 1, memory_order_release);
+		} else {
+			_mtlTextureViewOverflow[mtlPixFmt] = mtlTex;
 		}
 	}
 	return mtlTex;
 }
 
+// Returns the texture view with the pixel format, or nil if it has not been created.
+// The image lock must be held when calling this function.
+id<MTLTexture> MVKImage::getCachedMTLTextureView(MTLPixelFormat mtlPixFmt) {
+	uint32_t viewCnt = _mtlTextureViewCount.load(memory_order_relaxed);
+	for (uint32_t viewIdx = 0; viewIdx < viewCnt; viewIdx++) {
+		auto& texView = _mtlTextureViews[viewIdx];
+		if (texView.mtlPixelFormat == mtlPixFmt) { return texView.mtlTexture; }
+	}
+	auto iter = _mtlTextureViewOverflow.find(mtlPixFmt);
+	return (iter != _mtlTextureViewOverflow.end()) ? iter->second : nil;
+}
+
+// Returns whether this image is a transient attachment that can be backed by memoryless storage.
+// Input attachments may be read as textures if their subpass cannot be merged with the previous
+// subpass, so they must reserve memory.
+bool MVKImage::isMemorylessAttachment() {
+	return (mvkAreAllFlagsEnabled(_usage, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) &&
+			!mvkIsAnyFlagEnabled(_usage, VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT) &&
+			!_isLinear && !_ioSurface);
+}
+
+// Returns whether this image may share its memory with other resources, because it was created with
+// VK_IMAGE_CREATE_ALIAS_BIT, is a transient attachment, such as those whose memory a render graph reuses
+// across passes, or is bound to a range of memory that overlaps another buffer or image bound to it.
+bool MVKImage::isAliasingMemory() {
+	if (_isAliasable || mvkIsAnyFlagEnabled(_usage, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)) { return true; }
+	return _deviceMemory && _deviceMemory->hasOverlappingResource(this);
+}
+
+// A memory sub-allocated within a larger MTLHeap may not meet the alignment this texture requires within the MTLHeap.
+bool MVKImage::isMTLHeapOffsetAligned() {
+	NSUInteger mtlHeapOffset = _deviceMemory->getMTLHeapOffset() + getDeviceMemoryOffset();
+	return mvkAlignByteCount(mtlHeapOffset, _byteAlignment) == mtlHeapOffset;
+}
+
 id<MTLTexture> MVKImage::newMTLTexture() {
 	id<MTLTexture> mtlTex = nil;
 	MTLTextureDescriptor* mtlTexDesc = newMTLTextureDescriptor();	// temp retain
@@ -308,14 +382,25 @@ id<MTLTexture> MVKImage::newMTLTexture() {
 		mtlTex = [getMTLDevice() newTextureWithDescriptor: mtlTexDesc iosurface: _ioSurface plane: 0];
 	} else if (_usesTexelBuffer) {
 		mtlTex = [_deviceMemory->_mtlBuffer newTextureWithDescriptor: mtlTexDesc
-															  offset: getDeviceMemoryOffset()
+															  offset: _deviceMemory->getMTLBufferOffset() + getDeviceMemoryOffset()
 														 bytesPerRow: _subresources[0].layout.rowPitch];
-	} else if (_deviceMemory->_mtlHeap && !getIsDepthStencil()) {	// Metal support for depth/stencil from heaps is flaky
+	} else if (_deviceMemory->_mtlHeap &&
+			   (!getIsDepthStencil() || isAliasingMemory()) &&	// Metal support for depth/stencil from heaps is flaky, so only when aliasing
+			   mtlTexDesc.storageModeMVK != MTLStorageModeMemoryless && isMTLHeapOffsetAligned()) {
+		// Placed at the offset of the image within the memory, so it shares storage with any resources bound to overlapping ranges.
 		mtlTex = [_deviceMemory->_mtlHeap newTextureWithDescriptor: mtlTexDesc
-															offset: getDeviceMemoryOffset()];
+															offset: _deviceMemory->getMTLHeapOffset() + getDeviceMemoryOffset()];
 		if (_isAliasable) [mtlTex makeAliasable];
 	} else {
+		if (mtlTexDesc.storageModeMVK != MTLStorageModeMemoryless && _deviceMemory && _deviceMemory->hasOverlappingResource(this)) {
+			reportMessage(ASL_LEVEL_WARNING, "vkBindImageMemory(): The VkImage is bound to memory that overlaps another resource, but its texture cannot be placed in a Metal heap at offset %llu, so it does not alias that resource, and uses additional memory.",
+						  (unsigned long long)getDeviceMemoryOffset());
+		}
 		mtlTex = [getMTLDevice() newTextureWithDescriptor: mtlTexDesc];
+		if ([mtlTex respondsToSelector: @selector(allocatedSize)]) {
+			_mtlTextureByteCount = mtlTex.allocatedSize;
+			_device->updateMTLStorageModeByteCount(_device->_resourceStatistics.imageTextureBytes, mtlTex.storageMode, _mtlTextureByteCount);
+		}
 	}
 
 	[mtlTexDesc release];											// temp release
@@ -339,6 +424,7 @@ VkResult MVKImage::setMTLTexture(id<MTLTexture> mtlTexture) {
 	_samples = mvkVkSampleCountFlagBitsFromSampleCount(mtlTexture.sampleCount);
 	_arrayLayers = uint32_t(mtlTexture.arrayLength);
 	_usage = getPixelFormats()->getVkImageUsageFlags(mtlTexture.usage, _mtlPixelFormat);
+	_hasPixelFormatViews = mvkIsAnyFlagEnabled(mtlTexture.usage, MTLTextureUsagePixelFormatView);
 
 	if (_device->_pMetalFeatures->ioSurfaces) {
 		_ioSurface = mtlTexture.iosurface;
@@ -350,10 +436,17 @@ VkResult MVKImage::setMTLTexture(id<MTLTexture> mtlTexture) {
 
 // Removes and releases the MTLTexture object, and all associated texture views
 void MVKImage::releaseMTLTexture() {
+	if (_mtlTextureByteCount) {
+		_device->updateMTLStorageModeByteCount(_device->_resourceStatistics.imageTextureBytes, _mtlTexture.storageMode, -int64_t(_mtlTextureByteCount));
+		_mtlTextureByteCount = 0;
+	}
 	[_mtlTexture release];
 	_mtlTexture = nil;
-	for (auto elem : _mtlTextureViews) { [elem.second release]; }
-	_mtlTextureViews.clear();
+	uint32_t viewCnt = _mtlTextureViewCount.load(memory_order_relaxed);
+	for (uint32_t viewIdx = 0; viewIdx < viewCnt; viewIdx++) { [_mtlTextureViews[viewIdx].mtlTexture release]; }
+	_mtlTextureViewCount.store(0, memory_order_release);
+	for (auto elem : _mtlTextureViewOverflow) { [elem.second release]; }
+	_mtlTextureViewOverflow.clear();
 }
 
 void MVKImage::releaseIOSurface() {
@@ -413,14 +506,12 @@ VkResult MVKImage::useIOSurface(IOSurfaceRef ioSurface) {
 MTLTextureDescriptor* MVKImage::newMTLTextureDescriptor() {
 	MTLPixelFormat mtlPixFmt = _mtlPixelFormat;
 	MTLTextureUsage minUsage = MTLTextureUsageUnknown;
-#if MVK_MACOS
-	if (_is3DCompressed) {
-		// Metal before 3.0 doesn't support 3D compressed textures, so we'll decompress
-		// the texture ourselves. This, then, is the *uncompressed* format.
+	if (_needsDecompression) {
+		// Metal doesn't support this compressed format, or doesn't support it in 3D textures before
+		// Metal 3.0, so we'll decompress the texture ourselves. This, then, is the *uncompressed* format.
 		mtlPixFmt = MTLPixelFormatBGRA8Unorm;
 		minUsage = MTLTextureUsageShaderWrite;
 	}
-#endif
 
 	MTLTextureDescriptor* mtlTexDesc = [MTLTextureDescriptor new];	// retained
 	mtlTexDesc.pixelFormat = mtlPixFmt;
@@ -431,9 +522,10 @@ MTLTextureDescriptor* MVKImage::newMTLTextureDescriptor() {
 	mtlTexDesc.mipmapLevelCount = _mipLevels;
 	mtlTexDesc.sampleCount = mvkSampleCountFromVkSampleCountFlagBits(_samples);
 	mtlTexDesc.arrayLength = _arrayLayers;
-	mtlTexDesc.usageMVK = getPixelFormats()->getMTLTextureUsage(_usage, mtlPixFmt, minUsage);
+	mtlTexDesc.usageMVK = getPixelFormats()->getMTLTextureUsage(_usage, mtlPixFmt, minUsage, _hasPixelFormatViews);
 	mtlTexDesc.storageModeMVK = getMTLStorageMode();
 	mtlTexDesc.cpuCacheMode = getMTLCPUCacheMode();
+	mtlTexDesc.resourceOptions |= _device->getMTLResourceHazardTrackingOptions();
 
 	return mtlTexDesc;
 }
@@ -445,6 +537,12 @@ MTLStorageMode MVKImage::getMTLStorageMode() {
 
     if (_ioSurface && stgMode == MTLStorageModePrivate) { stgMode = MTLStorageModeShared; }
 
+#if MVK_IOS
+	// Only a transient attachment bound to lazily allocated memory lives entirely in tile memory.
+	// Any other image bound to lazily allocated memory falls back to private storage.
+	if (stgMode == MTLStorageModeMemoryless && !isMemorylessAttachment()) { stgMode = MTLStorageModePrivate; }
+#endif
+
 #if MVK_MACOS
 	// For macOS, textures cannot use Shared storage mode, so change to Managed storage mode.
     if (stgMode == MTLStorageModeShared) { stgMode = MTLStorageModeManaged; }
@@ -487,14 +585,15 @@ void MVKImage::updateMTLTextureContent(MVKImageSubresource& subresource,
     mtlRegion.origin = MTLOriginMake(0, 0, 0);
     mtlRegion.size = mvkMTLSizeFromVkExtent3D(mipExtent);
 
-#if MVK_MACOS
+	// Copy the layout, because decompression replaces it with that of the decompressed data.
+	VkSubresourceLayout srcLayout = imgLayout;
     std::unique_ptr<char[]> decompBuffer;
-    if (_is3DCompressed) {
+    if (_needsDecompression) {
         // We cannot upload the texture data directly in this case. But we
         // can upload the decompressed image data.
         std::unique_ptr<MVKCodec> codec = mvkCreateCodec(getVkFormat());
         if (!codec) {
-            reportError(VK_ERROR_FORMAT_NOT_SUPPORTED, "A 3D texture used a compressed format that MoltenVK does not yet support.");
+            reportError(VK_ERROR_FORMAT_NOT_SUPPORTED, "An image used a compressed format that MoltenVK does not yet support.");
             return;
         }
         VkSubresourceLayout destLayout;
@@ -502,14 +601,13 @@ void MVKImage::updateMTLTextureContent(MVKImageSubresource& subresource,
         destLayout.depthPitch = destLayout.rowPitch * mipExtent.height;
         destLayout.size = destLayout.depthPitch * mipExtent.depth;
         decompBuffer = std::unique_ptr<char[]>(new char[destLayout.size]);
-        codec->decompress(decompBuffer.get(), pImgBytes, destLayout, imgLayout, mipExtent);
+        codec->decompress(decompBuffer.get(), pImgBytes, destLayout, srcLayout, mipExtent);
         pImgBytes = decompBuffer.get();
-        imgLayout = destLayout;
+        srcLayout = destLayout;
     }
-#endif
 
-	VkDeviceSize bytesPerRow = (imgType != VK_IMAGE_TYPE_1D) ? imgLayout.rowPitch : 0;
-	VkDeviceSize bytesPerImage = (imgType == VK_IMAGE_TYPE_3D) ? imgLayout.depthPitch : 0;
+	VkDeviceSize bytesPerRow = (imgType != VK_IMAGE_TYPE_1D) ? srcLayout.rowPitch : 0;
+	VkDeviceSize bytesPerImage = (imgType == VK_IMAGE_TYPE_3D) ? srcLayout.depthPitch : 0;
 
 	id<MTLTexture> mtlTex = getMTLTexture();
 	if (getPixelFormats()->isPVRTCFormat(mtlTex.pixelFormat)) {
@@ -544,6 +642,9 @@ void MVKImage::getMTLTextureContent(MVKImageSubresource& subresource,
 	void* pHostMem = getHostMemoryAddress();
 	if ( !pHostMem ) { return; }
 
+	// Decompressed texture content cannot be compressed back into the memory.
+	if (_needsDecompression) { return; }
+
     VkExtent3D mipExtent = getExtent3D(imgSubRez.mipLevel);
     VkImageType imgType = getImageType();
     void* pImgBytes = (void*)((uintptr_t)pHostMem + imgLayout.offset);
@@ -566,6 +667,7 @@ void MVKImage::getMTLTextureContent(MVKImageSubresource& subresource,
 MVKImage::MVKImage(MVKDevice* device, const VkImageCreateInfo* pCreateInfo) : MVKResource(device) {
 
 	_mtlTexture = nil;
+	_mtlTextureViewCount = 0;
 	_ioSurface = nil;
 	_usesTexelBuffer = false;
 
@@ -594,11 +696,16 @@ MVKImage::MVKImage(MVKDevice* device, const VkImageCreateInfo* pCreateInfo) : MV
 	_mtlPixelFormat = pixFmts->getMTLPixelFormat(pCreateInfo->format);
 	_usage = pCreateInfo->usage;
 
-	_is3DCompressed = (getImageType() == VK_IMAGE_TYPE_3D) && (pixFmts->getFormatType(pCreateInfo->format) == kMVKFormatCompressed) && !_device->_pMetalFeatures->native3DCompressedTextures;
+	_vkFormat = pCreateInfo->format;
+	_needsDecompression = ((pixFmts->getFormatType(pCreateInfo->format) == kMVKFormatCompressed) &&
+						   mvkCanDecodeFormat(pCreateInfo->format) &&
+						   (!pixFmts->isSupported(pCreateInfo->format) ||
+							((getImageType() == VK_IMAGE_TYPE_3D) && !_device->_pMetalFeatures->native3DCompressedTextures)));
 	_isDepthStencilAttachment = (mvkAreAllFlagsEnabled(pCreateInfo->usage, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) ||
 								 mvkAreAllFlagsEnabled(pixFmts->getVkFormatProperties(pCreateInfo->format).optimalTilingFeatures, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT));
 	_canSupportMTLTextureView = !_isDepthStencilAttachment || _device->_pMetalFeatures->stencilViews;
 	_hasExpectedTexelSize = (pixFmts->getBytesPerBlock(_mtlPixelFormat) == pixFmts->getBytesPerBlock(pCreateInfo->format));
+	_hasPixelFormatViews = needsPixelFormatViews(pCreateInfo);		// Before newMTLTextureDescriptor()
 
 	_rowByteAlignment = _isLinear ? _device->getVkFormatTexelBufferAlignment(pCreateInfo->format, this) : mvkEnsurePowerOfTwo(pixFmts->getBytesPerBlock(pCreateInfo->format));
 	if (!_isLinear && _device->_pMetalFeatures->placementHeaps) {
@@ -755,6 +862,42 @@ bool MVKImage::validateLinear(const VkImageCreateInfo* pCreateInfo, bool isAttac
 	return isLin;
 }
 
+// Returns whether the Metal texture must support views that reinterpret its pixel format, which
+// prevents lossless compression of the texture on Apple GPUs. Views of other formats are only
+// permitted for images with a mutable format, and an image format list may show that the Metal
+// pixel formats of all the views are the same as that of the image. Without native swizzling,
+// image views apply some swizzles by reinterpreting the pixel format, so views are always needed.
+bool MVKImage::needsPixelFormatViews(const VkImageCreateInfo* pCreateInfo) {
+	if ( !_device->_pMetalFeatures->nativeTextureSwizzle ) { return true; }
+	if ( !mvkIsAnyFlagEnabled(pCreateInfo->flags, VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT) ) { return false; }
+
+	bool needsViews = true;
+	for (const auto* next = (const VkBaseInStructure*)pCreateInfo->pNext; next; next = next->pNext) {
+		switch (next->sType) {
+			case VK_STRUCTURE_TYPE_IMAGE_FORMAT_LIST_CREATE_INFO_KHR: {
+				// An empty list does not restrict the formats of the views.
+				auto* pFmtList = (const VkImageFormatListCreateInfoKHR*)next;
+				if (pFmtList->viewFormatCount == 0) { break; }
+
+				MVKPixelFormats* pixFmts = getPixelFormats();
+				needsViews = false;
+				for (uint32_t fmtIdx = 0; fmtIdx < pFmtList->viewFormatCount; fmtIdx++) {
+					if (pixFmts->getMTLPixelFormat(pFmtList->pViewFormats[fmtIdx]) != _mtlPixelFormat) { needsViews = true; }
+				}
+				break;
+			}
+			default:
+				break;
+		}
+	}
+
+	if (needsViews && mvkIsAnyFlagEnabled(pCreateInfo->usage, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)) {
+		MVKLogInfo("vkCreateImage(): The color attachment image has a mutable format, so its Metal texture must support pixel format views, which prevents lossless compression of the texture on some GPUs."
+				   " Listing only compatible view formats in VkImageFormatListCreateInfo, or omitting VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT, allows the texture to be compressed.");
+	}
+	return needsViews;
+}
+
 
 // Initializes the subresource definitions.
 void MVKImage::initSubresources(const VkImageCreateInfo* pCreateInfo) {
@@ -895,6 +1038,7 @@ void MVKPresentableSwapchainImage::acquireAndSignalWhenAvailable(MVKSemaphore* s
 	// Now that this image is being acquired, release the existing drawable and its texture.
 	// This is not done earlier so the texture is retained for any post-processing such as screen captures, etc.
 	releaseMetalDrawable();
+	prefetchCAMetalDrawable();
 
 	auto signaler = make_pair(semaphore, fence);
 	if (_availability.isAvailable) {
@@ -906,7 +1050,7 @@ void MVKPresentableSwapchainImage::acquireAndSignalWhenAvailable(MVKSemaphore* s
 		@autoreleasepool {
 			MVKSemaphore* mvkSem = signaler.first;
 			id<MTLCommandBuffer> mtlCmdBuff = (mvkSem && mvkSem->isUsingCommandEncoding()
-											   ? [_device->getAnyQueue()->getMTLCommandQueue() commandBufferWithUnretainedReferences]
+											   ? _device->getAnyQueue()->getMTLCommandBuffer()
 											   : nil);
 			signal(signaler, mtlCmdBuff);
 			[mtlCmdBuff commit];
@@ -927,13 +1071,13 @@ void MVKPresentableSwapchainImage::signalPresentationSemaphore(id<MTLCommandBuff
 
 	if ( !_availabilitySignalers.empty() ) {
 		MVKSemaphore* mvkSem = _availabilitySignalers.front().first;
-		if (mvkSem) { mvkSem->encodeSignal(mtlCmdBuff); }
+		if (mvkSem) { mvkSem->encodeSignal(mtlCmdBuff, 0); }
 	}
 }
 
 // Signal either or both of the semaphore and fence in the specified tracker pair.
 void MVKPresentableSwapchainImage::signal(MVKSwapchainSignaler& signaler, id<MTLCommandBuffer> mtlCmdBuff) {
-	if (signaler.first) { signaler.first->encodeSignal(mtlCmdBuff); }
+	if (signaler.first) { signaler.first->encodeSignal(mtlCmdBuff, 0); }
 	if (signaler.second) { signaler.second->signal(); }
 }
 
@@ -953,26 +1097,79 @@ void MVKPresentableSwapchainImage::unmarkAsTracked(MVKSwapchainSignaler& signale
 #pragma mark Metal
 
 id<CAMetalDrawable> MVKPresentableSwapchainImage::getCAMetalDrawable() {
-	while ( !_mtlDrawable ) {
+	awaitPrefetchedCAMetalDrawable();
+	if ( !_mtlDrawable ) { _mtlDrawable = newCAMetalDrawable(); }
+	return _mtlDrawable;
+}
+
+// Returns a retained drawable, blocking until the CAMetalLayer can provide one.
+id<CAMetalDrawable> MVKPresentableSwapchainImage::newCAMetalDrawable() {
+	uint64_t signpostID = mvkSignpostBegin(kMVKSignpostDrawableAcquisition);
+	id<CAMetalDrawable> mtlDrawable = nil;
+	while ( !mtlDrawable ) {
 		@autoreleasepool {      // Reclaim auto-released drawable object before end of loop
 			uint64_t startTime = _device->getPerformanceTimestamp();
 
-			_mtlDrawable = [_swapchain->_mtlLayer.nextDrawable retain];
-			if ( !_mtlDrawable ) { MVKLogError("CAMetalDrawable could not be acquired."); }
+			mtlDrawable = [_swapchain->_mtlLayer.nextDrawable retain];
+			if ( !mtlDrawable ) { MVKLogError("CAMetalDrawable could not be acquired."); }
 
 			_device->addActivityPerformance(_device->_performanceStatistics.queue.nextCAMetalDrawable, startTime);
 		}
 	}
-	return _mtlDrawable;
+	mvkSignpostEnd(kMVKSignpostDrawableAcquisition, signpostID);
+	return mtlDrawable;
+}
+
+// If the swapchain is prefetching drawables, acquires the drawable for this image on the
+// swapchain prefetch queue, so it is ready by the time it is needed for rendering or presenting.
+void MVKPresentableSwapchainImage::prefetchCAMetalDrawable() {
+	dispatch_queue_t prefetchQueue = _swapchain->getDrawablePrefetchQueue();
+	if ( !prefetchQueue ) { return; }
+
+	lock_guard<mutex> lock(_drawableLock);
+	if (_mtlDrawable || _isPrefetchingDrawable) { return; }
+	_isPrefetchingDrawable = true;
+
+	retain();	// Ensure this image is not destroyed while the drawable is being prefetched
+	dispatch_async(prefetchQueue, ^{
+		id<CAMetalDrawable> mtlDrawable = newCAMetalDrawable();
+		{
+			lock_guard<mutex> prefetchLock(_drawableLock);
+			_mtlDrawable = mtlDrawable;
+			_isPrefetchingDrawable = false;
+		}
+		_drawablePrefetched.notify_all();
+		release();
+	});
+}
+
+// If the drawable for this image is being prefetched, blocks until it is available.
+// Returns immediately if the swapchain is not prefetching drawables.
+void MVKPresentableSwapchainImage::awaitPrefetchedCAMetalDrawable() {
+	if ( !_swapchain->getDrawablePrefetchQueue() ) { return; }
+
+	unique_lock<mutex> lock(_drawableLock);
+	_drawablePrefetched.wait(lock, [this]{ return !_isPrefetchingDrawable; });
 }
 
 // Present the drawable and make myself available only once the command buffer has completed.
-void MVKPresentableSwapchainImage::presentCAMetalDrawable(id<MTLCommandBuffer> mtlCmdBuff) {
-	_swapchain->willPresentSurface(getMTLTexture(), mtlCmdBuff);
+void MVKPresentableSwapchainImage::presentCAMetalDrawable(id<MTLCommandBuffer> mtlCmdBuff,
+															const MVKImagePresentInfo& presentInfo) {
+	_swapchain->willPresentSurface(getMTLTexture(), mtlCmdBuff, presentInfo.renderExtent);
 
+	// Display timing uses nanoseconds of host time, and Core Animation uses seconds of the same clock.
+	id<CAMetalDrawable> mtlDrawable = getCAMetalDrawable();
 	NSString* scName = _swapchain->getDebugName();
+	if (presentInfo.hasPresentTime) { _swapchain->trackPresentationTiming(mtlDrawable, presentInfo); }
+
 	if (scName) { mvkPushDebugGroup(mtlCmdBuff, scName); }
-	[mtlCmdBuff presentDrawable: getCAMetalDrawable()];
+	if (_swapchain->isMailbox()) {
+		_swapchain->presentLatestCAMetalDrawable(mtlDrawable, mtlCmdBuff, presentInfo.desiredPresentTime);
+	} else if (presentInfo.desiredPresentTime) {
+		[mtlCmdBuff presentDrawable: mtlDrawable atTime: (double)presentInfo.desiredPresentTime * 1.0e-9];
+	} else {
+		[mtlCmdBuff presentDrawable: mtlDrawable];
+	}
 	if (scName) { mvkPopDebugGroup(mtlCmdBuff); }
 
 	signalPresentationSemaphore(mtlCmdBuff);
@@ -984,8 +1181,22 @@ void MVKPresentableSwapchainImage::presentCAMetalDrawable(id<MTLCommandBuffer> m
 	}];
 }
 
+// A render extent that covers the entire image is recorded as a zero extent, so presentation need not compare it.
+void MVKPresentableSwapchainImage::setRenderExtent(const VkExtent2D* pRenderExtent) {
+	VkExtent3D imgExtent = getExtent3D();
+	bool isFullExtent = ( !pRenderExtent || pRenderExtent->width == 0 || pRenderExtent->height == 0 ||
+						 (pRenderExtent->width >= imgExtent.width && pRenderExtent->height >= imgExtent.height) );
+	if (isFullExtent) {
+		_renderExtent = {0, 0};
+	} else {
+		_renderExtent.width = min(pRenderExtent->width, imgExtent.width);
+		_renderExtent.height = min(pRenderExtent->height, imgExtent.height);
+	}
+}
+
 // Resets the MTLTexture and CAMetalDrawable underlying this image.
 void MVKPresentableSwapchainImage::releaseMetalDrawable() {
+	awaitPrefetchedCAMetalDrawable();
 	releaseMTLTexture();			// Release texture first so drawable will be last to release it
 	[_mtlDrawable release];
 	_mtlDrawable = nil;
@@ -1001,10 +1212,12 @@ MVKPresentableSwapchainImage::MVKPresentableSwapchainImage(MVKDevice* device,
 	MVKSwapchainImage(device, pCreateInfo, swapchain, swapchainIndex) {
 
 	_mtlDrawable = nil;
+	_isPrefetchingDrawable = false;
 
 	_availability.acquisitionID = _swapchain->getNextAcquisitionID();
 	_availability.isAvailable = true;
 	_preSignaler = make_pair(nullptr, nullptr);
+	_renderExtent = {0, 0};
 }
 
 MVKPresentableSwapchainImage::~MVKPresentableSwapchainImage() {
@@ -1164,6 +1377,15 @@ MVKImageView::MVKImageView(MVKDevice* device,
 														  _device->_pMetalFeatures->nativeTextureSwizzle,
 														  _device->_pMVKConfig->fullImageViewSwizzle,
 														  _mtlPixelFormat, useSwizzle));
+	// If the swizzle would be applied by reinterpreting the pixel format, but the texture of the
+	// image does not support pixel format views, apply the swizzle natively instead.
+	MTLPixelFormat viewMTLPixFmt = getPixelFormats()->getMTLPixelFormat(pCreateInfo->format);
+	if (_image && !_image->hasPixelFormatViews() && !useSwizzle &&
+		_mtlPixelFormat != viewMTLPixFmt && viewMTLPixFmt == _image->getMTLPixelFormat() &&
+		pCreateInfo->subresourceRange.aspectMask != VK_IMAGE_ASPECT_STENCIL_BIT) {
+		_mtlPixelFormat = viewMTLPixFmt;
+		useSwizzle = true;
+	}
 	_packedSwizzle = useSwizzle ? mvkPackSwizzle(pCreateInfo->components) : 0;
 	_mtlTextureType = mvkMTLTextureTypeFromVkImageViewType(pCreateInfo->viewType,
 														   _image->getSampleCount() != VK_SAMPLE_COUNT_1_BIT);
@@ -1330,11 +1552,11 @@ MVKImageView::~MVKImageView() {
 #pragma mark MVKSampler
 
 bool MVKSampler::getConstexprSampler(mvk::MSLResourceBinding& resourceBinding) {
-	resourceBinding.requiresConstExprSampler = _requiresConstExprSampler;
-	if (_requiresConstExprSampler) {
+	resourceBinding.requiresConstExprSampler = getCanUseConstExprSampler();
+	if (resourceBinding.requiresConstExprSampler) {
 		resourceBinding.constExprSampler = _constExprSampler;
 	}
-	return _requiresConstExprSampler;
+	return resourceBinding.requiresConstExprSampler;
 }
 
 // Returns an Metal sampler descriptor constructed from the properties of this image.
@@ -1357,6 +1579,11 @@ MTLSamplerDescriptor* MVKSampler::newMTLSamplerDescriptor(const VkSamplerCreateI
 								 : 1);
 	mtlSampDesc.normalizedCoordinates = !pCreateInfo->unnormalizedCoordinates;
 
+	// Samplers must be explicitly enabled for encoding into Metal argument buffers.
+	if (_device->shouldUseMetalArgumentBuffers()) {
+		mtlSampDesc.supportArgumentBuffers = YES;
+	}
+
 	// If compareEnable is true, but dynamic samplers with depth compare are not available
 	// on this device, this sampler must only be used as an immutable sampler, and will
 	// be automatically hardcoded into the shader MSL. An error will be triggered if this
@@ -1384,9 +1611,11 @@ MTLSamplerDescriptor* MVKSampler::newMTLSamplerDescriptor(const VkSamplerCreateI
 
 MVKSampler::MVKSampler(MVKDevice* device, const VkSamplerCreateInfo* pCreateInfo) : MVKVulkanAPIDeviceObject(device) {
 	_requiresConstExprSampler = pCreateInfo->compareEnable && !_device->_pMetalFeatures->depthSampleCompare;
+	_canUseConstExprSampler = _device->shouldUseConstExprImmutableSamplers() && canExpressAsConstExprSampler(pCreateInfo);
 
+	// Equivalent samplers share a MTLSamplerState across the device.
 	MTLSamplerDescriptor* mtlSampDesc = newMTLSamplerDescriptor(pCreateInfo);	// temp retain
-    _mtlSamplerState = [getMTLDevice() newSamplerStateWithDescriptor: mtlSampDesc];
+	_mtlSamplerState = _device->getCommandResourceFactory()->getMTLSamplerState(mtlSampDesc);
 	[mtlSampDesc release];														// temp release
 
 	initConstExprSampler(pCreateInfo);
@@ -1457,14 +1686,35 @@ static MSLSamplerBorderColor getSpvBorderColorFromVkBorderColor(VkBorderColor vk
 			return MSL_SAMPLER_BORDER_COLOR_TRANSPARENT_BLACK;
 	}
 }
-\
+
+// Returns whether the LOD range of the sampler is narrower than the full range.
+bool MVKSampler::needsLODClamp(const VkSamplerCreateInfo* pCreateInfo) {
+	return pCreateInfo->minLod > 0.0f || pCreateInfo->maxLod < VK_LOD_CLAMP_NONE;
+}
+
+// Returns whether the sampler state can be reproduced exactly by an MSL constexpr sampler.
+// MSL has no mirror-clamp-to-edge address mode, respects border colors only when the device
+// supports clamping to a border color, and supports LOD clamping only from MSL 2.0.
+bool MVKSampler::canExpressAsConstExprSampler(const VkSamplerCreateInfo* pCreateInfo) {
+	VkSamplerAddressMode addrModes[] = { pCreateInfo->addressModeU, pCreateInfo->addressModeV, pCreateInfo->addressModeW };
+	for (auto addrMode : addrModes) {
+		if (addrMode == VK_SAMPLER_ADDRESS_MODE_MIRROR_CLAMP_TO_EDGE) { return false; }
+		if (addrMode == VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER &&
+			!_device->_pMetalFeatures->samplerClampToBorder) { return false; }
+	}
+	if (needsLODClamp(pCreateInfo) && _device->_pMetalFeatures->mslVersion < 20000) { return false; }
+	return true;
+}
+
 void MVKSampler::initConstExprSampler(const VkSamplerCreateInfo* pCreateInfo) {
-	if ( !_requiresConstExprSampler ) { return; }
+	if ( !getCanUseConstExprSampler() ) { return; }
 
 	_constExprSampler.coord = pCreateInfo->unnormalizedCoordinates ? MSL_SAMPLER_COORD_PIXEL : MSL_SAMPLER_COORD_NORMALIZED;
 	_constExprSampler.min_filter = getSpvMinMagFilterFromVkFilter(pCreateInfo->minFilter);
 	_constExprSampler.mag_filter = getSpvMinMagFilterFromVkFilter(pCreateInfo->magFilter);
-	_constExprSampler.mip_filter = getSpvMipFilterFromVkMipMode(pCreateInfo->mipmapMode);
+	_constExprSampler.mip_filter = (pCreateInfo->unnormalizedCoordinates
+									? MSL_SAMPLER_MIP_FILTER_NONE
+									: getSpvMipFilterFromVkMipMode(pCreateInfo->mipmapMode));
 	_constExprSampler.s_address = getSpvAddressModeFromVkAddressMode(pCreateInfo->addressModeU);
 	_constExprSampler.t_address = getSpvAddressModeFromVkAddressMode(pCreateInfo->addressModeV);
 	_constExprSampler.r_address = getSpvAddressModeFromVkAddressMode(pCreateInfo->addressModeW);
@@ -1472,12 +1722,14 @@ void MVKSampler::initConstExprSampler(const VkSamplerCreateInfo* pCreateInfo) {
 	_constExprSampler.border_color = getSpvBorderColorFromVkBorderColor(pCreateInfo->borderColor);
 	_constExprSampler.lod_clamp_min = pCreateInfo->minLod;
 	_constExprSampler.lod_clamp_max = pCreateInfo->maxLod;
-	_constExprSampler.max_anisotropy = pCreateInfo->maxAnisotropy;
+	_constExprSampler.max_anisotropy = (pCreateInfo->anisotropyEnable
+										? mvkClamp(pCreateInfo->maxAnisotropy, 1.0f, _device->_pProperties->limits.maxSamplerAnisotropy)
+										: 1);
 	_constExprSampler.compare_enable = pCreateInfo->compareEnable;
-	_constExprSampler.lod_clamp_enable = false;
+	_constExprSampler.lod_clamp_enable = needsLODClamp(pCreateInfo) && _device->_pMetalFeatures->mslVersion >= 20000;
 	_constExprSampler.anisotropy_enable = pCreateInfo->anisotropyEnable;
 }
 
 MVKSampler::~MVKSampler() {
-	[_mtlSamplerState release];
+	_device->getCommandResourceFactory()->releaseMTLSamplerState(_mtlSamplerState);
 }
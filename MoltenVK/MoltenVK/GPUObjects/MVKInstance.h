@@ -189,7 +189,7 @@ protected:
 
 	MVKConfiguration _mvkConfig;
 	VkApplicationInfo _appInfo;
-	MVKVectorInline<MVKPhysicalDevice, 2> _physicalDevices;
+	MVKVectorInline<MVKPhysicalDevice*, 2> _physicalDevices;
 	MVKVectorDefault<MVKDebugReportCallback*> _debugReportCallbacks;
 	MVKVectorDefault<MVKDebugUtilsMessenger*> _debugUtilMessengers;
 	std::unordered_map<std::string, MVKEntryPoint> _entryPoints;
@@ -199,6 +199,8 @@ protected:
 	bool _useCreationCallbacks;
 	const char* _debugReportCallbackLayerPrefix;
 	int32_t _autoGPUCaptureScope;
+	int32_t _autoGPUCaptureSlowFrameThreshold;
+	int32_t _autoGPUCaptureMaxFrameCount;
 	std::string _autoGPUCaptureOutputFile;
 };
 
@@ -62,7 +62,7 @@ VkResult MVKInstance::getPhysicalDevices(uint32_t* pCount, VkPhysicalDevice* pPh
 
 	// Now populate the devices
 	for (uint32_t pdIdx = 0; pdIdx < *pCount; pdIdx++) {
-		pPhysicalDevices[pdIdx] = _physicalDevices[pdIdx].getVkPhysicalDevice();
+		pPhysicalDevices[pdIdx] = _physicalDevices[pdIdx]->getVkPhysicalDevice();
 	}
 
 	return result;
@@ -71,7 +71,9 @@ VkResult MVKInstance::getPhysicalDevices(uint32_t* pCount, VkPhysicalDevice* pPh
 VkResult MVKInstance::getPhysicalDeviceGroups(uint32_t* pCount, VkPhysicalDeviceGroupProperties* pPhysicalDeviceGroupProps) {
 
 	// According to the Vulkan spec: "Every physical device *must* be in exactly one device group."
-	// Since we don't really support this yet, we must return one group for every device.
+	// A logical device drives a single MTLDevice, so we must return one group for every device.
+	// GPUs in the same Metal peer group are enumerated consecutively, and apps can identify
+	// them, and divide work between them, using the peer members of MVKPhysicalDeviceMetalFeatures.
 
 	// Get the number of physical devices
 	uint32_t pdCnt = getPhysicalDeviceCount();
@@ -89,7 +91,7 @@ VkResult MVKInstance::getPhysicalDeviceGroups(uint32_t* pCount, VkPhysicalDevice
 	// Now populate the device groups
 	for (uint32_t pdIdx = 0; pdIdx < *pCount; pdIdx++) {
 		pPhysicalDeviceGroupProps[pdIdx].physicalDeviceCount = 1;
-		pPhysicalDeviceGroupProps[pdIdx].physicalDevices[0] = _physicalDevices[pdIdx].getVkPhysicalDevice();
+		pPhysicalDeviceGroupProps[pdIdx].physicalDevices[0] = _physicalDevices[pdIdx]->getVkPhysicalDevice();
 		pPhysicalDeviceGroupProps[pdIdx].subsetAllocation = VK_FALSE;
 	}
 
@@ -287,6 +289,22 @@ VkDebugUtilsMessageSeverityFlagBitsEXT MVKInstance::getVkDebugUtilsMessageSeveri
 // grabs the first GPU will get a high-power one by default. If the MVK_CONFIG_FORCE_LOW_POWER_GPU
 // env var or build setting is set, the returned array will only include low-power devices.
 // If Metal is not supported, returns an empty array.
+#if MVK_MACOS
+// Orders GPUs in the same Metal peer group consecutively, by peer index,
+// so that apps can divide work between the GPUs in each peer group.
+static NSComparisonResult comparePeerGroups(id<MTLDevice> md1, id<MTLDevice> md2) {
+	if ( ![md1 respondsToSelector: @selector(peerGroupID)] ) { return NSOrderedSame; }
+
+	uint64_t md1PeerGroupID = md1.peerGroupID;
+	uint64_t md2PeerGroupID = md2.peerGroupID;
+	if (md1PeerGroupID != md2PeerGroupID) {
+		return md1PeerGroupID < md2PeerGroupID ? NSOrderedAscending : NSOrderedDescending;
+	}
+	if ( !md1PeerGroupID || md1.peerIndex == md2.peerIndex ) { return NSOrderedSame; }
+	return md1.peerIndex < md2.peerIndex ? NSOrderedAscending : NSOrderedDescending;
+}
+#endif	// MVK_MACOS
+
 static NSArray<id<MTLDevice>>* availableMTLDevicesArray() {
 	NSMutableArray* mtlDevs = [NSMutableArray array];
 
@@ -302,7 +320,7 @@ static NSArray<id<MTLDevice>>* availableMTLDevicesArray() {
 		}
 
 		// Sort by power
-		[mtlDevs sortUsingComparator: ^(id<MTLDevice> md1, id<MTLDevice> md2) {
+		[mtlDevs sortWithOptions: NSSortStable usingComparator: ^(id<MTLDevice> md1, id<MTLDevice> md2) {
 			BOOL md1IsLP = md1.isLowPower;
 			BOOL md2IsLP = md2.isLowPower;
 
@@ -312,7 +330,7 @@ static NSArray<id<MTLDevice>>* availableMTLDevicesArray() {
 				BOOL md1IsHeadless = md1.isHeadless;
 				BOOL md2IsHeadless = md2.isHeadless;
 				if (md1IsHeadless == md2IsHeadless ) {
-					return NSOrderedSame;
+					return comparePeerGroups(md1, md2);
 				}
 				return md2IsHeadless ? NSOrderedAscending : NSOrderedDescending;
 			}
@@ -366,7 +384,7 @@ MVKInstance::MVKInstance(const VkInstanceCreateInfo* pCreateInfo) : _enabledExte
 	@autoreleasepool {
 		NSArray<id<MTLDevice>>* mtlDevices = availableMTLDevicesArray();
 		for (id<MTLDevice> mtlDev in mtlDevices) {
-			_physicalDevices.emplace_back(this, mtlDev);
+			_physicalDevices.push_back(new MVKPhysicalDevice(this, mtlDev));
 		}
 	}
 
@@ -596,7 +614,14 @@ void MVKInstance::initProcAddrs() {
 	ADD_INST_EXT_ENTRY_POINT(vkSetMoltenVKConfigurationMVK, MVK_MOLTENVK);
 	ADD_INST_EXT_ENTRY_POINT(vkGetPhysicalDeviceMetalFeaturesMVK, MVK_MOLTENVK);
 	ADD_INST_EXT_ENTRY_POINT(vkGetPerformanceStatisticsMVK, MVK_MOLTENVK);
+	ADD_INST_EXT_ENTRY_POINT(vkGetResourceStatisticsMVK, MVK_MOLTENVK);
+	ADD_INST_EXT_ENTRY_POINT(vkGetQueueGPUFrameTimesMVK, MVK_MOLTENVK);
 	ADD_INST_EXT_ENTRY_POINT(vkGetVersionStringsMVK, MVK_MOLTENVK);
+	ADD_INST_EXT_ENTRY_POINT(vkGetPipelineCompilationStatusMVK, MVK_MOLTENVK);
+	ADD_INST_EXT_ENTRY_POINT(vkSetPipelineCompilationCallbackMVK, MVK_MOLTENVK);
+	ADD_INST_EXT_ENTRY_POINT(vkSetWorkgroupSizeTunableMVK, MVK_MOLTENVK);
+	ADD_INST_EXT_ENTRY_POINT(vkGetPipelineWorkgroupSizeMVK, MVK_MOLTENVK);
+	ADD_INST_EXT_ENTRY_POINT(vkSetSwapchainImageRenderExtentMVK, MVK_MOLTENVK);
 	ADD_INST_EXT_ENTRY_POINT(vkGetMTLDeviceMVK, MVK_MOLTENVK);
 	ADD_INST_EXT_ENTRY_POINT(vkSetMTLTextureMVK, MVK_MOLTENVK);
 	ADD_INST_EXT_ENTRY_POINT(vkGetMTLTextureMVK, MVK_MOLTENVK);
@@ -620,6 +645,9 @@ void MVKInstance::initProcAddrs() {
 	ADD_DVC_EXT_ENTRY_POINT(vkGetDescriptorSetLayoutSupportKHR, KHR_MAINTENANCE3);
 	ADD_DVC_EXT_ENTRY_POINT(vkCmdPushDescriptorSetKHR, KHR_PUSH_DESCRIPTOR);
 	ADD_DVC_EXT2_ENTRY_POINT(vkCmdPushDescriptorSetWithTemplateKHR, KHR_PUSH_DESCRIPTOR, KHR_DESCRIPTOR_UPDATE_TEMPLATE);
+	ADD_DVC_EXT_ENTRY_POINT(vkGetSemaphoreCounterValueKHR, KHR_TIMELINE_SEMAPHORE);
+	ADD_DVC_EXT_ENTRY_POINT(vkWaitSemaphoresKHR, KHR_TIMELINE_SEMAPHORE);
+	ADD_DVC_EXT_ENTRY_POINT(vkSignalSemaphoreKHR, KHR_TIMELINE_SEMAPHORE);
 	ADD_DVC_EXT_ENTRY_POINT(vkCreateSwapchainKHR, KHR_SWAPCHAIN);
 	ADD_DVC_EXT_ENTRY_POINT(vkDestroySwapchainKHR, KHR_SWAPCHAIN);
 	ADD_DVC_EXT_ENTRY_POINT(vkGetSwapchainImagesKHR, KHR_SWAPCHAIN);
@@ -629,7 +657,24 @@ void MVKInstance::initProcAddrs() {
 	ADD_DVC_EXT2_ENTRY_POINT(vkGetDeviceGroupSurfacePresentModesKHR, KHR_SWAPCHAIN, KHR_DEVICE_GROUP);
 	ADD_DVC_EXT2_ENTRY_POINT(vkGetPhysicalDevicePresentRectanglesKHR, KHR_SWAPCHAIN, KHR_DEVICE_GROUP);
 	ADD_DVC_EXT2_ENTRY_POINT(vkAcquireNextImage2KHR, KHR_SWAPCHAIN, KHR_DEVICE_GROUP);
+#ifdef VK_EXT_extended_dynamic_state
+	ADD_DVC_EXT_ENTRY_POINT(vkCmdSetCullModeEXT, EXT_EXTENDED_DYNAMIC_STATE);
+	ADD_DVC_EXT_ENTRY_POINT(vkCmdSetFrontFaceEXT, EXT_EXTENDED_DYNAMIC_STATE);
+	ADD_DVC_EXT_ENTRY_POINT(vkCmdSetPrimitiveTopologyEXT, EXT_EXTENDED_DYNAMIC_STATE);
+	ADD_DVC_EXT_ENTRY_POINT(vkCmdSetViewportWithCountEXT, EXT_EXTENDED_DYNAMIC_STATE);
+	ADD_DVC_EXT_ENTRY_POINT(vkCmdSetScissorWithCountEXT, EXT_EXTENDED_DYNAMIC_STATE);
+	ADD_DVC_EXT_ENTRY_POINT(vkCmdBindVertexBuffers2EXT, EXT_EXTENDED_DYNAMIC_STATE);
+	ADD_DVC_EXT_ENTRY_POINT(vkCmdSetDepthTestEnableEXT, EXT_EXTENDED_DYNAMIC_STATE);
+	ADD_DVC_EXT_ENTRY_POINT(vkCmdSetDepthWriteEnableEXT, EXT_EXTENDED_DYNAMIC_STATE);
+	ADD_DVC_EXT_ENTRY_POINT(vkCmdSetDepthCompareOpEXT, EXT_EXTENDED_DYNAMIC_STATE);
+	ADD_DVC_EXT_ENTRY_POINT(vkCmdSetDepthBoundsTestEnableEXT, EXT_EXTENDED_DYNAMIC_STATE);
+	ADD_DVC_EXT_ENTRY_POINT(vkCmdSetStencilTestEnableEXT, EXT_EXTENDED_DYNAMIC_STATE);
+	ADD_DVC_EXT_ENTRY_POINT(vkCmdSetStencilOpEXT, EXT_EXTENDED_DYNAMIC_STATE);
+#endif
 	ADD_DVC_EXT_ENTRY_POINT(vkSetHdrMetadataEXT, EXT_HDR_METADATA);
+	ADD_DVC_EXT_ENTRY_POINT(vkGetRefreshCycleDurationGOOGLE, GOOGLE_DISPLAY_TIMING);
+	ADD_DVC_EXT_ENTRY_POINT(vkGetPastPresentationTimingGOOGLE, GOOGLE_DISPLAY_TIMING);
+	ADD_DVC_EXT_ENTRY_POINT(vkGetMemoryHostPointerPropertiesEXT, EXT_EXTERNAL_MEMORY_HOST);
 	ADD_DVC_EXT_ENTRY_POINT(vkResetQueryPoolEXT, EXT_HOST_QUERY_RESET);
 	ADD_DVC_EXT_ENTRY_POINT(vkDebugMarkerSetObjectTagEXT, EXT_DEBUG_MARKER);
 	ADD_DVC_EXT_ENTRY_POINT(vkDebugMarkerSetObjectNameEXT, EXT_DEBUG_MARKER);
@@ -668,6 +713,8 @@ void MVKInstance::initConfig() {
 	MVK_SET_FROM_ENV_OR_BUILD_BOOL( _mvkConfig.defaultGPUCaptureScopeQueueIndex,       MVK_CONFIG_DEFAULT_GPU_CAPTURE_SCOPE_QUEUE_INDEX);
 
 	MVK_SET_FROM_ENV_OR_BUILD_INT32(_autoGPUCaptureScope, MVK_CONFIG_AUTO_GPU_CAPTURE_SCOPE);
+	MVK_SET_FROM_ENV_OR_BUILD_INT32(_autoGPUCaptureSlowFrameThreshold, MVK_CONFIG_AUTO_GPU_CAPTURE_SLOW_FRAME_THRESHOLD);
+	MVK_SET_FROM_ENV_OR_BUILD_INT32(_autoGPUCaptureMaxFrameCount, MVK_CONFIG_AUTO_GPU_CAPTURE_MAX_FRAME_COUNT);
 	MVK_SET_FROM_ENV_OR_BUILD_STRING(_autoGPUCaptureOutputFile, MVK_CONFIG_AUTO_GPU_CAPTURE_OUTPUT_FILE);
 }
 
@@ -682,6 +729,8 @@ VkResult MVKInstance::verifyLayers(uint32_t count, const char* const* names) {
 }
 
 MVKInstance::~MVKInstance() {
+	mvkDestroyContainerContents(_physicalDevices);
+
 	lock_guard<mutex> lock(_dcbLock);
 	_useCreationCallbacks = true;
 	mvkDestroyContainerContents(_debugReportCallbacks);
@@ -26,6 +26,7 @@
 #include <MoltenVKSPIRVToMSLConverter/SPIRVReflection.h>
 #include <MoltenVKSPIRVToMSLConverter/SPIRVToMSLConverter.h>
 #include <unordered_set>
+#include <atomic>
 #include <ostream>
 
 #import <Metal/Metal.h>
@@ -41,6 +42,12 @@ struct MVKShaderImplicitRezBinding {
 	uint32_t stages[kMVKShaderStageMax];
 };
 
+/** Identifies a shader library, held by a pipeline cache, that is used by a pipeline. */
+typedef struct {
+	MVKShaderModuleKey smKey;
+	MVKShaderLibrary* shaderLibrary;
+} MVKShaderLibraryUsage;
+
 /** Represents a Vulkan pipeline layout. */
 class MVKPipelineLayout : public MVKVulkanAPIDeviceObject {
 
@@ -99,6 +106,9 @@ public:
 	/** Returns the push constant binding info. */
 	const MVKShaderResourceBinding& getPushConstantBindings() { return _pushConstantsMTLResourceIndexes; }
 
+	/** Returns the descriptor set layout at the specified descriptor set index. */
+	MVKDescriptorSetLayout* getDescriptorSetLayout(uint32_t set) { return _descriptorSetLayouts[set]; }
+
 	/** Constructs an instance for the specified device. */
 	MVKPipelineLayout(MVKDevice* device, const VkPipelineLayoutCreateInfo* pCreateInfo);
 
@@ -117,6 +127,7 @@ protected:
 	MVKShaderImplicitRezBinding _outputBufferIndex;
 	uint32_t _tessCtlPatchOutputBufferIndex = 0;
 	uint32_t _tessCtlLevelBufferIndex = 0;
+	bool _isUsingMetalArgumentBuffers = false;
 };
 
 
@@ -164,20 +175,59 @@ public:
 	/** Returns whether or not full image view swizzling is enabled for this pipeline. */
 	bool fullImageViewSwizzle() const { return _fullImageViewSwizzle; }
 
-	/** Returns whether all internal Metal pipeline states are valid. */
-	bool hasValidMTLPipelineStates() { return _hasValidMTLPipelineStates; }
+	/**
+	 * Returns whether all internal Metal pipeline states are valid.
+	 * If the Metal pipeline states are being compiled in the background, waits until compilation is complete.
+	 */
+	bool hasValidMTLPipelineStates();
+
+	/**
+	 * Returns VK_SUCCESS if the Metal pipeline states have been compiled successfully, VK_NOT_READY
+	 * if they are still being compiled in the background, or an error if compilation failed.
+	 */
+	VkResult getMTLPipelineStatesCompilationStatus();
+
+	/**
+	 * Calls the callback function, with the compilation status, once the Metal pipeline states have been compiled.
+	 * The callback function is called immediately if the Metal pipeline states are not being compiled in the background.
+	 */
+	void notifyMTLPipelineStatesCompiled(PFN_vkPipelineCompiledMVK pfnCallback, void* pUserData);
+
+	/** Returns the number of threads in each workgroup dispatched with this pipeline, or zero if this is not a compute pipeline. */
+	virtual MTLSize getWorkgroupSize() { return MTLSizeMake(0, 0, 0); }
+
+	/**
+	 * If the shader libraries of this pipeline are being recorded in its pipeline cache, for prewarming
+	 * the next time the cache data is loaded, records them the first time this pipeline is bound.
+	 */
+	inline void markUsed() { if (_isUsagePending.load(std::memory_order_relaxed)) { recordUsage(); } }
 
 	/** Constructs an instance for the device. layout, and parent (which may be NULL). */
 	MVKPipeline(MVKDevice* device, MVKPipelineCache* pipelineCache, MVKPipelineLayout* layout, MVKPipeline* parent);
 
+	~MVKPipeline() override;
+
 protected:
 	void propogateDebugName() override {}
+	void compileMTLPipelineStates(dispatch_block_t block);
+	MVKShaderStageCompileRecord* newShaderStageCompileRecord();
+	uint64_t getCompileStartTime() { return _device->isReportingSlowCompiles() ? mvkGetTimestamp() : 0; }
+	void addPipelineCompileDuration(const char* pipelineType, uint64_t startTime);
+	void markPushConstantsUsage(MVKShaderStage stage, const SPIRVToMSLConversionConfiguration& shaderContext);
+	void addShaderLibraryUsage(MVKShaderModule* shaderModule, MVKShaderLibrary* shLib);
+	void recordUsage();
 
 	MVKPipelineCache* _pipelineCache;
+	MVKPipelineCompileRecord _compileRecord;
+	std::mutex _compileRecordLock;
 	MVKShaderImplicitRezBinding _swizzleBufferIndex;
 	MVKShaderImplicitRezBinding _bufferSizeBufferIndex;
 	MVKShaderImplicitRezBinding _indirectParamsIndex;
 	MVKShaderResourceBinding _pushConstantsMTLResourceIndexes;
+	dispatch_group_t _mtlPipelineStatesCompileGroup = nil;
+	MVKVectorInline<MVKShaderLibraryUsage, 2> _shaderLibraryUsage;
+	std::atomic<bool> _isUsagePending{false};
+	bool _stageUsesPushConstants[kMVKShaderStageMax] = {};
 	bool _fullImageViewSwizzle;
 	bool _hasValidMTLPipelineStates = true;
 
@@ -204,6 +254,12 @@ public:
     /** Returns whether this pipeline permits dynamic setting of the specifie state. */
     bool supportsDynamicState(VkDynamicState state);
 
+    /** Returns whether this pipeline permits dynamic setting of the specified extended state. */
+    bool supportsDynamicState(MVKExtendedDynamicState state) { return _dynamicStateEnabled[state]; }
+
+    /** Returns the Metal primitive type used by draws with this pipeline. */
+    MTLPrimitiveType getMTLPrimitiveType() { return _mtlPrimitiveType; }
+
     /** Returns whether this pipeline has tessellation shaders. */
     bool isTessellationPipeline() { return _pTessCtlSS && _pTessEvalSS && _tessInfo.patchControlPoints > 0; }
 
@@ -231,6 +287,15 @@ public:
 	/** Returns true if the tessellation control shader needs a buffer to store its per-patch output. */
 	bool needsTessCtlPatchOutputBuffer() { return _needsTessCtlPatchOutputBuffer; }
 
+	/** Returns the number of bytes of the vertex shader output buffer used by each vertex. */
+	uint32_t getVertexOutputStride() { return _vertexOutputStride; }
+
+	/** Returns the number of bytes of the tessellation control shader per-vertex output buffer used by each control point. */
+	uint32_t getTessCtlOutputStride() { return _tessCtlOutputStride; }
+
+	/** Returns the number of bytes of the tessellation control shader per-patch output buffer used by each patch. */
+	uint32_t getTessCtlPatchOutputStride() { return _tessCtlPatchOutputStride; }
+
 	/** Constructs an instance for the device and parent (which may be NULL). */
 	MVKGraphicsPipeline(MVKDevice* device,
 						MVKPipelineCache* pipelineCache,
@@ -245,14 +310,14 @@ protected:
     void initMTLRenderPipelineState(const VkGraphicsPipelineCreateInfo* pCreateInfo, const SPIRVTessReflectionData& reflectData);
     void initMVKShaderConverterContext(SPIRVToMSLConversionConfiguration& _shaderContext, const VkGraphicsPipelineCreateInfo* pCreateInfo, const SPIRVTessReflectionData& reflectData);
     void addVertexInputToShaderConverterContext(SPIRVToMSLConversionConfiguration& shaderContext, const VkGraphicsPipelineCreateInfo* pCreateInfo);
-    void addPrevStageOutputToShaderConverterContext(SPIRVToMSLConversionConfiguration& shaderContext, std::vector<SPIRVShaderOutput>& outputs);
+    void addPrevStageOutputToShaderConverterContext(SPIRVToMSLConversionConfiguration& shaderContext, const std::vector<SPIRVShaderOutput>& outputs);
     MTLRenderPipelineDescriptor* newMTLRenderPipelineDescriptor(const VkGraphicsPipelineCreateInfo* pCreateInfo, const SPIRVTessReflectionData& reflectData);
     MTLRenderPipelineDescriptor* newMTLTessVertexStageDescriptor(const VkGraphicsPipelineCreateInfo* pCreateInfo, const SPIRVTessReflectionData& reflectData, SPIRVToMSLConversionConfiguration& shaderContext);
 	MTLComputePipelineDescriptor* newMTLTessControlStageDescriptor(const VkGraphicsPipelineCreateInfo* pCreateInfo, const SPIRVTessReflectionData& reflectData, SPIRVToMSLConversionConfiguration& shaderContext);
 	MTLRenderPipelineDescriptor* newMTLTessRasterStageDescriptor(const VkGraphicsPipelineCreateInfo* pCreateInfo, const SPIRVTessReflectionData& reflectData, SPIRVToMSLConversionConfiguration& shaderContext);
 	bool addVertexShaderToPipeline(MTLRenderPipelineDescriptor* plDesc, const VkGraphicsPipelineCreateInfo* pCreateInfo, SPIRVToMSLConversionConfiguration& shaderContext);
-	bool addTessCtlShaderToPipeline(MTLComputePipelineDescriptor* plDesc, const VkGraphicsPipelineCreateInfo* pCreateInfo, SPIRVToMSLConversionConfiguration& shaderContext, std::vector<SPIRVShaderOutput>& prevOutput);
-	bool addTessEvalShaderToPipeline(MTLRenderPipelineDescriptor* plDesc, const VkGraphicsPipelineCreateInfo* pCreateInfo, SPIRVToMSLConversionConfiguration& shaderContext, std::vector<SPIRVShaderOutput>& prevOutput);
+	bool addTessCtlShaderToPipeline(MTLComputePipelineDescriptor* plDesc, const VkGraphicsPipelineCreateInfo* pCreateInfo, SPIRVToMSLConversionConfiguration& shaderContext, const std::vector<SPIRVShaderOutput>& prevOutput);
+	bool addTessEvalShaderToPipeline(MTLRenderPipelineDescriptor* plDesc, const VkGraphicsPipelineCreateInfo* pCreateInfo, SPIRVToMSLConversionConfiguration& shaderContext, const std::vector<SPIRVShaderOutput>& prevOutput);
     bool addFragmentShaderToPipeline(MTLRenderPipelineDescriptor* plDesc, const VkGraphicsPipelineCreateInfo* pCreateInfo, SPIRVToMSLConversionConfiguration& shaderContext);
 	bool addVertexInputToPipeline(MTLRenderPipelineDescriptor* plDesc, const VkPipelineVertexInputStateCreateInfo* pVI, const SPIRVToMSLConversionConfiguration& shaderContext);
     void addTessellationToPipeline(MTLRenderPipelineDescriptor* plDesc, const SPIRVTessReflectionData& reflectData, const VkPipelineTessellationStateCreateInfo* pTS);
@@ -290,6 +355,9 @@ protected:
 	MVKShaderImplicitRezBinding _outputBufferIndex;
 	uint32_t _tessCtlPatchOutputBufferIndex = 0;
 	uint32_t _tessCtlLevelBufferIndex = 0;
+	uint32_t _vertexOutputStride = 0;
+	uint32_t _tessCtlOutputStride = 0;
+	uint32_t _tessCtlPatchOutputStride = 0;
 
 	bool _dynamicStateEnabled[kMVKVkDynamicStateCount];
 	bool _hasDepthStencilInfo;
@@ -325,6 +393,11 @@ public:
 	/** Returns if this pipeline allows non-zero dispatch bases in vkCmdDispatchBase(). */
 	bool allowsDispatchBase() { return _allowsDispatchBase; }
 
+	/** Returns whether the shader of this pipeline reads the dispatch base from a buffer, instead of from the stage-input region. */
+	bool needsDispatchBaseBuffer() { return _needsDispatchBaseBuffer; }
+
+	MTLSize getWorkgroupSize() override { return _mtlThreadgroupSize; }
+
 	/** Constructs an instance for the device and parent (which may be NULL). */
 	MVKComputePipeline(MVKDevice* device,
 					   MVKPipelineCache* pipelineCache,
@@ -334,7 +407,12 @@ public:
 	~MVKComputePipeline() override;
 
 protected:
-    MVKMTLFunction getMTLFunction(const VkComputePipelineCreateInfo* pCreateInfo);
+    MVKMTLFunction getMTLFunction(const VkComputePipelineCreateInfo* pCreateInfo, uint32_t tunedWidth);
+	void compileMTLPipelineState(MTLComputePipelineDescriptor* plDesc);
+	void validateMTLPipelineState(MTLComputePipelineDescriptor* plDesc);
+	void tuneWorkgroupSize(const VkComputePipelineCreateInfo* pCreateInfo, MTLComputePipelineDescriptor* plDesc);
+	bool recompileMTLPipelineState(const VkComputePipelineCreateInfo* pCreateInfo, MTLComputePipelineDescriptor* plDesc, uint32_t tunedWidth);
+	bool validateThreadgroupSize();
 
     id<MTLComputePipelineState> _mtlPipelineState;
     MTLSize _mtlThreadgroupSize;
@@ -342,6 +420,7 @@ protected:
     bool _needsBufferSizeBuffer = false;
     bool _needsDispatchBaseBuffer = false;
     bool _allowsDispatchBase = false;
+    bool _isWorkgroupSizeTuned = false;
 };
 
 
@@ -372,6 +451,33 @@ public:
 	/** Merges the contents of the specified number of pipeline caches into this cache. */
 	VkResult mergePipelineCaches(uint32_t srcCacheCount, const VkPipelineCache* pSrcCaches);
 
+	/**
+	 * If this cache holds a MTLBinaryArchive, sets it into the descriptor, so that Metal
+	 * can retrieve the compiled pipeline state from the archive instead of compiling it.
+	 */
+	void setBinaryArchives(MTLRenderPipelineDescriptor* plDesc);
+
+	/** If this cache holds a MTLBinaryArchive, sets it into the descriptor. */
+	void setBinaryArchives(MTLComputePipelineDescriptor* plDesc);
+
+	/**
+	 * If this cache holds a MTLBinaryArchive, adds the compiled pipeline state described by the
+	 * descriptor to the archive, in the background, so it will be included in the cache data.
+	 */
+	void addToBinaryArchive(MTLRenderPipelineDescriptor* plDesc);
+
+	/** If this cache holds a MTLBinaryArchive, adds the compiled pipeline state described by the descriptor to the archive. */
+	void addToBinaryArchive(MTLComputePipelineDescriptor* plDesc);
+
+	/**
+	 * Records the use of the specified shader libraries by a pipeline that has been bound, so that they
+	 * are included in the usage manifest in the cache data, in order of first use, for prewarming.
+	 */
+	void recordShaderLibraryUsage(MVKVector<MVKShaderLibraryUsage>& shLibUsage);
+
+	/** Stops any prewarming of shader libraries before marking this instance as destroyed. */
+	void destroy() override;
+
 #pragma mark Construction
 
 	/** Constructs an instance for the specified device. */
@@ -380,15 +486,136 @@ public:
 	~MVKPipelineCache() override;
 
 protected:
+	friend MVKShaderLibraryCache;
+
 	void propogateDebugName() override {}
 	MVKShaderLibraryCache* getShaderLibraryCache(MVKShaderModuleKey smKey);
 	void readData(const VkPipelineCacheCreateInfo* pCreateInfo);
 	void writeData(std::ostream& outstream, bool isCounting = false);
 	void markDirty();
+	void addShaderLibraryEntry(const SPIRVToMSLConversionConfiguration& shaderContext, MVKShaderLibrary* shLib);
+	void initBinaryArchive(const std::string& archiveData);
+	void addToBinaryArchive(BOOL (^addBlock)(NSError** pError));
+	bool getBinaryArchiveData(std::string& archiveData);
+	void prewarmShaderLibraries();
+
+	/**
+	 * Identifies a shader library in the usage manifest, by its shader module key and the hash of its
+	 * cache data entry, along with the time it was first used, in milliseconds after cache creation.
+	 */
+	typedef struct MVKShaderLibraryUsageRecord {
+		uint64_t codeSize;
+		uint64_t codeHash;
+		uint64_t entryHash;
+		uint32_t firstUseTime;
+
+		std::size_t hash() const {
+			std::size_t h = mvkHash(&codeSize);
+			h = mvkHash(&codeHash, 1, h);
+			return mvkHash(&entryHash, 1, h);
+		}
+	} MVKShaderLibraryUsageRecord;
+
+	void prewarmShaderLibrary(const MVKShaderLibraryUsageRecord& usageRec);
+	bool isShaderLibraryCached(const MVKShaderLibraryUsageRecord& usageRec);
+
+	/**
+	 * Shader library caches are distributed across shards by shader module key, each with
+	 * its own lock, so threads retrieving shader libraries for different shader modules
+	 * do not contend with each other. Lookups hold the shard lock shared.
+	 *
+	 * Shader library entries loaded from the initial cache data are held undecoded in
+	 * pendingEntries, as locations within _loadedData, until the shader library cache
+	 * of their shader module is first retrieved.
+	 */
+	typedef struct {
+		uint64_t offset;
+		uint64_t size;
+	} MVKShaderLibraryEntryLocation;
+
+	typedef struct {
+		std::unordered_map<MVKShaderModuleKey, MVKShaderLibraryCache*> shaderCache;
+		std::unordered_map<MVKShaderModuleKey, MVKVectorInline<MVKShaderLibraryEntryLocation, 1>> pendingEntries;
+		MVKSharedMutex lock;
+	} MVKShaderCacheShard;
+
+	static const uint32_t kMVKShaderCacheShardCount = 16;
+
+	MVKShaderCacheShard& getShaderCacheShard(MVKShaderModuleKey smKey);
+	void loadShaderLibraries(MVKShaderCacheShard& scShard, MVKShaderModuleKey smKey, MVKShaderLibraryCache* slCache);
 
-	std::unordered_map<MVKShaderModuleKey, MVKShaderLibraryCache*> _shaderCache;
+	MVKShaderCacheShard _shaderCacheShards[kMVKShaderCacheShardCount];
+	std::vector<char> _loadedData;		// Undecoded shader library entries from the initial cache data
 	size_t _dataSize = 0;
-	std::mutex _shaderCacheLock;
+	std::atomic<size_t> _shaderLibraryEntriesSize{0};
+	std::atomic<uint32_t> _shaderLibraryEntryCount{0};
+	std::mutex _shaderCacheLock;		// Guards serialization state. Acquire before any shard lock.
+#if MVK_XCODE_12
+	id<MTLBinaryArchive> _mtlBinaryArchive = nil;
+#endif
+	NSURL* _mtlBinaryArchiveURL = nil;
+	dispatch_group_t _binaryArchiveGroup = nil;
+	std::mutex _binaryArchiveLock;
+	std::vector<MVKShaderLibraryUsageRecord> _usageManifest;			// Shader libraries used by this session
+	std::vector<MVKShaderLibraryUsageRecord> _loadedUsageManifest;		// Shader libraries used by previous sessions
+	std::unordered_set<std::size_t> _usageManifestHashes;
+	uint64_t _creationTime;
+	dispatch_group_t _prewarmGroup = nil;
+	std::atomic<bool> _isPrewarmCancelled{false};
+	bool _hasBinaryArchiveContent = false;
+};
+
+
+#pragma mark -
+#pragma mark MVKShaderDiskCache
+
+/**
+ * A process-wide cache, held in a directory on disk, of the MSL source code converted from SPIR-V.
+ *
+ * Each entry is identified by a hash of the shader module code, the shader conversion
+ * configuration, and the revision of the shader converter, so entries can be retrieved by
+ * any device, and by later runs of the app, even if the app does not use a VkPipelineCache.
+ * The total size of the cache is limited, by removing the least recently used entries.
+ */
+class MVKShaderDiskCache {
+
+public:
+
+	/** Returns the process-wide shader disk cache, or nullptr if no shader disk cache is configured. */
+	static MVKShaderDiskCache* getShaderDiskCache();
+
+	/**
+	 * If the cache contains the conversion of the code of the shader module identified by the key,
+	 * using the specified shader context, populates the MSL source code and conversion results,
+	 * marks the vertex attributes and resource bindings that are used by the shader in the shader
+	 * context, and returns true. Otherwise, returns false.
+	 */
+	bool getShaderConversion(MVKShaderModuleKey smKey,
+							 SPIRVToMSLConversionConfiguration* pContext,
+							 std::string& mslSourceCode,
+							 SPIRVToMSLConversionResults& shaderConversionResults);
+
+	/**
+	 * Adds the conversion of the code of the shader module identified by the key to the cache.
+	 * The shader context must be the one that was used for the conversion.
+	 *
+	 * The entry is written atomically, so it is never read partially written by another thread or process.
+	 */
+	void addShaderConversion(MVKShaderModuleKey smKey,
+							 const SPIRVToMSLConversionConfiguration& shaderContext,
+							 const std::string& mslSourceCode,
+							 const SPIRVToMSLConversionResults& shaderConversionResults);
+
+protected:
+	MVKShaderDiskCache(const std::string& dirPath, uint64_t maxSize);
+	std::string getEntryKey(MVKShaderModuleKey smKey, const SPIRVToMSLConversionConfiguration& shaderContext);
+	NSURL* getEntryURL(const std::string& entryKey);
+	void updateSize(bool shouldTrim);
+
+	NSURL* _dirURL = nil;
+	uint64_t _maxSize;
+	uint64_t _size = 0;
+	std::mutex _sizeLock;
 };
 
 
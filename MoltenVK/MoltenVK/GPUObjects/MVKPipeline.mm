@@ -29,6 +29,7 @@
 #include <cereal/archives/binary.hpp>
 #include <cereal/types/string.hpp>
 #include <cereal/types/vector.hpp>
+#include <sstream>
 
 using namespace std;
 using namespace SPIRV_CROSS_NAMESPACE;
@@ -48,9 +49,19 @@ void MVKPipelineLayout::bindDescriptorSets(MVKCommandEncoder* cmdEncoder,
 		MVKDescriptorSet* descSet = descriptorSets[dsIdx];
 		uint32_t dslIdx = firstSet + dsIdx;
 		MVKDescriptorSetLayout* dsl = _descriptorSetLayouts[dslIdx];
-		dsl->bindDescriptorSet(cmdEncoder, descSet,
-							   _dslMTLResourceIndexOffsets[dslIdx],
-							   pDynamicOffsets, &pDynamicOffsetIndex);
+		if (_isUsingMetalArgumentBuffers) {
+			dsl->bindMetalArgumentBuffer(cmdEncoder, descSet, _dslMTLResourceIndexOffsets[dslIdx]);
+		} else if (cmdEncoder && cmdEncoder->isBoundDescriptorSet(this, dslIdx, descSet)) {
+			// Rebinding the same descriptor set can only change its dynamic offsets.
+			dsl->bindDynamicOffsets(cmdEncoder, descSet,
+									_dslMTLResourceIndexOffsets[dslIdx],
+									pDynamicOffsets, &pDynamicOffsetIndex);
+		} else {
+			dsl->bindDescriptorSet(cmdEncoder, descSet,
+								   _dslMTLResourceIndexOffsets[dslIdx],
+								   pDynamicOffsets, &pDynamicOffsetIndex);
+			if (cmdEncoder) { cmdEncoder->setBoundDescriptorSet(this, dslIdx, descSet); }
+		}
 		setConfigurationResult(dsl->getConfigurationResult());
 	}
 }
@@ -60,6 +71,7 @@ void MVKPipelineLayout::pushDescriptorSet(MVKCommandEncoder* cmdEncoder,
                                           MVKVector<VkWriteDescriptorSet>& descriptorWrites,
                                           uint32_t set) {
 	clearConfigurationResult();
+	if (cmdEncoder) { cmdEncoder->setBoundDescriptorSet(this, set, nullptr); }
 	MVKDescriptorSetLayout* dsl = _descriptorSetLayouts[set];
 	dsl->pushDescriptorSet(cmdEncoder, descriptorWrites, _dslMTLResourceIndexOffsets[set]);
 	setConfigurationResult(dsl->getConfigurationResult());
@@ -71,6 +83,7 @@ void MVKPipelineLayout::pushDescriptorSet(MVKCommandEncoder* cmdEncoder,
                                           uint32_t set,
                                           const void* pData) {
 	clearConfigurationResult();
+	if (cmdEncoder) { cmdEncoder->setBoundDescriptorSet(this, set, nullptr); }
 	MVKDescriptorSetLayout* dsl = _descriptorSetLayouts[set];
 	dsl->pushDescriptorSet(cmdEncoder, descUpdateTemplate, pData, _dslMTLResourceIndexOffsets[set]);
 	setConfigurationResult(dsl->getConfigurationResult());
@@ -79,12 +92,18 @@ void MVKPipelineLayout::pushDescriptorSet(MVKCommandEncoder* cmdEncoder,
 void MVKPipelineLayout::populateShaderConverterContext(SPIRVToMSLConversionConfiguration& context) {
 	context.resourceBindings.clear();
 
+	// Each descriptor set is placed in a Metal argument buffer at the Metal buffer index
+	// that matches the descriptor set index, which is the SPIRV-Cross default placement.
+	context.options.mslOptions.argument_buffers = _isUsingMetalArgumentBuffers;
+	context.options.mslOptions.force_active_argument_buffer_resources = _isUsingMetalArgumentBuffers;
+
     // Add resource bindings defined in the descriptor set layouts
 	uint32_t dslCnt = (uint32_t)_descriptorSetLayouts.size();
 	for (uint32_t dslIdx = 0; dslIdx < dslCnt; dslIdx++) {
 		_descriptorSetLayouts[dslIdx]->populateShaderConverterContext(context,
 																	  _dslMTLResourceIndexOffsets[dslIdx],
-																	  dslIdx);
+																	  dslIdx,
+																	  _isUsingMetalArgumentBuffers);
 	}
 
 	// Add any resource bindings used by push-constants
@@ -118,13 +137,27 @@ MVKPipelineLayout::MVKPipelineLayout(MVKDevice* device,
 	// this pipeline layout to retain the VkDescriptorSetLayout, the MVKDescriptorSetLayout
 	// instance is retained, so that it will live on here after it has been destroyed by the API.
 
+	// Metal argument buffers are used only if all descriptor set layouts can use them,
+	// in which case each descriptor set layout consumes a single Metal buffer index.
+	_isUsingMetalArgumentBuffers = pCreateInfo->setLayoutCount > 0;
+	for (uint32_t i = 0; i < pCreateInfo->setLayoutCount; i++) {
+		MVKDescriptorSetLayout* pDescSetLayout = (MVKDescriptorSetLayout*)pCreateInfo->pSetLayouts[i];
+		_isUsingMetalArgumentBuffers = _isUsingMetalArgumentBuffers && pDescSetLayout->isUsingMetalArgumentBuffer();
+	}
+	MVKShaderResourceBinding mtlArgBuffRezCounts;
+	for (uint32_t i = kMVKShaderStageVertex; i < kMVKShaderStageMax; i++) {
+		mtlArgBuffRezCounts.stages[i].bufferIndex = 1;
+	}
+
 	_descriptorSetLayouts.reserve(pCreateInfo->setLayoutCount);
 	for (uint32_t i = 0; i < pCreateInfo->setLayoutCount; i++) {
 		MVKDescriptorSetLayout* pDescSetLayout = (MVKDescriptorSetLayout*)pCreateInfo->pSetLayouts[i];
 		pDescSetLayout->retain();
 		_descriptorSetLayouts.push_back(pDescSetLayout);
 		_dslMTLResourceIndexOffsets.push_back(_pushConstantsMTLResourceIndexes);
-		_pushConstantsMTLResourceIndexes += pDescSetLayout->_mtlResourceCounts;
+		_pushConstantsMTLResourceIndexes += (_isUsingMetalArgumentBuffers
+											 ? mtlArgBuffRezCounts
+											 : pDescSetLayout->_mtlResourceCounts);
 	}
 
 	// Add push constants
@@ -161,9 +194,98 @@ MVKPipelineLayout::~MVKPipelineLayout() {
 void MVKPipeline::bindPushConstants(MVKCommandEncoder* cmdEncoder) {
 	if (cmdEncoder) {
 		for (uint32_t i = kMVKShaderStageVertex; i < kMVKShaderStageMax; i++) {
-			cmdEncoder->getPushConstants(mvkVkShaderStageFlagBitsFromMVKShaderStage(MVKShaderStage(i)))->setMTLBufferIndex(_pushConstantsMTLResourceIndexes.stages[i].bufferIndex);
+			cmdEncoder->getPushConstants(mvkVkShaderStageFlagBitsFromMVKShaderStage(MVKShaderStage(i)))->setMTLBufferIndex(_pushConstantsMTLResourceIndexes.stages[i].bufferIndex,
+																													  _stageUsesPushConstants[i]);
+		}
+	}
+}
+
+// Records whether the shader function, just converted for the stage, reads the push constants.
+// This must be called before converting another stage, which updates the resource usage flags.
+void MVKPipeline::markPushConstantsUsage(MVKShaderStage stage, const SPIRVToMSLConversionConfiguration& shaderContext) {
+	_stageUsesPushConstants[stage] = shaderContext.isResourceUsed(shaderContext.options.entryPointStage, kPushConstDescSet, kPushConstBinding);
+}
+
+bool MVKPipeline::hasValidMTLPipelineStates() {
+	if (_mtlPipelineStatesCompileGroup) { dispatch_group_wait(_mtlPipelineStatesCompileGroup, DISPATCH_TIME_FOREVER); }
+	return _hasValidMTLPipelineStates;
+}
+
+VkResult MVKPipeline::getMTLPipelineStatesCompilationStatus() {
+	if (_mtlPipelineStatesCompileGroup && dispatch_group_wait(_mtlPipelineStatesCompileGroup, DISPATCH_TIME_NOW) != 0) { return VK_NOT_READY; }
+	if (_hasValidMTLPipelineStates) { return VK_SUCCESS; }
+
+	VkResult rslt = getConfigurationResult();
+	return (rslt == VK_SUCCESS) ? VK_ERROR_INITIALIZATION_FAILED : rslt;
+}
+
+// Retain this pipeline until the callback has been called, in case the app destroys it in the meantime.
+void MVKPipeline::notifyMTLPipelineStatesCompiled(PFN_vkPipelineCompiledMVK pfnCallback, void* pUserData) {
+	if ( !pfnCallback ) { return; }
+
+	VkPipeline vkPL = (VkPipeline)this;
+	if (_mtlPipelineStatesCompileGroup) {
+		retain();
+		dispatch_group_notify(_mtlPipelineStatesCompileGroup, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+			pfnCallback(vkPL, getMTLPipelineStatesCompilationStatus(), pUserData);
+			release();
+		});
+	} else {
+		pfnCallback(vkPL, getMTLPipelineStatesCompilationStatus(), pUserData);
+	}
+}
+
+// Compiles the Metal pipeline states using the block, either immediately, or in the background,
+// in which case this pipeline, and its pipeline cache, are retained until compilation is complete.
+// The block must only modify the Metal pipeline states, and the validity of those states, since
+// other members may be accessed by other threads while the block runs.
+void MVKPipeline::compileMTLPipelineStates(dispatch_block_t block) {
+	if ( !_device->shouldCompilePipelinesAsynchronously() ) {
+		block();
+		return;
+	}
+
+	if ( !_mtlPipelineStatesCompileGroup ) { _mtlPipelineStatesCompileGroup = dispatch_group_create(); }	// retained
+	MVKPipelineCache* plCache = _pipelineCache;
+	retain();
+	if (plCache) { plCache->retain(); }
+	dispatch_group_async(_mtlPipelineStatesCompileGroup, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+		@autoreleasepool { block(); }
+		if (plCache) { plCache->release(); }
+		release();
+	});
+}
+
+// Returns a new record of the compilation of a shader stage of this pipeline, to be populated when the stage
+// is compiled, or returns null if slow compiles are not being reported. The returned record is only valid
+// until this function is called again.
+MVKShaderStageCompileRecord* MVKPipeline::newShaderStageCompileRecord() {
+	if ( !_device->isReportingSlowCompiles() ) { return nullptr; }
+
+	lock_guard<mutex> lock(_compileRecordLock);
+	_compileRecord.stages.emplace_back();
+	return &_compileRecord.stages.back();
+}
+
+// Reports the compilation of a Metal pipeline state of this pipeline, started at the specified time,
+// along with the compilation of its shader stages. Because some pipelines compile several Metal
+// pipeline states from the same shader stages, the stage durations are only reported once.
+void MVKPipeline::addPipelineCompileDuration(const char* pipelineType, uint64_t startTime) {
+	if ( !_device->isReportingSlowCompiles() ) { return; }
+
+	MVKPipelineCompileRecord compileRecord;
+	{
+		lock_guard<mutex> lock(_compileRecordLock);
+		compileRecord = _compileRecord;
+		for (auto& stageRec : _compileRecord.stages) {
+			stageRec.spirvToMSL = 0.0;
+			stageRec.mslCompile = 0.0;
+			stageRec.functionSpecialization = 0.0;
 		}
 	}
+	compileRecord.pipelineType = pipelineType;
+	compileRecord.pipelineCompile = mvkGetElapsedMilliseconds(startTime);
+	_device->addPipelineCompileRecord(compileRecord);
 }
 
 MVKPipeline::MVKPipeline(MVKDevice* device, MVKPipelineCache* pipelineCache, MVKPipelineLayout* layout, MVKPipeline* parent) :
@@ -172,6 +294,32 @@ MVKPipeline::MVKPipeline(MVKDevice* device, MVKPipelineCache* pipelineCache, MVK
 	_pushConstantsMTLResourceIndexes(layout->getPushConstantBindings()),
 	_fullImageViewSwizzle(device->_pMVKConfig->fullImageViewSwizzle) {}
 
+// Adds a shader library retrieved from the pipeline cache to those recorded when this pipeline is first bound.
+// The pipeline cache is retained until then, since the app may destroy it once this pipeline is created.
+void MVKPipeline::addShaderLibraryUsage(MVKShaderModule* shaderModule, MVKShaderLibrary* shLib) {
+	if ( !shLib || !_pipelineCache || !_device->shouldPrewarmPipelines() ) { return; }
+
+	if (_shaderLibraryUsage.empty()) {
+		_pipelineCache->retain();
+		_isUsagePending = true;
+	}
+	for (auto& usage : _shaderLibraryUsage) { if (usage.shaderLibrary == shLib) { return; } }
+	_shaderLibraryUsage.push_back({shaderModule->getKey(), shLib});
+}
+
+// Records the shader libraries of this pipeline in the pipeline cache, the first time this is called.
+void MVKPipeline::recordUsage() {
+	if ( !_isUsagePending.exchange(false) ) { return; }
+
+	_pipelineCache->recordShaderLibraryUsage(_shaderLibraryUsage);
+	_pipelineCache->release();
+}
+
+MVKPipeline::~MVKPipeline() {
+	if (_isUsagePending) { _pipelineCache->release(); }
+	if (_mtlPipelineStatesCompileGroup) { dispatch_release(_mtlPipelineStatesCompileGroup); }
+}
+
 
 #pragma mark -
 #pragma mark MVKGraphicsPipeline
@@ -185,7 +333,8 @@ void MVKGraphicsPipeline::getStages(MVKVector<uint32_t>& stages) {
 }
 
 void MVKGraphicsPipeline::encode(MVKCommandEncoder* cmdEncoder, uint32_t stage) {
-	if ( !_hasValidMTLPipelineStates ) { return; }
+	if ( !hasValidMTLPipelineStates() ) { return; }
+	markUsed();
 
     id<MTLRenderCommandEncoder> mtlCmdEnc = cmdEncoder->_mtlRenderEncoder;
     if ( stage != kMVKGraphicsStageTessControl && !mtlCmdEnc ) { return; }   // Pre-renderpass. Come back later.
@@ -256,10 +405,10 @@ void MVKGraphicsPipeline::encode(MVKCommandEncoder* cmdEncoder, uint32_t stage)
             cmdEncoder->_depthBiasState.setDepthBias(_rasterInfo);
             cmdEncoder->_viewportState.setViewports(_viewports, 0, false);
             cmdEncoder->_scissorState.setScissors(_scissors, 0, false);
-            cmdEncoder->_mtlPrimitiveType = _mtlPrimitiveType;
+            cmdEncoder->_rasterizingState.setPrimitiveType(_mtlPrimitiveType, false);
+            cmdEncoder->_rasterizingState.setCullMode(_mtlCullMode, false);
+            cmdEncoder->_rasterizingState.setFrontFacingWinding(_mtlFrontWinding, false);
 
-            [mtlCmdEnc setCullMode: _mtlCullMode];
-            [mtlCmdEnc setFrontFacingWinding: _mtlFrontWinding];
             [mtlCmdEnc setTriangleFillMode: _mtlFillMode];
 
             if (_device->_enabledFeatures.depthClamp) {
@@ -272,6 +421,29 @@ void MVKGraphicsPipeline::encode(MVKCommandEncoder* cmdEncoder, uint32_t stage)
     cmdEncoder->_graphicsResourcesState.bindBufferSizeBuffer(_bufferSizeBufferIndex, _needsVertexBufferSizeBuffer, _needsTessCtlBufferSizeBuffer, _needsTessEvalBufferSizeBuffer, _needsFragmentBufferSizeBuffer);
 }
 
+// Returns the index of the Vulkan dynamic state within _dynamicStateEnabled,
+// or kMVKVkDynamicStateCount if the dynamic state is not supported.
+static uint32_t mvkGetDynamicStateIndex(VkDynamicState vkDynState) {
+	if (vkDynState <= VK_DYNAMIC_STATE_STENCIL_REFERENCE) { return vkDynState; }
+	switch (vkDynState) {
+#ifdef VK_EXT_extended_dynamic_state
+		case VK_DYNAMIC_STATE_CULL_MODE_EXT:					return kMVKDynamicStateCullMode;
+		case VK_DYNAMIC_STATE_FRONT_FACE_EXT:					return kMVKDynamicStateFrontFace;
+		case VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT:			return kMVKDynamicStatePrimitiveTopology;
+		case VK_DYNAMIC_STATE_VIEWPORT_WITH_COUNT_EXT:			return kMVKDynamicStateViewportWithCount;
+		case VK_DYNAMIC_STATE_SCISSOR_WITH_COUNT_EXT:			return kMVKDynamicStateScissorWithCount;
+		case VK_DYNAMIC_STATE_VERTEX_INPUT_BINDING_STRIDE_EXT:	return kMVKDynamicStateVertexInputBindingStride;
+		case VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT:			return kMVKDynamicStateDepthTestEnable;
+		case VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT:			return kMVKDynamicStateDepthWriteEnable;
+		case VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT:				return kMVKDynamicStateDepthCompareOp;
+		case VK_DYNAMIC_STATE_DEPTH_BOUNDS_TEST_ENABLE_EXT:		return kMVKDynamicStateDepthBoundsTestEnable;
+		case VK_DYNAMIC_STATE_STENCIL_TEST_ENABLE_EXT:			return kMVKDynamicStateStencilTestEnable;
+		case VK_DYNAMIC_STATE_STENCIL_OP_EXT:					return kMVKDynamicStateStencilOp;
+#endif
+		default:												return kMVKVkDynamicStateCount;
+	}
+}
+
 bool MVKGraphicsPipeline::supportsDynamicState(VkDynamicState state) {
 
     // First test if this dynamic state is explicitly turned off
@@ -314,7 +486,9 @@ MVKGraphicsPipeline::MVKGraphicsPipeline(MVKDevice* device,
 	SPIRVTessReflectionData reflectData;
 	std::string reflectErrorLog;
 	if (_pTessCtlSS && _pTessEvalSS) {
-		if (!getTessReflectionData(((MVKShaderModule*)_pTessCtlSS->module)->getSPIRV(), _pTessCtlSS->pName, ((MVKShaderModule*)_pTessEvalSS->module)->getSPIRV(), _pTessEvalSS->pName, reflectData, reflectErrorLog) ) {
+		auto* pTescReflectData = ((MVKShaderModule*)_pTessCtlSS->module)->getReflectionData(spv::ExecutionModelTessellationControl, _pTessCtlSS->pName, reflectErrorLog);
+		auto* pTeseReflectData = pTescReflectData ? ((MVKShaderModule*)_pTessEvalSS->module)->getReflectionData(spv::ExecutionModelTessellationEvaluation, _pTessEvalSS->pName, reflectErrorLog) : nullptr;
+		if ( !pTeseReflectData || !getTessReflectionData(*pTescReflectData, *pTeseReflectData, reflectData, reflectErrorLog) ) {
 			setConfigurationResult(reportError(VK_ERROR_INITIALIZATION_FAILED, "Failed to reflect tessellation shaders: %s", reflectErrorLog.c_str()));
 			return;
 		}
@@ -330,11 +504,20 @@ MVKGraphicsPipeline::MVKGraphicsPipeline(MVKDevice* device,
 	const VkPipelineDynamicStateCreateInfo* pDS = pCreateInfo->pDynamicState;
 	if (pDS) {
 		for (uint32_t i = 0; i < pDS->dynamicStateCount; i++) {
-			VkDynamicState ds = pDS->pDynamicStates[i];
-			_dynamicStateEnabled[ds] = true;
+			uint32_t dsIdx = mvkGetDynamicStateIndex(pDS->pDynamicStates[i]);
+			if (dsIdx < kMVKVkDynamicStateCount) { _dynamicStateEnabled[dsIdx] = true; }
 		}
 	}
 
+	// Viewports and scissors set with a count are also set dynamically.
+	if (_dynamicStateEnabled[kMVKDynamicStateViewportWithCount]) { _dynamicStateEnabled[VK_DYNAMIC_STATE_VIEWPORT] = true; }
+	if (_dynamicStateEnabled[kMVKDynamicStateScissorWithCount]) { _dynamicStateEnabled[VK_DYNAMIC_STATE_SCISSOR] = true; }
+
+	// Metal binds vertex buffers with the strides of the vertex descriptor of the pipeline.
+	if (_dynamicStateEnabled[kMVKDynamicStateVertexInputBindingStride]) {
+		MVKLogInfo("Metal does not support setting vertex binding strides dynamically. The strides of the pipeline vertex bindings will be used.");
+	}
+
 	// Blending
 	if (pCreateInfo->pColorBlendState) {
 		memcpy(&_blendConstants, &pCreateInfo->pColorBlendState->blendConstants, sizeof(_blendConstants));
@@ -402,10 +585,17 @@ MVKGraphicsPipeline::MVKGraphicsPipeline(MVKDevice* device,
 id<MTLRenderPipelineState> MVKGraphicsPipeline::getOrCompilePipeline(MTLRenderPipelineDescriptor* plDesc,
 																	 id<MTLRenderPipelineState>& plState) {
 	if ( !plState ) {
+		if (_pipelineCache) { _pipelineCache->setBinaryArchives(plDesc); }
+		uint64_t startTime = getCompileStartTime();
 		MVKRenderPipelineCompiler* plc = new MVKRenderPipelineCompiler(this);
 		plState = plc->newMTLRenderPipelineState(plDesc);	// retained
 		plc->destroy();
-		if ( !plState ) { _hasValidMTLPipelineStates = false; }
+		addPipelineCompileDuration("Render pipeline", startTime);
+		if ( !plState ) {
+			_hasValidMTLPipelineStates = false;
+		} else if (_pipelineCache) {
+			_pipelineCache->addToBinaryArchive(plDesc);
+		}
 	}
 	return plState;
 }
@@ -415,9 +605,11 @@ id<MTLComputePipelineState> MVKGraphicsPipeline::getOrCompilePipeline(MTLCompute
 																	  id<MTLComputePipelineState>& plState,
 																	  const char* compilerType) {
 	if ( !plState ) {
+		uint64_t startTime = getCompileStartTime();
 		MVKComputePipelineCompiler* plc = new MVKComputePipelineCompiler(this, compilerType);
 		plState = plc->newMTLComputePipelineState(plDesc);	// retained
 		plc->destroy();
+		addPipelineCompileDuration(compilerType, startTime);
 		if ( !plState ) { _hasValidMTLPipelineStates = false; }
 	}
 	return plState;
@@ -434,7 +626,9 @@ void MVKGraphicsPipeline::initMTLRenderPipelineState(const VkGraphicsPipelineCre
 	if (!isTessellationPipeline()) {
 		MTLRenderPipelineDescriptor* plDesc = newMTLRenderPipelineDescriptor(pCreateInfo, reflectData);	// temp retain
 		if (plDesc) {
-			getOrCompilePipeline(plDesc, _mtlPipelineState);
+			compileMTLPipelineStates(^{
+				getOrCompilePipeline(plDesc, _mtlPipelineState);
+			});
 		}
 		[plDesc release];																				// temp release
 	} else {
@@ -448,9 +642,11 @@ void MVKGraphicsPipeline::initMTLRenderPipelineState(const VkGraphicsPipelineCre
 		_mtlTessControlStageDesc = newMTLTessControlStageDescriptor(pCreateInfo, reflectData, shaderContext);				// retained
 		MTLRenderPipelineDescriptor* rastPLDesc = newMTLTessRasterStageDescriptor(pCreateInfo, reflectData, shaderContext);	// temp retained
 		if (vtxPLDesc && _mtlTessControlStageDesc && rastPLDesc) {
-			if (getOrCompilePipeline(vtxPLDesc, _mtlTessVertexStageState)) {
-				getOrCompilePipeline(rastPLDesc, _mtlPipelineState);
-			}
+			compileMTLPipelineStates(^{
+				if (getOrCompilePipeline(vtxPLDesc, _mtlTessVertexStageState)) {
+					getOrCompilePipeline(rastPLDesc, _mtlPipelineState);
+				}
+			});
 		}
 		[vtxPLDesc release];	// temp release
 		[rastPLDesc release];	// temp release
@@ -478,6 +674,12 @@ MTLRenderPipelineDescriptor* MVKGraphicsPipeline::newMTLRenderPipelineDescriptor
 	// Output
 	addFragmentOutputToPipeline(plDesc, reflectData, pCreateInfo);
 
+	// Allow draws using this pipeline to be replayed from, or encoded by the GPU into, a MTLIndirectCommandBuffer.
+	if (_device->shouldReplayReusableCommandBuffers() || _device->shouldPreencodeSecondaryCommandBuffers() ||
+		_device->shouldEncodeMultiDrawIndirectOnGPU()) {
+		plDesc.supportIndirectCommandBuffers = YES;
+	}
+
 	// Metal does not allow the name of the pipeline to be changed after it has been created,
 	// and we need to create the Metal pipeline immediately to provide error feedback to app.
 	// The best we can do at this point is set the pipeline name from the layout.
@@ -527,6 +729,20 @@ static uint32_t sizeOfOutput(const SPIRVShaderOutput& output) {
 	}
 }
 
+// Returns a conservative number of bytes consumed in an output buffer by the specified outputs,
+// per vertex or per patch, by aligning each output and the total to the largest output alignment.
+// If limitComponentCount is not zero, the result is capped at that number of 32-bit components.
+static uint32_t getOutputBufferStride(const std::vector<SPIRVShaderOutput>& outputs, bool perPatch, uint32_t limitComponentCount) {
+	uint32_t stride = 0;
+	for (const SPIRVShaderOutput& output : outputs) {
+		if (output.perPatch != perPatch) { continue; }
+		stride = (uint32_t)mvkAlignByteCount(stride, 16);
+		stride += sizeOfOutput(output);
+	}
+	stride = (uint32_t)mvkAlignByteCount(std::max(stride, 1U), 16);
+	return limitComponentCount ? std::min(stride, limitComponentCount * 4) : stride;
+}
+
 static VkFormat mvkFormatFromOutput(const SPIRVShaderOutput& output) {
 	switch (output.baseType) {
 		case SPIRType::SByte:
@@ -606,13 +822,16 @@ MTLComputePipelineDescriptor* MVKGraphicsPipeline::newMTLTessControlStageDescrip
 																					SPIRVToMSLConversionConfiguration& shaderContext) {
 	MTLComputePipelineDescriptor* plDesc = [MTLComputePipelineDescriptor new];		// retained
 
-	std::vector<SPIRVShaderOutput> vtxOutputs;
 	std::string errorLog;
-	// Unfortunately, MoltenVKShaderConverter doesn't know about MVKVector, so we can't use that here.
-	if (!getShaderOutputs(((MVKShaderModule*)_pVertexSS->module)->getSPIRV(), spv::ExecutionModelVertex, _pVertexSS->pName, vtxOutputs, errorLog) ) {
+	auto* pVtxReflectData = ((MVKShaderModule*)_pVertexSS->module)->getReflectionData(spv::ExecutionModelVertex, _pVertexSS->pName, errorLog);
+	if ( !pVtxReflectData ) {
 		setConfigurationResult(reportError(VK_ERROR_INITIALIZATION_FAILED, "Failed to get vertex outputs: %s", errorLog.c_str()));
+		[plDesc release];
 		return nil;
 	}
+	// Unfortunately, MoltenVKShaderConverter doesn't know about MVKVector, so we can't use that here.
+	const std::vector<SPIRVShaderOutput>& vtxOutputs = pVtxReflectData->outputs;
+	_vertexOutputStride = getOutputBufferStride(vtxOutputs, false, _device->_pProperties->limits.maxVertexOutputComponents);
 
 	// Add shader stages.
 	if (!addTessCtlShaderToPipeline(plDesc, pCreateInfo, shaderContext, vtxOutputs)) {
@@ -654,12 +873,16 @@ MTLRenderPipelineDescriptor* MVKGraphicsPipeline::newMTLTessRasterStageDescripto
 																				  SPIRVToMSLConversionConfiguration& shaderContext) {
 	MTLRenderPipelineDescriptor* plDesc = [MTLRenderPipelineDescriptor new];	// retained
 
-	std::vector<SPIRVShaderOutput> tcOutputs;
 	std::string errorLog;
-	if (!getShaderOutputs(((MVKShaderModule*)_pTessCtlSS->module)->getSPIRV(), spv::ExecutionModelTessellationControl, _pTessCtlSS->pName, tcOutputs, errorLog) ) {
+	auto* pTescReflectData = ((MVKShaderModule*)_pTessCtlSS->module)->getReflectionData(spv::ExecutionModelTessellationControl, _pTessCtlSS->pName, errorLog);
+	if ( !pTescReflectData ) {
 		setConfigurationResult(reportError(VK_ERROR_INITIALIZATION_FAILED, "Failed to get tessellation control outputs: %s", errorLog.c_str()));
+		[plDesc release];
 		return nil;
 	}
+	const std::vector<SPIRVShaderOutput>& tcOutputs = pTescReflectData->outputs;
+	_tessCtlOutputStride = getOutputBufferStride(tcOutputs, false, _device->_pProperties->limits.maxTessellationControlPerVertexOutputComponents);
+	_tessCtlPatchOutputStride = getOutputBufferStride(tcOutputs, true, _device->_pProperties->limits.maxTessellationControlPerPatchOutputComponents);
 
 	// Add shader stages. Compile tessellation evaluation shader before others just in case conversion changes anything...like rasterizaion disable.
 	if (!addTessEvalShaderToPipeline(plDesc, pCreateInfo, shaderContext, tcOutputs)) {
@@ -697,7 +920,7 @@ MTLRenderPipelineDescriptor* MVKGraphicsPipeline::newMTLTessRasterStageDescripto
 				if (innerLoc != (uint32_t)(-1)) {
 					// For triangle tessellation, we use a single attribute. Don't add it more than once.
 					if (reflectData.patchKind == spv::ExecutionModeTriangles) { continue; }
-					// getShaderOutputs() assigned individual elements their own locations. Try to reduce the gap.
+					// Shader reflection assigned individual elements their own locations. Try to reduce the gap.
 					location = innerLoc + 1;
 				}
 				outerLoc = location;
@@ -788,7 +1011,9 @@ bool MVKGraphicsPipeline::addVertexShaderToPipeline(MTLRenderPipelineDescriptor*
 	shaderContext.options.mslOptions.disable_rasterization = isTessellationPipeline() || (pCreateInfo->pRasterizationState && (pCreateInfo->pRasterizationState->rasterizerDiscardEnable));
     addVertexInputToShaderConverterContext(shaderContext, pCreateInfo);
 
-	MVKMTLFunction func = ((MVKShaderModule*)_pVertexSS->module)->getMTLFunction(&shaderContext, _pVertexSS->pSpecializationInfo, _pipelineCache);
+	MVKShaderLibrary* shLib = nullptr;
+	MVKMTLFunction func = ((MVKShaderModule*)_pVertexSS->module)->getMTLFunction(&shaderContext, _pVertexSS->pSpecializationInfo, _pipelineCache, newShaderStageCompileRecord(), &shLib);
+	addShaderLibraryUsage((MVKShaderModule*)_pVertexSS->module, shLib);
 	id<MTLFunction> mtlFunc = func.getMTLFunction();
 	if ( !mtlFunc ) {
 		setConfigurationResult(reportError(VK_ERROR_INVALID_SHADER_NV, "Vertex shader function could not be compiled into pipeline. See previous logged error."));
@@ -797,6 +1022,7 @@ bool MVKGraphicsPipeline::addVertexShaderToPipeline(MTLRenderPipelineDescriptor*
 	plDesc.vertexFunction = mtlFunc;
 
 	auto& funcRslts = func.shaderConversionResults;
+	markPushConstantsUsage(kMVKShaderStageVertex, shaderContext);
 	plDesc.rasterizationEnabled = !funcRslts.isRasterizationDisabled;
 	_needsVertexSwizzleBuffer = funcRslts.needsSwizzleBuffer;
 	_needsVertexBufferSizeBuffer = funcRslts.needsBufferSizeBuffer;
@@ -823,7 +1049,7 @@ bool MVKGraphicsPipeline::addVertexShaderToPipeline(MTLRenderPipelineDescriptor*
 bool MVKGraphicsPipeline::addTessCtlShaderToPipeline(MTLComputePipelineDescriptor* plDesc,
 													 const VkGraphicsPipelineCreateInfo* pCreateInfo,
 													 SPIRVToMSLConversionConfiguration& shaderContext,
-													 std::vector<SPIRVShaderOutput>& vtxOutputs) {
+													 const std::vector<SPIRVShaderOutput>& vtxOutputs) {
 	shaderContext.options.entryPointStage = spv::ExecutionModelTessellationControl;
 	shaderContext.options.entryPointName = _pTessCtlSS->pName;
 	shaderContext.options.mslOptions.swizzle_buffer_index = _swizzleBufferIndex.stages[kMVKShaderStageTessCtl];
@@ -835,7 +1061,9 @@ bool MVKGraphicsPipeline::addTessCtlShaderToPipeline(MTLComputePipelineDescripto
 	shaderContext.options.mslOptions.capture_output_to_buffer = true;
 	addPrevStageOutputToShaderConverterContext(shaderContext, vtxOutputs);
 
-	MVKMTLFunction func = ((MVKShaderModule*)_pTessCtlSS->module)->getMTLFunction(&shaderContext, _pTessCtlSS->pSpecializationInfo, _pipelineCache);
+	MVKShaderLibrary* shLib = nullptr;
+	MVKMTLFunction func = ((MVKShaderModule*)_pTessCtlSS->module)->getMTLFunction(&shaderContext, _pTessCtlSS->pSpecializationInfo, _pipelineCache, newShaderStageCompileRecord(), &shLib);
+	addShaderLibraryUsage((MVKShaderModule*)_pTessCtlSS->module, shLib);
 	id<MTLFunction> mtlFunc = func.getMTLFunction();
 	if ( !mtlFunc ) {
 		setConfigurationResult(reportError(VK_ERROR_INVALID_SHADER_NV, "Tessellation control shader function could not be compiled into pipeline. See previous logged error."));
@@ -844,6 +1072,7 @@ bool MVKGraphicsPipeline::addTessCtlShaderToPipeline(MTLComputePipelineDescripto
 	plDesc.computeFunction = mtlFunc;
 
 	auto& funcRslts = func.shaderConversionResults;
+	markPushConstantsUsage(kMVKShaderStageTessCtl, shaderContext);
 	_needsTessCtlSwizzleBuffer = funcRslts.needsSwizzleBuffer;
 	_needsTessCtlBufferSizeBuffer = funcRslts.needsBufferSizeBuffer;
 	_needsTessCtlOutputBuffer = funcRslts.needsOutputBuffer;
@@ -876,7 +1105,7 @@ bool MVKGraphicsPipeline::addTessCtlShaderToPipeline(MTLComputePipelineDescripto
 bool MVKGraphicsPipeline::addTessEvalShaderToPipeline(MTLRenderPipelineDescriptor* plDesc,
 													  const VkGraphicsPipelineCreateInfo* pCreateInfo,
 													  SPIRVToMSLConversionConfiguration& shaderContext,
-													  std::vector<SPIRVShaderOutput>& tcOutputs) {
+													  const std::vector<SPIRVShaderOutput>& tcOutputs) {
 	shaderContext.options.entryPointStage = spv::ExecutionModelTessellationEvaluation;
 	shaderContext.options.entryPointName = _pTessEvalSS->pName;
 	shaderContext.options.mslOptions.swizzle_buffer_index = _swizzleBufferIndex.stages[kMVKShaderStageTessEval];
@@ -885,7 +1114,9 @@ bool MVKGraphicsPipeline::addTessEvalShaderToPipeline(MTLRenderPipelineDescripto
 	shaderContext.options.mslOptions.disable_rasterization = (pCreateInfo->pRasterizationState && (pCreateInfo->pRasterizationState->rasterizerDiscardEnable));
 	addPrevStageOutputToShaderConverterContext(shaderContext, tcOutputs);
 
-	MVKMTLFunction func = ((MVKShaderModule*)_pTessEvalSS->module)->getMTLFunction(&shaderContext, _pTessEvalSS->pSpecializationInfo, _pipelineCache);
+	MVKShaderLibrary* shLib = nullptr;
+	MVKMTLFunction func = ((MVKShaderModule*)_pTessEvalSS->module)->getMTLFunction(&shaderContext, _pTessEvalSS->pSpecializationInfo, _pipelineCache, newShaderStageCompileRecord(), &shLib);
+	addShaderLibraryUsage((MVKShaderModule*)_pTessEvalSS->module, shLib);
 	id<MTLFunction> mtlFunc = func.getMTLFunction();
 	if ( !mtlFunc ) {
 		setConfigurationResult(reportError(VK_ERROR_INVALID_SHADER_NV, "Tessellation evaluation shader function could not be compiled into pipeline. See previous logged error."));
@@ -895,6 +1126,7 @@ bool MVKGraphicsPipeline::addTessEvalShaderToPipeline(MTLRenderPipelineDescripto
 	plDesc.vertexFunction = mtlFunc;
 
 	auto& funcRslts = func.shaderConversionResults;
+	markPushConstantsUsage(kMVKShaderStageTessEval, shaderContext);
 	plDesc.rasterizationEnabled = !funcRslts.isRasterizationDisabled;
 	_needsTessEvalSwizzleBuffer = funcRslts.needsSwizzleBuffer;
 	_needsTessEvalBufferSizeBuffer = funcRslts.needsBufferSizeBuffer;
@@ -918,7 +1150,9 @@ bool MVKGraphicsPipeline::addFragmentShaderToPipeline(MTLRenderPipelineDescripto
 		shaderContext.options.entryPointName = _pFragmentSS->pName;
 		shaderContext.options.mslOptions.capture_output_to_buffer = false;
 
-		MVKMTLFunction func = ((MVKShaderModule*)_pFragmentSS->module)->getMTLFunction(&shaderContext, _pFragmentSS->pSpecializationInfo, _pipelineCache);
+		MVKShaderLibrary* shLib = nullptr;
+		MVKMTLFunction func = ((MVKShaderModule*)_pFragmentSS->module)->getMTLFunction(&shaderContext, _pFragmentSS->pSpecializationInfo, _pipelineCache, newShaderStageCompileRecord(), &shLib);
+		addShaderLibraryUsage((MVKShaderModule*)_pFragmentSS->module, shLib);
 		id<MTLFunction> mtlFunc = func.getMTLFunction();
 		if ( !mtlFunc ) {
 			setConfigurationResult(reportError(VK_ERROR_INVALID_SHADER_NV, "Fragment shader function could not be compiled into pipeline. See previous logged error."));
@@ -927,6 +1161,7 @@ bool MVKGraphicsPipeline::addFragmentShaderToPipeline(MTLRenderPipelineDescripto
 		plDesc.fragmentFunction = mtlFunc;
 
 		auto& funcRslts = func.shaderConversionResults;
+		markPushConstantsUsage(kMVKShaderStageFragment, shaderContext);
 		_needsFragmentSwizzleBuffer = funcRslts.needsSwizzleBuffer;
 		_needsFragmentBufferSizeBuffer = funcRslts.needsBufferSizeBuffer;
 		if (!verifyImplicitBuffer(_needsFragmentSwizzleBuffer, _swizzleBufferIndex, kMVKShaderStageFragment, "swizzle", 0)) {
@@ -1163,6 +1398,7 @@ void MVKGraphicsPipeline::initMVKShaderConverterContext(SPIRVToMSLConversionConf
 		}
 	}
 
+	shaderContext.options.mslOptions.ios_use_framebuffer_fetch_subpasses = mvkRenderSubpass->usesFramebufferFetchForInputAttachments();
 	shaderContext.options.mslOptions.texture_1D_as_2D = mvkTreatTexture1DAs2D();
     shaderContext.options.mslOptions.enable_point_size_builtin = isRenderingPoints(pCreateInfo, reflectData);
 	shaderContext.options.mslOptions.enable_frag_depth_builtin = pixFmts->isDepthFormat(mtlDSFormat);
@@ -1241,7 +1477,7 @@ void MVKGraphicsPipeline::addVertexInputToShaderConverterContext(SPIRVToMSLConve
 
 // Initializes the vertex attributes in a shader converter context from the previous stage output.
 void MVKGraphicsPipeline::addPrevStageOutputToShaderConverterContext(SPIRVToMSLConversionConfiguration& shaderContext,
-                                                                     std::vector<SPIRVShaderOutput>& shaderOutputs) {
+                                                                     const std::vector<SPIRVShaderOutput>& shaderOutputs) {
     // Set the shader context vertex attribute information
     shaderContext.vertexAttributes.clear();
     uint32_t vaCnt = (uint32_t)shaderOutputs.size();
@@ -1288,12 +1524,18 @@ MVKGraphicsPipeline::~MVKGraphicsPipeline() {
 #pragma mark -
 #pragma mark MVKComputePipeline
 
+// The widest workgroup chosen for a compute pipeline whose workgroup width may be tuned to the GPU.
+// The width actually used is then narrowed to whole SIMD-groups, within the number of threads
+// supported by the compiled pipeline state, which depends on the registers the kernel uses.
+static const uint32_t kMVKTunedWorkgroupWidth = 128;
+
 void MVKComputePipeline::getStages(MVKVector<uint32_t>& stages) {
     stages.push_back(0);
 }
 
 void MVKComputePipeline::encode(MVKCommandEncoder* cmdEncoder, uint32_t) {
-	if ( !_hasValidMTLPipelineStates ) { return; }
+	if ( !hasValidMTLPipelineStates() ) { return; }
+	markUsed();
 
 	[cmdEncoder->getMTLComputeEncoder(kMVKCommandUseDispatch) setComputePipelineState: _mtlPipelineState];
     cmdEncoder->_mtlThreadgroupSize = _mtlThreadgroupSize;
@@ -1309,7 +1551,10 @@ MVKComputePipeline::MVKComputePipeline(MVKDevice* device,
 
 	_allowsDispatchBase = mvkAreAllFlagsEnabled(pCreateInfo->flags, VK_PIPELINE_CREATE_DISPATCH_BASE);	// sic; drafters forgot the 'BIT' suffix
 
-	MVKMTLFunction func = getMTLFunction(pCreateInfo);
+	uint32_t tunedWidth = (((MVKShaderModule*)pCreateInfo->stage.module)->isWorkgroupSizeTunable()
+						   ? (uint32_t)min<NSUInteger>(kMVKTunedWorkgroupWidth, getMTLDevice().maxThreadsPerThreadgroup.width)
+						   : 0);
+	MVKMTLFunction func = getMTLFunction(pCreateInfo, tunedWidth);
 	_mtlThreadgroupSize = func.threadGroupSize;
 	_mtlPipelineState = nil;
 
@@ -1323,12 +1568,20 @@ MVKComputePipeline::MVKComputePipeline(MVKDevice* device,
 		// The best we can do at this point is set the pipeline name from the layout.
 		setLabelIfNotNil(plDesc, ((MVKPipelineLayout*)pCreateInfo->layout)->getDebugName());
 
-		MVKComputePipelineCompiler* plc = new MVKComputePipelineCompiler(this);
-		_mtlPipelineState = plc->newMTLComputePipelineState(plDesc);	// retained
-		plc->destroy();
+		// Tuning the workgroup width may specialize the shader function again, which needs the shader
+		// module, and the app may destroy the shader module once the pipeline has been created.
+		// So a pipeline whose workgroup width is tuned is compiled before this constructor returns.
+		if (_isWorkgroupSizeTuned) {
+			compileMTLPipelineState(plDesc);
+			tuneWorkgroupSize(pCreateInfo, plDesc);
+			validateMTLPipelineState(plDesc);
+		} else {
+			compileMTLPipelineStates(^{
+				compileMTLPipelineState(plDesc);
+				validateMTLPipelineState(plDesc);
+			});
+		}
 		[plDesc release];															// temp release
-
-		if ( !_mtlPipelineState ) { _hasValidMTLPipelineStates = false; }
 	} else {
 		setConfigurationResult(reportError(VK_ERROR_INVALID_SHADER_NV, "Compute shader function could not be compiled into pipeline. See previous logged error."));
 	}
@@ -1344,8 +1597,86 @@ MVKComputePipeline::MVKComputePipeline(MVKDevice* device,
 	}
 }
 
+// Compiles the MTLComputePipelineState, replacing any previously compiled pipeline state.
+void MVKComputePipeline::compileMTLPipelineState(MTLComputePipelineDescriptor* plDesc) {
+	if (_pipelineCache) { _pipelineCache->setBinaryArchives(plDesc); }
+	uint64_t startTime = getCompileStartTime();
+	MVKComputePipelineCompiler* plc = new MVKComputePipelineCompiler(this);
+	[_mtlPipelineState release];
+	_mtlPipelineState = plc->newMTLComputePipelineState(plDesc);	// retained
+	plc->destroy();
+	addPipelineCompileDuration("Compute pipeline", startTime);
+}
+
+// Marks this pipeline invalid if the MTLComputePipelineState could not be compiled, or does not
+// support the workgroup size, otherwise adds the pipeline state to the binary archive.
+void MVKComputePipeline::validateMTLPipelineState(MTLComputePipelineDescriptor* plDesc) {
+	if ( !_mtlPipelineState ) {
+		_hasValidMTLPipelineStates = false;
+	} else if ( !validateThreadgroupSize() ) {
+		_hasValidMTLPipelineStates = false;
+	} else if (_pipelineCache) {
+		_pipelineCache->addToBinaryArchive(plDesc);
+	}
+}
+
+// Narrows the tuned workgroup width to the widest whole number of SIMD-groups supported by the compiled
+// MTLComputePipelineState, and if that differs from the compiled width, recompiles the pipeline state
+// with the narrower width. If the recompiled pipeline state does not support that width either,
+// because it uses different registers, falls back to the workgroup width set by the app.
+void MVKComputePipeline::tuneWorkgroupSize(const VkComputePipelineCreateInfo* pCreateInfo, MTLComputePipelineDescriptor* plDesc) {
+	if ( !_mtlPipelineState ) { return; }
+
+	NSUInteger simdWidth = _mtlPipelineState.threadExecutionWidth;
+	NSUInteger width = min(_mtlThreadgroupSize.width, _mtlPipelineState.maxTotalThreadsPerThreadgroup);
+	if (simdWidth && width > simdWidth) { width -= width % simdWidth; }
+	if (width == _mtlThreadgroupSize.width) { return; }
+
+	if (recompileMTLPipelineState(pCreateInfo, plDesc, (uint32_t)width) &&
+		_mtlThreadgroupSize.width <= _mtlPipelineState.maxTotalThreadsPerThreadgroup) { return; }
+
+	recompileMTLPipelineState(pCreateInfo, plDesc, 0);
+}
+
+// Specializes the shader function with the tuned workgroup width, or with the workgroup width set
+// by the app if it is zero, and recompiles the MTLComputePipelineState from it.
+// Returns whether the pipeline state was recompiled.
+bool MVKComputePipeline::recompileMTLPipelineState(const VkComputePipelineCreateInfo* pCreateInfo,
+												   MTLComputePipelineDescriptor* plDesc,
+												   uint32_t tunedWidth) {
+	MVKMTLFunction func = getMTLFunction(pCreateInfo, tunedWidth);
+	id<MTLFunction> mtlFunc = func.getMTLFunction();
+	if ( !mtlFunc ) { return false; }
+
+	_mtlThreadgroupSize = func.threadGroupSize;
+	plDesc.computeFunction = mtlFunc;
+	compileMTLPipelineState(plDesc);
+	return _mtlPipelineState != nil;
+}
+
+// Returns whether the compiled MTLComputePipelineState supports the number of threads in the workgroup.
+// The number of threads it supports depends on the resources the kernel uses, such as registers.
+// Also reports workgroups that leave lanes of their last SIMD-group idle, as a performance hint.
+bool MVKComputePipeline::validateThreadgroupSize() {
+	NSUInteger tgThreadCnt = _mtlThreadgroupSize.width * _mtlThreadgroupSize.height * _mtlThreadgroupSize.depth;
+	NSUInteger maxThreadCnt = _mtlPipelineState.maxTotalThreadsPerThreadgroup;
+	if (tgThreadCnt > maxThreadCnt) {
+		reportError(VK_ERROR_INITIALIZATION_FAILED, "Compute shader workgroup size (%lu x %lu x %lu) exceeds the maximum of %lu threads per workgroup supported by this pipeline on this GPU.",
+					(unsigned long)_mtlThreadgroupSize.width, (unsigned long)_mtlThreadgroupSize.height, (unsigned long)_mtlThreadgroupSize.depth, (unsigned long)maxThreadCnt);
+		return false;
+	}
+
+	NSUInteger simdWidth = _mtlPipelineState.threadExecutionWidth;
+	if (simdWidth && (tgThreadCnt % simdWidth)) {
+		MVKLogInfo("Compute shader workgroup size (%lu x %lu x %lu) is not a multiple of the %lu threads the GPU executes together, which leaves some GPU threads idle.",
+				   (unsigned long)_mtlThreadgroupSize.width, (unsigned long)_mtlThreadgroupSize.height, (unsigned long)_mtlThreadgroupSize.depth, (unsigned long)simdWidth);
+	}
+	return true;
+}
+
 // Returns a MTLFunction to use when creating the MTLComputePipelineState.
-MVKMTLFunction MVKComputePipeline::getMTLFunction(const VkComputePipelineCreateInfo* pCreateInfo) {
+// If tunedWidth is not zero, the function is specialized with that workgroup width, if the shader allows it.
+MVKMTLFunction MVKComputePipeline::getMTLFunction(const VkComputePipelineCreateInfo* pCreateInfo, uint32_t tunedWidth) {
 
     const VkPipelineShaderStageCreateInfo* pSS = &pCreateInfo->stage;
     if ( !mvkAreAllFlagsEnabled(pSS->stage, VK_SHADER_STAGE_COMPUTE_BIT) ) { return MVKMTLFunctionNull; }
@@ -1368,9 +1699,14 @@ MVKMTLFunction MVKComputePipeline::getMTLFunction(const VkComputePipelineCreateI
     shaderContext.options.mslOptions.buffer_size_buffer_index = _bufferSizeBufferIndex.stages[kMVKShaderStageCompute];
     shaderContext.options.mslOptions.indirect_params_buffer_index = _indirectParamsIndex.stages[kMVKShaderStageCompute];
 
-    MVKMTLFunction func = ((MVKShaderModule*)pSS->module)->getMTLFunction(&shaderContext, pSS->pSpecializationInfo, _pipelineCache);
+    MVKShaderLibrary* shLib = nullptr;
+    MVKMTLFunction func = ((MVKShaderModule*)pSS->module)->getMTLFunction(&shaderContext, pSS->pSpecializationInfo, _pipelineCache, newShaderStageCompileRecord(), &shLib, tunedWidth);
+    addShaderLibraryUsage((MVKShaderModule*)pSS->module, shLib);
 
 	auto& funcRslts = func.shaderConversionResults;
+	_isWorkgroupSizeTuned = (tunedWidth && funcRslts.entryPoint.workgroupSize.width.isSpecialized &&
+							 func.threadGroupSize.height == 1 && func.threadGroupSize.depth == 1);
+	markPushConstantsUsage(kMVKShaderStageCompute, shaderContext);
 	_needsSwizzleBuffer = funcRslts.needsSwizzleBuffer;
     _needsBufferSizeBuffer = funcRslts.needsBufferSizeBuffer;
     _needsDispatchBaseBuffer = funcRslts.needsDispatchBaseBuffer;
@@ -1387,26 +1723,44 @@ MVKComputePipeline::~MVKComputePipeline() {
 #pragma mark MVKPipelineCache
 
 // Return a shader library from the specified shader context sourced from the specified shader module.
+// The shader library cache manages its own locking, so existing shader libraries can be
+// retrieved concurrently, and the serialization lock is only taken if a library was added.
 MVKShaderLibrary* MVKPipelineCache::getShaderLibrary(SPIRVToMSLConversionConfiguration* pContext, MVKShaderModule* shaderModule) {
-	lock_guard<mutex> lock(_shaderCacheLock);
-
 	bool wasAdded = false;
 	MVKShaderLibraryCache* slCache = getShaderLibraryCache(shaderModule->getKey());
 	MVKShaderLibrary* shLib = slCache->getShaderLibrary(pContext, shaderModule, &wasAdded);
-	if (wasAdded) { markDirty(); }
+	if (wasAdded) {
+		lock_guard<mutex> lock(_shaderCacheLock);
+		markDirty();
+	}
 	return shLib;
 }
 
 // Returns a shader library cache for the specified shader module key, creating it if necessary.
+// Shader library caches are never removed, so the returned cache remains valid once the lock is released.
+// When a shader library cache is created, any shader libraries loaded for it from the initial cache data
+// are decoded, so only the shader libraries of shader modules that are actually used are decoded.
 MVKShaderLibraryCache* MVKPipelineCache::getShaderLibraryCache(MVKShaderModuleKey smKey) {
-	MVKShaderLibraryCache* slCache = _shaderCache[smKey];
+	MVKShaderCacheShard& scShard = getShaderCacheShard(smKey);
+	{
+		MVKSharedLock lock(scShard.lock);
+		auto iter = scShard.shaderCache.find(smKey);
+		if (iter != scShard.shaderCache.end()) { return iter->second; }
+	}
+
+	lock_guard<MVKSharedMutex> lock(scShard.lock);
+	MVKShaderLibraryCache*& slCache = scShard.shaderCache[smKey];
 	if ( !slCache ) {
 		slCache = new MVKShaderLibraryCache(this);
-		_shaderCache[smKey] = slCache;
+		loadShaderLibraries(scShard, smKey, slCache);
 	}
 	return slCache;
 }
 
+MVKPipelineCache::MVKShaderCacheShard& MVKPipelineCache::getShaderCacheShard(MVKShaderModuleKey smKey) {
+	return _shaderCacheShards[std::hash<MVKShaderModuleKey>()(smKey) % kMVKShaderCacheShardCount];
+}
+
 
 #pragma mark Streaming pipeline cache to and from offline memory
 
@@ -1416,8 +1770,28 @@ static uint32_t kDataHeaderSize = (sizeof(uint32_t) * 4) + VK_UUID_SIZE;
 typedef enum {
 	MVKPipelineCacheEntryTypeEOF = 0,
 	MVKPipelineCacheEntryTypeShaderLibrary = 1,
+	MVKPipelineCacheEntryTypeBinaryArchive = 2,
+	MVKPipelineCacheEntryTypeShaderLibraryIndex = 3,
+	MVKPipelineCacheEntryTypeUsageManifest = 4,
 } MVKPipelineCacheEntryType;
 
+// Returns the number of bytes occupied by each shader library in a shader library index entry.
+static size_t mvkMeasureShaderLibraryIndexEntrySize() {
+	mvk::countbuf cb;
+	ostream outStream(&cb);
+	cereal::BinaryOutputArchive writer(outStream);
+	MVKShaderModuleKey smKey;
+	uint64_t entryOffset = 0;
+	uint64_t entrySize = 0;
+	writer(smKey, entryOffset, entrySize);
+	return cb.buffSize;
+}
+
+static size_t mvkGetShaderLibraryIndexEntrySize() {
+	static const size_t indexEntrySize = mvkMeasureShaderLibraryIndexEntrySize();
+	return indexEntrySize;
+}
+
 // Helper class to iterate through the shader libraries in a shader library cache in order to serialize them.
 // Needs to support input of null shader library cache.
 class MVKShaderCacheIterator : public MVKBaseObject {
@@ -1429,9 +1803,7 @@ protected:
 	friend MVKPipelineCache;
 
 	bool next() { return (++_index < (_pSLCache ? _pSLCache->_shaderLibraries.size() : 0)); }
-	SPIRVToMSLConversionConfiguration& getShaderConversionConfig() { return _pSLCache->_shaderLibraries[_index].first; }
-	std::string& getMSL() { return _pSLCache->_shaderLibraries[_index].second->_msl; }
-	SPIRVToMSLConversionResults& getShaderConversionResults() { return _pSLCache->_shaderLibraries[_index].second->_shaderConversionResults; }
+	const std::string& getSerializedEntry() { return _pSLCache->_shaderLibraries[_index].second->_serializedEntry; }
 	MVKShaderCacheIterator(MVKShaderLibraryCache* pSLCache) : _pSLCache(pSLCache) {}
 
 	MVKShaderLibraryCache* _pSLCache;
@@ -1439,17 +1811,99 @@ protected:
 	int32_t _index = -1;
 };
 
+// Serializes the shader library as a pipeline cache data entry, unless it was copied from another
+// pipeline cache, or loaded from the initial cache data, with its entry already serialized, and adds
+// the entry to the size of the cache data. Entries are immutable once serialized, so they are written
+// as is by writeData(), and the size of the cache data does not need to be measured by visiting them.
+// The shader module key of each entry is written separately, in the shader library index.
+void MVKPipelineCache::addShaderLibraryEntry(const SPIRVToMSLConversionConfiguration& shaderContext,
+											 MVKShaderLibrary* shLib) {
+	if (shLib->_serializedEntry.empty()) {
+		uint64_t startTime = _device->getPerformanceTimestamp();
+
+		ostringstream outStream;
+		cereal::BinaryOutputArchive writer(outStream);
+		writer(shaderContext);
+		writer(shLib->_shaderConversionResults);
+		writer(shLib->_msl);
+
+		shLib->_serializedEntry = outStream.str();
+		_device->addActivityPerformance(_device->_performanceStatistics.pipelineCache.writePipelineCache, startTime);
+	}
+	if ( !shLib->_serializedEntryHash ) { shLib->_serializedEntryHash = std::hash<string>()(shLib->_serializedEntry); }
+	_shaderLibraryEntriesSize += shLib->_serializedEntry.size();
+	_shaderLibraryEntryCount++;
+}
+
+// Decodes the shader library entries loaded from the initial cache data for the specified shader module,
+// and adds them to the shader library cache. Each shader library keeps its raw entry, so it is written
+// back out unchanged, and its MTLLibrary is not compiled until a MTLFunction is first retrieved from it.
+// The caller must hold the lock of the shard exclusively.
+void MVKPipelineCache::loadShaderLibraries(MVKShaderCacheShard& scShard,
+										   MVKShaderModuleKey smKey,
+										   MVKShaderLibraryCache* slCache) {
+	auto iter = scShard.pendingEntries.find(smKey);
+	if (iter == scShard.pendingEntries.end()) { return; }
+
+	lock_guard<MVKSharedMutex> lock(slCache->_accessLock);
+	for (auto& entryLoc : iter->second) {
+		uint64_t startTime = _device->getPerformanceTimestamp();
+
+		// The entry is no longer pending. If it is successfully decoded, it is counted again when it is added.
+		_shaderLibraryEntriesSize -= entryLoc.size;
+		_shaderLibraryEntryCount--;
+
+		char* pEntry = &_loadedData[entryLoc.offset];
+		try {
+			mvk::membuf mb(pEntry, entryLoc.size);
+			istream inStream(&mb);
+			cereal::BinaryInputArchive reader(inStream);
+
+			SPIRVToMSLConversionConfiguration shaderConversionConfig;
+			reader(shaderConversionConfig);
+
+			SPIRVToMSLConversionResults shaderConversionResults;
+			reader(shaderConversionResults);
+
+			string msl;
+			reader(msl);
+
+			MVKShaderLibrary* shLib = new MVKShaderLibrary(this, msl, shaderConversionResults);
+			shLib->_serializedEntry.assign(pEntry, entryLoc.size);
+			slCache->addShaderLibrary(&shaderConversionConfig, shLib);
+		} catch (cereal::Exception& ex) {
+			reportError(VK_SUCCESS, "Error reading pipeline cache data: %s", ex.what());
+		}
+
+		_device->addActivityPerformance(_device->_performanceStatistics.pipelineCache.readPipelineCache, startTime);
+	}
+	scShard.pendingEntries.erase(iter);
+}
+
 // If pData is not null, serializes at most pDataSize bytes of the contents of the cache into that
 // memory location, and returns the number of bytes serialized in pDataSize. If pData is null,
 // returns the number of bytes required to serialize the contents of this pipeline cache.
 // This is the compliment of the readData() function. The two must be kept aligned.
 VkResult MVKPipelineCache::writeData(size_t* pDataSize, void* pData) {
+	// Ensure compiled pipeline states still being added to the binary archive are included.
+	if (_binaryArchiveGroup) { dispatch_group_wait(_binaryArchiveGroup, DISPATCH_TIME_FOREVER); }
+
 	lock_guard<mutex> lock(_shaderCacheLock);
 
 	try {
 
 		if ( !pDataSize ) { return VK_SUCCESS; }
 
+		// Shader library entries are counted as they are added, so only the remaining content is measured.
+		if (_dataSize == 0) {
+			mvk::countbuf cb;
+			ostream outStream(&cb);
+			writeData(outStream, true);
+			_dataSize = (cb.buffSize +
+						 (_shaderLibraryEntryCount * mvkGetShaderLibraryIndexEntrySize()) +
+						 _shaderLibraryEntriesSize);
+		}
+
 		if (pData) {
 			if (*pDataSize >= _dataSize) {
 				mvk::membuf mb((char*)pData, _dataSize);
@@ -1462,12 +1916,6 @@ VkResult MVKPipelineCache::writeData(size_t* pDataSize, void* pData) {
 				return VK_INCOMPLETE;
 			}
 		} else {
-			if (_dataSize == 0) {
-				mvk::countbuf cb;
-				ostream outStream(&cb);
-				writeData(outStream, true);
-				_dataSize = cb.buffSize;
-			}
 			*pDataSize = _dataSize;
 			return VK_SUCCESS;
 		}
@@ -1497,20 +1945,93 @@ void MVKPipelineCache::writeData(ostream& outstream, bool isCounting) {
 	writer(pDevProps->pipelineCacheUUID);
 
 	// Shader libraries
-	// Output a cache entry for each shader library, including the shader module key in each entry.
-	cacheEntryType = MVKPipelineCacheEntryTypeShaderLibrary;
-	for (auto& scPair : _shaderCache) {
-		MVKShaderModuleKey smKey = scPair.first;
-		MVKShaderCacheIterator cacheIter(scPair.second);
-		while (cacheIter.next()) {
-			uint64_t startTime = _device->getPerformanceTimestamp();
-			writer(cacheEntryType);
-			writer(smKey);
-			writer(cacheIter.getShaderConversionConfig());
-			writer(cacheIter.getShaderConversionResults());
-			writer(cacheIter.getMSL());
-			_device->addActivityPerformance(activityTracker, startTime);
+	// Output a single cache entry holding an index of the shader libraries, followed by the shader library
+	// entries, which were serialized when each shader library was added, or which were loaded from the
+	// initial cache data and have not been decoded. The index lets a cache loading this data locate the
+	// entries of each shader module without decoding them. When counting, the number and size of the
+	// entries are already known, so they do not need to be visited, and only the index header is counted.
+	cacheEntryType = MVKPipelineCacheEntryTypeShaderLibraryIndex;
+	writer(cacheEntryType);
+	if (isCounting) {
+		uint32_t entryCount = _shaderLibraryEntryCount;
+		writer(entryCount);
+	} else {
+		uint64_t startTime = _device->getPerformanceTimestamp();
+
+		// Entries are immutable and never removed, so they can be referenced after the locks are released.
+		struct MVKShaderLibraryEntryRef {
+			MVKShaderModuleKey smKey;
+			const char* pEntry;
+			uint64_t size;
+		};
+		vector<MVKShaderLibraryEntryRef> entryRefs;
+		for (auto& scShard : _shaderCacheShards) {
+			MVKSharedLock shardLock(scShard.lock);
+			for (auto& scPair : scShard.shaderCache) {
+				MVKSharedLock slCacheLock(scPair.second->_accessLock);
+				MVKShaderCacheIterator cacheIter(scPair.second);
+				while (cacheIter.next()) {
+					const string& entry = cacheIter.getSerializedEntry();
+					entryRefs.push_back({scPair.first, entry.data(), entry.size()});
+				}
+			}
+			for (auto& pePair : scShard.pendingEntries) {
+				for (auto& entryLoc : pePair.second) {
+					entryRefs.push_back({pePair.first, &_loadedData[entryLoc.offset], entryLoc.size});
+				}
+			}
+		}
+
+		uint32_t entryCount = (uint32_t)entryRefs.size();
+		writer(entryCount);
+		uint64_t entryOffset = 0;
+		for (auto& entryRef : entryRefs) {
+			writer(entryRef.smKey, entryOffset, entryRef.size);
+			entryOffset += entryRef.size;
+		}
+		for (auto& entryRef : entryRefs) {
+			writer(cereal::binary_data(entryRef.pEntry, entryRef.size));
 		}
+
+		_device->addActivityPerformance(activityTracker, startTime);
+	}
+
+	// Compiled pipeline states
+	// Output a single cache entry holding the serialized binary archive, if there is one.
+	// Readers that do not recognize this entry type treat it as the end of the archive.
+	string archiveData;
+	if (getBinaryArchiveData(archiveData)) {
+		uint64_t startTime = _device->getPerformanceTimestamp();
+		cacheEntryType = MVKPipelineCacheEntryTypeBinaryArchive;
+		writer(cacheEntryType);
+		writer(archiveData);
+		_device->addActivityPerformance(activityTracker, startTime);
+	}
+
+	// Usage manifest
+	// Output a single cache entry listing the shader libraries used by this session, in order of first use,
+	// followed by those used by previous sessions that have not been used yet by this session, and that are
+	// still held by this cache, so records of shader libraries that were not written out are dropped.
+	if ( !_usageManifest.empty() || !_loadedUsageManifest.empty() ) {
+		uint64_t startTime = _device->getPerformanceTimestamp();
+		vector<const MVKShaderLibraryUsageRecord*> loadedUsageRecs;
+		for (auto& usageRec : _loadedUsageManifest) {
+			if ( !_usageManifestHashes.count(usageRec.hash()) && isShaderLibraryCached(usageRec) ) {
+				loadedUsageRecs.push_back(&usageRec);
+			}
+		}
+		uint32_t recCount = (uint32_t)(_usageManifest.size() + loadedUsageRecs.size());
+
+		cacheEntryType = MVKPipelineCacheEntryTypeUsageManifest;
+		writer(cacheEntryType);
+		writer(recCount);
+		for (auto& usageRec : _usageManifest) {
+			writer(usageRec.codeSize, usageRec.codeHash, usageRec.entryHash, usageRec.firstUseTime);
+		}
+		for (auto* pUsageRec : loadedUsageRecs) {
+			writer(pUsageRec->codeSize, pUsageRec->codeHash, pUsageRec->entryHash, pUsageRec->firstUseTime);
+		}
+		_device->addActivityPerformance(activityTracker, startTime);
 	}
 
 	// Mark the end of the archive
@@ -1580,6 +2101,79 @@ void MVKPipelineCache::readData(const VkPipelineCacheCreateInfo* pCreateInfo) {
 					break;
 				}
 
+				case MVKPipelineCacheEntryTypeShaderLibraryIndex: {
+					uint64_t startTime = _device->getPerformanceTimestamp();
+
+					// Read the index, and ensure the entries it locates are all present.
+					uint32_t entryCount;
+					reader(entryCount);
+					if (entryCount > (size_t)mb.in_avail() / mvkGetShaderLibraryIndexEntrySize()) { return; }
+
+					MVKVectorInline<std::pair<MVKShaderModuleKey, MVKShaderLibraryEntryLocation>, 1> entryIndex;
+					entryIndex.resize(entryCount);
+					uint64_t entriesSize = 0;
+					for (auto& idxPair : entryIndex) {
+						MVKShaderLibraryEntryLocation& entryLoc = idxPair.second;
+						reader(idxPair.first, entryLoc.offset, entryLoc.size);
+						if (entryLoc.offset > byteCount || entryLoc.size > byteCount - entryLoc.offset) { return; }
+						entriesSize = max(entriesSize, entryLoc.offset + entryLoc.size);
+					}
+					if (entriesSize > (uint64_t)mb.in_avail()) { return; }
+
+					// The initial data is only valid during cache creation, so the entries are copied as one
+					// block, and are only decoded when the shader library cache of their shader module is used.
+					size_t loadedDataOffset = _loadedData.size();
+					const char* pEntries = mb.getReadPosition();
+					_loadedData.insert(_loadedData.end(), pEntries, pEntries + entriesSize);
+					mb.skip(entriesSize);
+
+					for (auto& idxPair : entryIndex) {
+						MVKShaderLibraryEntryLocation entryLoc = idxPair.second;
+						entryLoc.offset += loadedDataOffset;
+						_shaderLibraryEntriesSize += entryLoc.size;
+						_shaderLibraryEntryCount++;
+
+						MVKShaderCacheShard& scShard = getShaderCacheShard(idxPair.first);
+						lock_guard<MVKSharedMutex> lock(scShard.lock);
+						scShard.pendingEntries[idxPair.first].push_back(entryLoc);
+
+						// If the shader library cache already exists, it is not created again, so decode now.
+						auto iter = scShard.shaderCache.find(idxPair.first);
+						if (iter != scShard.shaderCache.end()) { loadShaderLibraries(scShard, idxPair.first, iter->second); }
+					}
+
+					_device->addActivityPerformance(_device->_performanceStatistics.pipelineCache.readPipelineCache, startTime);
+
+					break;
+				}
+
+				case MVKPipelineCacheEntryTypeBinaryArchive: {
+					uint64_t startTime = _device->getPerformanceTimestamp();
+
+					string archiveData;
+					reader(archiveData);
+
+					initBinaryArchive(archiveData);
+					_device->addActivityPerformance(_device->_performanceStatistics.pipelineCache.readPipelineCache, startTime);
+
+					break;
+				}
+
+				case MVKPipelineCacheEntryTypeUsageManifest: {
+					static const size_t usageRecSize = (sizeof(uint64_t) * 3) + sizeof(uint32_t);
+
+					uint32_t recCount;
+					reader(recCount);
+					if (recCount > (size_t)mb.in_avail() / usageRecSize) { return; }
+
+					_loadedUsageManifest.resize(recCount);
+					for (auto& usageRec : _loadedUsageManifest) {
+						reader(usageRec.codeSize, usageRec.codeHash, usageRec.entryHash, usageRec.firstUseTime);
+					}
+
+					break;
+				}
+
 				default: {
 					done = true;
 					break;
@@ -1597,11 +2191,26 @@ void MVKPipelineCache::markDirty() {
 	_dataSize = 0;
 }
 
+// Shader libraries in the source caches that were loaded from initial cache data, but not yet decoded,
+// are decoded first, so they can be compared with the shader libraries in this cache.
 VkResult MVKPipelineCache::mergePipelineCaches(uint32_t srcCacheCount, const VkPipelineCache* pSrcCaches) {
+	lock_guard<mutex> lock(_shaderCacheLock);
+
 	for (uint32_t srcIdx = 0; srcIdx < srcCacheCount; srcIdx++) {
 		MVKPipelineCache* srcPLC = (MVKPipelineCache*)pSrcCaches[srcIdx];
-		for (auto& srcPair : srcPLC->_shaderCache) {
-			getShaderLibraryCache(srcPair.first)->merge(srcPair.second);
+		for (auto& srcShard : srcPLC->_shaderCacheShards) {
+			MVKVectorInline<MVKShaderModuleKey, 8> pendingKeys;
+			{
+				MVKSharedLock srcShardLock(srcShard.lock);
+				for (auto& pePair : srcShard.pendingEntries) { pendingKeys.push_back(pePair.first); }
+			}
+			for (auto& smKey : pendingKeys) { srcPLC->getShaderLibraryCache(smKey); }
+		}
+		for (auto& srcShard : srcPLC->_shaderCacheShards) {
+			MVKSharedLock srcShardLock(srcShard.lock);
+			for (auto& srcPair : srcShard.shaderCache) {
+				getShaderLibraryCache(srcPair.first)->merge(srcPair.second);
+			}
 		}
 	}
 	markDirty();
@@ -1610,6 +2219,208 @@ VkResult MVKPipelineCache::mergePipelineCaches(uint32_t srcCacheCount, const VkP
 }
 
 
+#pragma mark Prewarming
+
+// Records each shader library the first time it is used by a bound pipeline. Only shader libraries
+// that are serialized in the cache data can be identified when the cache data is loaded again.
+void MVKPipelineCache::recordShaderLibraryUsage(MVKVector<MVKShaderLibraryUsage>& shLibUsage) {
+	uint32_t firstUseTime = (uint32_t)mvkGetElapsedMilliseconds(_creationTime);
+
+	lock_guard<mutex> lock(_shaderCacheLock);
+
+	for (auto& slUsage : shLibUsage) {
+		MVKShaderLibraryUsageRecord usageRec;
+		usageRec.codeSize = slUsage.smKey.codeSize;
+		usageRec.codeHash = slUsage.smKey.codeHash;
+		usageRec.entryHash = slUsage.shaderLibrary->_serializedEntryHash;
+		usageRec.firstUseTime = firstUseTime;
+		if (usageRec.entryHash && _usageManifestHashes.insert(usageRec.hash()).second) {
+			_usageManifest.push_back(usageRec);
+			markDirty();
+		}
+	}
+}
+
+// Compiles the MTLLibrary of each shader library listed in the usage manifest loaded from the initial
+// cache data, in the order the shader libraries were first used, on a low-priority background queue,
+// so they are ready by the time the app creates the pipelines that use them. The MTLLibrary of each
+// shader library is compiled only once, so a pipeline created while prewarming is underway waits for
+// a shader library being prewarmed, and shader libraries already compiled for a pipeline are skipped.
+void MVKPipelineCache::prewarmShaderLibraries() {
+	if (_loadedUsageManifest.empty() || !_device->shouldPrewarmPipelines()) { return; }
+
+	_prewarmGroup = dispatch_group_create();	// retained
+	dispatch_group_async(_prewarmGroup, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0), ^{
+		for (auto& usageRec : _loadedUsageManifest) {
+			if (_isPrewarmCancelled) { break; }
+			@autoreleasepool { prewarmShaderLibrary(usageRec); }
+		}
+	});
+}
+
+// Retrieving the shader library cache of the shader module decodes its shader library entries.
+void MVKPipelineCache::prewarmShaderLibrary(const MVKShaderLibraryUsageRecord& usageRec) {
+	MVKShaderLibraryCache* slCache = getShaderLibraryCache(MVKShaderModuleKey(usageRec.codeSize, usageRec.codeHash));
+
+	MVKShaderLibrary* shLib = nullptr;
+	{
+		MVKSharedLock lock(slCache->_accessLock);
+		auto iter = slCache->_shaderLibrariesBySerializedEntryHash.find(usageRec.entryHash);
+		if (iter != slCache->_shaderLibrariesBySerializedEntryHash.end()) { shLib = iter->second; }
+	}
+	if (shLib) { shLib->getMTLLibrary(); }
+}
+
+
+// Returns whether this cache holds the shader library entry identified by the usage record. The entries
+// of a shader module that have not been decoded yet are identified only by the shader module key,
+// since their hashes are not known until they are decoded.
+bool MVKPipelineCache::isShaderLibraryCached(const MVKShaderLibraryUsageRecord& usageRec) {
+	MVKShaderModuleKey smKey(usageRec.codeSize, usageRec.codeHash);
+	MVKShaderCacheShard& scShard = getShaderCacheShard(smKey);
+	MVKSharedLock shardLock(scShard.lock);
+
+	if (scShard.pendingEntries.find(smKey) != scShard.pendingEntries.end()) { return true; }
+
+	auto scIter = scShard.shaderCache.find(smKey);
+	if (scIter == scShard.shaderCache.end()) { return false; }
+
+	MVKSharedLock slCacheLock(scIter->second->_accessLock);
+	auto& shLibsByEntryHash = scIter->second->_shaderLibrariesBySerializedEntryHash;
+	return shLibsByEntryHash.find(usageRec.entryHash) != shLibsByEntryHash.end();
+}
+
+
+#pragma mark Binary archives
+
+// Returns a new autoreleased URL of a unique temporary file, since Metal can only load
+// and serialize the contents of a binary archive using a file.
+static NSURL* mvkNewBinaryArchiveTempFileURL() {
+	NSString* fileName = [NSString stringWithFormat: @"MoltenVK-%@.metallib", NSUUID.UUID.UUIDString];
+	return [NSURL fileURLWithPath: [NSTemporaryDirectory() stringByAppendingPathComponent: fileName]];
+}
+
+// Creates the binary archive of this cache, if the device supports binary archives, loading it from
+// the archive data if that is not empty. Does nothing if the binary archive has already been created.
+void MVKPipelineCache::initBinaryArchive(const string& archiveData) {
+#if MVK_XCODE_12
+	id<MTLDevice> mtlDev = getMTLDevice();
+	if (_mtlBinaryArchive || ![mtlDev respondsToSelector: @selector(newBinaryArchiveWithDescriptor:error:)]) { return; }
+
+	@autoreleasepool {
+		MTLBinaryArchiveDescriptor* baDesc = [[MTLBinaryArchiveDescriptor new] autorelease];
+		if ( !archiveData.empty() ) {
+			NSURL* url = mvkNewBinaryArchiveTempFileURL();
+			NSData* data = [NSData dataWithBytesNoCopy: (void*)archiveData.data() length: archiveData.size() freeWhenDone: NO];
+			if ([data writeToURL: url atomically: NO]) {
+				_mtlBinaryArchiveURL = [url retain];		// retained
+				baDesc.url = url;
+			}
+		}
+
+		NSError* err = nil;
+		_mtlBinaryArchive = [mtlDev newBinaryArchiveWithDescriptor: baDesc error: &err];	// retained
+		_hasBinaryArchiveContent = (_mtlBinaryArchive && baDesc.url);
+
+		// The archive data may have been created by a different GPU or OS version. If so, start again with an empty archive.
+		if ( !_mtlBinaryArchive && baDesc.url ) {
+			reportError(VK_SUCCESS, "Could not load compiled pipelines from pipeline cache data (Error code %li):\n%s.",
+						(long)err.code, err.localizedDescription.UTF8String);
+			baDesc.url = nil;
+			_mtlBinaryArchive = [mtlDev newBinaryArchiveWithDescriptor: baDesc error: &err];	// retained
+		}
+	}
+
+	if (_mtlBinaryArchive) { _binaryArchiveGroup = dispatch_group_create(); }	// retained
+#endif
+}
+
+void MVKPipelineCache::setBinaryArchives(MTLRenderPipelineDescriptor* plDesc) {
+#if MVK_XCODE_12
+	if (_mtlBinaryArchive) { plDesc.binaryArchives = @[_mtlBinaryArchive]; }
+#endif
+}
+
+void MVKPipelineCache::setBinaryArchives(MTLComputePipelineDescriptor* plDesc) {
+#if MVK_XCODE_12
+	if (_mtlBinaryArchive) { plDesc.binaryArchives = @[_mtlBinaryArchive]; }
+#endif
+}
+
+void MVKPipelineCache::addToBinaryArchive(MTLRenderPipelineDescriptor* plDesc) {
+#if MVK_XCODE_12
+	addToBinaryArchive(^BOOL(NSError** pError) {
+		return [_mtlBinaryArchive addRenderPipelineFunctionsWithDescriptor: plDesc error: pError];
+	});
+#endif
+}
+
+void MVKPipelineCache::addToBinaryArchive(MTLComputePipelineDescriptor* plDesc) {
+#if MVK_XCODE_12
+	addToBinaryArchive(^BOOL(NSError** pError) {
+		return [_mtlBinaryArchive addComputePipelineFunctionsWithDescriptor: plDesc error: pError];
+	});
+#endif
+}
+
+// Adding a pipeline state to the binary archive compiles it again, so it is done in the background,
+// and this cache is retained until it is done. writeData() waits for any additions to complete.
+void MVKPipelineCache::addToBinaryArchive(BOOL (^addBlock)(NSError** pError)) {
+#if MVK_XCODE_12
+	if ( !_mtlBinaryArchive ) { return; }
+
+	retain();
+	dispatch_group_async(_binaryArchiveGroup, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0), ^{
+		@autoreleasepool {
+			NSError* err = nil;
+			bool wasAdded;
+			{
+				lock_guard<mutex> lock(_binaryArchiveLock);
+				wasAdded = addBlock(&err);
+				if (wasAdded) { _hasBinaryArchiveContent = true; }
+			}
+			if (wasAdded) {
+				lock_guard<mutex> lock(_shaderCacheLock);
+				markDirty();
+			} else {
+				reportError(VK_SUCCESS, "Could not add compiled pipeline to pipeline cache (Error code %li):\n%s.",
+							(long)err.code, err.localizedDescription.UTF8String);
+			}
+		}
+		release();
+	});
+#endif
+}
+
+// Populates the archive data with the serialized content of the binary archive,
+// and returns whether the binary archive has any content to serialize.
+bool MVKPipelineCache::getBinaryArchiveData(string& archiveData) {
+#if MVK_XCODE_12
+	lock_guard<mutex> lock(_binaryArchiveLock);
+
+	if ( !_hasBinaryArchiveContent ) { return false; }
+
+	@autoreleasepool {
+		NSURL* url = mvkNewBinaryArchiveTempFileURL();
+		NSError* err = nil;
+		if ( ![_mtlBinaryArchive serializeToURL: url error: &err] ) {
+			reportError(VK_SUCCESS, "Could not write compiled pipelines to pipeline cache data (Error code %li):\n%s.",
+						(long)err.code, err.localizedDescription.UTF8String);
+			return false;
+		}
+		NSData* data = [NSData dataWithContentsOfURL: url];
+		[NSFileManager.defaultManager removeItemAtURL: url error: nil];
+		if ( !data ) { return false; }
+
+		archiveData.assign((const char*)data.bytes, data.length);
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+
 #pragma mark Cereal archive definitions
 
 namespace SPIRV_CROSS_NAMESPACE {
@@ -1778,12 +2589,235 @@ void serialize(Archive & archive, MVKShaderModuleKey& k) {
 #pragma mark Construction
 
 MVKPipelineCache::MVKPipelineCache(MVKDevice* device, const VkPipelineCacheCreateInfo* pCreateInfo) : MVKVulkanAPIDeviceObject(device) {
+	_creationTime = mvkGetTimestamp();
 	readData(pCreateInfo);
+	initBinaryArchive("");		// If not loaded from the cache data
+	prewarmShaderLibraries();
+}
+
+// A shader library being compiled by the prewarming thread is allowed to complete.
+void MVKPipelineCache::destroy() {
+	_isPrewarmCancelled = true;
+	if (_prewarmGroup) { dispatch_group_wait(_prewarmGroup, DISPATCH_TIME_FOREVER); }
+	MVKVulkanAPIDeviceObject::destroy();
 }
 
 MVKPipelineCache::~MVKPipelineCache() {
-	for (auto& pair : _shaderCache) { pair.second->destroy(); }
-	_shaderCache.clear();
+	if (_prewarmGroup) { dispatch_release(_prewarmGroup); }
+
+	for (auto& scShard : _shaderCacheShards) {
+		for (auto& pair : scShard.shaderCache) { pair.second->destroy(); }
+		scShard.shaderCache.clear();
+	}
+
+#if MVK_XCODE_12
+	[_mtlBinaryArchive release];
+#endif
+	if (_mtlBinaryArchiveURL) { [NSFileManager.defaultManager removeItemAtURL: _mtlBinaryArchiveURL error: nil]; }
+	[_mtlBinaryArchiveURL release];
+	if (_binaryArchiveGroup) { dispatch_release(_binaryArchiveGroup); }
+}
+
+
+#pragma mark -
+#pragma mark MVKShaderDiskCache
+
+static NSString* kMVKShaderDiskCacheEntryExtension = @"mvkmsl";
+
+// Returns the Git revision of SPIRV-Cross used to convert shaders, so that entries
+// converted by another revision are not retrieved from the shader disk cache.
+static const char* mvkGetSpirvCrossRevisionString() {
+
+#include <SPIRV-Cross/mvkSpirvCrossRevisionDerived.h>
+
+	return spirvCrossRevisionString;
+}
+
+MVKShaderDiskCache* MVKShaderDiskCache::getShaderDiskCache() {
+	static MVKShaderDiskCache* shaderDiskCache = nullptr;
+	static once_flag onceFlag;
+	call_once(onceFlag, []() {
+		string dirPath;
+		MVK_SET_FROM_ENV_OR_BUILD_STRING(dirPath, MVK_CONFIG_SHADER_DISK_CACHE_PATH);
+		if (dirPath.empty()) { return; }
+
+		int64_t maxSize;
+		MVK_SET_FROM_ENV_OR_BUILD_INT64(maxSize, MVK_CONFIG_SHADER_DISK_CACHE_MAX_SIZE);
+
+		shaderDiskCache = new MVKShaderDiskCache(dirPath, max(maxSize, (int64_t)0));
+		if ( !shaderDiskCache->_dirURL ) {
+			delete shaderDiskCache;
+			shaderDiskCache = nullptr;
+		}
+	});
+	return shaderDiskCache;
+}
+
+bool MVKShaderDiskCache::getShaderConversion(MVKShaderModuleKey smKey,
+											 SPIRVToMSLConversionConfiguration* pContext,
+											 string& mslSourceCode,
+											 SPIRVToMSLConversionResults& shaderConversionResults) {
+	@autoreleasepool {
+		string entryKey = getEntryKey(smKey, *pContext);
+		NSURL* entryURL = getEntryURL(entryKey);
+		NSData* entryData = [NSData dataWithContentsOfURL: entryURL];
+		if ( !entryData ) { return false; }
+
+		SPIRVToMSLConversionConfiguration convertedContext;
+		try {
+			mvk::membuf mb((char*)entryData.bytes, entryData.length);
+			istream inStream(&mb);
+			cereal::BinaryInputArchive reader(inStream);
+
+			// Entries are named by a hash of the key, so guard against a hash collision.
+			string storedEntryKey;
+			reader(storedEntryKey);
+			if (storedEntryKey != entryKey) { return false; }
+
+			reader(convertedContext);
+			reader(shaderConversionResults);
+			reader(mslSourceCode);
+		} catch (cereal::Exception& ex) {
+			MVKLogError("Error reading shader disk cache entry %s: %s", entryURL.path.UTF8String, ex.what());
+			return false;
+		}
+
+		// The context used for the conversion identifies which vertex attributes and resource bindings are used.
+		pContext->alignWith(convertedContext);
+
+		// Mark the entry as recently used, so it is not removed when the cache is trimmed.
+		[NSFileManager.defaultManager setAttributes: @{ NSFileModificationDate: [NSDate date] }
+									   ofItemAtPath: entryURL.path
+											  error: nil];
+		return true;
+	}
+}
+
+void MVKShaderDiskCache::addShaderConversion(MVKShaderModuleKey smKey,
+											 const SPIRVToMSLConversionConfiguration& shaderContext,
+											 const string& mslSourceCode,
+											 const SPIRVToMSLConversionResults& shaderConversionResults) {
+	@autoreleasepool {
+		string entryKey = getEntryKey(smKey, shaderContext);
+
+		ostringstream outStream;
+		try {
+			cereal::BinaryOutputArchive writer(outStream);
+			writer(entryKey);
+			writer(shaderContext);
+			writer(shaderConversionResults);
+			writer(mslSourceCode);
+		} catch (cereal::Exception& ex) {
+			MVKLogError("Error writing shader disk cache entry: %s", ex.what());
+			return;
+		}
+
+		// Foundation writes atomically by writing to a temporary file, then renaming it.
+		string entryBytes = outStream.str();
+		NSData* entryData = [NSData dataWithBytesNoCopy: (void*)entryBytes.data()
+												 length: entryBytes.size()
+										   freeWhenDone: NO];
+		NSURL* entryURL = getEntryURL(entryKey);
+		NSError* err = nil;
+		if ( ![entryData writeToURL: entryURL options: NSDataWritingAtomic error: &err] ) {
+			MVKLogError("Could not write shader disk cache entry %s (Error code %li): %s",
+						entryURL.path.UTF8String, (long)err.code, err.localizedDescription.UTF8String);
+			return;
+		}
+
+		lock_guard<mutex> lock(_sizeLock);
+		_size += entryBytes.size();
+		if (_size > _maxSize) { updateSize(true); }
+	}
+}
+
+// Returns the serialized identity of a cache entry. Whether vertex attributes and resource
+// bindings are used by the shader is an output of the conversion, and is not part of the identity.
+string MVKShaderDiskCache::getEntryKey(MVKShaderModuleKey smKey, const SPIRVToMSLConversionConfiguration& shaderContext) {
+	SPIRVToMSLConversionConfiguration keyContext = shaderContext;
+	for (auto& va : keyContext.vertexAttributes) { va.isUsedByShader = false; }
+	for (auto& rb : keyContext.resourceBindings) { rb.isUsedByShader = false; }
+
+	ostringstream outStream;
+	cereal::BinaryOutputArchive writer(outStream);
+	writer(string(mvkGetSpirvCrossRevisionString()));
+	writer((uint32_t)MVK_VERSION);
+	writer(smKey);
+	writer(keyContext);
+	return outStream.str();
+}
+
+// Returns an autoreleased URL of the file holding the cache entry, named by a hash of the entry key.
+NSURL* MVKShaderDiskCache::getEntryURL(const string& entryKey) {
+	uint64_t keyHash = mvkHash((const uint8_t*)entryKey.data(), entryKey.size());
+	NSString* fileName = [NSString stringWithFormat: @"%016llx.%@", keyHash, kMVKShaderDiskCacheEntryExtension];
+	return [_dirURL URLByAppendingPathComponent: fileName];
+}
+
+// Measures the total size of the entries in the cache directory, which may have been changed by
+// other processes. If requested, and the cache is too large, removes the least recently used
+// entries, until the cache is reduced to three quarters of its maximum size, to leave room to grow.
+// The caller must hold the size lock, or be the constructor.
+void MVKShaderDiskCache::updateSize(bool shouldTrim) {
+	@autoreleasepool {
+		NSFileManager* fileMgr = NSFileManager.defaultManager;
+		NSArray<NSURLResourceKey>* rezKeys = @[NSURLContentModificationDateKey, NSURLFileSizeKey];
+		NSArray<NSURL*>* fileURLs = [fileMgr contentsOfDirectoryAtURL: _dirURL
+										   includingPropertiesForKeys: rezKeys
+															  options: NSDirectoryEnumerationSkipsHiddenFiles
+																error: nil];
+
+		typedef struct {
+			NSURL* url;
+			NSTimeInterval lastUsed;
+			uint64_t size;
+		} MVKShaderDiskCacheEntry;
+
+		vector<MVKShaderDiskCacheEntry> entries;
+		_size = 0;
+		for (NSURL* fileURL in fileURLs) {
+			if ( ![fileURL.pathExtension isEqualToString: kMVKShaderDiskCacheEntryExtension] ) { continue; }
+
+			NSDictionary<NSURLResourceKey, id>* rezVals = [fileURL resourceValuesForKeys: rezKeys error: nil];
+			MVKShaderDiskCacheEntry entry;
+			entry.url = fileURL;
+			entry.lastUsed = ((NSDate*)rezVals[NSURLContentModificationDateKey]).timeIntervalSinceReferenceDate;
+			entry.size = ((NSNumber*)rezVals[NSURLFileSizeKey]).unsignedLongLongValue;
+			entries.push_back(entry);
+			_size += entry.size;
+		}
+
+		if ( !shouldTrim || _size <= _maxSize ) { return; }
+
+		sort(entries.begin(), entries.end(), [](const MVKShaderDiskCacheEntry& a, const MVKShaderDiskCacheEntry& b) {
+			return a.lastUsed < b.lastUsed;
+		});
+
+		uint64_t trimmedSize = _maxSize / 4 * 3;
+		for (auto& entry : entries) {
+			if (_size <= trimmedSize) { break; }
+			if ([fileMgr removeItemAtURL: entry.url error: nil]) { _size -= entry.size; }
+		}
+	}
+}
+
+MVKShaderDiskCache::MVKShaderDiskCache(const string& dirPath, uint64_t maxSize) : _maxSize(maxSize) {
+	@autoreleasepool {
+		NSString* path = [@(dirPath.c_str()) stringByExpandingTildeInPath];
+		NSURL* dirURL = [NSURL fileURLWithPath: path isDirectory: YES];
+		NSError* err = nil;
+		if ( ![NSFileManager.defaultManager createDirectoryAtURL: dirURL
+									 withIntermediateDirectories: YES
+													  attributes: nil
+														   error: &err] ) {
+			MVKLogError("Could not create shader disk cache directory %s (Error code %li): %s",
+						path.UTF8String, (long)err.code, err.localizedDescription.UTF8String);
+			return;
+		}
+		_dirURL = [dirURL retain];		// retained
+
+		updateSize(true);
+	}
 }
 
 
@@ -31,6 +31,8 @@ class MVKPhysicalDevice;
 // Validate these values periodically as new formats are added over time.
 static const uint32_t _vkFormatCount = 256;
 static const uint32_t _vkFormatCoreCount = VK_FORMAT_ASTC_12x12_SRGB_BLOCK + 1;
+static const uint32_t _vkFormatExtPVRTCCount = VK_FORMAT_PVRTC2_4BPP_SRGB_BLOCK_IMG - VK_FORMAT_PVRTC1_2BPP_UNORM_BLOCK_IMG + 1;
+static const uint32_t _vkFormatIndexCount = _vkFormatCoreCount + _vkFormatExtPVRTCCount;
 static const uint32_t _mtlPixelFormatCount = MTLPixelFormatX32_Stencil8 + 2;     // The actual last enum value is not available on iOS
 static const uint32_t _mtlVertexFormatCount = MTLVertexFormatHalf + 1;
 
@@ -114,6 +116,26 @@ typedef struct {
 } MVKMTLFormatDesc;
 
 
+#pragma mark -
+#pragma mark VkFormat indices
+
+/**
+ * Returns a dense index for the VkFormat, for use in a lookup array of size _vkFormatIndexCount.
+ *
+ * Core VkFormat values are small and consecutive, and are used as the index directly. Extension
+ * VkFormat values are large, but each extension defines a small consecutive range, which is mapped
+ * to a block of indices following the core formats. Returns zero (VK_FORMAT_UNDEFINED) for unknown
+ * formats. When adding extension formats, add a range here, and increase _vkFormatIndexCount.
+ */
+static constexpr uint32_t mvkVkFormatIndex(VkFormat vkFormat) {
+	return (uint32_t(vkFormat) < _vkFormatCoreCount
+			? uint32_t(vkFormat)
+			: ((vkFormat >= VK_FORMAT_PVRTC1_2BPP_UNORM_BLOCK_IMG && vkFormat <= VK_FORMAT_PVRTC2_4BPP_SRGB_BLOCK_IMG)
+			   ? _vkFormatCoreCount + (vkFormat - VK_FORMAT_PVRTC1_2BPP_UNORM_BLOCK_IMG)
+			   : 0));
+}
+
+
 #pragma mark -
 #pragma mark MVKPixelFormats
 
@@ -265,10 +287,14 @@ public:
 	/**
 	 * Returns the Metal texture usage from the Vulkan image usage and Metal format, ensuring that at least the
 	 * usages in minUsage are included, even if they wouldn't naturally be included based on the other two parameters.
+	 *
+	 * If needsPixelFormatViews is false, views that reinterpret a color format are not supported by the usage.
+	 * Supporting them prevents lossless compression of the texture on some GPUs.
 	 */
 	MTLTextureUsage getMTLTextureUsage(VkImageUsageFlags vkImageUsageFlags,
 									   MTLPixelFormat mtlFormat,
-									   MTLTextureUsage minUsage = MTLTextureUsageUnknown);
+									   MTLTextureUsage minUsage = MTLTextureUsageUnknown,
+									   bool needsPixelFormatViews = true);
 
 	/** Enumerates all formats that support the given features, calling a specified function for each one. */
 	void enumerateSupportedFormats(VkFormatProperties properties, bool any, std::function<bool(VkFormat)> func);
@@ -280,11 +306,23 @@ public:
 	MTLVertexFormat getMTLVertexFormat(VkFormat vkFormat);
 
 
+	/**
+	 * Copies the device-independent formats, and applies the capabilities of the physical device
+	 * to them. An instance constructed for a physical device does not contain any formats until
+	 * this function is called, so that the physical device can defer the work until it is queried.
+	 * An instance constructed without a physical device calls this function during construction.
+	 */
+	void initDeviceCapabilities();
+
+
 #pragma mark Construction
 
 	MVKPixelFormats(MVKPhysicalDevice* physicalDevice = nullptr);
 
 protected:
+	MVKPixelFormats(bool isDeviceIndependent);
+	static const MVKPixelFormats& getDeviceIndependentFormats();
+	void copyDeviceIndependentFormats();
 	MVKVkFormatDesc& getVkFormatDesc(VkFormat vkFormat);
 	MVKVkFormatDesc& getVkFormatDesc(MTLPixelFormat mtlFormat);
 	MVKMTLFormatDesc& getMTLPixelFormatDesc(VkFormat vkFormat);
@@ -296,6 +334,7 @@ protected:
 	void initMTLVertexFormatCapabilities();
 	void buildMTLFormatMaps();
 	void buildVkFormatMaps();
+	void modifyVkFormatCapabilities();
 	void setFormatProperties(MVKVkFormatDesc& vkDesc);
 	void modifyMTLFormatCapabilities();
 	void modifyMTLFormatCapabilities(id<MTLDevice> mtlDevice);
@@ -318,10 +357,8 @@ protected:
 	MVKMTLFormatDesc _mtlPixelFormatDescriptions[_mtlPixelFormatCount];
 	MVKMTLFormatDesc _mtlVertexFormatDescriptions[_mtlVertexFormatCount];
 
-	// Vulkan core formats have small values and are mapped by simple lookup array.
-	// Vulkan extension formats have larger values and are mapped by a map.
-	uint16_t _vkFormatDescIndicesByVkFormatsCore[_vkFormatCoreCount];
-	std::unordered_map<uint32_t, uint32_t> _vkFormatDescIndicesByVkFormatsExt;
+	// Vulkan formats are mapped by simple lookup array, using the dense index from mvkVkFormatIndex().
+	uint16_t _vkFormatDescIndicesByVkFormats[_vkFormatIndexCount];
 
 	// Metal formats have small values and are mapped by simple lookup array.
 	uint16_t _mtlFormatDescIndicesByMTLPixelFormats[_mtlPixelFormatCount];
@@ -398,7 +398,8 @@ VkImageUsageFlags MVKPixelFormats::getVkImageUsageFlags(MTLTextureUsage mtlUsage
 
 MTLTextureUsage MVKPixelFormats::getMTLTextureUsage(VkImageUsageFlags vkImageUsageFlags,
 													MTLPixelFormat mtlFormat,
-													MTLTextureUsage minUsage) {
+													MTLTextureUsage minUsage,
+													bool needsPixelFormatViews) {
 	bool isDepthFmt = isDepthFormat(mtlFormat);
 	bool isStencilFmt = isStencilFormat(mtlFormat);
 	bool isCombinedDepthStencilFmt = isDepthFmt && isStencilFmt;
@@ -432,14 +433,15 @@ MTLTextureUsage MVKPixelFormats::getMTLTextureUsage(VkImageUsageFlags vkImageUsa
 		mvkEnableFlags(mtlUsage, MTLTextureUsageRenderTarget);
 	}
 
-	// Create view on, but only on color formats, or combined depth-stencil formats if supported by the GPU...
+	// Create view on, but only on color formats that need to be reinterpreted,
+	// or combined depth-stencil formats if supported by the GPU...
 	if (mvkIsAnyFlagEnabled(vkImageUsageFlags, (VK_IMAGE_USAGE_TRANSFER_SRC_BIT |	 		// May use temp view if transfer involves format change
 												VK_IMAGE_USAGE_SAMPLED_BIT |
 												VK_IMAGE_USAGE_STORAGE_BIT |
 												VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT |
 												VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
 												VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)) &&
-		(isColorFormat || (isCombinedDepthStencilFmt && supportsStencilViews))) {
+		((isColorFormat && needsPixelFormatViews) || (isCombinedDepthStencilFmt && supportsStencilViews))) {
 
 		mvkEnableFlags(mtlUsage, MTLTextureUsagePixelFormatView);
 	}
@@ -449,8 +451,7 @@ MTLTextureUsage MVKPixelFormats::getMTLTextureUsage(VkImageUsageFlags vkImageUsa
 
 // Return a reference to the Vulkan format descriptor corresponding to the VkFormat.
 MVKVkFormatDesc& MVKPixelFormats::getVkFormatDesc(VkFormat vkFormat) {
-	uint16_t fmtIdx = (vkFormat < _vkFormatCoreCount) ? _vkFormatDescIndicesByVkFormatsCore[vkFormat] : _vkFormatDescIndicesByVkFormatsExt[vkFormat];
-	return _vkFormatDescriptions[fmtIdx];
+	return _vkFormatDescriptions[_vkFormatDescIndicesByVkFormats[mvkVkFormatIndex(vkFormat)]];
 }
 
 // Return a reference to the Vulkan format descriptor corresponding to the MTLPixelFormat.
@@ -485,17 +486,47 @@ MVKMTLFormatDesc& MVKPixelFormats::getMTLVertexFormatDesc(MTLVertexFormat mtlFor
 
 MVKPixelFormats::MVKPixelFormats(MVKPhysicalDevice* physicalDevice) : _physicalDevice(physicalDevice) {
 
-	// Build and update the Metal formats
+	// A physical device initializes its formats when it is first queried.
+	if ( !_physicalDevice ) { initDeviceCapabilities(); }
+}
+
+void MVKPixelFormats::initDeviceCapabilities() {
+
+	// Start with the device-independent formats, and apply the capabilities of the device to them.
+	copyDeviceIndependentFormats();
+	modifyMTLFormatCapabilities();
+	modifyVkFormatCapabilities();
+
+//	test();
+}
+
+// Builds the format tables and lookup maps that do not depend on the capabilities of a device.
+MVKPixelFormats::MVKPixelFormats(bool isDeviceIndependent) : _physicalDevice(nullptr) {
+
+	// Build the Metal formats
 	initMTLPixelFormatCapabilities();
 	initMTLVertexFormatCapabilities();
 	buildMTLFormatMaps();
-	modifyMTLFormatCapabilities();
 
 	// Build the Vulkan formats and link them to the Metal formats
 	initVkFormatCapabilities();
 	buildVkFormatMaps();
+}
 
-//	test();
+// The device-independent formats are built once per process, the first time they are needed.
+const MVKPixelFormats& MVKPixelFormats::getDeviceIndependentFormats() {
+	static const MVKPixelFormats devIndepFormats(true);
+	return devIndepFormats;
+}
+
+void MVKPixelFormats::copyDeviceIndependentFormats() {
+	const MVKPixelFormats& srcFmts = getDeviceIndependentFormats();
+	mvkCopy(_vkFormatDescriptions, srcFmts._vkFormatDescriptions, _vkFormatCount);
+	mvkCopy(_mtlPixelFormatDescriptions, srcFmts._mtlPixelFormatDescriptions, _mtlPixelFormatCount);
+	mvkCopy(_mtlVertexFormatDescriptions, srcFmts._mtlVertexFormatDescriptions, _mtlVertexFormatCount);
+	mvkCopy(_vkFormatDescIndicesByVkFormats, srcFmts._vkFormatDescIndicesByVkFormats, _vkFormatIndexCount);
+	mvkCopy(_mtlFormatDescIndicesByMTLPixelFormats, srcFmts._mtlFormatDescIndicesByMTLPixelFormats, _mtlPixelFormatCount);
+	mvkCopy(_mtlFormatDescIndicesByMTLVertexFormats, srcFmts._mtlFormatDescIndicesByMTLVertexFormats, _mtlVertexFormatCount);
 }
 
 #define addVkFormatDesc(VK_FMT, MTL_FMT, MTL_FMT_ALT, MTL_VTX_FMT, MTL_VTX_FMT_ALT, BLK_W, BLK_H, BLK_BYTE_CNT, MVK_FMT_TYPE)  \
@@ -671,21 +702,22 @@ void MVKPixelFormats::initVkFormatCapabilities() {
 
 	addVkFormatDesc( X8_D24_UNORM_PACK32, Invalid, Depth24Unorm_Stencil8, Invalid, Invalid, 1, 1, 4, DepthStencil );
 
-	addVkFormatDesc( BC1_RGB_UNORM_BLOCK, BC1_RGBA, Invalid, Invalid, Invalid, 4, 4, 8, Compressed );
-	addVkFormatDesc( BC1_RGB_SRGB_BLOCK, BC1_RGBA_sRGB, Invalid, Invalid, Invalid, 4, 4, 8, Compressed );
-	addVkFormatDesc( BC1_RGBA_UNORM_BLOCK, BC1_RGBA, Invalid, Invalid, Invalid, 4, 4, 8, Compressed );
-	addVkFormatDesc( BC1_RGBA_SRGB_BLOCK, BC1_RGBA_sRGB, Invalid, Invalid, Invalid, 4, 4, 8, Compressed );
+	// Where Metal lacks them, the BC formats that MoltenVK can decode are substituted with an uncompressed format.
+	addVkFormatDesc( BC1_RGB_UNORM_BLOCK, BC1_RGBA, BGRA8Unorm, Invalid, Invalid, 4, 4, 8, Compressed );
+	addVkFormatDesc( BC1_RGB_SRGB_BLOCK, BC1_RGBA_sRGB, BGRA8Unorm, Invalid, Invalid, 4, 4, 8, Compressed );
+	addVkFormatDesc( BC1_RGBA_UNORM_BLOCK, BC1_RGBA, BGRA8Unorm, Invalid, Invalid, 4, 4, 8, Compressed );
+	addVkFormatDesc( BC1_RGBA_SRGB_BLOCK, BC1_RGBA_sRGB, BGRA8Unorm, Invalid, Invalid, 4, 4, 8, Compressed );
 
-	addVkFormatDesc( BC2_UNORM_BLOCK, BC2_RGBA, Invalid, Invalid, Invalid, 4, 4, 16, Compressed );
-	addVkFormatDesc( BC2_SRGB_BLOCK, BC2_RGBA_sRGB, Invalid, Invalid, Invalid, 4, 4, 16, Compressed );
+	addVkFormatDesc( BC2_UNORM_BLOCK, BC2_RGBA, BGRA8Unorm, Invalid, Invalid, 4, 4, 16, Compressed );
+	addVkFormatDesc( BC2_SRGB_BLOCK, BC2_RGBA_sRGB, BGRA8Unorm, Invalid, Invalid, 4, 4, 16, Compressed );
 
-	addVkFormatDesc( BC3_UNORM_BLOCK, BC3_RGBA, Invalid, Invalid, Invalid, 4, 4, 16, Compressed );
-	addVkFormatDesc( BC3_SRGB_BLOCK, BC3_RGBA_sRGB, Invalid, Invalid, Invalid, 4, 4, 16, Compressed );
+	addVkFormatDesc( BC3_UNORM_BLOCK, BC3_RGBA, BGRA8Unorm, Invalid, Invalid, 4, 4, 16, Compressed );
+	addVkFormatDesc( BC3_SRGB_BLOCK, BC3_RGBA_sRGB, BGRA8Unorm, Invalid, Invalid, 4, 4, 16, Compressed );
 
-	addVkFormatDesc( BC4_UNORM_BLOCK, BC4_RUnorm, Invalid, Invalid, Invalid, 4, 4, 8, Compressed );
+	addVkFormatDesc( BC4_UNORM_BLOCK, BC4_RUnorm, BGRA8Unorm, Invalid, Invalid, 4, 4, 8, Compressed );
 	addVkFormatDesc( BC4_SNORM_BLOCK, BC4_RSnorm, Invalid, Invalid, Invalid, 4, 4, 8, Compressed );
 
-	addVkFormatDesc( BC5_UNORM_BLOCK, BC5_RGUnorm, Invalid, Invalid, Invalid, 4, 4, 16, Compressed );
+	addVkFormatDesc( BC5_UNORM_BLOCK, BC5_RGUnorm, BGRA8Unorm, Invalid, Invalid, 4, 4, 16, Compressed );
 	addVkFormatDesc( BC5_SNORM_BLOCK, BC5_RGSnorm, Invalid, Invalid, Invalid, 4, 4, 16, Compressed );
 
 	addVkFormatDesc( BC6H_UFLOAT_BLOCK, BC6H_RGBUfloat, Invalid, Invalid, Invalid, 4, 4, 16, Compressed );
@@ -1193,43 +1225,48 @@ void MVKPixelFormats::modifyMTLFormatCapabilities(id<MTLDevice> mtlDevice) {
 void MVKPixelFormats::buildVkFormatMaps() {
 
 	// Set the VkFormats to undefined/invalid
-	mvkClear(_vkFormatDescIndicesByVkFormatsCore, _vkFormatCoreCount);
+	mvkClear(_vkFormatDescIndicesByVkFormats, _vkFormatIndexCount);
 
-	// Iterate through the VkFormat descriptions, populate the lookup maps and back pointers,
-	// and validate the Metal formats for the platform and OS.
+	// Iterate through the VkFormat descriptions, and populate the lookup maps and back pointers.
 	for (uint32_t fmtIdx = 0; fmtIdx < _vkFormatCount; fmtIdx++) {
 		MVKVkFormatDesc& vkDesc = _vkFormatDescriptions[fmtIdx];
 		VkFormat vkFmt = vkDesc.vkFormat;
 		if (vkFmt) {
-			// Create a lookup between the Vulkan format and an index to the format info.
-			// For core Vulkan format values, which are small and consecutive, use a simple lookup array.
-			// For extension format values, which can be large, use a map.
-			if (vkFmt < _vkFormatCoreCount) {
-				_vkFormatDescIndicesByVkFormatsCore[vkFmt] = fmtIdx;
-			} else {
-				_vkFormatDescIndicesByVkFormatsExt[vkFmt] = fmtIdx;
-			}
+			// Create a lookup between the dense index of the Vulkan format and an index to the format info.
+			uint32_t vkFmtIdx = mvkVkFormatIndex(vkFmt);
+			MVKAssert(vkFmtIdx, "VkFormat %d has no lookup index. Add its extension range to mvkVkFormatIndex().", vkFmt);
+			_vkFormatDescIndicesByVkFormats[vkFmtIdx] = fmtIdx;
 
 			// Populate the back reference from the Metal formats to the Vulkan format.
-			// Validate the corresponding Metal formats for the platform, and clear them
-			// in the Vulkan format if not supported.
 			if (vkDesc.mtlPixelFormat) {
 				auto& mtlDesc = getMTLPixelFormatDesc(vkDesc.mtlPixelFormat);
 				if ( !mtlDesc.vkFormat ) { mtlDesc.vkFormat = vkFmt; }
-				if ( !mtlDesc.isSupported() ) { vkDesc.mtlPixelFormat = MTLPixelFormatInvalid; }
-			}
-			if (vkDesc.mtlPixelFormatSubstitute) {
-				auto& mtlDesc = getMTLPixelFormatDesc(vkDesc.mtlPixelFormatSubstitute);
-				if ( !mtlDesc.isSupported() ) { vkDesc.mtlPixelFormatSubstitute = MTLPixelFormatInvalid; }
 			}
 			if (vkDesc.mtlVertexFormat) {
 				auto& mtlDesc = getMTLVertexFormatDesc(vkDesc.mtlVertexFormat);
 				if ( !mtlDesc.vkFormat ) { mtlDesc.vkFormat = vkFmt; }
-				if ( !mtlDesc.isSupported() ) { vkDesc.mtlVertexFormat = MTLVertexFormatInvalid; }
 			}
-			if (vkDesc.mtlVertexFormatSubstitute) {
-				auto& mtlDesc = getMTLVertexFormatDesc(vkDesc.mtlVertexFormatSubstitute);
-				if ( !mtlDesc.isSupported() ) { vkDesc.mtlVertexFormatSubstitute = MTLVertexFormatInvalid; }
+		}
+	}
+}
+
+// Validates the Metal formats of each Vulkan format against the capabilities of the device,
+// clearing them in the Vulkan format if not supported, and sets the Vulkan format properties.
+void MVKPixelFormats::modifyVkFormatCapabilities() {
+	for (uint32_t fmtIdx = 0; fmtIdx < _vkFormatCount; fmtIdx++) {
+		MVKVkFormatDesc& vkDesc = _vkFormatDescriptions[fmtIdx];
+		if (vkDesc.vkFormat) {
+			if (vkDesc.mtlPixelFormat && !getMTLPixelFormatDesc(vkDesc.mtlPixelFormat).isSupported()) {
+				vkDesc.mtlPixelFormat = MTLPixelFormatInvalid;
+			}
+			if (vkDesc.mtlPixelFormatSubstitute && !getMTLPixelFormatDesc(vkDesc.mtlPixelFormatSubstitute).isSupported()) {
+				vkDesc.mtlPixelFormatSubstitute = MTLPixelFormatInvalid;
+			}
+			if (vkDesc.mtlVertexFormat && !getMTLVertexFormatDesc(vkDesc.mtlVertexFormat).isSupported()) {
+				vkDesc.mtlVertexFormat = MTLVertexFormatInvalid;
+			}
+			if (vkDesc.mtlVertexFormatSubstitute && !getMTLVertexFormatDesc(vkDesc.mtlVertexFormatSubstitute).isSupported()) {
+				vkDesc.mtlVertexFormatSubstitute = MTLVertexFormatInvalid;
 			}
 
 			// Set Vulkan format properties
@@ -1270,6 +1307,11 @@ void MVKPixelFormats::setFormatProperties(MVKVkFormatDesc& vkDesc) {
 	VkFormatProperties& vkProps = vkDesc.properties;
 	MVKMTLFmtCaps mtlPixFmtCaps = getMTLPixelFormatDesc(vkFmt).mtlFmtCaps;
 
+	// Compressed formats can only be read, even if substituted with a more capable uncompressed format.
+	if (vkDesc.formatType == kMVKFormatCompressed) {
+		mtlPixFmtCaps = (MVKMTLFmtCaps)(mtlPixFmtCaps & kMVKMTLFmtCapsRF);
+	}
+
 	// Set optimal tiling features first
 	vkProps.optimalTilingFeatures = kMVKVkFormatFeatureFlagsTexNone;
 	enableFormatFeatures(Read, Tex, mtlPixFmtCaps, vkProps.optimalTilingFeatures);
@@ -1279,6 +1321,12 @@ void MVKPixelFormats::setFormatProperties(MVKVkFormatDesc& vkDesc) {
 	enableFormatFeatures(DSAtt, Tex, mtlPixFmtCaps, vkProps.optimalTilingFeatures);
 	enableFormatFeatures(Blend, Tex, mtlPixFmtCaps, vkProps.optimalTilingFeatures);
 
+	// The content of a compressed format substituted with an uncompressed format is held decompressed,
+	// and cannot be compressed back, so it cannot be copied from, although it can still be a BLIT source.
+	if (vkDesc.formatType == kMVKFormatCompressed && !vkDesc.isSupported()) {
+		mvkDisableFlags(vkProps.optimalTilingFeatures, VK_FORMAT_FEATURE_TRANSFER_SRC_BIT);
+	}
+
 	// Linear tiling is not available to depth/stencil or compressed formats.
 	vkProps.linearTilingFeatures = kMVKVkFormatFeatureFlagsTexNone;
 	if ( !(vkDesc.formatType == kMVKFormatDepthStencil || vkDesc.formatType == kMVKFormatCompressed) ) {
@@ -21,6 +21,8 @@
 #include "MVKDevice.h"
 #include "MVKVector.h"
 #include <mutex>
+#include <atomic>
+#include <vector>
 #include <condition_variable>
 
 class MVKBuffer;
@@ -101,7 +103,7 @@ public:
 	MVKQueryPool(MVKDevice* device,
 				 const VkQueryPoolCreateInfo* pCreateInfo,
 				 const uint32_t queryElementCount) : MVKVulkanAPIDeviceObject(device),
-                    _availability(pCreateInfo->queryCount, Initial),
+                    _availability(pCreateInfo->queryCount),		// Value-initialized to Initial
                     _queryElementCount(queryElementCount) {}
 
 protected:
@@ -127,7 +129,9 @@ protected:
 		Available           /**< Query is available to the host. */
 	};
 
-	MVKVectorInline<Status, kMVKDefaultQueryCount> _availability;
+	// Availability is atomic, so that polling for results never contends with query completion.
+	// The availability lock is only needed to wait for queries to complete, and to defer copies.
+	std::vector<std::atomic<Status>> _availability;
 	MVKVectorInline<DeferredCopy, 4> _deferredCopies;
 	uint32_t _queryElementCount;
 	std::mutex _availabilityLock;
@@ -145,18 +149,37 @@ class MVKTimestampQueryPool : public MVKQueryPool {
 public:
     void finishQueries(MVKVector<uint32_t>& queries) override;
 
+	/**
+	 * Returns the MTLCounterSampleBuffer into which GPU timestamps are sampled,
+	 * using the query index as the sample index, or nil if the GPU does not
+	 * support sampling timestamps, in which case host timestamps are used.
+	 */
+	id<MTLCounterSampleBuffer> getMTLCounterBuffer() { return _mtlCounterBuffer; }
+
+	/**
+	 * Sets whether the specified query was sampled into the MTLCounterSampleBuffer,
+	 * or should take the host timestamp at which the query is finished.
+	 */
+	void setIsGPUTimestamp(uint32_t query, bool isGPUTimestamp) { _isGPUTimestamp[query] = isGPUTimestamp; }
+
 
 #pragma mark Construction
 
 	MVKTimestampQueryPool(MVKDevice* device, const VkQueryPoolCreateInfo* pCreateInfo);
 
+	~MVKTimestampQueryPool() override;
+
 protected:
 	void propogateDebugName() override {}
 	void getResult(uint32_t query, void* pQryData, bool shouldOutput64Bit) override;
 	id<MTLBuffer> getResultBuffer(MVKCommandEncoder* cmdEncoder, uint32_t firstQuery, uint32_t queryCount, NSUInteger& offset) override;
 	void encodeSetResultBuffer(MVKCommandEncoder* cmdEncoder, uint32_t firstQuery, uint32_t queryCount, uint32_t index) override;
+	void resolveGPUTimestamps(MVKVector<uint32_t>& queries);
+	void initMTLCounterBuffer(uint32_t queryCount);
 
 	MVKVectorInline<uint64_t, kMVKDefaultQueryCount> _timestamps;
+	MVKVectorInline<uint8_t, kMVKDefaultQueryCount> _isGPUTimestamp;
+	id<MTLCounterSampleBuffer> _mtlCounterBuffer = nil;
 };
 
 
@@ -204,10 +227,40 @@ protected:
 class MVKPipelineStatisticsQueryPool : public MVKQueryPool {
 
 public:
+    void beginQuery(uint32_t query, VkQueryControlFlags flags, MVKCommandEncoder* cmdEncoder) override;
+    void endQuery(uint32_t query, MVKCommandEncoder* cmdEncoder) override;
+    void finishQueries(MVKVector<uint32_t>& queries) override;
+
+	/** Returns the MTLCounterSampleBuffer into which the statistic counters are sampled. */
+	id<MTLCounterSampleBuffer> getMTLCounterBuffer() { return _mtlCounterBuffer; }
+
+	/** Returns the index of the sample taken when the specified query begins. */
+	uint32_t getBeginSampleIndex(uint32_t query) { return query * 2; }
+
+	/** Returns the index of the sample taken when the specified query ends. */
+	uint32_t getEndSampleIndex(uint32_t query) { return query * 2 + 1; }
+
+	/** Sets whether both the begin and end samples of the specified query were taken on the GPU. */
+	void setIsSampled(uint32_t query, bool isSampled) { _isSampled[query] = isSampled; }
+
+#pragma mark Construction
+
     MVKPipelineStatisticsQueryPool(MVKDevice* device, const VkQueryPoolCreateInfo* pCreateInfo);
 
+	~MVKPipelineStatisticsQueryPool() override;
+
 protected:
 	void propogateDebugName() override {}
+	void getResult(uint32_t query, void* pQryData, bool shouldOutput64Bit) override;
+	id<MTLBuffer> getResultBuffer(MVKCommandEncoder* cmdEncoder, uint32_t firstQuery, uint32_t queryCount, NSUInteger& offset) override;
+	void encodeSetResultBuffer(MVKCommandEncoder* cmdEncoder, uint32_t firstQuery, uint32_t queryCount, uint32_t index) override;
+	void resolveStatistics(MVKVector<uint32_t>& queries);
+	void initMTLCounterBuffer(uint32_t queryCount);
+
+	MVKVectorInline<uint64_t, kMVKDefaultQueryCount> _results;
+	MVKVectorInline<uint8_t, kMVKDefaultQueryCount> _isSampled;
+	id<MTLCounterSampleBuffer> _mtlCounterBuffer = nil;
+	VkQueryPipelineStatisticFlags _pipelineStatistics;
 };
 
 
@@ -36,7 +36,7 @@ void MVKQueryPool::endQuery(uint32_t query, MVKCommandEncoder* cmdEncoder) {
     if (!_deferredCopies.empty()) {
         // Partition by readiness.
         auto ready = std::partition(_deferredCopies.begin(), _deferredCopies.end(), [this](const DeferredCopy& copy) {
-            return !areQueriesDeviceAvailable(copy.firstQuery, copy.queryCount);
+            return !areQueriesDeviceAvailable(copy.firstQuery, copy.firstQuery + copy.queryCount);
         });
         // Execute the ready copies, then remove them.
         for (auto i = ready; i != _deferredCopies.end(); ++i) {
@@ -46,10 +46,10 @@ void MVKQueryPool::endQuery(uint32_t query, MVKCommandEncoder* cmdEncoder) {
     }
 }
 
-// Mark queries as available
+// Mark queries as available. The lock is only held to wake any threads waiting for results.
 void MVKQueryPool::finishQueries(MVKVector<uint32_t>& queries) {
+    for (uint32_t qry : queries) { _availability[qry].store(Available, memory_order_release); }
     lock_guard<mutex> lock(_availabilityLock);
-    for (uint32_t qry : queries) { _availability[qry] = Available; }
     _availabilityBlocker.notify_all();      // Predicate of each wait() call will check whether all required queries are available
 }
 
@@ -67,11 +67,11 @@ VkResult MVKQueryPool::getResults(uint32_t firstQuery,
 								  void* pData,
 								  VkDeviceSize stride,
 								  VkQueryResultFlags flags) {
-	unique_lock<mutex> lock(_availabilityLock);
-
 	uint32_t endQuery = firstQuery + queryCount;
 
-	if (mvkAreAllFlagsEnabled(flags, VK_QUERY_RESULT_WAIT_BIT)) {
+	// Only wait if needed. Polling for results or availability never takes the lock.
+	if (mvkAreAllFlagsEnabled(flags, VK_QUERY_RESULT_WAIT_BIT) && !areQueriesHostAvailable(firstQuery, endQuery)) {
+		unique_lock<mutex> lock(_availabilityLock);
 		_availabilityBlocker.wait(lock, [this, firstQuery, endQuery]{
 			return areQueriesHostAvailable(firstQuery, endQuery);
 		});
@@ -96,14 +96,14 @@ bool MVKQueryPool::areQueriesDeviceAvailable(uint32_t firstQuery, uint32_t endQu
 // Returns whether all the queries between the start (inclusive) and end (exclusive) queries are available.
 bool MVKQueryPool::areQueriesHostAvailable(uint32_t firstQuery, uint32_t endQuery) {
     for (uint32_t query = firstQuery; query < endQuery; query++) {
-        if ( _availability[query] < Available ) { return false; }
+        if ( _availability[query].load(memory_order_acquire) < Available ) { return false; }
     }
     return true;
 }
 
 VkResult MVKQueryPool::getResult(uint32_t query, void* pQryData, VkQueryResultFlags flags) {
 
-	bool isAvailable = _availability[query] == Available;
+	bool isAvailable = _availability[query].load(memory_order_acquire) == Available;
 	bool shouldOutput = (isAvailable || mvkAreAllFlagsEnabled(flags, VK_QUERY_RESULT_PARTIAL_BIT));
 	bool shouldOutput64Bit = mvkAreAllFlagsEnabled(flags, VK_QUERY_RESULT_64_BIT);
 
@@ -137,7 +137,7 @@ void MVKQueryPool::encodeCopyResults(MVKCommandEncoder* cmdEncoder,
 	if (mvkIsAnyFlagEnabled(flags, VK_QUERY_RESULT_64_BIT) &&
 		!mvkIsAnyFlagEnabled(flags, VK_QUERY_RESULT_WITH_AVAILABILITY_BIT) &&
 		stride == _queryElementCount * sizeof(uint64_t) &&
-		areQueriesDeviceAvailable(firstQuery, queryCount)) {
+		areQueriesDeviceAvailable(firstQuery, firstQuery + queryCount)) {
 
 		id<MTLBlitCommandEncoder> mtlBlitCmdEnc = cmdEncoder->getMTLBlitEncoder(kMVKCommandUseCopyQueryPoolResults);
 		NSUInteger srcOffset;
@@ -159,9 +159,10 @@ void MVKQueryPool::encodeCopyResults(MVKCommandEncoder* cmdEncoder,
 		cmdEncoder->setComputeBytes(mtlComputeCmdEnc, &stride, sizeof(uint32_t), 2);
 		cmdEncoder->setComputeBytes(mtlComputeCmdEnc, &queryCount, sizeof(uint32_t), 3);
 		cmdEncoder->setComputeBytes(mtlComputeCmdEnc, &flags, sizeof(VkQueryResultFlags), 4);
-		_availabilityLock.lock();
-		cmdEncoder->setComputeBytes(mtlComputeCmdEnc, _availability.data(), _availability.size() * sizeof(Status), 5);
-		_availabilityLock.unlock();
+		// The shader reads the availability of each query relative to the first query.
+		static_assert(sizeof(atomic<Status>) == sizeof(Status), "Query availability must be layout-compatible with the copy shader.");
+		cmdEncoder->setComputeBytes(mtlComputeCmdEnc, &_availability[firstQuery], queryCount * sizeof(Status), 5);
+		cmdEncoder->setComputeBytes(mtlComputeCmdEnc, &_queryElementCount, sizeof(uint32_t), 6);
 		// Run one thread per query. Try to fill up a subgroup.
 		[mtlComputeCmdEnc dispatchThreadgroups: MTLSizeMake(max(queryCount / mtlCopyResultsState.threadExecutionWidth, NSUInteger(1)), 1, 1)
 						  threadsPerThreadgroup: MTLSizeMake(min(NSUInteger(queryCount), mtlCopyResultsState.threadExecutionWidth), 1, 1)];
@@ -187,10 +188,49 @@ void MVKQueryPool::deferCopyResults(uint32_t firstQuery,
 void MVKTimestampQueryPool::finishQueries(MVKVector<uint32_t>& queries) {
     uint64_t ts = mvkGetTimestamp();
     for (uint32_t qry : queries) { _timestamps[qry] = ts; }
+	resolveGPUTimestamps(queries);
 
     MVKQueryPool::finishQueries(queries);
 }
 
+// Replaces the host timestamp of each query that was sampled on the GPU with the GPU timestamp
+// at which it was sampled. GPU timestamps are converted to the host timestamp domain, so that
+// all queries are consistent with each other, and with the timestampPeriod device limit.
+void MVKTimestampQueryPool::resolveGPUTimestamps(MVKVector<uint32_t>& queries) {
+#if MVK_XCODE_12
+	if ( !_mtlCounterBuffer ) { return; }
+
+	uint32_t minQry = UINT32_MAX;
+	uint32_t maxQry = 0;
+	for (uint32_t qry : queries) {
+		if (_isGPUTimestamp[qry]) {
+			minQry = min(minQry, qry);
+			maxQry = max(maxQry, qry);
+		}
+	}
+	if (minQry > maxQry) { return; }
+
+	@autoreleasepool {
+		NSData* tsData = [_mtlCounterBuffer resolveCounterRange: NSMakeRange(minQry, maxQry - minQry + 1)];
+		if ( !tsData ) { return; }
+		auto* pGPUTimestamps = (const MTLCounterResultTimestamp*)tsData.bytes;
+
+		uint64_t gpuNow;
+		double hostTicksPerGPUTick = _device->getPhysicalDevice()->sampleGPUTimestamp(gpuNow) / mvkGetTimestampPeriod();
+		uint64_t hostNow = mvkGetTimestamp();
+		for (uint32_t qry : queries) {
+			if ( !_isGPUTimestamp[qry] ) { continue; }
+
+			uint64_t gpuTS = pGPUTimestamps[qry - minQry].timestamp;
+			if (gpuTS == MTLCounterErrorValue || gpuTS > gpuNow) { continue; }
+
+			uint64_t hostElapsed = (uint64_t)((double)(gpuNow - gpuTS) * hostTicksPerGPUTick);
+			_timestamps[qry] = (hostElapsed < hostNow) ? hostNow - hostElapsed : 0;
+		}
+	}
+#endif
+}
+
 void MVKTimestampQueryPool::getResult(uint32_t query, void* pQryData, bool shouldOutput64Bit) {
 	if (shouldOutput64Bit) {
 		*(uint64_t*)pQryData = _timestamps[query];
@@ -216,7 +256,37 @@ void MVKTimestampQueryPool::encodeSetResultBuffer(MVKCommandEncoder* cmdEncoder,
 
 MVKTimestampQueryPool::MVKTimestampQueryPool(MVKDevice* device,
 											 const VkQueryPoolCreateInfo* pCreateInfo) :
-	MVKQueryPool(device, pCreateInfo, 1), _timestamps(pCreateInfo->queryCount, 0) {
+	MVKQueryPool(device, pCreateInfo, 1),
+	_timestamps(pCreateInfo->queryCount, 0),
+	_isGPUTimestamp(pCreateInfo->queryCount, false) {
+
+	initMTLCounterBuffer(pCreateInfo->queryCount);
+}
+
+// If the GPU supports sampling timestamps, creates a MTLCounterSampleBuffer with one sample per query.
+// Sample buffers must use shared storage so that their contents can be resolved on the host.
+void MVKTimestampQueryPool::initMTLCounterBuffer(uint32_t queryCount) {
+#if MVK_XCODE_12
+	if ( !_device->_pMetalFeatures->counterSamplingPoints ) { return; }
+
+	@autoreleasepool {
+		MTLCounterSampleBufferDescriptor* csbDesc = [[MTLCounterSampleBufferDescriptor new] autorelease];
+		csbDesc.counterSet = _device->getPhysicalDevice()->getTimestampMTLCounterSet();
+		csbDesc.storageMode = MTLStorageModeShared;
+		csbDesc.sampleCount = queryCount;
+
+		NSError* err = nil;
+		_mtlCounterBuffer = [getMTLDevice() newCounterSampleBufferWithDescriptor: csbDesc error: &err];	// retained
+		if ( !_mtlCounterBuffer ) {
+			MVKLogInfo("Could not create a MTLCounterSampleBuffer for %d timestamp queries (Error code %li: %s). Host timestamps will be used instead.",
+					   queryCount, (long)err.code, err.localizedDescription.UTF8String);
+		}
+	}
+#endif
+}
+
+MVKTimestampQueryPool::~MVKTimestampQueryPool() {
+	[_mtlCounterBuffer release];
 }
 
 
@@ -322,24 +392,170 @@ MVKOcclusionQueryPool::MVKOcclusionQueryPool(MVKDevice* device,
         _visibilityResultMTLBuffer = [getMTLDevice() newBufferWithLength: mtlBuffLen options: mtlBuffOpts];     // retained
 
     } else {
-        _queryIndexOffset = _device->expandVisibilityResultMTLBuffer(pCreateInfo->queryCount);
+        _queryIndexOffset = _device->reserveVisibilityResultMTLBufferSlice(pCreateInfo->queryCount);
         _visibilityResultMTLBuffer = nil;   // Will delegate to global buffer in device on access
     }
 }
 
 MVKOcclusionQueryPool::~MVKOcclusionQueryPool() {
-    [_visibilityResultMTLBuffer release];
+    if (_visibilityResultMTLBuffer) {
+        [_visibilityResultMTLBuffer release];
+    } else {
+        _device->releaseVisibilityResultMTLBufferSlice(_queryIndexOffset);
+    }
 };
 
 
 #pragma mark -
 #pragma mark MVKPipelineStatisticsQueryPool
 
+void MVKPipelineStatisticsQueryPool::beginQuery(uint32_t query, VkQueryControlFlags flags, MVKCommandEncoder* cmdEncoder) {
+	MVKQueryPool::beginQuery(query, flags, cmdEncoder);
+	cmdEncoder->beginPipelineStatisticsQuery(this, query);
+}
+
+void MVKPipelineStatisticsQueryPool::endQuery(uint32_t query, MVKCommandEncoder* cmdEncoder) {
+	cmdEncoder->endPipelineStatisticsQuery(this, query);
+	MVKQueryPool::endQuery(query, cmdEncoder);
+}
+
+// Update statistic values, then mark queries as available
+void MVKPipelineStatisticsQueryPool::finishQueries(MVKVector<uint32_t>& queries) {
+	for (uint32_t qry : queries) {
+		uint64_t* pQryRslts = &_results[qry * _queryElementCount];
+		for (uint32_t elemIdx = 0; elemIdx < _queryElementCount; elemIdx++) { pQryRslts[elemIdx] = 0; }
+	}
+	resolveStatistics(queries);
+
+	MVKQueryPool::finishQueries(queries);
+}
+
+#if MVK_XCODE_12
+// Returns the Metal counter that corresponds to the Vulkan pipeline statistic. Statistics that Metal does
+// not count, such as geometry shader statistics, return zero. Metal counts input assembly only in terms
+// of the vertex invocations and the primitives reaching the clipper, which are used for those statistics.
+static uint64_t mvkGetPipelineStatistic(const MTLCounterResultStatistic& mtlStats, VkQueryPipelineStatisticFlagBits vkStat) {
+	switch (vkStat) {
+		case VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT:						return mtlStats.vertexInvocations;
+		case VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT:						return mtlStats.clipperInvocations;
+		case VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT:						return mtlStats.vertexInvocations;
+		case VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT:							return mtlStats.clipperInvocations;
+		case VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT:							return mtlStats.clipperPrimitivesOut;
+		case VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT:					return mtlStats.fragmentInvocations;
+		case VK_QUERY_PIPELINE_STATISTIC_TESSELLATION_CONTROL_SHADER_PATCHES_BIT:			return mtlStats.tessellationInputPatches;
+		case VK_QUERY_PIPELINE_STATISTIC_TESSELLATION_EVALUATION_SHADER_INVOCATIONS_BIT:	return mtlStats.postTessellationVertexInvocations;
+		case VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT:					return mtlStats.computeKernelInvocations;
+		default:																			return 0;
+	}
+}
+#endif
+
+// Metal statistic counters accumulate, so the result of each statistic is the
+// difference between the samples taken at the end and the start of the query.
+// Queries that could not be sampled on the GPU report zero for each statistic.
+void MVKPipelineStatisticsQueryPool::resolveStatistics(MVKVector<uint32_t>& queries) {
+#if MVK_XCODE_12
+	if ( !_mtlCounterBuffer ) { return; }
+
+	uint32_t minQry = UINT32_MAX;
+	uint32_t maxQry = 0;
+	for (uint32_t qry : queries) {
+		if (_isSampled[qry]) {
+			minQry = min(minQry, qry);
+			maxQry = max(maxQry, qry);
+		}
+	}
+	if (minQry > maxQry) { return; }
+
+	@autoreleasepool {
+		uint32_t firstSample = getBeginSampleIndex(minQry);
+		NSData* statsData = [_mtlCounterBuffer resolveCounterRange: NSMakeRange(firstSample, getEndSampleIndex(maxQry) - firstSample + 1)];
+		if ( !statsData ) { return; }
+		auto* pMTLStats = (const MTLCounterResultStatistic*)statsData.bytes;
+
+		for (uint32_t qry : queries) {
+			if ( !_isSampled[qry] ) { continue; }
+
+			const MTLCounterResultStatistic& beginStats = pMTLStats[getBeginSampleIndex(qry) - firstSample];
+			const MTLCounterResultStatistic& endStats = pMTLStats[getEndSampleIndex(qry) - firstSample];
+			if (beginStats.vertexInvocations == MTLCounterErrorValue || endStats.vertexInvocations == MTLCounterErrorValue) { continue; }
+
+			uint64_t* pQryRslts = &_results[qry * _queryElementCount];
+			uint32_t elemIdx = 0;
+			for (uint32_t statBit = 1; statBit <= VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT; statBit <<= 1) {
+				if ( !mvkIsAnyFlagEnabled(_pipelineStatistics, statBit) ) { continue; }
+
+				auto vkStat = (VkQueryPipelineStatisticFlagBits)statBit;
+				uint64_t beginVal = mvkGetPipelineStatistic(beginStats, vkStat);
+				uint64_t endVal = mvkGetPipelineStatistic(endStats, vkStat);
+				pQryRslts[elemIdx++] = (endVal > beginVal) ? endVal - beginVal : 0;
+			}
+		}
+	}
+#endif
+}
+
+void MVKPipelineStatisticsQueryPool::getResult(uint32_t query, void* pQryData, bool shouldOutput64Bit) {
+	const uint64_t* pQryRslts = &_results[query * _queryElementCount];
+	for (uint32_t elemIdx = 0; elemIdx < _queryElementCount; elemIdx++) {
+		if (shouldOutput64Bit) {
+			((uint64_t*)pQryData)[elemIdx] = pQryRslts[elemIdx];
+		} else {
+			((uint32_t*)pQryData)[elemIdx] = (uint32_t)pQryRslts[elemIdx];
+		}
+	}
+}
+
+id<MTLBuffer> MVKPipelineStatisticsQueryPool::getResultBuffer(MVKCommandEncoder* cmdEncoder, uint32_t firstQuery, uint32_t queryCount, NSUInteger& offset) {
+	const MVKMTLBufferAllocation* tempBuff = cmdEncoder->getTempMTLBuffer(queryCount * _queryElementCount * sizeof(uint64_t));
+	memcpy(tempBuff->getContents(), &_results[firstQuery * _queryElementCount], queryCount * _queryElementCount * sizeof(uint64_t));
+	offset = tempBuff->_offset;
+	return tempBuff->_mtlBuffer;
+}
+
+void MVKPipelineStatisticsQueryPool::encodeSetResultBuffer(MVKCommandEncoder* cmdEncoder, uint32_t firstQuery, uint32_t queryCount, uint32_t index) {
+	cmdEncoder->setComputeBytes(cmdEncoder->getMTLComputeEncoder(kMVKCommandUseCopyQueryPoolResults), &_results[firstQuery * _queryElementCount], queryCount * _queryElementCount * sizeof(uint64_t), index);
+}
+
+
+#pragma mark Construction
+
+// Each enabled statistic occupies one element of the query result, in bit order.
 MVKPipelineStatisticsQueryPool::MVKPipelineStatisticsQueryPool(MVKDevice* device,
-															   const VkQueryPoolCreateInfo* pCreateInfo) : MVKQueryPool(device, pCreateInfo, 1) {
+															   const VkQueryPoolCreateInfo* pCreateInfo) :
+	MVKQueryPool(device, pCreateInfo, __builtin_popcount(pCreateInfo->pipelineStatistics)),
+	_results(pCreateInfo->queryCount * __builtin_popcount(pCreateInfo->pipelineStatistics), 0),
+	_isSampled(pCreateInfo->queryCount, false),
+	_pipelineStatistics(pCreateInfo->pipelineStatistics) {
+
 	if ( !_device->_enabledFeatures.pipelineStatisticsQuery ) {
 		setConfigurationResult(reportError(VK_ERROR_FEATURE_NOT_PRESENT, "vkCreateQueryPool: VK_QUERY_TYPE_PIPELINE_STATISTICS is not supported."));
+		return;
 	}
+	initMTLCounterBuffer(pCreateInfo->queryCount);
+}
+
+// Creates a MTLCounterSampleBuffer holding a begin and end sample for each query.
+void MVKPipelineStatisticsQueryPool::initMTLCounterBuffer(uint32_t queryCount) {
+#if MVK_XCODE_12
+	@autoreleasepool {
+		MTLCounterSampleBufferDescriptor* csbDesc = [[MTLCounterSampleBufferDescriptor new] autorelease];
+		csbDesc.counterSet = _device->getPhysicalDevice()->getStatisticMTLCounterSet();
+		csbDesc.storageMode = MTLStorageModeShared;
+		csbDesc.sampleCount = getEndSampleIndex(queryCount - 1) + 1;
+
+		NSError* err = nil;
+		_mtlCounterBuffer = [getMTLDevice() newCounterSampleBufferWithDescriptor: csbDesc error: &err];	// retained
+		if ( !_mtlCounterBuffer ) {
+			setConfigurationResult(reportError(VK_ERROR_INITIALIZATION_FAILED, "vkCreateQueryPool: Could not create a MTLCounterSampleBuffer for %d pipeline statistics queries (Error code %li):\n%s.",
+											   queryCount, (long)err.code, err.localizedDescription.UTF8String));
+		}
+	}
+#endif
+}
+
+MVKPipelineStatisticsQueryPool::~MVKPipelineStatisticsQueryPool() {
+	[_mtlCounterBuffer release];
 }
 
 
@@ -23,12 +23,16 @@
 #include "MVKImage.h"
 #include "MVKSync.h"
 #include "MVKVector.h"
+#include "MVKObjectPool.h"
 #include <mutex>
+#include <condition_variable>
 
 #import <Metal/Metal.h>
 
 class MVKQueue;
 class MVKQueueSubmission;
+class MVKQueueCommandBufferSubmission;
+class MVKQueuePresentSurfaceSubmission;
 class MVKPhysicalDevice;
 class MVKGPUCaptureScope;
 
@@ -69,6 +73,33 @@ protected:
 };
 
 
+#pragma mark -
+#pragma mark MVKQueueSubmissionPool
+
+/**
+ * Recycles the queue submissions of a particular type, which are constructed for a queue.
+ * Submissions are acquired when the app submits, and returned once they have finished,
+ * usually on a different thread, so this pool should be used through its thread-safe functions.
+ */
+template <class T>
+class MVKQueueSubmissionPool : public MVKObjectPool<T> {
+
+public:
+
+	/** Returns the Vulkan API opaque object controlling this object. */
+	MVKVulkanAPIObject* getVulkanAPIObject() override;
+
+	/** Returns a new instance. */
+	T* newObject() override { return new T(_queue); }
+
+	/** Configures this instance for the queue. */
+	MVKQueueSubmissionPool(MVKQueue* queue) : MVKObjectPool<T>(true), _queue(queue) {}
+
+protected:
+	MVKQueue* _queue;
+};
+
+
 #pragma mark -
 #pragma mark MVKQueue
 
@@ -106,6 +137,19 @@ public:
 	/** Returns the Metal queue underlying this queue. */
 	inline id<MTLCommandQueue> getMTLCommandQueue() { return _mtlQueue; }
 
+	/**
+	 * Returns a new autoreleased MTLCommandBuffer from the Metal queue underlying this queue.
+	 * The MTLCommandBuffer is counted as active, for submission flow control, until it completes.
+	 * If retainReferences is false, the MTLCommandBuffer does not retain the objects it references.
+	 */
+	id<MTLCommandBuffer> getMTLCommandBuffer(bool retainReferences = false);
+
+	/**
+	 * Populates the GPU execution times of the most recent completed frames on this queue,
+	 * as described for the vkGetQueueGPUFrameTimesMVK() function.
+	 */
+	VkResult getGPUFrameTimes(uint32_t* pFrameTimeCount, MVKGPUFrameTime* pFrameTimes);
+
 #pragma mark Construction
 	
 	/** Constructs an instance for the device and queue family. */
@@ -140,6 +184,15 @@ protected:
 	void initGPUCaptureScopes();
 	void destroyExecQueue();
 	VkResult submit(MVKQueueSubmission* qSubmit);
+	uint32_t reserveMTLCommandBuffers(uint32_t mtlCmdBuffCount);
+	void releaseReservedMTLCommandBuffers(uint32_t mtlCmdBuffCount);
+	void completeMTLCommandBuffer(id<MTLCommandBuffer> mtlCmdBuff, uint64_t startTime, uint64_t frameIndex);
+	void addGPUFrameTimes(MVKGPUFrameTime& frameTime, id<MTLCommandBuffer> mtlCmdBuff);
+	void endGPUFrame();
+	void finishGPUFrame(MVKGPUFrameTime& frameTime);
+	uint64_t getOldestGPUFrameIndex();
+	void advanceGPUFrameCompletedCount();
+	void updateSlowFrameGPUCapture();
 
 	MVKQueueFamily* _queueFamily;
 	uint32_t _index;
@@ -150,8 +203,28 @@ protected:
 	MVKMTLCommandBufferID _nextMTLCmdBuffID;
 	MVKGPUCaptureScope* _submissionCaptureScope;
 	MVKGPUCaptureScope* _presentationCaptureScope;
+	MVKQueueSubmissionPool<MVKQueueCommandBufferSubmission> _cmdBuffSubmissionPool;
+	MVKQueueSubmissionPool<MVKQueuePresentSurfaceSubmission> _presentSubmissionPool;
+	std::mutex _mtlCmdBuffFlowLock;
+	std::condition_variable _mtlCmdBuffFlowCondVar;
+	double _averageMTLCommandBufferLifetime = 0.0;
+	uint32_t _maxActiveMTLCommandBufferCount;
+	uint32_t _activeMTLCommandBufferCount = 0;
+	uint32_t _reservedMTLCommandBufferCount = 0;
+	MVKGPUFrameTime _gpuFrameTimes[kMVKGPUFrameTimeCapacity];
+	uint32_t _gpuFramePendingCounts[kMVKGPUFrameTimeCapacity];
+	uint64_t _gpuFrameIndex = 0;
+	uint64_t _gpuFrameCompletedCount = 0;
+	double _lastGPUFrameEndTime = 0.0;
+	uint64_t _lastPresentTime = 0;
+	uint64_t _slowFrameCaptureFrameIndex = kMVKUndefinedLargeUInt64;
+	uint32_t _slowFrameCaptureCount = 0;
+	bool _hasSlowGPUFrame = false;
 };
 
+template <class T>
+MVKVulkanAPIObject* MVKQueueSubmissionPool<T>::getVulkanAPIObject() { return _queue->getVulkanAPIObject(); }
+
 
 #pragma mark -
 #pragma mark MVKQueueSubmission
@@ -171,15 +244,18 @@ public:
 	 */
 	virtual void execute() = 0;
 
-	MVKQueueSubmission(MVKQueue* queue,
-					   uint32_t waitSemaphoreCount,
-					   const VkSemaphore* pWaitSemaphores);
+	/** Returns the number of new MTLCommandBuffers that this instance is expected to use when executed. */
+	virtual uint32_t getMTLCommandBufferCount() { return 1; }
+
+	MVKQueueSubmission(MVKQueue* queue) : _queue(queue) {}
 
 protected:
 	friend class MVKQueue;
 
+	void setWaitSemaphores(uint32_t waitSemaphoreCount, const VkSemaphore* pWaitSemaphores);
+
 	MVKQueue* _queue;
-	MVKVectorInline<MVKSemaphore*, 8> _waitSemaphores;
+	MVKVectorInline<std::pair<MVKSemaphore*, uint64_t>, 8> _waitSemaphores;
 	bool _trackPerformance;
 };
 
@@ -187,27 +263,65 @@ protected:
 #pragma mark -
 #pragma mark MVKQueueCommandBufferSubmission
 
-/** Submits the commands in a set of command buffers to the queue. */
-class MVKQueueCommandBufferSubmission : public MVKQueueSubmission {
+/**
+ * Submits the commands in a set of command buffers to the queue.
+ *
+ * Consecutive VkSubmitInfos are merged into a single instance, and encoded onto the same
+ * MTLCommandBuffer, as long as each wait semaphore of a later VkSubmitInfo is signaled by
+ * an earlier VkSubmitInfo in the same instance. Each merged VkSubmitInfo remains a distinct
+ * logical submit, whose semaphores are signaled once its own command buffers are encoded.
+ */
+class MVKQueueCommandBufferSubmission : public MVKQueueSubmission,
+										public MVKLinkableMixin<MVKQueueCommandBufferSubmission> {
 
 public:
 	void execute() override;
 
+	/** Returns the number of VkSubmitInfos merged into this instance. */
+	uint32_t getSubmitCount() { return (uint32_t)_logicalSubmits.size(); }
+
+	uint32_t getMTLCommandBufferCount() override;
+
+	/**
+	 * Prepares this instance for submission, merging as many of the VkSubmitInfos as possible,
+	 * starting with the first. The fence is only tracked if all of the VkSubmitInfos are merged.
+	 * The VkSubmitInfos can be null if just tracking the fence alone.
+	 *
+	 * Instances are recycled through the queue, and this function clears any previous content.
+	 */
+	void prepare(const VkSubmitInfo* pSubmits, uint32_t submitCount, VkFence fence);
+
+	/**
+	 * Commits the active MTLCommandBuffer, holding the commands encoded so far, so that the GPU
+	 * can start executing them, and returns the new active MTLCommandBuffer, onto which the
+	 * remaining commands are encoded. The caller must have ended all Metal encoding.
+	 */
+	id<MTLCommandBuffer> commitPartialMTLCommandBuffer();
+
 	/** Constructs an instance for the queue. */
-	MVKQueueCommandBufferSubmission(MVKQueue* queue,
-									const VkSubmitInfo* pSubmit,
-									VkFence fence);
+	MVKQueueCommandBufferSubmission(MVKQueue* queue) : MVKQueueSubmission(queue) {}
 
 protected:
 	friend MVKCommandBuffer;
 
+	/** The ends of the ranges of command buffers and signal semaphores of each merged VkSubmitInfo. */
+	typedef struct {
+		uint32_t cmdBuffersEnd;
+		uint32_t signalSemaphoresEnd;
+	} MVKLogicalSubmit;
+
+	bool canMergeSubmit(const VkSubmitInfo* pSubmit);
+	void addSubmit(const VkSubmitInfo* pSubmit, bool isFirst);
+	bool canEncodeInParallel(uint32_t cbStart, uint32_t cbEnd);
+	void encodeCommandBuffersInParallel(uint32_t cbStart, uint32_t cbEnd);
 	id<MTLCommandBuffer> getActiveMTLCommandBuffer();
 	void setActiveMTLCommandBuffer(id<MTLCommandBuffer> mtlCmdBuff);
 	void commitActiveMTLCommandBuffer(bool signalCompletion = false);
 	void finish();
 
 	MVKVectorInline<MVKCommandBuffer*, 32> _cmdBuffers;
-	MVKVectorInline<MVKSemaphore*, 8> _signalSemaphores;
+	MVKVectorInline<std::pair<MVKSemaphore*, uint64_t>, 8> _signalSemaphores;
+	MVKVectorInline<MVKLogicalSubmit, 4> _logicalSubmits;
 	MVKFence* _fence;
 	id<MTLCommandBuffer> _activeMTLCommandBuffer;
 };
@@ -217,17 +331,25 @@ protected:
 #pragma mark MVKQueuePresentSurfaceSubmission
 
 /** Presents a swapchain surface image to the OS. */
-class MVKQueuePresentSurfaceSubmission : public MVKQueueSubmission {
+class MVKQueuePresentSurfaceSubmission : public MVKQueueSubmission,
+										 public MVKLinkableMixin<MVKQueuePresentSurfaceSubmission> {
 
 public:
 	void execute() override;
 
-	MVKQueuePresentSurfaceSubmission(MVKQueue* queue,
-									 const VkPresentInfoKHR* pPresentInfo);
+	/**
+	 * Prepares this instance to present the swapchain images.
+	 *
+	 * Instances are recycled through the queue, and this function clears any previous content.
+	 */
+	void prepare(const VkPresentInfoKHR* pPresentInfo);
+
+	/** Constructs an instance for the queue. */
+	MVKQueuePresentSurfaceSubmission(MVKQueue* queue) : MVKQueueSubmission(queue) {}
 
 protected:
 	id<MTLCommandBuffer> getMTLCommandBuffer();
 
-	MVKVectorInline<MVKPresentableSwapchainImage*, 4> _presentableImages;
+	MVKVectorInline<MVKImagePresentInfo, 4> _presentInfo;
 };
 
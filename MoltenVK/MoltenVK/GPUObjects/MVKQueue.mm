@@ -62,6 +62,14 @@ MVKQueueFamily::~MVKQueueFamily() {
 #pragma mark -
 #pragma mark MVKQueue
 
+// The weight of the lifetime of each completed MTLCommandBuffer in the running average lifetime.
+static const double kMVKMTLCommandBufferLifetimeWeight = 0.125;
+
+// The multiple of the average MTLCommandBuffer lifetime, and the minimum time, in milliseconds,
+// that a submission waits for active MTLCommandBuffers to complete, before proceeding anyway.
+static const double kMVKMTLCommandBufferFlowTimeoutLifetimes = 4.0;
+static const double kMVKMTLCommandBufferFlowMinTimeout = 50.0;
+
 void MVKQueue::propogateDebugName() { setLabelIfNotNil(_mtlQueue, _debugName); }
 
 
@@ -79,32 +87,281 @@ VkResult MVKQueue::submit(MVKQueueSubmission* qSubmit) {
 	if ( !qSubmit ) { return VK_SUCCESS; }     // Ignore nils
 
 	VkResult rslt = qSubmit->getConfigurationResult();     // Extract result before submission to avoid race condition with early destruction
+	uint32_t mtlCmdBuffCnt = reserveMTLCommandBuffers(qSubmit->getMTLCommandBufferCount());
 	if (_execQueue) {
-		dispatch_async(_execQueue, ^{ execute(qSubmit); } );
+		dispatch_async(_execQueue, ^{
+			execute(qSubmit);
+			releaseReservedMTLCommandBuffers(mtlCmdBuffCnt);
+		});
 	} else {
 		execute(qSubmit);
+		releaseReservedMTLCommandBuffers(mtlCmdBuffCnt);
 	}
 	return rslt;
 }
 
 VkResult MVKQueue::submit(uint32_t submitCount, const VkSubmitInfo* pSubmits, VkFence fence) {
+	uint64_t startTime = _device->getPerformanceTimestamp();
 
     // Fence-only submission
     if (submitCount == 0 && fence) {
-        return submit(new MVKQueueCommandBufferSubmission(this, nullptr, fence));
+        auto* qSubmit = _cmdBuffSubmissionPool.acquireObjectSafely();
+        qSubmit->prepare(nullptr, 0, fence);
+        VkResult rslt = submit(qSubmit);
+        _device->addActivityPerformance(_device->_performanceStatistics.queue.queueSubmit, startTime);
+        return rslt;
     }
 
+	// Each submission merges as many of the remaining VkSubmitInfos as it can.
+	// The last submission gets the fence. Extract the merged count before
+	// submission to avoid race condition with early destruction.
     VkResult rslt = VK_SUCCESS;
-    for (uint32_t sIdx = 0; sIdx < submitCount; sIdx++) {
-        VkFence fenceOrNil = (sIdx == (submitCount - 1)) ? fence : VK_NULL_HANDLE; // last one gets the fence
-        VkResult subRslt = submit(new MVKQueueCommandBufferSubmission(this, &pSubmits[sIdx], fenceOrNil));
+    for (uint32_t sIdx = 0; sIdx < submitCount; ) {
+        auto* qSubmit = _cmdBuffSubmissionPool.acquireObjectSafely();
+        qSubmit->prepare(&pSubmits[sIdx], submitCount - sIdx, fence);
+        sIdx += qSubmit->getSubmitCount();
+        VkResult subRslt = submit(qSubmit);
         if (rslt == VK_SUCCESS) { rslt = subRslt; }
     }
+    _device->addActivityPerformance(_device->_performanceStatistics.queue.queueSubmit, startTime);
     return rslt;
 }
 
 VkResult MVKQueue::submit(const VkPresentInfoKHR* pPresentInfo) {
-	return submit(new MVKQueuePresentSurfaceSubmission(this, pPresentInfo));
+	auto* qSubmit = _presentSubmissionPool.acquireObjectSafely();
+	qSubmit->prepare(pPresentInfo);
+	return submit(qSubmit);
+}
+
+// Metal blocks the creation of a MTLCommandBuffer, for an unpredictable time, while its queue holds the
+// maximum number of active MTLCommandBuffers. Instead, each submission reserves the MTLCommandBuffers it
+// expects to use, before it is dispatched for execution, and waits here while the active and reserved
+// MTLCommandBuffers would exceed that maximum. The wait is bounded by a multiple of the average lifetime
+// of the MTLCommandBuffers of this queue, after which the submission proceeds anyway, so that GPU work
+// waiting on later work from the app, such as a timeline semaphore signal, cannot deadlock the app.
+// Returns the number of MTLCommandBuffers reserved, which must later be released.
+uint32_t MVKQueue::reserveMTLCommandBuffers(uint32_t mtlCmdBuffCount) {
+	unique_lock<mutex> lock(_mtlCmdBuffFlowLock);
+
+	mtlCmdBuffCount = min(mtlCmdBuffCount, _maxActiveMTLCommandBufferCount);
+	auto hasCapacity = [this, mtlCmdBuffCount]() {
+		return _activeMTLCommandBufferCount + _reservedMTLCommandBufferCount + mtlCmdBuffCount <= _maxActiveMTLCommandBufferCount;
+	};
+	if ( !hasCapacity() ) {
+		uint64_t startTime = _device->getPerformanceTimestamp();
+		double timeoutMS = max(_averageMTLCommandBufferLifetime * kMVKMTLCommandBufferFlowTimeoutLifetimes,
+							   kMVKMTLCommandBufferFlowMinTimeout);
+		if ( !_mtlCmdBuffFlowCondVar.wait_for(lock, chrono::duration<double, milli>(timeoutMS), hasCapacity) ) {
+			MVKLogInfo("%s: Proceeding with submission after waiting %.3f ms for %u of %u active MTLCommandBuffers to complete.",
+					   getName().c_str(), timeoutMS, mtlCmdBuffCount, _maxActiveMTLCommandBufferCount);
+		}
+		_device->addActivityPerformance(_device->_performanceStatistics.queue.mtlCommandBufferFlowWait, startTime);
+	}
+	_reservedMTLCommandBufferCount += mtlCmdBuffCount;
+	return mtlCmdBuffCount;
+}
+
+// Once a submission has executed, the MTLCommandBuffers it used are counted as active instead.
+void MVKQueue::releaseReservedMTLCommandBuffers(uint32_t mtlCmdBuffCount) {
+	lock_guard<mutex> lock(_mtlCmdBuffFlowLock);
+	_reservedMTLCommandBufferCount -= mtlCmdBuffCount;
+	_mtlCmdBuffFlowCondVar.notify_all();
+}
+
+// Each MTLCommandBuffer is attributed to the GPU frame that is current when it is created.
+id<MTLCommandBuffer> MVKQueue::getMTLCommandBuffer(bool retainReferences) {
+	id<MTLCommandBuffer> mtlCmdBuff = (retainReferences
+									   ? [_mtlQueue commandBuffer]
+									   : [_mtlQueue commandBufferWithUnretainedReferences]);
+	uint64_t startTime = mvkGetTimestamp();
+
+	uint32_t activeCnt;
+	uint64_t frameIdx;
+	{
+		lock_guard<mutex> lock(_mtlCmdBuffFlowLock);
+		activeCnt = ++_activeMTLCommandBufferCount;
+		frameIdx = _gpuFrameIndex;
+		_gpuFramePendingCounts[frameIdx % kMVKGPUFrameTimeCapacity]++;
+	}
+	[mtlCmdBuff addCompletedHandler: ^(id<MTLCommandBuffer> mcb) { completeMTLCommandBuffer(mcb, startTime, frameIdx); }];
+
+	_device->updateActiveMTLCommandBufferCount(1, activeCnt);
+	return mtlCmdBuff;
+}
+
+// Tracks the lifetime of the completed MTLCommandBuffer, from creation to completion,
+// as a running average that favours recent MTLCommandBuffers, and frees its slot.
+// Also adds the GPU times reported by Metal to the performance statistics, and to the GPU frame.
+void MVKQueue::completeMTLCommandBuffer(id<MTLCommandBuffer> mtlCmdBuff, uint64_t startTime, uint64_t frameIndex) {
+	double lifetime = mvkGetElapsedMilliseconds(startTime);
+	bool hasGPUTimes = [mtlCmdBuff respondsToSelector: @selector(GPUStartTime)];
+	if (hasGPUTimes) {
+		_device->addActivityDuration(_device->_performanceStatistics.gpu.mtlCommandBufferExecution,
+									 (mtlCmdBuff.GPUEndTime - mtlCmdBuff.GPUStartTime) * 1000.0);
+		_device->addActivityDuration(_device->_performanceStatistics.gpu.mtlCommandBufferScheduling,
+									 (mtlCmdBuff.kernelEndTime - mtlCmdBuff.kernelStartTime) * 1000.0);
+		_device->addActivityDuration(_device->_performanceStatistics.gpu.mtlCommandBufferQueueLatency,
+									 max(mtlCmdBuff.GPUStartTime - mtlCmdBuff.kernelEndTime, 0.0) * 1000.0);
+	}
+
+	uint32_t activeCnt;
+	{
+		lock_guard<mutex> lock(_mtlCmdBuffFlowLock);
+		_averageMTLCommandBufferLifetime = ((_averageMTLCommandBufferLifetime == 0.0)
+											? lifetime
+											: (_averageMTLCommandBufferLifetime * (1.0 - kMVKMTLCommandBufferLifetimeWeight) +
+											   lifetime * kMVKMTLCommandBufferLifetimeWeight));
+		activeCnt = --_activeMTLCommandBufferCount;
+		_mtlCmdBuffFlowCondVar.notify_all();
+
+		// If the slot of the GPU frame has been recycled for a later frame, the frame was discarded.
+		uint32_t frameSlot = frameIndex % kMVKGPUFrameTimeCapacity;
+		auto& frameTime = _gpuFrameTimes[frameSlot];
+		if (frameTime.frameIndex == frameIndex) {
+			if (hasGPUTimes) { addGPUFrameTimes(frameTime, mtlCmdBuff); }
+			frameTime.mtlCommandBufferCount++;
+			if (--_gpuFramePendingCounts[frameSlot] == 0 && frameIndex < _gpuFrameIndex) {
+				finishGPUFrame(frameTime);
+				advanceGPUFrameCompletedCount();
+			}
+		}
+	}
+	_device->updateActiveMTLCommandBufferCount(-1, activeCnt);
+}
+
+// Adds the GPU times of the completed MTLCommandBuffer to the GPU frame. MTLCommandBuffers
+// on a queue complete in order, so overlap can only occur with the previous MTLCommandBuffer.
+// Must be called while _mtlCmdBuffFlowLock is held.
+void MVKQueue::addGPUFrameTimes(MVKGPUFrameTime& frameTime, id<MTLCommandBuffer> mtlCmdBuff) {
+	double gpuStart = mtlCmdBuff.GPUStartTime * 1000.0;
+	double gpuEnd = mtlCmdBuff.GPUEndTime * 1000.0;
+	if (gpuEnd <= 0.0) { return; }		// Not executed on the GPU
+
+	bool isFirst = frameTime.gpuEndTime == 0.0;
+	frameTime.gpuBusyTime += max(gpuEnd - (isFirst ? gpuStart : max(gpuStart, frameTime.gpuEndTime)), 0.0);
+	frameTime.gpuStartTime = isFirst ? gpuStart : min(gpuStart, frameTime.gpuStartTime);
+	frameTime.gpuEndTime = max(gpuEnd, frameTime.gpuEndTime);
+	frameTime.maxQueueLatency = max((mtlCmdBuff.GPUStartTime - mtlCmdBuff.kernelEndTime) * 1000.0, frameTime.maxQueueLatency);
+}
+
+// Ends the current GPU frame, when a presentation has been committed to this queue, and begins
+// the next GPU frame. If the GPU frame being recycled never finished, its times are discarded,
+// and completions of its remaining MTLCommandBuffers are ignored.
+void MVKQueue::endGPUFrame() {
+	lock_guard<mutex> lock(_mtlCmdBuffFlowLock);
+
+	uint32_t frameSlot = _gpuFrameIndex % kMVKGPUFrameTimeCapacity;
+	_gpuFrameTimes[frameSlot].frameIndex = _gpuFrameIndex;
+	if (_gpuFramePendingCounts[frameSlot] == 0) { finishGPUFrame(_gpuFrameTimes[frameSlot]); }
+
+	_gpuFrameIndex++;
+	frameSlot = _gpuFrameIndex % kMVKGPUFrameTimeCapacity;
+	mvkClear(&_gpuFrameTimes[frameSlot]);
+	_gpuFrameTimes[frameSlot].frameIndex = _gpuFrameIndex;
+	_gpuFramePendingCounts[frameSlot] = 0;
+
+	// A discarded frame no longer holds up the frames that followed it.
+	uint64_t oldestFrameIdx = getOldestGPUFrameIndex();
+	if (_gpuFrameCompletedCount < oldestFrameIdx) { _gpuFrameCompletedCount = oldestFrameIdx; }
+	advanceGPUFrameCompletedCount();
+}
+
+// Returns the index of the oldest GPU frame whose slot has not been recycled.
+// Must be called while _mtlCmdBuffFlowLock is held.
+uint64_t MVKQueue::getOldestGPUFrameIndex() {
+	return (_gpuFrameIndex >= kMVKGPUFrameTimeCapacity - 1) ? _gpuFrameIndex - (kMVKGPUFrameTimeCapacity - 1) : 0;
+}
+
+// GPU frames are reported in order, so the completed count only advances past
+// consecutive frames that have ended and whose MTLCommandBuffers have all completed.
+// Must be called while _mtlCmdBuffFlowLock is held.
+void MVKQueue::advanceGPUFrameCompletedCount() {
+	while (_gpuFrameCompletedCount < _gpuFrameIndex) {
+		uint32_t frameSlot = _gpuFrameCompletedCount % kMVKGPUFrameTimeCapacity;
+		if (_gpuFrameTimes[frameSlot].frameIndex != _gpuFrameCompletedCount || _gpuFramePendingCounts[frameSlot]) { return; }
+		_gpuFrameCompletedCount++;
+	}
+}
+
+// Completes the GPU frame once all of its MTLCommandBuffers have completed.
+// Must be called while _mtlCmdBuffFlowLock is held.
+void MVKQueue::finishGPUFrame(MVKGPUFrameTime& frameTime) {
+	if (frameTime.gpuEndTime > 0.0) {
+		double frameInterval = ((_lastGPUFrameEndTime > 0.0 && _lastGPUFrameEndTime < frameTime.gpuEndTime)
+								? frameTime.gpuEndTime - _lastGPUFrameEndTime
+								: frameTime.gpuEndTime - frameTime.gpuStartTime);
+		frameTime.gpuUtilization = frameInterval > 0.0 ? min(frameTime.gpuBusyTime / frameInterval, 1.0) : 1.0;
+		_lastGPUFrameEndTime = frameTime.gpuEndTime;
+		_device->addActivityDuration(_device->_performanceStatistics.gpu.frameGPUBusyTime, frameTime.gpuBusyTime);
+
+		MVKInstance* mvkInst = getInstance();
+		if (mvkInst->_autoGPUCaptureScope == MVK_CONFIG_AUTO_GPU_CAPTURE_SCOPE_SLOW_FRAME &&
+			frameTime.gpuBusyTime > mvkInst->_autoGPUCaptureSlowFrameThreshold &&
+			frameTime.frameIndex != _slowFrameCaptureFrameIndex) {
+			_hasSlowGPUFrame = true;
+		}
+	}
+}
+
+// Called between the end of one frame on this queue and the beginning of the next. If slow frames are
+// being captured, and the frame that just ended took longer than the threshold on the CPU, or a recently
+// completed frame took longer than the threshold on the GPU, captures the frame that is beginning.
+// Frames that are captured are not considered, because capturing slows them down.
+void MVKQueue::updateSlowFrameGPUCapture() {
+	MVKInstance* mvkInst = getInstance();
+	if (mvkInst->_autoGPUCaptureScope != MVK_CONFIG_AUTO_GPU_CAPTURE_SCOPE_SLOW_FRAME) { return; }
+
+	uint64_t presentTime = mvkGetTimestamp();
+	double cpuFrameTime = _lastPresentTime ? mvkGetElapsedMilliseconds(_lastPresentTime, presentTime) : 0.0;
+	_lastPresentTime = presentTime;
+
+	lock_guard<mutex> lock(_mtlCmdBuffFlowLock);
+
+	bool wasCaptured = (_gpuFrameIndex == _slowFrameCaptureFrameIndex + 1);
+	bool isCPUSlow = !wasCaptured && cpuFrameTime > mvkInst->_autoGPUCaptureSlowFrameThreshold;
+	if ( !(isCPUSlow || _hasSlowGPUFrame) ) { return; }
+	if (_slowFrameCaptureCount >= (uint32_t)mvkInst->_autoGPUCaptureMaxFrameCount) { return; }
+
+	// Append the sequence number to the file name, before the extension.
+	std::string outFile = mvkInst->_autoGPUCaptureOutputFile;
+	if ( !outFile.empty() ) {
+		std::string seqNum = "-" + std::to_string(_slowFrameCaptureCount + 1);
+		size_t extPos = outFile.find_last_of('.');
+		size_t dirPos = outFile.find_last_of('/');
+		if (extPos != std::string::npos && (dirPos == std::string::npos || extPos > dirPos)) {
+			outFile.insert(extPos, seqNum);
+		} else {
+			outFile += seqNum;
+		}
+	}
+
+	if (_presentationCaptureScope->captureNextScope(outFile)) {
+		MVKLogInfo("%s: Capturing frame %llu, after a frame took %.3f ms on the CPU%s.", _name.c_str(),
+				   (unsigned long long)_gpuFrameIndex, cpuFrameTime, _hasSlowGPUFrame ? ", or longer than the threshold on the GPU" : "");
+		_slowFrameCaptureFrameIndex = _gpuFrameIndex;
+		_slowFrameCaptureCount++;
+		_hasSlowGPUFrame = false;
+	}
+}
+
+// Only completed frames whose slots have not been recycled are available.
+VkResult MVKQueue::getGPUFrameTimes(uint32_t* pFrameTimeCount, MVKGPUFrameTime* pFrameTimes) {
+	lock_guard<mutex> lock(_mtlCmdBuffFlowLock);
+
+	uint64_t oldestFrameIdx = getOldestGPUFrameIndex();
+	uint32_t availCnt = (_gpuFrameCompletedCount > oldestFrameIdx) ? uint32_t(_gpuFrameCompletedCount - oldestFrameIdx) : 0;
+	if ( !pFrameTimes ) {
+		*pFrameTimeCount = availCnt;
+		return VK_SUCCESS;
+	}
+
+	uint32_t frameCnt = min(*pFrameTimeCount, availCnt);
+	uint64_t firstFrameIdx = _gpuFrameCompletedCount - frameCnt;
+	for (uint32_t frameIdx = 0; frameIdx < frameCnt; frameIdx++) {
+		pFrameTimes[frameIdx] = _gpuFrameTimes[(firstFrameIdx + frameIdx) % kMVKGPUFrameTimeCapacity];
+	}
+	*pFrameTimeCount = frameCnt;
+	return (frameCnt < availCnt) ? VK_INCOMPLETE : VK_SUCCESS;
 }
 
 // Create an empty submit struct and fence, submit to queue and wait on fence.
@@ -125,15 +382,19 @@ VkResult MVKQueue::waitIdle() {
 
 #pragma mark Construction
 
-#define MVK_DISPATCH_QUEUE_QOS_CLASS		QOS_CLASS_USER_INITIATED
+#define MVK_DISPATCH_QUEUE_QOS_CLASS					QOS_CLASS_USER_INITIATED
+#define MVK_DISPATCH_QUEUE_LOW_PRIORITY_QOS_CLASS		QOS_CLASS_UTILITY
 
 MVKQueue::MVKQueue(MVKDevice* device, MVKQueueFamily* queueFamily, uint32_t index, float priority)
-        : MVKDeviceTrackingMixin(device) {
+        : MVKDeviceTrackingMixin(device), _cmdBuffSubmissionPool(this), _presentSubmissionPool(this) {
 
 	_queueFamily = queueFamily;
 	_index = index;
 	_priority = priority;
 	_nextMTLCmdBuffID = 1;
+	_maxActiveMTLCommandBufferCount = max(getInstance()->getMoltenVKConfiguration()->maxActiveMetalCommandBuffersPerQueue, 1U);
+	mvkClear(_gpuFrameTimes, kMVKGPUFrameTimeCapacity);
+	mvkClear(_gpuFramePendingCounts, kMVKGPUFrameTimeCapacity);
 
 	initName();
 	initExecQueue();
@@ -151,9 +412,14 @@ void MVKQueue::initName() {
 void MVKQueue::initExecQueue() {
 	_execQueue = nil;
 	if ( !_device->_pMVKConfig->synchronousQueueSubmits ) {
-		// Determine the dispatch queue priority
-		dispatch_qos_class_t dqQOS = MVK_DISPATCH_QUEUE_QOS_CLASS;
-		int dqPriority = (1.0 - _priority) * QOS_MIN_RELATIVE_PRIORITY;
+		// Determine the dispatch queue priority. Queues in the upper half of the priority range use
+		// the default QoS class, and queues in the lower half, such as those used for background work,
+		// use a lower QoS class, so the OS schedules their submission threads behind interactive work.
+		// The priority within each half determines the relative priority within the QoS class.
+		bool isLowPriority = _priority < 0.5;
+		dispatch_qos_class_t dqQOS = isLowPriority ? MVK_DISPATCH_QUEUE_LOW_PRIORITY_QOS_CLASS : MVK_DISPATCH_QUEUE_QOS_CLASS;
+		float relPriority = mvkClamp((isLowPriority ? _priority : _priority - 0.5f) * 2.0f, 0.0f, 1.0f);
+		int dqPriority = (1.0 - relPriority) * QOS_MIN_RELATIVE_PRIORITY;
 		dispatch_queue_attr_t dqAttr = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, dqQOS, dqPriority);
 
 		// Create the dispatch queue
@@ -200,15 +466,15 @@ void MVKQueue::destroyExecQueue() {
 #pragma mark -
 #pragma mark MVKQueueSubmission
 
-MVKQueueSubmission::MVKQueueSubmission(MVKQueue* queue,
-									   uint32_t waitSemaphoreCount,
-									   const VkSemaphore* pWaitSemaphores) {
-	_queue = queue;
+// Clears any content from a previous use, since submissions are recycled.
+void MVKQueueSubmission::setWaitSemaphores(uint32_t waitSemaphoreCount, const VkSemaphore* pWaitSemaphores) {
+	clearConfigurationResult();
 	_trackPerformance = _queue->_device->_pMVKConfig->performanceTracking;
 
+	_waitSemaphores.clear();
 	_waitSemaphores.reserve(waitSemaphoreCount);
 	for (uint32_t i = 0; i < waitSemaphoreCount; i++) {
-		_waitSemaphores.push_back((MVKSemaphore*)pWaitSemaphores[i]);
+		_waitSemaphores.push_back(make_pair((MVKSemaphore*)pWaitSemaphores[i], (uint64_t)0));
 	}
 }
 
@@ -220,26 +486,138 @@ void MVKQueueCommandBufferSubmission::execute() {
 
 //	MVKLogDebug("Executing submission %p.", this);
 
+	uint64_t signpostID = mvkSignpostBegin(kMVKSignpostQueueSubmissionExecute);
+
 	_queue->_submissionCaptureScope->beginScope();
 
+	// Sync any non-coherent memory ranges flushed by the app since the previous submission.
+	if (_queue->_device->shouldTrackDirtyMappedMemory()) { _queue->_device->flushDirtyDeviceMemory(); }
+
 	// If using encoded semaphore waiting, do so now.
-	for (auto* ws : _waitSemaphores) { ws->encodeWait(getActiveMTLCommandBuffer()); }
+	for (auto& ws : _waitSemaphores) { ws.first->encodeWait(getActiveMTLCommandBuffer(), ws.second); }
+
+	uint32_t cbStart = 0;
+	uint32_t ssStart = 0;
+	for (auto& ls : _logicalSubmits) {
+
+		// Submit each command buffer, either in parallel, or one after another.
+		if (canEncodeInParallel(cbStart, ls.cmdBuffersEnd)) {
+			encodeCommandBuffersInParallel(cbStart, ls.cmdBuffersEnd);
+		} else {
+			for (uint32_t cbIdx = cbStart; cbIdx < ls.cmdBuffersEnd; cbIdx++) { _cmdBuffers[cbIdx]->submit(this); }
+		}
 
-	// Submit each command buffer.
-	for (auto& cb : _cmdBuffers) { cb->submit(this); }
+		// If using encoded semaphore signaling, do so now. Signals consumed
+		// by a later merged submit have been removed, and are skipped.
+		for (uint32_t ssIdx = ssStart; ssIdx < ls.signalSemaphoresEnd; ssIdx++) {
+			auto& ss = _signalSemaphores[ssIdx];
+			if (ss.first) { ss.first->encodeSignal(getActiveMTLCommandBuffer(), ss.second); }
+		}
 
-	// If using encoded semaphore signaling, do so now.
-	for (auto* ss : _signalSemaphores) { ss->encodeSignal(getActiveMTLCommandBuffer()); }
+		cbStart = ls.cmdBuffersEnd;
+		ssStart = ls.signalSemaphoresEnd;
+	}
 
 	// Commit the last MTLCommandBuffer.
-	// Nothing after this because callback might destroy this instance before this function ends.
+	// Nothing that uses this instance after this because callback might destroy this instance before this function ends.
 	commitActiveMTLCommandBuffer(true);
+	mvkSignpostEnd(kMVKSignpostQueueSubmissionExecute, signpostID);
+}
+
+// Follows the MTLCommandBuffers that execute() will use. Semaphore waits, serially encoded command
+// buffers, and semaphore signals all use the active MTLCommandBuffer, creating it if needed. Each
+// command buffer of a logical submit encoded in parallel uses its own MTLCommandBuffer, which is
+// committed separately from any active MTLCommandBuffer holding earlier semaphore waits, and the
+// last of which becomes the active MTLCommandBuffer. Partial commits made while encoding are not
+// known in advance, and are not counted. At least one MTLCommandBuffer is always committed.
+uint32_t MVKQueueCommandBufferSubmission::getMTLCommandBufferCount() {
+	uint32_t mtlCmdBuffCnt = 0;
+	bool hasActive = false;
+	auto useActive = [&]() { if ( !hasActive ) { mtlCmdBuffCnt++; hasActive = true; } };
+
+	if ( !_waitSemaphores.empty() ) { useActive(); }
+
+	uint32_t cbStart = 0;
+	uint32_t ssStart = 0;
+	for (auto& ls : _logicalSubmits) {
+		if (canEncodeInParallel(cbStart, ls.cmdBuffersEnd)) {
+			mtlCmdBuffCnt += ls.cmdBuffersEnd - cbStart;
+			hasActive = true;
+		} else if (ls.cmdBuffersEnd > cbStart) {
+			useActive();
+		}
+		for (uint32_t ssIdx = ssStart; ssIdx < ls.signalSemaphoresEnd; ssIdx++) {
+			if (_signalSemaphores[ssIdx].first) { useActive(); }
+		}
+		cbStart = ls.cmdBuffersEnd;
+		ssStart = ls.signalSemaphoresEnd;
+	}
+	useActive();
+
+	return mtlCmdBuffCnt;
+}
+
+// Returns whether the range of command buffers in this submission should be encoded in parallel.
+bool MVKQueueCommandBufferSubmission::canEncodeInParallel(uint32_t cbStart, uint32_t cbEnd) {
+	return cbEnd - cbStart > 1 && _queue->_device->shouldEncodeSubmissionsInParallel();
+}
+
+// Encodes each command buffer onto its own MTLCommandBuffer, using a concurrent dispatch queue.
+// Each MTLCommandBuffer is enqueued in submission order before any encoding starts, so the GPU
+// will execute them in submission order, regardless of the order in which encoding completes.
+// Any MTLCommandBuffer already active, holding encoded semaphore waits, is enqueued ahead of them.
+// Once all encoding is complete, the MTLCommandBuffers are committed in order, and the last
+// is left as the active MTLCommandBuffer, to carry semaphore signals and completion handling.
+void MVKQueueCommandBufferSubmission::encodeCommandBuffersInParallel(uint32_t cbStart, uint32_t cbEnd) {
+	size_t cbCnt = cbEnd - cbStart;
+	MVKVectorInline<MVKCommandBuffer*, 32> encCmdBuffs;
+	MVKVectorInline<id<MTLCommandBuffer>, 32> encMTLCmdBuffs;
+	MVKVectorInline<id<MTLCommandBuffer>, 32> mtlCmdBuffs;
+	encCmdBuffs.reserve(cbCnt);
+	encMTLCmdBuffs.reserve(cbCnt);
+	mtlCmdBuffs.reserve(cbCnt);
+
+	for (uint32_t cbIdx = cbStart; cbIdx < cbEnd; cbIdx++) {
+		MVKCommandBuffer* cb = _cmdBuffers[cbIdx];
+		bool needsEncoding = false;
+		id<MTLCommandBuffer> mtlCmdBuff = cb->prepareSubmitted(_queue, needsEncoding);
+		if ( !mtlCmdBuff ) { continue; }
+
+		[mtlCmdBuff enqueue];
+
+		mtlCmdBuffs.push_back(mtlCmdBuff);
+		if (needsEncoding) {
+			encCmdBuffs.push_back(cb);
+			encMTLCmdBuffs.push_back(mtlCmdBuff);
+		}
+	}
+
+	size_t encCnt = encCmdBuffs.size();
+	if (encCnt > 1) {
+		MVKCommandBuffer** pEncCmdBuffs = encCmdBuffs.data();
+		id<MTLCommandBuffer>* pEncMTLCmdBuffs = encMTLCmdBuffs.data();
+		dispatch_apply(encCnt, dispatch_get_global_queue(QOS_CLASS_USER_INTERACTIVE, 0), ^(size_t cbIdx) {
+			pEncCmdBuffs[cbIdx]->encodeSubmitted(pEncMTLCmdBuffs[cbIdx]);
+		});
+	} else if (encCnt == 1) {
+		encCmdBuffs[0]->encodeSubmitted(encMTLCmdBuffs[0]);
+	}
+
+	for (auto mtlCmdBuff : mtlCmdBuffs) {
+		if (_activeMTLCommandBuffer) { commitActiveMTLCommandBuffer(); }
+		_activeMTLCommandBuffer = mtlCmdBuff;		// already retained and enqueued
+	}
+}
+
+id<MTLCommandBuffer> MVKQueueCommandBufferSubmission::commitPartialMTLCommandBuffer() {
+	setActiveMTLCommandBuffer(_queue->getMTLCommandBuffer());
+	return _activeMTLCommandBuffer;
 }
 
 // Returns the active MTLCommandBuffer, lazily retrieving it from the queue if needed.
 id<MTLCommandBuffer> MVKQueueCommandBufferSubmission::getActiveMTLCommandBuffer() {
 	if ( !_activeMTLCommandBuffer ) {
-		setActiveMTLCommandBuffer([_queue->_mtlQueue commandBufferWithUnretainedReferences]);
+		setActiveMTLCommandBuffer(_queue->getMTLCommandBuffer());
 	}
 	return _activeMTLCommandBuffer;
 }
@@ -258,9 +636,10 @@ void MVKQueueCommandBufferSubmission::setActiveMTLCommandBuffer(id<MTLCommandBuf
 // any semaphores. We have delayed signalling the semaphores as long as possible to
 // allow as much filling of the MTLCommandBuffer as possible before forcing a wait.
 void MVKQueueCommandBufferSubmission::commitActiveMTLCommandBuffer(bool signalCompletion) {
+	uint64_t signpostID = mvkSignpostBegin(kMVKSignpostQueueSubmissionCommit);
 
 	// If using inline semaphore waiting, do so now.
-	for (auto& ws : _waitSemaphores) { ws->encodeWait(nil); }
+	for (auto& ws : _waitSemaphores) { ws.first->encodeWait(nil, ws.second); }
 
 	MVKDevice* mkvDev = _queue->_device;
 	uint64_t startTime = mkvDev->getPerformanceTimestamp();
@@ -279,54 +658,136 @@ void MVKQueueCommandBufferSubmission::commitActiveMTLCommandBuffer(bool signalCo
 	_activeMTLCommandBuffer = nil;
 	[mtlCmdBuff commit];
 	[mtlCmdBuff release];		// retained
+	mvkSignpostEnd(kMVKSignpostQueueSubmissionCommit, signpostID);
 }
 
 void MVKQueueCommandBufferSubmission::finish() {
 
 //	MVKLogDebug("Finishing submission %p. Submission count %u.", this, _subCount--);
 
+	uint64_t signpostID = mvkSignpostBegin(kMVKSignpostQueueSubmissionFinish);
+
 	// Performed here instead of as part of execute() for rare case where app destroys queue
 	// immediately after a waitIdle() is cleared by fence below, taking the capture scope with it.
 	_queue->_submissionCaptureScope->endScope();
 
 	// If using inline semaphore signaling, do so now.
-	for (auto& ss : _signalSemaphores) { ss->encodeSignal(nil); }
+	for (auto& ss : _signalSemaphores) {
+		if (ss.first) { ss.first->encodeSignal(nil, ss.second); }
+	}
 
 	// If a fence exists, signal it.
 	if (_fence) { _fence->signal(); }
 
-	this->destroy();
-}
-
-MVKQueueCommandBufferSubmission::MVKQueueCommandBufferSubmission(MVKQueue* queue,
-																 const VkSubmitInfo* pSubmit,
-																 VkFence fence)
-        : MVKQueueSubmission(queue,
-							 (pSubmit ? pSubmit->waitSemaphoreCount : 0),
-							 (pSubmit ? pSubmit->pWaitSemaphores : nullptr)) {
-
-    // pSubmit can be null if just tracking the fence alone
-    if (pSubmit) {
-        uint32_t cbCnt = pSubmit->commandBufferCount;
-        _cmdBuffers.reserve(cbCnt);
-        for (uint32_t i = 0; i < cbCnt; i++) {
-            MVKCommandBuffer* cb = MVKCommandBuffer::getMVKCommandBuffer(pSubmit->pCommandBuffers[i]);
-            _cmdBuffers.push_back(cb);
-            setConfigurationResult(cb->getConfigurationResult());
-        }
-
-        uint32_t ssCnt = pSubmit->signalSemaphoreCount;
-        _signalSemaphores.reserve(ssCnt);
-        for (uint32_t i = 0; i < ssCnt; i++) {
-            _signalSemaphores.push_back((MVKSemaphore*)pSubmit->pSignalSemaphores[i]);
-        }
-    }
+	// Return to the queue for reuse. Nothing that uses this instance after this, because this instance may be reused immediately.
+	_queue->_cmdBuffSubmissionPool.returnObjectSafely(this);
+	mvkSignpostEnd(kMVKSignpostQueueSubmissionFinish, signpostID);
+}
+
+// Returns the timeline semaphore values of the VkSubmitInfo, or null if it has none.
+static const VkTimelineSemaphoreSubmitInfoKHR* getTimelineSemaphoreSubmitInfo(const VkSubmitInfo* pSubmit) {
+	for (const auto* next = (const VkBaseInStructure*)pSubmit->pNext; next; next = next->pNext) {
+		switch (next->sType) {
+			case VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR:
+				return (const VkTimelineSemaphoreSubmitInfoKHR*)next;
+			default:
+				break;
+		}
+	}
+	return nullptr;
+}
 
-	_fence = (MVKFence*)fence;
+// Returns the index of the signal semaphore, added by an earlier merged submit, that satisfies
+// a wait on the semaphore at the value, or returns -1 if the wait is not satisfied in this submission.
+static int32_t findSatisfyingSignal(MVKVectorInline<pair<MVKSemaphore*, uint64_t>, 8>& signalSemaphores,
+									MVKSemaphore* mvkSem4, uint64_t value) {
+	bool isTimeline = mvkSem4->getSemaphoreType() == VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+	for (size_t ssIdx = 0; ssIdx < signalSemaphores.size(); ssIdx++) {
+		auto& ss = signalSemaphores[ssIdx];
+		if (ss.first == mvkSem4 && ( !isTimeline || ss.second >= value)) { return (int32_t)ssIdx; }
+	}
+	return -1;
+}
+
+// A submit can be merged if each of its waits is satisfied by a signal from an earlier merged submit.
+// Semaphores that do not use command encoding are signaled from the CPU once the whole submission
+// has completed, so a submit that signals one of them is never followed by a merged submit, which
+// would otherwise delay that signal until the later command buffers have also completed.
+bool MVKQueueCommandBufferSubmission::canMergeSubmit(const VkSubmitInfo* pSubmit) {
+	for (auto& ss : _signalSemaphores) {
+		if (ss.first && !ss.first->isUsingCommandEncoding()) { return false; }
+	}
+
+	auto* pTimelineSubmit = getTimelineSemaphoreSubmitInfo(pSubmit);
+	for (uint32_t i = 0; i < pSubmit->waitSemaphoreCount; i++) {
+		auto* mvkSem4 = (MVKSemaphore*)pSubmit->pWaitSemaphores[i];
+		uint64_t value = (pTimelineSubmit && i < pTimelineSubmit->waitSemaphoreValueCount) ? pTimelineSubmit->pWaitSemaphoreValues[i] : 0;
+		if (findSatisfyingSignal(_signalSemaphores, mvkSem4, value) < 0) { return false; }
+	}
+	return true;
+}
+
+// Adds the command buffers and semaphore signals of the submit as a logical submit.
+// The waits of the first submit are retained. The waits of each later submit are satisfied
+// within the MTLCommandBuffer, so they are dropped, along with the binary semaphore signals
+// they consume. Timeline semaphore signals remain, since they may be observed elsewhere.
+void MVKQueueCommandBufferSubmission::addSubmit(const VkSubmitInfo* pSubmit, bool isFirst) {
+	auto* pTimelineSubmit = getTimelineSemaphoreSubmitInfo(pSubmit);
+
+	if (isFirst) {
+		uint32_t wsCnt = pTimelineSubmit ? min(pTimelineSubmit->waitSemaphoreValueCount, (uint32_t)_waitSemaphores.size()) : 0;
+		for (uint32_t i = 0; i < wsCnt; i++) {
+			_waitSemaphores[i].second = pTimelineSubmit->pWaitSemaphoreValues[i];
+		}
+	} else {
+		for (uint32_t i = 0; i < pSubmit->waitSemaphoreCount; i++) {
+			auto* mvkSem4 = (MVKSemaphore*)pSubmit->pWaitSemaphores[i];
+			if (mvkSem4->getSemaphoreType() == VK_SEMAPHORE_TYPE_TIMELINE_KHR) { continue; }
+			int32_t ssIdx = findSatisfyingSignal(_signalSemaphores, mvkSem4, 0);
+			if (ssIdx >= 0) { _signalSemaphores[ssIdx].first = nullptr; }
+		}
+	}
+
+	uint32_t cbCnt = pSubmit->commandBufferCount;
+	for (uint32_t i = 0; i < cbCnt; i++) {
+		MVKCommandBuffer* cb = MVKCommandBuffer::getMVKCommandBuffer(pSubmit->pCommandBuffers[i]);
+		_cmdBuffers.push_back(cb);
+		setConfigurationResult(cb->getConfigurationResult());
+	}
+
+	// Timeline semaphores signal the values provided for them. Binary semaphores ignore them.
+	uint32_t ssCnt = pSubmit->signalSemaphoreCount;
+	for (uint32_t i = 0; i < ssCnt; i++) {
+		uint64_t value = (pTimelineSubmit && i < pTimelineSubmit->signalSemaphoreValueCount) ? pTimelineSubmit->pSignalSemaphoreValues[i] : 0;
+		_signalSemaphores.push_back(make_pair((MVKSemaphore*)pSubmit->pSignalSemaphores[i], value));
+	}
+
+	_logicalSubmits.push_back({(uint32_t)_cmdBuffers.size(), (uint32_t)_signalSemaphores.size()});
+}
+
+void MVKQueueCommandBufferSubmission::prepare(const VkSubmitInfo* pSubmits, uint32_t submitCount, VkFence fence) {
+	setWaitSemaphores((pSubmits ? pSubmits->waitSemaphoreCount : 0),
+					  (pSubmits ? pSubmits->pWaitSemaphores : nullptr));
+	_cmdBuffers.clear();
+	_signalSemaphores.clear();
+	_logicalSubmits.clear();
+
+	// pSubmits can be null if just tracking the fence alone
+	uint32_t mergedCnt = 0;
+	if (pSubmits) {
+		addSubmit(&pSubmits[mergedCnt++], true);
+		while (mergedCnt < submitCount && canMergeSubmit(&pSubmits[mergedCnt])) {
+			addSubmit(&pSubmits[mergedCnt++], false);
+		}
+	} else {
+		_logicalSubmits.push_back({0, 0});
+	}
+
+	_fence = (mergedCnt == submitCount) ? (MVKFence*)fence : nullptr;
 	_activeMTLCommandBuffer = nil;
 
 //	static std::atomic<uint32_t> _subCount;
-//	MVKLogDebug("Creating submission %p. Submission count %u.", this, ++_subCount);
+//	MVKLogDebug("Preparing submission %p. Submission count %u.", this, ++_subCount);
 }
 
 
@@ -338,37 +799,59 @@ void MVKQueuePresentSurfaceSubmission::execute() {
 	// If the semaphores are not encodable, wait on them inline after presenting.
 	// The semaphores know what to do.
 	id<MTLCommandBuffer> mtlCmdBuff = getMTLCommandBuffer();
-	for (auto& ws : _waitSemaphores) { ws->encodeWait(mtlCmdBuff); }
-	for (auto& img : _presentableImages) { img->presentCAMetalDrawable(mtlCmdBuff); }
-	for (auto& ws : _waitSemaphores) { ws->encodeWait(nil); }
+	for (auto& ws : _waitSemaphores) { ws.first->encodeWait(mtlCmdBuff, ws.second); }
+	for (auto& pi : _presentInfo) { pi.presentableImage->presentCAMetalDrawable(mtlCmdBuff, pi); }
+	for (auto& ws : _waitSemaphores) { ws.first->encodeWait(nil, ws.second); }
 	[mtlCmdBuff commit];
+	_queue->endGPUFrame();
 
 	// Let Xcode know the current frame is done, then start a new frame
 	auto cs = _queue->_presentationCaptureScope;
 	cs->endScope();
+	_queue->updateSlowFrameGPUCapture();
 	cs->beginScope();
 
-	this->destroy();
+	// Return to the queue for reuse. Nothing after this, because this instance may be reused immediately.
+	_queue->_presentSubmissionPool.returnObjectSafely(this);
 }
 
 id<MTLCommandBuffer> MVKQueuePresentSurfaceSubmission::getMTLCommandBuffer() {
-	id<MTLCommandBuffer> mtlCmdBuff = [_queue->getMTLCommandQueue() commandBufferWithUnretainedReferences];
+	id<MTLCommandBuffer> mtlCmdBuff = _queue->getMTLCommandBuffer();
 	setLabelIfNotNil(mtlCmdBuff, @"vkQueuePresentKHR CommandBuffer");
 	[mtlCmdBuff enqueue];
 	return mtlCmdBuff;
 }
 
-MVKQueuePresentSurfaceSubmission::MVKQueuePresentSurfaceSubmission(MVKQueue* queue,
-																   const VkPresentInfoKHR* pPresentInfo)
-	: MVKQueueSubmission(queue, pPresentInfo->waitSemaphoreCount, pPresentInfo->pWaitSemaphores) {
+void MVKQueuePresentSurfaceSubmission::prepare(const VkPresentInfoKHR* pPresentInfo) {
+	setWaitSemaphores(pPresentInfo->waitSemaphoreCount, pPresentInfo->pWaitSemaphores);
+	_presentInfo.clear();
+
+	const VkPresentTimesInfoGOOGLE* pPresentTimesInfo = nullptr;
+	for (const auto* next = (const VkBaseInStructure*)pPresentInfo->pNext; next; next = next->pNext) {
+		switch (next->sType) {
+			case VK_STRUCTURE_TYPE_PRESENT_TIMES_INFO_GOOGLE:
+				pPresentTimesInfo = (const VkPresentTimesInfoGOOGLE*)next;
+				break;
+			default:
+				break;
+		}
+	}
 
 	// Populate the array of swapchain images, testing each one for status
 	uint32_t scCnt = pPresentInfo->swapchainCount;
 	VkResult* pSCRslts = pPresentInfo->pResults;
-	_presentableImages.reserve(scCnt);
+	_presentInfo.reserve(scCnt);
 	for (uint32_t scIdx = 0; scIdx < scCnt; scIdx++) {
 		MVKSwapchain* mvkSC = (MVKSwapchain*)pPresentInfo->pSwapchains[scIdx];
-		_presentableImages.push_back(mvkSC->getPresentableImage(pPresentInfo->pImageIndices[scIdx]));
+		MVKImagePresentInfo presentInfo = {};
+		presentInfo.presentableImage = mvkSC->getPresentableImage(pPresentInfo->pImageIndices[scIdx]);
+		if (pPresentTimesInfo && pPresentTimesInfo->pTimes) {
+			presentInfo.hasPresentTime = true;
+			presentInfo.presentID = pPresentTimesInfo->pTimes[scIdx].presentID;
+			presentInfo.desiredPresentTime = pPresentTimesInfo->pTimes[scIdx].desiredPresentTime;
+		}
+		presentInfo.renderExtent = presentInfo.presentableImage->getRenderExtent();
+		_presentInfo.push_back(presentInfo);
 		VkResult scRslt = mvkSC->getSurfaceStatus();
 		if (pSCRslts) { pSCRslts[scIdx] = scRslt; }
 		setConfigurationResult(scRslt);
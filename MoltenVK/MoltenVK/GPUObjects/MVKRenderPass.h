@@ -25,12 +25,100 @@
 
 class MVKRenderPass;
 class MVKFramebuffer;
+class MVKImage;
 
 
 // Parameters to define the sizing of inline collections
 const static uint32_t kMVKDefaultAttachmentCount = 8;
 
 
+#pragma mark -
+#pragma mark MVKClearLoadOverrides
+
+/**
+ * Identifies subpass attachments whose Metal load action should clear them to the contained
+ * values, regardless of their Vulkan load op. Color attachments are identified by their index
+ * within the subpass.
+ */
+typedef struct MVKClearLoadOverrides {
+	VkClearValue colorValues[kMVKCachedColorAttachmentCount];
+	float mtlDepthValue;
+	uint32_t mtlStencilValue;
+	uint32_t colorAttachmentMask;
+	bool isClearingDepth;
+	bool isClearingStencil;
+
+	bool isColorAttachmentCleared(uint32_t caIdx) { return mvkIsAnyFlagEnabled(colorAttachmentMask, 1U << caIdx); }
+
+	void reset() {
+		colorAttachmentMask = 0;
+		isClearingDepth = false;
+		isClearingStencil = false;
+	}
+
+	MVKClearLoadOverrides() { reset(); }
+
+} MVKClearLoadOverrides;
+
+
+#pragma mark -
+#pragma mark MVKResolveStoreOverrides
+
+/**
+ * Identifies subpass color attachments whose Metal store action should resolve them to the
+ * contained image subresources, in place of resolve commands that follow the render pass.
+ * Color attachments are identified by their index within the subpass.
+ */
+typedef struct MVKResolveStoreOverrides {
+	MVKImage* images[kMVKCachedColorAttachmentCount];
+	uint32_t mipLevels[kMVKCachedColorAttachmentCount];
+	uint32_t arrayLayers[kMVKCachedColorAttachmentCount];
+	uint32_t colorAttachmentMask;
+	uint32_t commandCount;		// The number of commands performed by these store actions
+
+	bool isColorAttachmentResolved(uint32_t caIdx) { return mvkIsAnyFlagEnabled(colorAttachmentMask, 1U << caIdx); }
+
+	void reset() {
+		colorAttachmentMask = 0;
+		commandCount = 0;
+	}
+
+	MVKResolveStoreOverrides() { reset(); }
+
+} MVKResolveStoreOverrides;
+
+
+#pragma mark -
+#pragma mark MVKInferredLoadStoreActions
+
+/**
+ * Identifies render pass attachments whose contents have been inferred, from the commands around
+ * the render pass in its command buffer, to be undefined when the render pass begins, and so need
+ * not be loaded, or to be overwritten before anything reads them after the render pass ends, and
+ * so need not be stored. Attachments are identified by their index within the render pass.
+ */
+typedef struct MVKInferredLoadStoreActions {
+	uint64_t dontCareLoadAttachmentMask;
+	uint64_t dontCareStoreAttachmentMask;
+
+	static const uint32_t kMaxAttachmentCount = 64;
+
+	bool isLoadDontCare(uint32_t rpAttIdx) { return rpAttIdx < kMaxAttachmentCount && mvkIsAnyFlagEnabled(dontCareLoadAttachmentMask, 1ULL << rpAttIdx); }
+	bool isStoreDontCare(uint32_t rpAttIdx) { return rpAttIdx < kMaxAttachmentCount && mvkIsAnyFlagEnabled(dontCareStoreAttachmentMask, 1ULL << rpAttIdx); }
+
+	void setLoadDontCare(uint32_t rpAttIdx) { if (rpAttIdx < kMaxAttachmentCount) { dontCareLoadAttachmentMask |= 1ULL << rpAttIdx; } }
+	void setStoreDontCare(uint32_t rpAttIdx) { if (rpAttIdx < kMaxAttachmentCount) { dontCareStoreAttachmentMask |= 1ULL << rpAttIdx; } }
+
+	void reset() {
+		dontCareLoadAttachmentMask = 0;
+		dontCareStoreAttachmentMask = 0;
+	}
+
+	MVKInferredLoadStoreActions() { reset(); }
+
+} MVKInferredLoadStoreActions;
+
+
 #pragma mark -
 #pragma mark MVKRenderSubpass
 
@@ -43,6 +131,9 @@ public:
 	/** Returns the Vulkan API opaque object controlling this object. */
 	MVKVulkanAPIObject* getVulkanAPIObject() override;
 
+	/** Returns the render pass containing this subpass. */
+	inline MVKRenderPass* getRenderPass() { return _renderPass; }
+
 	/** Returns the number of color attachments, which may be zero for depth-only rendering. */
 	inline uint32_t getColorAttachmentCount() { return uint32_t(_colorAttachments.size()); }
 
@@ -58,16 +149,73 @@ public:
 	/** Returns the Vulkan sample count of the attachments used in this subpass. */
 	VkSampleCountFlagBits getSampleCount();
 
+	/** Returns whether the Metal render pass used by this subpass ends with the last subpass of the render pass. */
+	bool isInLastMetalRenderPass();
+
+	/**
+	 * Returns the index of the color attachment of this subpass that renders to the specified
+	 * mip level and array layer of the specified image, using the specified Metal pixel format,
+	 * and that has no resolve attachment, or returns VK_ATTACHMENT_UNUSED if this subpass has
+	 * no such color attachment.
+	 */
+	uint32_t getUnresolvedColorAttachmentIndex(MVKFramebuffer* framebuffer,
+											   MVKImage* image,
+											   uint32_t mipLevel,
+											   uint32_t arrayLayer,
+											   MTLPixelFormat mtlPixFmt);
+
+	/**
+	 * Returns whether this subpass continues the Metal render pass begun by the previous
+	 * subpass, instead of beginning a new Metal render pass of its own.
+	 */
+	inline bool continuesPreviousMetalRenderPass() { return _isMergedWithPreviousSubpass; }
+
+	/**
+	 * Returns whether the input attachments of this subpass are read from the current
+	 * contents of the color attachments, using framebuffer fetch.
+	 */
+	inline bool usesFramebufferFetchForInputAttachments() { return _isMergedWithPreviousSubpass && !_inputAttachments.empty(); }
+
 	/** 
 	 * Populates the specified Metal MTLRenderPassDescriptor with content from this
 	 * instance, the specified framebuffer, and the specified array of clear values.
+	 * If clear load overrides are provided, the identified attachments are cleared
+	 * to the override values by the Metal load action. If resolve store overrides are
+	 * provided, the identified attachments are resolved to the override image
+	 * subresources by the Metal store action. If inferred load and store actions are
+	 * provided, the identified attachments are neither loaded nor stored.
 	 */
 	void populateMTLRenderPassDescriptor(MTLRenderPassDescriptor* mtlRPDesc,
 										 MVKFramebuffer* framebuffer,
 										 MVKVector<VkClearValue>& clearValues,
 										 bool isRenderingEntireAttachment,
                                          bool loadOverride = false,
-                                         bool storeOverride = false);
+                                         bool storeOverride = false,
+										 MVKClearLoadOverrides* pClearLoads = nullptr,
+										 MVKResolveStoreOverrides* pResolveStores = nullptr,
+										 MVKInferredLoadStoreActions* pInferredLoadStores = nullptr);
+
+	/**
+	 * Populates the attachments of the specified Metal MTLRenderPassDescriptor, including their
+	 * load and store actions, as populateMTLRenderPassDescriptor() does, but not the clear values.
+	 */
+	void populateMTLRenderPassDescriptorAttachments(MTLRenderPassDescriptor* mtlRPDesc,
+													MVKFramebuffer* framebuffer,
+													bool isRenderingEntireAttachment,
+													bool loadOverride,
+													bool storeOverride,
+													MVKClearLoadOverrides* pClearLoads,
+													MVKResolveStoreOverrides* pResolveStores,
+													MVKInferredLoadStoreActions* pInferredLoadStores);
+
+	/**
+	 * Populates the clear values of the attachments of the specified Metal MTLRenderPassDescriptor
+	 * that will be cleared by their load action, from the specified array of clear values, or the
+	 * clear load overrides, if provided.
+	 */
+	void populateMTLRenderPassDescriptorClearValues(MTLRenderPassDescriptor* mtlRPDesc,
+													MVKVector<VkClearValue>& clearValues,
+													MVKClearLoadOverrides* pClearLoads = nullptr);
 
 	/**
 	 * Populates the specified vector with the attachments that need to be cleared
@@ -85,15 +233,18 @@ private:
 	friend class MVKRenderPassAttachment;
 
 	MVKMTLFmtCaps getRequiredFormatCapabilitiesForAttachmentAt(uint32_t rpAttIdx);
+	bool canMergeWithPreviousSubpass(MVKRenderSubpass& prevSubpass);
 
 	MVKRenderPass* _renderPass;
 	uint32_t _subpassIndex;
+	uint32_t _mtlRenderPassEndIndex;
 	MVKVectorInline<VkAttachmentReference, kMVKDefaultAttachmentCount> _inputAttachments;
 	MVKVectorInline<VkAttachmentReference, kMVKDefaultAttachmentCount> _colorAttachments;
 	MVKVectorInline<VkAttachmentReference, kMVKDefaultAttachmentCount> _resolveAttachments;
 	MVKVectorInline<uint32_t, kMVKDefaultAttachmentCount> _preserveAttachments;
 	VkAttachmentReference _depthStencilAttachment;
 	id<MTLTexture> _mtlDummyTex = nil;
+	bool _isMergedWithPreviousSubpass;
 };
 
 
@@ -124,11 +275,29 @@ public:
                                                    bool hasResolveAttachment,
                                                    bool isStencil,
                                                    bool loadOverride = false,
-                                                   bool storeOverride = false);
+                                                   bool storeOverride = false,
+                                                   bool clearOverride = false,
+                                                   bool isLoadDontCare = false,
+                                                   bool isStoreDontCare = false);
 
     /** Returns whether this attachment should be cleared in the subpass. */
     bool shouldUseClearAttachment(MVKRenderSubpass* subpass);
 
+	/**
+	 * Returns whether the render pass replaces all of the existing contents of this attachment,
+	 * in all aspects, before reading them, when the render pass renders the entire attachment.
+	 */
+	bool replacesContents();
+
+	/**
+	 * Returns whether the contents of this attachment are undefined after the render pass,
+	 * in all aspects, when the render pass renders the entire attachment.
+	 */
+	bool discardsContents();
+
+	/** Returns whether the contents of this attachment are undefined when the render pass begins. */
+	bool hasUndefinedInitialContents() { return _info.initialLayout == VK_IMAGE_LAYOUT_UNDEFINED; }
+
 	/** Constructs an instance for the specified parent renderpass. */
 	MVKRenderPassAttachment(MVKRenderPass* renderPass,
 							const VkAttachmentDescription* pCreateInfo);
@@ -162,6 +331,18 @@ public:
 	/** Returns the format of the color attachment at the specified index. */
 	MVKRenderSubpass* getSubpass(uint32_t subpassIndex);
 
+	/** Returns the number of attachments in this render pass. */
+	uint32_t getAttachmentCount() { return uint32_t(_attachments.size()); }
+
+	/** Returns the attachment at the specified index. */
+	MVKRenderPassAttachment* getAttachment(uint32_t rpAttIdx) { return &_attachments[rpAttIdx]; }
+
+	/**
+	 * Returns whether this render pass declares an explicit dependency on the commands before it,
+	 * if isSource is true, or an explicit dependency of the commands after it, if isSource is false.
+	 */
+	bool hasExternalSubpassDependency(bool isSource);
+
 	/** Constructs an instance for the specified device. */
 	MVKRenderPass(MVKDevice* device, const VkRenderPassCreateInfo* pCreateInfo);
 
@@ -170,6 +351,8 @@ protected:
 	friend class MVKRenderPassAttachment;
 
 	void propogateDebugName() override {}
+	bool areSubpassesDependentOnlyByRegion(uint32_t firstSrcSubpassIdx, uint32_t dstSubpassIdx);
+	void mergeCompatibleSubpasses();
 
 	MVKVectorInline<MVKRenderPassAttachment, kMVKDefaultAttachmentCount> _attachments;
 	MVKVectorInline<MVKRenderSubpass, 1> _subpasses;
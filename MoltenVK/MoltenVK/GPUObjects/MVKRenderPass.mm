@@ -67,12 +67,53 @@ VkSampleCountFlagBits MVKRenderSubpass::getSampleCount() {
 	return VK_SAMPLE_COUNT_1_BIT;
 }
 
+bool MVKRenderSubpass::isInLastMetalRenderPass() { return _mtlRenderPassEndIndex == _renderPass->_subpasses.size() - 1; }
+
+uint32_t MVKRenderSubpass::getUnresolvedColorAttachmentIndex(MVKFramebuffer* framebuffer,
+															 MVKImage* image,
+															 uint32_t mipLevel,
+															 uint32_t arrayLayer,
+															 MTLPixelFormat mtlPixFmt) {
+	uint32_t caCnt = getColorAttachmentCount();
+	for (uint32_t caIdx = 0; caIdx < caCnt; caIdx++) {
+		uint32_t clrRPAttIdx = _colorAttachments[caIdx].attachment;
+		if (clrRPAttIdx == VK_ATTACHMENT_UNUSED) { continue; }
+
+		bool hasResolveAttachment = !_resolveAttachments.empty() && _resolveAttachments[caIdx].attachment != VK_ATTACHMENT_UNUSED;
+		if (hasResolveAttachment) { continue; }
+
+		MVKImageView* imgView = framebuffer->getAttachment(clrRPAttIdx);
+		const VkImageSubresourceRange& srRange = imgView->getSubresourceRange();
+		if (imgView->getImage() == image && imgView->getMTLPixelFormat() == mtlPixFmt &&
+			srRange.baseMipLevel == mipLevel && srRange.baseArrayLayer == arrayLayer) {
+			return caIdx;
+		}
+	}
+	return VK_ATTACHMENT_UNUSED;
+}
+
 void MVKRenderSubpass::populateMTLRenderPassDescriptor(MTLRenderPassDescriptor* mtlRPDesc,
 													   MVKFramebuffer* framebuffer,
 													   MVKVector<VkClearValue>& clearValues,
 													   bool isRenderingEntireAttachment,
 													   bool loadOverride,
-													   bool storeOverride) {
+													   bool storeOverride,
+													   MVKClearLoadOverrides* pClearLoads,
+													   MVKResolveStoreOverrides* pResolveStores,
+													   MVKInferredLoadStoreActions* pInferredLoadStores) {
+	populateMTLRenderPassDescriptorAttachments(mtlRPDesc, framebuffer, isRenderingEntireAttachment,
+											   loadOverride, storeOverride, pClearLoads, pResolveStores, pInferredLoadStores);
+	populateMTLRenderPassDescriptorClearValues(mtlRPDesc, clearValues, pClearLoads);
+}
+
+void MVKRenderSubpass::populateMTLRenderPassDescriptorAttachments(MTLRenderPassDescriptor* mtlRPDesc,
+																  MVKFramebuffer* framebuffer,
+																  bool isRenderingEntireAttachment,
+																  bool loadOverride,
+																  bool storeOverride,
+																  MVKClearLoadOverrides* pClearLoads,
+																  MVKResolveStoreOverrides* pResolveStores,
+																  MVKInferredLoadStoreActions* pInferredLoadStores) {
 	MVKPixelFormats* pixFmts = _renderPass->getPixelFormats();
 
 	// Populate the Metal color attachments
@@ -90,18 +131,26 @@ void MVKRenderSubpass::populateMTLRenderPassDescriptor(MTLRenderPassDescriptor*
             bool hasResolveAttachment = (rslvRPAttIdx != VK_ATTACHMENT_UNUSED);
             if (hasResolveAttachment) {
                 framebuffer->getAttachment(rslvRPAttIdx)->populateMTLRenderPassAttachmentDescriptorResolve(mtlColorAttDesc);
+            } else if (pResolveStores && pResolveStores->isColorAttachmentResolved(caIdx)) {
+				mtlColorAttDesc.resolveTexture = pResolveStores->images[caIdx]->getMTLTexture();
+				mtlColorAttDesc.resolveLevel = pResolveStores->mipLevels[caIdx];
+				mtlColorAttDesc.resolveSlice = pResolveStores->arrayLayers[caIdx];
+				mtlColorAttDesc.resolveDepthPlane = 0;
+				hasResolveAttachment = true;
             }
 
             // Configure the color attachment
             MVKRenderPassAttachment* clrMVKRPAtt = &_renderPass->_attachments[clrRPAttIdx];
+			bool isClearOverride = pClearLoads && pClearLoads->isColorAttachmentCleared(caIdx);
 			framebuffer->getAttachment(clrRPAttIdx)->populateMTLRenderPassAttachmentDescriptor(mtlColorAttDesc);
-			if (clrMVKRPAtt->populateMTLRenderPassAttachmentDescriptor(mtlColorAttDesc, this,
-                                                                       isRenderingEntireAttachment,
-                                                                       hasResolveAttachment, false,
-                                                                       loadOverride,
-                                                                       storeOverride)) {
-				mtlColorAttDesc.clearColor = pixFmts->getMTLClearColor(clearValues[clrRPAttIdx], clrMVKRPAtt->getFormat());
-			}
+			clrMVKRPAtt->populateMTLRenderPassAttachmentDescriptor(mtlColorAttDesc, this,
+                                                                   isRenderingEntireAttachment,
+                                                                   hasResolveAttachment, false,
+                                                                   loadOverride,
+                                                                   storeOverride,
+                                                                   isClearOverride,
+                                                                   pInferredLoadStores && pInferredLoadStores->isLoadDontCare(clrRPAttIdx),
+                                                                   pInferredLoadStores && pInferredLoadStores->isStoreDontCare(clrRPAttIdx));
 		}
 	}
 
@@ -115,24 +164,28 @@ void MVKRenderSubpass::populateMTLRenderPassDescriptor(MTLRenderPassDescriptor*
 		if (pixFmts->isDepthFormat(mtlDSFormat)) {
 			MTLRenderPassDepthAttachmentDescriptor* mtlDepthAttDesc = mtlRPDesc.depthAttachment;
 			dsImage->populateMTLRenderPassAttachmentDescriptor(mtlDepthAttDesc);
-			if (dsMVKRPAtt->populateMTLRenderPassAttachmentDescriptor(mtlDepthAttDesc, this,
-                                                                      isRenderingEntireAttachment,
-                                                                      false, false,
-                                                                      loadOverride,
-                                                                      storeOverride)) {
-                mtlDepthAttDesc.clearDepth = pixFmts->getMTLClearDepthValue(clearValues[dsRPAttIdx]);
-			}
+			bool isClearOverride = pClearLoads && pClearLoads->isClearingDepth;
+			dsMVKRPAtt->populateMTLRenderPassAttachmentDescriptor(mtlDepthAttDesc, this,
+                                                                  isRenderingEntireAttachment,
+                                                                  false, false,
+                                                                  loadOverride,
+                                                                  storeOverride,
+                                                                  isClearOverride,
+                                                                  pInferredLoadStores && pInferredLoadStores->isLoadDontCare(dsRPAttIdx),
+                                                                  pInferredLoadStores && pInferredLoadStores->isStoreDontCare(dsRPAttIdx));
 		}
 		if (pixFmts->isStencilFormat(mtlDSFormat)) {
 			MTLRenderPassStencilAttachmentDescriptor* mtlStencilAttDesc = mtlRPDesc.stencilAttachment;
 			dsImage->populateMTLRenderPassAttachmentDescriptor(mtlStencilAttDesc);
-			if (dsMVKRPAtt->populateMTLRenderPassAttachmentDescriptor(mtlStencilAttDesc, this,
-                                                                      isRenderingEntireAttachment,
-                                                                      false, true,
-                                                                      loadOverride,
-                                                                      storeOverride)) {
-				mtlStencilAttDesc.clearStencil = pixFmts->getMTLClearStencilValue(clearValues[dsRPAttIdx]);
-			}
+			bool isClearOverride = pClearLoads && pClearLoads->isClearingStencil;
+			dsMVKRPAtt->populateMTLRenderPassAttachmentDescriptor(mtlStencilAttDesc, this,
+                                                                  isRenderingEntireAttachment,
+                                                                  false, true,
+                                                                  loadOverride,
+                                                                  storeOverride,
+                                                                  isClearOverride,
+                                                                  pInferredLoadStores && pInferredLoadStores->isLoadDontCare(dsRPAttIdx),
+                                                                  pInferredLoadStores && pInferredLoadStores->isStoreDontCare(dsRPAttIdx));
 		}
 	}
 
@@ -167,6 +220,40 @@ void MVKRenderSubpass::populateMTLRenderPassDescriptor(MTLRenderPassDescriptor*
 	}
 }
 
+// The clear values are only needed by attachments that are cleared by their load action.
+void MVKRenderSubpass::populateMTLRenderPassDescriptorClearValues(MTLRenderPassDescriptor* mtlRPDesc,
+																  MVKVector<VkClearValue>& clearValues,
+																  MVKClearLoadOverrides* pClearLoads) {
+	MVKPixelFormats* pixFmts = _renderPass->getPixelFormats();
+
+	uint32_t caCnt = getColorAttachmentCount();
+	for (uint32_t caIdx = 0; caIdx < caCnt; caIdx++) {
+		uint32_t clrRPAttIdx = _colorAttachments[caIdx].attachment;
+		if (clrRPAttIdx == VK_ATTACHMENT_UNUSED) { continue; }
+
+		MTLRenderPassColorAttachmentDescriptor* mtlColorAttDesc = mtlRPDesc.colorAttachments[caIdx];
+		if (mtlColorAttDesc.loadAction != MTLLoadActionClear) { continue; }
+
+		bool isClearOverride = pClearLoads && pClearLoads->isColorAttachmentCleared(caIdx);
+		VkClearValue& clearValue = isClearOverride ? pClearLoads->colorValues[caIdx] : clearValues[clrRPAttIdx];
+		mtlColorAttDesc.clearColor = pixFmts->getMTLClearColor(clearValue, _renderPass->_attachments[clrRPAttIdx].getFormat());
+	}
+
+	uint32_t dsRPAttIdx = _depthStencilAttachment.attachment;
+	if (dsRPAttIdx == VK_ATTACHMENT_UNUSED) { return; }
+
+	MTLRenderPassDepthAttachmentDescriptor* mtlDepthAttDesc = mtlRPDesc.depthAttachment;
+	if (mtlDepthAttDesc.texture && mtlDepthAttDesc.loadAction == MTLLoadActionClear) {
+		bool isClearOverride = pClearLoads && pClearLoads->isClearingDepth;
+		mtlDepthAttDesc.clearDepth = isClearOverride ? pClearLoads->mtlDepthValue : pixFmts->getMTLClearDepthValue(clearValues[dsRPAttIdx]);
+	}
+	MTLRenderPassStencilAttachmentDescriptor* mtlStencilAttDesc = mtlRPDesc.stencilAttachment;
+	if (mtlStencilAttDesc.texture && mtlStencilAttDesc.loadAction == MTLLoadActionClear) {
+		bool isClearOverride = pClearLoads && pClearLoads->isClearingStencil;
+		mtlStencilAttDesc.clearStencil = isClearOverride ? pClearLoads->mtlStencilValue : pixFmts->getMTLClearStencilValue(clearValues[dsRPAttIdx]);
+	}
+}
+
 void MVKRenderSubpass::populateClearAttachments(MVKVector<VkClearAttachment>& clearAtts,
 												MVKVector<VkClearValue>& clearValues) {
 	VkClearAttachment cAtt;
@@ -227,10 +314,41 @@ MVKMTLFmtCaps MVKRenderSubpass::getRequiredFormatCapabilitiesForAttachmentAt(uin
 	return caps;
 }
 
+// Returns whether this subpass can continue the Metal render pass of the specified previous subpass.
+// The subpasses must render to identical color and depth/stencil attachments, neither may resolve,
+// and each input attachment must be the color attachment at the same index, so it can be read as
+// the current pixel of that color attachment using framebuffer fetch.
+bool MVKRenderSubpass::canMergeWithPreviousSubpass(MVKRenderSubpass& prevSubpass) {
+	uint32_t caCnt = getColorAttachmentCount();
+	if (caCnt == 0 || caCnt != prevSubpass.getColorAttachmentCount()) { return false; }
+	for (uint32_t caIdx = 0; caIdx < caCnt; caIdx++) {
+		if (_colorAttachments[caIdx].attachment != prevSubpass._colorAttachments[caIdx].attachment) { return false; }
+	}
+	if (_depthStencilAttachment.attachment != prevSubpass._depthStencilAttachment.attachment) { return false; }
+
+	for (auto& att : _resolveAttachments) {
+		if (att.attachment != VK_ATTACHMENT_UNUSED) { return false; }
+	}
+	for (auto& att : prevSubpass._resolveAttachments) {
+		if (att.attachment != VK_ATTACHMENT_UNUSED) { return false; }
+	}
+
+	uint32_t iaCnt = (uint32_t)_inputAttachments.size();
+	for (uint32_t iaIdx = 0; iaIdx < iaCnt; iaIdx++) {
+		uint32_t iaRPAttIdx = _inputAttachments[iaIdx].attachment;
+		if (iaRPAttIdx == VK_ATTACHMENT_UNUSED) { continue; }
+		if (iaIdx >= caCnt || iaRPAttIdx != _colorAttachments[iaIdx].attachment) { return false; }
+	}
+
+	return true;
+}
+
 MVKRenderSubpass::MVKRenderSubpass(MVKRenderPass* renderPass,
 								   const VkSubpassDescription* pCreateInfo) {
 	_renderPass = renderPass;
 	_subpassIndex = (uint32_t)_renderPass->_subpasses.size();
+	_mtlRenderPassEndIndex = _subpassIndex;
+	_isMergedWithPreviousSubpass = false;
 
 	// Add attachments
 	_inputAttachments.reserve(pCreateInfo->inputAttachmentCount);
@@ -278,14 +396,20 @@ bool MVKRenderPassAttachment::populateMTLRenderPassAttachmentDescriptor(MTLRende
                                                                         bool hasResolveAttachment,
                                                                         bool isStencil,
                                                                         bool loadOverride,
-                                                                        bool storeOverride) {
+                                                                        bool storeOverride,
+                                                                        bool clearOverride,
+                                                                        bool isLoadDontCare,
+                                                                        bool isStoreDontCare) {
 
     bool willClear = false;		// Assume the attachment won't be cleared
 
     // Only allow clearing of entire attachment if we're actually rendering to the entire
-    // attachment AND we're in the first subpass.
+    // attachment AND we're in the first subpass, or if the clear has been explicitly requested.
     if ( loadOverride ) {
         mtlAttDesc.loadAction = MTLLoadActionLoad;
+    } else if ( clearOverride ) {
+        mtlAttDesc.loadAction = MTLLoadActionClear;
+        willClear = true;
     } else if ( isRenderingEntireAttachment && (subpass->_subpassIndex == _firstUseSubpassIdx) ) {
         VkAttachmentLoadOp loadOp = isStencil ? _info.stencilLoadOp : _info.loadOp;
         mtlAttDesc.loadAction = mvkMTLLoadActionFromVkAttachmentLoadOp(loadOp);
@@ -294,19 +418,45 @@ bool MVKRenderPassAttachment::populateMTLRenderPassAttachmentDescriptor(MTLRende
         mtlAttDesc.loadAction = MTLLoadActionLoad;
     }
 
+    // If the contents of the attachment are known to be undefined when the render pass begins, don't load them.
+    if (isLoadDontCare && !loadOverride && !clearOverride && (subpass->_subpassIndex == _firstUseSubpassIdx) &&
+        mtlAttDesc.loadAction == MTLLoadActionLoad) {
+        mtlAttDesc.loadAction = MTLLoadActionDontCare;
+    }
+
     // If a resolve attachment exists, this attachment must resolve once complete.
     // Otherwise only allow the attachment to be discarded if we're actually rendering
-    // to the entire attachment and we're in the last subpass.
+    // to the entire attachment and the Metal render pass ends with the last subpass.
     if (hasResolveAttachment && !_renderPass->getDevice()->getPhysicalDevice()->getMetalFeatures()->combinedStoreResolveAction) {
         mtlAttDesc.storeAction = MTLStoreActionMultisampleResolve;
     } else if ( storeOverride ) {
         mtlAttDesc.storeAction = hasResolveAttachment ? MTLStoreActionStoreAndMultisampleResolve : MTLStoreActionStore;
-    } else if ( isRenderingEntireAttachment && (subpass->_subpassIndex == _lastUseSubpassIdx) ) {
+    } else if ( isRenderingEntireAttachment && (subpass->_mtlRenderPassEndIndex == _lastUseSubpassIdx) ) {
         VkAttachmentStoreOp storeOp = isStencil ? _info.stencilStoreOp : _info.storeOp;
         mtlAttDesc.storeAction = mvkMTLStoreActionFromVkAttachmentStoreOp(storeOp, hasResolveAttachment);
     } else {
         mtlAttDesc.storeAction = hasResolveAttachment ? MTLStoreActionStoreAndMultisampleResolve : MTLStoreActionStore;
     }
+
+    // If the contents of the attachment are known to be overwritten before being read after
+    // the render pass ends, don't store them, although a multisample attachment is still resolved.
+    if (isStoreDontCare && !storeOverride && (subpass->_mtlRenderPassEndIndex == _lastUseSubpassIdx)) {
+        if (mtlAttDesc.storeAction == MTLStoreActionStore) { mtlAttDesc.storeAction = MTLStoreActionDontCare; }
+        if (mtlAttDesc.storeAction == MTLStoreActionStoreAndMultisampleResolve) { mtlAttDesc.storeAction = MTLStoreActionMultisampleResolve; }
+    }
+
+#if MVK_IOS
+	// The contents of a memoryless attachment exist only in tile memory during the Metal render pass,
+	// so can be neither loaded nor stored, although a multisample attachment can still be resolved.
+	// If the Metal render pass is being restarted within the subpass, the contents are lost.
+	if (mtlAttDesc.texture.storageMode == MTLStorageModeMemoryless) {
+		if (loadOverride || storeOverride) {
+			_renderPass->reportMessage(ASL_LEVEL_WARNING, "The Metal render pass must be restarted within the subpass, but the contents of the transient attachment, which is bound to lazily allocated memory, exist only in tile memory, and cannot be preserved across the restart.");
+		}
+		if (mtlAttDesc.loadAction == MTLLoadActionLoad) { mtlAttDesc.loadAction = MTLLoadActionDontCare; }
+		mtlAttDesc.storeAction = hasResolveAttachment ? MTLStoreActionMultisampleResolve : MTLStoreActionDontCare;
+	}
+#endif
     return willClear;
 }
 
@@ -318,6 +468,31 @@ bool MVKRenderPassAttachment::shouldUseClearAttachment(MVKRenderSubpass* subpass
 	return (_info.loadOp == VK_ATTACHMENT_LOAD_OP_CLEAR);
 }
 
+// The load op of the attachment only takes effect in the first subpass to use it, so an
+// attachment that is first used in a later subpass might be read as a texture before then.
+bool MVKRenderPassAttachment::replacesContents() {
+	if (_firstUseSubpassIdx != 0) { return false; }
+	if (_info.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD) { return false; }
+
+	MVKPixelFormats* pixFmts = _renderPass->getPixelFormats();
+	if (pixFmts->isStencilFormat(pixFmts->getMTLPixelFormat(_info.format))) {
+		return _info.stencilLoadOp != VK_ATTACHMENT_LOAD_OP_LOAD;
+	}
+	return true;
+}
+
+// An attachment that is not used by any subpass retains its contents.
+bool MVKRenderPassAttachment::discardsContents() {
+	if (_firstUseSubpassIdx == kMVKUndefinedLargeUInt32) { return false; }
+	if (_info.storeOp != VK_ATTACHMENT_STORE_OP_DONT_CARE) { return false; }
+
+	MVKPixelFormats* pixFmts = _renderPass->getPixelFormats();
+	if (pixFmts->isStencilFormat(pixFmts->getMTLPixelFormat(_info.format))) {
+		return _info.stencilStoreOp == VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	}
+	return true;
+}
+
 MVKRenderPassAttachment::MVKRenderPassAttachment(MVKRenderPass* renderPass,
 												 const VkAttachmentDescription* pCreateInfo) {
 	_info = *pCreateInfo;
@@ -369,6 +544,7 @@ MVKRenderPass::MVKRenderPass(MVKDevice* device,
 	for (uint32_t i = 0; i < pCreateInfo->dependencyCount; i++) {
 		_subpassDependencies.push_back(pCreateInfo->pDependencies[i]);
 	}
+	if (_device->shouldMergeSubpasses()) { mergeCompatibleSubpasses(); }
 
 	// Add attachments after subpasses, so each attachment can link to subpasses
 	_attachments.reserve(pCreateInfo->attachmentCount);
@@ -377,4 +553,48 @@ MVKRenderPass::MVKRenderPass(MVKDevice* device,
 	}
 }
 
+// Returns whether all dependencies of the destination subpass on the subpasses between the first
+// source subpass and it are framebuffer-local, and involve only fragment stages, so the
+// destination subpass can join a Metal render pass that starts with the first source subpass.
+bool MVKRenderPass::areSubpassesDependentOnlyByRegion(uint32_t firstSrcSubpassIdx, uint32_t dstSubpassIdx) {
+	static const VkPipelineStageFlags fragStages = (VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+													VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+													VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+													VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+	for (auto& spDep : _subpassDependencies) {
+		if (spDep.dstSubpass != dstSubpassIdx || spDep.srcSubpass < firstSrcSubpassIdx || spDep.srcSubpass >= dstSubpassIdx) { continue; }
+		if ( !mvkIsAnyFlagEnabled(spDep.dependencyFlags, VK_DEPENDENCY_BY_REGION_BIT) ) { return false; }
+		if ( mvkIsAnyFlagEnabled(spDep.srcStageMask, ~fragStages) ) { return false; }
+		if ( mvkIsAnyFlagEnabled(spDep.dstStageMask, ~fragStages) ) { return false; }
+	}
+	return true;
+}
+
+bool MVKRenderPass::hasExternalSubpassDependency(bool isSource) {
+	for (auto& spDep : _subpassDependencies) {
+		if ((isSource ? spDep.srcSubpass : spDep.dstSubpass) == VK_SUBPASS_EXTERNAL) { return true; }
+	}
+	return false;
+}
+
+// Groups runs of consecutive compatible subpasses into single Metal render passes, and
+// marks each subpass in a group with the index of the last subpass in that group. A subpass
+// joins a group only if its dependencies on every earlier subpass in the group allow it.
+void MVKRenderPass::mergeCompatibleSubpasses() {
+	uint32_t spCnt = (uint32_t)_subpasses.size();
+	uint32_t groupStartIdx = 0;
+	for (uint32_t spIdx = 1; spIdx < spCnt; spIdx++) {
+		MVKRenderSubpass& subpass = _subpasses[spIdx];
+		subpass._isMergedWithPreviousSubpass = (subpass.canMergeWithPreviousSubpass(_subpasses[spIdx - 1]) &&
+												areSubpassesDependentOnlyByRegion(groupStartIdx, spIdx));
+		if ( !subpass._isMergedWithPreviousSubpass ) { groupStartIdx = spIdx; }
+	}
+	for (uint32_t spIdx = spCnt; spIdx > 1; spIdx--) {
+		MVKRenderSubpass& subpass = _subpasses[spIdx - 1];
+		if (subpass._isMergedWithPreviousSubpass) {
+			_subpasses[spIdx - 2]._mtlRenderPassEndIndex = subpass._mtlRenderPassEndIndex;
+		}
+	}
+}
+
 
@@ -21,9 +21,11 @@
 #include "MVKDevice.h"
 #include "MVKSync.h"
 #include "MVKVector.h"
+#include <MoltenVKSPIRVToMSLConverter/SPIRVReflection.h>
 #include <MoltenVKSPIRVToMSLConverter/SPIRVToMSLConverter.h>
 #include <MoltenVKGLSLToSPIRVConverter/GLSLToSPIRVConverter.h>
 #include <mutex>
+#include <map>
 
 #import <Metal/Metal.h>
 
@@ -101,22 +103,62 @@ protected:
 	friend MVKShaderCacheIterator;
 	friend MVKShaderLibraryCache;
 	friend MVKShaderModule;
+	friend MVKPipelineCache;
 
-	MVKMTLFunction getMTLFunction(const VkSpecializationInfo* pSpecializationInfo, MVKShaderModule* shaderModule);
+	MVKMTLFunction getMTLFunction(const VkSpecializationInfo* pSpecializationInfo, MVKShaderModule* shaderModule, uint32_t tunedWorkgroupWidth = 0);
+	id<MTLLibrary> getMTLLibrary();
 	void handleCompilationError(NSError* err, const char* opDesc);
     MTLFunctionConstant* getFunctionConstant(NSArray<MTLFunctionConstant*>* mtlFCs, NSUInteger mtlFCID);
+	std::string getMTLFunctionKey(const VkSpecializationInfo* pSpecializationInfo);
+	id<MTLFunction> getMTLFunctionFromCache(const std::string& funcKey);
+	id<MTLFunction> addMTLFunctionToCache(const std::string& funcKey, id<MTLFunction> mtlFunc);
 
 	MVKVulkanAPIDeviceObject* _owner;
 	id<MTLLibrary> _mtlLibrary;
+	std::mutex _mtlLibraryLock;
+	bool _isCompiled;
 	SPIRVToMSLConversionResults _shaderConversionResults;
 	std::string _msl;
+	std::string _serializedEntry;			// Pipeline cache data entry, if held by a pipeline cache
+	std::size_t _serializedEntryHash = 0;
+	std::unordered_map<std::string, id<MTLFunction>> _mtlFunctions;
+	std::mutex _mtlFunctionsLock;
 };
 
 
 #pragma mark -
 #pragma mark MVKShaderLibraryCache
 
-/** Represents a cache of shader libraries for one shader module. */
+typedef struct MVKShaderModuleKey {
+	std::size_t codeSize;
+	std::size_t codeHash;
+
+	bool operator==(const MVKShaderModuleKey& rhs) const {
+		return ((codeSize == rhs.codeSize) && (codeHash == rhs.codeHash));
+	}
+	MVKShaderModuleKey(std::size_t codeSize, std::size_t codeHash) : codeSize(codeSize), codeHash(codeHash) {}
+	MVKShaderModuleKey() :  MVKShaderModuleKey(0, 0) {}
+} MVKShaderModuleKey;
+
+/**
+ * Hash structure implementation for MVKShaderModuleKey in std namespace,
+ * so MVKShaderModuleKey can be used as a key in a std::map and std::unordered_map.
+ */
+namespace std {
+	template <>
+	struct hash<MVKShaderModuleKey> {
+		std::size_t operator()(const MVKShaderModuleKey& k) const { return k.codeHash; }
+	};
+}
+
+
+/**
+ * Represents a cache of shader libraries for one shader module.
+ *
+ * Lookups hold the cache lock shared, so threads retrieving existing libraries do not block
+ * each other. New libraries are converted and compiled without holding the lock, and the
+ * lock is only held exclusively while the new library is inserted.
+ */
 class MVKShaderLibraryCache : public MVKBaseObject {
 
 public:
@@ -137,6 +179,12 @@ public:
 
 	MVKShaderLibraryCache(MVKVulkanAPIDeviceObject* owner) : _owner(owner) {};
 
+	/**
+	 * Constructs an instance held by the pipeline cache.
+	 * The pipeline cache serializes each shader library as it is added to this cache.
+	 */
+	MVKShaderLibraryCache(MVKPipelineCache* pipelineCache);
+
 	~MVKShaderLibraryCache() override;
 
 protected:
@@ -148,38 +196,29 @@ protected:
 	MVKShaderLibrary* addShaderLibrary(SPIRVToMSLConversionConfiguration* pContext,
 									   const std::string& mslSourceCode,
 									   const SPIRVToMSLConversionResults& shaderConversionResults);
+	MVKShaderLibrary* addShaderLibrary(SPIRVToMSLConversionConfiguration* pContext, MVKShaderLibrary* shLib);
+	void addShaderLibraryIndex(const SPIRVToMSLConversionConfiguration& shaderContext);
 	void merge(MVKShaderLibraryCache* other);
+	bool isSerializedDuplicate(MVKShaderLibrary* shLib);
+
+	/** Indexes an entry in _shaderLibraries, for quick rejection of configurations that cannot match. */
+	typedef struct {
+		uint64_t usedBindingSignature;
+		uint32_t shaderLibraryIndex;
+	} MVKShaderLibraryIndex;
 
 	MVKVulkanAPIDeviceObject* _owner;
+	MVKPipelineCache* _pipelineCache = nullptr;
 	MVKVectorInline<std::pair<SPIRVToMSLConversionConfiguration, MVKShaderLibrary*>, 1> _shaderLibraries;
+	std::unordered_map<std::size_t, MVKVectorInline<MVKShaderLibraryIndex, 1>> _shaderLibraryIndexesByOptions;
+	std::unordered_map<std::size_t, MVKShaderLibrary*> _shaderLibrariesBySerializedEntryHash;
+	MVKSharedMutex _accessLock;
 };
 
 
 #pragma mark -
 #pragma mark MVKShaderModule
 
-typedef struct MVKShaderModuleKey {
-	std::size_t codeSize;
-	std::size_t codeHash;
-
-	bool operator==(const MVKShaderModuleKey& rhs) const {
-		return ((codeSize == rhs.codeSize) && (codeHash == rhs.codeHash));
-	}
-	MVKShaderModuleKey(std::size_t codeSize, std::size_t codeHash) : codeSize(codeSize), codeHash(codeHash) {}
-	MVKShaderModuleKey() :  MVKShaderModuleKey(0, 0) {}
-} MVKShaderModuleKey;
-
-/**
- * Hash structure implementation for MVKShaderModuleKey in std namespace,
- * so MVKShaderModuleKey can be used as a key in a std::map and std::unordered_map.
- */
-namespace std {
-	template <>
-	struct hash<MVKShaderModuleKey> {
-		std::size_t operator()(const MVKShaderModuleKey& k) const { return k.codeHash; }
-	};
-}
-
 /** Represents a Vulkan shader module. */
 class MVKShaderModule : public MVKVulkanAPIDeviceObject {
 
@@ -191,17 +230,52 @@ public:
 	/** Returns the debug report object type of this object. */
 	VkDebugReportObjectTypeEXT getVkDebugReportObjectType() override { return VK_DEBUG_REPORT_OBJECT_TYPE_SHADER_MODULE_EXT; }
 
-	/** Returns the Metal shader function, possibly specialized. */
+	/**
+	 * Returns the Metal shader function, possibly specialized.
+	 *
+	 * If pCompileRecord is not null, and the device is reporting slow compiles, it is populated
+	 * with the identity of the shader stage, and the durations of its compilation phases.
+	 *
+	 * If ppShaderLibrary is not null, it is set to the shader library retrieved from the
+	 * pipeline cache, or to null if the shader library is not held by the pipeline cache.
+	 *
+	 * If tunedWorkgroupWidth is not zero, and the workgroup is one-dimensional, with a width that
+	 * is set by a specialization constant, the function is specialized with that width instead.
+	 */
 	MVKMTLFunction getMTLFunction(SPIRVToMSLConversionConfiguration* pContext,
 								  const VkSpecializationInfo* pSpecializationInfo,
-								  MVKPipelineCache* pipelineCache);
+								  MVKPipelineCache* pipelineCache,
+								  MVKShaderStageCompileRecord* pCompileRecord = nullptr,
+								  MVKShaderLibrary** ppShaderLibrary = nullptr,
+								  uint32_t tunedWorkgroupWidth = 0);
 
 	/** Convert the SPIR-V to MSL, using the specified shader conversion context. */
 	bool convert(SPIRVToMSLConversionConfiguration* pContext);
 
+	/**
+	 * Converts the SPIR-V to MSL, using the specified shader conversion context, and copies
+	 * the resulting MSL and conversion results to the specified references. Unlike convert(),
+	 * this function can be called safely by multiple threads at the same time.
+	 */
+	bool convert(SPIRVToMSLConversionConfiguration* pContext,
+				 std::string& mslSourceCode,
+				 SPIRVToMSLConversionResults& shaderConversionResults);
+
 	/** Returns the original SPIR-V code that was specified when this object was created. */
 	const std::vector<uint32_t>& getSPIRV() { return _spvConverter.getSPIRV(); }
 
+	/**
+	 * Returns reflection data for the entry point with the specified name and execution model.
+	 *
+	 * The SPIR-V is reflected the first time each entry point is queried, using the parsed SPIR-V
+	 * that is retained by this module and also used for conversions to MSL, and the results are
+	 * retained by this module and returned to all later queries. The returned data remains valid
+	 * for the lifetime of this module. If reflection fails, errorLog is populated, and null is returned.
+	 */
+	const SPIRVEntryPointReflectionData* getReflectionData(spv::ExecutionModel model,
+														   const std::string& entryName,
+														   std::string& errorLog);
+
 	/**
 	 * Returns the Metal Shading Language source code as converted by the most recent
 	 * call to convert() function, or set directly using the setMSL() function.
@@ -213,6 +287,16 @@ public:
 
     /** Sets the number of threads in a single compute kernel workgroup, per dimension. */
     void setWorkgroupSize(uint32_t x, uint32_t y, uint32_t z);
+
+	/**
+	 * Sets whether compute pipelines created from this shader module may choose the width of a
+	 * one-dimensional workgroup whose width is set by a specialization constant, to suit the GPU.
+	 * The width is chosen by the compute pipeline, from the limits of its compiled pipeline state.
+	 */
+	void setWorkgroupSizeTunable(bool isTunable) { _isWorkgroupSizeTunable = isTunable; }
+
+	/** Returns whether compute pipelines created from this shader module may choose the width of the workgroup. */
+	bool isWorkgroupSizeTunable() { return _isWorkgroupSizeTunable; }
     
 	/** Returns a key as a means of identifying this shader module in a pipeline cache. */
 	MVKShaderModuleKey getKey() { return _key; }
@@ -233,6 +317,9 @@ protected:
 	MVKShaderLibrary* _directMSLLibrary;
 	MVKShaderModuleKey _key;
     std::mutex _accessLock;
+	std::map<std::pair<spv::ExecutionModel, std::string>, SPIRVEntryPointReflectionData> _reflectionData;
+	std::mutex _reflectionLock;
+	bool _isWorkgroupSizeTunable = false;
 };
 
 
@@ -60,62 +60,118 @@ static uint32_t getWorkgroupDimensionSize(const SPIRVWorkgroupSizeDimension& wgD
 	return wgDim.size;
 }
 
-MVKMTLFunction MVKShaderLibrary::getMTLFunction(const VkSpecializationInfo* pSpecializationInfo, MVKShaderModule* shaderModule) {
+// Populates the tuned specialization info, using the map entries and data storage provided,
+// to override the specialization constant that sets the workgroup width, and returns it.
+static const VkSpecializationInfo* getTunedSpecializationInfo(const VkSpecializationInfo* pSpecializationInfo,
+															  const SPIRVWorkgroupSizeDimension& wgWidth,
+															  uint32_t tunedWidth,
+															  VkSpecializationInfo& tunedSpecInfo,
+															  vector<VkSpecializationMapEntry>& tunedMapEntries,
+															  vector<uint8_t>& tunedData) {
+	uint32_t mapEntryCnt = pSpecializationInfo ? pSpecializationInfo->mapEntryCount : 0;
+	size_t dataSize = pSpecializationInfo ? pSpecializationInfo->dataSize : 0;
+
+	tunedData.resize(dataSize + sizeof(uint32_t));
+	if (dataSize) { memcpy(tunedData.data(), pSpecializationInfo->pData, dataSize); }
+	memcpy(&tunedData[dataSize], &tunedWidth, sizeof(uint32_t));
+
+	// Copy the map entries, except any for the width, then add an entry for the tuned width.
+	tunedMapEntries.clear();
+	for (uint32_t specIdx = 0; specIdx < mapEntryCnt; specIdx++) {
+		const VkSpecializationMapEntry& mapEntry = pSpecializationInfo->pMapEntries[specIdx];
+		if (mapEntry.constantID != wgWidth.specializationID) { tunedMapEntries.push_back(mapEntry); }
+	}
+	tunedMapEntries.push_back({ wgWidth.specializationID, (uint32_t)dataSize, sizeof(uint32_t) });
+
+	tunedSpecInfo.mapEntryCount = (uint32_t)tunedMapEntries.size();
+	tunedSpecInfo.pMapEntries = tunedMapEntries.data();
+	tunedSpecInfo.dataSize = tunedData.size();
+	tunedSpecInfo.pData = tunedData.data();
+	return &tunedSpecInfo;
+}
 
-    if ( !_mtlLibrary ) { return MVKMTLFunctionNull; }
+// If the tuned workgroup width is not zero, and the workgroup is one-dimensional, with a width that is set
+// by a specialization constant, the function is specialized with the tuned width instead.
+MVKMTLFunction MVKShaderLibrary::getMTLFunction(const VkSpecializationInfo* pSpecializationInfo,
+												MVKShaderModule* shaderModule,
+												uint32_t tunedWorkgroupWidth) {
+
+	id<MTLLibrary> mtlLibrary = getMTLLibrary();
+    if ( !mtlLibrary ) { return MVKMTLFunctionNull; }
+
+	auto& wgSize = _shaderConversionResults.entryPoint.workgroupSize;
+
+	VkSpecializationInfo tunedSpecInfo;
+	vector<VkSpecializationMapEntry> tunedMapEntries;
+	vector<uint8_t> tunedData;
+	if (tunedWorkgroupWidth && wgSize.width.isSpecialized &&
+		getWorkgroupDimensionSize(wgSize.height, pSpecializationInfo) == 1 &&
+		getWorkgroupDimensionSize(wgSize.depth, pSpecializationInfo) == 1) {
+		pSpecializationInfo = getTunedSpecializationInfo(pSpecializationInfo, wgSize.width, tunedWorkgroupWidth,
+														 tunedSpecInfo, tunedMapEntries, tunedData);
+	}
 
 	id<MTLFunction> mtlFunc = nil;
 	@autoreleasepool {
 		NSString* mtlFuncName = @(_shaderConversionResults.entryPoint.mtlFunctionName.c_str());
 		MVKDevice* mvkDev = _owner->getDevice();
-		uint64_t startTime = mvkDev->getPerformanceTimestamp();
-		mtlFunc = [_mtlLibrary newFunctionWithName: mtlFuncName];								// temp retain
-		mvkDev->addActivityPerformance(mvkDev->_performanceStatistics.shaderCompilation.functionRetrieval, startTime);
 
+		// If this function has already been resolved with the same specialization constant values,
+		// possibly by another pipeline that differs only in fixed-function state, use that function.
+		string funcKey = getMTLFunctionKey(pSpecializationInfo);
+		uint64_t startTime = mvkDev->getPerformanceTimestamp();
+		mtlFunc = getMTLFunctionFromCache(funcKey);												// temp retain
 		if (mtlFunc) {
-			// If the Metal device supports shader specialization, and the Metal function expects to be
-			// specialized, populate Metal function constant values from the Vulkan specialization info,
-			// and compiled a specialized Metal function, otherwise simply use the unspecialized Metal function.
-			if (mvkDev->_pMetalFeatures->shaderSpecialization) {
-				NSArray<MTLFunctionConstant*>* mtlFCs = mtlFunc.functionConstantsDictionary.allValues;
-				if (mtlFCs.count) {
-					// The Metal shader contains function constants and expects to be specialized
-					// Populate the Metal function constant values from the Vulkan specialization info.
-					MTLFunctionConstantValues* mtlFCVals = [MTLFunctionConstantValues new];		// temp retain
-					if (pSpecializationInfo) {
-						// Iterate through the provided Vulkan specialization entries, and populate the
-						// Metal function constant value that matches the Vulkan specialization constantID.
-						for (uint32_t specIdx = 0; specIdx < pSpecializationInfo->mapEntryCount; specIdx++) {
-							const VkSpecializationMapEntry* pMapEntry = &pSpecializationInfo->pMapEntries[specIdx];
-							NSUInteger mtlFCIndex = pMapEntry->constantID;
-							MTLFunctionConstant* mtlFC = getFunctionConstant(mtlFCs, mtlFCIndex);
-							if (mtlFC) {
-								[mtlFCVals setConstantValue: &(((char*)pSpecializationInfo->pData)[pMapEntry->offset])
-													   type: mtlFC.type
-													atIndex: mtlFCIndex];
+			mvkDev->addActivityPerformance(mvkDev->_performanceStatistics.shaderCompilation.functionFromCache, startTime);
+		} else {
+			mtlFunc = [mtlLibrary newFunctionWithName: mtlFuncName];							// temp retain
+			mvkDev->addActivityPerformance(mvkDev->_performanceStatistics.shaderCompilation.functionRetrieval, startTime);
+
+			if (mtlFunc) {
+				// If the Metal device supports shader specialization, and the Metal function expects to be
+				// specialized, populate Metal function constant values from the Vulkan specialization info,
+				// and compiled a specialized Metal function, otherwise simply use the unspecialized Metal function.
+				if (mvkDev->_pMetalFeatures->shaderSpecialization) {
+					NSArray<MTLFunctionConstant*>* mtlFCs = mtlFunc.functionConstantsDictionary.allValues;
+					if (mtlFCs.count) {
+						// The Metal shader contains function constants and expects to be specialized
+						// Populate the Metal function constant values from the Vulkan specialization info.
+						MTLFunctionConstantValues* mtlFCVals = [MTLFunctionConstantValues new];		// temp retain
+						if (pSpecializationInfo) {
+							// Iterate through the provided Vulkan specialization entries, and populate the
+							// Metal function constant value that matches the Vulkan specialization constantID.
+							for (uint32_t specIdx = 0; specIdx < pSpecializationInfo->mapEntryCount; specIdx++) {
+								const VkSpecializationMapEntry* pMapEntry = &pSpecializationInfo->pMapEntries[specIdx];
+								NSUInteger mtlFCIndex = pMapEntry->constantID;
+								MTLFunctionConstant* mtlFC = getFunctionConstant(mtlFCs, mtlFCIndex);
+								if (mtlFC) {
+									[mtlFCVals setConstantValue: &(((char*)pSpecializationInfo->pData)[pMapEntry->offset])
+														   type: mtlFC.type
+														atIndex: mtlFCIndex];
+								}
 							}
 						}
-					}
 
-					// Compile the specialized Metal function, and use it instead of the unspecialized Metal function.
-					MVKFunctionSpecializer* fs = new MVKFunctionSpecializer(_owner);
-					[mtlFunc release];															// temp release
-					mtlFunc = fs->newMTLFunction(_mtlLibrary, mtlFuncName, mtlFCVals);			// temp retain
-					fs->destroy();
-					[mtlFCVals release];														// temp release
+						// Compile the specialized Metal function, and use it instead of the unspecialized Metal function.
+						MVKFunctionSpecializer* fs = new MVKFunctionSpecializer(_owner);
+						[mtlFunc release];															// temp release
+						mtlFunc = fs->newMTLFunction(mtlLibrary, mtlFuncName, mtlFCVals);			// temp retain
+						fs->destroy();
+						[mtlFCVals release];														// temp release
+					}
 				}
+			} else {
+				reportError(VK_ERROR_INVALID_SHADER_NV, "Shader module does not contain an entry point named '%s'.", mtlFuncName.UTF8String);
 			}
-		} else {
-			reportError(VK_ERROR_INVALID_SHADER_NV, "Shader module does not contain an entry point named '%s'.", mtlFuncName.UTF8String);
-		}
 
-		// Set the debug name. First try name of shader module, otherwise try name of owner.
-		NSString* dbName = shaderModule-> getDebugName();
-		if ( !dbName ) { dbName = _owner-> getDebugName(); }
-		setLabelIfNotNil(mtlFunc, dbName);
-	}
+			// Set the debug name. First try name of shader module, otherwise try name of owner.
+			NSString* dbName = shaderModule-> getDebugName();
+			if ( !dbName ) { dbName = _owner-> getDebugName(); }
+			setLabelIfNotNil(mtlFunc, dbName);
 
-	auto& wgSize = _shaderConversionResults.entryPoint.workgroupSize;
+			if (mtlFunc) { mtlFunc = addMTLFunctionToCache(funcKey, mtlFunc); }
+		}
+	}
 
 	MVKMTLFunction mvkMTLFunc(mtlFunc, _shaderConversionResults, MTLSizeMake(getWorkgroupDimensionSize(wgSize.width, pSpecializationInfo),
 																			 getWorkgroupDimensionSize(wgSize.height, pSpecializationInfo),
@@ -132,6 +188,45 @@ MTLFunctionConstant* MVKShaderLibrary::getFunctionConstant(NSArray<MTLFunctionCo
     return nil;
 }
 
+// Returns a key identifying the entry point function, and the constant values it is specialized with.
+// Each constant value is identified by its constant ID, since the offsets of the constant values
+// within the specialization data may differ between specializations with the same values.
+string MVKShaderLibrary::getMTLFunctionKey(const VkSpecializationInfo* pSpecializationInfo) {
+	string funcKey = _shaderConversionResults.entryPoint.mtlFunctionName;
+	funcKey.push_back('\0');
+	if (pSpecializationInfo) {
+		for (uint32_t specIdx = 0; specIdx < pSpecializationInfo->mapEntryCount; specIdx++) {
+			const VkSpecializationMapEntry* pMapEntry = &pSpecializationInfo->pMapEntries[specIdx];
+			funcKey.append((const char*)&pMapEntry->constantID, sizeof(pMapEntry->constantID));
+			funcKey.append((const char*)&pMapEntry->size, sizeof(pMapEntry->size));
+			funcKey.append(&(((const char*)pSpecializationInfo->pData)[pMapEntry->offset]), pMapEntry->size);
+		}
+	}
+	return funcKey;
+}
+
+// Returns a new (retained) reference to the previously resolved MTLFunction identified by the key,
+// or returns nil if the function has not been resolved with those specialization constant values.
+id<MTLFunction> MVKShaderLibrary::getMTLFunctionFromCache(const string& funcKey) {
+	lock_guard<mutex> lock(_mtlFunctionsLock);
+	auto iter = _mtlFunctions.find(funcKey);
+	return (iter != _mtlFunctions.end()) ? [iter->second retain] : nil;
+}
+
+// Adds the specified (retained) MTLFunction to the cache and returns it, unless another thread
+// has already added a function for the same key, in which case the specified function is
+// released, and a new (retained) reference to the function that is already in the cache is returned.
+id<MTLFunction> MVKShaderLibrary::addMTLFunctionToCache(const string& funcKey, id<MTLFunction> mtlFunc) {
+	lock_guard<mutex> lock(_mtlFunctionsLock);
+	id<MTLFunction>& cachedFunc = _mtlFunctions[funcKey];
+	if (cachedFunc) {
+		[mtlFunc release];
+		return [cachedFunc retain];
+	}
+	cachedFunc = [mtlFunc retain];		// retained
+	return mtlFunc;
+}
+
 void MVKShaderLibrary::setEntryPointName(string& funcName) {
 	_shaderConversionResults.entryPoint.mtlFunctionName = funcName;
 }
@@ -146,16 +241,28 @@ void MVKShaderLibrary::setWorkgroupSize(uint32_t x, uint32_t y, uint32_t z) {
 MVKShaderLibrary::MVKShaderLibrary(MVKVulkanAPIDeviceObject* owner,
 								   const string& mslSourceCode,
 								   const SPIRVToMSLConversionResults& shaderConversionResults) : _owner(owner) {
-	MVKShaderLibraryCompiler* slc = new MVKShaderLibraryCompiler(_owner);
+	_mtlLibrary = nil;
+	_isCompiled = false;
+	_shaderConversionResults = shaderConversionResults;
+	_msl = mslSourceCode;
+}
 
-	NSString* nsSrc = [[NSString alloc] initWithUTF8String: mslSourceCode.c_str()];	// temp retained
-	_mtlLibrary = slc->newMTLLibrary(nsSrc);	// retained
-	[nsSrc release];	// release temp string
+// Returns the MTLLibrary, compiling it from the MSL source code on first use, so that
+// shader libraries loaded from pipeline cache data are only compiled if they are used.
+id<MTLLibrary> MVKShaderLibrary::getMTLLibrary() {
+	lock_guard<mutex> lock(_mtlLibraryLock);
 
-	slc->destroy();
+	if ( !_isCompiled ) {
+		MVKShaderLibraryCompiler* slc = new MVKShaderLibraryCompiler(_owner);
 
-	_shaderConversionResults = shaderConversionResults;
-	_msl = mslSourceCode;
+		NSString* nsSrc = [[NSString alloc] initWithUTF8String: _msl.c_str()];	// temp retained
+		_mtlLibrary = slc->newMTLLibrary(nsSrc);	// retained
+		[nsSrc release];	// release temp string
+
+		slc->destroy();
+		_isCompiled = true;
+	}
+	return _mtlLibrary;
 }
 
 MVKShaderLibrary::MVKShaderLibrary(MVKVulkanAPIDeviceObject* owner,
@@ -170,6 +277,7 @@ MVKShaderLibrary::MVKShaderLibrary(MVKVulkanAPIDeviceObject* owner,
                                                         DISPATCH_DATA_DESTRUCTOR_DEFAULT);
         NSError* err = nil;
         _mtlLibrary = [mvkDev->getMTLDevice() newLibraryWithData: shdrData error: &err];    // retained
+        _isCompiled = true;
         handleCompilationError(err, "Compiled shader module creation");
         [shdrData release];
     }
@@ -177,9 +285,13 @@ MVKShaderLibrary::MVKShaderLibrary(MVKVulkanAPIDeviceObject* owner,
 }
 
 MVKShaderLibrary::MVKShaderLibrary(const MVKShaderLibrary& other) : _owner(other._owner) {
+	lock_guard<mutex> lock(const_cast<MVKShaderLibrary&>(other)._mtlLibraryLock);
 	_mtlLibrary = [other._mtlLibrary retain];
+	_isCompiled = other._isCompiled;
 	_shaderConversionResults = other._shaderConversionResults;
 	_msl = other._msl;
+	_serializedEntry = other._serializedEntry;
+	_serializedEntryHash = other._serializedEntryHash;
 }
 
 // If err object is nil, the compilation succeeded without any warnings.
@@ -200,6 +312,7 @@ void MVKShaderLibrary::handleCompilationError(NSError* err, const char* opDesc)
 
 MVKShaderLibrary::~MVKShaderLibrary() {
 	[_mtlLibrary release];
+	for (auto& mfPair : _mtlFunctions) { [mfPair.second release]; }
 }
 
 
@@ -210,11 +323,26 @@ MVKShaderLibrary* MVKShaderLibraryCache::getShaderLibrary(SPIRVToMSLConversionCo
 														  MVKShaderModule* shaderModule,
 														  bool* pWasAdded) {
 	bool wasAdded = false;
-	MVKShaderLibrary* shLib = findShaderLibrary(pContext);
+	MVKShaderLibrary* shLib;
+	{
+		MVKSharedLock lock(_accessLock);
+		shLib = findShaderLibrary(pContext);
+	}
 	if ( !shLib ) {
-		if (shaderModule->convert(pContext)) {
-			shLib = addShaderLibrary(pContext, shaderModule->getMSL(), shaderModule->getConversionResults());
-			wasAdded = true;
+		// Convert and compile without holding the lock, so lookups by other threads are not blocked.
+		// Another thread may have added a matching library in the meantime, in which case use that one.
+		string mslSourceCode;
+		SPIRVToMSLConversionResults shaderConversionResults;
+		if (shaderModule->convert(pContext, mslSourceCode, shaderConversionResults)) {
+			MVKShaderLibrary* newLib = new MVKShaderLibrary(_owner, mslSourceCode, shaderConversionResults);
+			lock_guard<MVKSharedMutex> lock(_accessLock);
+			shLib = findShaderLibrary(pContext);
+			if (shLib) {
+				newLib->destroy();
+			} else {
+				shLib = addShaderLibrary(pContext, newLib);
+				wasAdded = true;
+			}
 		}
 	}
 
@@ -225,8 +353,17 @@ MVKShaderLibrary* MVKShaderLibraryCache::getShaderLibrary(SPIRVToMSLConversionCo
 
 // Finds and returns a shader library matching the specified context, or returns nullptr if it doesn't exist.
 // If a match is found, the specified context is aligned with the context of the matching library.
+// Only libraries with matching options, and whose used bindings might all be found in the context,
+// are compared in full.
 MVKShaderLibrary* MVKShaderLibraryCache::findShaderLibrary(SPIRVToMSLConversionConfiguration* pContext) {
-	for (auto& slPair : _shaderLibraries) {
+	auto iter = _shaderLibraryIndexesByOptions.find(pContext->options.hash());
+	if (iter == _shaderLibraryIndexesByOptions.end()) { return nullptr; }
+
+	uint64_t ctxBindingSig = pContext->getBindingSignature(false);
+	for (auto& slIdx : iter->second) {
+		if ((slIdx.usedBindingSignature & ~ctxBindingSig) != 0) { continue; }
+
+		auto& slPair = _shaderLibraries[slIdx.shaderLibraryIndex];
 		if (slPair.first.matches(*pContext)) {
 			pContext->alignWith(slPair.first);
 			return slPair.second;
@@ -239,21 +376,73 @@ MVKShaderLibrary* MVKShaderLibraryCache::findShaderLibrary(SPIRVToMSLConversionC
 MVKShaderLibrary* MVKShaderLibraryCache::addShaderLibrary(SPIRVToMSLConversionConfiguration* pContext,
 														  const string& mslSourceCode,
 														  const SPIRVToMSLConversionResults& shaderConversionResults) {
-	MVKShaderLibrary* shLib = new MVKShaderLibrary(_owner, mslSourceCode, shaderConversionResults);
+	return addShaderLibrary(pContext, new MVKShaderLibrary(_owner, mslSourceCode, shaderConversionResults));
+}
+
+// Adds and returns the specified shader library, configured from the specified context.
+// The caller must hold the lock exclusively, if this cache can be accessed by multiple threads.
+// If this cache is held by a pipeline cache, the pipeline cache serializes the shader library.
+MVKShaderLibrary* MVKShaderLibraryCache::addShaderLibrary(SPIRVToMSLConversionConfiguration* pContext,
+														  MVKShaderLibrary* shLib) {
 	_shaderLibraries.emplace_back(*pContext, shLib);
+	addShaderLibraryIndex(*pContext);
+	if (_pipelineCache) {
+		_pipelineCache->addShaderLibraryEntry(*pContext, shLib);
+		_shaderLibrariesBySerializedEntryHash.emplace(shLib->_serializedEntryHash, shLib);
+	}
 	return shLib;
 }
 
+// Indexes the most recently added shader library, by the hash of its options and the signature of its used bindings.
+void MVKShaderLibraryCache::addShaderLibraryIndex(const SPIRVToMSLConversionConfiguration& shaderContext) {
+	MVKShaderLibraryIndex slIdx;
+	slIdx.usedBindingSignature = shaderContext.getBindingSignature(true);
+	slIdx.shaderLibraryIndex = (uint32_t)_shaderLibraries.size() - 1;
+	_shaderLibraryIndexesByOptions[shaderContext.options.hash()].push_back(slIdx);
+}
+
 // Merge another shader library cache with this one. Handle null input.
 void MVKShaderLibraryCache::merge(MVKShaderLibraryCache* other) {
-	if ( !other ) { return; }
+	if ( !other || other == this ) { return; }
+
+	// Acquire the two locks in a consistent (address) order, so that two caches
+	// being merged into each other concurrently from different threads cannot deadlock.
+	bool isThisLockFirst = less<MVKSharedMutex*>()(&_accessLock, &other->_accessLock);
+	if (isThisLockFirst) { _accessLock.lock(); }
+	other->_accessLock.lock_shared();
+	if ( !isThisLockFirst ) { _accessLock.lock(); }
+
 	for (auto& otherPair : other->_shaderLibraries) {
-		if ( !findShaderLibrary(&otherPair.first) ) {
-			_shaderLibraries.emplace_back(otherPair.first, new MVKShaderLibrary(*otherPair.second));
+		// Libraries serialized identically to one already in this cache are duplicates, and can
+		// be skipped without comparing conversion configurations. This is common when merging
+		// pipeline caches that were populated in parallel from the same shaders.
+		MVKShaderLibrary* otherLib = otherPair.second;
+		if (isSerializedDuplicate(otherLib)) { continue; }
+
+		// Match against a copy, because matching aligns the configuration with the one it matches,
+		// and the other cache is only held shared, and must not be modified.
+		SPIRVToMSLConversionConfiguration otherConfig = otherPair.first;
+		if ( !findShaderLibrary(&otherConfig) ) {
+			addShaderLibrary(&otherConfig, new MVKShaderLibrary(*otherLib));
 		}
 	}
+
+	_accessLock.unlock();
+	other->_accessLock.unlock_shared();
 }
 
+// Returns whether this cache contains a shader library whose pipeline cache entry is identical to that of the specified library.
+bool MVKShaderLibraryCache::isSerializedDuplicate(MVKShaderLibrary* shLib) {
+	if (shLib->_serializedEntry.empty()) { return false; }
+
+	auto iter = _shaderLibrariesBySerializedEntryHash.find(shLib->_serializedEntryHash);
+	return (iter != _shaderLibrariesBySerializedEntryHash.end() &&
+			iter->second->_serializedEntry == shLib->_serializedEntry);
+}
+
+MVKShaderLibraryCache::MVKShaderLibraryCache(MVKPipelineCache* pipelineCache) :
+	_owner(pipelineCache), _pipelineCache(pipelineCache) {}
+
 MVKShaderLibraryCache::~MVKShaderLibraryCache() {
 	for (auto& slPair : _shaderLibraries) { slPair.second->destroy(); }
 }
@@ -262,32 +451,99 @@ MVKShaderLibraryCache::~MVKShaderLibraryCache() {
 #pragma mark -
 #pragma mark MVKShaderModule
 
+// Returns a name for the shader stage identified by the SPIR-V execution model.
+static const char* mvkGetExecutionModelName(spv::ExecutionModel model) {
+	switch (model) {
+		case spv::ExecutionModelVertex:					return "vertex";
+		case spv::ExecutionModelTessellationControl:	return "tessellation control";
+		case spv::ExecutionModelTessellationEvaluation:	return "tessellation evaluation";
+		case spv::ExecutionModelGeometry:				return "geometry";
+		case spv::ExecutionModelFragment:				return "fragment";
+		case spv::ExecutionModelGLCompute:				return "compute";
+		default:										return "unknown";
+	}
+}
+
 MVKMTLFunction MVKShaderModule::getMTLFunction(SPIRVToMSLConversionConfiguration* pContext,
 											   const VkSpecializationInfo* pSpecializationInfo,
-											   MVKPipelineCache* pipelineCache) {
-	lock_guard<mutex> lock(_accessLock);
-	
+											   MVKPipelineCache* pipelineCache,
+											   MVKShaderStageCompileRecord* pCompileRecord,
+											   MVKShaderLibrary** ppShaderLibrary,
+											   uint32_t tunedWorkgroupWidth) {
+	if (ppShaderLibrary) { *ppShaderLibrary = nullptr; }
+	if ( !_device->isReportingSlowCompiles() ) { pCompileRecord = nullptr; }
+	if (pCompileRecord) {
+		pCompileRecord->shaderModuleHash = _key.codeHash;
+		pCompileRecord->configHash = pContext->options.hash();
+		pCompileRecord->stage = mvkGetExecutionModelName(pContext->options.entryPointStage);
+		pCompileRecord->entryPoint = pContext->options.entryPointName;
+	}
+
+	// A library set directly from MSL is modified for each use, so access to it must be serialized.
 	MVKShaderLibrary* mvkLib = _directMSLLibrary;
-	if ( !mvkLib ) {
-		uint64_t startTime = _device->getPerformanceTimestamp();
-		if (pipelineCache) {
-			mvkLib = pipelineCache->getShaderLibrary(pContext, this);
-		} else {
-			mvkLib = _shaderLibraryCache.getShaderLibrary(pContext, this);
-		}
-		_device->addActivityPerformance(_device->_performanceStatistics.shaderCompilation.shaderLibraryFromCache, startTime);
-	} else {
+	if (mvkLib) {
+		lock_guard<mutex> lock(_accessLock);
 		mvkLib->setEntryPointName(pContext->options.entryPointName);
 		pContext->markAllAttributesAndResourcesUsed();
+		uint64_t startTime = pCompileRecord ? mvkGetTimestamp() : 0;
+		MVKMTLFunction mvkMTLFunc = mvkLib->getMTLFunction(pSpecializationInfo, this, tunedWorkgroupWidth);
+		if (pCompileRecord) { pCompileRecord->functionSpecialization = mvkGetElapsedMilliseconds(startTime); }
+		return mvkMTLFunc;
+	}
+
+	// Shader library caches manage their own locking, and lock this module only while converting.
+	uint64_t startTime = _device->getPerformanceTimestamp();
+	uint64_t phaseStartTime = pCompileRecord ? mvkGetTimestamp() : 0;
+	if (pipelineCache) {
+		mvkLib = pipelineCache->getShaderLibrary(pContext, this);
+		if (ppShaderLibrary) { *ppShaderLibrary = mvkLib; }
+	} else {
+		mvkLib = _shaderLibraryCache.getShaderLibrary(pContext, this);
 	}
+	_device->addActivityPerformance(_device->_performanceStatistics.shaderCompilation.shaderLibraryFromCache, startTime);
+
+	if ( !mvkLib ) { return MVKMTLFunctionNull; }
+	if ( !pCompileRecord ) { return mvkLib->getMTLFunction(pSpecializationInfo, this, tunedWorkgroupWidth); }
+
+	// Compile the library before retrieving the function, so the phases can be timed separately.
+	pCompileRecord->spirvToMSL = mvkGetElapsedMilliseconds(phaseStartTime);
+	phaseStartTime = mvkGetTimestamp();
+	mvkLib->getMTLLibrary();
+	pCompileRecord->mslCompile = mvkGetElapsedMilliseconds(phaseStartTime);
+	phaseStartTime = mvkGetTimestamp();
+	MVKMTLFunction mvkMTLFunc = mvkLib->getMTLFunction(pSpecializationInfo, this, tunedWorkgroupWidth);
+	pCompileRecord->functionSpecialization = mvkGetElapsedMilliseconds(phaseStartTime);
+	return mvkMTLFunc;
+}
+
+bool MVKShaderModule::convert(SPIRVToMSLConversionConfiguration* pContext,
+							  string& mslSourceCode,
+							  SPIRVToMSLConversionResults& shaderConversionResults) {
+	lock_guard<mutex> lock(_accessLock);
 
-	return mvkLib ? mvkLib->getMTLFunction(pSpecializationInfo, this) : MVKMTLFunctionNull;
+	if ( !convert(pContext) ) { return false; }
+
+	mslSourceCode = getMSL();
+	shaderConversionResults = getConversionResults();
+	return true;
 }
 
 bool MVKShaderModule::convert(SPIRVToMSLConversionConfiguration* pContext) {
 	bool shouldLogCode = _device->_pMVKConfig->debugMode;
 	bool shouldLogEstimatedGLSL = shouldLogCode;
 
+	// If this shader code has already been converted with the same conversion configuration,
+	// possibly by another device or a prior run of the app, retrieve it from the shader disk cache.
+	MVKShaderDiskCache* shaderDiskCache = MVKShaderDiskCache::getShaderDiskCache();
+	if (shaderDiskCache) {
+		string mslSourceCode;
+		SPIRVToMSLConversionResults shaderConversionResults;
+		if (shaderDiskCache->getShaderConversion(_key, pContext, mslSourceCode, shaderConversionResults)) {
+			_spvConverter.setMSL(mslSourceCode, &shaderConversionResults);
+			return true;
+		}
+	}
+
 	// If the SPIR-V converter does not have any code, but the GLSL converter does,
 	// convert the GLSL code to SPIR-V and set it into the SPIR-V conveter.
 	if ( !_spvConverter.hasSPIRV() && _glslConverter.hasGLSL() ) {
@@ -311,12 +567,33 @@ bool MVKShaderModule::convert(SPIRVToMSLConversionConfiguration* pContext) {
 
 	if (wasConverted) {
 		if (shouldLogCode) { MVKLogInfo("%s", _spvConverter.getResultLog().c_str()); }
+		if (shaderDiskCache) { shaderDiskCache->addShaderConversion(_key, *pContext, getMSL(), getConversionResults()); }
 	} else {
 		reportError(VK_ERROR_INVALID_SHADER_NV, "Unable to convert SPIR-V to MSL:\n%s", _spvConverter.getResultLog().c_str());
 	}
 	return wasConverted;
 }
 
+const SPIRVEntryPointReflectionData* MVKShaderModule::getReflectionData(spv::ExecutionModel model,
+																		const string& entryName,
+																		string& errorLog) {
+	lock_guard<mutex> lock(_reflectionLock);
+
+	auto key = make_pair(model, entryName);
+	auto iter = _reflectionData.find(key);
+	if (iter != _reflectionData.end()) { return &iter->second; }
+
+	// Reflect from the IR retained by the SPIR-V converter, which is shared with conversions to MSL.
+	SPIRVEntryPointReflectionData reflectData;
+	{
+		lock_guard<mutex> convLock(_accessLock);
+		if ( !_spvConverter.getEntryPointReflectionData(model, entryName, reflectData, errorLog) ) { return nullptr; }
+	}
+
+	// Map entries are never moved, so the returned reference remains valid as other entries are added.
+	return &_reflectionData.emplace(key, move(reflectData)).first->second;
+}
+
 // Returns the MVKGLSLConversionShaderStage corresponding to the shader stage in the SPIR-V converter context.
 MVKGLSLConversionShaderStage MVKShaderModule::getMVKGLSLConversionShaderStage(SPIRVToMSLConversionConfiguration* pContext) {
 	switch (pContext->options.entryPointStage) {
@@ -409,6 +686,7 @@ MVKShaderModule::MVKShaderModule(MVKDevice* device,
 				codeHash = mvkHash(pGLSL, codeSize);
 				_device->addActivityPerformance(_device->_performanceStatistics.shaderCompilation.hashShaderCode, startTime);
 
+				GLSLToSPIRVConverter::initializeProcess();
 				_glslConverter.setGLSL(pGLSL, glslLen);
 			} else {
 				setConfigurationResult(reportError(VK_ERROR_INVALID_SHADER_NV, "vkCreateShaderModule(): The SPIR-V contains an invalid magic number %x.", magicNum));
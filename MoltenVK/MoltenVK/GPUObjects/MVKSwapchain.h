@@ -26,9 +26,14 @@
 #import <Metal/Metal.h>
 
 class MVKWatermark;
+class MVKPerformanceHUD;
+class MVKSwapchainUpscaler;
 
 @class MVKBlockObserver;
 
+/** The maximum number of past presentations whose timing is retained for VK_GOOGLE_display_timing. */
+static const uint32_t kMVKMaxPresentationHistory = 60;
+
 
 #pragma mark -
 #pragma mark MVKSwapchain
@@ -87,9 +92,28 @@ public:
 		return VK_SUCCESS;
 	}
 
+	/**
+	 * Returns whether this swapchain uses VK_PRESENT_MODE_MAILBOX_KHR, where an image queued for
+	 * presentation is dropped, instead of being displayed, if a newer image is queued before it.
+	 */
+	inline bool isMailbox() { return _presentMode == VK_PRESENT_MODE_MAILBOX_KHR; }
+
 	/** Adds HDR metadata to this swapchain. */
 	void setHDRMetadataEXT(const VkHdrMetadataEXT& metadata);
 
+	/** VK_GOOGLE_display_timing - returns the duration of the refresh cycle of the display. */
+	VkResult getRefreshCycleDuration(VkRefreshCycleDurationGOOGLE* pRefreshCycleDuration);
+
+	/**
+	 * VK_GOOGLE_display_timing - returns the timing of past presentations that have been displayed
+	 * and not yet returned by this function. Returned presentations are removed from this swapchain.
+	 *
+	 * If pPresentationTimings is null, the value of pCount is updated with the number of
+	 * presentations available. Returns VK_INCOMPLETE if more presentations are available
+	 * than the pCount value.
+	 */
+	VkResult getPastPresentationTiming(uint32_t* pCount, VkPastPresentationTimingGOOGLE* pPresentationTimings);
+
 
 #pragma mark Construction
 	
@@ -105,18 +129,33 @@ protected:
 	void initSurfaceImages(const VkSwapchainCreateInfoKHR* pCreateInfo, uint32_t imgCnt);
 	void releaseUndisplayedSurfaces();
 	uint64_t getNextAcquisitionID();
-    void willPresentSurface(id<MTLTexture> mtlTexture, id<MTLCommandBuffer> mtlCmdBuff);
+	void presentLatestCAMetalDrawable(id<CAMetalDrawable> mtlDrawable, id<MTLCommandBuffer> mtlCmdBuff, uint64_t desiredPresentTime);
+    void willPresentSurface(id<MTLTexture> mtlTexture, id<MTLCommandBuffer> mtlCmdBuff, VkExtent2D renderExtent);
+	void upscaleRenderExtent(id<MTLTexture> mtlTexture, id<MTLCommandBuffer> mtlCmdBuff, VkExtent2D renderExtent);
     void renderWatermark(id<MTLTexture> mtlTexture, id<MTLCommandBuffer> mtlCmdBuff);
+	void renderPerformanceHUD(id<MTLTexture> mtlTexture, id<MTLCommandBuffer> mtlCmdBuff);
     void markFrameInterval();
+	void trackPresentationTiming(id<CAMetalDrawable> mtlDrawable, const MVKImagePresentInfo& presentInfo);
+	void recordPresentationTiming(const MVKImagePresentInfo& presentInfo, uint64_t actualPresentTime);
+	inline dispatch_queue_t getDrawablePrefetchQueue() { return _drawablePrefetchQueue; }
 
 	CAMetalLayer* _mtlLayer;
     MVKWatermark* _licenseWatermark;
+	MVKPerformanceHUD* _performanceHUD;
+	MVKSwapchainUpscaler* _upscaler;
 	MVKVectorInline<MVKPresentableSwapchainImage*, kMVKMaxSwapchainImageCount> _presentableImages;
 	std::atomic<uint64_t> _currentAcquisitionID;
+	std::atomic<uint64_t> _latestPresentID;
+	VkPresentModeKHR _presentMode;
     CGSize _mtlLayerOrigDrawSize;
     uint64_t _lastFrameTime;
     uint32_t _currentPerfLogFrameCount;
     std::atomic<bool> _surfaceLost;
     MVKBlockObserver* _layerObserver;
+	dispatch_queue_t _drawablePrefetchQueue;
+	VkPastPresentationTimingGOOGLE _presentTimingHistory[kMVKMaxPresentationHistory];
+	uint32_t _presentHistoryCount;
+	uint32_t _presentHistoryIndex;
+	std::mutex _presentHistoryLock;
 };
 
@@ -32,6 +32,13 @@
 
 #include <libkern/OSByteOrder.h>
 
+#if MVK_IOS
+#	import <UIKit/UIScreen.h>
+#endif
+#if MVK_MACOS
+#	import <CoreGraphics/CGDisplayConfiguration.h>
+#endif
+
 using namespace std;
 
 
@@ -103,6 +110,27 @@ VkResult MVKSwapchain::acquireNextImageKHR(uint64_t timeout,
 
 uint64_t MVKSwapchain::getNextAcquisitionID() { return ++_currentAcquisitionID; }
 
+// In mailbox mode, the drawable is presented once its rendering is complete, unless a newer drawable has been
+// queued for presentation by then. A dropped drawable is released back to the CAMetalLayer without being
+// displayed, so the newest image is displayed at the next vertical sync, and acquisition is not held up
+// waiting for superseded images to be displayed.
+void MVKSwapchain::presentLatestCAMetalDrawable(id<CAMetalDrawable> mtlDrawable,
+												id<MTLCommandBuffer> mtlCmdBuff,
+												uint64_t desiredPresentTime) {
+	uint64_t presentID = ++_latestPresentID;
+	retain();	// Ensure this swapchain is not destroyed while awaiting MTLCommandBuffer completion
+	[mtlCmdBuff addCompletedHandler: ^(id<MTLCommandBuffer> mcb) {
+		if (presentID == _latestPresentID) {
+			if (desiredPresentTime) {
+				[mtlDrawable presentAtTime: (double)desiredPresentTime * 1.0e-9];
+			} else {
+				[mtlDrawable present];
+			}
+		}
+		release();
+	}];
+}
+
 // Releases any surfaces that are not currently being displayed,
 // so they can be used by a different swapchain.
 void MVKSwapchain::releaseUndisplayedSurfaces() {}
@@ -111,10 +139,21 @@ void MVKSwapchain::releaseUndisplayedSurfaces() {}
 #pragma mark Rendering
 
 // Called automatically when a swapchain image is about to be presented to the surface by the queue.
-// Activities include marking the frame interval and rendering the watermark if needed.
-void MVKSwapchain::willPresentSurface(id<MTLTexture> mtlTexture, id<MTLCommandBuffer> mtlCmdBuff) {
+// Activities include marking the frame interval, upscaling the region of the image rendered by
+// the app, and rendering the watermark if needed. Overlays are rendered after upscaling, at full size.
+void MVKSwapchain::willPresentSurface(id<MTLTexture> mtlTexture, id<MTLCommandBuffer> mtlCmdBuff, VkExtent2D renderExtent) {
     markFrameInterval();
+	upscaleRenderExtent(mtlTexture, mtlCmdBuff, renderExtent);
     renderWatermark(mtlTexture, mtlCmdBuff);
+	renderPerformanceHUD(mtlTexture, mtlCmdBuff);
+}
+
+// If the app rendered only part of the image, and upscaling is enabled,
+// upscales the rendered region to cover the entire image.
+void MVKSwapchain::upscaleRenderExtent(id<MTLTexture> mtlTexture, id<MTLCommandBuffer> mtlCmdBuff, VkExtent2D renderExtent) {
+	if (renderExtent.width == 0 || renderExtent.height == 0 || !_upscaler) { return; }
+
+	_upscaler->render(mtlTexture, mtlCmdBuff, renderExtent);
 }
 
 // If the product has not been fully licensed, renders the watermark image to the surface.
@@ -138,6 +177,26 @@ void MVKSwapchain::renderWatermark(id<MTLTexture> mtlTexture, id<MTLCommandBuffe
     }
 }
 
+// If enabled, renders the performance HUD to the surface, reusing the watermark rendering.
+void MVKSwapchain::renderPerformanceHUD(id<MTLTexture> mtlTexture, id<MTLCommandBuffer> mtlCmdBuff) {
+	if (_device->shouldDisplayPerformanceHUD()) {
+		if ( !_performanceHUD ) { _performanceHUD = new MVKPerformanceHUD(getMTLDevice(), __watermarkShaderSource); }
+
+		// Read consistent snapshots, because the statistics are updated by other threads.
+		MVKPerformanceStatistics perfStats;
+		MVKResourceStatistics rezStats;
+		_device->getPerformanceStatistics(&perfStats);
+		_device->getResourceStatistics(&rezStats);
+		_performanceHUD->addFrame(perfStats, rezStats);
+		_performanceHUD->render(mtlTexture, mtlCmdBuff, 0.0);
+	} else {
+		if (_performanceHUD) {
+			_performanceHUD->destroy();
+			_performanceHUD = nullptr;
+		}
+	}
+}
+
 // Calculates and remembers the time interval between frames.
 void MVKSwapchain::markFrameInterval() {
 	if ( !(_device->_pMVKConfig->performanceTracking || _licenseWatermark) ) { return; }
@@ -160,6 +219,81 @@ void MVKSwapchain::markFrameInterval() {
 	}
 }
 
+
+#pragma mark Display timing
+
+VkResult MVKSwapchain::getRefreshCycleDuration(VkRefreshCycleDurationGOOGLE* pRefreshCycleDuration) {
+	double framesPerSecond = 0;
+#if MVK_IOS
+	UIScreen* screen = [UIScreen mainScreen];
+	if ([screen respondsToSelector: @selector(maximumFramesPerSecond)]) { framesPerSecond = screen.maximumFramesPerSecond; }
+#endif
+#if MVK_MACOS
+	CGDisplayModeRef dispMode = CGDisplayCopyDisplayMode(CGMainDisplayID());
+	if (dispMode) {
+		framesPerSecond = CGDisplayModeGetRefreshRate(dispMode);
+		CGDisplayModeRelease(dispMode);
+	}
+#endif
+	// Some displays, such as built-in laptop displays, do not report a refresh rate.
+	if (framesPerSecond <= 0) { framesPerSecond = 60.0; }
+
+	pRefreshCycleDuration->refreshDuration = (uint64_t)(1.0e9 / framesPerSecond);
+	return VK_SUCCESS;
+}
+
+VkResult MVKSwapchain::getPastPresentationTiming(uint32_t* pCount, VkPastPresentationTimingGOOGLE* pPresentationTimings) {
+	lock_guard<mutex> lock(_presentHistoryLock);
+
+	if ( !pPresentationTimings ) {
+		*pCount = _presentHistoryCount;
+		return VK_SUCCESS;
+	}
+
+	// Return the oldest presentations first, and remove the returned presentations from the history.
+	uint32_t histCnt = _presentHistoryCount;
+	uint32_t cnt = min(*pCount, histCnt);
+	uint32_t oldestIdx = (_presentHistoryIndex + kMVKMaxPresentationHistory - histCnt) % kMVKMaxPresentationHistory;
+	for (uint32_t i = 0; i < cnt; i++) {
+		pPresentationTimings[i] = _presentTimingHistory[(oldestIdx + i) % kMVKMaxPresentationHistory];
+	}
+	_presentHistoryCount -= cnt;
+	*pCount = cnt;
+
+	return (cnt < histCnt) ? VK_INCOMPLETE : VK_SUCCESS;
+}
+
+// Records the time the drawable is actually displayed, if the OS supports reporting it.
+void MVKSwapchain::trackPresentationTiming(id<CAMetalDrawable> mtlDrawable, const MVKImagePresentInfo& presentInfo) {
+	if ( ![mtlDrawable respondsToSelector: @selector(addPresentedHandler:)] ) { return; }
+
+	MVKImagePresentInfo pi = presentInfo;
+	retain();	// Ensure this swapchain is not destroyed while awaiting presentation
+	[mtlDrawable addPresentedHandler: ^(id<MTLDrawable> drawable) {
+		// A drawable that was dropped without being displayed has no presented time.
+		CFTimeInterval presentedTime = drawable.presentedTime;
+		if (presentedTime > 0) { recordPresentationTiming(pi, (uint64_t)(presentedTime * 1.0e9)); }
+		release();
+	}];
+}
+
+// Core Animation does not report when the image could have been displayed, or how early it
+// was submitted, so the earliest present time is the actual present time, with no margin.
+void MVKSwapchain::recordPresentationTiming(const MVKImagePresentInfo& presentInfo, uint64_t actualPresentTime) {
+	lock_guard<mutex> lock(_presentHistoryLock);
+
+	VkPastPresentationTimingGOOGLE& timing = _presentTimingHistory[_presentHistoryIndex];
+	timing.presentID = presentInfo.presentID;
+	timing.desiredPresentTime = presentInfo.desiredPresentTime;
+	timing.actualPresentTime = actualPresentTime;
+	timing.earliestPresentTime = actualPresentTime;
+	timing.presentMargin = 0;
+
+	// Once the history is full, the oldest presentation is overwritten.
+	_presentHistoryIndex = (_presentHistoryIndex + 1) % kMVKMaxPresentationHistory;
+	_presentHistoryCount = min(_presentHistoryCount + 1, kMVKMaxPresentationHistory);
+}
+
 #if MVK_MACOS
 struct CIE1931XY {
 	uint16_t x;
@@ -232,20 +366,43 @@ MVKSwapchain::MVKSwapchain(MVKDevice* device,
 	MVKVulkanAPIDeviceObject(device),
 	_surfaceLost(false),
 	_currentAcquisitionID(0),
+	_latestPresentID(0),
+	_presentMode(pCreateInfo->presentMode),
 	_layerObserver(nil),
 	_currentPerfLogFrameCount(0),
 	_lastFrameTime(0),
-	_licenseWatermark(nil) {
+	_licenseWatermark(nil),
+	_performanceHUD(nullptr),
+	_upscaler(nullptr),
+	_drawablePrefetchQueue(nullptr),
+	_presentHistoryCount(0),
+	_presentHistoryIndex(0) {
 
 	// If applicable, release any surfaces (not currently being displayed) from the old swapchain.
 	MVKSwapchain* oldSwapchain = (MVKSwapchain*)pCreateInfo->oldSwapchain;
 	if (oldSwapchain) { oldSwapchain->releaseUndisplayedSurfaces(); }
 
-	uint32_t imgCnt = mvkClamp(pCreateInfo->minImageCount,
-							   _device->_pMetalFeatures->minSwapchainImageCount,
-							   _device->_pMetalFeatures->maxSwapchainImageCount);
+	// The image count sets the number of drawables the CAMetalLayer can provide, trading latency for throughput.
+	// Mailbox presentation needs a drawable to render to while one is displayed and another is queued.
+	uint32_t imgCnt = pCreateInfo->minImageCount;
+	if (isMailbox()) { imgCnt = max(imgCnt, 3U); }
+	imgCnt = mvkClamp(imgCnt,
+					  _device->_pMetalFeatures->minSwapchainImageCount,
+					  _device->_pMetalFeatures->maxSwapchainImageCount);
 	initCAMetalLayer(pCreateInfo, imgCnt);
     initSurfaceImages(pCreateInfo, imgCnt);		// After initCAMetalLayer()
+
+	// Drawables are prefetched in the order their images are acquired, at the priority of presentation.
+	if (_device->shouldPrefetchDrawables()) {
+		dispatch_queue_attr_t dqAttr = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_USER_INTERACTIVE, 0);
+		_drawablePrefetchQueue = dispatch_queue_create("MoltenVKDrawablePrefetchQueue", dqAttr);		// retained
+	}
+
+	// The upscaler compiles its shaders here, so presentation is not delayed by compilation.
+	MVKSwapchainUpscaleFilter upscaleFilter = (MVKSwapchainUpscaleFilter)_device->getSwapchainUpscaleFilter();
+	if (upscaleFilter != kMVKSwapchainUpscaleFilterNone && !_surfaceLost) {
+		_upscaler = new MVKSwapchainUpscaler(getMTLDevice(), upscaleFilter, __swapchainUpscaleShaderSource);
+	}
 }
 
 // Initializes the CAMetalLayer underlying the surface of this swapchain.
@@ -258,16 +415,21 @@ void MVKSwapchain::initCAMetalLayer(const VkSwapchainCreateInfoKHR* pCreateInfo,
 		return;
 	}
 
+	// The CAMetalLayer is owned by the surface, and is reconfigured, rather than replaced, each time a swapchain
+	// is created on the surface, so a swapchain recreated with a new present mode or image count takes effect
+	// without disturbing the view. Only the immediate present mode disables vertical sync.
 	_mtlLayer = mvkSrfc->getCAMetalLayer();
 	_mtlLayer.device = getMTLDevice();
 	_mtlLayer.pixelFormat = getPixelFormats()->getMTLPixelFormat(pCreateInfo->imageFormat);
 	_mtlLayer.maximumDrawableCountMVK = imgCnt;
 	_mtlLayer.displaySyncEnabledMVK = (pCreateInfo->presentMode != VK_PRESENT_MODE_IMMEDIATE_KHR);
 	_mtlLayer.magnificationFilter = _device->_pMVKConfig->swapchainMagFilterUseNearest ? kCAFilterNearest : kCAFilterLinear;
-	_mtlLayer.framebufferOnly = !mvkIsAnyFlagEnabled(pCreateInfo->imageUsage, (VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
-																			   VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-																			   VK_IMAGE_USAGE_SAMPLED_BIT |
-																			   VK_IMAGE_USAGE_STORAGE_BIT));
+	// Upscaling copies the region rendered by the app out of the drawable texture.
+	_mtlLayer.framebufferOnly = (_device->getSwapchainUpscaleFilter() == kMVKSwapchainUpscaleFilterNone &&
+								 !mvkIsAnyFlagEnabled(pCreateInfo->imageUsage, (VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+																				VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+																				VK_IMAGE_USAGE_SAMPLED_BIT |
+																				VK_IMAGE_USAGE_STORAGE_BIT)));
 	if (pCreateInfo->compositeAlpha != VK_COMPOSITE_ALPHA_INHERIT_BIT_KHR) {
 		_mtlLayer.opaque = pCreateInfo->compositeAlpha == VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	}
@@ -375,9 +537,17 @@ void MVKSwapchain::initSurfaceImages(const VkSwapchainCreateInfoKHR* pCreateInfo
 }
 
 MVKSwapchain::~MVKSwapchain() {
+	// Wait for any drawable prefetches, which access the CAMetalLayer, to finish.
+	if (_drawablePrefetchQueue) {
+		dispatch_sync(_drawablePrefetchQueue, ^{});
+		dispatch_release(_drawablePrefetchQueue);
+	}
+
 	for (auto& img : _presentableImages) { _device->destroyPresentableSwapchainImage(img, NULL); }
 
     if (_licenseWatermark) { _licenseWatermark->destroy(); }
+	if (_performanceHUD) { _performanceHUD->destroy(); }
+	if (_upscaler) { _upscaler->destroy(); }
     [this->_layerObserver release];
 }
 
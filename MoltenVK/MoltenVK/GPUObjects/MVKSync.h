@@ -22,11 +22,64 @@
 #include <atomic>
 #include <mutex>
 #include <condition_variable>
-#include <unordered_set>
+#include "MVKVector.h"
+#include <pthread.h>
 
 class MVKFenceSitter;
 
 
+#pragma mark -
+#pragma mark MVKSharedMutex
+
+/**
+ * A mutex that can be held either exclusively by a single writer, or shared by any number of readers.
+ *
+ * This class satisfies the requirements of std::lock_guard and std::unique_lock, which hold
+ * it exclusively. Use MVKSharedLock to hold it shared for the duration of a scope.
+ */
+class MVKSharedMutex {
+
+public:
+
+	/** Acquires exclusive ownership, blocking while any other thread holds this mutex. */
+	void lock() { pthread_rwlock_wrlock(&_rwLock); }
+
+	/** Releases exclusive ownership. */
+	void unlock() { pthread_rwlock_unlock(&_rwLock); }
+
+	/** Acquires shared ownership, blocking only while another thread holds this mutex exclusively. */
+	void lock_shared() { pthread_rwlock_rdlock(&_rwLock); }
+
+	/** Releases shared ownership. */
+	void unlock_shared() { pthread_rwlock_unlock(&_rwLock); }
+
+	MVKSharedMutex() { pthread_rwlock_init(&_rwLock, nullptr); }
+
+	MVKSharedMutex(const MVKSharedMutex&) = delete;
+	MVKSharedMutex& operator=(const MVKSharedMutex&) = delete;
+
+	~MVKSharedMutex() { pthread_rwlock_destroy(&_rwLock); }
+
+protected:
+	pthread_rwlock_t _rwLock;
+};
+
+/** Holds shared ownership of a MVKSharedMutex for the duration of a scope. */
+class MVKSharedLock {
+
+public:
+	MVKSharedLock(MVKSharedMutex& mutex) : _mutex(mutex) { _mutex.lock_shared(); }
+
+	MVKSharedLock(const MVKSharedLock&) = delete;
+	MVKSharedLock& operator=(const MVKSharedLock&) = delete;
+
+	~MVKSharedLock() { _mutex.unlock_shared(); }
+
+protected:
+	MVKSharedMutex& _mutex;
+};
+
+
 #pragma mark -
 #pragma mark MVKSemaphoreImpl
 
@@ -120,8 +173,12 @@ public:
 	/** Returns the debug report object type of this object. */
 	VkDebugReportObjectTypeEXT getVkDebugReportObjectType() override { return VK_DEBUG_REPORT_OBJECT_TYPE_SEMAPHORE_EXT; }
 
+	/** Returns whether this is a binary or a timeline semaphore. */
+	virtual VkSemaphoreTypeKHR getSemaphoreType() { return VK_SEMAPHORE_TYPE_BINARY_KHR; }
+
 	/**
-	 * Wait for this semaphore to be signaled.
+	 * Wait for this semaphore to be signaled, or for a timeline semaphore, to reach the value.
+	 * Binary semaphores ignore the value.
 	 *
 	 * If the subclass uses command encoding AND the mtlCmdBuff is not nil, a wait
 	 * is encoded on the mtlCmdBuff, and this call returns immediately. Otherwise, if the
@@ -133,10 +190,11 @@ public:
 	 * subclass supports command encoding, and once without a mtlCmdBuff, at the point in the
 	 * code path where the code should block if the subclass does not support command encoding.
 	 */
-	virtual void encodeWait(id<MTLCommandBuffer> mtlCmdBuff) = 0;
+	virtual void encodeWait(id<MTLCommandBuffer> mtlCmdBuff, uint64_t value) = 0;
 
 	/**
-	 * Signals this semaphore.
+	 * Signals this semaphore, or for a timeline semaphore, sets it to the value.
+	 * Binary semaphores ignore the value.
 	 *
 	 * If the subclass uses command encoding AND the mtlCmdBuff is not nil, a signal is
 	 * encoded on the mtlCmdBuff. Otherwise, if the subclass does NOT use command encoding,
@@ -148,7 +206,7 @@ public:
 	 * subclass supports command encoding, and once without a mtlCmdBuff, at the point in the
 	 * code path where the code should block if the subclass does not support command encoding.
 	 */
-	virtual void encodeSignal(id<MTLCommandBuffer> mtlCmdBuff) = 0;
+	virtual void encodeSignal(id<MTLCommandBuffer> mtlCmdBuff, uint64_t value) = 0;
 
 	/** Returns whether this semaphore uses command encoding. */
 	virtual bool isUsingCommandEncoding() = 0;
@@ -171,8 +229,8 @@ protected:
 class MVKSemaphoreMTLFence : public MVKSemaphore {
 
 public:
-	void encodeWait(id<MTLCommandBuffer> mtlCmdBuff) override;
-	void encodeSignal(id<MTLCommandBuffer> mtlCmdBuff) override;
+	void encodeWait(id<MTLCommandBuffer> mtlCmdBuff, uint64_t value) override;
+	void encodeSignal(id<MTLCommandBuffer> mtlCmdBuff, uint64_t value) override;
 	bool isUsingCommandEncoding() override { return true; }
 
 	MVKSemaphoreMTLFence(MVKDevice* device, const VkSemaphoreCreateInfo* pCreateInfo);
@@ -191,8 +249,8 @@ protected:
 class MVKSemaphoreMTLEvent : public MVKSemaphore {
 
 public:
-	void encodeWait(id<MTLCommandBuffer> mtlCmdBuff) override;
-	void encodeSignal(id<MTLCommandBuffer> mtlCmdBuff) override;
+	void encodeWait(id<MTLCommandBuffer> mtlCmdBuff, uint64_t value) override;
+	void encodeSignal(id<MTLCommandBuffer> mtlCmdBuff, uint64_t value) override;
 	bool isUsingCommandEncoding() override { return true; }
 
 	MVKSemaphoreMTLEvent(MVKDevice* device, const VkSemaphoreCreateInfo* pCreateInfo);
@@ -212,8 +270,8 @@ protected:
 class MVKSemaphoreEmulated : public MVKSemaphore {
 
 public:
-	void encodeWait(id<MTLCommandBuffer> mtlCmdBuff) override;
-	void encodeSignal(id<MTLCommandBuffer> mtlCmdBuff) override;
+	void encodeWait(id<MTLCommandBuffer> mtlCmdBuff, uint64_t value) override;
+	void encodeSignal(id<MTLCommandBuffer> mtlCmdBuff, uint64_t value) override;
 	bool isUsingCommandEncoding() override { return false; }
 
 	MVKSemaphoreEmulated(MVKDevice* device, const VkSemaphoreCreateInfo* pCreateInfo);
@@ -223,6 +281,45 @@ protected:
 };
 
 
+#pragma mark -
+#pragma mark MVKTimelineSemaphore
+
+/**
+ * An MVKSemaphore that implements a Vulkan timeline semaphore on the counter value of a MTLSharedEvent.
+ * Queue submissions wait and signal on the GPU, and the host waits and signals the MTLSharedEvent directly.
+ */
+class MVKTimelineSemaphore : public MVKSemaphore {
+
+public:
+	VkSemaphoreTypeKHR getSemaphoreType() override { return VK_SEMAPHORE_TYPE_TIMELINE_KHR; }
+	void encodeWait(id<MTLCommandBuffer> mtlCmdBuff, uint64_t value) override;
+	void encodeSignal(id<MTLCommandBuffer> mtlCmdBuff, uint64_t value) override;
+	bool isUsingCommandEncoding() override { return true; }
+
+	/** Returns the current counter value of this semaphore. */
+	uint64_t getCounterValue() { return _mtlEvent.signaledValue; }
+
+	/** Sets the counter value of this semaphore from the host. */
+	void signal(uint64_t value) { _mtlEvent.signaledValue = value; }
+
+	/**
+	 * Invokes the block on the device MTLSharedEventListener once the counter value
+	 * of this semaphore reaches the value. The block is invoked promptly if the
+	 * counter value has already reached the value.
+	 */
+	void notifyWhenSignaled(uint64_t value, MTLSharedEventNotificationBlock block);
+
+	MVKTimelineSemaphore(MVKDevice* device,
+						 const VkSemaphoreCreateInfo* pCreateInfo,
+						 const VkSemaphoreTypeCreateInfoKHR* pTypeCreateInfo);
+
+	~MVKTimelineSemaphore() override;
+
+protected:
+	id<MTLSharedEvent> _mtlEvent;
+};
+
+
 #pragma mark -
 #pragma mark MVKFence
 
@@ -240,16 +337,12 @@ public:
 	/**
 	 * If this fence has not been signaled yet, adds the specified fence sitter to the
 	 * internal list of fence sitters that will be notified when this fence is signaled,
-	 * and then calls addUnsignaledFence() on the fence sitter so it is aware that it
-	 * will be signaled.
-	 *
-	 * Does nothing if this fence has already been signaled, and does not call 
-	 * addUnsignaledFence() on the fence sitter.
+	 * and returns true.
 	 *
-	 * Each fence sitter should only listen once for each fence. Adding the same fence sitter
-	 * more than once in between each fence reset and signal results in undefined behaviour.
+	 * Returns false, and does nothing, if this fence has already been signaled, or if the
+	 * fence sitter has already been added to this fence since it was last reset or signaled.
 	 */
-	void addSitter(MVKFenceSitter* fenceSitter);
+	bool addSitter(MVKFenceSitter* fenceSitter);
 
 	/** Removes the specified fence sitter. */
 	void removeSitter(MVKFenceSitter* fenceSitter);
@@ -274,7 +367,7 @@ protected:
 	void notifySitters();
 
 	std::mutex _lock;
-	std::unordered_set<MVKFenceSitter*> _fenceSitters;
+	MVKVectorInline<MVKFenceSitter*, 4> _fenceSitters;
 	bool _isSignaled;
 };
 
@@ -282,7 +375,14 @@ protected:
 #pragma mark -
 #pragma mark MVKFenceSitter
 
-/** An object that responds to signals from MVKFences. */
+/**
+ * An object that responds to signals from MVKFences.
+ *
+ * This is an event count. Each signal from a fence increments a count of signals, and the
+ * waiting thread is woken only once, when that count reaches how many signals are required.
+ * Fences can be added in a batch, before that target is known, and any signals that arrive
+ * while the fences are being added are simply counted.
+ */
 class MVKFenceSitter : public MVKBaseObject {
 
 public:
@@ -291,29 +391,46 @@ public:
 	MVKVulkanAPIObject* getVulkanAPIObject() override { return nullptr; }
 
 	/**
-	 * If this instance has been configured to wait for fences, blocks processing on the
-	 * current thread until any or all of the fences that this instance is waiting for are
-	 * signaled, or until the specified timeout in nanoseconds expires. If this instance
-	 * has not been configured to wait for fences, this function immediately returns true.
+	 * Adds this instance to each of the fences that have not yet been signaled, and returns
+	 * whether the wait is already satisfied. When waiting for any fence, adding stops at the
+	 * first fence that has already been signaled.
+	 */
+	bool addFences(uint32_t fenceCount, const VkFence* pFences);
+
+	/**
+	 * Blocks processing on the current thread until any or all of the fences that were added
+	 * are signaled, or until the specified timeout in nanoseconds expires. Returns immediately
+	 * if no unsignaled fences were added.
 	 *
 	 * If timeout is the special value UINT64_MAX the timeout is treated as infinite.
 	 *
 	 * Returns true if the required fences were triggered, or false if the timeout interval expired.
 	 */
-	bool wait(uint64_t timeout = UINT64_MAX) { return _blocker.wait(timeout); }
+	bool wait(uint64_t timeout = UINT64_MAX);
+
+	/** Removes this instance from any added fences that may still signal it. */
+	void removeFences(uint32_t fenceCount, const VkFence* pFences);
 
 
 #pragma mark Construction
 
-	MVKFenceSitter(bool waitAll) : _blocker(waitAll, 0) {}
+	MVKFenceSitter(bool waitAll) : _signalCount(0), _addedCount(0), _requiredCount(0), _waitAll(waitAll) {}
+
+	/** Acquires the lock to ensure any fence that is signaling this instance has finished doing so. */
+	~MVKFenceSitter() override;
 
 private:
 	friend class MVKFence;
 
-	void awaitFence(MVKFence* fence) { _blocker.reserve(); }
-	void fenceSignaled(MVKFence* fence) { _blocker.release(); }
+	void fenceSignaled();
+	inline bool isSatisfied() { return _signalCount >= _requiredCount; }	// Not thread-safe
 
-	MVKSemaphoreImpl _blocker;
+	std::mutex _lock;
+	std::condition_variable _blocker;
+	uint32_t _signalCount;
+	uint32_t _addedCount;
+	uint32_t _requiredCount;
+	bool _waitAll;
 };
 
 
@@ -412,6 +529,15 @@ VkResult mvkWaitForFences(MVKDevice* device,
 						  uint64_t timeout = UINT64_MAX);
 
 
+/**
+ * Blocks the current thread until any or all of the specified timeline semaphores
+ * have reached their values, or the specified timeout occurs.
+ */
+VkResult mvkWaitSemaphores(MVKDevice* device,
+						   const VkSemaphoreWaitInfoKHR* pWaitInfo,
+						   uint64_t timeout);
+
+
 #pragma mark -
 #pragma mark MVKMetalCompiler
 
@@ -18,6 +18,7 @@
 
 #include "MVKSync.h"
 #include "MVKFoundation.h"
+#include "MVKOSExtensions.h"
 #include "MVKLogging.h"
 
 using namespace std;
@@ -82,7 +83,7 @@ MVKSemaphoreImpl::~MVKSemaphoreImpl() {
 
 // Could use any encoder. Assume BLIT is fastest and lightest.
 // Nil mtlCmdBuff will do nothing.
-void MVKSemaphoreMTLFence::encodeWait(id<MTLCommandBuffer> mtlCmdBuff) {
+void MVKSemaphoreMTLFence::encodeWait(id<MTLCommandBuffer> mtlCmdBuff, uint64_t) {
 	id<MTLBlitCommandEncoder> mtlCmdEnc = mtlCmdBuff.blitCommandEncoder;
 	[mtlCmdEnc waitForFence: _mtlFence];
 	[mtlCmdEnc endEncoding];
@@ -90,7 +91,7 @@ void MVKSemaphoreMTLFence::encodeWait(id<MTLCommandBuffer> mtlCmdBuff) {
 
 // Could use any encoder. Assume BLIT is fastest and lightest.
 // Nil mtlCmdBuff will do nothing.
-void MVKSemaphoreMTLFence::encodeSignal(id<MTLCommandBuffer> mtlCmdBuff) {
+void MVKSemaphoreMTLFence::encodeSignal(id<MTLCommandBuffer> mtlCmdBuff, uint64_t) {
 	id<MTLBlitCommandEncoder> mtlCmdEnc = mtlCmdBuff.blitCommandEncoder;
 	[mtlCmdEnc updateFence: _mtlFence];
 	[mtlCmdEnc endEncoding];
@@ -109,12 +110,12 @@ MVKSemaphoreMTLFence::~MVKSemaphoreMTLFence() {
 #pragma mark MVKSemaphoreMTLEvent
 
 // Nil mtlCmdBuff will do nothing.
-void MVKSemaphoreMTLEvent::encodeWait(id<MTLCommandBuffer> mtlCmdBuff) {
+void MVKSemaphoreMTLEvent::encodeWait(id<MTLCommandBuffer> mtlCmdBuff, uint64_t) {
 	[mtlCmdBuff encodeWaitForEvent: _mtlEvent value: _mtlEventValue++];
 }
 
 // Nil mtlCmdBuff will do nothing.
-void MVKSemaphoreMTLEvent::encodeSignal(id<MTLCommandBuffer> mtlCmdBuff) {
+void MVKSemaphoreMTLEvent::encodeSignal(id<MTLCommandBuffer> mtlCmdBuff, uint64_t) {
 	[mtlCmdBuff encodeSignalEvent: _mtlEvent value: _mtlEventValue];
 }
 
@@ -131,11 +132,11 @@ MVKSemaphoreMTLEvent::~MVKSemaphoreMTLEvent() {
 #pragma mark -
 #pragma mark MVKSemaphoreEmulated
 
-void MVKSemaphoreEmulated::encodeWait(id<MTLCommandBuffer> mtlCmdBuff) {
+void MVKSemaphoreEmulated::encodeWait(id<MTLCommandBuffer> mtlCmdBuff, uint64_t) {
 	if ( !mtlCmdBuff ) { _blocker.wait(UINT64_MAX, true); }
 }
 
-void MVKSemaphoreEmulated::encodeSignal(id<MTLCommandBuffer> mtlCmdBuff) {
+void MVKSemaphoreEmulated::encodeSignal(id<MTLCommandBuffer> mtlCmdBuff, uint64_t) {
 	if ( !mtlCmdBuff ) { _blocker.release(); }
 }
 
@@ -144,25 +145,59 @@ MVKSemaphoreEmulated::MVKSemaphoreEmulated(MVKDevice* device, const VkSemaphoreC
 	_blocker(false, 1) {}
 
 
+#pragma mark -
+#pragma mark MVKTimelineSemaphore
+
+// Nil mtlCmdBuff will do nothing.
+void MVKTimelineSemaphore::encodeWait(id<MTLCommandBuffer> mtlCmdBuff, uint64_t value) {
+	[mtlCmdBuff encodeWaitForEvent: _mtlEvent value: value];
+}
+
+// Nil mtlCmdBuff will do nothing.
+void MVKTimelineSemaphore::encodeSignal(id<MTLCommandBuffer> mtlCmdBuff, uint64_t value) {
+	[mtlCmdBuff encodeSignalEvent: _mtlEvent value: value];
+}
+
+void MVKTimelineSemaphore::notifyWhenSignaled(uint64_t value, MTLSharedEventNotificationBlock block) {
+	[_mtlEvent notifyListener: _device->getMTLSharedEventListener() atValue: value block: block];
+}
+
+MVKTimelineSemaphore::MVKTimelineSemaphore(MVKDevice* device,
+										   const VkSemaphoreCreateInfo* pCreateInfo,
+										   const VkSemaphoreTypeCreateInfoKHR* pTypeCreateInfo) :
+	MVKSemaphore(device, pCreateInfo),
+	_mtlEvent([device->getMTLDevice() newSharedEvent]) {	//retained
+
+	_mtlEvent.signaledValue = pTypeCreateInfo->initialValue;
+}
+
+MVKTimelineSemaphore::~MVKTimelineSemaphore() {
+	[_mtlEvent release];
+}
+
+
 #pragma mark -
 #pragma mark MVKFence
 
-void MVKFence::addSitter(MVKFenceSitter* fenceSitter) {
+bool MVKFence::addSitter(MVKFenceSitter* fenceSitter) {
 	lock_guard<mutex> lock(_lock);
 
 	// We only care about unsignaled fences. If already signaled,
-	// don't add myself to the sitter and don't signal the sitter.
-	if (_isSignaled) { return; }
+	// don't add the sitter, because it will not be signaled.
+	if (_isSignaled) { return false; }
 
-	// Ensure each fence only added once to each fence sitter
-	auto addRslt = _fenceSitters.insert(fenceSitter);	// pair with second element true if was added
-	if (addRslt.second) { fenceSitter->awaitFence(this); }
+	// Ensure each fence sitter is only added once to each fence.
+	// There are rarely more than a few sitters, so a linear search is cheapest.
+	for (auto* fs : _fenceSitters) { if (fs == fenceSitter) { return false; } }
+
+	_fenceSitters.push_back(fenceSitter);
+	return true;
 }
 
 void MVKFence::removeSitter(MVKFenceSitter* fenceSitter) {
 	lock_guard<mutex> lock(_lock);
 
-	_fenceSitters.erase(fenceSitter);
+	mvkRemoveFirstOccurance(_fenceSitters, fenceSitter);
 }
 
 void MVKFence::signal() {
@@ -173,7 +208,7 @@ void MVKFence::signal() {
 
 	// Notify all the fence sitters, and clear them from this instance.
     for (auto& fs : _fenceSitters) {
-        fs->fenceSignaled(this);
+        fs->fenceSignaled();
     }
 	_fenceSitters.clear();
 }
@@ -192,6 +227,69 @@ bool MVKFence::getIsSignaled() {
 }
 
 
+#pragma mark -
+#pragma mark MVKFenceSitter
+
+bool MVKFenceSitter::addFences(uint32_t fenceCount, const VkFence* pFences) {
+	// Fences are added without holding this lock, so each fence only takes its own lock.
+	uint32_t addedCnt = 0;
+	bool isAnySignaled = false;
+	for (uint32_t i = 0; i < fenceCount; i++) {
+		if (((MVKFence*)pFences[i])->addSitter(this)) {
+			addedCnt++;
+		} else if ( !_waitAll && ((MVKFence*)pFences[i])->getIsSignaled() ) {
+			isAnySignaled = true;
+			break;
+		}
+	}
+
+	// Signals counted while fences were being added are compared against the required count.
+	lock_guard<mutex> lock(_lock);
+	_addedCount = addedCnt;
+	_requiredCount = isAnySignaled ? 0 : (_waitAll ? addedCnt : min(addedCnt, 1U));
+	return isSatisfied();
+}
+
+bool MVKFenceSitter::wait(uint64_t timeout) {
+	unique_lock<mutex> lock(_lock);
+
+	if (timeout == 0) {
+		return isSatisfied();
+	} else if (timeout == UINT64_MAX) {
+		_blocker.wait(lock, [this]{ return isSatisfied(); });
+		return true;
+	} else {
+		// Limit timeout to avoid overflow since wait_for() uses wait_until()
+		chrono::nanoseconds nanos(min(timeout, kMVKUndefinedLargeUInt64));
+		return _blocker.wait_for(lock, nanos, [this]{ return isSatisfied(); });
+	}
+}
+
+void MVKFenceSitter::removeFences(uint32_t fenceCount, const VkFence* pFences) {
+	// If every added fence has signaled, each has already removed this instance itself.
+	{
+		lock_guard<mutex> lock(_lock);
+		if (_signalCount >= _addedCount) { return; }
+	}
+	for (uint32_t i = 0; i < fenceCount; i++) {
+		((MVKFence*)pFences[i])->removeSitter(this);
+	}
+}
+
+// Called by a fence while it holds its own lock, so always before the fence is removed.
+// Only the signal that satisfies the wait needs to wake the waiting thread.
+void MVKFenceSitter::fenceSignaled() {
+	lock_guard<mutex> lock(_lock);
+	_signalCount++;
+	if (_signalCount == _requiredCount) { _blocker.notify_one(); }
+}
+
+MVKFenceSitter::~MVKFenceSitter() {
+	// Acquire the lock to ensure proper ordering.
+	lock_guard<mutex> lock(_lock);
+}
+
+
 #pragma mark -
 #pragma mark MVKEventNative
 
@@ -272,7 +370,8 @@ VkResult mvkResetFences(uint32_t fenceCount, const VkFence* pFences) {
 	return VK_SUCCESS;
 }
 
-// Create a blocking fence sitter, add it to each fence, wait, then remove it.
+// Create a blocking fence sitter, add it to the fences in one batch, wait for a single
+// wakeup, then remove it from any fences that may still signal it.
 VkResult mvkWaitForFences(MVKDevice* device,
 						  uint32_t fenceCount,
 						  const VkFence* pFences,
@@ -282,15 +381,63 @@ VkResult mvkWaitForFences(MVKDevice* device,
 	VkResult rslt = VK_SUCCESS;
 	MVKFenceSitter fenceSitter(waitAll);
 
-	for (uint32_t i = 0; i < fenceCount; i++) {
-		((MVKFence*)pFences[i])->addSitter(&fenceSitter);
-	}
+	if ( !fenceSitter.addFences(fenceCount, pFences) && !fenceSitter.wait(timeout) ) { rslt = VK_TIMEOUT; }
 
-	if ( !fenceSitter.wait(timeout) ) { rslt = VK_TIMEOUT; }
+	fenceSitter.removeFences(fenceCount, pFences);
 
-	for (uint32_t i = 0; i < fenceCount; i++) {
-		((MVKFence*)pFences[i])->removeSitter(&fenceSitter);
+	return rslt;
+}
+
+
+// Semaphores that have not yet reached their values notify a dispatch semaphore from the
+// device MTLSharedEventListener. Waiting for any requires one notification, and waiting for
+// all requires one per pending semaphore. Notifications for pending semaphores that arrive
+// after a timeout are harmless, because each block retains the dispatch semaphore.
+VkResult mvkWaitSemaphores(MVKDevice* device,
+						   const VkSemaphoreWaitInfoKHR* pWaitInfo,
+						   uint64_t timeout) {
+
+	bool waitAny = mvkIsAnyFlagEnabled(pWaitInfo->flags, VK_SEMAPHORE_WAIT_ANY_BIT_KHR);
+	uint32_t sem4Cnt = pWaitInfo->semaphoreCount;
+
+	uint32_t pendingCnt = 0;
+	for (uint32_t i = 0; i < sem4Cnt; i++) {
+		auto* mvkSem4 = (MVKTimelineSemaphore*)pWaitInfo->pSemaphores[i];
+		if (mvkSem4->getCounterValue() >= pWaitInfo->pValues[i]) {
+			if (waitAny) { return VK_SUCCESS; }
+		} else {
+			pendingCnt++;
+		}
+	}
+	if (pendingCnt == 0) { return VK_SUCCESS; }
+	if (timeout == 0) { return VK_TIMEOUT; }
+
+	// Semaphores that reached their values since being counted above need no notification.
+	dispatch_semaphore_t dispSem4 = dispatch_semaphore_create(0);		// retained
+	pendingCnt = 0;
+	for (uint32_t i = 0; i < sem4Cnt; i++) {
+		auto* mvkSem4 = (MVKTimelineSemaphore*)pWaitInfo->pSemaphores[i];
+		uint64_t value = pWaitInfo->pValues[i];
+		if (waitAny || mvkSem4->getCounterValue() < value) {
+			mvkSem4->notifyWhenSignaled(value, ^(id<MTLSharedEvent> mtlEvent, uint64_t signaledValue) {
+				dispatch_semaphore_signal(dispSem4);
+			});
+			pendingCnt++;
+		}
+	}
+
+	dispatch_time_t deadline = (timeout == UINT64_MAX
+								? DISPATCH_TIME_FOREVER
+								: dispatch_time(DISPATCH_TIME_NOW, min(timeout, (uint64_t)INT64_MAX)));
+	uint32_t waitCnt = waitAny ? 1 : pendingCnt;
+	VkResult rslt = VK_SUCCESS;
+	for (uint32_t i = 0; i < waitCnt; i++) {
+		if (dispatch_semaphore_wait(dispSem4, deadline) != 0) {
+			rslt = VK_TIMEOUT;
+			break;
+		}
 	}
+	dispatch_release(dispSem4);
 
 	return rslt;
 }
@@ -309,6 +456,7 @@ void MVKMetalCompiler::compile(unique_lock<mutex>& lock, dispatch_block_t block)
 
 	MVKDevice* mvkDev = _owner->getDevice();
 	_startTime = mvkDev->getPerformanceTimestamp();
+	uint64_t signpostID = mvkSignpostBegin(kMVKSignpostMetalCompile, _compilerType.c_str());
 
 	dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{ @autoreleasepool { block(); } });
 
@@ -325,6 +473,7 @@ void MVKMetalCompiler::compile(unique_lock<mutex>& lock, dispatch_block_t block)
 
 	if (_compileError) { handleError(); }
 
+	mvkSignpostEnd(kMVKSignpostMetalCompile, signpostID);
 	mvkDev->addActivityPerformance(*_pPerformanceTracker, _startTime);
 }
 
@@ -0,0 +1,797 @@
+/*
+ * MVKCallRecord.h
+ *
+ * Copyright (c) 2015-2020 The Brenwill Workshop Ltd. (http://www.brenwill.com)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "MVKFoundation.h"
+#include "MVKArena.h"
+#include <string.h>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+/**
+ * The format of a Vulkan call recording file, and the serialization of the parameters
+ * of each recorded call. This file is shared by the recorder within MoltenVK, and by
+ * the MoltenVKCallReplayer tool, which re-issues the recorded calls against MoltenVK.
+ *
+ * The file consists of an MVKCallRecordFileHeader, followed by the names of the recorded
+ * functions, each terminated by a null character, followed by the recorded calls, in the
+ * order in which they completed. Each call consists of an MVKCallRecordHeader, followed
+ * by the serialized parameters of the call.
+ *
+ * Parameters are serialized in the order they are declared by the Vulkan function.
+ * Scalars, enums and unions are serialized by value, and handles as 64-bit values.
+ * Pointers are serialized as a uint32_t element count, which is zero if the pointer
+ * is null, followed by the elements. Structs are serialized by value, followed by the
+ * content referenced by their pointer members. Raw data is serialized as a uint32_t
+ * byte count followed by the bytes, and strings as a uint32_t length, including the
+ * terminating null character, followed by the characters. Extension structs in pNext
+ * chains, allocation callbacks, and the contents of buffers, images and pipeline cache
+ * data are not serialized. Buffer memory contents are identified by hashes.
+ */
+
+/** The signature at the start of a Vulkan call recording file. */
+#define kMVKCallRecordSignature		"MVKCALLS"
+
+/** The version of the Vulkan call recording file format. */
+static const uint32_t kMVKCallRecordFormatVersion = 2;
+
+/** The frame index of calls recorded before the recorded range of frames. */
+static const uint32_t kMVKCallRecordSetupFrame = 0xFFFFFFFF;
+
+/** The header of a Vulkan call recording file. */
+typedef struct {
+	char signature[8];			/**< The kMVKCallRecordSignature signature, without a terminating null character. */
+	uint32_t formatVersion;		/**< The kMVKCallRecordFormatVersion of the file. */
+	uint32_t frameCount;		/**< The number of frames recorded. */
+	uint32_t funcCount;			/**< The number of function names following this header. */
+	uint32_t threadCount;		/**< The number of threads that made recorded calls. */
+	uint64_t callCount;			/**< The number of calls recorded. */
+	uint64_t droppedCount;		/**< The number of calls not recorded, because the recording was full. */
+} MVKCallRecordFileHeader;
+
+/**
+ * The header of a single recorded Vulkan call, followed by paramSize bytes of serialized
+ * parameters. If paramSize is zero, only the function and timing of the call was recorded.
+ */
+typedef struct {
+	uint64_t sequence;			/**< The order in which the call completed, across all threads. */
+	uint64_t startTime;			/**< Nanoseconds since the start of the recording. */
+	uint64_t duration;			/**< Nanoseconds. */
+	uint32_t funcIndex;			/**< Index of the function in the function names of the recording file. */
+	uint32_t threadID;			/**< Mach thread ID of the calling thread. */
+	uint32_t frameIndex;		/**< Frame within the recorded range of frames, or kMVKCallRecordSetupFrame. */
+	uint32_t paramSize;			/**< The number of bytes of serialized parameters following this header. */
+} MVKCallRecordHeader;
+
+
+#pragma mark -
+#pragma mark MVKCallRecordWriter
+
+/** Serializes the parameters of a recorded Vulkan call into a byte buffer. */
+class MVKCallRecordWriter {
+
+public:
+
+	/** Indicates that this archive writes serialized content. */
+	static const bool isReading = false;
+
+	/** Serializes the specified value, by value. */
+	template<typename T>
+	void value(const T& val) { bytes(&val, sizeof(T)); }
+
+	/** Serializes the specified handle, as a 64-bit value. */
+	template<typename H>
+	void handle(H& hndl) { value((uint64_t)(uintptr_t)hndl); }
+
+	/** Serializes the specified handle, returned by the recorded call. */
+	template<typename H>
+	void outputHandle(H& hndl) { handle(hndl); }
+
+	/** Serializes the element count of an array, and returns the number of elements to serialize. */
+	template<typename T>
+	size_t beginArray(T*& pElems, size_t count) {
+		uint32_t elemCnt = pElems ? (uint32_t)count : 0;
+		value(elemCnt);
+		return elemCnt;
+	}
+
+	/** Serializes the specified number of bytes of raw data. */
+	template<typename T>
+	void data(T*& pData, size_t byteCount) {
+		uint32_t byteCnt = pData ? (uint32_t)byteCount : 0;
+		value(byteCnt);
+		bytes(pData, byteCnt);
+	}
+
+	/** Serializes a hash of the specified raw data, instead of the data itself. */
+	template<typename T, typename C>
+	void contentHash(T*& pData, C& byteCount) { value(pData ? mvkHashBytes(pData, byteCount) : 0); }
+
+	/** Serializes the specified null-terminated string. */
+	void string(const char*& str) {
+		uint32_t len = str ? (uint32_t)strlen(str) + 1 : 0;
+		value(len);
+		bytes(str, len);
+	}
+
+	/** Appends the specified bytes. */
+	void bytes(const void* pBytes, size_t byteCount) {
+		if ( !byteCount ) { return; }
+		_data.insert(_data.end(), (const uint8_t*)pBytes, (const uint8_t*)pBytes + byteCount);
+	}
+
+	/** Constructs an instance that appends serialized content to the specified byte buffer. */
+	MVKCallRecordWriter(std::vector<uint8_t>& data) : _data(data) {}
+
+protected:
+	std::vector<uint8_t>& _data;
+};
+
+
+#pragma mark -
+#pragma mark MVKCallRecordReader
+
+/**
+ * Deserializes the parameters of a recorded Vulkan call. Handles are replaced by the live
+ * handles they have been mapped to. Deserialized arrays, structs, and strings are allocated
+ * within an arena, and remain valid until the parameters of the next call are read.
+ */
+class MVKCallRecordReader {
+
+public:
+
+	/** Indicates that this archive reads serialized content. */
+	static const bool isReading = true;
+
+	/** Deserializes the specified value, by value. */
+	template<typename T>
+	void value(T& val) { bytes(&val, sizeof(T)); }
+
+	/** Deserializes the specified handle, and replaces it with the live handle it is mapped to. */
+	template<typename H>
+	void handle(H& hndl) {
+		uint64_t recHndl = 0;
+		value(recHndl);
+		hndl = (H)(uintptr_t)getLiveHandle(recHndl);
+	}
+
+	/**
+	 * Deserializes the specified handle, returned by the recorded call, and remembers where it
+	 * was deserialized to, so that mapOutputHandles() can map it to the live handle returned
+	 * by the replayed call.
+	 */
+	template<typename H>
+	void outputHandle(H& hndl) {
+		static_assert(sizeof(H) == sizeof(uint64_t), "Vulkan call recording requires 64-bit handles.");
+		uint64_t recHndl = 0;
+		value(recHndl);
+		hndl = (H)(uintptr_t)recHndl;
+		_outputHandles.push_back({ (uint64_t*)&hndl, recHndl });
+	}
+
+	/** Deserializes the element count of an array, allocates the array, and returns the element count. */
+	template<typename T>
+	size_t beginArray(T*& pElems, size_t count) {
+		typedef typename std::remove_const<T>::type E;
+		uint32_t elemCnt = 0;
+		value(elemCnt);
+		if (elemCnt > getRemainingByteCount() / sizeof(E)) { invalidate(); elemCnt = 0; }
+		E* pNewElems = nullptr;
+		if (elemCnt) {
+			pNewElems = _arena.newArray<E>(elemCnt);
+			memset((void*)pNewElems, 0, sizeof(E) * elemCnt);
+		}
+		pElems = pNewElems;
+		return elemCnt;
+	}
+
+	/** Deserializes raw data. The byte count is read from the serialized content. */
+	template<typename T>
+	void data(T*& pData, size_t byteCount) {
+		uint32_t byteCnt = 0;
+		value(byteCnt);
+		if (byteCnt > getRemainingByteCount()) { invalidate(); byteCnt = 0; }
+		uint64_t* pNewData = byteCnt ? _arena.newArray<uint64_t>((byteCnt + sizeof(uint64_t) - 1) / sizeof(uint64_t)) : nullptr;
+		bytes(pNewData, byteCnt);
+		pData = (T*)pNewData;
+	}
+
+	/** Deserializes a hash of raw data. The data is not available, so it is replaced by null content. */
+	template<typename T, typename C>
+	void contentHash(T*& pData, C& byteCount) {
+		value(_lastContentHash);
+		pData = nullptr;
+		byteCount = 0;
+	}
+
+	/** Deserializes a null-terminated string. */
+	void string(const char*& str) {
+		uint32_t len = 0;
+		value(len);
+		if (len > getRemainingByteCount()) { invalidate(); len = 0; }
+		char* pNewStr = len ? _arena.newArray<char>(len) : nullptr;
+		bytes(pNewStr, len);
+		if (pNewStr) { pNewStr[len - 1] = 0; }
+		str = pNewStr;
+	}
+
+	/** Copies the specified number of bytes from the serialized content. */
+	void bytes(void* pBytes, size_t byteCount) {
+		if ( !byteCount ) { return; }
+		if (byteCount > getRemainingByteCount()) {
+			memset(pBytes, 0, byteCount);
+			invalidate();
+			return;
+		}
+		memcpy(pBytes, _pData + _offset, byteCount);
+		_offset += byteCount;
+	}
+
+	/**
+	 * Starts reading the serialized parameters of a call, and releases the content
+	 * deserialized from the parameters of the previous call.
+	 */
+	void reset(const uint8_t* pData, size_t size) {
+		_arena.reset();
+		_outputHandles.clear();
+		_pData = pData;
+		_size = size;
+		_offset = 0;
+		_lastContentHash = 0;
+		_isValid = true;
+	}
+
+	/** Maps the recorded handles returned by the call to the live handles returned by the replayed call. */
+	void mapOutputHandles() {
+		for (auto& outHndl : _outputHandles) { mapHandle(outHndl.second, *outHndl.first); }
+		_outputHandles.clear();
+	}
+
+	/** Maps the specified recorded handle to the specified live handle. */
+	void mapHandle(uint64_t recHndl, uint64_t liveHndl) {
+		if (recHndl) { _liveHandles[recHndl] = liveHndl; }
+	}
+
+	/** Removes the mapping of the specified recorded handle. */
+	void unmapHandle(uint64_t recHndl) { _liveHandles.erase(recHndl); }
+
+	/** Returns the live handle mapped to the specified recorded handle, or zero if it is not mapped. */
+	uint64_t getLiveHandle(uint64_t recHndl) {
+		if ( !recHndl ) { return 0; }
+		auto iter = _liveHandles.find(recHndl);
+		return (iter != _liveHandles.end()) ? iter->second : 0;
+	}
+
+	/** Returns the hash most recently read by contentHash(). */
+	uint64_t getLastContentHash() { return _lastContentHash; }
+
+	/** Returns whether all of the parameters read since reset() were within the serialized content. */
+	bool isValid() { return _isValid; }
+
+	/** Returns whether all of the serialized content has been read since reset(). */
+	bool isAtEnd() { return _offset == _size; }
+
+protected:
+	size_t getRemainingByteCount() { return _size - _offset; }
+	void invalidate() { _isValid = false; _offset = _size; }
+
+	MVKArena _arena;
+	std::unordered_map<uint64_t, uint64_t> _liveHandles;
+	std::vector<std::pair<uint64_t*, uint64_t>> _outputHandles;
+	const uint8_t* _pData = nullptr;
+	size_t _size = 0;
+	size_t _offset = 0;
+	uint64_t _lastContentHash = 0;
+	bool _isValid = true;
+};
+
+
+#pragma mark -
+#pragma mark Serialization
+
+// Each of the following functions serializes or deserializes content, depending on whether
+// the archive is an MVKCallRecordWriter or an MVKCallRecordReader. When writing, serialized
+// content is never modified, so the const qualifiers of recorded parameters can be removed.
+
+template<typename A, typename T>
+void mvkSerializeArray(A& ar, T*& pElems, size_t count);
+
+/** Serializes scalars, enums, and unions, including fixed-size arrays of them, by value. */
+template<typename A, typename T>
+typename std::enable_if<!std::is_class<T>::value && !std::is_pointer<T>::value>::type
+mvkSerializeElement(A& ar, T& val) { ar.value(val); }
+
+/** Removes the pNext chain from a deserialized struct. */
+template<typename A, typename T>
+auto mvkSerializeNext(A& ar, T& s, int) -> decltype((void)s.pNext) { if (A::isReading) { s.pNext = nullptr; } }
+
+/** Structs without a pNext member. */
+template<typename A, typename T>
+void mvkSerializeNext(A& ar, T& s, long) {}
+
+/** Structs without pointer or handle members need no content beyond their value. */
+template<typename A, typename T>
+void mvkSerializeDeep(A& ar, T& s) {}
+
+/** Serializes a struct by value, followed by the content referenced by its members. */
+template<typename A, typename T>
+typename std::enable_if<std::is_class<T>::value>::type
+mvkSerializeElement(A& ar, T& s) {
+	ar.value(s);
+	mvkSerializeNext(ar, s, 0);
+	mvkSerializeDeep(ar, s);
+}
+
+/** Serializes a pointer to a single element. */
+template<typename A, typename T>
+void mvkSerializeElement(A& ar, T*& pElem) { mvkSerializeArray(ar, pElem, 1); }
+
+/** Allocation callbacks are not serialized, and are null when deserialized. */
+template<typename A>
+void mvkSerializeElement(A& ar, const VkAllocationCallbacks*& pAllocator) { if (A::isReading) { pAllocator = nullptr; } }
+
+/** Elements that are not handles are serialized the same way, whether or not they are returned by the call. */
+template<typename A, typename T>
+void mvkSerializeOutput(A& ar, T& elem) { mvkSerializeElement(ar, elem); }
+
+#define MVK_CALL_RECORD_HANDLE(H)	\
+	template<typename A> void mvkSerializeElement(A& ar, H& hndl) { ar.handle(hndl); }	\
+	template<typename A> void mvkSerializeOutput(A& ar, H& hndl) { ar.outputHandle(hndl); }
+
+MVK_CALL_RECORD_HANDLE(VkInstance)
+MVK_CALL_RECORD_HANDLE(VkPhysicalDevice)
+MVK_CALL_RECORD_HANDLE(VkDevice)
+MVK_CALL_RECORD_HANDLE(VkQueue)
+MVK_CALL_RECORD_HANDLE(VkCommandBuffer)
+MVK_CALL_RECORD_HANDLE(VkSemaphore)
+MVK_CALL_RECORD_HANDLE(VkFence)
+MVK_CALL_RECORD_HANDLE(VkDeviceMemory)
+MVK_CALL_RECORD_HANDLE(VkBuffer)
+MVK_CALL_RECORD_HANDLE(VkImage)
+MVK_CALL_RECORD_HANDLE(VkEvent)
+MVK_CALL_RECORD_HANDLE(VkQueryPool)
+MVK_CALL_RECORD_HANDLE(VkBufferView)
+MVK_CALL_RECORD_HANDLE(VkImageView)
+MVK_CALL_RECORD_HANDLE(VkShaderModule)
+MVK_CALL_RECORD_HANDLE(VkPipelineCache)
+MVK_CALL_RECORD_HANDLE(VkPipelineLayout)
+MVK_CALL_RECORD_HANDLE(VkRenderPass)
+MVK_CALL_RECORD_HANDLE(VkPipeline)
+MVK_CALL_RECORD_HANDLE(VkDescriptorSetLayout)
+MVK_CALL_RECORD_HANDLE(VkSampler)
+MVK_CALL_RECORD_HANDLE(VkDescriptorPool)
+MVK_CALL_RECORD_HANDLE(VkDescriptorSet)
+MVK_CALL_RECORD_HANDLE(VkFramebuffer)
+MVK_CALL_RECORD_HANDLE(VkCommandPool)
+MVK_CALL_RECORD_HANDLE(VkSurfaceKHR)
+MVK_CALL_RECORD_HANDLE(VkSwapchainKHR)
+MVK_CALL_RECORD_HANDLE(VkDescriptorUpdateTemplateKHR)
+
+template<typename A, typename E>
+void mvkSerializeArrayElements(A& ar, E* pElems, size_t count, std::true_type isConst) {
+	for (size_t elemIdx = 0; elemIdx < count; elemIdx++) { mvkSerializeElement(ar, pElems[elemIdx]); }
+}
+
+template<typename A, typename E>
+void mvkSerializeArrayElements(A& ar, E* pElems, size_t count, std::false_type isConst) {
+	for (size_t elemIdx = 0; elemIdx < count; elemIdx++) { mvkSerializeOutput(ar, pElems[elemIdx]); }
+}
+
+/**
+ * Serializes the specified number of elements of an array. The elements of arrays referenced
+ * by non-const pointers are returned by the call, and are serialized after the call completes.
+ */
+template<typename A, typename T>
+void mvkSerializeArray(A& ar, T*& pElems, size_t count) {
+	typedef typename std::remove_const<T>::type E;
+	size_t elemCnt = ar.beginArray(pElems, count);
+	mvkSerializeArrayElements(ar, const_cast<E*>(pElems), elemCnt, std::is_const<T>());
+}
+
+/** Serializes the specified number of null-terminated strings. */
+template<typename A>
+void mvkSerializeStrings(A& ar, const char* const*& pStrs, size_t count) {
+	size_t strCnt = ar.beginArray(pStrs, count);
+	const char** pMutableStrs = const_cast<const char**>(pStrs);
+	for (size_t strIdx = 0; strIdx < strCnt; strIdx++) { ar.string(pMutableStrs[strIdx]); }
+}
+
+
+#pragma mark Call parameters
+
+/** The base of helper wrappers that serialize call parameters that cannot be serialized from their type alone. */
+class MVKCallRecordArg {};
+
+// These wrappers are only used when recording. When replaying, the element and byte counts
+// are read from the serialized content, and the parameters are deserialized from their types.
+
+/** Serializes an array of call parameters, with a count supplied by another call parameter. */
+template<typename T, typename C>
+class MVKCallRecordArray : public MVKCallRecordArg {
+
+public:
+	void serialize(MVKCallRecordWriter& ar) const { mvkSerializeArray(ar, const_cast<T*&>(_pElems), _count); }
+
+	MVKCallRecordArray(T* const& pElems, const C& count) : _pElems(pElems), _count(count) {}
+
+protected:
+	T* const& _pElems;
+	const C& _count;
+};
+
+/** Records an array of elements, whose count is supplied by another parameter of the call. */
+template<typename T, typename C>
+MVKCallRecordArray<T, C> mvkRecordArray(T* const& pElems, const C& count) { return MVKCallRecordArray<T, C>(pElems, count); }
+
+/** Serializes raw data call parameters, with a byte count supplied by another call parameter. */
+template<typename T, typename C>
+class MVKCallRecordBytes : public MVKCallRecordArg {
+
+public:
+	void serialize(MVKCallRecordWriter& ar) const { ar.data(const_cast<T*&>(_pData), _byteCount); }
+
+	MVKCallRecordBytes(T* const& pData, const C& byteCount) : _pData(pData), _byteCount(byteCount) {}
+
+protected:
+	T* const& _pData;
+	const C& _byteCount;
+};
+
+/** Records raw data, whose size in bytes is supplied by another parameter of the call. */
+template<typename T, typename C>
+MVKCallRecordBytes<T, C> mvkRecordBytes(T* const& pData, const C& byteCount) { return MVKCallRecordBytes<T, C>(pData, byteCount); }
+
+/** Deserializes raw data call parameters, recorded by mvkRecordBytes(). */
+inline void mvkSerializeElement(MVKCallRecordReader& ar, const void*& pData) { ar.data(pData, 0); }
+
+template<typename A, typename T>
+typename std::enable_if<!std::is_base_of<MVKCallRecordArg, typename std::remove_const<T>::type>::value>::type
+mvkSerializeArg(A& ar, T& arg) { mvkSerializeElement(ar, arg); }
+
+template<typename A, typename T>
+typename std::enable_if<std::is_base_of<MVKCallRecordArg, typename std::remove_const<T>::type>::value>::type
+mvkSerializeArg(A& ar, T& arg) { arg.serialize(ar); }
+
+/** Serializes the specified call parameters, in order. */
+template<typename A>
+void mvkSerializeArgs(A& ar) {}
+
+/** Serializes the specified call parameters, in order. */
+template<typename A, typename T, typename... Args>
+void mvkSerializeArgs(A& ar, T&& arg, Args&&... args) {
+	mvkSerializeArg(ar, arg);
+	mvkSerializeArgs(ar, std::forward<Args>(args)...);
+}
+
+
+#pragma mark Struct contents
+
+// The content referenced by the pointer and handle members of the Vulkan structs passed to
+// recorded calls. Pointer members that Vulkan ignores, based on the values of other members,
+// may be invalid, and are serialized as null.
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkDeviceQueueCreateInfo& s) {
+	mvkSerializeArray(ar, s.pQueuePriorities, s.queueCount);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkDeviceCreateInfo& s) {
+	mvkSerializeArray(ar, s.pQueueCreateInfos, s.queueCreateInfoCount);
+	mvkSerializeStrings(ar, s.ppEnabledLayerNames, s.enabledLayerCount);
+	mvkSerializeStrings(ar, s.ppEnabledExtensionNames, s.enabledExtensionCount);
+	mvkSerializeArray(ar, s.pEnabledFeatures, 1);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkMappedMemoryRange& s) {
+	ar.handle(s.memory);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkBufferCreateInfo& s) {
+	mvkSerializeArray(ar, s.pQueueFamilyIndices, (s.sharingMode == VK_SHARING_MODE_CONCURRENT) ? s.queueFamilyIndexCount : 0);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkBufferViewCreateInfo& s) {
+	ar.handle(s.buffer);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkImageCreateInfo& s) {
+	mvkSerializeArray(ar, s.pQueueFamilyIndices, (s.sharingMode == VK_SHARING_MODE_CONCURRENT) ? s.queueFamilyIndexCount : 0);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkImageViewCreateInfo& s) {
+	ar.handle(s.image);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkShaderModuleCreateInfo& s) {
+	ar.data(s.pCode, s.codeSize);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkPipelineCacheCreateInfo& s) {
+	ar.contentHash(s.pInitialData, s.initialDataSize);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkSpecializationInfo& s) {
+	mvkSerializeArray(ar, s.pMapEntries, s.mapEntryCount);
+	ar.data(s.pData, s.dataSize);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkPipelineShaderStageCreateInfo& s) {
+	ar.handle(s.module);
+	ar.string(s.pName);
+	mvkSerializeArray(ar, s.pSpecializationInfo, 1);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkPipelineVertexInputStateCreateInfo& s) {
+	mvkSerializeArray(ar, s.pVertexBindingDescriptions, s.vertexBindingDescriptionCount);
+	mvkSerializeArray(ar, s.pVertexAttributeDescriptions, s.vertexAttributeDescriptionCount);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkPipelineMultisampleStateCreateInfo& s) {
+	mvkSerializeArray(ar, s.pSampleMask, (s.rasterizationSamples + 31) / 32);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkPipelineColorBlendStateCreateInfo& s) {
+	mvkSerializeArray(ar, s.pAttachments, s.attachmentCount);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkPipelineDynamicStateCreateInfo& s) {
+	mvkSerializeArray(ar, s.pDynamicStates, s.dynamicStateCount);
+}
+
+// Returns whether the specified dynamic state is enabled.
+static inline bool mvkIsDynamicState(const VkPipelineDynamicStateCreateInfo* pDynamicState, VkDynamicState dynState) {
+	if ( !pDynamicState || !pDynamicState->pDynamicStates ) { return false; }
+	for (uint32_t dsIdx = 0; dsIdx < pDynamicState->dynamicStateCount; dsIdx++) {
+		if (pDynamicState->pDynamicStates[dsIdx] == dynState) { return true; }
+	}
+	return false;
+}
+
+// The viewports and scissors are ignored if they are dynamic.
+template<typename A>
+void mvkSerializeViewportState(A& ar, const VkPipelineViewportStateCreateInfo*& pViewportState, const VkPipelineDynamicStateCreateInfo* pDynamicState) {
+	if ( !ar.beginArray(pViewportState, 1) ) { return; }
+
+	auto& vpState = const_cast<VkPipelineViewportStateCreateInfo&>(*pViewportState);
+	ar.value(vpState);
+	mvkSerializeNext(ar, vpState, 0);
+	mvkSerializeArray(ar, vpState.pViewports, mvkIsDynamicState(pDynamicState, VK_DYNAMIC_STATE_VIEWPORT) ? 0 : vpState.viewportCount);
+	mvkSerializeArray(ar, vpState.pScissors, mvkIsDynamicState(pDynamicState, VK_DYNAMIC_STATE_SCISSOR) ? 0 : vpState.scissorCount);
+}
+
+// The dynamic state and rasterization state are serialized first,
+// because they determine which of the other states are ignored.
+template<typename A>
+void mvkSerializeDeep(A& ar, VkGraphicsPipelineCreateInfo& s) {
+	mvkSerializeArray(ar, s.pStages, s.stageCount);
+	mvkSerializeArray(ar, s.pDynamicState, 1);
+	mvkSerializeArray(ar, s.pRasterizationState, 1);
+
+	bool isTessellated = false;
+	for (uint32_t stgIdx = 0; s.pStages && stgIdx < s.stageCount; stgIdx++) {
+		if (s.pStages[stgIdx].stage == VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT) { isTessellated = true; }
+	}
+	bool isRasterizing = !(s.pRasterizationState && s.pRasterizationState->rasterizerDiscardEnable);
+
+	mvkSerializeArray(ar, s.pVertexInputState, 1);
+	mvkSerializeArray(ar, s.pInputAssemblyState, 1);
+	mvkSerializeArray(ar, s.pTessellationState, isTessellated ? 1 : 0);
+	if (isRasterizing) {
+		mvkSerializeViewportState(ar, s.pViewportState, s.pDynamicState);
+	} else {
+		mvkSerializeArray(ar, s.pViewportState, 0);
+	}
+	mvkSerializeArray(ar, s.pMultisampleState, isRasterizing ? 1 : 0);
+	mvkSerializeArray(ar, s.pDepthStencilState, isRasterizing ? 1 : 0);
+	mvkSerializeArray(ar, s.pColorBlendState, isRasterizing ? 1 : 0);
+	ar.handle(s.layout);
+	ar.handle(s.renderPass);
+	ar.handle(s.basePipelineHandle);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkComputePipelineCreateInfo& s) {
+	mvkSerializeNext(ar, s.stage, 0);
+	mvkSerializeDeep(ar, s.stage);
+	ar.handle(s.layout);
+	ar.handle(s.basePipelineHandle);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkDescriptorSetLayoutBinding& s) {
+	bool isSampler = (s.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER ||
+					  s.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+	mvkSerializeArray(ar, s.pImmutableSamplers, isSampler ? s.descriptorCount : 0);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkDescriptorSetLayoutCreateInfo& s) {
+	mvkSerializeArray(ar, s.pBindings, s.bindingCount);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkPipelineLayoutCreateInfo& s) {
+	mvkSerializeArray(ar, s.pSetLayouts, s.setLayoutCount);
+	mvkSerializeArray(ar, s.pPushConstantRanges, s.pushConstantRangeCount);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkDescriptorPoolCreateInfo& s) {
+	mvkSerializeArray(ar, s.pPoolSizes, s.poolSizeCount);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkDescriptorSetAllocateInfo& s) {
+	ar.handle(s.descriptorPool);
+	mvkSerializeArray(ar, s.pSetLayouts, s.descriptorSetCount);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkDescriptorImageInfo& s) {
+	ar.handle(s.sampler);
+	ar.handle(s.imageView);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkDescriptorBufferInfo& s) {
+	ar.handle(s.buffer);
+}
+
+// Returns whether the descriptor type is an image type, buffer type or texel buffer type, respectively.
+static inline bool mvkIsImageDescriptorType(VkDescriptorType descType) {
+	switch (descType) {
+		case VK_DESCRIPTOR_TYPE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+			return true;
+		default:
+			return false;
+	}
+}
+
+static inline bool mvkIsBufferDescriptorType(VkDescriptorType descType) {
+	switch (descType) {
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+			return true;
+		default:
+			return false;
+	}
+}
+
+static inline bool mvkIsTexelBufferDescriptorType(VkDescriptorType descType) {
+	return (descType == VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER ||
+			descType == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkWriteDescriptorSet& s) {
+	ar.handle(s.dstSet);
+	mvkSerializeArray(ar, s.pImageInfo, mvkIsImageDescriptorType(s.descriptorType) ? s.descriptorCount : 0);
+	mvkSerializeArray(ar, s.pBufferInfo, mvkIsBufferDescriptorType(s.descriptorType) ? s.descriptorCount : 0);
+	mvkSerializeArray(ar, s.pTexelBufferView, mvkIsTexelBufferDescriptorType(s.descriptorType) ? s.descriptorCount : 0);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkCopyDescriptorSet& s) {
+	ar.handle(s.srcSet);
+	ar.handle(s.dstSet);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkDescriptorUpdateTemplateCreateInfoKHR& s) {
+	mvkSerializeArray(ar, s.pDescriptorUpdateEntries, s.descriptorUpdateEntryCount);
+	ar.handle(s.descriptorSetLayout);
+	ar.handle(s.pipelineLayout);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkSubpassDescription& s) {
+	mvkSerializeArray(ar, s.pInputAttachments, s.inputAttachmentCount);
+	mvkSerializeArray(ar, s.pColorAttachments, s.colorAttachmentCount);
+	mvkSerializeArray(ar, s.pResolveAttachments, s.colorAttachmentCount);
+	mvkSerializeArray(ar, s.pDepthStencilAttachment, 1);
+	mvkSerializeArray(ar, s.pPreserveAttachments, s.preserveAttachmentCount);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkRenderPassCreateInfo& s) {
+	mvkSerializeArray(ar, s.pAttachments, s.attachmentCount);
+	mvkSerializeArray(ar, s.pSubpasses, s.subpassCount);
+	mvkSerializeArray(ar, s.pDependencies, s.dependencyCount);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkFramebufferCreateInfo& s) {
+	ar.handle(s.renderPass);
+	mvkSerializeArray(ar, s.pAttachments, s.attachmentCount);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkCommandBufferAllocateInfo& s) {
+	ar.handle(s.commandPool);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkCommandBufferInheritanceInfo& s) {
+	ar.handle(s.renderPass);
+	ar.handle(s.framebuffer);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkRenderPassBeginInfo& s) {
+	ar.handle(s.renderPass);
+	ar.handle(s.framebuffer);
+	mvkSerializeArray(ar, s.pClearValues, s.clearValueCount);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkBufferMemoryBarrier& s) {
+	ar.handle(s.buffer);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkImageMemoryBarrier& s) {
+	ar.handle(s.image);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkSubmitInfo& s) {
+	mvkSerializeArray(ar, s.pWaitSemaphores, s.waitSemaphoreCount);
+	mvkSerializeArray(ar, s.pWaitDstStageMask, s.waitSemaphoreCount);
+	mvkSerializeArray(ar, s.pCommandBuffers, s.commandBufferCount);
+	mvkSerializeArray(ar, s.pSignalSemaphores, s.signalSemaphoreCount);
+}
+
+template<typename A>
+void mvkSerializeDeep(A& ar, VkSwapchainCreateInfoKHR& s) {
+	ar.handle(s.surface);
+	mvkSerializeArray(ar, s.pQueueFamilyIndices, (s.imageSharingMode == VK_SHARING_MODE_CONCURRENT) ? s.queueFamilyIndexCount : 0);
+	ar.handle(s.oldSwapchain);
+}
+
+// The results are returned by the call, and are not recorded.
+template<typename A>
+void mvkSerializeDeep(A& ar, VkPresentInfoKHR& s) {
+	mvkSerializeArray(ar, s.pWaitSemaphores, s.waitSemaphoreCount);
+	mvkSerializeArray(ar, s.pSwapchains, s.swapchainCount);
+	mvkSerializeArray(ar, s.pImageIndices, s.swapchainCount);
+	mvkSerializeArray(ar, s.pResults, 0);
+}
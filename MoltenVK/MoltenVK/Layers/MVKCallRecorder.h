@@ -0,0 +1,91 @@
+/*
+ * MVKCallRecorder.h
+ *
+ * Copyright (c) 2015-2020 The Brenwill Workshop Ltd. (http://www.brenwill.com)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "MVKCallRecord.h"
+#include <mutex>
+
+
+#pragma mark -
+#pragma mark MVKCallRecordBuffer
+
+/**
+ * The Vulkan calls recorded by a single thread.
+ *
+ * Each thread records into its own buffer, so threads do not contend with each other while
+ * recording. The lock is held by the recording thread while it records a call, and is only
+ * contended when the recording is written to the recording file.
+ */
+typedef struct {
+	std::vector<uint8_t> data;
+	std::mutex lock;
+	uint32_t threadID;
+} MVKCallRecordBuffer;
+
+
+#pragma mark -
+#pragma mark Vulkan call recording
+
+/**
+ * Returns whether Vulkan calls are being recorded, either while setting up the objects used
+ * by the range of frames to be recorded, or during those frames. The recording configuration
+ * is read from the environment on first use, in a thread-safe manner.
+ */
+bool mvkIsRecordingVulkanCalls();
+
+/**
+ * Returns the index that identifies the named function in the recording file.
+ * This is called once per function, and the result cached by the caller.
+ */
+uint32_t mvkGetVulkanCallRecordFunctionIndex(const char* funcName);
+
+/**
+ * If the call should be recorded, locks and returns the recording buffer of the calling thread,
+ * with space reserved for the MVKCallRecordHeader of the call. Otherwise returns null.
+ *
+ * Calls that create, destroy, or update the state of Vulkan objects are recorded from the start
+ * of the recording, so that the recorded frames can be replayed. Calls that record or submit
+ * commands, identified by isFrameCall, are only recorded during the recorded range of frames.
+ */
+MVKCallRecordBuffer* mvkBeginVulkanCallRecord(bool isFrameCall);
+
+/**
+ * Completes the record of a call started at the specified time, within the specified buffer
+ * returned by mvkBeginVulkanCallRecord(), whose MVKCallRecordHeader starts at the specified
+ * offset, and unlocks the buffer.
+ */
+void mvkEndVulkanCallRecord(MVKCallRecordBuffer* pRecBuff, size_t recOffset, uint32_t funcIndex, uint64_t startTime);
+
+/** Records a call to the function, started at the specified time, with the specified parameters. */
+template<typename... Args>
+void mvkRecordVulkanCall(uint32_t funcIndex, uint64_t startTime, bool isFrameCall, Args&&... args) {
+	MVKCallRecordBuffer* pRecBuff = mvkBeginVulkanCallRecord(isFrameCall);
+	if ( !pRecBuff ) { return; }
+
+	size_t recOffset = pRecBuff->data.size() - sizeof(MVKCallRecordHeader);
+	MVKCallRecordWriter writer(pRecBuff->data);
+	mvkSerializeArgs(writer, std::forward<Args>(args)...);
+	mvkEndVulkanCallRecord(pRecBuff, recOffset, funcIndex, startTime);
+}
+
+/** Marks the end of a frame, and starts or stops recording frames at the configured frames. */
+void mvkEndVulkanCallRecordFrame();
+
+/** If Vulkan calls are being recorded, writes the recording to the recording file, and stops recording. */
+void mvkStopRecordingVulkanCalls();
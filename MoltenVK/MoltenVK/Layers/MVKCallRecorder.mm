@@ -0,0 +1,240 @@
+/*
+ * MVKCallRecorder.mm
+ *
+ * Copyright (c) 2015-2020 The Brenwill Workshop Ltd. (http://www.brenwill.com)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MVKCallRecorder.h"
+#include "MVKOSExtensions.h"
+#include "MVKLogging.h"
+#include <Foundation/Foundation.h>
+#include <pthread.h>
+#include <algorithm>
+#include <atomic>
+
+using namespace std;
+
+
+#pragma mark -
+#pragma mark Vulkan call recording
+
+#ifndef MVK_CONFIG_CALL_RECORD_FILE
+#   define MVK_CONFIG_CALL_RECORD_FILE    ""
+#endif
+#ifndef MVK_CONFIG_CALL_RECORD_START_FRAME
+#   define MVK_CONFIG_CALL_RECORD_START_FRAME    0
+#endif
+#ifndef MVK_CONFIG_CALL_RECORD_FRAME_COUNT
+#   define MVK_CONFIG_CALL_RECORD_FRAME_COUNT    1
+#endif
+
+// The maximum total size of the recorded calls. Calls beyond this are counted, but not recorded.
+static const size_t kMVKMaxVulkanCallRecordSize = 256 * MEBI;
+
+typedef enum : uint32_t {
+	MVKCallRecordStateUninitialized = 0,	// The recording configuration has not been read.
+	MVKCallRecordStateDisabled,				// Vulkan calls are not recorded.
+	MVKCallRecordStateRecordingSetup,		// Recording calls that set up objects, before the recorded frames.
+	MVKCallRecordStateRecordingFrames,		// Recording all calls, during the recorded frames.
+	MVKCallRecordStateFinished,				// The recording has been written to the recording file.
+} MVKCallRecordState;
+
+static string _mvkCallRecordFile;
+static uint32_t _mvkCallRecordStartFrame = MVK_CONFIG_CALL_RECORD_START_FRAME;
+static uint32_t _mvkCallRecordFrameCount = MVK_CONFIG_CALL_RECORD_FRAME_COUNT;
+static uint64_t _mvkCallRecordStartTime = 0;
+static once_flag _mvkCallRecordInitFlag;
+static atomic<uint32_t> _mvkCallRecordState(MVKCallRecordStateUninitialized);
+static atomic<uint32_t> _mvkCallRecordFrameIndex(0);
+static atomic<uint64_t> _mvkCallRecordSequence(0);
+static atomic<uint64_t> _mvkCallRecordSize(0);
+static atomic<uint64_t> _mvkCallRecordDroppedCount(0);
+
+// The function names and the recording buffers of all threads are only accessed the first
+// time each function is called, and the first time each thread records a call, respectively.
+static mutex _mvkCallRecordRegistryLock;
+static vector<const char*> _mvkCallRecordFuncNames;
+static vector<MVKCallRecordBuffer*> _mvkCallRecordBuffers;
+static thread_local MVKCallRecordBuffer* _mvkThreadCallRecordBuffer = nullptr;
+
+// Reads the recording configuration from environment variables. We do this once lazily,
+// instead of in a library constructor function, to ensure the NSProcessInfo environment
+// is available when called upon.
+static void mvkInitVulkanCallRecording() {
+	MVK_SET_FROM_ENV_OR_BUILD_STRING(_mvkCallRecordFile, MVK_CONFIG_CALL_RECORD_FILE);
+	MVK_SET_FROM_ENV_OR_BUILD_INT32(_mvkCallRecordStartFrame, MVK_CONFIG_CALL_RECORD_START_FRAME);
+	MVK_SET_FROM_ENV_OR_BUILD_INT32(_mvkCallRecordFrameCount, MVK_CONFIG_CALL_RECORD_FRAME_COUNT);
+	_mvkCallRecordStartTime = mvkGetTimestamp();
+
+	MVKCallRecordState state = MVKCallRecordStateDisabled;
+	if ( !_mvkCallRecordFile.empty() && _mvkCallRecordFrameCount ) {
+		state = _mvkCallRecordStartFrame ? MVKCallRecordStateRecordingSetup : MVKCallRecordStateRecordingFrames;
+	}
+	_mvkCallRecordState = state;
+}
+
+static inline uint32_t mvkGetVulkanCallRecordState() {
+	uint32_t state = _mvkCallRecordState.load(memory_order_acquire);
+	if (state == MVKCallRecordStateUninitialized) {
+		call_once(_mvkCallRecordInitFlag, mvkInitVulkanCallRecording);
+		state = _mvkCallRecordState.load(memory_order_acquire);
+	}
+	return state;
+}
+
+bool mvkIsRecordingVulkanCalls() {
+	uint32_t state = mvkGetVulkanCallRecordState();
+	return state == MVKCallRecordStateRecordingSetup || state == MVKCallRecordStateRecordingFrames;
+}
+
+uint32_t mvkGetVulkanCallRecordFunctionIndex(const char* funcName) {
+	lock_guard<mutex> lock(_mvkCallRecordRegistryLock);
+	_mvkCallRecordFuncNames.push_back(funcName);
+	return (uint32_t)_mvkCallRecordFuncNames.size() - 1;
+}
+
+// Returns the recording buffer of the calling thread, creating and registering it on first use.
+// Buffers are never freed, so they remain available to be written after their threads exit.
+static MVKCallRecordBuffer* mvkGetThreadCallRecordBuffer() {
+	if ( !_mvkThreadCallRecordBuffer ) {
+		auto* pRecBuff = new MVKCallRecordBuffer();
+		pRecBuff->threadID = pthread_mach_thread_np(pthread_self());
+		lock_guard<mutex> lock(_mvkCallRecordRegistryLock);
+		_mvkCallRecordBuffers.push_back(pRecBuff);
+		_mvkThreadCallRecordBuffer = pRecBuff;
+	}
+	return _mvkThreadCallRecordBuffer;
+}
+
+// The state is checked while the buffer is locked, so no call
+// can be added to the buffer once the recording has been written.
+MVKCallRecordBuffer* mvkBeginVulkanCallRecord(bool isFrameCall) {
+	MVKCallRecordBuffer* pRecBuff = mvkGetThreadCallRecordBuffer();
+	pRecBuff->lock.lock();
+
+	uint32_t state = _mvkCallRecordState.load(memory_order_acquire);
+	if ( !(state == MVKCallRecordStateRecordingFrames || (state == MVKCallRecordStateRecordingSetup && !isFrameCall)) ) {
+		pRecBuff->lock.unlock();
+		return nullptr;
+	}
+
+	pRecBuff->data.resize(pRecBuff->data.size() + sizeof(MVKCallRecordHeader));
+	return pRecBuff;
+}
+
+void mvkEndVulkanCallRecord(MVKCallRecordBuffer* pRecBuff, size_t recOffset, uint32_t funcIndex, uint64_t startTime) {
+	size_t recSize = pRecBuff->data.size() - recOffset;
+	if (_mvkCallRecordSize.fetch_add(recSize) + recSize > kMVKMaxVulkanCallRecordSize) {
+		_mvkCallRecordSize -= recSize;
+		_mvkCallRecordDroppedCount++;
+		pRecBuff->data.resize(recOffset);
+		pRecBuff->lock.unlock();
+		return;
+	}
+
+	uint64_t endTime = mvkGetTimestamp();
+	uint32_t frameIdx = _mvkCallRecordFrameIndex;
+	double tsPeriod = mvkGetTimestampPeriod();
+
+	MVKCallRecordHeader callHdr;
+	callHdr.sequence = _mvkCallRecordSequence++;
+	callHdr.startTime = (uint64_t)((startTime - _mvkCallRecordStartTime) * tsPeriod);
+	callHdr.duration = (uint64_t)((endTime - startTime) * tsPeriod);
+	callHdr.funcIndex = funcIndex;
+	callHdr.threadID = pRecBuff->threadID;
+	callHdr.frameIndex = (frameIdx >= _mvkCallRecordStartFrame) ? frameIdx - _mvkCallRecordStartFrame : kMVKCallRecordSetupFrame;
+	callHdr.paramSize = (uint32_t)(recSize - sizeof(MVKCallRecordHeader));
+	memcpy(&pRecBuff->data[recOffset], &callHdr, sizeof(callHdr));
+
+	pRecBuff->lock.unlock();
+}
+
+void mvkEndVulkanCallRecordFrame() {
+	uint32_t state = mvkGetVulkanCallRecordState();
+	if ( !(state == MVKCallRecordStateRecordingSetup || state == MVKCallRecordStateRecordingFrames) ) { return; }
+
+	uint32_t frameIdx = ++_mvkCallRecordFrameIndex;
+	if (frameIdx == _mvkCallRecordStartFrame) {
+		uint32_t setupState = MVKCallRecordStateRecordingSetup;
+		_mvkCallRecordState.compare_exchange_strong(setupState, MVKCallRecordStateRecordingFrames);
+	}
+	if (frameIdx == _mvkCallRecordStartFrame + _mvkCallRecordFrameCount) { mvkStopRecordingVulkanCalls(); }
+}
+
+// The location and size of a single recorded call within the recording buffer of a thread.
+typedef struct {
+	uint64_t sequence;
+	const uint8_t* pRecord;
+	size_t size;
+} MVKCallRecordLocation;
+
+// The recorded calls of all threads are written in the order in which they completed.
+// The file format is described in MVKCallRecord.h.
+void mvkStopRecordingVulkanCalls() {
+	uint32_t state = mvkGetVulkanCallRecordState();
+	while (state == MVKCallRecordStateRecordingSetup || state == MVKCallRecordStateRecordingFrames) {
+		if (_mvkCallRecordState.compare_exchange_weak(state, MVKCallRecordStateFinished)) { break; }
+	}
+	if ( !(state == MVKCallRecordStateRecordingSetup || state == MVKCallRecordStateRecordingFrames) ) { return; }
+
+	lock_guard<mutex> lock(_mvkCallRecordRegistryLock);
+
+	// Wait for each thread to finish recording any call in progress.
+	vector<MVKCallRecordLocation> callLocs;
+	uint32_t threadCnt = 0;
+	for (auto* pRecBuff : _mvkCallRecordBuffers) {
+		lock_guard<mutex> buffLock(pRecBuff->lock);
+		if ( !pRecBuff->data.empty() ) { threadCnt++; }
+		const uint8_t* pData = pRecBuff->data.data();
+		size_t dataSize = pRecBuff->data.size();
+		size_t offset = 0;
+		while (offset + sizeof(MVKCallRecordHeader) <= dataSize) {
+			MVKCallRecordHeader callHdr;
+			memcpy(&callHdr, pData + offset, sizeof(callHdr));
+			size_t recSize = sizeof(MVKCallRecordHeader) + callHdr.paramSize;
+			callLocs.push_back({ callHdr.sequence, pData + offset, recSize });
+			offset += recSize;
+		}
+	}
+	sort(callLocs.begin(), callLocs.end(), [](const MVKCallRecordLocation& a, const MVKCallRecordLocation& b) { return a.sequence < b.sequence; });
+
+	uint32_t frameIdx = _mvkCallRecordFrameIndex;
+	@autoreleasepool {
+		NSString* path = [@(_mvkCallRecordFile.c_str()) stringByExpandingTildeInPath];
+		FILE* pFile = fopen(path.UTF8String, "wb");
+		if (pFile) {
+			MVKCallRecordFileHeader fileHdr;
+			memcpy(fileHdr.signature, kMVKCallRecordSignature, sizeof(fileHdr.signature));
+			fileHdr.formatVersion = kMVKCallRecordFormatVersion;
+			fileHdr.frameCount = (frameIdx > _mvkCallRecordStartFrame) ? min(frameIdx - _mvkCallRecordStartFrame, _mvkCallRecordFrameCount) : 0;
+			fileHdr.funcCount = (uint32_t)_mvkCallRecordFuncNames.size();
+			fileHdr.threadCount = threadCnt;
+			fileHdr.callCount = callLocs.size();
+			fileHdr.droppedCount = _mvkCallRecordDroppedCount;
+			fwrite(&fileHdr, sizeof(fileHdr), 1, pFile);
+			for (const char* funcName : _mvkCallRecordFuncNames) { fwrite(funcName, 1, strlen(funcName) + 1, pFile); }
+			for (auto& callLoc : callLocs) { fwrite(callLoc.pRecord, 1, callLoc.size, pFile); }
+			fclose(pFile);
+			MVKLogInfo("Recorded %llu Vulkan calls over %d frames to %s.", fileHdr.callCount, fileHdr.frameCount, path.UTF8String);
+		} else {
+			MVKLogError("Could not open Vulkan call recording file %s.", path.UTF8String);
+		}
+	}
+
+	for (auto* pRecBuff : _mvkCallRecordBuffers) {
+		lock_guard<mutex> buffLock(pRecBuff->lock);
+		vector<uint8_t>().swap(pRecBuff->data);
+	}
+}
@@ -20,6 +20,8 @@
 
 #include "MVKQueue.h"
 
+#include <string>
+
 #import <Metal/Metal.h>
 
 
@@ -48,6 +50,14 @@ public:
 	/** Makes this instance the default capture scope within Xcode. */
 	void makeDefault();
 
+	/**
+	 * Starts a GPU capture that covers the next scope of this instance, beginning when beginScope()
+	 * is next called, and ending with the following call to endScope(). The capture is saved to the
+	 * file, if it is not empty, or is captured to Xcode otherwise. Returns whether the capture was
+	 * started, which requires MTLCaptureScope support, and that no other GPU capture is in progress.
+	 */
+	bool captureNextScope(const std::string& outputFile);
+
 	/**
 	 * Constructs an instance for the specified queue and purpose.
 	 *
@@ -56,6 +56,36 @@ void MVKGPUCaptureScope::makeDefault() {
 	}
 }
 
+bool MVKGPUCaptureScope::captureNextScope(const std::string& outputFile) {
+	MTLCaptureManager* captureMgr = [MTLCaptureManager sharedCaptureManager];
+	if ( !_mtlCaptureScope || captureMgr.isCapturing ) { return false; }
+
+	if ( ![captureMgr respondsToSelector: @selector(startCaptureWithDescriptor:error:)] ) {
+		[captureMgr startCaptureWithScope: _mtlCaptureScope];
+		return true;
+	}
+
+	MTLCaptureDescriptor* captureDesc = [MTLCaptureDescriptor new];		// temp retain
+	captureDesc.captureObject = _mtlCaptureScope;
+	if ( !outputFile.empty() ) {
+		if ([captureMgr supportsDestination: MTLCaptureDestinationGPUTraceDocument]) {
+			NSString* path = [NSString stringWithUTF8String: outputFile.c_str()];
+			captureDesc.destination = MTLCaptureDestinationGPUTraceDocument;
+			captureDesc.outputURL = [NSURL fileURLWithPath: path.stringByExpandingTildeInPath];
+		} else {
+			reportError(VK_ERROR_FEATURE_NOT_PRESENT, "Capturing GPU traces to a file requires macOS 10.15 or iOS 13.0. Falling back to Xcode GPU capture.");
+		}
+	}
+
+	NSError* err = nil;
+	bool isStarted = [captureMgr startCaptureWithDescriptor: captureDesc error: &err];
+	if ( !isStarted ) {
+		reportError(VK_ERROR_INITIALIZATION_FAILED, "Failed to start GPU capture session to %s (Error code %li): %s", outputFile.c_str(), (long)err.code, err.localizedDescription.UTF8String);
+	}
+	[captureDesc release];												// temp release
+	return isStarted;
+}
+
 MVKGPUCaptureScope::MVKGPUCaptureScope(MVKQueue* mvkQueue, const char* purpose) : _queue(mvkQueue) {
 	_mtlQueue = [_queue->getMTLCommandQueue() retain];	// retained
 	if (mvkOSVersionIsAtLeast(kMinOSVersionMTLCaptureScope)) {
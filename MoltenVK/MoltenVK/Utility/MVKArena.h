@@ -0,0 +1,113 @@
+/*
+ * MVKArena.h
+ *
+ * Copyright (c) 2015-2020 The Brenwill Workshop Ltd. (http://www.brenwill.com)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "MVKFoundation.h"
+#include <vector>
+#include <new>
+#include <utility>
+#include <stdlib.h>
+
+
+#pragma mark -
+#pragma mark MVKArena
+
+/**
+ * A linear bump-pointer arena, holding objects of any type constructed in place,
+ * one after another in allocation order, within large memory blocks.
+ *
+ * The arena does not track or destroy the objects it holds. The owner must invoke the
+ * destructor of each object before calling reset(), which rewinds the arena in one
+ * operation, while retaining the memory blocks for reuse by subsequent allocations.
+ *
+ * Access to this arena is not thread-safe. Owners rely on the external synchronization
+ * that Vulkan requires of the object holding the arena.
+ */
+class MVKArena {
+
+public:
+
+	/** The default size of each memory block, in bytes. */
+	static const size_t kMVKArenaBlockSize = 16 * KIBI;
+
+	/** Constructs and returns a new object of the specified type within this arena, using the specified constructor arguments. */
+	template <class T, class... Args>
+	T* newObject(Args&&... args) { return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...); }
+
+	/** Returns an uninitialized array of the specified number of elements of the specified type within this arena. */
+	template <class T>
+	T* newArray(size_t count) { return (T*)allocate(sizeof(T) * count, alignof(T)); }
+
+	/** Rewinds this arena to empty, retaining the memory blocks for reuse. */
+	void reset() {
+		_blockIndex = 0;
+		_blockOffset = 0;
+	}
+
+	/** Rewinds this arena to empty, and releases all memory blocks back to the system. */
+	void trim() {
+		for (auto& blk : _blocks) { free(blk.pMem); }
+		_blocks.clear();
+		reset();
+	}
+
+	/**
+	 * Constructs an instance. The first memory block, allocated on first use, is at least
+	 * as large as the specified size, which allows an owner that knows its maximum content
+	 * to hold all of that content in a single block.
+	 */
+	MVKArena(size_t firstBlockSize = kMVKArenaBlockSize) : _firstBlockSize(firstBlockSize) {}
+
+	MVKArena(const MVKArena&) = delete;
+	MVKArena& operator=(const MVKArena&) = delete;
+
+	~MVKArena() { trim(); }
+
+protected:
+	typedef struct {
+		void* pMem;
+		size_t size;
+	} MVKArenaBlock;
+
+	// Returns aligned memory of the specified size, moving to the next block, or adding a new block, if needed.
+	void* allocate(size_t size, size_t alignment) {
+		while (_blockIndex < _blocks.size()) {
+			auto& blk = _blocks[_blockIndex];
+			size_t offset = mvkAlignByteCount(_blockOffset, alignment);
+			if (offset + size <= blk.size) {
+				_blockOffset = offset + size;
+				return (char*)blk.pMem + offset;
+			}
+			_blockIndex++;
+			_blockOffset = 0;
+		}
+
+		// malloc() memory is suitably aligned for any fundamental type.
+		size_t blkSize = std::max(size, _blocks.empty() ? _firstBlockSize : kMVKArenaBlockSize);
+		_blocks.push_back({ malloc(blkSize), blkSize });
+		_blockIndex = _blocks.size() - 1;
+		_blockOffset = size;
+		return _blocks.back().pMem;
+	}
+
+	std::vector<MVKArenaBlock> _blocks;
+	size_t _firstBlockSize;
+	size_t _blockIndex = 0;
+	size_t _blockOffset = 0;
+};
@@ -21,6 +21,7 @@
 
 #include <algorithm>
 #include <simd/simd.h>
+#include <dispatch/dispatch.h>
 
 
 using simd::float3;
@@ -30,56 +31,135 @@ using simd::select;
 
 static uint32_t pack_float_to_unorm4x8(float4 x) {
 	return ((((uint8_t)(x.r * 255)) & 0x000000ff) | ((((uint8_t)(x.g * 255)) << 8) & 0x0000ff00) |
-		((((uint8_t)(x.b * 255)) & 0x00ff0000) << 16) | ((((uint8_t)(x.a * 255)) << 24) & 0xff000000));
+		((((uint8_t)(x.b * 255)) << 16) & 0x00ff0000) | ((((uint8_t)(x.a * 255)) << 24) & 0xff000000));
 }
 
+// Matches the MSL function, which unpacks the least significant bits into the first component.
+// DXTn colours therefore decode into BGRA component order in both the CPU and GPU decoders.
 static float3 unpack_unorm565_to_float(uint16_t x) {
-	return simd::make_float3(((x >> 11) & 0x1f) / 31.0f, ((x >> 5) & 0x3f) / 63.0f, (x & 0x1f) / 31.0f);
+	return simd::make_float3((x & 0x1f) / 31.0f, ((x >> 5) & 0x3f) / 63.0f, ((x >> 11) & 0x1f) / 31.0f);
 }
 
 
-/** Texture codec for DXTn (i.e. BC[1-3]) compressed data.
+// Rows of blocks are decoded in parallel, in groups of this many block rows.
+static const uint32_t kMVKDXTnBlockRowsPerTask = 8;
+
+/** Texture codec for DXTn (i.e. BC[1-3]) and RGTC (i.e. BC[4-5]) compressed data.
  *
  * This implementation is largely derived from Wine, from code originally
  * written by Connor McAdams.
+ *
+ * Rather than evaluating each texel, a packed palette of the colours and alphas of
+ * each block is built once, using SIMD vector arithmetic, and each texel is then a
+ * lookup into that palette. Groups of block rows in each slice are decoded in parallel.
  */
 class MVKDXTnCodec : public MVKCodec {
 
 public:
 
 	void decompress(void* pDest, const void* pSrc, const VkSubresourceLayout& destLayout, const VkSubresourceLayout& srcLayout, VkExtent3D extent) override {
-		VkDeviceSize blockByteCount;
-		const uint8_t* pSrcRow;
-		const uint8_t* pSrcSlice = (const uint8_t*)pSrc;
-		uint8_t* pDestRow;
-		uint8_t* pDestSlice = (uint8_t*)pDest;
-
-		blockByteCount = isBC1Format(_format) ? 8 : 16;
-
-		for (uint32_t z = 0; z < extent.depth; ++z) {
-			pSrcRow = pSrcSlice;
-			pDestRow = pDestSlice;
-			for (uint32_t y = 0; y < extent.height; y += 4) {
-				for (uint32_t x = 0; x < extent.width; x += 4) {
-					VkExtent2D blockExtent;
-					blockExtent.width = std::min(extent.width - x, 4u);
-					blockExtent.height = std::min(extent.height - y, 4u);
-					decompressDXTnBlock(pSrcRow + x * (blockByteCount / 4),
-						pDestRow + x * 4, blockExtent, destLayout.rowPitch, _format);
-				}
-				pSrcRow += srcLayout.rowPitch;
-				pDestRow += destLayout.rowPitch * 4;
+		uint32_t blockRowCnt = mvkCeilingDivide(extent.height, 4u);
+		uint32_t tasksPerSlice = mvkCeilingDivide(blockRowCnt, kMVKDXTnBlockRowsPerTask);
+		size_t taskCnt = tasksPerSlice * extent.depth;
+
+		auto decompressTask = ^(size_t taskIdx) {
+			uint32_t z = (uint32_t)(taskIdx / tasksPerSlice);
+			uint32_t firstBlockRow = (uint32_t)(taskIdx % tasksPerSlice) * kMVKDXTnBlockRowsPerTask;
+			uint32_t lastBlockRow = std::min(firstBlockRow + kMVKDXTnBlockRowsPerTask, blockRowCnt);
+			const uint8_t* pSrcSlice = (const uint8_t*)pSrc + z * srcLayout.depthPitch;
+			uint8_t* pDestSlice = (uint8_t*)pDest + z * destLayout.depthPitch;
+			for (uint32_t blockRow = firstBlockRow; blockRow < lastBlockRow; blockRow++) {
+				decompressBlockRow(pSrcSlice + blockRow * srcLayout.rowPitch,
+								   pDestSlice + blockRow * destLayout.rowPitch * 4,
+								   extent, blockRow * 4, destLayout.rowPitch);
 			}
-			pSrcSlice += srcLayout.depthPitch;
-			pDestSlice += destLayout.depthPitch;
+		};
+
+		if (taskCnt > 1) {
+			dispatch_apply(taskCnt, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), decompressTask);
+		} else if (taskCnt == 1) {
+			decompressTask(0);
 		}
 	}
 
 	/** Constructs an instance. */
-	MVKDXTnCodec(VkFormat format) : _format(format) {}
+	MVKDXTnCodec(VkFormat format) : _format(format) {
+		_blockByteCount = getDXTnBlockByteCount(_format);
+		for (uint32_t i = 0; i < 16; i++) { _bc2AlphaTable[i] = ((uint32_t)(uint8_t)((i / 15.0f) * 255)) << 24; }
+	}
 
 private:
 
+	void decompressBlockRow(const uint8_t* pSrcRow, uint8_t* pDestRow, VkExtent3D extent, uint32_t y, VkDeviceSize destRowPitch) {
+		for (uint32_t x = 0; x < extent.width; x += 4) {
+			VkExtent2D blockExtent;
+			blockExtent.width = std::min(extent.width - x, 4u);
+			blockExtent.height = std::min(extent.height - y, 4u);
+			decodeDXTnBlock(pSrcRow + x * (_blockByteCount / 4), pDestRow + x * 4, blockExtent, destRowPitch);
+		}
+	}
+
+	// Produces the same texels as decompressDXTnBlock(), by building packed palettes per block.
+	void decodeDXTnBlock(const void* pSrc, void* pDest, VkExtent2D extent, VkDeviceSize destRowPitch) {
+		if (isBC4Format(_format) || isBC5Format(_format)) {
+			decompressRGTCBlock(pSrc, pDest, extent, destRowPitch, _format);
+			return;
+		}
+
+		const uint32_t* pSrcBlock = (const uint32_t*)pSrc;
+		float3 colourTable[4];
+		float alphaTable[8];
+		uint32_t packedColours[4];
+		uint32_t packedAlphas[8];
+		uint64_t alphaBits = 0;
+		uint32_t colourBits;
+		bool isBC1 = isBC1Format(_format);
+		bool isBC2 = isBC2Format(_format);
+
+		if (isBC1) {
+			uint16_t colour0 = pSrcBlock[0] & 0xffff;
+			uint16_t colour1 = pSrcBlock[0] >> 16;
+			colourBits = pSrcBlock[1];
+			buildDXTnColourTable(colour0, colour1, colourTable, _format);
+			packDXTnColourTable(colourTable, packedColours, 0xff000000);
+			if (colour0 <= colour1) { packedColours[3] &= 0x00ffffff; }
+		} else {
+			alphaBits = pSrcBlock[0] | ((uint64_t)pSrcBlock[1] << 32);
+			if ( !isBC2 ) {
+				buildDXT5AlphaTable(alphaBits & 0xff, (alphaBits >> 8) & 0xff, alphaTable);
+				for (uint32_t i = 0; i < 8; i++) { packedAlphas[i] = ((uint32_t)(uint8_t)(alphaTable[i] * 255)) << 24; }
+				alphaBits >>= 16;
+			}
+			colourBits = pSrcBlock[3];
+			buildDXTnColourTable(pSrcBlock[2] & 0xffff, pSrcBlock[2] >> 16, colourTable, _format);
+			packDXTnColourTable(colourTable, packedColours, 0);
+		}
+
+		for (uint32_t y = 0; y < extent.height; ++y) {
+			uint32_t* pDestTexels = (uint32_t*)((uint8_t*)pDest + y * destRowPitch);
+			for (uint32_t x = 0; x < extent.width; ++x) {
+				uint32_t texel = packedColours[(colourBits >> (y * 8 + x * 2)) & 0x3];
+				if (isBC2) {
+					texel |= _bc2AlphaTable[(alphaBits >> (y * 16 + x * 4)) & 0xf];
+				} else if ( !isBC1 ) {
+					texel |= packedAlphas[(alphaBits >> (y * 12 + x * 3)) & 0x7];
+				}
+				pDestTexels[x] = texel;
+			}
+		}
+	}
+
+	// Converts each colour to linear if needed, and packs it, along with the alpha bits.
+	void packDXTnColourTable(float3* pColourTable, uint32_t* pPackedColours, uint32_t alphaBits) {
+		bool isSRGB = isSRGBFormat(_format);
+		for (uint32_t i = 0; i < 4; i++) {
+			float4 colour;
+			colour.rgb = isSRGB ? sRGBCorrect(pColourTable[i]) : pColourTable[i];
+			colour.a = 0;
+			pPackedColours[i] = pack_float_to_unorm4x8(colour) | alphaBits;
+		}
+	}
+
 #define constant const
 #define device
 #define thread
@@ -88,6 +168,8 @@ private:
 #undef MVK_DECOMPRESS_CODE
 
 	VkFormat _format;
+	VkDeviceSize _blockByteCount;
+	uint32_t _bc2AlphaTable[16];
 };
 
 std::unique_ptr<MVKCodec> mvkCreateCodec(VkFormat format) {
@@ -100,6 +182,8 @@ std::unique_ptr<MVKCodec> mvkCreateCodec(VkFormat format) {
 	case VK_FORMAT_BC2_SRGB_BLOCK:
 	case VK_FORMAT_BC3_UNORM_BLOCK:
 	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
 		return std::unique_ptr<MVKCodec>(new MVKDXTnCodec(format));
 
 	default:
@@ -117,6 +201,8 @@ bool mvkCanDecodeFormat(VkFormat format) {
 	case VK_FORMAT_BC2_SRGB_BLOCK:
 	case VK_FORMAT_BC3_UNORM_BLOCK:
 	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
 		return true;
 
 	default:
@@ -162,10 +162,24 @@
  */
 #define MVK_CONFIG_AUTO_GPU_CAPTURE_SCOPE_NONE		0
 #define MVK_CONFIG_AUTO_GPU_CAPTURE_SCOPE_DEVICE	1
+#define MVK_CONFIG_AUTO_GPU_CAPTURE_SCOPE_SLOW_FRAME	2
 #ifndef MVK_CONFIG_AUTO_GPU_CAPTURE_SCOPE
 #   define MVK_CONFIG_AUTO_GPU_CAPTURE_SCOPE    	MVK_CONFIG_AUTO_GPU_CAPTURE_SCOPE_NONE
 #endif
 
+/**
+ * When automatically capturing slow frames, the number of milliseconds of CPU frame interval
+ * or GPU busy time, above which a frame is considered slow, and the next frame is captured.
+ */
+#ifndef MVK_CONFIG_AUTO_GPU_CAPTURE_SLOW_FRAME_THRESHOLD
+#   define MVK_CONFIG_AUTO_GPU_CAPTURE_SLOW_FRAME_THRESHOLD    50
+#endif
+
+/** When automatically capturing slow frames, the maximum number of frames to capture. */
+#ifndef MVK_CONFIG_AUTO_GPU_CAPTURE_MAX_FRAME_COUNT
+#   define MVK_CONFIG_AUTO_GPU_CAPTURE_MAX_FRAME_COUNT    1
+#endif
+
 /**
  * The file to capture automatic GPU traces to, instead of capturing to Xcode. This is
  * useful when trying to capture a one-shot trace, but the program cannot be run under
@@ -177,6 +191,32 @@
 #	define MVK_CONFIG_AUTO_GPU_CAPTURE_OUTPUT_FILE	""
 #endif
 
+/**
+ * The directory in which to cache the results of converting SPIR-V shader code to MSL,
+ * across all devices, and across successive runs of the app. Tilde paths may be used to
+ * place the directory in a user's home directory. If left blank, no shader disk cache is used.
+ */
+#ifndef MVK_CONFIG_SHADER_DISK_CACHE_PATH
+#	define MVK_CONFIG_SHADER_DISK_CACHE_PATH	""
+#endif
+
+/**
+ * The maximum size, in bytes, of the shader disk cache. When this size is exceeded,
+ * the least recently used cache entries are removed. Defaults to 64 MB.
+ */
+#ifndef MVK_CONFIG_SHADER_DISK_CACHE_MAX_SIZE
+#	define MVK_CONFIG_SHADER_DISK_CACHE_MAX_SIZE	(64 * 1024 * 1024)
+#endif
+
+/**
+ * The file to which a machine-readable summary of performance statistics is appended when each
+ * VkDevice is destroyed, while performance tracking is enabled. Tilde paths may be used to place
+ * the file in a user's home directory. If left blank, no performance report file is written.
+ */
+#ifndef MVK_CONFIG_PERFORMANCE_REPORT_FILE
+#	define MVK_CONFIG_PERFORMANCE_REPORT_FILE	""
+#endif
+
 /** Force the use of a low-power GPU if it exists. Disabled by default. */
 #ifndef MVK_CONFIG_FORCE_LOW_POWER_GPU
 #   define MVK_CONFIG_FORCE_LOW_POWER_GPU    0
@@ -0,0 +1,271 @@
+/*
+ * MVKFlatHashMap.h
+ *
+ * Copyright (c) 2015-2020 The Brenwill Workshop Ltd. (http://www.brenwill.com)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+#pragma mark -
+#pragma mark MVKFlatHashMap
+
+/**
+ * An open-addressing hash map, using linear probing, that holds its entries in one contiguous
+ * table, instead of allocating a node for each entry, as std::unordered_map does. Alongside
+ * each entry, the table holds a byte of state, containing a fragment of the hash of the key,
+ * so most probes that do not match are rejected without comparing keys.
+ *
+ * The interface follows the commonly used subset of std::unordered_map, and the entries
+ * referenced by iterators have first and second members, like std::pair. Keys and values
+ * must be trivially copyable and default constructible.
+ *
+ * Lookups using find(), count() and get() are lock-free, and may run on any number of threads
+ * concurrently with one thread inserting entries using emplace() or operator[], provided all
+ * inserting threads are serialized by a lock. Concurrent readers see either the value that was
+ * inserted or no entry at all, so a value must not be modified once it may be read concurrently.
+ * When the table grows, the superseded table is retained until clear() or destruction, because
+ * concurrent readers may still be probing it. All other operations, including modifying a value,
+ * erase(), clear() and iteration, require exclusive access to the map.
+ */
+template<class K, class V, class H = std::hash<K>>
+class MVKFlatHashMap {
+
+	static_assert(std::is_trivially_copyable<K>::value, "MVKFlatHashMap keys must be trivially copyable.");
+	static_assert(std::is_trivially_copyable<V>::value, "MVKFlatHashMap values must be trivially copyable.");
+
+public:
+
+	/** An entry in the map. */
+	struct Entry {
+		K first;
+		V second;
+	};
+
+protected:
+
+	static const uint8_t kEmpty = 0;
+	static const uint8_t kErased = 1;
+	static const uint8_t kFull = 0x80;		// Low 7 bits hold a fragment of the key hash
+	static const uint32_t kMinCapacityLog2 = 3;
+
+	struct Table {
+		std::atomic<uint8_t>* states;
+		Entry* entries;
+		size_t capacity;
+		uint32_t capacityLog2;
+
+		Table(uint32_t capLog2) : capacity(size_t(1) << capLog2), capacityLog2(capLog2) {
+			states = new std::atomic<uint8_t>[capacity];
+			for (size_t i = 0; i < capacity; i++) { states[i].store(kEmpty, std::memory_order_relaxed); }
+			entries = new Entry[capacity];
+		}
+		~Table() {
+			delete[] states;
+			delete[] entries;
+		}
+	};
+
+public:
+
+	/** Iterates the entries in the map. */
+	class iterator {
+
+	public:
+		Entry& operator*() const { return _table->entries[_index]; }
+		Entry* operator->() const { return &_table->entries[_index]; }
+		iterator& operator++() { _index++; skipToFull(); return *this; }
+		bool operator==(const iterator& it) const { return _table == it._table && _index == it._index; }
+		bool operator!=(const iterator& it) const { return !(*this == it); }
+
+	protected:
+		friend class MVKFlatHashMap;
+
+		iterator(Table* table, size_t index) : _table(table), _index(index) { skipToFull(); }
+
+		// Moves to the next full slot, or to the end iterator, if there are no more entries.
+		void skipToFull() {
+			if ( !_table ) { return; }
+			while (_index < _table->capacity && !isFull(_table->states[_index].load(std::memory_order_relaxed))) { _index++; }
+			if (_index >= _table->capacity) { _table = nullptr; _index = 0; }
+		}
+
+		Table* _table;
+		size_t _index;
+	};
+
+	iterator begin() { return iterator(_table.load(std::memory_order_relaxed), 0); }
+	iterator end() { return iterator(nullptr, 0); }
+
+	/** Returns the number of entries in the map. */
+	size_t size() const { return _size; }
+
+	/** Returns whether the map contains no entries. */
+	bool empty() const { return _size == 0; }
+
+	/** Returns an iterator referencing the entry with the key, or end() if it does not exist. Lock-free. */
+	iterator find(const K& key) {
+		uint64_t hash = getHash(key);
+		Table* table = _table.load(std::memory_order_acquire);
+		size_t idx = findIndex(table, key, hash);
+		return (idx < table->capacity) ? iterator(table, idx) : end();
+	}
+
+	/** Returns 1 if the map contains an entry with the key, or 0 otherwise. Lock-free. */
+	size_t count(const K& key) const {
+		uint64_t hash = getHash(key);
+		Table* table = _table.load(std::memory_order_acquire);
+		return (findIndex(table, key, hash) < table->capacity) ? 1 : 0;
+	}
+
+	/** Returns a copy of the value with the key, or the default value if it does not exist. Lock-free. */
+	V get(const K& key, const V& defaultValue = V()) const {
+		uint64_t hash = getHash(key);
+		Table* table = _table.load(std::memory_order_acquire);
+		size_t idx = findIndex(table, key, hash);
+		return (idx < table->capacity) ? table->entries[idx].second : defaultValue;
+	}
+
+	/**
+	 * Inserts an entry with the key and value, if the map does not already contain the key.
+	 * Returns an iterator to the entry with the key, and whether the entry was inserted.
+	 */
+	std::pair<iterator, bool> emplace(const K& key, const V& value) {
+		uint64_t hash = getHash(key);
+		Table* table = _table.load(std::memory_order_relaxed);
+
+		size_t idx = findIndex(table, key, hash);
+		if (idx < table->capacity) { return std::make_pair(iterator(table, idx), false); }
+
+		// Keep the table at most three quarters full, counting erased slots, which lengthen probes.
+		if ((_size + _erasedCount + 1) * 4 > table->capacity * 3) { table = grow(); }
+
+		idx = insertIndex(table, hash);
+		if (table->states[idx].load(std::memory_order_relaxed) == kErased) { _erasedCount--; }
+		table->entries[idx] = { key, value };
+		table->states[idx].store(kFull | getHashFragment(hash), std::memory_order_release);
+		_size++;
+		return std::make_pair(iterator(table, idx), true);
+	}
+
+	/** Returns a reference to the value with the key, inserting a default value if it does not exist. */
+	V& operator[](const K& key) { return emplace(key, V()).first->second; }
+
+	/** Removes the entry referenced by the iterator, and returns an iterator to the next entry. */
+	iterator erase(iterator it) {
+		it._table->states[it._index].store(kErased, std::memory_order_relaxed);
+		_size--;
+		_erasedCount++;
+		return ++it;
+	}
+
+	/** Removes the entry with the key, if it exists, and returns the number of entries removed. */
+	size_t erase(const K& key) {
+		auto it = find(key);
+		if (it == end()) { return 0; }
+		erase(it);
+		return 1;
+	}
+
+	/** Removes all entries, retaining the current table capacity. */
+	void clear() {
+		Table* table = _table.load(std::memory_order_relaxed);
+		for (size_t i = 0; i < table->capacity; i++) { table->states[i].store(kEmpty, std::memory_order_relaxed); }
+		_size = 0;
+		_erasedCount = 0;
+		freeRetiredTables();
+	}
+
+	MVKFlatHashMap() : _table(new Table(kMinCapacityLog2)) {}
+
+	MVKFlatHashMap(const MVKFlatHashMap& other) = delete;
+
+	MVKFlatHashMap& operator=(const MVKFlatHashMap& other) = delete;
+
+	~MVKFlatHashMap() {
+		delete _table.load(std::memory_order_relaxed);
+		freeRetiredTables();
+	}
+
+protected:
+	static bool isFull(uint8_t state) { return (state & kFull) != 0; }
+
+	// Fibonacci hashing spreads the bits of hash functions that return the key itself,
+	// such as std::hash on integers. The table index is taken from the high bits.
+	static uint64_t getHash(const K& key) { return uint64_t(H()(key)) * 0x9E3779B97F4A7C15ull; }
+	static uint8_t getHashFragment(uint64_t hash) { return uint8_t(hash & 0x7F); }
+	static size_t getStartIndex(const Table* table, uint64_t hash) { return size_t(hash >> (64 - table->capacityLog2)); }
+
+	// Returns the index of the entry with the key, or the table capacity if it does not exist.
+	static size_t findIndex(const Table* table, const K& key, uint64_t hash) {
+		size_t mask = table->capacity - 1;
+		uint8_t fullState = kFull | getHashFragment(hash);
+		for (size_t idx = getStartIndex(table, hash), probeCnt = 0; probeCnt < table->capacity; idx = (idx + 1) & mask, probeCnt++) {
+			uint8_t state = table->states[idx].load(std::memory_order_acquire);
+			if (state == kEmpty) { break; }
+			if (state == fullState && table->entries[idx].first == key) { return idx; }
+		}
+		return table->capacity;
+	}
+
+	// Returns the index of the first slot, along the probe sequence of the hash, that is not full.
+	static size_t insertIndex(const Table* table, uint64_t hash) {
+		size_t mask = table->capacity - 1;
+		size_t idx = getStartIndex(table, hash);
+		while (isFull(table->states[idx].load(std::memory_order_relaxed))) { idx = (idx + 1) & mask; }
+		return idx;
+	}
+
+	// Rehashes the entries into a new table that is at most half full, publishes it to readers,
+	// and retires the old table, which readers may still be probing. Returns the new table.
+	Table* grow() {
+		Table* oldTable = _table.load(std::memory_order_relaxed);
+		uint32_t capLog2 = kMinCapacityLog2;
+		while ((size_t(1) << capLog2) < (_size + 1) * 2) { capLog2++; }
+
+		Table* newTable = new Table(capLog2);
+		for (size_t i = 0; i < oldTable->capacity; i++) {
+			if (isFull(oldTable->states[i].load(std::memory_order_relaxed))) {
+				Entry& entry = oldTable->entries[i];
+				uint64_t hash = getHash(entry.first);
+				size_t idx = insertIndex(newTable, hash);
+				newTable->entries[idx] = entry;
+				newTable->states[idx].store(kFull | getHashFragment(hash), std::memory_order_relaxed);
+			}
+		}
+		_table.store(newTable, std::memory_order_release);
+		_retiredTables.push_back(oldTable);
+		_erasedCount = 0;
+		return newTable;
+	}
+
+	void freeRetiredTables() {
+		for (Table* table : _retiredTables) { delete table; }
+		_retiredTables.clear();
+	}
+
+	std::atomic<Table*> _table;
+	std::vector<Table*> _retiredTables;
+	size_t _size = 0;
+	size_t _erasedCount = 0;
+};
@@ -17,6 +17,7 @@
  */
 
 #include "MVKFoundation.h"
+#include <stdio.h>
 
 
 #define CASE_STRINGIFY(V)  case V: return #V
@@ -60,6 +61,34 @@ const char* mvkVkResultName(VkResult vkResult) {
 	}
 }
 
+std::string mvkGetJSONEscapedString(const char* str) {
+	std::string escStr;
+	if ( !str ) { return escStr; }
+
+	for (const char* pChar = str; *pChar; pChar++) {
+		unsigned char c = *pChar;
+		switch (c) {
+			case '"':	escStr += "\\\""; break;
+			case '\\':	escStr += "\\\\"; break;
+			case '\b':	escStr += "\\b"; break;
+			case '\f':	escStr += "\\f"; break;
+			case '\n':	escStr += "\\n"; break;
+			case '\r':	escStr += "\\r"; break;
+			case '\t':	escStr += "\\t"; break;
+			default:
+				if (c < 0x20) {
+					char buff[8];
+					snprintf(buff, sizeof(buff), "\\u%04x", c);
+					escStr += buff;
+				} else {
+					escStr += (char)c;
+				}
+				break;
+		}
+	}
+	return escStr;
+}
+
 const char* mvkVkComponentSwizzleName(VkComponentSwizzle swizzle) {
 	switch (swizzle) {
 			CASE_STRINGIFY(VK_COMPONENT_SWIZZLE_IDENTITY);
@@ -75,6 +104,72 @@ const char* mvkVkComponentSwizzleName(VkComponentSwizzle swizzle) {
 }
 
 
+#pragma mark -
+#pragma mark Hashing
+
+// The wyhash algorithm (final version 4), by Wang Yi, released into the public domain.
+static const uint64_t kMVKWyhashSecret[4] = { 0xa0761d6478bd642full, 0xe7037ed1a0b428dbull,
+											   0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull };
+
+static inline void mvkWymum(uint64_t* pA, uint64_t* pB) {
+	__uint128_t r = *pA;
+	r *= *pB;
+	*pA = (uint64_t)r;
+	*pB = (uint64_t)(r >> 64);
+}
+
+static inline uint64_t mvkWymix(uint64_t a, uint64_t b) { mvkWymum(&a, &b); return a ^ b; }
+
+// Unaligned little-endian reads. All Apple platforms are little-endian.
+static inline uint64_t mvkWyr8(const uint8_t* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static inline uint64_t mvkWyr4(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static inline uint64_t mvkWyr3(const uint8_t* p, size_t k) { return (((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8) | p[k - 1]; }
+
+uint64_t mvkHashBytes(const void* pBytes, size_t byteCount, uint64_t seed) {
+	const uint8_t* p = (const uint8_t*)pBytes;
+	const uint64_t* secret = kMVKWyhashSecret;
+	uint64_t a, b;
+
+	seed ^= mvkWymix(seed ^ secret[0], secret[1]);
+	if (byteCount <= 16) {
+		if (byteCount >= 4) {
+			a = (mvkWyr4(p) << 32) | mvkWyr4(p + ((byteCount >> 3) << 2));
+			b = (mvkWyr4(p + byteCount - 4) << 32) | mvkWyr4(p + byteCount - 4 - ((byteCount >> 3) << 2));
+		} else if (byteCount > 0) {
+			a = mvkWyr3(p, byteCount);
+			b = 0;
+		} else {
+			a = b = 0;
+		}
+	} else {
+		size_t i = byteCount;
+		if (i > 48) {
+			// Three independent lanes, so the multiplies of each iteration can overlap.
+			uint64_t see1 = seed, see2 = seed;
+			do {
+				seed = mvkWymix(mvkWyr8(p) ^ secret[1], mvkWyr8(p + 8) ^ seed);
+				see1 = mvkWymix(mvkWyr8(p + 16) ^ secret[2], mvkWyr8(p + 24) ^ see1);
+				see2 = mvkWymix(mvkWyr8(p + 32) ^ secret[3], mvkWyr8(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+			seed ^= see1 ^ see2;
+		}
+		while (i > 16) {
+			seed = mvkWymix(mvkWyr8(p) ^ secret[1], mvkWyr8(p + 8) ^ seed);
+			p += 16;
+			i -= 16;
+		}
+		a = mvkWyr8(p + i - 16);
+		b = mvkWyr8(p + i - 8);
+	}
+	a ^= secret[1];
+	b ^= seed;
+	mvkWymum(&a, &b);
+	return mvkWymix(a ^ secret[0] ^ byteCount, b ^ secret[1]);
+}
+
+
 #pragma mark -
 #pragma mark Alignment functions
 
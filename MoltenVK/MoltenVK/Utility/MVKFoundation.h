@@ -24,6 +24,7 @@
 #include "mvk_vulkan.h"
 #include <algorithm>
 #include <string>
+#include <type_traits>
 #include <simd/simd.h>
 
 
@@ -94,7 +95,10 @@ typedef enum : uint8_t {
     kMVKCommandUseResetQueryPool,           /**< vkCmdResetQueryPool. */
     kMVKCommandUseDispatch,                 /**< vkCmdDispatch. */
     kMVKCommandUseTessellationControl,      /**< vkCmdDraw* - tessellation control stage. */
-    kMVKCommandUseCopyQueryPoolResults      /**< vkCmdCopyQueryPoolResults. */
+    kMVKCommandUseCopyQueryPoolResults,     /**< vkCmdCopyQueryPoolResults. */
+    kMVKCommandUseWriteTimestamp,           /**< vkCmdWriteTimestamp. */
+    kMVKCommandUseBeginQuery,               /**< vkCmdBeginQuery. */
+    kMVKCommandUseEndQuery                  /**< vkCmdEndQuery. */
 } MVKCommandUse;
 
 /** Represents a given stage of a graphics pipeline. */
@@ -110,6 +114,12 @@ const char* mvkVkResultName(VkResult vkResult);
 /** Returns the name of the component swizzle. */
 const char* mvkVkComponentSwizzleName(VkComponentSwizzle swizzle);
 
+/**
+ * Returns the specified string, with quotes, backslashes and control characters escaped,
+ * so that it can be embedded between quotes within JSON content.
+ */
+std::string mvkGetJSONEscapedString(const char* str);
+
 /** Returns the Vulkan API version number as a string. */
 static inline std::string mvkGetVulkanVersionString(uint32_t vkVersion) {
 	std::string verStr;
@@ -353,8 +363,19 @@ T mvkCeilingDivide(T numerator, T denominator) {
 #pragma mark Hashing
 
 /**
- * Returns a hash value calculated from the specified array of numeric elements,
- * using the DJB2a algorithm:  hash = (hash * 33) ^ value.
+ * Returns a 64-bit hash value calculated from the specified bytes, using the wyhash algorithm.
+ * Inputs longer than 48 bytes are consumed in three independent lanes of 16 bytes each,
+ * which keeps several 128-bit multiplies in flight at once, so hashing large inputs,
+ * such as shader code, runs at memory speed.
+ *
+ * To accumulate a single hash value over several blocks of data, use the
+ * hash value returned by previous calls as the seed in subsequent calls.
+ */
+uint64_t mvkHashBytes(const void* pBytes, std::size_t byteCount, uint64_t seed = 0);
+
+/**
+ * Returns a hash value calculated from the contents of the specified array of elements,
+ * which must be of a trivially-copyable type, including any padding they contain.
  *
  * For a hash on a single array, leave the seed value unspecified, to use the default
  * seed value. To accumulate a single hash value over several arrays, use the hash
@@ -362,9 +383,8 @@ T mvkCeilingDivide(T numerator, T denominator) {
  */
 template<class N>
 std::size_t mvkHash(const N* pVals, std::size_t count = 1, std::size_t seed = 5381) {
-    std::size_t hash = seed;
-    for (std::size_t i = 0; i < count; i++) { hash = ((hash << 5) + hash) ^ pVals[i]; }
-    return hash;
+	static_assert(std::is_trivially_copyable<N>::value, "mvkHash() requires elements of a trivially-copyable type.");
+	return (std::size_t)mvkHashBytes(pVals, count * sizeof(N), seed);
 }
 
 
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "MVKBaseObject.h"
+#include <atomic>
 #include <mutex>
 
 
@@ -94,8 +95,8 @@ public:
 		if (_isPooling) { obj = nextObject(); }
 		if ( !obj ) {
 			obj = newObject();
-			_counts.created++;
-			_counts.alive++;
+			_createdCount++;
+			_aliveCount++;
 		}
 
 		return obj;
@@ -119,7 +120,7 @@ public:
 			obj->_next = nullptr;
 			_tail = obj;
 			if ( !_head ) { _head = obj; }
-			_counts.resident++;
+			_residentCount++;
 		} else {
 			destroyObject(obj);
 		}
@@ -143,8 +144,17 @@ public:
 		while ( T* obj = nextObject() ) { destroyObject(obj); }
 	}
 
-	/** Returns the current counts. */
-	MVKObjectPoolCounts getCounts() { return _counts; }
+	/**
+	 * Returns the current counts. This method is thread-safe, and may be called
+	 * from a thread other than that acquiring and returning objects.
+	 */
+	MVKObjectPoolCounts getCounts() {
+		MVKObjectPoolCounts counts;
+		counts.created = _createdCount;
+		counts.alive = _aliveCount;
+		counts.resident = _residentCount;
+		return counts;
+	}
 
 	/**
 	 * Configures this instance to either use pooling, or not, depending on the
@@ -167,7 +177,7 @@ protected:
             _head = (T*)obj->_next;				// Will be null for last object in pool
             if ( !_head ) { _tail = nullptr; }	// If last, also clear tail
             obj->_next = nullptr;				// Objects in the wild should never think they are still part of this pool
-			_counts.resident--;
+			_residentCount--;
         }
         return obj;
     }
@@ -178,13 +188,256 @@ protected:
 	/** Destroys the object. */
 	void destroyObject(T* obj) {
 		obj->destroy();
-		_counts.alive--;
+		_aliveCount--;
 	}
 
     std::mutex _lock;
 	T* _head = nullptr;
 	T* _tail = nullptr;
 	bool _isPooling;
-	MVKObjectPoolCounts _counts;
+	std::atomic<uint64_t> _createdCount{0};
+	std::atomic<uint64_t> _aliveCount{0};
+	std::atomic<uint64_t> _residentCount{0};
 };
 
+
+#pragma mark -
+#pragma mark MVKThreadCachedObjectPool
+
+/** The number of per-thread object magazines in each MVKThreadCachedObjectPool. */
+static const uint32_t kMVKObjectPoolMagazineCount = 16;
+
+/** The number of objects a magazine holds before draining a batch back to the global stack. */
+static const uint32_t kMVKObjectPoolMagazineCapacity = 32;
+
+/**
+ * Returns a small integer identifying the calling thread, which is assigned
+ * the first time a thread calls this function, and does not change thereafter.
+ */
+inline uint32_t mvkGetObjectPoolThreadSlot() {
+	static std::atomic<uint32_t> _nextThreadSlot(0);
+	static thread_local uint32_t _threadSlot = _nextThreadSlot++;
+	return _threadSlot;
+}
+
+/**
+ * Manages a pool of instances of a particular object type, which can be accessed
+ * concurrently from many threads without contending for a single lock.
+ *
+ * Each thread acquires and returns objects through a magazine of objects, which is normally
+ * used only by that thread. When a magazine is empty, it is refilled in a single batch from a
+ * lock-free global stack. When a magazine is full, half of its objects are drained back to the
+ * global stack in a single batch. New objects are created, under a lock, only when both the
+ * magazine and the global stack are empty, so the newObject() function need not be thread-safe.
+ *
+ * The global stack is only ever popped by detaching its entire contents in one atomic exchange,
+ * and pushed by linking a batch in front of the existing contents. Neither operation is
+ * susceptible to the ABA problem that affects lock-free stacks that pop individual objects.
+ *
+ * The objects managed by this pool should derive from MVKLinkableMixin, or otherwise
+ * support a public member variable named "_next", of the same object type, which is
+ * used by this pool to create linked lists of objects.
+ *
+ * The acquire and return functions of this pool are all thread-safe. The clear() function,
+ * and destroying this pool, must not occur concurrently with other access to this pool.
+ * When this pool is destroyed, any objects contained in the pool are also destroyed.
+ */
+template <class T>
+class MVKThreadCachedObjectPool : public MVKBaseObject {
+
+public:
+
+	/**
+	 * Acquires and returns the next available object from the pool, creating it if necessary.
+	 *
+	 * If this instance was configured to use pooling, the object is removed from the pool
+	 * until it is returned back to the pool. If this instance was configured NOT to use
+	 * pooling, the object is created anew on each request, and will be deleted when
+	 * returned back to the pool. This method is thread-safe.
+	 */
+	T* acquireObject() {
+		T* obj = nullptr;
+		if (_isPooling) {
+			MVKObjectMagazine& mag = getMagazine();
+			if ( !mag.isBusy.test_and_set(std::memory_order_acquire) ) {
+				if ( !mag.head ) { refillMagazine(mag); }
+				obj = mag.head;
+				if (obj) {
+					mag.head = (T*)obj->_next;
+					mag.count--;
+				}
+				mag.isBusy.clear(std::memory_order_release);
+			} else {
+				obj = popGlobalObject();	// Another thread shares this magazine and is using it
+			}
+		}
+
+		if (obj) {
+			obj->_next = nullptr;	// Objects in the wild should never think they are still part of this pool
+			_residentCount--;
+		} else {
+			obj = createObject();
+		}
+		return obj;
+	}
+
+	/**
+	 * Returns the specified object back to the pool.
+	 *
+	 * If this instance was configured to use pooling, the returned object is added back
+	 * into the pool. If this instance was configured NOT to use pooling, the returned
+	 * object is simply deleted. This method is thread-safe.
+	 */
+	void returnObject(T* obj) {
+		if ( !obj ) { return; }
+
+		if ( !_isPooling ) {
+			destroyObject(obj);
+			return;
+		}
+
+		_residentCount++;
+		MVKObjectMagazine& mag = getMagazine();
+		if ( !mag.isBusy.test_and_set(std::memory_order_acquire) ) {
+			obj->_next = mag.head;
+			mag.head = obj;
+			if (++mag.count >= kMVKObjectPoolMagazineCapacity) { drainMagazine(mag); }
+			mag.isBusy.clear(std::memory_order_release);
+		} else {
+			obj->_next = nullptr;
+			pushGlobalObjects(obj, obj);	// Another thread shares this magazine and is using it
+		}
+	}
+
+	/** Identical to acquireObject(). Provided for interface compatibility with MVKObjectPool. */
+	T* acquireObjectSafely() { return acquireObject(); }
+
+	/** Identical to returnObject(). Provided for interface compatibility with MVKObjectPool. */
+	void returnObjectSafely(T* obj) { returnObject(obj); }
+
+	/**
+	 * Clears all the objects from this pool, destroying each one.
+	 * This method must not be called concurrently with other access to this pool.
+	 */
+	void clear() {
+		for (auto& mag : _magazines) {
+			destroyObjects(mag.head);
+			mag.head = nullptr;
+			mag.count = 0;
+		}
+		destroyObjects(_globalHead.exchange(nullptr, std::memory_order_acquire));
+	}
+
+	/** Returns the current counts. */
+	MVKObjectPoolCounts getCounts() {
+		MVKObjectPoolCounts counts;
+		counts.created = _createdCount;
+		counts.alive = _aliveCount;
+		counts.resident = _residentCount;
+		return counts;
+	}
+
+	/**
+	 * Configures this instance to either use pooling, or not, depending on the
+	 * value of isPooling, which defaults to true if not indicated explicitly.
+	 */
+	MVKThreadCachedObjectPool(bool isPooling = true) : _isPooling(isPooling) {}
+
+	~MVKThreadCachedObjectPool() override { clear(); }
+
+protected:
+
+	/** A small linked list of objects, normally used by a single thread. */
+	struct alignas(64) MVKObjectMagazine {
+		T* head = nullptr;
+		uint32_t count = 0;
+		std::atomic_flag isBusy = ATOMIC_FLAG_INIT;
+	};
+
+	/** Returns a new instance of the type of object managed by this pool. */
+	virtual T* newObject() = 0;
+
+	// Returns the magazine used by the calling thread.
+	MVKObjectMagazine& getMagazine() {
+		return _magazines[mvkGetObjectPoolThreadSlot() % kMVKObjectPoolMagazineCount];
+	}
+
+	// Moves the entire contents of the global stack into the empty magazine.
+	void refillMagazine(MVKObjectMagazine& mag) {
+		T* obj = _globalHead.exchange(nullptr, std::memory_order_acquire);
+		mag.head = obj;
+		mag.count = 0;
+		while (obj) {
+			mag.count++;
+			obj = (T*)obj->_next;
+		}
+	}
+
+	// Moves the most recently returned half of the objects in the magazine to the global stack.
+	void drainMagazine(MVKObjectMagazine& mag) {
+		uint32_t drainCnt = mag.count / 2;
+		T* first = mag.head;
+		T* last = first;
+		for (uint32_t i = 1; i < drainCnt; i++) { last = (T*)last->_next; }
+		mag.head = (T*)last->_next;
+		mag.count -= drainCnt;
+		pushGlobalObjects(first, last);
+	}
+
+	// Links the batch of objects, from first to last, in front of the contents of the global stack.
+	void pushGlobalObjects(T* first, T* last) {
+		T* head = _globalHead.load(std::memory_order_relaxed);
+		do {
+			last->_next = head;
+		} while ( !_globalHead.compare_exchange_weak(head, first, std::memory_order_release, std::memory_order_relaxed) );
+	}
+
+	// Removes and returns one object from the global stack, or returns null if the global stack
+	// is empty. The entire stack is detached, and any remaining objects are pushed back.
+	T* popGlobalObject() {
+		T* obj = _globalHead.exchange(nullptr, std::memory_order_acquire);
+		if (obj && obj->_next) {
+			T* first = (T*)obj->_next;
+			T* last = first;
+			while (last->_next) { last = (T*)last->_next; }
+			pushGlobalObjects(first, last);
+		}
+		return obj;
+	}
+
+	// Returns a new object. The lock guards against newObject() implementations that are not thread-safe.
+	T* createObject() {
+		T* obj;
+		{
+			std::lock_guard<std::mutex> lock(_creationLock);
+			obj = newObject();
+		}
+		_createdCount++;
+		_aliveCount++;
+		return obj;
+	}
+
+	// Destroys the object.
+	void destroyObject(T* obj) {
+		obj->destroy();
+		_aliveCount--;
+	}
+
+	// Destroys each object in the linked list that begins with the specified object.
+	void destroyObjects(T* obj) {
+		while (obj) {
+			T* nextObj = (T*)obj->_next;
+			destroyObject(obj);
+			_residentCount--;
+			obj = nextObj;
+		}
+	}
+
+	MVKObjectMagazine _magazines[kMVKObjectPoolMagazineCount];
+	std::atomic<T*> _globalHead{nullptr};
+	std::mutex _creationLock;
+	std::atomic<uint64_t> _createdCount{0};
+	std::atomic<uint64_t> _aliveCount{0};
+	std::atomic<uint64_t> _residentCount{0};
+	bool _isPooling;
+};
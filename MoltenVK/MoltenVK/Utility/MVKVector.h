@@ -23,10 +23,10 @@
 //
 #if 0
 
-template<typename T, size_t N = 0>
+template<typename T, size_t N = 0, typename Growth = void>
 using MVKVectorInline = std::vector<T>;
 
-template<typename T>
+template<typename T, typename Growth = void>
 using MVKVectorDefault = std::vector<T>;
 
 template<typename T>
@@ -61,12 +61,40 @@ using MVKVector = std::vector<T>;
 // is derived from MVKVector. If you want to pass MVKVectorInline to a function
 // use MVKVector.
 //
+// Element types may be move-only, in which case calling the copying members
+// (copy push_back, assign, and resize with a value) fails to compile.
+// Growing relocates trivially relocatable elements with memcpy (see
+// mvk_is_trivially_relocatable), and move constructs all others.
+// The growth strategy is a template parameter, e.g.
+//  MVKVectorInline<int, 4, mvk_vector_growth_geometric<2, 1>> vector;    // doubles when full
+//
 #include "MVKVectorAllocator.h"
 #include <type_traits>
 #include <initializer_list>
 #include <utility>
 
 
+//
+// Geometric growth strategy: when full, the capacity grows by Numerator / Denominator,
+// plus a minimum of 4 elements or one 64 byte cache line, whichever is more elements.
+//
+template<size_t Numerator = 3, size_t Denominator = 2>
+struct mvk_vector_growth_geometric
+{
+  static_assert( Numerator > Denominator, "the growth factor must be greater than one" );
+
+  template<typename Type>
+  static size_t get_next_capacity( const size_t current_capacity )
+  {
+    constexpr auto ELEMENTS_FOR_64_BYTES = 64 / sizeof( Type );
+    constexpr auto MINIMUM_CAPACITY = ELEMENTS_FOR_64_BYTES > 4 ? ELEMENTS_FOR_64_BYTES : 4;
+    return MINIMUM_CAPACITY + ( Numerator * current_capacity ) / Denominator;
+  }
+};
+
+typedef mvk_vector_growth_geometric<> mvk_vector_growth_default;
+
+
 template<class Type> class MVKVector
 {
   mvk_vector_allocator_base<Type> *alc_ptr;
@@ -125,10 +153,10 @@ public:
   virtual void        clear()                                             = 0;
   virtual void        reset()                                             = 0;
   virtual void        reserve( const size_t new_size )                    = 0;
-  virtual void        assign( const size_t new_size, const Type &t )      = 0;
-  virtual void        resize( const size_t new_size, const Type t = { } ) = 0;
-  virtual void        shrink_to_fit()                                     = 0;
-  virtual void        push_back( const Type &t )                          = 0;
+  virtual void        assign( const size_t new_size, const mvk_vector_element::copy_type<Type> &t )      = 0;
+  virtual void        resize( const size_t new_size, const mvk_vector_element::copy_type<Type> t = { } ) = 0;
+  virtual void        shrink_to_fit()                                                                    = 0;
+  virtual void        push_back( const mvk_vector_element::copy_type<Type> &t )                          = 0;
   virtual void        push_back( Type &&t )                               = 0;
 };
 
@@ -198,7 +226,7 @@ public:
 
 
 // this is the actual implementation of MVKVector
-template<class Type, typename Allocator = mvk_vector_allocator_default<Type>> class MVKVectorImpl : public MVKVector<Type>
+template<class Type, typename Allocator = mvk_vector_allocator_default<Type>, typename Growth = mvk_vector_growth_default> class MVKVectorImpl : public MVKVector<Type>
 {
   friend class MVKVectorImpl;
 
@@ -236,13 +264,10 @@ public:
   };
 
 private:
-  // this is the growth strategy -> adjust to your needs
+  // the growth strategy is set by the Growth template parameter
   size_t vector_GetNextCapacity() const
   {
-    constexpr auto ELEMENTS_FOR_64_BYTES = 64 / sizeof( Type );
-    constexpr auto MINIMUM_CAPACITY = ELEMENTS_FOR_64_BYTES > 4 ? ELEMENTS_FOR_64_BYTES : 4;
-    const auto current_capacity = capacity();
-    return MINIMUM_CAPACITY + ( 3 * current_capacity ) / 2;
+    return Growth::template get_next_capacity<Type>( capacity() );
   }
 
   void vector_Allocate( const size_t s )
@@ -257,6 +282,20 @@ private:
     alc.re_allocate( s );
   }
 
+  // grows a full vector and appends an element constructed by constructElement,
+  // which is constructed into temporary storage before the existing elements move
+  template<class F>
+  void vector_GrowAndConstruct( const F &constructElement )
+  {
+    alignas( alignof( Type ) ) unsigned char element[sizeof( Type )];
+    auto *element_ptr = reinterpret_cast< Type* >( &element[0] );
+
+    constructElement( element_ptr );
+    vector_ReAllocate( vector_GetNextCapacity() );
+    mvk_vector_element::relocate( &alc.ptr[alc.num_elements_used], element_ptr, 1 );
+    ++alc.num_elements_used;
+  }
+
 public:
   MVKVectorImpl() : MVKVector<Type>{ &alc }
   {
@@ -454,7 +493,7 @@ public:
     }
   }
 
-  void assign( const size_t new_size, const Type &t ) override
+  void assign( const size_t new_size, const mvk_vector_element::copy_type<Type> &t ) override
   {
     if( new_size <= capacity() )
     {
@@ -467,7 +506,7 @@ public:
 
     for( size_t i = 0; i < new_size; ++i )
     {
-      alc.construct( &alc.ptr[i], t );
+      mvk_vector_element::copy_construct( &alc.ptr[i], t );
     }
 
     alc.num_elements_used = new_size;
@@ -485,7 +524,7 @@ public:
     }
   }
 
-  void resize( const size_t new_size, const Type t = { } ) override
+  void resize( const size_t new_size, const mvk_vector_element::copy_type<Type> t = { } ) override
   {
     if( new_size == alc.num_elements_used )
     {
@@ -507,7 +546,7 @@ public:
 
       while( alc.num_elements_used < new_size )
       {
-        alc.construct( &alc.ptr[alc.num_elements_used], t );
+        mvk_vector_element::copy_construct( &alc.ptr[alc.num_elements_used], t );
         ++alc.num_elements_used;
       }
     }
@@ -598,12 +637,16 @@ public:
     }
   }
 
-  void push_back( const Type &t ) override
+  void push_back( const mvk_vector_element::copy_type<Type> &t ) override
   {
     if( alc.num_elements_used == capacity() )
-      vector_ReAllocate( vector_GetNextCapacity() );
+    {
+      // t may refer to an element of this vector, so copy it before the elements are relocated
+      vector_GrowAndConstruct( [&t]( Type *p ) { mvk_vector_element::copy_construct( p, t ); } );
+      return;
+    }
 
-    alc.construct( &alc.ptr[alc.num_elements_used], t );
+    mvk_vector_element::copy_construct( &alc.ptr[alc.num_elements_used], t );
     ++alc.num_elements_used;
   }
 
@@ -620,17 +663,22 @@ public:
   Type &emplace_back( Args&&... args )
   {
     if( alc.num_elements_used == capacity() )
-      vector_ReAllocate( vector_GetNextCapacity() );
-
-    alc.construct( &alc.ptr[alc.num_elements_used], std::forward<Args>( args )... );
-    ++alc.num_elements_used;
+    {
+      // args may refer to elements of this vector, so construct before the elements are relocated
+      vector_GrowAndConstruct( [&]( Type *p ) { alc.construct( p, std::forward<Args>( args )... ); } );
+    }
+    else
+    {
+      alc.construct( &alc.ptr[alc.num_elements_used], std::forward<Args>( args )... );
+      ++alc.num_elements_used;
+    }
 
     return alc.ptr[alc.num_elements_used - 1];
   }
 };
 
 // specialization for pointer types
-template<class Type, typename Allocator> class MVKVectorImpl<Type*, Allocator> : public MVKVector<Type*>
+template<class Type, typename Allocator, typename Growth> class MVKVectorImpl<Type*, Allocator, Growth> : public MVKVector<Type*>
 {
   friend class MVKVectorImpl;
 
@@ -666,13 +714,10 @@ public:
   };
 
 private:
-  // this is the growth strategy -> adjust to your needs
+  // the growth strategy is set by the Growth template parameter
   size_t vector_GetNextCapacity() const
   {
-    constexpr auto ELEMENTS_FOR_64_BYTES = 64 / sizeof( Type* );
-    constexpr auto MINIMUM_CAPACITY = ELEMENTS_FOR_64_BYTES > 4 ? ELEMENTS_FOR_64_BYTES : 4;
-    const auto current_capacity = capacity();
-    return MINIMUM_CAPACITY + ( 3 * current_capacity ) / 2;
+    return Growth::template get_next_capacity<Type*>( capacity() );
   }
 
   void vector_Allocate( const size_t s )
@@ -981,11 +1026,11 @@ public:
 };
 
 
-template<typename Type>
-using MVKVectorDefault = MVKVectorImpl<Type, mvk_vector_allocator_default<Type>>;
+template<typename Type, typename Growth = mvk_vector_growth_default>
+using MVKVectorDefault = MVKVectorImpl<Type, mvk_vector_allocator_default<Type>, Growth>;
 
-template<typename Type, size_t N = 8>
-using MVKVectorInline  = MVKVectorImpl<Type, mvk_vector_allocator_with_stack<Type, N>>;
+template<typename Type, size_t N = 8, typename Growth = mvk_vector_growth_default>
+using MVKVectorInline  = MVKVectorImpl<Type, mvk_vector_allocator_with_stack<Type, N>, Growth>;
 
 
 #endif
@@ -19,7 +19,10 @@
 #pragma once
 
 #include <new>
+#include <cstring>
+#include <stdexcept>
 #include <type_traits>
+#include <utility>
 
 
 #define MVK_VECTOR_CHECK_BOUNDS if (i >= num_elements_used) { throw std::out_of_range("Index out of range"); }
@@ -39,6 +42,78 @@ namespace mvk_memory_allocator
 };
 
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// mvk_is_trivially_relocatable -> element types that can be moved to new storage with memcpy
+//
+// By default this covers trivially copyable types. Specialize it for element types that are
+// safe to move bitwise, and whose moved-from original needs no destruction, even though they
+// have non-trivial copy or move operations, so that growing an MVKVector of them skips the
+// per-element move constructor and destructor calls.
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+template<typename T>
+struct mvk_is_trivially_relocatable : std::is_trivially_copyable<T> { };
+
+
+namespace mvk_vector_element
+{
+  //
+  // moves num_elements elements from src into the uninitialized storage at dst, and ends the lifetime of the originals
+  //
+  template<class S> typename std::enable_if< mvk_is_trivially_relocatable<S>::value >::type
+    relocate( S *dst, S *src, const size_t num_elements )
+  {
+    if( num_elements > 0 )
+    {
+      memcpy( (void*)dst, (const void*)src, num_elements * sizeof( S ) );
+    }
+  }
+
+  template<class S> typename std::enable_if< !mvk_is_trivially_relocatable<S>::value >::type
+    relocate( S *dst, S *src, const size_t num_elements )
+  {
+    for( size_t i = 0; i < num_elements; ++i )
+    {
+      new ( &dst[i] ) S( std::move( src[i] ) );
+      src[i].~S();
+    }
+  }
+
+  //
+  // stands in for a move-only element type in the parameters of the copying members (copy
+  // push_back, assign, resize with a value), which are virtual and so are always instantiated;
+  // constructing it from an element fails to compile, so calling them is rejected at compile time
+  //
+  template<class S> struct uncopyable
+  {
+    uncopyable()
+    {
+      static_assert( std::is_copy_constructible<S>::value, "MVKVector element type is not copy constructible" );
+    }
+
+    template<class U> uncopyable( const U & )
+    {
+      static_assert( std::is_copy_constructible<S>::value, "MVKVector element type is not copy constructible" );
+    }
+  };
+
+  // the type of the element parameter of the copying members
+  template<class S> using copy_type = typename std::conditional< std::is_copy_constructible<S>::value, S, uncopyable<S> >::type;
+
+  //
+  // copy constructs an element
+  //
+  template<class S> void copy_construct( S *dst, const S &src )
+  {
+    new ( dst ) S( src );
+  }
+
+  // never called, because an uncopyable cannot be constructed
+  template<class S> void copy_construct( S *dst, const uncopyable<S> &src ) { }
+};
+
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //
 // mvk_vector_allocator_base -> base class so we can use MVKVector with template parameter
@@ -82,13 +157,13 @@ private:
   size_t  num_elements_reserved;
 
 public:
-  template<class S, class... Args> typename std::enable_if< !std::is_trivially_constructible<S>::value >::type
+  template<class S, class... Args> typename std::enable_if< !std::is_trivially_constructible<S, Args...>::value >::type
     construct( S *_ptr, Args&&... _args )
   {
     new ( _ptr ) S( std::forward<Args>( _args )... );
   }
 
-  template<class S, class... Args> typename std::enable_if< std::is_trivially_constructible<S>::value >::type
+  template<class S, class... Args> typename std::enable_if< std::is_trivially_constructible<S, Args...>::value >::type
     construct( S *_ptr, Args&&... _args )
   {
     *_ptr = S( std::forward<Args>( _args )... );
@@ -170,28 +245,13 @@ public:
 
   void re_allocate( const size_t num_elements_to_reserve ) override
   {
-    //if constexpr( std::is_trivially_copyable<T>::value )
-    //{
-    //  ptr = reinterpret_cast< T* >( mvk_memory_allocator::tm_memrealloc( ptr, num_elements_to_reserve * sizeof( T ) );
-    //}
-    //else
-    {
-      auto *new_ptr = reinterpret_cast< T* >( mvk_memory_allocator::alloc( num_elements_to_reserve * sizeof( T ) ) );
-
-      for( size_t i = 0; i < mvk_vector_allocator_base<T>::num_elements_used; ++i )
-      {
-        construct( &new_ptr[i], std::move( mvk_vector_allocator_base<T>::ptr[i] ) );
-        destruct( &mvk_vector_allocator_base<T>::ptr[i] );
-      }
+    auto *new_ptr = reinterpret_cast< T* >( mvk_memory_allocator::alloc( num_elements_to_reserve * sizeof( T ) ) );
 
-      //if ( ptr != nullptr )
-      {
-        mvk_memory_allocator::free( mvk_vector_allocator_base<T>::ptr );
-      }
+    mvk_vector_element::relocate( new_ptr, mvk_vector_allocator_base<T>::ptr, mvk_vector_allocator_base<T>::num_elements_used );
 
-      mvk_vector_allocator_base<T>::ptr = new_ptr;
-    }
+    mvk_memory_allocator::free( mvk_vector_allocator_base<T>::ptr );
 
+    mvk_vector_allocator_base<T>::ptr = new_ptr;
     num_elements_reserved = num_elements_to_reserve;
   }
 
@@ -205,11 +265,7 @@ public:
     {
       auto *new_ptr = reinterpret_cast< T* >( mvk_memory_allocator::alloc( mvk_vector_allocator_base<T>::num_elements_used * sizeof( T ) ) );
 
-      for( size_t i = 0; i < mvk_vector_allocator_base<T>::num_elements_used; ++i )
-      {
-        construct( &new_ptr[i], std::move( mvk_vector_allocator_base<T>::ptr[i] ) );
-        destruct( &mvk_vector_allocator_base<T>::ptr[i] );
-      }
+      mvk_vector_element::relocate( new_ptr, mvk_vector_allocator_base<T>::ptr, mvk_vector_allocator_base<T>::num_elements_used );
 
       mvk_memory_allocator::free( mvk_vector_allocator_base<T>::ptr );
 
@@ -296,25 +352,12 @@ public:
   template<class S> typename std::enable_if< !std::is_trivially_destructible<S>::value >::type
     swap_stack( mvk_vector_allocator_with_stack &a )
   {
-    T stack_copy[N];
+    alignas( alignof( S ) ) unsigned char stack_copy[N * sizeof( S )];
+    auto *copy_ptr = reinterpret_cast< S* >( &stack_copy[0] );
 
-    for( size_t i = 0; i < mvk_vector_allocator_base<S>::num_elements_used; ++i )
-    {
-      construct( &stack_copy[i], std::move( S::ptr[i] ) );
-      destruct( &mvk_vector_allocator_base<S>::ptr[i] );
-    }
-
-    for( size_t i = 0; i < a.num_elements_used; ++i )
-    {
-      construct( &mvk_vector_allocator_base<S>::ptr[i], std::move( a.ptr[i] ) );
-      destruct( &mvk_vector_allocator_base<S>::ptr[i] );
-    }
-
-    for( size_t i = 0; i < mvk_vector_allocator_base<S>::num_elements_used; ++i )
-    {
-      construct( &a.ptr[i], std::move( stack_copy[i] ) );
-      destruct( &stack_copy[i] );
-    }
+    mvk_vector_element::relocate( copy_ptr, mvk_vector_allocator_base<S>::ptr, mvk_vector_allocator_base<S>::num_elements_used );
+    mvk_vector_element::relocate( mvk_vector_allocator_base<S>::ptr, a.ptr, a.num_elements_used );
+    mvk_vector_element::relocate( a.ptr, copy_ptr, mvk_vector_allocator_base<S>::num_elements_used );
   }
 
   template<class S> typename std::enable_if< std::is_trivially_destructible<S>::value >::type
@@ -347,11 +390,7 @@ public:
     else
     {
       mvk_vector_allocator_base<T>::ptr = get_default_ptr();
-      for( size_t i = 0; i < a.num_elements_used; ++i )
-      {
-        construct( &mvk_vector_allocator_base<T>::ptr[i], std::move( a.ptr[i] ) );
-        destruct( &a.ptr[i] );
-      }
+      mvk_vector_element::relocate( mvk_vector_allocator_base<T>::ptr, a.ptr, a.num_elements_used );
     }
 
     a.num_elements_used = 0;
@@ -400,11 +439,7 @@ public:
       auto copy_num_elements_reserved = a.get_capacity();
 
       a.ptr = a.get_default_ptr();
-      for( size_t i = 0; i < mvk_vector_allocator_base<T>::num_elements_used; ++i )
-      {
-        construct( &a.ptr[i], std::move( mvk_vector_allocator_base<T>::ptr[i] ) );
-        destruct( &mvk_vector_allocator_base<T>::ptr[i] );
-      }
+      mvk_vector_element::relocate( a.ptr, mvk_vector_allocator_base<T>::ptr, mvk_vector_allocator_base<T>::num_elements_used );
 
       mvk_vector_allocator_base<T>::ptr = copy_ptr;
       set_num_elements_reserved( copy_num_elements_reserved );
@@ -415,11 +450,7 @@ public:
       auto copy_num_elements_reserved = get_capacity();
 
       mvk_vector_allocator_base<T>::ptr = get_default_ptr();
-      for( size_t i = 0; i < a.num_elements_used; ++i )
-      {
-        construct( &mvk_vector_allocator_base<T>::ptr[i], std::move( a.ptr[i] ) );
-        destruct( &a.ptr[i] );
-      }
+      mvk_vector_element::relocate( mvk_vector_allocator_base<T>::ptr, a.ptr, a.num_elements_used );
 
       a.ptr = copy_ptr;
       a.set_num_elements_reserved( copy_num_elements_reserved );
@@ -448,16 +479,11 @@ public:
     set_num_elements_reserved( num_elements_to_reserve );
   }
 
-  //template<class S> typename std::enable_if< !std::is_trivially_copyable<S>::value >::type
   void _re_allocate( const size_t num_elements_to_reserve )
   {
     auto *new_ptr = reinterpret_cast< T* >( mvk_memory_allocator::alloc( num_elements_to_reserve * sizeof( T ) ) );
 
-    for( size_t i = 0; i < mvk_vector_allocator_base<T>::num_elements_used; ++i )
-    {
-      construct( &new_ptr[i], std::move( mvk_vector_allocator_base<T>::ptr[i] ) );
-      destruct( &mvk_vector_allocator_base<T>::ptr[i] );
-    }
+    mvk_vector_element::relocate( new_ptr, mvk_vector_allocator_base<T>::ptr, mvk_vector_allocator_base<T>::num_elements_used );
 
     if( mvk_vector_allocator_base<T>::ptr != get_default_ptr() )
     {
@@ -468,24 +494,6 @@ public:
     set_num_elements_reserved( num_elements_to_reserve );
   }
 
-  //template<class S> typename std::enable_if< std::is_trivially_copyable<S>::value >::type
-  //  _re_allocate( const size_t num_elements_to_reserve )
-  //{
-  //  const bool data_is_on_stack = get_data_on_stack();
-  //
-  //  auto *new_ptr = reinterpret_cast< S* >( mvk_memory_allocator::tm_memrealloc( data_is_on_stack ? nullptr : ptr, num_elements_to_reserve * sizeof( S ) ) );
-  //  if( data_is_on_stack )
-  //  {
-  //    for( int i = 0; i < N; ++i )
-  //    {
-  //      new_ptr[i] = ptr[i];
-  //    }
-  //  }
-  //
-  //  ptr = new_ptr;
-  //  set_num_elements_reserved( num_elements_to_reserve );
-  //}
-
   void re_allocate( const size_t num_elements_to_reserve ) override
   {
     //TM_ASSERT( num_elements_to_reserve > get_capacity() );
@@ -508,11 +516,7 @@ public:
       //const auto num_elements_reserved = get_capacity();
 
       auto *stack_ptr = get_default_ptr();
-      for( size_t i = 0; i < mvk_vector_allocator_base<T>::num_elements_used; ++i )
-      {
-        construct( &stack_ptr[i], std::move( mvk_vector_allocator_base<T>::ptr[i] ) );
-        destruct( &mvk_vector_allocator_base<T>::ptr[i] );
-      }
+      mvk_vector_element::relocate( stack_ptr, mvk_vector_allocator_base<T>::ptr, mvk_vector_allocator_base<T>::num_elements_used );
 
       mvk_memory_allocator::free( mvk_vector_allocator_base<T>::ptr );
 
@@ -522,11 +526,7 @@ public:
     {
       auto *new_ptr = reinterpret_cast< T* >( mvk_memory_allocator::alloc( mvk_vector_allocator_base<T>::num_elements_used * sizeof( T ) ) );
 
-      for( size_t i = 0; i < mvk_vector_allocator_base<T>::num_elements_used; ++i )
-      {
-        construct( &new_ptr[i], std::move( mvk_vector_allocator_base<T>::ptr[i] ) );
-        destruct( &mvk_vector_allocator_base<T>::ptr[i] );
-      }
+      mvk_vector_element::relocate( new_ptr, mvk_vector_allocator_base<T>::ptr, mvk_vector_allocator_base<T>::num_elements_used );
 
       mvk_memory_allocator::free( mvk_vector_allocator_base<T>::ptr );
 
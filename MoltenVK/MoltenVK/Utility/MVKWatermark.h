@@ -20,6 +20,7 @@
 
 
 #include "MVKBaseObject.h"
+#include "vk_mvk_moltenvk.h"
 #include <string>
 
 #import <Metal/Metal.h>
@@ -173,3 +174,118 @@ protected:
     MVKWatermarkPositionMode _positionMode;
 };
 
+
+#pragma mark -
+#pragma mark MVKPerformanceHUD
+
+/** The number of recent frames displayed by the performance HUD, one per column. */
+static const uint32_t kMVKPerformanceHUDFrameCount = 128;
+
+/** The performance of a single frame, as displayed by the performance HUD. */
+typedef struct {
+	double frameTime;			// CPU frame interval, in milliseconds
+	double gpuTime;				// GPU busy time of the most recently completed frame, in milliseconds
+	uint32_t submitCount;		// Queue submissions during the frame
+	uint32_t compileCount;		// Shader library and pipeline compilations during the frame
+	uint32_t stallCount;		// Waits for MTLCommandBuffers or CAMetalDrawables during the frame
+	float memoryFraction;		// Metal memory in use, as a fraction of the recommended working set size
+} MVKPerformanceHUDFrame;
+
+/**
+ * A heads-up display, overlaid in the top-left corner of the rendered scene, showing the
+ * performance of recent frames, with the newest frame on the right. From top to bottom, the
+ * display shows the CPU frame interval, colored green, yellow, or red as the frame exceeds
+ * 1/60 and 1/30 of a second, the GPU busy time in blue, the number of queue submissions in
+ * cyan, markers for frames containing shader or pipeline compilations in magenta, markers
+ * for frames that stalled on MTLCommandBuffers or drawables in orange, and across the bottom,
+ * the Metal memory in use, as a fraction of the recommended working set size of the device.
+ *
+ * The display is drawn from a small texture that is updated by the CPU once per frame, and
+ * rendered as a single textured quad, reusing the watermark rendering, so its GPU cost is negligible.
+ */
+class MVKPerformanceHUD : public MVKWatermark {
+
+public:
+
+	/**
+	 * Adds the performance of the latest frame to this display, derived from the changes to
+	 * the specified performance and resource statistics since the previous frame was added.
+	 */
+	void addFrame(const MVKPerformanceStatistics& perfStats, const MVKResourceStatistics& rezStats);
+
+	/** Update the render state prior to rendering to the specified texture. */
+	void updateRenderState(id<MTLTexture> mtlTexture) override;
+
+	MVKPerformanceHUD(id<MTLDevice> mtlDevice, const char* mtlShaderSource);
+
+	~MVKPerformanceHUD() override;
+
+protected:
+	void updateTexture();
+	void fillColumn(uint32_t x, uint32_t top, uint32_t height, uint32_t fillHeight, uint32_t color);
+
+	MVKPerformanceHUDFrame _frames[kMVKPerformanceHUDFrameCount];
+	id<MTLTexture> _mtlTextures[3];
+	uint32_t* _pixels;
+	uint64_t _recommendedWorkingSetSize;
+	uint32_t _nextFrameIndex;
+	uint32_t _mtlTextureIndex;
+	uint32_t _prevSubmitCount;
+	uint32_t _prevCompileCount;
+	uint32_t _prevFlowWaitCount;
+	uint32_t _prevDrawableCount;
+	bool _hasPrevCounts;
+};
+
+
+#pragma mark -
+#pragma mark MVKSwapchainUpscaler
+
+/** The filter used to upscale swapchain images that were rendered at less than their full extent. */
+typedef enum {
+	kMVKSwapchainUpscaleFilterNone = 0,			/**< Swapchain images are not upscaled. */
+	kMVKSwapchainUpscaleFilterBilinear = 1,		/**< Bilinear filtering, using the texture sampler. */
+	kMVKSwapchainUpscaleFilterLanczos = 2,		/**< Two-lobe Lanczos filtering, using sixteen texels per pixel. */
+} MVKSwapchainUpscaleFilter;
+
+/**
+ * Upscales the region, at the origin of a swapchain texture, that the app rendered at less than
+ * the full extent of the texture, so it covers the entire texture, before the texture is presented.
+ *
+ * The rendered region is copied to a scratch texture, which is then sampled by a single triangle
+ * that covers the swapchain texture. The scratch texture is only reallocated when the size or
+ * format of the swapchain texture changes, so the rendered region may change every frame.
+ *
+ * This class uses Metal directly.
+ */
+class MVKSwapchainUpscaler : public MVKBaseObject {
+
+public:
+
+	/** Returns the Vulkan API opaque object controlling this object. */
+	MVKVulkanAPIObject* getVulkanAPIObject() override { return nullptr; };
+
+	/**
+	 * Encodes commands to the Metal command buffer that upscale the region of the
+	 * specified texture, at its origin, with the specified extent, to cover the texture.
+	 */
+	void render(id<MTLTexture> mtlTexture, id<MTLCommandBuffer> mtlCommandBuffer, VkExtent2D srcExtent);
+
+	MVKSwapchainUpscaler(id<MTLDevice> mtlDevice, MVKSwapchainUpscaleFilter filter, const char* mtlShaderSource);
+
+	~MVKSwapchainUpscaler() override;
+
+protected:
+	void initShaders(const char* mslSourceCode);
+	id<MTLTexture> getScratchTexture(id<MTLTexture> mtlTexture);
+	id<MTLRenderPipelineState> getRenderPipelineState(MTLPixelFormat mtlPixFmt);
+
+	id<MTLDevice> _mtlDevice;
+	id<MTLFunction> _mtlFunctionVertex;
+	id<MTLFunction> _mtlFunctionFragment;
+	id<MTLSamplerState> _mtlSamplerState;
+	id<MTLRenderPipelineState> _mtlRenderPipelineState;
+	id<MTLTexture> _mtlScratchTexture;
+	MTLPixelFormat _mtlColorFormat;
+	MVKSwapchainUpscaleFilter _filter;
+};
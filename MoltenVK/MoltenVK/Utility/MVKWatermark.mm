@@ -22,6 +22,8 @@
 #include "MVKLogging.h"
 #include "MTLTextureDescriptor+MoltenVK.h"
 #include "MVKEnvironment.h"
+#include <algorithm>
+#include <cmath>
 
 
 /** The structure to hold shader uniforms. */
@@ -498,3 +500,355 @@ MVKWatermarkRandom::MVKWatermarkRandom(id<MTLDevice> mtlDevice,
                                      randomFloatBetween(-_maxPosition, _maxPosition)));
 }
 
+
+
+#pragma mark -
+#pragma mark MVKPerformanceHUD
+
+#define kMVKPerformanceHUDTextureWidth			kMVKPerformanceHUDFrameCount
+#define kMVKPerformanceHUDTextureHeight			80
+
+// The rows of the texture occupied by each part of the display, from the top.
+#define kMVKPerformanceHUDFrameTimeTop			0
+#define kMVKPerformanceHUDFrameTimeHeight		32
+#define kMVKPerformanceHUDGPUTimeTop			34
+#define kMVKPerformanceHUDGPUTimeHeight			24
+#define kMVKPerformanceHUDSubmitTop				60
+#define kMVKPerformanceHUDSubmitHeight			8
+#define kMVKPerformanceHUDCompileTop			69
+#define kMVKPerformanceHUDStallTop				73
+#define kMVKPerformanceHUDMarkerHeight			3
+#define kMVKPerformanceHUDMemoryTop				77
+#define kMVKPerformanceHUDMemoryHeight			3
+
+// The duration displayed by the full height of the frame time and GPU time graphs, in milliseconds.
+#define kMVKPerformanceHUDMaxDuration			(1000.0 / 30.0)
+
+// A drawable wait longer than this, in milliseconds, is displayed as a stall.
+#define kMVKPerformanceHUDDrawableStallDuration	2.0
+
+static inline uint32_t mvkHUDColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+	return (uint32_t)r | ((uint32_t)g << 8) | ((uint32_t)b << 16) | ((uint32_t)a << 24);
+}
+
+static const uint32_t kMVKHUDColorBackground	= mvkHUDColor(  0,   0,   0, 160);
+static const uint32_t kMVKHUDColorGuide			= mvkHUDColor(255, 255, 255,  96);
+static const uint32_t kMVKHUDColorGood			= mvkHUDColor( 64, 224,  64, 255);
+static const uint32_t kMVKHUDColorSlow			= mvkHUDColor(240, 224,  48, 255);
+static const uint32_t kMVKHUDColorHitch			= mvkHUDColor(240,  48,  48, 255);
+static const uint32_t kMVKHUDColorGPU			= mvkHUDColor( 64, 128, 255, 255);
+static const uint32_t kMVKHUDColorSubmit		= mvkHUDColor( 64, 224, 224, 255);
+static const uint32_t kMVKHUDColorCompile		= mvkHUDColor(240,  64, 240, 255);
+static const uint32_t kMVKHUDColorStall			= mvkHUDColor(255, 144,  32, 255);
+static const uint32_t kMVKHUDColorMemory		= mvkHUDColor(160, 240, 160, 255);
+
+// Returns the number of rows of a graph of the specified height filled by the duration.
+static inline uint32_t mvkHUDFillHeight(double duration, uint32_t height) {
+	return (uint32_t)std::min((double)height, std::round(duration / kMVKPerformanceHUDMaxDuration * height));
+}
+
+void MVKPerformanceHUD::addFrame(const MVKPerformanceStatistics& perfStats, const MVKResourceStatistics& rezStats) {
+	auto& shComp = perfStats.shaderCompilation;
+	uint32_t submitCount = perfStats.queue.queueSubmit.count;
+	uint32_t compileCount = shComp.mslCompile.count + shComp.functionSpecialization.count + shComp.pipelineCompile.count;
+	uint32_t flowWaitCount = perfStats.queue.mtlCommandBufferFlowWait.count;
+	uint32_t drawableCount = perfStats.queue.nextCAMetalDrawable.count;
+
+	// The display may be enabled after the device has been in use, so the counts
+	// accumulated before the first frame was added are not attributed to that frame.
+	if ( !_hasPrevCounts ) {
+		_prevSubmitCount = submitCount;
+		_prevCompileCount = compileCount;
+		_prevFlowWaitCount = flowWaitCount;
+		_prevDrawableCount = drawableCount;
+		_hasPrevCounts = true;
+	}
+
+	MVKPerformanceHUDFrame& frame = _frames[_nextFrameIndex];
+	frame.frameTime = perfStats.queue.frameInterval.latestDuration;
+	frame.gpuTime = perfStats.gpu.frameGPUBusyTime.latestDuration;
+	frame.submitCount = submitCount - _prevSubmitCount;
+	frame.compileCount = compileCount - _prevCompileCount;
+	frame.stallCount = flowWaitCount - _prevFlowWaitCount;
+	if (drawableCount != _prevDrawableCount &&
+		perfStats.queue.nextCAMetalDrawable.latestDuration > kMVKPerformanceHUDDrawableStallDuration) {
+		frame.stallCount++;
+	}
+
+	uint64_t memSize = (rezStats.deviceMemoryBytes.shared.current +
+						rezStats.deviceMemoryBytes.managed.current +
+						rezStats.deviceMemoryBytes.privateStorage.current +
+						rezStats.deviceMemoryBytes.memoryless.current +
+						rezStats.imageTextureBytes.shared.current +
+						rezStats.imageTextureBytes.managed.current +
+						rezStats.imageTextureBytes.privateStorage.current +
+						rezStats.imageTextureBytes.memoryless.current +
+						rezStats.internalMTLBufferBytes.current);
+	frame.memoryFraction = std::min((float)((double)memSize / (double)_recommendedWorkingSetSize), 1.0f);
+
+	_prevSubmitCount = submitCount;
+	_prevCompileCount = compileCount;
+	_prevFlowWaitCount = flowWaitCount;
+	_prevDrawableCount = drawableCount;
+	_nextFrameIndex = (_nextFrameIndex + 1) % kMVKPerformanceHUDFrameCount;
+
+	updateTexture();
+}
+
+// Fills the rows of a column of a part of the display, with the bottom fillHeight rows filled
+// with the specified color, and the remainder filled with the background color.
+void MVKPerformanceHUD::fillColumn(uint32_t x, uint32_t top, uint32_t height, uint32_t fillHeight, uint32_t color) {
+	uint32_t fillTop = top + height - fillHeight;
+	for (uint32_t y = top; y < top + height; y++) {
+		_pixels[(y * kMVKPerformanceHUDTextureWidth) + x] = (y >= fillTop) ? color : kMVKHUDColorBackground;
+	}
+}
+
+// Redraws the display into the pixel buffer, and copies it to the next texture, so that
+// the texture being updated is not one that the GPU might still be reading from.
+void MVKPerformanceHUD::updateTexture() {
+	uint32_t guideRow = kMVKPerformanceHUDFrameTimeTop + kMVKPerformanceHUDFrameTimeHeight - mvkHUDFillHeight(1000.0 / 60.0, kMVKPerformanceHUDFrameTimeHeight);
+	uint32_t newestFrameIdx = (_nextFrameIndex + kMVKPerformanceHUDFrameCount - 1) % kMVKPerformanceHUDFrameCount;
+	uint32_t memWidth = (uint32_t)std::round(_frames[newestFrameIdx].memoryFraction * kMVKPerformanceHUDTextureWidth);
+
+	for (uint32_t x = 0; x < kMVKPerformanceHUDTextureWidth; x++) {
+		const MVKPerformanceHUDFrame& frame = _frames[(_nextFrameIndex + x) % kMVKPerformanceHUDFrameCount];
+
+		uint32_t frameColor = ((frame.frameTime > 1000.0 / 30.0) ? kMVKHUDColorHitch
+							   : ((frame.frameTime > 1000.0 / 60.0) ? kMVKHUDColorSlow : kMVKHUDColorGood));
+		fillColumn(x, kMVKPerformanceHUDFrameTimeTop, kMVKPerformanceHUDFrameTimeHeight,
+				   mvkHUDFillHeight(frame.frameTime, kMVKPerformanceHUDFrameTimeHeight), frameColor);
+		uint32_t& guidePixel = _pixels[(guideRow * kMVKPerformanceHUDTextureWidth) + x];
+		if (guidePixel == kMVKHUDColorBackground) { guidePixel = kMVKHUDColorGuide; }
+
+		fillColumn(x, kMVKPerformanceHUDFrameTimeHeight, kMVKPerformanceHUDGPUTimeTop - kMVKPerformanceHUDFrameTimeHeight, 0, 0);
+		fillColumn(x, kMVKPerformanceHUDGPUTimeTop, kMVKPerformanceHUDGPUTimeHeight,
+				   mvkHUDFillHeight(frame.gpuTime, kMVKPerformanceHUDGPUTimeHeight), kMVKHUDColorGPU);
+
+		fillColumn(x, kMVKPerformanceHUDGPUTimeTop + kMVKPerformanceHUDGPUTimeHeight,
+				   kMVKPerformanceHUDSubmitTop - (kMVKPerformanceHUDGPUTimeTop + kMVKPerformanceHUDGPUTimeHeight), 0, 0);
+		fillColumn(x, kMVKPerformanceHUDSubmitTop, kMVKPerformanceHUDSubmitHeight,
+				   std::min(frame.submitCount, (uint32_t)kMVKPerformanceHUDSubmitHeight), kMVKHUDColorSubmit);
+
+		fillColumn(x, kMVKPerformanceHUDSubmitTop + kMVKPerformanceHUDSubmitHeight, 1, 0, 0);
+		fillColumn(x, kMVKPerformanceHUDCompileTop, kMVKPerformanceHUDMarkerHeight,
+				   frame.compileCount ? kMVKPerformanceHUDMarkerHeight : 0, kMVKHUDColorCompile);
+
+		fillColumn(x, kMVKPerformanceHUDCompileTop + kMVKPerformanceHUDMarkerHeight, 1, 0, 0);
+		fillColumn(x, kMVKPerformanceHUDStallTop, kMVKPerformanceHUDMarkerHeight,
+				   frame.stallCount ? kMVKPerformanceHUDMarkerHeight : 0, kMVKHUDColorStall);
+
+		fillColumn(x, kMVKPerformanceHUDStallTop + kMVKPerformanceHUDMarkerHeight, 1, 0, 0);
+		fillColumn(x, kMVKPerformanceHUDMemoryTop, kMVKPerformanceHUDMemoryHeight,
+				   (x < memWidth) ? kMVKPerformanceHUDMemoryHeight : 0, kMVKHUDColorMemory);
+	}
+
+	_mtlTextureIndex = (_mtlTextureIndex + 1) % (sizeof(_mtlTextures) / sizeof(_mtlTextures[0]));
+	id<MTLTexture> mtlTex = _mtlTextures[_mtlTextureIndex];
+	[mtlTex replaceRegion: MTLRegionMake2D(0, 0, kMVKPerformanceHUDTextureWidth, kMVKPerformanceHUDTextureHeight)
+			  mipmapLevel: 0
+					slice: 0
+				withBytes: _pixels
+			  bytesPerRow: kMVKPerformanceHUDTextureWidth * sizeof(uint32_t)
+			bytesPerImage: 0];
+	[_mtlTexture release];
+	_mtlTexture = [mtlTex retain];		// retained
+}
+
+void MVKPerformanceHUD::updateRenderState(id<MTLTexture> mtlTexture) {
+
+	MVKWatermark::updateRenderState(mtlTexture);
+
+	// Display each texel as a square block of pixels, scaled to the height of the framebuffer,
+	// and position the display in the top-left corner, in clip-space coordinates.
+	double texelScale = std::max(1.0, std::floor((double)mtlTexture.height / 540.0)) * 2.0;
+	float halfWidth = (kMVKPerformanceHUDTextureWidth * texelScale) / mtlTexture.width;
+	float halfHeight = (kMVKPerformanceHUDTextureHeight * texelScale) / mtlTexture.height;
+	float margin = 0.02;
+	setSize(MVKWatermarkSize(halfWidth, halfHeight));
+	setPosition(MVKWatermarkPosition(-1.0 + margin + halfWidth, 1.0 - margin - halfHeight));
+}
+
+// The initial content of the textures, which is transparent until the first frame is added.
+static unsigned char __performanceHUDInitialContent[kMVKPerformanceHUDTextureWidth * kMVKPerformanceHUDTextureHeight * sizeof(uint32_t)] = {};
+
+MVKPerformanceHUD::MVKPerformanceHUD(id<MTLDevice> mtlDevice,
+									 const char* mslSourceCode) : MVKWatermark(mtlDevice,
+																			   __performanceHUDInitialContent,
+																			   kMVKPerformanceHUDTextureWidth,
+																			   kMVKPerformanceHUDTextureHeight,
+																			   MTLPixelFormatRGBA8Unorm,
+																			   kMVKPerformanceHUDTextureWidth * sizeof(uint32_t),
+																			   mslSourceCode) {
+	[_mtlName release];
+	[_mtlRendEncName release];
+	_mtlName = [@"Performance HUD" retain];								// retained
+	_mtlRendEncName = [@"Performance HUD RenderEncoder" retain];		// retained
+	setOpacity(0.9);
+
+	// Draw from a ring of textures, so the content of a texture is not replaced while in use by the GPU.
+	_mtlTextures[0] = [_mtlTexture retain];		// retained
+	for (uint32_t texIdx = 1; texIdx < (sizeof(_mtlTextures) / sizeof(_mtlTextures[0])); texIdx++) {
+		MTLTextureDescriptor* texDesc = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat: _mtlTexture.pixelFormat
+																						   width: _mtlTexture.width
+																						  height: _mtlTexture.height
+																					   mipmapped: NO];
+		texDesc.usageMVK = MTLTextureUsageShaderRead;
+		texDesc.storageModeMVK = _mtlTexture.storageMode;
+		_mtlTextures[texIdx] = [_mtlDevice newTextureWithDescriptor: texDesc];		// retained
+	}
+	_mtlTextureIndex = 0;
+
+	_pixels = (uint32_t*)calloc(kMVKPerformanceHUDTextureWidth * kMVKPerformanceHUDTextureHeight, sizeof(uint32_t));
+	memset(_frames, 0, sizeof(_frames));
+	_nextFrameIndex = 0;
+	_prevSubmitCount = 0;
+	_prevCompileCount = 0;
+	_prevFlowWaitCount = 0;
+	_prevDrawableCount = 0;
+	_hasPrevCounts = false;
+
+	_recommendedWorkingSetSize = [NSProcessInfo processInfo].physicalMemory;
+#if MVK_MACOS
+	if ([_mtlDevice respondsToSelector: @selector(recommendedMaxWorkingSetSize)]) {
+		_recommendedWorkingSetSize = _mtlDevice.recommendedMaxWorkingSetSize;
+	}
+#endif
+	_recommendedWorkingSetSize = std::max(_recommendedWorkingSetSize, (uint64_t)1);
+}
+
+MVKPerformanceHUD::~MVKPerformanceHUD() {
+	for (auto& mtlTex : _mtlTextures) { [mtlTex release]; }
+	free(_pixels);
+}
+
+
+#pragma mark -
+#pragma mark MVKSwapchainUpscaler
+
+#define kMVKSwapchainUpscalerUniformBufferIndex		0
+#define kMVKSwapchainUpscalerTextureIndex			0
+
+void MVKSwapchainUpscaler::render(id<MTLTexture> mtlTexture, id<MTLCommandBuffer> mtlCommandBuffer, VkExtent2D srcExtent) {
+
+	id<MTLTexture> mtlScratchTex = getScratchTexture(mtlTexture);
+
+	// The region rendered by the app cannot be sampled while the same texture is being rendered.
+	id<MTLBlitCommandEncoder> mtlBlitEnc = [mtlCommandBuffer blitCommandEncoder];
+	mtlBlitEnc.label = @"Swapchain Upscale Copy";
+	[mtlBlitEnc copyFromTexture: mtlTexture
+					sourceSlice: 0
+					sourceLevel: 0
+				   sourceOrigin: MTLOriginMake(0, 0, 0)
+					 sourceSize: MTLSizeMake(srcExtent.width, srcExtent.height, 1)
+					  toTexture: mtlScratchTex
+			   destinationSlice: 0
+			   destinationLevel: 0
+			  destinationOrigin: MTLOriginMake(0, 0, 0)];
+	[mtlBlitEnc endEncoding];
+
+	// Every pixel is overwritten, so the previous contents need not be loaded.
+	MTLRenderPassDescriptor* mtlRPDesc = [MTLRenderPassDescriptor renderPassDescriptor];
+	MTLRenderPassColorAttachmentDescriptor* mtlColorAttDesc = mtlRPDesc.colorAttachments[0];
+	mtlColorAttDesc.texture = mtlTexture;
+	mtlColorAttDesc.loadAction = MTLLoadActionDontCare;
+	mtlColorAttDesc.storeAction = MTLStoreActionStore;
+
+	float srcSize[2] = { (float)srcExtent.width, (float)srcExtent.height };
+
+	id<MTLRenderCommandEncoder> mtlRendEnc = [mtlCommandBuffer renderCommandEncoderWithDescriptor: mtlRPDesc];
+	mtlRendEnc.label = @"Swapchain Upscale RenderEncoder";
+	[mtlRendEnc setRenderPipelineState: getRenderPipelineState(mtlTexture.pixelFormat)];
+	[mtlRendEnc setFragmentTexture: mtlScratchTex atIndex: kMVKSwapchainUpscalerTextureIndex];
+	[mtlRendEnc setFragmentSamplerState: _mtlSamplerState atIndex: kMVKSwapchainUpscalerTextureIndex];
+	[mtlRendEnc setFragmentBytes: srcSize length: sizeof(srcSize) atIndex: kMVKSwapchainUpscalerUniformBufferIndex];
+	[mtlRendEnc drawPrimitives: MTLPrimitiveTypeTriangle vertexStart: 0 vertexCount: 3];
+	[mtlRendEnc endEncoding];
+}
+
+// Returns a texture, with the same size and format as the specified texture, to hold the rendered region.
+id<MTLTexture> MVKSwapchainUpscaler::getScratchTexture(id<MTLTexture> mtlTexture) {
+	if (_mtlScratchTexture &&
+		_mtlScratchTexture.width == mtlTexture.width &&
+		_mtlScratchTexture.height == mtlTexture.height &&
+		_mtlScratchTexture.pixelFormat == mtlTexture.pixelFormat) { return _mtlScratchTexture; }
+
+	[_mtlScratchTexture release];
+
+	MTLTextureDescriptor* texDesc = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat: mtlTexture.pixelFormat
+																					   width: mtlTexture.width
+																					  height: mtlTexture.height
+																				   mipmapped: NO];
+	texDesc.usageMVK = MTLTextureUsageShaderRead;
+	texDesc.storageModeMVK = MTLStorageModePrivate;
+	_mtlScratchTexture = [_mtlDevice newTextureWithDescriptor: texDesc];		// retained
+	_mtlScratchTexture.label = @"Swapchain Upscale Source";
+	return _mtlScratchTexture;
+}
+
+id<MTLRenderPipelineState> MVKSwapchainUpscaler::getRenderPipelineState(MTLPixelFormat mtlPixFmt) {
+	if (_mtlRenderPipelineState && _mtlColorFormat == mtlPixFmt) { return _mtlRenderPipelineState; }
+
+	[_mtlRenderPipelineState release];
+	_mtlColorFormat = mtlPixFmt;
+
+	MTLRenderPipelineDescriptor* plDesc = [MTLRenderPipelineDescriptor new];	// temp retained
+	plDesc.label = @"Swapchain Upscale";
+	plDesc.vertexFunction = _mtlFunctionVertex;
+	plDesc.fragmentFunction = _mtlFunctionFragment;
+	plDesc.colorAttachments[0].pixelFormat = mtlPixFmt;
+
+	NSError* err = nil;
+	_mtlRenderPipelineState = [_mtlDevice newRenderPipelineStateWithDescriptor: plDesc error: &err];	// retained
+	MVKAssert( !err, "Could not create swapchain upscale pipeline state (Error code %li)\n%s", (long)err.code, err.localizedDescription.UTF8String);
+	[plDesc release];		// temp released
+	return _mtlRenderPipelineState;
+}
+
+
+#pragma mark Instance creation
+
+MVKSwapchainUpscaler::MVKSwapchainUpscaler(id<MTLDevice> mtlDevice,
+										   MVKSwapchainUpscaleFilter filter,
+										   const char* mslSourceCode) : _filter(filter) {
+	_mtlDevice = [mtlDevice retain];	// retained
+	_mtlRenderPipelineState = nil;
+	_mtlScratchTexture = nil;
+	_mtlColorFormat = MTLPixelFormatInvalid;
+	initShaders(mslSourceCode);
+
+	// The sampler is only used by bilinear filtering. The shaders clamp coordinates to the rendered region.
+	MTLSamplerDescriptor* sampDesc = [MTLSamplerDescriptor new];				// temp retained
+	sampDesc.minFilter = MTLSamplerMinMagFilterLinear;
+	sampDesc.magFilter = MTLSamplerMinMagFilterLinear;
+	sampDesc.sAddressMode = MTLSamplerAddressModeClampToEdge;
+	sampDesc.tAddressMode = MTLSamplerAddressModeClampToEdge;
+	_mtlSamplerState = [_mtlDevice newSamplerStateWithDescriptor: sampDesc];	// retained
+	[sampDesc release];															// temp released
+}
+
+// Initialize the shader functions for the filter
+void MVKSwapchainUpscaler::initShaders(const char* mslSourceCode) {
+	NSError* err = nil;
+	NSString* nsSrc = [[NSString alloc] initWithUTF8String: mslSourceCode];	// temp retained
+	id<MTLLibrary> mtlLib = [_mtlDevice newLibraryWithSource: nsSrc
+													 options: nil
+													   error: &err];		// temp retained
+	MVKAssert( !err, "Could not compile swapchain upscale shaders (Error code %li):\n%s", (long)err.code, err.localizedDescription.UTF8String);
+
+	NSString* fragFuncName = (_filter == kMVKSwapchainUpscaleFilterLanczos) ? @"upscaleLanczosFragment" : @"upscaleBilinearFragment";
+	_mtlFunctionVertex = [mtlLib newFunctionWithName: @"upscaleVertex"];		// retained
+	_mtlFunctionFragment = [mtlLib newFunctionWithName: fragFuncName];		// retained
+
+	[nsSrc release];	// temp released
+	[mtlLib release];	// temp released
+}
+
+MVKSwapchainUpscaler::~MVKSwapchainUpscaler() {
+	[_mtlDevice release];
+	[_mtlFunctionVertex release];
+	[_mtlFunctionFragment release];
+	[_mtlSamplerState release];
+	[_mtlRenderPipelineState release];
+	[_mtlScratchTexture release];
+}
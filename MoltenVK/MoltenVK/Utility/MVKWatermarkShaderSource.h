@@ -58,7 +58,61 @@ fragment float4 watermarkFragment(Varyings varyings [[stage_in]],						\n\
 ";
 
 
+/** This file contains static source code for the swapchain upscaling shaders. */
 
-
-
-
+static const char* __swapchainUpscaleShaderSource = "															\n\
+#include <metal_stdlib>																							\n\
+using namespace metal;																							\n\
+																												\n\
+typedef struct {																								\n\
+	float4 v_position [[position]];																				\n\
+	float2 v_texCoord;																							\n\
+} Varyings;																										\n\
+																												\n\
+// A single triangle covering the render target, with texture coordinates of 0 to 1 across it.					\n\
+vertex Varyings upscaleVertex(uint vid [[vertex_id]]) {															\n\
+	Varyings varyings;																							\n\
+	float2 uv = float2((vid << 1) & 2, vid & 2);																\n\
+	varyings.v_position = float4((uv * float2(2.0, -2.0)) + float2(-1.0, 1.0), 0.0, 1.0);						\n\
+	varyings.v_texCoord = uv;																					\n\
+	return varyings;																							\n\
+}																												\n\
+																												\n\
+// srcExtent is the size, in texels, of the region rendered by the app, at the texture origin.					\n\
+fragment float4 upscaleBilinearFragment(Varyings varyings [[stage_in]],											\n\
+										texture2d<float> texture [[ texture(0) ]],								\n\
+										sampler sampler [[ sampler(0) ]],										\n\
+										constant float2& srcExtent [[ buffer(0) ]]) {							\n\
+	float2 texSize = float2(texture.get_width(), texture.get_height());											\n\
+	float2 srcPos = clamp(varyings.v_texCoord * srcExtent, float2(0.5), srcExtent - 0.5);								\n\
+	return texture.sample(sampler, srcPos / texSize);															\n\
+}																												\n\
+																												\n\
+static float lanczos2(float x) {																				\n\
+	if (abs(x) < 1.0e-5) { return 1.0; }																		\n\
+	if (abs(x) >= 2.0) { return 0.0; }																			\n\
+	float px = M_PI_F * x;																						\n\
+	return 2.0 * sin(px) * sin(px * 0.5) / (px * px);															\n\
+}																												\n\
+																												\n\
+fragment float4 upscaleLanczosFragment(Varyings varyings [[stage_in]],											\n\
+									   texture2d<float> texture [[ texture(0) ]],								\n\
+									   constant float2& srcExtent [[ buffer(0) ]]) {							\n\
+	float2 srcPos = (varyings.v_texCoord * srcExtent) - 0.5;													\n\
+	float2 srcBase = floor(srcPos);																				\n\
+	float2 srcFract = srcPos - srcBase;																			\n\
+	int2 maxCoord = int2(srcExtent) - 1;																		\n\
+	float4 color = 0.0;																							\n\
+	float weightSum = 0.0;																						\n\
+	for (int y = -1; y <= 2; y++) {																				\n\
+		float wy = lanczos2(float(y) - srcFract.y);																\n\
+		for (int x = -1; x <= 2; x++) {																			\n\
+			float w = lanczos2(float(x) - srcFract.x) * wy;														\n\
+			int2 coord = clamp(int2(srcBase) + int2(x, y), int2(0), maxCoord);									\n\
+			color += texture.read(uint2(coord)) * w;															\n\
+			weightSum += w;																						\n\
+		}																										\n\
+	}																											\n\
+	return color / weightSum;																					\n\
+}																												\n\
+";
@@ -25,6 +25,8 @@
 #include "MVKBuffer.h"
 #include "MVKFoundation.h"
 #include "MVKShaderModule.h"
+#include "MVKPipeline.h"
+#include "MVKQueue.h"
 #include <string>
 
 using namespace std;
@@ -85,6 +87,25 @@ MVK_PUBLIC_SYMBOL VkResult vkGetPerformanceStatisticsMVK(
 	return mvkCopy(pPerf, &mvkPerf, pPerfSize);
 }
 
+MVK_PUBLIC_SYMBOL VkResult vkGetResourceStatisticsMVK(
+	VkDevice                                    device,
+	MVKResourceStatistics*                      pRezStats,
+	size_t*                                     pRezStatsSize) {
+
+	MVKResourceStatistics mvkRezStats;
+	MVKDevice::getMVKDevice(device)->getResourceStatistics(&mvkRezStats);
+	return mvkCopy(pRezStats, &mvkRezStats, pRezStatsSize);
+}
+
+MVK_PUBLIC_SYMBOL VkResult vkGetQueueGPUFrameTimesMVK(
+	VkQueue                                     queue,
+	uint32_t*                                   pFrameTimeCount,
+	MVKGPUFrameTime*                            pFrameTimes) {
+
+	MVKQueue* mvkQueue = MVKQueue::getMVKQueue(queue);
+	return mvkQueue->getGPUFrameTimes(pFrameTimeCount, pFrameTimes);
+}
+
 MVK_PUBLIC_SYMBOL void vkGetVersionStringsMVK(
 	char*										pMoltenVersionStringBuffer,
 	uint32_t									moltenVersionStringBufferLength,
@@ -160,3 +181,51 @@ MVK_PUBLIC_SYMBOL void vkSetWorkgroupSizeMVK(
     mvkShaderModule->setWorkgroupSize(x, y, z);
 }
 
+MVK_PUBLIC_SYMBOL VkResult vkGetPipelineCompilationStatusMVK(
+	VkDevice                                    device,
+	VkPipeline                                  pipeline) {
+
+	MVKPipeline* mvkPL = (MVKPipeline*)pipeline;
+	return mvkPL->getMTLPipelineStatesCompilationStatus();
+}
+
+MVK_PUBLIC_SYMBOL void vkSetPipelineCompilationCallbackMVK(
+	VkDevice                                    device,
+	VkPipeline                                  pipeline,
+	PFN_vkPipelineCompiledMVK                   pfnCallback,
+	void*                                       pUserData) {
+
+	MVKPipeline* mvkPL = (MVKPipeline*)pipeline;
+	mvkPL->notifyMTLPipelineStatesCompiled(pfnCallback, pUserData);
+}
+
+MVK_PUBLIC_SYMBOL void vkSetWorkgroupSizeTunableMVK(
+	VkShaderModule                              shaderModule,
+	VkBool32                                    isTunable) {
+
+	MVKShaderModule* mvkShaderModule = (MVKShaderModule*)shaderModule;
+	mvkShaderModule->setWorkgroupSizeTunable(isTunable);
+}
+
+MVK_PUBLIC_SYMBOL void vkGetPipelineWorkgroupSizeMVK(
+	VkPipeline                                  pipeline,
+	uint32_t*                                   pX,
+	uint32_t*                                   pY,
+	uint32_t*                                   pZ) {
+
+	MVKPipeline* mvkPL = (MVKPipeline*)pipeline;
+	MTLSize wgSize = mvkPL->getWorkgroupSize();
+	*pX = (uint32_t)wgSize.width;
+	*pY = (uint32_t)wgSize.height;
+	*pZ = (uint32_t)wgSize.depth;
+}
+
+MVK_PUBLIC_SYMBOL void vkSetSwapchainImageRenderExtentMVK(
+	VkSwapchainKHR                              swapchain,
+	uint32_t                                    imageIndex,
+	const VkExtent2D*                           pRenderExtent) {
+
+	MVKSwapchain* mvkSwapchain = (MVKSwapchain*)swapchain;
+	mvkSwapchain->getPresentableImage(imageIndex)->setRenderExtent(pRenderExtent);
+}
+
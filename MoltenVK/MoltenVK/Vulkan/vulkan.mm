@@ -39,6 +39,7 @@
 #include "MVKQueryPool.h"
 #include "MVKSwapchain.h"
 #include "MVKSurface.h"
+#include "MVKCallRecorder.h"
 #include "MVKFoundation.h"
 #include "MVKOSExtensions.h"
 #include "MVKLogging.h"
@@ -111,19 +112,116 @@ static inline void MVKTraceVulkanCallEndImpl(const char* funcName, uint64_t star
 	}
 }
 
-#define MVKTraceVulkanCallStart()	uint64_t tvcStartTime = MVKTraceVulkanCallStartImpl(__FUNCTION__)
-#define MVKTraceVulkanCallEnd()		MVKTraceVulkanCallEndImpl(__FUNCTION__, tvcStartTime)
+
+#pragma mark -
+#pragma mark Vulkan call recording
+
+// Returns the time at which a Vulkan call started, if Vulkan calls are being recorded, or zero if not.
+static inline uint64_t mvkRecordVulkanCallStart() {
+	return mvkIsRecordingVulkanCalls() ? mvkGetTimestamp() : 0;
+}
+
+// Returns a hash of the contents of the specified memory, or zero if the memory is not host-accessible.
+static uint64_t mvkGetDeviceMemoryContentHash(VkDeviceMemory mem) {
+	MVKDeviceMemory* mvkMem = (MVKDeviceMemory*)mem;
+	void* pMem = mvkMem ? mvkMem->getHostMemoryAddress() : nullptr;
+	return pMem ? mvkHashBytes(pMem, mvkMem->getDeviceMemorySize()) : 0;
+}
+
+// Returns a hash of the contents of the specified memory ranges.
+static uint64_t mvkGetMappedMemoryRangesContentHash(uint32_t memRangeCount, const VkMappedMemoryRange* pMemRanges) {
+	uint64_t hash = 0;
+	for (uint32_t i = 0; i < memRangeCount; i++) {
+		const VkMappedMemoryRange* pMem = &pMemRanges[i];
+		MVKDeviceMemory* mvkMem = (MVKDeviceMemory*)pMem->memory;
+		char* pMemBase = mvkMem ? (char*)mvkMem->getHostMemoryAddress() : nullptr;
+		if ( !pMemBase || pMem->offset >= mvkMem->getDeviceMemorySize() ) { continue; }
+
+		VkDeviceSize memSize = mvkMem->getDeviceMemorySize() - pMem->offset;
+		if (pMem->size != VK_WHOLE_SIZE) { memSize = std::min(pMem->size, memSize); }
+		hash = mvkHashBytes(pMemBase + pMem->offset, memSize, hash);
+	}
+	return hash;
+}
+
+// Records the descriptors in the data of a descriptor set update template, for each entry of
+// the template, in the same form as the descriptor arrays referenced by VkWriteDescriptorSet,
+// so that the handles within the data can be replaced when the call is replayed.
+class MVKCallRecordDescriptorUpdateData : public MVKCallRecordArg {
+
+public:
+	void serialize(MVKCallRecordWriter& ar) const {
+		auto* mvkDUT = (MVKDescriptorUpdateTemplate*)_descriptorUpdateTemplate;
+		uint32_t entCnt = mvkDUT->getNumberOfEntries();
+		for (uint32_t entIdx = 0; entIdx < entCnt; entIdx++) {
+			const VkDescriptorUpdateTemplateEntryKHR* pEntry = mvkDUT->getEntry(entIdx);
+			const char* pEntData = (const char*)_pData + pEntry->offset;
+			VkDescriptorType descType = pEntry->descriptorType;
+			if (descType == VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT) {
+				ar.data(pEntData, pEntry->descriptorCount);
+				continue;
+			}
+
+			bool isRecorded = (mvkIsImageDescriptorType(descType) ||
+							   mvkIsBufferDescriptorType(descType) ||
+							   mvkIsTexelBufferDescriptorType(descType));
+			uint32_t elemCnt = isRecorded ? pEntry->descriptorCount : 0;
+			ar.value(elemCnt);
+			for (uint32_t elemIdx = 0; elemIdx < elemCnt; elemIdx++) {
+				void* pElem = (void*)(pEntData + pEntry->stride * elemIdx);
+				if (mvkIsImageDescriptorType(descType)) {
+					mvkSerializeElement(ar, *(VkDescriptorImageInfo*)pElem);
+				} else if (mvkIsBufferDescriptorType(descType)) {
+					mvkSerializeElement(ar, *(VkDescriptorBufferInfo*)pElem);
+				} else {
+					mvkSerializeElement(ar, *(VkBufferView*)pElem);
+				}
+			}
+		}
+	}
+
+	MVKCallRecordDescriptorUpdateData(VkDescriptorUpdateTemplateKHR descriptorUpdateTemplate, const void* pData) :
+		_descriptorUpdateTemplate(descriptorUpdateTemplate), _pData(pData) {}
+
+protected:
+	VkDescriptorUpdateTemplateKHR _descriptorUpdateTemplate;
+	const void* _pData;
+};
+
+// Also optionally mark each function call as an os_signpost interval for Instruments,
+// and record it to the Vulkan call recording file.
+//
+// MVKRecordVulkanCall() records the parameters of a call that creates, destroys, or updates
+// the state of Vulkan objects, and MVKRecordVulkanFrameCall() records the parameters of a call
+// that records or submits commands. MVKTraceVulkanCallEnd() records the function and timing of
+// any other call made during the recorded frames. The parameters are recorded once the call has
+// completed, so they include the handles returned by the call.
+#define MVKTraceVulkanCallStart()	uint64_t tvcStartTime = MVKTraceVulkanCallStartImpl(__FUNCTION__);		\
+									uint64_t tvcRecordStartTime = mvkRecordVulkanCallStart();				\
+									static const uint32_t tvcRecordFuncIndex = mvkGetVulkanCallRecordFunctionIndex(__FUNCTION__);	\
+									uint64_t tvcSignpostID = mvkSignpostBegin(kMVKSignpostVulkanCall, __FUNCTION__)
+#define MVKTraceVulkanCallEnd()		mvkSignpostEnd(kMVKSignpostVulkanCall, tvcSignpostID);					\
+									if (tvcRecordStartTime) { mvkRecordVulkanCall(tvcRecordFuncIndex, tvcRecordStartTime, true); }	\
+									MVKTraceVulkanCallEndImpl(__FUNCTION__, tvcStartTime)
+#define MVKRecordVulkanCallImpl(isFrameCall, ...)																	\
+	if (tvcRecordStartTime) {																						\
+		mvkRecordVulkanCall(tvcRecordFuncIndex, tvcRecordStartTime, isFrameCall, ##__VA_ARGS__);					\
+		tvcRecordStartTime = 0;																						\
+	}
+#define MVKRecordVulkanCall(...)		MVKRecordVulkanCallImpl(false, ##__VA_ARGS__)
+#define MVKRecordVulkanFrameCall(...)	MVKRecordVulkanCallImpl(true, ##__VA_ARGS__)
 
 // Create and configure a command of particular type.
 // If the command is configured correctly, add it to the buffer,
 // otherwise indicate the configuration error to the command buffer.
 #define MVKAddCmd(cmdType, vkCmdBuff, ...)  													\
 	MVKCommandBuffer* cmdBuff = MVKCommandBuffer::getMVKCommandBuffer(vkCmdBuff);				\
-	MVKCmd ##cmdType* cmd = cmdBuff->getCommandPool()->_cmd ##cmdType ##Pool.acquireObject();	\
+	MVKCmd ##cmdType* cmd = cmdBuff->acquireCommand(cmdBuff->getCommandPool()->_cmd ##cmdType ##Pool);	\
 	VkResult cmdRslt = cmd->setContent(cmdBuff, ##__VA_ARGS__);									\
 	if (cmdRslt == VK_SUCCESS) {																\
 		cmdBuff->addCommand(cmd);																\
 	} else {																					\
+		cmdBuff->discardCommand(cmd);															\
 		cmdBuff->setConfigurationResult(cmdRslt);												\
 	}
 
@@ -182,6 +280,7 @@ MVK_PUBLIC_SYMBOL void vkDestroyInstance(
 	MVKTraceVulkanCallStart();
 	if (instance) { MVKInstance::getMVKInstance(instance)->destroy(); }
 	MVKTraceVulkanCallEnd();
+	mvkStopRecordingVulkanCalls();
 }
 
 MVK_PUBLIC_SYMBOL VkResult vkEnumeratePhysicalDevices(
@@ -308,6 +407,7 @@ MVK_PUBLIC_SYMBOL VkResult vkCreateDevice(
 	MVKDevice* mvkDev = new MVKDevice(mvkPD, pCreateInfo);
 	*pDevice = mvkDev->getVkDevice();
 	VkResult rslt = mvkDev->getConfigurationResult();
+	MVKRecordVulkanCall(physicalDevice, pCreateInfo, pAllocator, pDevice);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -318,6 +418,7 @@ MVK_PUBLIC_SYMBOL void vkDestroyDevice(
 
 	MVKTraceVulkanCallStart();
 	if (device) { MVKDevice::getMVKDevice(device)->destroy(); }
+	MVKRecordVulkanCall(device, pAllocator);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -376,6 +477,7 @@ MVK_PUBLIC_SYMBOL void vkGetDeviceQueue(
 	MVKTraceVulkanCallStart();
 	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
 	*pQueue = mvkDev->getQueue(queueFamilyIndex, queueIndex)->getVkQueue();
+	MVKRecordVulkanCall(device, queueFamilyIndex, queueIndex, pQueue);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -388,6 +490,7 @@ MVK_PUBLIC_SYMBOL VkResult vkQueueSubmit(
 	MVKTraceVulkanCallStart();
 	MVKQueue* mvkQ = MVKQueue::getMVKQueue(queue);
 	VkResult rslt = mvkQ->submit(submitCount, pSubmits, fence);
+	MVKRecordVulkanFrameCall(queue, submitCount, mvkRecordArray(pSubmits, submitCount), fence);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -398,6 +501,7 @@ MVK_PUBLIC_SYMBOL VkResult vkQueueWaitIdle(
 	MVKTraceVulkanCallStart();
 	MVKQueue* mvkQ = MVKQueue::getMVKQueue(queue);
 	VkResult rslt = mvkQ->waitIdle();
+	MVKRecordVulkanFrameCall(queue);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -408,6 +512,7 @@ MVK_PUBLIC_SYMBOL VkResult vkDeviceWaitIdle(
 	MVKTraceVulkanCallStart();
 	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
 	VkResult rslt = mvkDev->waitIdle();
+	MVKRecordVulkanFrameCall(device);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -423,6 +528,7 @@ MVK_PUBLIC_SYMBOL VkResult vkAllocateMemory(
 	MVKDeviceMemory* mvkMem = mvkDev->allocateMemory(pAllocateInfo, pAllocator);
 	VkResult rslt = mvkMem->getConfigurationResult();
 	*pMem = (VkDeviceMemory)((rslt == VK_SUCCESS) ? mvkMem : VK_NULL_HANDLE);
+	MVKRecordVulkanCall(device, pAllocateInfo, pAllocator, pMem);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -435,6 +541,7 @@ MVK_PUBLIC_SYMBOL void vkFreeMemory(
 	MVKTraceVulkanCallStart();
 	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
 	mvkDev->freeMemory((MVKDeviceMemory*)mem, pAllocator);
+	MVKRecordVulkanCall(device, mem, pAllocator);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -449,6 +556,7 @@ MVK_PUBLIC_SYMBOL VkResult vkMapMemory(
 	MVKTraceVulkanCallStart();
 	MVKDeviceMemory* mvkMem = (MVKDeviceMemory*)mem;
 	VkResult rslt = mvkMem->map(offset, size, flags, ppData);
+	MVKRecordVulkanCall(device, mem, offset, size, flags);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -460,6 +568,7 @@ MVK_PUBLIC_SYMBOL void vkUnmapMemory(
 	MVKTraceVulkanCallStart();
 	MVKDeviceMemory* mvkMem = (MVKDeviceMemory*)mem;
 	mvkMem->unmap();
+	MVKRecordVulkanCall(device, mem, mvkGetDeviceMemoryContentHash(mem));
 	MVKTraceVulkanCallEnd();
 }
 
@@ -476,6 +585,7 @@ MVK_PUBLIC_SYMBOL VkResult vkFlushMappedMemoryRanges(
 		VkResult r = mvkMem->flushToDevice(pMem->offset, pMem->size);
 		if (rslt == VK_SUCCESS) { rslt = r; }
 	}
+	MVKRecordVulkanCall(device, memRangeCount, mvkRecordArray(pMemRanges, memRangeCount), mvkGetMappedMemoryRangesContentHash(memRangeCount, pMemRanges));
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -513,6 +623,7 @@ MVK_PUBLIC_SYMBOL VkResult vkBindBufferMemory(
 	MVKBuffer* mvkBuff = (MVKBuffer*)buffer;
 	MVKDeviceMemory* mvkMem = (MVKDeviceMemory*)mem;
 	VkResult rslt = mvkBuff->bindDeviceMemory(mvkMem, memOffset);
+	MVKRecordVulkanCall(device, buffer, mem, memOffset);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -527,6 +638,7 @@ MVK_PUBLIC_SYMBOL VkResult vkBindImageMemory(
 	MVKImage* mvkImg = (MVKImage*)image;
 	MVKDeviceMemory* mvkMem = (MVKDeviceMemory*)mem;
 	VkResult rslt = mvkImg->bindDeviceMemory(mvkMem, memOffset);
+	MVKRecordVulkanCall(device, image, mem, memOffset);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -613,6 +725,7 @@ MVK_PUBLIC_SYMBOL VkResult vkCreateFence(
 	MVKFence* mvkFence = mvkDev->createFence(pCreateInfo, pAllocator);
 	*pFence = (VkFence)mvkFence;
 	VkResult rslt = mvkFence->getConfigurationResult();
+	MVKRecordVulkanCall(device, pCreateInfo, pAllocator, pFence);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -625,6 +738,7 @@ MVK_PUBLIC_SYMBOL void vkDestroyFence(
 	MVKTraceVulkanCallStart();
 	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
 	mvkDev->destroyFence((MVKFence*)fence, pAllocator);
+	MVKRecordVulkanCall(device, fence, pAllocator);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -635,6 +749,7 @@ MVK_PUBLIC_SYMBOL VkResult vkResetFences(
 	
 	MVKTraceVulkanCallStart();
 	VkResult rslt = mvkResetFences(fenceCount, pFences);
+	MVKRecordVulkanFrameCall(device, fenceCount, mvkRecordArray(pFences, fenceCount));
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -660,6 +775,7 @@ MVK_PUBLIC_SYMBOL VkResult vkWaitForFences(
 	MVKTraceVulkanCallStart();
 	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
 	VkResult rslt = mvkWaitForFences(mvkDev, fenceCount, pFences, waitAll, timeout);
+	MVKRecordVulkanFrameCall(device, fenceCount, mvkRecordArray(pFences, fenceCount), waitAll, timeout);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -675,6 +791,7 @@ MVK_PUBLIC_SYMBOL VkResult vkCreateSemaphore(
 	MVKSemaphore* mvkSem4 = mvkDev->createSemaphore(pCreateInfo, pAllocator);
 	*pSemaphore = (VkSemaphore)mvkSem4;
 	VkResult rslt = mvkSem4->getConfigurationResult();
+	MVKRecordVulkanCall(device, pCreateInfo, pAllocator, pSemaphore);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -687,6 +804,7 @@ MVK_PUBLIC_SYMBOL void vkDestroySemaphore(
 	MVKTraceVulkanCallStart();
 	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
 	mvkDev->destroySemaphore((MVKSemaphore*)semaphore, pAllocator);
+	MVKRecordVulkanCall(device, semaphore, pAllocator);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -760,6 +878,7 @@ MVK_PUBLIC_SYMBOL VkResult vkCreateQueryPool(
 	MVKQueryPool* mvkQP = mvkDev->createQueryPool(pCreateInfo, pAllocator);
 	*pQueryPool = (VkQueryPool)mvkQP;
 	VkResult rslt = mvkQP->getConfigurationResult();
+	MVKRecordVulkanCall(device, pCreateInfo, pAllocator, pQueryPool);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -772,6 +891,7 @@ MVK_PUBLIC_SYMBOL void vkDestroyQueryPool(
 	MVKTraceVulkanCallStart();
 	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
 	mvkDev->destroyQueryPool((MVKQueryPool*)queryPool, pAllocator);
+	MVKRecordVulkanCall(device, queryPool, pAllocator);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -803,6 +923,7 @@ MVK_PUBLIC_SYMBOL VkResult vkCreateBuffer(
 	MVKBuffer* mvkBuff = mvkDev->createBuffer(pCreateInfo, pAllocator);
 	*pBuffer = (VkBuffer)mvkBuff;
 	VkResult rslt = mvkBuff->getConfigurationResult();
+	MVKRecordVulkanCall(device, pCreateInfo, pAllocator, pBuffer);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -815,6 +936,7 @@ MVK_PUBLIC_SYMBOL void vkDestroyBuffer(
 	MVKTraceVulkanCallStart();
 	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
 	mvkDev->destroyBuffer((MVKBuffer*)buffer, pAllocator);
+	MVKRecordVulkanCall(device, buffer, pAllocator);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -829,6 +951,7 @@ MVK_PUBLIC_SYMBOL VkResult vkCreateBufferView(
     MVKBufferView* mvkBuffView = mvkDev->createBufferView(pCreateInfo, pAllocator);
     *pView = (VkBufferView)mvkBuffView;
     VkResult rslt = mvkBuffView->getConfigurationResult();
+	MVKRecordVulkanCall(device, pCreateInfo, pAllocator, pView);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -841,6 +964,7 @@ MVK_PUBLIC_SYMBOL void vkDestroyBufferView(
 	MVKTraceVulkanCallStart();
     MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
     mvkDev->destroyBufferView((MVKBufferView*)bufferView, pAllocator);
+	MVKRecordVulkanCall(device, bufferView, pAllocator);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -855,6 +979,7 @@ MVK_PUBLIC_SYMBOL VkResult vkCreateImage(
 	MVKImage* mvkImg = mvkDev->createImage(pCreateInfo, pAllocator);
 	*pImage = (VkImage)mvkImg;
 	VkResult rslt = mvkImg->getConfigurationResult();
+	MVKRecordVulkanCall(device, pCreateInfo, pAllocator, pImage);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -867,6 +992,7 @@ MVK_PUBLIC_SYMBOL void vkDestroyImage(
 	MVKTraceVulkanCallStart();
 	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
 	mvkDev->destroyImage((MVKImage*)image, pAllocator);
+	MVKRecordVulkanCall(device, image, pAllocator);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -893,6 +1019,7 @@ MVK_PUBLIC_SYMBOL VkResult vkCreateImageView(
 	MVKImageView* mvkImgView = mvkDev->createImageView(pCreateInfo, pAllocator);
 	*pView = (VkImageView)mvkImgView;
 	VkResult rslt = mvkImgView->getConfigurationResult();
+	MVKRecordVulkanCall(device, pCreateInfo, pAllocator, pView);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -905,6 +1032,7 @@ MVK_PUBLIC_SYMBOL void vkDestroyImageView(
 	MVKTraceVulkanCallStart();
 	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
 	mvkDev->destroyImageView((MVKImageView*)imageView, pAllocator);
+	MVKRecordVulkanCall(device, imageView, pAllocator);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -919,6 +1047,7 @@ MVK_PUBLIC_SYMBOL VkResult vkCreateShaderModule(
 	MVKShaderModule* mvkShdrMod = mvkDev->createShaderModule(pCreateInfo, pAllocator);
 	*pShaderModule = (VkShaderModule)mvkShdrMod;
 	VkResult rslt = mvkShdrMod->getConfigurationResult();
+	MVKRecordVulkanCall(device, pCreateInfo, pAllocator, pShaderModule);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -931,6 +1060,7 @@ MVK_PUBLIC_SYMBOL void vkDestroyShaderModule(
 	MVKTraceVulkanCallStart();
 	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
 	mvkDev->destroyShaderModule((MVKShaderModule*)shaderModule, pAllocator);
+	MVKRecordVulkanCall(device, shaderModule, pAllocator);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -945,6 +1075,7 @@ MVK_PUBLIC_SYMBOL VkResult vkCreatePipelineCache(
 	MVKPipelineCache* mvkPLC = mvkDev->createPipelineCache(pCreateInfo, pAllocator);
 	*pPipelineCache = (VkPipelineCache)mvkPLC;
 	VkResult rslt = mvkPLC->getConfigurationResult();
+	MVKRecordVulkanCall(device, pCreateInfo, pAllocator, pPipelineCache);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -957,6 +1088,7 @@ MVK_PUBLIC_SYMBOL void vkDestroyPipelineCache(
 	MVKTraceVulkanCallStart();
 	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
 	mvkDev->destroyPipelineCache((MVKPipelineCache*)pipelineCache, pAllocator);
+	MVKRecordVulkanCall(device, pipelineCache, pAllocator);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -997,6 +1129,7 @@ MVK_PUBLIC_SYMBOL VkResult vkCreateGraphicsPipelines(
 	MVKTraceVulkanCallStart();
     MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
 	VkResult rslt = mvkDev->createPipelines<MVKGraphicsPipeline, VkGraphicsPipelineCreateInfo>(pipelineCache, count, pCreateInfos, pAllocator, pPipelines);
+	MVKRecordVulkanCall(device, pipelineCache, count, mvkRecordArray(pCreateInfos, count), pAllocator, mvkRecordArray(pPipelines, count));
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -1012,6 +1145,7 @@ MVK_PUBLIC_SYMBOL VkResult vkCreateComputePipelines(
 	MVKTraceVulkanCallStart();
     MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
     VkResult rslt = mvkDev->createPipelines<MVKComputePipeline, VkComputePipelineCreateInfo>(pipelineCache, count, pCreateInfos, pAllocator, pPipelines);
+	MVKRecordVulkanCall(device, pipelineCache, count, mvkRecordArray(pCreateInfos, count), pAllocator, mvkRecordArray(pPipelines, count));
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -1024,6 +1158,7 @@ MVK_PUBLIC_SYMBOL void vkDestroyPipeline(
 	MVKTraceVulkanCallStart();
     MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
     mvkDev->destroyPipeline((MVKPipeline*)pipeline, pAllocator);
+	MVKRecordVulkanCall(device, pipeline, pAllocator);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1038,6 +1173,7 @@ MVK_PUBLIC_SYMBOL VkResult vkCreatePipelineLayout(
 	MVKPipelineLayout* mvkPLL = mvkDev->createPipelineLayout(pCreateInfo, pAllocator);
 	*pPipelineLayout = (VkPipelineLayout)mvkPLL;
 	VkResult rslt = mvkPLL->getConfigurationResult();
+	MVKRecordVulkanCall(device, pCreateInfo, pAllocator, pPipelineLayout);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -1050,6 +1186,7 @@ MVK_PUBLIC_SYMBOL void vkDestroyPipelineLayout(
 	MVKTraceVulkanCallStart();
 	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
 	mvkDev->destroyPipelineLayout((MVKPipelineLayout*)pipelineLayout, pAllocator);
+	MVKRecordVulkanCall(device, pipelineLayout, pAllocator);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1064,6 +1201,7 @@ MVK_PUBLIC_SYMBOL VkResult vkCreateSampler(
 	MVKSampler* mvkSamp = mvkDev->createSampler(pCreateInfo, pAllocator);
 	*pSampler = (VkSampler)mvkSamp;
 	VkResult rslt = mvkSamp->getConfigurationResult();
+	MVKRecordVulkanCall(device, pCreateInfo, pAllocator, pSampler);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -1076,6 +1214,7 @@ MVK_PUBLIC_SYMBOL void vkDestroySampler(
 	MVKTraceVulkanCallStart();
 	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
 	mvkDev->destroySampler((MVKSampler*)sampler, pAllocator);
+	MVKRecordVulkanCall(device, sampler, pAllocator);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1090,6 +1229,7 @@ MVK_PUBLIC_SYMBOL VkResult vkCreateDescriptorSetLayout(
 	MVKDescriptorSetLayout* mvkDSL = mvkDev->createDescriptorSetLayout(pCreateInfo, pAllocator);
 	*pSetLayout = (VkDescriptorSetLayout)mvkDSL;
 	VkResult rslt = mvkDSL->getConfigurationResult();
+	MVKRecordVulkanCall(device, pCreateInfo, pAllocator, pSetLayout);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -1102,6 +1242,7 @@ MVK_PUBLIC_SYMBOL void vkDestroyDescriptorSetLayout(
 	MVKTraceVulkanCallStart();
 	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
 	mvkDev->destroyDescriptorSetLayout((MVKDescriptorSetLayout*)descriptorSetLayout, pAllocator);
+	MVKRecordVulkanCall(device, descriptorSetLayout, pAllocator);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1116,6 +1257,7 @@ MVK_PUBLIC_SYMBOL VkResult vkCreateDescriptorPool(
 	MVKDescriptorPool* mvkDP = mvkDev->createDescriptorPool(pCreateInfo, pAllocator);
 	*pDescriptorPool = (VkDescriptorPool)mvkDP;
 	VkResult rslt = mvkDP->getConfigurationResult();
+	MVKRecordVulkanCall(device, pCreateInfo, pAllocator, pDescriptorPool);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -1128,6 +1270,7 @@ MVK_PUBLIC_SYMBOL void vkDestroyDescriptorPool(
 	MVKTraceVulkanCallStart();
 	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
 	mvkDev->destroyDescriptorPool((MVKDescriptorPool*)descriptorPool, pAllocator);
+	MVKRecordVulkanCall(device, descriptorPool, pAllocator);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1139,6 +1282,7 @@ MVK_PUBLIC_SYMBOL VkResult vkResetDescriptorPool(
 	MVKTraceVulkanCallStart();
 	MVKDescriptorPool* mvkDP = (MVKDescriptorPool*)descriptorPool;
 	VkResult rslt = mvkDP->reset(flags);
+	MVKRecordVulkanCall(device, descriptorPool, flags);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -1153,6 +1297,7 @@ MVK_PUBLIC_SYMBOL VkResult vkAllocateDescriptorSets(
 	VkResult rslt = mvkDP->allocateDescriptorSets(pAllocateInfo->descriptorSetCount,
 												  pAllocateInfo->pSetLayouts,
 												  pDescriptorSets);
+	MVKRecordVulkanCall(device, pAllocateInfo, mvkRecordArray(pDescriptorSets, pAllocateInfo->descriptorSetCount));
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -1166,6 +1311,7 @@ MVK_PUBLIC_SYMBOL VkResult vkFreeDescriptorSets(
 	MVKTraceVulkanCallStart();
 	MVKDescriptorPool* mvkDP = (MVKDescriptorPool*)descriptorPool;
 	VkResult rslt = mvkDP->freeDescriptorSets(count, pDescriptorSets);
+	MVKRecordVulkanCall(device, descriptorPool, count, mvkRecordArray(pDescriptorSets, count));
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -1178,7 +1324,11 @@ MVK_PUBLIC_SYMBOL void vkUpdateDescriptorSets(
     const VkCopyDescriptorSet*                  pDescriptorCopies) {
 	
 	MVKTraceVulkanCallStart();
+	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
+	uint64_t startTime = mvkDev->getPerformanceTimestamp();
 	mvkUpdateDescriptorSets(writeCount, pDescriptorWrites, copyCount, pDescriptorCopies);
+	mvkDev->addActivityPerformance(mvkDev->_performanceStatistics.descriptors.updateDescriptorSets, startTime);
+	MVKRecordVulkanCall(device, writeCount, mvkRecordArray(pDescriptorWrites, writeCount), copyCount, mvkRecordArray(pDescriptorCopies, copyCount));
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1193,6 +1343,7 @@ MVK_PUBLIC_SYMBOL VkResult vkCreateFramebuffer(
 	MVKFramebuffer* mvkFB = mvkDev->createFramebuffer(pCreateInfo, pAllocator);
 	*pFramebuffer = (VkFramebuffer)mvkFB;
 	VkResult rslt = mvkFB->getConfigurationResult();
+	MVKRecordVulkanCall(device, pCreateInfo, pAllocator, pFramebuffer);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -1205,6 +1356,7 @@ MVK_PUBLIC_SYMBOL void vkDestroyFramebuffer(
 	MVKTraceVulkanCallStart();
 	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
 	mvkDev->destroyFramebuffer((MVKFramebuffer*)framebuffer, pAllocator);
+	MVKRecordVulkanCall(device, framebuffer, pAllocator);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1219,6 +1371,7 @@ MVK_PUBLIC_SYMBOL VkResult vkCreateRenderPass(
 	MVKRenderPass* mvkRendPass = mvkDev->createRenderPass(pCreateInfo, pAllocator);
 	*pRenderPass = (VkRenderPass)mvkRendPass;
 	VkResult rslt = mvkRendPass->getConfigurationResult();
+	MVKRecordVulkanCall(device, pCreateInfo, pAllocator, pRenderPass);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -1231,6 +1384,7 @@ MVK_PUBLIC_SYMBOL void vkDestroyRenderPass(
 	MVKTraceVulkanCallStart();
 	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
 	mvkDev->destroyRenderPass((MVKRenderPass*)renderPass, pAllocator);
+	MVKRecordVulkanCall(device, renderPass, pAllocator);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1256,6 +1410,7 @@ MVK_PUBLIC_SYMBOL VkResult vkCreateCommandPool(
 	MVKCommandPool* mvkCmdPool = mvkDev->createCommandPool(pCreateInfo, pAllocator);
 	*pCmdPool = (VkCommandPool)mvkCmdPool;
 	VkResult rslt = mvkCmdPool->getConfigurationResult();
+	MVKRecordVulkanCall(device, pCreateInfo, pAllocator, pCmdPool);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -1268,6 +1423,7 @@ MVK_PUBLIC_SYMBOL void vkDestroyCommandPool(
 	MVKTraceVulkanCallStart();
 	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
 	mvkDev->destroyCommandPool((MVKCommandPool*)commandPool, pAllocator);
+	MVKRecordVulkanCall(device, commandPool, pAllocator);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1279,6 +1435,7 @@ MVK_PUBLIC_SYMBOL VkResult vkResetCommandPool(
 	MVKTraceVulkanCallStart();
 	MVKCommandPool* mvkCmdPool = (MVKCommandPool*)commandPool;
 	VkResult rslt = mvkCmdPool->reset(flags);
+	MVKRecordVulkanFrameCall(device, commandPool, flags);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -1291,6 +1448,7 @@ MVK_PUBLIC_SYMBOL VkResult vkAllocateCommandBuffers(
 	MVKTraceVulkanCallStart();
 	MVKCommandPool* mvkCmdPool = (MVKCommandPool*)pAllocateInfo->commandPool;
 	VkResult rslt = mvkCmdPool->allocateCommandBuffers(pAllocateInfo, pCmdBuffer);
+	MVKRecordVulkanCall(device, pAllocateInfo, mvkRecordArray(pCmdBuffer, pAllocateInfo->commandBufferCount));
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -1304,6 +1462,7 @@ MVK_PUBLIC_SYMBOL void vkFreeCommandBuffers(
 	MVKTraceVulkanCallStart();
 	MVKCommandPool* mvkCmdPool = (MVKCommandPool*)commandPool;
 	mvkCmdPool->freeCommandBuffers(commandBufferCount, pCommandBuffers);
+	MVKRecordVulkanCall(device, commandPool, commandBufferCount, mvkRecordArray(pCommandBuffers, commandBufferCount));
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1314,6 +1473,7 @@ MVK_PUBLIC_SYMBOL VkResult vkBeginCommandBuffer(
 	MVKTraceVulkanCallStart();
     MVKCommandBuffer* cmdBuff = MVKCommandBuffer::getMVKCommandBuffer(commandBuffer);
 	VkResult rslt = cmdBuff->begin(pBeginInfo);
+	MVKRecordVulkanFrameCall(commandBuffer, pBeginInfo->flags, mvkRecordArray(pBeginInfo->pInheritanceInfo, cmdBuff->isSecondary() ? 1 : 0));
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -1324,6 +1484,7 @@ MVK_PUBLIC_SYMBOL VkResult vkEndCommandBuffer(
 	MVKTraceVulkanCallStart();
     MVKCommandBuffer* cmdBuff = MVKCommandBuffer::getMVKCommandBuffer(commandBuffer);
 	VkResult rslt = cmdBuff->end();
+	MVKRecordVulkanFrameCall(commandBuffer);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -1335,6 +1496,7 @@ MVK_PUBLIC_SYMBOL VkResult vkResetCommandBuffer(
 	MVKTraceVulkanCallStart();
     MVKCommandBuffer* cmdBuff = MVKCommandBuffer::getMVKCommandBuffer(commandBuffer);
 	VkResult rslt = cmdBuff->reset(flags);
+	MVKRecordVulkanFrameCall(commandBuffer, flags);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -1357,6 +1519,7 @@ MVK_PUBLIC_SYMBOL void vkCmdBindPipeline(
 		default:
 			break;
 	}
+	MVKRecordVulkanFrameCall(commandBuffer, pipelineBindPoint, pipeline);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1368,6 +1531,7 @@ MVK_PUBLIC_SYMBOL void vkCmdSetViewport(
 
 	MVKTraceVulkanCallStart();
 	MVKAddCmdFromThreshold(SetViewport, viewportCount, 1, commandBuffer, firstViewport, viewportCount, pViewports);
+	MVKRecordVulkanFrameCall(commandBuffer, firstViewport, viewportCount, mvkRecordArray(pViewports, viewportCount));
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1379,6 +1543,7 @@ MVK_PUBLIC_SYMBOL void vkCmdSetScissor(
 
 	MVKTraceVulkanCallStart();
 	MVKAddCmdFromThreshold(SetScissor, scissorCount, 1, commandBuffer, firstScissor, scissorCount, pScissors);
+	MVKRecordVulkanFrameCall(commandBuffer, firstScissor, scissorCount, mvkRecordArray(pScissors, scissorCount));
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1388,6 +1553,7 @@ MVK_PUBLIC_SYMBOL void vkCmdSetLineWidth(
 
 	MVKTraceVulkanCallStart();
     MVKAddCmd(SetLineWidth, commandBuffer, lineWidth);
+	MVKRecordVulkanFrameCall(commandBuffer, lineWidth);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1399,6 +1565,7 @@ MVK_PUBLIC_SYMBOL void vkCmdSetDepthBias(
 
 	MVKTraceVulkanCallStart();
     MVKAddCmd(SetDepthBias, commandBuffer,depthBiasConstantFactor, depthBiasClamp, depthBiasSlopeFactor);
+	MVKRecordVulkanFrameCall(commandBuffer, depthBiasConstantFactor, depthBiasClamp, depthBiasSlopeFactor);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1408,6 +1575,7 @@ MVK_PUBLIC_SYMBOL void vkCmdSetBlendConstants(
 
 	MVKTraceVulkanCallStart();
     MVKAddCmd(SetBlendConstants, commandBuffer, blendConst);
+	MVKRecordVulkanFrameCall(commandBuffer, mvkRecordArray(blendConst, 4));
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1418,6 +1586,7 @@ MVK_PUBLIC_SYMBOL void vkCmdSetDepthBounds(
 
 	MVKTraceVulkanCallStart();
     MVKAddCmd(SetDepthBounds, commandBuffer, minDepthBounds, maxDepthBounds);
+	MVKRecordVulkanFrameCall(commandBuffer, minDepthBounds, maxDepthBounds);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1428,6 +1597,7 @@ MVK_PUBLIC_SYMBOL void vkCmdSetStencilCompareMask(
 
 	MVKTraceVulkanCallStart();
     MVKAddCmd(SetStencilCompareMask, commandBuffer, faceMask, stencilCompareMask);
+	MVKRecordVulkanFrameCall(commandBuffer, faceMask, stencilCompareMask);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1438,6 +1608,7 @@ MVK_PUBLIC_SYMBOL void vkCmdSetStencilWriteMask(
 
 	MVKTraceVulkanCallStart();
     MVKAddCmd(SetStencilWriteMask, commandBuffer, faceMask, stencilWriteMask);
+	MVKRecordVulkanFrameCall(commandBuffer, faceMask, stencilWriteMask);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1448,6 +1619,7 @@ MVK_PUBLIC_SYMBOL void vkCmdSetStencilReference(
 
 	MVKTraceVulkanCallStart();
     MVKAddCmd(SetStencilReference, commandBuffer, faceMask, stencilReference);
+	MVKRecordVulkanFrameCall(commandBuffer, faceMask, stencilReference);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1469,6 +1641,7 @@ MVK_PUBLIC_SYMBOL void vkCmdBindDescriptorSets(
 		MVKAddCmdFrom2Thresholds(BindDescriptorSetsStatic, setCount, 1, 4, commandBuffer, pipelineBindPoint, layout,
 				  firstSet, setCount, pDescriptorSets);
 	}
+	MVKRecordVulkanFrameCall(commandBuffer, pipelineBindPoint, layout, firstSet, setCount, mvkRecordArray(pDescriptorSets, setCount), dynamicOffsetCount, mvkRecordArray(pDynamicOffsets, dynamicOffsetCount));
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1480,6 +1653,7 @@ MVK_PUBLIC_SYMBOL void vkCmdBindIndexBuffer(
 	
 	MVKTraceVulkanCallStart();
 	MVKAddCmd(BindIndexBuffer, commandBuffer, buffer, offset, indexType);
+	MVKRecordVulkanFrameCall(commandBuffer, buffer, offset, indexType);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1492,6 +1666,7 @@ MVK_PUBLIC_SYMBOL void vkCmdBindVertexBuffers(
 	
 	MVKTraceVulkanCallStart();
 	MVKAddCmdFrom2Thresholds(BindVertexBuffers, bindingCount, 1, 2, commandBuffer, startBinding, bindingCount, pBuffers, pOffsets);
+	MVKRecordVulkanFrameCall(commandBuffer, startBinding, bindingCount, mvkRecordArray(pBuffers, bindingCount), mvkRecordArray(pOffsets, bindingCount));
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1504,6 +1679,7 @@ MVK_PUBLIC_SYMBOL void vkCmdDraw(
 
 	MVKTraceVulkanCallStart();
 	MVKAddCmd(Draw, commandBuffer, vertexCount, instanceCount, firstVertex, firstInstance);
+	MVKRecordVulkanFrameCall(commandBuffer, vertexCount, instanceCount, firstVertex, firstInstance);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1517,6 +1693,7 @@ MVK_PUBLIC_SYMBOL void vkCmdDrawIndexed(
 
 	MVKTraceVulkanCallStart();
 	MVKAddCmd(DrawIndexed, commandBuffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+	MVKRecordVulkanFrameCall(commandBuffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1529,6 +1706,7 @@ MVK_PUBLIC_SYMBOL void vkCmdDrawIndirect(
 	
 	MVKTraceVulkanCallStart();
 	MVKAddCmd(DrawIndirect, commandBuffer, buffer, offset, drawCount, stride);
+	MVKRecordVulkanFrameCall(commandBuffer, buffer, offset, drawCount, stride);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1541,6 +1719,7 @@ MVK_PUBLIC_SYMBOL void vkCmdDrawIndexedIndirect(
 	
 	MVKTraceVulkanCallStart();
 	MVKAddCmd(DrawIndexedIndirect, commandBuffer, buffer, offset, drawCount, stride);
+	MVKRecordVulkanFrameCall(commandBuffer, buffer, offset, drawCount, stride);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1552,6 +1731,7 @@ MVK_PUBLIC_SYMBOL void vkCmdDispatch(
 	
 	MVKTraceVulkanCallStart();
 	MVKAddCmd(Dispatch, commandBuffer, 0, 0, 0, x, y, z);
+	MVKRecordVulkanFrameCall(commandBuffer, x, y, z);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1562,6 +1742,7 @@ MVK_PUBLIC_SYMBOL void vkCmdDispatchIndirect(
 	
 	MVKTraceVulkanCallStart();
     MVKAddCmd(DispatchIndirect, commandBuffer, buffer, offset);
+	MVKRecordVulkanFrameCall(commandBuffer, buffer, offset);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1574,6 +1755,7 @@ MVK_PUBLIC_SYMBOL void vkCmdCopyBuffer(
 	
 	MVKTraceVulkanCallStart();
 	MVKAddCmdFromThreshold(CopyBuffer, regionCount, 1, commandBuffer, srcBuffer, destBuffer, regionCount, pRegions);
+	MVKRecordVulkanFrameCall(commandBuffer, srcBuffer, destBuffer, regionCount, mvkRecordArray(pRegions, regionCount));
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1589,6 +1771,7 @@ MVK_PUBLIC_SYMBOL void vkCmdCopyImage(
 	MVKTraceVulkanCallStart();
 	MVKAddCmdFromThreshold(CopyImage, regionCount, 1, commandBuffer,
 						   srcImage, srcImageLayout, dstImage, dstImageLayout, regionCount, pRegions);
+	MVKRecordVulkanFrameCall(commandBuffer, srcImage, srcImageLayout, dstImage, dstImageLayout, regionCount, mvkRecordArray(pRegions, regionCount));
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1605,6 +1788,7 @@ MVK_PUBLIC_SYMBOL void vkCmdBlitImage(
 	MVKTraceVulkanCallStart();
 	MVKAddCmdFromThreshold(BlitImage, regionCount, 1, commandBuffer,
 						   srcImage, srcImageLayout, dstImage, dstImageLayout, regionCount, pRegions, filter);
+	MVKRecordVulkanFrameCall(commandBuffer, srcImage, srcImageLayout, dstImage, dstImageLayout, regionCount, mvkRecordArray(pRegions, regionCount), filter);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1619,6 +1803,7 @@ MVK_PUBLIC_SYMBOL void vkCmdCopyBufferToImage(
 	MVKTraceVulkanCallStart();
     MVKAddCmdFrom3Thresholds(BufferImageCopy, regionCount, 1, 4, 8, commandBuffer,
 							 srcBuffer, dstImage, dstImageLayout, regionCount, pRegions, true);
+	MVKRecordVulkanFrameCall(commandBuffer, srcBuffer, dstImage, dstImageLayout, regionCount, mvkRecordArray(pRegions, regionCount));
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1633,6 +1818,7 @@ MVK_PUBLIC_SYMBOL void vkCmdCopyImageToBuffer(
 	MVKTraceVulkanCallStart();
 	MVKAddCmdFrom3Thresholds(BufferImageCopy, regionCount, 1, 4, 8, commandBuffer,
 							 dstBuffer, srcImage, srcImageLayout, regionCount, pRegions, false);
+	MVKRecordVulkanFrameCall(commandBuffer, srcImage, srcImageLayout, dstBuffer, regionCount, mvkRecordArray(pRegions, regionCount));
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1645,6 +1831,7 @@ MVK_PUBLIC_SYMBOL void vkCmdUpdateBuffer(
 
 	MVKTraceVulkanCallStart();
     MVKAddCmd(UpdateBuffer, commandBuffer, dstBuffer, dstOffset, dataSize, pData);
+	MVKRecordVulkanFrameCall(commandBuffer, dstBuffer, dstOffset, dataSize, mvkRecordBytes(pData, dataSize));
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1657,6 +1844,7 @@ MVK_PUBLIC_SYMBOL void vkCmdFillBuffer(
 
 	MVKTraceVulkanCallStart();
     MVKAddCmd(FillBuffer, commandBuffer, dstBuffer, dstOffset, size, data);
+	MVKRecordVulkanFrameCall(commandBuffer, dstBuffer, dstOffset, size, data);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1673,6 +1861,7 @@ MVK_PUBLIC_SYMBOL void vkCmdClearColorImage(
 	clrVal.color = *pColor;
 	MVKAddCmdFromThreshold(ClearColorImage, rangeCount, 1, commandBuffer,
 						   image, imageLayout, clrVal, rangeCount, pRanges);
+	MVKRecordVulkanFrameCall(commandBuffer, image, imageLayout, pColor, rangeCount, mvkRecordArray(pRanges, rangeCount));
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1689,6 +1878,7 @@ MVK_PUBLIC_SYMBOL void vkCmdClearDepthStencilImage(
 	clrVal.depthStencil = *pDepthStencil;
     MVKAddCmdFromThreshold(ClearDepthStencilImage, rangeCount, 1, commandBuffer,
 						   image, imageLayout, clrVal, rangeCount, pRanges);
+	MVKRecordVulkanFrameCall(commandBuffer, image, imageLayout, pDepthStencil, rangeCount, mvkRecordArray(pRanges, rangeCount));
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1707,6 +1897,7 @@ MVK_PUBLIC_SYMBOL void vkCmdClearAttachments(
 		MVKAddCmdFromThreshold(ClearSingleAttachment, rectCount, 1, commandBuffer,
 							   attachmentCount, pAttachments, rectCount, pRects);
 	}
+	MVKRecordVulkanFrameCall(commandBuffer, attachmentCount, mvkRecordArray(pAttachments, attachmentCount), rectCount, mvkRecordArray(pRects, rectCount));
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1722,6 +1913,7 @@ MVK_PUBLIC_SYMBOL void vkCmdResolveImage(
 	MVKTraceVulkanCallStart();
 	MVKAddCmdFromThreshold(ResolveImage, regionCount, 1, commandBuffer,
 						   srcImage, srcImageLayout, dstImage, dstImageLayout, regionCount, pRegions);
+	MVKRecordVulkanFrameCall(commandBuffer, srcImage, srcImageLayout, dstImage, dstImageLayout, regionCount, mvkRecordArray(pRegions, regionCount));
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1786,6 +1978,7 @@ MVK_PUBLIC_SYMBOL void vkCmdPipelineBarrier(
 							   memoryBarrierCount, pMemoryBarriers,
 							   bufferMemoryBarrierCount, pBufferMemoryBarriers,
 							   imageMemoryBarrierCount, pImageMemoryBarriers);
+	MVKRecordVulkanFrameCall(commandBuffer, srcStageMask, dstStageMask, dependencyFlags, memoryBarrierCount, mvkRecordArray(pMemoryBarriers, memoryBarrierCount), bufferMemoryBarrierCount, mvkRecordArray(pBufferMemoryBarriers, bufferMemoryBarrierCount), imageMemoryBarrierCount, mvkRecordArray(pImageMemoryBarriers, imageMemoryBarrierCount));
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1797,6 +1990,7 @@ MVK_PUBLIC_SYMBOL void vkCmdBeginQuery(
 	
 	MVKTraceVulkanCallStart();
     MVKAddCmd(BeginQuery, commandBuffer, queryPool, query, flags);
+	MVKRecordVulkanFrameCall(commandBuffer, queryPool, query, flags);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1807,6 +2001,7 @@ MVK_PUBLIC_SYMBOL void vkCmdEndQuery(
 	
 	MVKTraceVulkanCallStart();
     MVKAddCmd(EndQuery, commandBuffer, queryPool, query);
+	MVKRecordVulkanFrameCall(commandBuffer, queryPool, query);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1818,6 +2013,7 @@ MVK_PUBLIC_SYMBOL void vkCmdResetQueryPool(
 	
 	MVKTraceVulkanCallStart();
     MVKAddCmd(ResetQueryPool, commandBuffer, queryPool, firstQuery, queryCount);
+	MVKRecordVulkanFrameCall(commandBuffer, queryPool, firstQuery, queryCount);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1829,6 +2025,7 @@ MVK_PUBLIC_SYMBOL void vkCmdWriteTimestamp(
 
 	MVKTraceVulkanCallStart();
 	MVKAddCmd(WriteTimestamp, commandBuffer, pipelineStage, queryPool, query);
+	MVKRecordVulkanFrameCall(commandBuffer, pipelineStage, queryPool, query);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1858,6 +2055,7 @@ MVK_PUBLIC_SYMBOL void vkCmdPushConstants(
 	
 	MVKTraceVulkanCallStart();
 	MVKAddCmdFrom2Thresholds(PushConstants, size, 64, 128, commandBuffer, layout, stageFlags, offset, size, pValues);
+	MVKRecordVulkanFrameCall(commandBuffer, layout, stageFlags, offset, size, mvkRecordBytes(pValues, size));
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1868,6 +2066,7 @@ MVK_PUBLIC_SYMBOL void vkCmdBeginRenderPass(
 	
 	MVKTraceVulkanCallStart();
 	MVKAddCmdFrom2Thresholds(BeginRenderPass, pRenderPassBegin->clearValueCount, 1, 2, commandBuffer,pRenderPassBegin, contents);
+	MVKRecordVulkanFrameCall(commandBuffer, pRenderPassBegin, contents);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1877,6 +2076,7 @@ MVK_PUBLIC_SYMBOL void vkCmdNextSubpass(
 	
 	MVKTraceVulkanCallStart();
 	MVKAddCmd(NextSubpass, commandBuffer, contents);
+	MVKRecordVulkanFrameCall(commandBuffer, contents);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1885,6 +2085,7 @@ MVK_PUBLIC_SYMBOL void vkCmdEndRenderPass(
 	
 	MVKTraceVulkanCallStart();
 	MVKAddCmd(EndRenderPass, commandBuffer);
+	MVKRecordVulkanFrameCall(commandBuffer);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1895,6 +2096,7 @@ MVK_PUBLIC_SYMBOL void vkCmdExecuteCommands(
 	
 	MVKTraceVulkanCallStart();
 	MVKAddCmdFromThreshold(ExecuteCommands, cmdBuffersCount, 1, commandBuffer, cmdBuffersCount, pCommandBuffers);
+	MVKRecordVulkanFrameCall(commandBuffer, cmdBuffersCount, mvkRecordArray(pCommandBuffers, cmdBuffersCount));
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1950,6 +2152,7 @@ MVK_PUBLIC_SYMBOL VkResult vkCreateDescriptorUpdateTemplateKHR(
                                                           pAllocator);
     *pDescriptorUpdateTemplate = (VkDescriptorUpdateTemplateKHR)mvkDUT;
     VkResult rslt = mvkDUT->getConfigurationResult();
+	MVKRecordVulkanCall(device, pCreateInfo, pAllocator, pDescriptorUpdateTemplate);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -1962,6 +2165,7 @@ MVK_PUBLIC_SYMBOL void vkDestroyDescriptorUpdateTemplateKHR(
 	MVKTraceVulkanCallStart();
     MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
     mvkDev->destroyDescriptorUpdateTemplate((MVKDescriptorUpdateTemplate*)descriptorUpdateTemplate, pAllocator);
+	MVKRecordVulkanCall(device, descriptorUpdateTemplate, pAllocator);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -1972,7 +2176,11 @@ MVK_PUBLIC_SYMBOL void vkUpdateDescriptorSetWithTemplateKHR(
     const void*                                 pData) {
 
 	MVKTraceVulkanCallStart();
+	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
+	uint64_t startTime = mvkDev->getPerformanceTimestamp();
     mvkUpdateDescriptorSetWithTemplate(descriptorSet, descriptorUpdateTemplate, pData);
+	mvkDev->addActivityPerformance(mvkDev->_performanceStatistics.descriptors.updateDescriptorSets, startTime);
+	MVKRecordVulkanCall(device, descriptorSet, descriptorUpdateTemplate, MVKCallRecordDescriptorUpdateData(descriptorUpdateTemplate, pData));
 	MVKTraceVulkanCallEnd();
 }
 
@@ -2218,6 +2426,45 @@ MVK_PUBLIC_SYMBOL void vkCmdPushDescriptorSetWithTemplateKHR(
 }
 
 
+#pragma mark -
+#pragma mark VK_KHR_timeline_semaphore extension
+
+MVK_PUBLIC_SYMBOL VkResult vkGetSemaphoreCounterValueKHR(
+	VkDevice                                    device,
+	VkSemaphore                                 semaphore,
+	uint64_t*                                   pValue) {
+
+	MVKTraceVulkanCallStart();
+	auto* mvkSem4 = (MVKTimelineSemaphore*)semaphore;
+	*pValue = mvkSem4->getCounterValue();
+	MVKTraceVulkanCallEnd();
+	return VK_SUCCESS;
+}
+
+MVK_PUBLIC_SYMBOL VkResult vkWaitSemaphoresKHR(
+	VkDevice                                    device,
+	const VkSemaphoreWaitInfoKHR*               pWaitInfo,
+	uint64_t                                    timeout) {
+
+	MVKTraceVulkanCallStart();
+	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
+	VkResult rslt = mvkWaitSemaphores(mvkDev, pWaitInfo, timeout);
+	MVKTraceVulkanCallEnd();
+	return rslt;
+}
+
+MVK_PUBLIC_SYMBOL VkResult vkSignalSemaphoreKHR(
+	VkDevice                                    device,
+	const VkSemaphoreSignalInfoKHR*             pSignalInfo) {
+
+	MVKTraceVulkanCallStart();
+	auto* mvkSem4 = (MVKTimelineSemaphore*)pSignalInfo->semaphore;
+	mvkSem4->signal(pSignalInfo->value);
+	MVKTraceVulkanCallEnd();
+	return VK_SUCCESS;
+}
+
+
 #pragma mark -
 #pragma mark VK_KHR_swapchain extension
 
@@ -2232,6 +2479,7 @@ MVK_PUBLIC_SYMBOL VkResult vkCreateSwapchainKHR(
     MVKSwapchain* mvkSwpChn = mvkDev->createSwapchain(pCreateInfo, pAllocator);
     *pSwapchain = (VkSwapchainKHR)(mvkSwpChn);
     VkResult rslt = mvkSwpChn->getConfigurationResult();
+	MVKRecordVulkanCall(device, pCreateInfo, pAllocator, pSwapchain);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -2244,6 +2492,7 @@ MVK_PUBLIC_SYMBOL void vkDestroySwapchainKHR(
 	MVKTraceVulkanCallStart();
     MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
     mvkDev->destroySwapchain((MVKSwapchain*)swapchain, pAllocator);
+	MVKRecordVulkanCall(device, swapchain, pAllocator);
 	MVKTraceVulkanCallEnd();
 }
 
@@ -2256,6 +2505,7 @@ MVK_PUBLIC_SYMBOL VkResult vkGetSwapchainImagesKHR(
 	MVKTraceVulkanCallStart();
     MVKSwapchain* mvkSwapchain = (MVKSwapchain*)swapchain;
     VkResult rslt = mvkSwapchain->getImages(pCount, pSwapchainImages);
+	MVKRecordVulkanCall(device, swapchain, pCount, mvkRecordArray(pSwapchainImages, *pCount));
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -2271,6 +2521,7 @@ MVK_PUBLIC_SYMBOL VkResult vkAcquireNextImageKHR(
 	MVKTraceVulkanCallStart();
     MVKSwapchain* mvkSwapchain = (MVKSwapchain*)swapchain;
     VkResult rslt = mvkSwapchain->acquireNextImageKHR(timeout, semaphore, fence, ~0u, pImageIndex);
+	MVKRecordVulkanFrameCall(device, swapchain, timeout, semaphore, fence, pImageIndex);
 	MVKTraceVulkanCallEnd();
 	return rslt;
 }
@@ -2282,7 +2533,9 @@ MVK_PUBLIC_SYMBOL VkResult vkQueuePresentKHR(
 	MVKTraceVulkanCallStart();
     MVKQueue* mvkQ = MVKQueue::getMVKQueue(queue);
     VkResult rslt = mvkQ->submit(pPresentInfo);
+	MVKRecordVulkanFrameCall(queue, pPresentInfo);
 	MVKTraceVulkanCallEnd();
+	mvkEndVulkanCallRecordFrame();
 	return rslt;
 }
 
@@ -2651,6 +2904,134 @@ MVK_PUBLIC_SYMBOL void vkSubmitDebugUtilsMessageEXT(
 }
 
 
+#pragma mark -
+#pragma mark VK_EXT_extended_dynamic_state extension
+
+#ifdef VK_EXT_extended_dynamic_state
+
+MVK_PUBLIC_SYMBOL void vkCmdSetCullModeEXT(
+	VkCommandBuffer                             commandBuffer,
+	VkCullModeFlags                             cullMode) {
+
+	MVKTraceVulkanCallStart();
+	MVKAddCmd(SetCullMode, commandBuffer, cullMode);
+	MVKTraceVulkanCallEnd();
+}
+
+MVK_PUBLIC_SYMBOL void vkCmdSetFrontFaceEXT(
+	VkCommandBuffer                             commandBuffer,
+	VkFrontFace                                 frontFace) {
+
+	MVKTraceVulkanCallStart();
+	MVKAddCmd(SetFrontFace, commandBuffer, frontFace);
+	MVKTraceVulkanCallEnd();
+}
+
+MVK_PUBLIC_SYMBOL void vkCmdSetPrimitiveTopologyEXT(
+	VkCommandBuffer                             commandBuffer,
+	VkPrimitiveTopology                         primitiveTopology) {
+
+	MVKTraceVulkanCallStart();
+	MVKAddCmd(SetPrimitiveTopology, commandBuffer, primitiveTopology);
+	MVKTraceVulkanCallEnd();
+}
+
+MVK_PUBLIC_SYMBOL void vkCmdSetViewportWithCountEXT(
+	VkCommandBuffer                             commandBuffer,
+	uint32_t                                    viewportCount,
+	const VkViewport*                           pViewports) {
+
+	MVKTraceVulkanCallStart();
+	MVKAddCmdFromThreshold(SetViewport, viewportCount, 1, commandBuffer, 0, viewportCount, pViewports);
+	MVKTraceVulkanCallEnd();
+}
+
+MVK_PUBLIC_SYMBOL void vkCmdSetScissorWithCountEXT(
+	VkCommandBuffer                             commandBuffer,
+	uint32_t                                    scissorCount,
+	const VkRect2D*                             pScissors) {
+
+	MVKTraceVulkanCallStart();
+	MVKAddCmdFromThreshold(SetScissor, scissorCount, 1, commandBuffer, 0, scissorCount, pScissors);
+	MVKTraceVulkanCallEnd();
+}
+
+MVK_PUBLIC_SYMBOL void vkCmdBindVertexBuffers2EXT(
+	VkCommandBuffer                             commandBuffer,
+	uint32_t                                    firstBinding,
+	uint32_t                                    bindingCount,
+	const VkBuffer*                             pBuffers,
+	const VkDeviceSize*                         pOffsets,
+	const VkDeviceSize*                         pSizes,
+	const VkDeviceSize*                         pStrides) {
+
+	MVKTraceVulkanCallStart();
+	// Metal binds vertex buffers using the strides of the pipeline, and to the end of each buffer.
+	MVKAddCmdFrom2Thresholds(BindVertexBuffers, bindingCount, 1, 2, commandBuffer, firstBinding, bindingCount, pBuffers, pOffsets);
+	MVKTraceVulkanCallEnd();
+}
+
+MVK_PUBLIC_SYMBOL void vkCmdSetDepthTestEnableEXT(
+	VkCommandBuffer                             commandBuffer,
+	VkBool32                                    depthTestEnable) {
+
+	MVKTraceVulkanCallStart();
+	MVKAddCmd(SetDepthTestEnable, commandBuffer, depthTestEnable);
+	MVKTraceVulkanCallEnd();
+}
+
+MVK_PUBLIC_SYMBOL void vkCmdSetDepthWriteEnableEXT(
+	VkCommandBuffer                             commandBuffer,
+	VkBool32                                    depthWriteEnable) {
+
+	MVKTraceVulkanCallStart();
+	MVKAddCmd(SetDepthWriteEnable, commandBuffer, depthWriteEnable);
+	MVKTraceVulkanCallEnd();
+}
+
+MVK_PUBLIC_SYMBOL void vkCmdSetDepthCompareOpEXT(
+	VkCommandBuffer                             commandBuffer,
+	VkCompareOp                                 depthCompareOp) {
+
+	MVKTraceVulkanCallStart();
+	MVKAddCmd(SetDepthCompareOp, commandBuffer, depthCompareOp);
+	MVKTraceVulkanCallEnd();
+}
+
+MVK_PUBLIC_SYMBOL void vkCmdSetDepthBoundsTestEnableEXT(
+	VkCommandBuffer                             commandBuffer,
+	VkBool32                                    depthBoundsTestEnable) {
+
+	MVKTraceVulkanCallStart();
+	MVKAddCmd(SetDepthBoundsTestEnable, commandBuffer, depthBoundsTestEnable);
+	MVKTraceVulkanCallEnd();
+}
+
+MVK_PUBLIC_SYMBOL void vkCmdSetStencilTestEnableEXT(
+	VkCommandBuffer                             commandBuffer,
+	VkBool32                                    stencilTestEnable) {
+
+	MVKTraceVulkanCallStart();
+	MVKAddCmd(SetStencilTestEnable, commandBuffer, stencilTestEnable);
+	MVKTraceVulkanCallEnd();
+}
+
+MVK_PUBLIC_SYMBOL void vkCmdSetStencilOpEXT(
+	VkCommandBuffer                             commandBuffer,
+	VkStencilFaceFlags                          faceMask,
+	VkStencilOp                                 failOp,
+	VkStencilOp                                 passOp,
+	VkStencilOp                                 depthFailOp,
+	VkCompareOp                                 compareOp) {
+
+	MVKTraceVulkanCallStart();
+	MVKAddCmd(SetStencilOp, commandBuffer, faceMask, failOp, passOp, depthFailOp, compareOp);
+	MVKTraceVulkanCallEnd();
+}
+
+#endif	// VK_EXT_extended_dynamic_state
+
+
 #pragma mark -
 #pragma mark VK_EXT_hdr_metadata extension
 
@@ -2669,6 +3050,52 @@ MVK_PUBLIC_SYMBOL void vkSetHdrMetadataEXT(
 }
 
 
+#pragma mark -
+#pragma mark VK_GOOGLE_display_timing extension
+
+MVK_PUBLIC_SYMBOL VkResult vkGetRefreshCycleDurationGOOGLE(
+	VkDevice                                    device,
+	VkSwapchainKHR                              swapchain,
+	VkRefreshCycleDurationGOOGLE*               pDisplayTimingProperties) {
+
+	MVKTraceVulkanCallStart();
+	MVKSwapchain* mvkSwapchain = (MVKSwapchain*)swapchain;
+	VkResult rslt = mvkSwapchain->getRefreshCycleDuration(pDisplayTimingProperties);
+	MVKTraceVulkanCallEnd();
+	return rslt;
+}
+
+MVK_PUBLIC_SYMBOL VkResult vkGetPastPresentationTimingGOOGLE(
+	VkDevice                                    device,
+	VkSwapchainKHR                              swapchain,
+	uint32_t*                                   pPresentationTimingCount,
+	VkPastPresentationTimingGOOGLE*             pPresentationTimings) {
+
+	MVKTraceVulkanCallStart();
+	MVKSwapchain* mvkSwapchain = (MVKSwapchain*)swapchain;
+	VkResult rslt = mvkSwapchain->getPastPresentationTiming(pPresentationTimingCount, pPresentationTimings);
+	MVKTraceVulkanCallEnd();
+	return rslt;
+}
+
+
+#pragma mark -
+#pragma mark VK_EXT_external_memory_host extension
+
+MVK_PUBLIC_SYMBOL VkResult vkGetMemoryHostPointerPropertiesEXT(
+	VkDevice                                    device,
+	VkExternalMemoryHandleTypeFlagBits          handleType,
+	const void*                                 pHostPointer,
+	VkMemoryHostPointerPropertiesEXT*           pMemoryHostPointerProperties) {
+
+	MVKTraceVulkanCallStart();
+	MVKDevice* mvkDev = MVKDevice::getMVKDevice(device);
+	VkResult rslt = mvkDev->getMemoryHostPointerProperties(handleType, pHostPointer, pMemoryHostPointerProperties);
+	MVKTraceVulkanCallEnd();
+	return rslt;
+}
+
+
 #pragma mark -
 #pragma mark VK_EXT_host_query_reset extension
 
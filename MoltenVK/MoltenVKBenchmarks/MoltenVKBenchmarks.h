@@ -0,0 +1,118 @@
+/*
+ * MoltenVKBenchmarks.h
+ *
+ * Copyright (c) 2015-2020 The Brenwill Workshop Ltd. (http://www.brenwill.com)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+
+#include <MoltenVK/vk_mvk_moltenvk.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+namespace mvk {
+
+	/** The durations, in milliseconds, of the iterations of a single benchmark. */
+	typedef struct {
+		std::string name;
+		uint64_t operationCount = 0;		/**< The number of operations performed in each iteration. */
+		std::vector<double> durations;		/**< The duration of each iteration, in milliseconds. */
+		double queueSubmitDuration = 0.0;	/**< The average duration reported by MoltenVK for each vkQueueSubmit(), if measured. */
+	} MVKBenchmarkResult;
+
+
+#pragma mark -
+#pragma mark MoltenVKBenchmarks
+
+	/**
+	 * Runs headless microbenchmarks of the MoltenVK hot paths, and writes the results
+	 * as a single line of JSON, so the results from successive MoltenVK releases can
+	 * be compared to detect performance regressions.
+	 */
+	class MoltenVKBenchmarks {
+
+	public:
+
+		/**
+		 * Runs the benchmarks, based on command line arguments.
+		 * Returns zero if all went well, or an error code if not.
+		 */
+		int run();
+
+		/** Constructor with specified command line arguments. */
+		MoltenVKBenchmarks(int argc, const char* argv[]);
+
+		~MoltenVKBenchmarks();
+
+	protected:
+		bool parseArgs(int argc, const char* argv[]);
+		void showUsage();
+		void log(const char* logMsg);
+		bool initVulkan();
+		bool initRenderTarget();
+		bool initGraphicsPipeline();
+		bool initDescriptors();
+		void destroyVulkan();
+		uint32_t getMemoryTypeIndex(uint32_t memTypeBits, VkMemoryPropertyFlags memFlags);
+		bool shouldRun(const char* benchmarkName);
+		void measure(const char* benchmarkName, uint64_t operationCount, std::function<void()> iteration);
+		void recordCommands(VkCommandBuffer cmdBuff, uint32_t cmdCount, std::function<void(VkCommandBuffer)> recordCommand);
+		VkPipeline newComputePipeline(const std::vector<char>* pInitialCacheData, std::vector<char>* pCacheData = nullptr);
+		void waitForPipelineCompilation(VkPipeline pipeline);
+		void runCommandRecordingBenchmarks();
+		void runSubmitBenchmarks();
+		void runDescriptorBenchmarks();
+		void runPipelineBenchmarks();
+		void runPixelFormatBenchmarks();
+		void runCodecBenchmarks();
+		bool writeResults();
+
+		std::string _processName;
+		std::string _outputFilePath;
+		std::string _filter;
+		std::vector<MVKBenchmarkResult> _results;
+		uint32_t _iterationCount;
+		uint32_t _operationCount;
+		bool _isActive;
+
+		VkInstance _instance = VK_NULL_HANDLE;
+		VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
+		VkPhysicalDeviceProperties _physicalDeviceProperties;
+		VkPhysicalDeviceMemoryProperties _memoryProperties;
+		VkDevice _device = VK_NULL_HANDLE;
+		VkQueue _queue = VK_NULL_HANDLE;
+		uint32_t _queueFamilyIndex = 0;
+		VkCommandPool _commandPool = VK_NULL_HANDLE;
+		VkCommandBuffer _commandBuffer = VK_NULL_HANDLE;
+		VkImage _colorImage = VK_NULL_HANDLE;
+		VkDeviceMemory _colorImageMemory = VK_NULL_HANDLE;
+		VkImageView _colorImageView = VK_NULL_HANDLE;
+		VkRenderPass _renderPass = VK_NULL_HANDLE;
+		VkFramebuffer _framebuffer = VK_NULL_HANDLE;
+		VkShaderModule _graphicsShaderModule = VK_NULL_HANDLE;
+		VkDescriptorSetLayout _descriptorSetLayout = VK_NULL_HANDLE;
+		VkPipelineLayout _pipelineLayout = VK_NULL_HANDLE;
+		VkPipeline _graphicsPipeline = VK_NULL_HANDLE;
+		VkBuffer _uniformBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory _uniformBufferMemory = VK_NULL_HANDLE;
+		VkDescriptorPool _descriptorPool = VK_NULL_HANDLE;
+		VkDescriptorSet _descriptorSet = VK_NULL_HANDLE;
+		VkDescriptorUpdateTemplateKHR _descriptorUpdateTemplate = VK_NULL_HANDLE;
+	};
+
+}
@@ -0,0 +1,881 @@
+/*
+ * MoltenVKBenchmarks.mm
+ *
+ * Copyright (c) 2015-2020 The Brenwill Workshop Ltd. (http://www.brenwill.com)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MoltenVKBenchmarks.h"
+#include "MVKCodec.h"
+#include "MVKFoundation.h"
+#include <Foundation/Foundation.h>
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <stdio.h>
+#include <string.h>
+
+using namespace mvk;
+using namespace std;
+
+
+#pragma mark Shader code
+
+// Renders a tiny triangle covering a corner of the render target,
+// so that submission benchmarks are dominated by encoding, not by the GPU.
+static const char* _graphicsMSL =
+	"#include <metal_stdlib>\n"
+	"using namespace metal;\n"
+	"struct BenchmarkVertexOut { float4 position [[position]]; };\n"
+	"vertex BenchmarkVertexOut benchmarkVertex(uint vid [[vertex_id]]) {\n"
+	"	BenchmarkVertexOut out;\n"
+	"	out.position = float4(float(vid & 1) * 0.1, float(vid >> 1) * 0.1, 0.0, 1.0);\n"
+	"	return out;\n"
+	"}\n"
+	"fragment float4 benchmarkFragment() { return float4(1.0); }\n";
+
+// An empty SPIR-V compute shader, with a LocalSize of (1, 1, 1), and an entry point named "main".
+// SPIR-V is used, rather than MSL, so pipeline creation exercises SPIR-V conversion and the pipeline cache.
+static const uint32_t _computeSPIRV[] = {
+	0x07230203, 0x00010000, 0x00000000, 0x00000005, 0x00000000,		// Header, with an ID bound of 5
+	0x00020011, 0x00000001,											// OpCapability Shader
+	0x0003000E, 0x00000000, 0x00000001,								// OpMemoryModel Logical GLSL450
+	0x0005000F, 0x00000005, 0x00000003, 0x6E69616D, 0x00000000,		// OpEntryPoint GLCompute %3 "main"
+	0x00060010, 0x00000003, 0x00000011, 0x00000001, 0x00000001, 0x00000001,	// OpExecutionMode %3 LocalSize 1 1 1
+	0x00020013, 0x00000001,											// %1 = OpTypeVoid
+	0x00030021, 0x00000002, 0x00000001,								// %2 = OpTypeFunction %1
+	0x00050036, 0x00000001, 0x00000003, 0x00000000, 0x00000002,		// %3 = OpFunction %1 None %2
+	0x000200F8, 0x00000004,											// %4 = OpLabel
+	0x000100FD,														// OpReturn
+	0x00010038,														// OpFunctionEnd
+};
+
+static const uint32_t kMVKBenchmarkRenderTargetSize = 64;
+static const uint32_t kMVKBenchmarkCodecTextureSize = 1024;
+static const uint32_t kMVKBenchmarkPushConstantsSize = 64;
+
+
+#pragma mark -
+#pragma mark MoltenVKBenchmarks
+
+int MoltenVKBenchmarks::run() {
+	if ( !_isActive ) { return EXIT_FAILURE; }
+
+	bool success = initVulkan();
+	if (success) {
+		runCommandRecordingBenchmarks();
+		runSubmitBenchmarks();
+		runDescriptorBenchmarks();
+		runPipelineBenchmarks();
+		runPixelFormatBenchmarks();
+		runCodecBenchmarks();
+		success = writeResults();
+	}
+	destroyVulkan();
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Times each iteration separately, after one untimed iteration to warm up allocations and caches.
+void MoltenVKBenchmarks::measure(const char* benchmarkName, uint64_t operationCount, function<void()> iteration) {
+	MVKBenchmarkResult result;
+	result.name = benchmarkName;
+	result.operationCount = operationCount;
+
+	iteration();
+	for (uint32_t iterIdx = 0; iterIdx < _iterationCount; iterIdx++) {
+		auto startTime = chrono::steady_clock::now();
+		iteration();
+		auto endTime = chrono::steady_clock::now();
+		result.durations.push_back(chrono::duration<double, milli>(endTime - startTime).count());
+	}
+	_results.push_back(result);
+
+	string line = "Completed " + result.name;
+	log(line.c_str());
+}
+
+bool MoltenVKBenchmarks::shouldRun(const char* benchmarkName) {
+	return _filter.empty() || strstr(benchmarkName, _filter.c_str());
+}
+
+
+#pragma mark Command recording
+
+// Records the specified number of the specified command within a render pass, using the graphics pipeline.
+void MoltenVKBenchmarks::recordCommands(VkCommandBuffer cmdBuff, uint32_t cmdCount, function<void(VkCommandBuffer)> recordCommand) {
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	vkBeginCommandBuffer(cmdBuff, &beginInfo);
+
+	VkRenderPassBeginInfo rpBeginInfo = {};
+	rpBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	rpBeginInfo.renderPass = _renderPass;
+	rpBeginInfo.framebuffer = _framebuffer;
+	rpBeginInfo.renderArea.extent = { kMVKBenchmarkRenderTargetSize, kMVKBenchmarkRenderTargetSize };
+	vkCmdBeginRenderPass(cmdBuff, &rpBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+	vkCmdBindPipeline(cmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, _graphicsPipeline);
+	VkViewport viewport = { 0.0f, 0.0f, (float)kMVKBenchmarkRenderTargetSize, (float)kMVKBenchmarkRenderTargetSize, 0.0f, 1.0f };
+	vkCmdSetViewport(cmdBuff, 0, 1, &viewport);
+	VkRect2D scissor = { { 0, 0 }, { kMVKBenchmarkRenderTargetSize, kMVKBenchmarkRenderTargetSize } };
+	vkCmdSetScissor(cmdBuff, 0, 1, &scissor);
+	vkCmdBindDescriptorSets(cmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, 0, 1, &_descriptorSet, 0, nullptr);
+
+	for (uint32_t cmdIdx = 0; cmdIdx < cmdCount; cmdIdx++) { recordCommand(cmdBuff); }
+
+	vkCmdEndRenderPass(cmdBuff);
+	vkEndCommandBuffer(cmdBuff);
+}
+
+void MoltenVKBenchmarks::runCommandRecordingBenchmarks() {
+	uint8_t pushConstants[kMVKBenchmarkPushConstantsSize] = {};
+	uint32_t opCnt = _operationCount;
+
+	if (shouldRun("recordDraw")) {
+		measure("recordDraw", opCnt, [&]() {
+			recordCommands(_commandBuffer, opCnt, [](VkCommandBuffer cmdBuff) { vkCmdDraw(cmdBuff, 3, 1, 0, 0); });
+			vkResetCommandPool(_device, _commandPool, 0);
+		});
+	}
+
+	if (shouldRun("recordBindDescriptorSets")) {
+		measure("recordBindDescriptorSets", opCnt, [&]() {
+			recordCommands(_commandBuffer, opCnt, [&](VkCommandBuffer cmdBuff) {
+				vkCmdBindDescriptorSets(cmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, 0, 1, &_descriptorSet, 0, nullptr);
+			});
+			vkResetCommandPool(_device, _commandPool, 0);
+		});
+	}
+
+	if (shouldRun("recordPushConstants")) {
+		measure("recordPushConstants", opCnt, [&]() {
+			recordCommands(_commandBuffer, opCnt, [&](VkCommandBuffer cmdBuff) {
+				vkCmdPushConstants(cmdBuff, _pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pushConstants), pushConstants);
+			});
+			vkResetCommandPool(_device, _commandPool, 0);
+		});
+	}
+}
+
+
+#pragma mark Submission
+
+// Command buffers are encoded into Metal when submitted, so resubmitting the same
+// recorded command buffer measures the encoding of its commands each time.
+void MoltenVKBenchmarks::runSubmitBenchmarks() {
+	if ( !shouldRun("submitDraws") ) { return; }
+
+	uint8_t pushConstants[kMVKBenchmarkPushConstantsSize] = {};
+	recordCommands(_commandBuffer, _operationCount, [&](VkCommandBuffer cmdBuff) {
+		vkCmdPushConstants(cmdBuff, _pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pushConstants), pushConstants);
+		vkCmdBindDescriptorSets(cmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, 0, 1, &_descriptorSet, 0, nullptr);
+		vkCmdDraw(cmdBuff, 3, 1, 0, 0);
+	});
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &_commandBuffer;
+
+	measure("submitDraws", _operationCount, [&]() {
+		vkQueueSubmit(_queue, 1, &submitInfo, VK_NULL_HANDLE);
+		vkQueueWaitIdle(_queue);
+	});
+
+	// The wall-clock duration above includes GPU execution, so also report the CPU time spent within vkQueueSubmit().
+	MVKPerformanceStatistics perfStats;
+	size_t perfStatsSize = sizeof(perfStats);
+	if (vkGetPerformanceStatisticsMVK(_device, &perfStats, &perfStatsSize) == VK_SUCCESS) {
+		_results.back().queueSubmitDuration = perfStats.queue.queueSubmit.averageDuration;
+	}
+
+	vkResetCommandPool(_device, _commandPool, 0);
+}
+
+
+#pragma mark Descriptors
+
+void MoltenVKBenchmarks::runDescriptorBenchmarks() {
+	uint32_t opCnt = _operationCount;
+
+	VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, opCnt };
+	VkDescriptorPoolCreateInfo dpInfo = {};
+	dpInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	dpInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+	dpInfo.maxSets = opCnt;
+	dpInfo.poolSizeCount = 1;
+	dpInfo.pPoolSizes = &poolSize;
+	VkDescriptorPool descPool = VK_NULL_HANDLE;
+	if (vkCreateDescriptorPool(_device, &dpInfo, nullptr, &descPool) != VK_SUCCESS) {
+		log("Could not create the descriptor pool for the descriptor benchmarks.");
+		return;
+	}
+
+	vector<VkDescriptorSetLayout> dsLayouts(opCnt, _descriptorSetLayout);
+	vector<VkDescriptorSet> descSets(opCnt, VK_NULL_HANDLE);
+	VkDescriptorSetAllocateInfo dsAllocInfo = {};
+	dsAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	dsAllocInfo.descriptorPool = descPool;
+	dsAllocInfo.descriptorSetCount = opCnt;
+	dsAllocInfo.pSetLayouts = dsLayouts.data();
+
+	if (shouldRun("descriptorSetAllocateFree")) {
+		measure("descriptorSetAllocateFree", opCnt, [&]() {
+			vkAllocateDescriptorSets(_device, &dsAllocInfo, descSets.data());
+			vkFreeDescriptorSets(_device, descPool, opCnt, descSets.data());
+		});
+	}
+
+	VkDescriptorBufferInfo buffInfo = { _uniformBuffer, 0, VK_WHOLE_SIZE };
+	VkWriteDescriptorSet descWrite = {};
+	descWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descWrite.dstBinding = 0;
+	descWrite.descriptorCount = 1;
+	descWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	descWrite.pBufferInfo = &buffInfo;
+
+	vkAllocateDescriptorSets(_device, &dsAllocInfo, descSets.data());
+
+	if (shouldRun("descriptorSetUpdate")) {
+		measure("descriptorSetUpdate", opCnt, [&]() {
+			for (auto descSet : descSets) {
+				descWrite.dstSet = descSet;
+				vkUpdateDescriptorSets(_device, 1, &descWrite, 0, nullptr);
+			}
+		});
+	}
+
+	if (shouldRun("descriptorSetUpdateWithTemplate")) {
+		measure("descriptorSetUpdateWithTemplate", opCnt, [&]() {
+			for (auto descSet : descSets) {
+				vkUpdateDescriptorSetWithTemplateKHR(_device, descSet, _descriptorUpdateTemplate, &buffInfo);
+			}
+		});
+	}
+
+	vkDestroyDescriptorPool(_device, descPool, nullptr);
+}
+
+
+#pragma mark Pipelines
+
+// Creates a compute pipeline from a new shader module and a new pipeline cache, as an app does when it
+// starts. If initial cache data is provided, the MSL held in the cache data avoids SPIR-V conversion.
+// If pCacheData is provided, it is populated with the content of the pipeline cache.
+VkPipeline MoltenVKBenchmarks::newComputePipeline(const vector<char>* pInitialCacheData, vector<char>* pCacheData) {
+	VkShaderModuleCreateInfo smInfo = {};
+	smInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	smInfo.codeSize = sizeof(_computeSPIRV);
+	smInfo.pCode = _computeSPIRV;
+	VkShaderModule shaderModule = VK_NULL_HANDLE;
+	vkCreateShaderModule(_device, &smInfo, nullptr, &shaderModule);
+
+	VkPipelineCacheCreateInfo pcInfo = {};
+	pcInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	if (pInitialCacheData) {
+		pcInfo.initialDataSize = pInitialCacheData->size();
+		pcInfo.pInitialData = pInitialCacheData->data();
+	}
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+	vkCreatePipelineCache(_device, &pcInfo, nullptr, &pipelineCache);
+
+	VkComputePipelineCreateInfo plInfo = {};
+	plInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	plInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	plInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	plInfo.stage.module = shaderModule;
+	plInfo.stage.pName = "main";
+	plInfo.layout = _pipelineLayout;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	vkCreateComputePipelines(_device, pipelineCache, 1, &plInfo, nullptr, &pipeline);
+	waitForPipelineCompilation(pipeline);
+
+	if (pCacheData) {
+		size_t dataSize = 0;
+		vkGetPipelineCacheData(_device, pipelineCache, &dataSize, nullptr);
+		pCacheData->resize(dataSize);
+		vkGetPipelineCacheData(_device, pipelineCache, &dataSize, pCacheData->data());
+	}
+
+	vkDestroyPipelineCache(_device, pipelineCache, nullptr);
+	vkDestroyShaderModule(_device, shaderModule, nullptr);
+	return pipeline;
+}
+
+// If pipelines are compiled asynchronously, include the background compilation in the measurement.
+void MoltenVKBenchmarks::waitForPipelineCompilation(VkPipeline pipeline) {
+	while (pipeline && vkGetPipelineCompilationStatusMVK(_device, pipeline) == VK_NOT_READY) {
+		[NSThread sleepForTimeInterval: 0.0001];
+	}
+}
+
+// Metal maintains its own cache of compiled shaders, which may also shorten cold pipeline creation.
+void MoltenVKBenchmarks::runPipelineBenchmarks() {
+	if (shouldRun("computePipelineCreateCold")) {
+		measure("computePipelineCreateCold", 1, [&]() {
+			vkDestroyPipeline(_device, newComputePipeline(nullptr), nullptr);
+		});
+	}
+
+	if (shouldRun("computePipelineCreateWarm")) {
+		vector<char> cacheData;
+		vkDestroyPipeline(_device, newComputePipeline(nullptr, &cacheData), nullptr);
+		measure("computePipelineCreateWarm", 1, [&]() {
+			vkDestroyPipeline(_device, newComputePipeline(&cacheData), nullptr);
+		});
+	}
+}
+
+
+#pragma mark Pixel formats
+
+// Queries the properties of every core format, each of which is looked up in MVKPixelFormats.
+void MoltenVKBenchmarks::runPixelFormatBenchmarks() {
+	const uint32_t fmtCnt = VK_FORMAT_ASTC_12x12_SRGB_BLOCK + 1;
+
+	if (shouldRun("formatProperties")) {
+		measure("formatProperties", fmtCnt, [&]() {
+			VkFormatProperties fmtProps;
+			for (uint32_t fmtIdx = 0; fmtIdx < fmtCnt; fmtIdx++) {
+				vkGetPhysicalDeviceFormatProperties(_physicalDevice, (VkFormat)fmtIdx, &fmtProps);
+			}
+		});
+	}
+
+	if (shouldRun("imageFormatProperties")) {
+		measure("imageFormatProperties", fmtCnt, [&]() {
+			VkImageFormatProperties imgFmtProps;
+			for (uint32_t fmtIdx = 0; fmtIdx < fmtCnt; fmtIdx++) {
+				vkGetPhysicalDeviceImageFormatProperties(_physicalDevice, (VkFormat)fmtIdx, VK_IMAGE_TYPE_2D,
+														 VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, 0, &imgFmtProps);
+			}
+		});
+	}
+}
+
+
+#pragma mark Codecs
+
+// Decompresses a texture of each family of compressed formats, as MoltenVK does on the
+// CPU when uploading compressed content to a GPU that does not support the format.
+void MoltenVKBenchmarks::runCodecBenchmarks() {
+	struct {
+		const char* name;
+		VkFormat format;
+		uint32_t blockByteCount;
+	} codecFormats[] = {
+		{ "decompressBC1", VK_FORMAT_BC1_RGBA_UNORM_BLOCK, 8 },
+		{ "decompressBC3", VK_FORMAT_BC3_UNORM_BLOCK, 16 },
+		{ "decompressBC5", VK_FORMAT_BC5_UNORM_BLOCK, 16 },
+	};
+
+	const uint32_t texSize = kMVKBenchmarkCodecTextureSize;
+	const uint32_t blocksPerRow = texSize / 4;
+	VkExtent3D extent = { texSize, texSize, 1 };
+	vector<uint8_t> dstData(texSize * texSize * 4);
+
+	VkSubresourceLayout dstLayout = {};
+	dstLayout.rowPitch = texSize * 4;
+	dstLayout.depthPitch = dstData.size();
+	dstLayout.size = dstData.size();
+
+	for (auto& codecFmt : codecFormats) {
+		if ( !shouldRun(codecFmt.name) ) { continue; }
+
+		auto codec = mvkCreateCodec(codecFmt.format);
+		if ( !codec ) { continue; }
+
+		// Arbitrary, but repeatable, block content exercises all palette entries.
+		vector<uint8_t> srcData(blocksPerRow * blocksPerRow * codecFmt.blockByteCount);
+		for (size_t byteIdx = 0; byteIdx < srcData.size(); byteIdx++) { srcData[byteIdx] = (uint8_t)(byteIdx * 2654435761u >> 24); }
+
+		VkSubresourceLayout srcLayout = {};
+		srcLayout.rowPitch = blocksPerRow * codecFmt.blockByteCount;
+		srcLayout.depthPitch = srcData.size();
+		srcLayout.size = srcData.size();
+
+		measure(codecFmt.name, uint64_t(texSize) * texSize, [&]() {
+			codec->decompress(dstData.data(), srcData.data(), dstLayout, srcLayout, extent);
+		});
+	}
+}
+
+
+#pragma mark Results
+
+// Writes one line of JSON, appending to the output file if one was specified, or to stdout otherwise.
+bool MoltenVKBenchmarks::writeResults() {
+	FILE* pFile = _outputFilePath.empty() ? stdout : fopen(_outputFilePath.c_str(), "a");
+	if ( !pFile ) {
+		string errMsg = "Could not open output file " + _outputFilePath;
+		log(errMsg.c_str());
+		return false;
+	}
+
+	fprintf(pFile, "{\"moltenVKVersion\":\"%d.%d.%d\",\"gpu\":\"%s\",\"timestamp\":%.0f,\"iterations\":%u,\"benchmarks\":[",
+			MVK_VERSION_MAJOR, MVK_VERSION_MINOR, MVK_VERSION_PATCH,
+			mvkGetJSONEscapedString(_physicalDeviceProperties.deviceName).c_str(),
+			[NSDate date].timeIntervalSince1970, _iterationCount);
+
+	const char* sep = "";
+	for (auto& result : _results) {
+		auto durations = result.durations;
+		sort(durations.begin(), durations.end());
+		double minDur = durations.empty() ? 0.0 : durations.front();
+		double maxDur = durations.empty() ? 0.0 : durations.back();
+		double medianDur = durations.empty() ? 0.0 : durations[durations.size() / 2];
+		double meanDur = durations.empty() ? 0.0 : accumulate(durations.begin(), durations.end(), 0.0) / durations.size();
+		double nsPerOp = result.operationCount ? medianDur * 1000000.0 / result.operationCount : 0.0;
+
+		fprintf(pFile, "%s{\"name\":\"%s\",\"operations\":%llu,\"min\":%.6f,\"median\":%.6f,\"mean\":%.6f,\"max\":%.6f,\"nsPerOperation\":%.3f",
+				sep, result.name.c_str(), (unsigned long long)result.operationCount, minDur, medianDur, meanDur, maxDur, nsPerOp);
+		if (result.queueSubmitDuration) { fprintf(pFile, ",\"queueSubmit\":%.6f", result.queueSubmitDuration); }
+		fprintf(pFile, "}");
+		sep = ",";
+	}
+	fprintf(pFile, "]}\n");
+
+	if (pFile != stdout) { fclose(pFile); }
+	return true;
+}
+
+
+#pragma mark Vulkan
+
+bool MoltenVKBenchmarks::initVulkan() {
+	VkApplicationInfo appInfo = {};
+	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pApplicationName = _processName.c_str();
+	appInfo.apiVersion = VK_API_VERSION_1_0;
+
+	VkInstanceCreateInfo instInfo = {};
+	instInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	instInfo.pApplicationInfo = &appInfo;
+	if (vkCreateInstance(&instInfo, nullptr, &_instance) != VK_SUCCESS) {
+		log("Could not create a VkInstance.");
+		return false;
+	}
+
+	// Track performance, so vkQueueSubmit() durations can be reported, and ensure
+	// command buffers are encoded when submitted, so submission measures encoding.
+	MVKConfiguration mvkConfig;
+	size_t mvkConfigSize = sizeof(mvkConfig);
+	vkGetMoltenVKConfigurationMVK(_instance, &mvkConfig, &mvkConfigSize);
+	mvkConfig.performanceTracking = true;
+	mvkConfig.prefillMetalCommandBuffers = false;
+	mvkConfig.synchronousQueueSubmits = true;
+	vkSetMoltenVKConfigurationMVK(_instance, &mvkConfig, &mvkConfigSize);
+
+	uint32_t gpuCnt = 1;
+	vkEnumeratePhysicalDevices(_instance, &gpuCnt, &_physicalDevice);
+	if ( !gpuCnt ) {
+		log("Could not find a GPU.");
+		return false;
+	}
+	vkGetPhysicalDeviceProperties(_physicalDevice, &_physicalDeviceProperties);
+	vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &_memoryProperties);
+
+	uint32_t qfCnt = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &qfCnt, nullptr);
+	vector<VkQueueFamilyProperties> qfProps(qfCnt);
+	vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &qfCnt, qfProps.data());
+	for (uint32_t qfIdx = 0; qfIdx < qfCnt; qfIdx++) {
+		if (mvkIsAnyFlagEnabled(qfProps[qfIdx].queueFlags, VK_QUEUE_GRAPHICS_BIT)) {
+			_queueFamilyIndex = qfIdx;
+			break;
+		}
+	}
+
+	float qPriority = 1.0f;
+	VkDeviceQueueCreateInfo qInfo = {};
+	qInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	qInfo.queueFamilyIndex = _queueFamilyIndex;
+	qInfo.queueCount = 1;
+	qInfo.pQueuePriorities = &qPriority;
+
+	const char* extnNames[] = { VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME };
+	VkDeviceCreateInfo devInfo = {};
+	devInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	devInfo.queueCreateInfoCount = 1;
+	devInfo.pQueueCreateInfos = &qInfo;
+	devInfo.enabledExtensionCount = 1;
+	devInfo.ppEnabledExtensionNames = extnNames;
+	if (vkCreateDevice(_physicalDevice, &devInfo, nullptr, &_device) != VK_SUCCESS) {
+		log("Could not create a VkDevice.");
+		return false;
+	}
+	vkGetDeviceQueue(_device, _queueFamilyIndex, 0, &_queue);
+
+	VkCommandPoolCreateInfo cpInfo = {};
+	cpInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	cpInfo.queueFamilyIndex = _queueFamilyIndex;
+	vkCreateCommandPool(_device, &cpInfo, nullptr, &_commandPool);
+
+	VkCommandBufferAllocateInfo cbInfo = {};
+	cbInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	cbInfo.commandPool = _commandPool;
+	cbInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	cbInfo.commandBufferCount = 1;
+	vkAllocateCommandBuffers(_device, &cbInfo, &_commandBuffer);
+
+	return initRenderTarget() && initDescriptors() && initGraphicsPipeline();
+}
+
+bool MoltenVKBenchmarks::initRenderTarget() {
+	const VkFormat colorFormat = VK_FORMAT_B8G8R8A8_UNORM;
+
+	VkImageCreateInfo imgInfo = {};
+	imgInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imgInfo.imageType = VK_IMAGE_TYPE_2D;
+	imgInfo.format = colorFormat;
+	imgInfo.extent = { kMVKBenchmarkRenderTargetSize, kMVKBenchmarkRenderTargetSize, 1 };
+	imgInfo.mipLevels = 1;
+	imgInfo.arrayLayers = 1;
+	imgInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imgInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imgInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	imgInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	if (vkCreateImage(_device, &imgInfo, nullptr, &_colorImage) != VK_SUCCESS) {
+		log("Could not create the render target image.");
+		return false;
+	}
+
+	VkMemoryRequirements memReqs;
+	vkGetImageMemoryRequirements(_device, _colorImage, &memReqs);
+	VkMemoryAllocateInfo memInfo = {};
+	memInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memInfo.allocationSize = memReqs.size;
+	memInfo.memoryTypeIndex = getMemoryTypeIndex(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (vkAllocateMemory(_device, &memInfo, nullptr, &_colorImageMemory) != VK_SUCCESS) {
+		log("Could not allocate memory for the render target image.");
+		return false;
+	}
+	vkBindImageMemory(_device, _colorImage, _colorImageMemory, 0);
+
+	VkImageViewCreateInfo viewInfo = {};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = _colorImage;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = colorFormat;
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	vkCreateImageView(_device, &viewInfo, nullptr, &_colorImageView);
+
+	VkAttachmentDescription attDesc = {};
+	attDesc.format = colorFormat;
+	attDesc.samples = VK_SAMPLE_COUNT_1_BIT;
+	attDesc.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attDesc.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attDesc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attDesc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attDesc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	attDesc.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference colorRef = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+	VkSubpassDescription spDesc = {};
+	spDesc.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	spDesc.colorAttachmentCount = 1;
+	spDesc.pColorAttachments = &colorRef;
+
+	VkRenderPassCreateInfo rpInfo = {};
+	rpInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	rpInfo.attachmentCount = 1;
+	rpInfo.pAttachments = &attDesc;
+	rpInfo.subpassCount = 1;
+	rpInfo.pSubpasses = &spDesc;
+	vkCreateRenderPass(_device, &rpInfo, nullptr, &_renderPass);
+
+	VkFramebufferCreateInfo fbInfo = {};
+	fbInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	fbInfo.renderPass = _renderPass;
+	fbInfo.attachmentCount = 1;
+	fbInfo.pAttachments = &_colorImageView;
+	fbInfo.width = kMVKBenchmarkRenderTargetSize;
+	fbInfo.height = kMVKBenchmarkRenderTargetSize;
+	fbInfo.layers = 1;
+	vkCreateFramebuffer(_device, &fbInfo, nullptr, &_framebuffer);
+
+	return true;
+}
+
+bool MoltenVKBenchmarks::initDescriptors() {
+	VkBufferCreateInfo buffInfo = {};
+	buffInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffInfo.size = 256;
+	buffInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+	vkCreateBuffer(_device, &buffInfo, nullptr, &_uniformBuffer);
+
+	VkMemoryRequirements memReqs;
+	vkGetBufferMemoryRequirements(_device, _uniformBuffer, &memReqs);
+	VkMemoryAllocateInfo memInfo = {};
+	memInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memInfo.allocationSize = memReqs.size;
+	memInfo.memoryTypeIndex = getMemoryTypeIndex(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+	if (vkAllocateMemory(_device, &memInfo, nullptr, &_uniformBufferMemory) != VK_SUCCESS) {
+		log("Could not allocate memory for the uniform buffer.");
+		return false;
+	}
+	vkBindBufferMemory(_device, _uniformBuffer, _uniformBufferMemory, 0);
+
+	VkDescriptorSetLayoutBinding dslBinding = {};
+	dslBinding.binding = 0;
+	dslBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	dslBinding.descriptorCount = 1;
+	dslBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+	VkDescriptorSetLayoutCreateInfo dslInfo = {};
+	dslInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	dslInfo.bindingCount = 1;
+	dslInfo.pBindings = &dslBinding;
+	vkCreateDescriptorSetLayout(_device, &dslInfo, nullptr, &_descriptorSetLayout);
+
+	VkPushConstantRange pcRange = { VK_SHADER_STAGE_VERTEX_BIT, 0, kMVKBenchmarkPushConstantsSize };
+	VkPipelineLayoutCreateInfo plInfo = {};
+	plInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	plInfo.setLayoutCount = 1;
+	plInfo.pSetLayouts = &_descriptorSetLayout;
+	plInfo.pushConstantRangeCount = 1;
+	plInfo.pPushConstantRanges = &pcRange;
+	vkCreatePipelineLayout(_device, &plInfo, nullptr, &_pipelineLayout);
+
+	VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 };
+	VkDescriptorPoolCreateInfo dpInfo = {};
+	dpInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	dpInfo.maxSets = 1;
+	dpInfo.poolSizeCount = 1;
+	dpInfo.pPoolSizes = &poolSize;
+	vkCreateDescriptorPool(_device, &dpInfo, nullptr, &_descriptorPool);
+
+	VkDescriptorSetAllocateInfo dsAllocInfo = {};
+	dsAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	dsAllocInfo.descriptorPool = _descriptorPool;
+	dsAllocInfo.descriptorSetCount = 1;
+	dsAllocInfo.pSetLayouts = &_descriptorSetLayout;
+	if (vkAllocateDescriptorSets(_device, &dsAllocInfo, &_descriptorSet) != VK_SUCCESS) {
+		log("Could not allocate a descriptor set.");
+		return false;
+	}
+
+	VkDescriptorBufferInfo descBuffInfo = { _uniformBuffer, 0, VK_WHOLE_SIZE };
+	VkWriteDescriptorSet descWrite = {};
+	descWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descWrite.dstSet = _descriptorSet;
+	descWrite.dstBinding = 0;
+	descWrite.descriptorCount = 1;
+	descWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	descWrite.pBufferInfo = &descBuffInfo;
+	vkUpdateDescriptorSets(_device, 1, &descWrite, 0, nullptr);
+
+	VkDescriptorUpdateTemplateEntryKHR dutEntry = {};
+	dutEntry.dstBinding = 0;
+	dutEntry.descriptorCount = 1;
+	dutEntry.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	dutEntry.stride = sizeof(VkDescriptorBufferInfo);
+
+	VkDescriptorUpdateTemplateCreateInfoKHR dutInfo = {};
+	dutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO_KHR;
+	dutInfo.descriptorUpdateEntryCount = 1;
+	dutInfo.pDescriptorUpdateEntries = &dutEntry;
+	dutInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET_KHR;
+	dutInfo.descriptorSetLayout = _descriptorSetLayout;
+	vkCreateDescriptorUpdateTemplateKHR(_device, &dutInfo, nullptr, &_descriptorUpdateTemplate);
+
+	return true;
+}
+
+bool MoltenVKBenchmarks::initGraphicsPipeline() {
+	// MSL source is preceded by a magic number, and must include its null terminator.
+	size_t mslLen = strlen(_graphicsMSL) + 1;
+	vector<uint32_t> shaderCode(mvkCeilingDivide(sizeof(MVKMSLSPIRVHeader) + mslLen, sizeof(uint32_t)), 0);
+	shaderCode[0] = kMVKMagicNumberMSLSourceCode;
+	memcpy(&shaderCode[1], _graphicsMSL, mslLen);
+
+	VkShaderModuleCreateInfo smInfo = {};
+	smInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	smInfo.codeSize = sizeof(MVKMSLSPIRVHeader) + mslLen;
+	smInfo.pCode = shaderCode.data();
+	vkCreateShaderModule(_device, &smInfo, nullptr, &_graphicsShaderModule);
+
+	VkPipelineShaderStageCreateInfo stages[2] = {};
+	stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	stages[0].module = _graphicsShaderModule;
+	stages[0].pName = "benchmarkVertex";
+	stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	stages[1].module = _graphicsShaderModule;
+	stages[1].pName = "benchmarkFragment";
+
+	VkPipelineVertexInputStateCreateInfo viInfo = {};
+	viInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+	VkPipelineInputAssemblyStateCreateInfo iaInfo = {};
+	iaInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	iaInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	VkPipelineViewportStateCreateInfo vpInfo = {};
+	vpInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	vpInfo.viewportCount = 1;
+	vpInfo.scissorCount = 1;
+
+	VkPipelineRasterizationStateCreateInfo rsInfo = {};
+	rsInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rsInfo.polygonMode = VK_POLYGON_MODE_FILL;
+	rsInfo.cullMode = VK_CULL_MODE_NONE;
+	rsInfo.lineWidth = 1.0f;
+
+	VkPipelineMultisampleStateCreateInfo msInfo = {};
+	msInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	msInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkPipelineColorBlendAttachmentState cbAttState = {};
+	cbAttState.colorWriteMask = (VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+								 VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT);
+	VkPipelineColorBlendStateCreateInfo cbInfo = {};
+	cbInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	cbInfo.attachmentCount = 1;
+	cbInfo.pAttachments = &cbAttState;
+
+	VkDynamicState dynStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dsInfo = {};
+	dsInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dsInfo.dynamicStateCount = 2;
+	dsInfo.pDynamicStates = dynStates;
+
+	VkGraphicsPipelineCreateInfo plInfo = {};
+	plInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	plInfo.stageCount = 2;
+	plInfo.pStages = stages;
+	plInfo.pVertexInputState = &viInfo;
+	plInfo.pInputAssemblyState = &iaInfo;
+	plInfo.pViewportState = &vpInfo;
+	plInfo.pRasterizationState = &rsInfo;
+	plInfo.pMultisampleState = &msInfo;
+	plInfo.pColorBlendState = &cbInfo;
+	plInfo.pDynamicState = &dsInfo;
+	plInfo.layout = _pipelineLayout;
+	plInfo.renderPass = _renderPass;
+	if (vkCreateGraphicsPipelines(_device, VK_NULL_HANDLE, 1, &plInfo, nullptr, &_graphicsPipeline) != VK_SUCCESS) {
+		log("Could not create the graphics pipeline.");
+		return false;
+	}
+	waitForPipelineCompilation(_graphicsPipeline);
+
+	return true;
+}
+
+uint32_t MoltenVKBenchmarks::getMemoryTypeIndex(uint32_t memTypeBits, VkMemoryPropertyFlags memFlags) {
+	for (uint32_t mtIdx = 0; mtIdx < _memoryProperties.memoryTypeCount; mtIdx++) {
+		if (mvkIsAnyFlagEnabled(memTypeBits, 1U << mtIdx) &&
+			mvkAreAllFlagsEnabled(_memoryProperties.memoryTypes[mtIdx].propertyFlags, memFlags)) {
+			return mtIdx;
+		}
+	}
+	return 0;
+}
+
+void MoltenVKBenchmarks::destroyVulkan() {
+	if (_device) {
+		vkDeviceWaitIdle(_device);
+		vkDestroyDescriptorUpdateTemplateKHR(_device, _descriptorUpdateTemplate, nullptr);
+		vkDestroyDescriptorPool(_device, _descriptorPool, nullptr);
+		vkDestroyPipeline(_device, _graphicsPipeline, nullptr);
+		vkDestroyPipelineLayout(_device, _pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(_device, _descriptorSetLayout, nullptr);
+		vkDestroyShaderModule(_device, _graphicsShaderModule, nullptr);
+		vkDestroyBuffer(_device, _uniformBuffer, nullptr);
+		vkFreeMemory(_device, _uniformBufferMemory, nullptr);
+		vkDestroyFramebuffer(_device, _framebuffer, nullptr);
+		vkDestroyRenderPass(_device, _renderPass, nullptr);
+		vkDestroyImageView(_device, _colorImageView, nullptr);
+		vkDestroyImage(_device, _colorImage, nullptr);
+		vkFreeMemory(_device, _colorImageMemory, nullptr);
+		vkDestroyCommandPool(_device, _commandPool, nullptr);
+		vkDestroyDevice(_device, nullptr);
+		_device = VK_NULL_HANDLE;
+	}
+	if (_instance) {
+		vkDestroyInstance(_instance, nullptr);
+		_instance = VK_NULL_HANDLE;
+	}
+}
+
+
+#pragma mark Command line
+
+void MoltenVKBenchmarks::log(const char* logMsg) {
+	fprintf(stderr, "%s\n", logMsg);
+}
+
+void MoltenVKBenchmarks::showUsage() {
+	string line = "\n\e[1m" + _processName + "\e[0m runs headless microbenchmarks of MoltenVK command recording,";
+	log(line.c_str());
+	log("command buffer submission, descriptor updates, pipeline creation, pixel format");
+	log("lookups and texture decompression, and writes the results as a single line of JSON.");
+	log("All durations are in milliseconds.");
+	log("\nUsage:");
+	log("  -o \"outFile\"       - Appends the results to the specified file, instead of");
+	log("                       writing them to stdout.");
+	log("  -i iterations      - The number of timed iterations of each benchmark.");
+	log("                       Defaults to 20.");
+	log("  -n operations      - The number of commands or descriptor sets used in each");
+	log("                       iteration of the recording, submission and descriptor");
+	log("                       benchmarks. Defaults to 1000.");
+	log("  -f \"filter\"        - Runs only the benchmarks whose names contain the filter.");
+	log("  -h                 - Displays this message.");
+	log("");
+}
+
+bool MoltenVKBenchmarks::parseArgs(int argc, const char* argv[]) {
+	if (argc == 0) { return false; }
+
+	string execPath(argv[0]);
+	size_t sepPos = execPath.find_last_of('/');
+	_processName = (sepPos == string::npos) ? execPath : execPath.substr(sepPos + 1);
+
+	for (int argIdx = 1; argIdx < argc; argIdx++) {
+		string arg = argv[argIdx];
+		bool hasParam = argIdx + 1 < argc;
+
+		if (arg == "-o" && hasParam) {
+			_outputFilePath = argv[++argIdx];
+			continue;
+		}
+		if (arg == "-i" && hasParam) {
+			_iterationCount = max(atoi(argv[++argIdx]), 1);
+			continue;
+		}
+		if (arg == "-n" && hasParam) {
+			_operationCount = max(atoi(argv[++argIdx]), 1);
+			continue;
+		}
+		if (arg == "-f" && hasParam) {
+			_filter = argv[++argIdx];
+			continue;
+		}
+		return false;
+	}
+	return true;
+}
+
+MoltenVKBenchmarks::MoltenVKBenchmarks(int argc, const char* argv[]) {
+	_iterationCount = 20;
+	_operationCount = 1000;
+	_isActive = parseArgs(argc, argv);
+	if ( !_isActive ) { showUsage(); }
+}
+
+MoltenVKBenchmarks::~MoltenVKBenchmarks() {
+	destroyVulkan();
+}
@@ -0,0 +1,190 @@
+/*
+ * MoltenVKCallReplayer.h
+ *
+ * Copyright (c) 2015-2020 The Brenwill Workshop Ltd. (http://www.brenwill.com)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+
+#include <MoltenVK/vk_mvk_moltenvk.h>
+#include "MVKCallRecord.h"
+#include <chrono>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+
+namespace mvk {
+
+	/** The recorded and replayed durations, in milliseconds, of the calls to a single Vulkan function. */
+	typedef struct {
+		std::string name;
+		uint64_t recordedCount = 0;			/**< The number of calls made during the recorded frames. */
+		uint64_t replayedCount = 0;			/**< The number of calls made during the recorded frames that were replayed. */
+		uint64_t skippedCount = 0;			/**< The number of calls that were not replayed, including calls made before the recorded frames. */
+		double recordedDuration = 0.0;		/**< The total recorded duration of the calls made during the recorded frames. */
+		double replayedDuration = 0.0;		/**< The total replayed duration of the calls made during the recorded frames. */
+		bool isSupported = true;			/**< Whether calls to this function with recorded parameters can be replayed. */
+	} MVKCallReplayFunction;
+
+	/**
+	 * The recorded and replayed durations, in milliseconds, of a single frame. The durations of the calls
+	 * include only the calls that were replayed, whereas the frame durations include the time between calls,
+	 * which during replay is mostly spent reading the recording.
+	 */
+	typedef struct {
+		double recordedDuration = 0.0;
+		double replayedDuration = 0.0;
+		double recordedCallDuration = 0.0;
+		double replayedCallDuration = 0.0;
+	} MVKCallReplayFrame;
+
+	/** The images that stand in for the images of a swapchain during replay. */
+	typedef struct {
+		VkDevice device;
+		VkSwapchainCreateInfoKHR createInfo;
+		std::vector<VkImage> images;
+		std::vector<VkDeviceMemory> imageMemories;
+	} MVKCallReplaySwapchain;
+
+	template<size_t... I> struct MVKIndexSequence {};
+	template<size_t N, size_t... I> struct MVKMakeIndexSequence : MVKMakeIndexSequence<N - 1, N - 1, I...> {};
+	template<size_t... I> struct MVKMakeIndexSequence<0, I...> { typedef MVKIndexSequence<I...> type; };
+
+
+#pragma mark -
+#pragma mark MoltenVKCallReplayer
+
+	/**
+	 * Replays a recording of Vulkan calls, written by MoltenVK when the MVK_CONFIG_CALL_RECORD_FILE
+	 * environment variable is set, against MoltenVK, and writes the recorded and replayed durations
+	 * of the calls as a single line of JSON, so the CPU cost of the same frames can be compared
+	 * between MoltenVK releases, independently of the app that made the recording.
+	 *
+	 * The swapchain images are replaced by offscreen images, and nothing is presented. The contents
+	 * of buffers, images and pipeline caches are not recorded, so memory is left uninitialized, and
+	 * pipelines are compiled without cached data. Command buffers recorded before the recorded frames
+	 * are not submitted, and waits on fences and semaphores that were not signaled during the replay
+	 * are skipped, so the replay cannot stall on work that was not recorded.
+	 */
+	class MoltenVKCallReplayer {
+
+	public:
+
+		/**
+		 * Replays the recording, based on command line arguments.
+		 * Returns zero if all went well, or an error code if not.
+		 */
+		int run();
+
+		/** Constructor with specified command line arguments. */
+		MoltenVKCallReplayer(int argc, const char* argv[]);
+
+		~MoltenVKCallReplayer();
+
+	protected:
+		typedef void (*MVKCallReplayHandler)(MoltenVKCallReplayer* replayer);
+
+		bool parseArgs(int argc, const char* argv[]);
+		void showUsage();
+		void log(const char* logMsg);
+		bool loadRecording();
+		bool initVulkan();
+		void initReplayHandlers();
+		void replayCalls();
+		void destroyVulkan();
+		bool writeResults();
+		uint32_t getMemoryTypeIndex(uint32_t memTypeBits, VkMemoryPropertyFlags memFlags);
+		bool addSwapchainImage(MVKCallReplaySwapchain* pSwapchain);
+		void destroySwapchain(MVKCallReplaySwapchain* pSwapchain);
+		uint32_t filterWaitSemaphores(uint32_t semaphoreCount, const VkSemaphore* pSemaphores, const VkPipelineStageFlags* pWaitStages);
+		void signalOnQueue(VkSemaphore semaphore, VkFence fence);
+		void endFrame();
+
+		template<typename... Args>
+		bool readArgs(Args&... args);
+		template<typename F>
+		void timeCall(F call);
+		template<typename R, typename... P>
+		void replayCall(R (*func)(P...));
+		template<typename R, typename... P, size_t... I>
+		void replayCall(R (*func)(P...), MVKIndexSequence<I...>);
+
+		void replayCreateDevice();
+		void replayDestroyDevice();
+		void replayGetDeviceQueue();
+		void replayQueueSubmit();
+		void replayMapMemory();
+		void replayUnmapMemory();
+		void replayFlushMappedMemoryRanges();
+		void replayCreateFence();
+		void replayResetFences();
+		void replayWaitForFences();
+		void replayCreateSemaphore();
+		void replayAllocateCommandBuffers();
+		void replayFreeCommandBuffers();
+		void replayBeginCommandBuffer();
+		void replayCreateDescriptorUpdateTemplate();
+		void replayUpdateDescriptorSetWithTemplate();
+		void replayCreateSwapchain();
+		void replayDestroySwapchain();
+		void replayGetSwapchainImages();
+		void replayAcquireNextImage();
+		void replayQueuePresent();
+
+		std::string _processName;
+		std::string _recordingFilePath;
+		std::string _outputFilePath;
+		bool _isVerbose;
+		bool _isActive;
+
+		std::vector<uint8_t> _recording;
+		MVKCallRecordFileHeader _fileHeader;
+		std::vector<MVKCallReplayFunction> _functions;
+		std::vector<MVKCallReplayHandler> _handlers;
+		std::vector<std::pair<MVKCallRecordHeader, const uint8_t*>> _calls;
+		const MVKCallRecordHeader* _pCurrentCall = nullptr;
+		MVKCallRecordReader _reader;
+		double _callDuration = 0.0;
+		bool _isCallReplayed = false;
+		uint64_t _replayedCallCount = 0;
+		uint64_t _skippedCallCount = 0;
+		uint64_t _invalidCallCount = 0;
+		uint64_t _skippedCommandBufferCount = 0;
+		uint64_t _skippedWaitCount = 0;
+		std::vector<MVKCallReplayFrame> _frames;
+		MVKCallReplayFrame _currentFrame;
+		std::chrono::steady_clock::time_point _frameStartTime;
+		uint64_t _recordedFrameStartTime = 0;
+		bool _isInFrames = false;
+		bool _isFrameEnd = false;
+
+		VkInstance _instance = VK_NULL_HANDLE;
+		VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
+		VkPhysicalDeviceProperties _physicalDeviceProperties;
+		VkPhysicalDeviceMemoryProperties _memoryProperties;
+		VkDevice _device = VK_NULL_HANDLE;
+		VkQueue _queue = VK_NULL_HANDLE;
+		std::unordered_set<VkCommandBuffer> _recordedCommandBuffers;
+		std::unordered_set<VkFence> _signalingFences;
+		std::unordered_set<VkSemaphore> _signalingSemaphores;
+		std::unordered_map<VkDescriptorUpdateTemplateKHR, std::vector<VkDescriptorUpdateTemplateEntryKHR>> _descriptorUpdateTemplateEntries;
+		std::vector<MVKCallReplaySwapchain*> _swapchains;
+	};
+
+}
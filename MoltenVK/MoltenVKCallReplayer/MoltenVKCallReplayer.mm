@@ -0,0 +1,977 @@
+/*
+ * MoltenVKCallReplayer.mm
+ *
+ * Copyright (c) 2015-2020 The Brenwill Workshop Ltd. (http://www.brenwill.com)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MoltenVKCallReplayer.h"
+#include "MVKFoundation.h"
+#include <Foundation/Foundation.h>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+using namespace mvk;
+using namespace std;
+
+
+#pragma mark -
+#pragma mark MoltenVKCallReplayer
+
+int MoltenVKCallReplayer::run() {
+	if ( !_isActive ) { return EXIT_FAILURE; }
+
+	bool success = loadRecording() && initVulkan();
+	if (success) {
+		initReplayHandlers();
+		replayCalls();
+		success = writeResults();
+	}
+	destroyVulkan();
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Reads the whole recording into memory, and indexes the recorded calls.
+bool MoltenVKCallReplayer::loadRecording() {
+	FILE* pFile = fopen(_recordingFilePath.c_str(), "rb");
+	if ( !pFile ) {
+		string errMsg = "Could not open recording file " + _recordingFilePath;
+		log(errMsg.c_str());
+		return false;
+	}
+	fseek(pFile, 0, SEEK_END);
+	long fileSize = ftell(pFile);
+	fseek(pFile, 0, SEEK_SET);
+	_recording.resize(fileSize > 0 ? fileSize : 0);
+	size_t readSize = fread(_recording.data(), 1, _recording.size(), pFile);
+	fclose(pFile);
+
+	string errMsg = _recordingFilePath + " is not a valid Vulkan call recording.";
+	if (readSize != _recording.size() || readSize < sizeof(_fileHeader)) {
+		log(errMsg.c_str());
+		return false;
+	}
+	memcpy(&_fileHeader, _recording.data(), sizeof(_fileHeader));
+	if (memcmp(_fileHeader.signature, kMVKCallRecordSignature, sizeof(_fileHeader.signature)) != 0) {
+		log(errMsg.c_str());
+		return false;
+	}
+	if (_fileHeader.formatVersion != kMVKCallRecordFormatVersion) {
+		errMsg = _recordingFilePath + " was recorded in format version " + to_string(_fileHeader.formatVersion) +
+				 ", but this tool replays format version " + to_string(kMVKCallRecordFormatVersion) + ".";
+		log(errMsg.c_str());
+		return false;
+	}
+
+	const uint8_t* pData = _recording.data();
+	size_t size = _recording.size();
+	size_t offset = sizeof(_fileHeader);
+
+	_functions.resize(_fileHeader.funcCount);
+	for (auto& func : _functions) {
+		const void* pNameEnd = memchr(pData + offset, 0, size - offset);
+		if ( !pNameEnd ) {
+			log(errMsg.c_str());
+			return false;
+		}
+		func.name = (const char*)(pData + offset);
+		offset = (const uint8_t*)pNameEnd - pData + 1;
+	}
+
+	// The call headers are copied out, because the variable length names and parameters leave them unaligned.
+	_calls.reserve(_fileHeader.callCount);
+	while (offset < size) {
+		MVKCallRecordHeader callHdr;
+		if (size - offset < sizeof(callHdr)) {
+			log(errMsg.c_str());
+			return false;
+		}
+		memcpy(&callHdr, pData + offset, sizeof(callHdr));
+		offset += sizeof(callHdr);
+		if (callHdr.funcIndex >= _functions.size() || callHdr.paramSize > size - offset) {
+			log(errMsg.c_str());
+			return false;
+		}
+		_calls.push_back(make_pair(callHdr, pData + offset));
+		offset += callHdr.paramSize;
+	}
+
+	if (_fileHeader.droppedCount) {
+		string msg = "The recording was full, and " + to_string(_fileHeader.droppedCount) + " calls were not recorded.";
+		log(msg.c_str());
+	}
+	return true;
+}
+
+
+#pragma mark Replay
+
+// Replays each call in the order in which the calls completed, regardless of the thread that made them.
+void MoltenVKCallReplayer::replayCalls() {
+	for (auto& call : _calls) {
+		const MVKCallRecordHeader& callHdr = call.first;
+		auto& func = _functions[callHdr.funcIndex];
+		bool isFrameCall = (callHdr.frameIndex != kMVKCallRecordSetupFrame);
+		if (isFrameCall && !_isInFrames) {
+			_isInFrames = true;
+			_frameStartTime = chrono::steady_clock::now();
+			_recordedFrameStartTime = callHdr.startTime;
+		}
+		if (isFrameCall) {
+			func.recordedCount++;
+			func.recordedDuration += callHdr.duration / 1e6;
+		}
+
+		// Calls whose parameters were not recorded, and functions this tool cannot replay, are skipped.
+		MVKCallReplayHandler handler = _handlers[callHdr.funcIndex];
+		_isCallReplayed = false;
+		if (callHdr.paramSize && handler) {
+			_pCurrentCall = &callHdr;
+			_reader.reset(call.second, callHdr.paramSize);
+			handler(this);
+		} else if (callHdr.paramSize && func.isSupported) {
+			func.isSupported = false;
+			string msg = "Calls to " + func.name + " cannot be replayed.";
+			log(msg.c_str());
+		}
+
+		if (_isCallReplayed) {
+			_replayedCallCount++;
+			if (isFrameCall) {
+				func.replayedCount++;
+				func.replayedDuration += _callDuration;
+				_currentFrame.recordedCallDuration += callHdr.duration / 1e6;
+				_currentFrame.replayedCallDuration += _callDuration;
+			}
+		} else {
+			_skippedCallCount++;
+			func.skippedCount++;
+		}
+
+		if (_isFrameEnd) {
+			_isFrameEnd = false;
+			if (isFrameCall) { endFrame(); }
+		}
+	}
+}
+
+// Called after the call that presents the frame has been replayed.
+void MoltenVKCallReplayer::endFrame() {
+	auto now = chrono::steady_clock::now();
+	uint64_t recordedEndTime = _pCurrentCall->startTime + _pCurrentCall->duration;
+	_currentFrame.replayedDuration = chrono::duration<double, milli>(now - _frameStartTime).count();
+	_currentFrame.recordedDuration = (recordedEndTime - _recordedFrameStartTime) / 1e6;
+	_frames.push_back(_currentFrame);
+
+	_currentFrame = MVKCallReplayFrame();
+	_frameStartTime = now;
+	_recordedFrameStartTime = recordedEndTime;
+}
+
+template<typename... Args>
+bool MoltenVKCallReplayer::readArgs(Args&... args) {
+	mvkSerializeArgs(_reader, args...);
+	if (_reader.isValid()) { return true; }
+
+	_invalidCallCount++;
+	if (_isVerbose) {
+		string msg = "The parameters of call " + to_string(_pCurrentCall->sequence) + " to " +
+					 _functions[_pCurrentCall->funcIndex].name + " are not valid.";
+		log(msg.c_str());
+	}
+	return false;
+}
+
+template<typename F>
+void MoltenVKCallReplayer::timeCall(F call) {
+	auto startTime = chrono::steady_clock::now();
+	call();
+	_callDuration = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+	_isCallReplayed = true;
+}
+
+// Deserializes the parameters of the call, based on the parameter types of the function, and calls the function.
+template<typename R, typename... P>
+void MoltenVKCallReplayer::replayCall(R (*func)(P...)) {
+	replayCall(func, typename MVKMakeIndexSequence<sizeof...(P)>::type());
+}
+
+template<typename R, typename... P, size_t... I>
+void MoltenVKCallReplayer::replayCall(R (*func)(P...), MVKIndexSequence<I...>) {
+	tuple<typename decay<P>::type...> args;
+	if ( !readArgs(get<I>(args)...) ) { return; }
+
+	timeCall([&]() { func(get<I>(args)...); });
+	_reader.mapOutputHandles();
+}
+
+#define MVK_REPLAY_CALL(func)			{ #func, [](MoltenVKCallReplayer* pReplayer) { pReplayer->replayCall(func); } }
+#define MVK_REPLAY_HANDLER(func, hndlr)	{ #func, [](MoltenVKCallReplayer* pReplayer) { pReplayer->hndlr(); } }
+
+void MoltenVKCallReplayer::initReplayHandlers() {
+	unordered_map<string, MVKCallReplayHandler> handlers = {
+		MVK_REPLAY_HANDLER(vkCreateDevice, replayCreateDevice),
+		MVK_REPLAY_HANDLER(vkDestroyDevice, replayDestroyDevice),
+		MVK_REPLAY_HANDLER(vkGetDeviceQueue, replayGetDeviceQueue),
+		MVK_REPLAY_HANDLER(vkQueueSubmit, replayQueueSubmit),
+		MVK_REPLAY_CALL(vkQueueWaitIdle),
+		MVK_REPLAY_CALL(vkDeviceWaitIdle),
+		MVK_REPLAY_CALL(vkAllocateMemory),
+		MVK_REPLAY_CALL(vkFreeMemory),
+		MVK_REPLAY_HANDLER(vkMapMemory, replayMapMemory),
+		MVK_REPLAY_HANDLER(vkUnmapMemory, replayUnmapMemory),
+		MVK_REPLAY_HANDLER(vkFlushMappedMemoryRanges, replayFlushMappedMemoryRanges),
+		MVK_REPLAY_CALL(vkBindBufferMemory),
+		MVK_REPLAY_CALL(vkBindImageMemory),
+		MVK_REPLAY_HANDLER(vkCreateFence, replayCreateFence),
+		MVK_REPLAY_CALL(vkDestroyFence),
+		MVK_REPLAY_HANDLER(vkResetFences, replayResetFences),
+		MVK_REPLAY_HANDLER(vkWaitForFences, replayWaitForFences),
+		MVK_REPLAY_HANDLER(vkCreateSemaphore, replayCreateSemaphore),
+		MVK_REPLAY_CALL(vkDestroySemaphore),
+		MVK_REPLAY_CALL(vkCreateQueryPool),
+		MVK_REPLAY_CALL(vkDestroyQueryPool),
+		MVK_REPLAY_CALL(vkCreateBuffer),
+		MVK_REPLAY_CALL(vkDestroyBuffer),
+		MVK_REPLAY_CALL(vkCreateBufferView),
+		MVK_REPLAY_CALL(vkDestroyBufferView),
+		MVK_REPLAY_CALL(vkCreateImage),
+		MVK_REPLAY_CALL(vkDestroyImage),
+		MVK_REPLAY_CALL(vkCreateImageView),
+		MVK_REPLAY_CALL(vkDestroyImageView),
+		MVK_REPLAY_CALL(vkCreateShaderModule),
+		MVK_REPLAY_CALL(vkDestroyShaderModule),
+		MVK_REPLAY_CALL(vkCreatePipelineCache),
+		MVK_REPLAY_CALL(vkDestroyPipelineCache),
+		MVK_REPLAY_CALL(vkCreateGraphicsPipelines),
+		MVK_REPLAY_CALL(vkCreateComputePipelines),
+		MVK_REPLAY_CALL(vkDestroyPipeline),
+		MVK_REPLAY_CALL(vkCreatePipelineLayout),
+		MVK_REPLAY_CALL(vkDestroyPipelineLayout),
+		MVK_REPLAY_CALL(vkCreateSampler),
+		MVK_REPLAY_CALL(vkDestroySampler),
+		MVK_REPLAY_CALL(vkCreateDescriptorSetLayout),
+		MVK_REPLAY_CALL(vkDestroyDescriptorSetLayout),
+		MVK_REPLAY_CALL(vkCreateDescriptorPool),
+		MVK_REPLAY_CALL(vkDestroyDescriptorPool),
+		MVK_REPLAY_CALL(vkResetDescriptorPool),
+		MVK_REPLAY_CALL(vkAllocateDescriptorSets),
+		MVK_REPLAY_CALL(vkFreeDescriptorSets),
+		MVK_REPLAY_CALL(vkUpdateDescriptorSets),
+		MVK_REPLAY_CALL(vkCreateFramebuffer),
+		MVK_REPLAY_CALL(vkDestroyFramebuffer),
+		MVK_REPLAY_CALL(vkCreateRenderPass),
+		MVK_REPLAY_CALL(vkDestroyRenderPass),
+		MVK_REPLAY_CALL(vkCreateCommandPool),
+		MVK_REPLAY_CALL(vkDestroyCommandPool),
+		MVK_REPLAY_CALL(vkResetCommandPool),
+		MVK_REPLAY_HANDLER(vkAllocateCommandBuffers, replayAllocateCommandBuffers),
+		MVK_REPLAY_HANDLER(vkFreeCommandBuffers, replayFreeCommandBuffers),
+		MVK_REPLAY_HANDLER(vkBeginCommandBuffer, replayBeginCommandBuffer),
+		MVK_REPLAY_CALL(vkEndCommandBuffer),
+		MVK_REPLAY_CALL(vkResetCommandBuffer),
+		MVK_REPLAY_CALL(vkCmdBindPipeline),
+		MVK_REPLAY_CALL(vkCmdSetViewport),
+		MVK_REPLAY_CALL(vkCmdSetScissor),
+		MVK_REPLAY_CALL(vkCmdSetLineWidth),
+		MVK_REPLAY_CALL(vkCmdSetDepthBias),
+		MVK_REPLAY_CALL(vkCmdSetBlendConstants),
+		MVK_REPLAY_CALL(vkCmdSetDepthBounds),
+		MVK_REPLAY_CALL(vkCmdSetStencilCompareMask),
+		MVK_REPLAY_CALL(vkCmdSetStencilWriteMask),
+		MVK_REPLAY_CALL(vkCmdSetStencilReference),
+		MVK_REPLAY_CALL(vkCmdBindDescriptorSets),
+		MVK_REPLAY_CALL(vkCmdBindIndexBuffer),
+		MVK_REPLAY_CALL(vkCmdBindVertexBuffers),
+		MVK_REPLAY_CALL(vkCmdDraw),
+		MVK_REPLAY_CALL(vkCmdDrawIndexed),
+		MVK_REPLAY_CALL(vkCmdDrawIndirect),
+		MVK_REPLAY_CALL(vkCmdDrawIndexedIndirect),
+		MVK_REPLAY_CALL(vkCmdDispatch),
+		MVK_REPLAY_CALL(vkCmdDispatchIndirect),
+		MVK_REPLAY_CALL(vkCmdCopyBuffer),
+		MVK_REPLAY_CALL(vkCmdCopyImage),
+		MVK_REPLAY_CALL(vkCmdBlitImage),
+		MVK_REPLAY_CALL(vkCmdCopyBufferToImage),
+		MVK_REPLAY_CALL(vkCmdCopyImageToBuffer),
+		MVK_REPLAY_CALL(vkCmdUpdateBuffer),
+		MVK_REPLAY_CALL(vkCmdFillBuffer),
+		MVK_REPLAY_CALL(vkCmdClearColorImage),
+		MVK_REPLAY_CALL(vkCmdClearDepthStencilImage),
+		MVK_REPLAY_CALL(vkCmdClearAttachments),
+		MVK_REPLAY_CALL(vkCmdResolveImage),
+		MVK_REPLAY_CALL(vkCmdPipelineBarrier),
+		MVK_REPLAY_CALL(vkCmdBeginQuery),
+		MVK_REPLAY_CALL(vkCmdEndQuery),
+		MVK_REPLAY_CALL(vkCmdResetQueryPool),
+		MVK_REPLAY_CALL(vkCmdWriteTimestamp),
+		MVK_REPLAY_CALL(vkCmdPushConstants),
+		MVK_REPLAY_CALL(vkCmdBeginRenderPass),
+		MVK_REPLAY_CALL(vkCmdNextSubpass),
+		MVK_REPLAY_CALL(vkCmdEndRenderPass),
+		MVK_REPLAY_CALL(vkCmdExecuteCommands),
+		MVK_REPLAY_HANDLER(vkCreateDescriptorUpdateTemplateKHR, replayCreateDescriptorUpdateTemplate),
+		MVK_REPLAY_CALL(vkDestroyDescriptorUpdateTemplateKHR),
+		MVK_REPLAY_HANDLER(vkUpdateDescriptorSetWithTemplateKHR, replayUpdateDescriptorSetWithTemplate),
+		MVK_REPLAY_HANDLER(vkCreateSwapchainKHR, replayCreateSwapchain),
+		MVK_REPLAY_HANDLER(vkDestroySwapchainKHR, replayDestroySwapchain),
+		MVK_REPLAY_HANDLER(vkGetSwapchainImagesKHR, replayGetSwapchainImages),
+		MVK_REPLAY_HANDLER(vkAcquireNextImageKHR, replayAcquireNextImage),
+		MVK_REPLAY_HANDLER(vkQueuePresentKHR, replayQueuePresent),
+	};
+
+	_handlers.assign(_functions.size(), nullptr);
+	for (size_t funcIdx = 0; funcIdx < _functions.size(); funcIdx++) {
+		auto iter = handlers.find(_functions[funcIdx].name);
+		if (iter != handlers.end()) { _handlers[funcIdx] = iter->second; }
+	}
+}
+
+
+#pragma mark Devices and queues
+
+// The recorded physical device was enumerated before the recording started,
+// so the device is created on the physical device chosen by this tool.
+void MoltenVKCallReplayer::replayCreateDevice() {
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	const VkDeviceCreateInfo* pCreateInfo = nullptr;
+	const VkAllocationCallbacks* pAllocator = nullptr;
+	VkDevice* pDevice = nullptr;
+	if ( !readArgs(physicalDevice, pCreateInfo, pAllocator, pDevice) || !pCreateInfo || !pDevice ) { return; }
+
+	VkResult rslt = VK_SUCCESS;
+	timeCall([&]() { rslt = vkCreateDevice(_physicalDevice, pCreateInfo, pAllocator, pDevice); });
+	if (rslt != VK_SUCCESS) {
+		log("Could not create the recorded VkDevice.");
+		return;
+	}
+	_reader.mapOutputHandles();
+	if ( !_device ) { _device = *pDevice; }
+}
+
+void MoltenVKCallReplayer::replayDestroyDevice() {
+	VkDevice device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks* pAllocator = nullptr;
+	if ( !readArgs(device, pAllocator) || !device ) { return; }
+
+	auto swapchains = _swapchains;
+	for (auto* pSwapchain : swapchains) {
+		if (pSwapchain->device == device) { destroySwapchain(pSwapchain); }
+	}
+
+	timeCall([&]() { vkDestroyDevice(device, pAllocator); });
+	if (device == _device) {
+		_device = VK_NULL_HANDLE;
+		_queue = VK_NULL_HANDLE;
+	}
+}
+
+// Acquiring and presenting swapchain images is simulated on the first queue retrieved.
+void MoltenVKCallReplayer::replayGetDeviceQueue() {
+	VkDevice device = VK_NULL_HANDLE;
+	uint32_t queueFamilyIndex = 0;
+	uint32_t queueIndex = 0;
+	VkQueue* pQueue = nullptr;
+	if ( !readArgs(device, queueFamilyIndex, queueIndex, pQueue) || !device || !pQueue ) { return; }
+
+	timeCall([&]() { vkGetDeviceQueue(device, queueFamilyIndex, queueIndex, pQueue); });
+	_reader.mapOutputHandles();
+	if ( !_queue ) { _queue = *pQueue; }
+}
+
+// Command buffers that were not recorded during the recorded frames are not submitted, and semaphores that
+// have not been signaled during the replay are not waited on, so that the GPU does not wait indefinitely.
+void MoltenVKCallReplayer::replayQueueSubmit() {
+	VkQueue queue = VK_NULL_HANDLE;
+	uint32_t submitCount = 0;
+	const VkSubmitInfo* pSubmits = nullptr;
+	VkFence fence = VK_NULL_HANDLE;
+	if ( !readArgs(queue, submitCount, pSubmits, fence) || !queue ) { return; }
+
+	uint32_t sbmtCnt = pSubmits ? submitCount : 0;
+	for (uint32_t sbmtIdx = 0; sbmtIdx < sbmtCnt; sbmtIdx++) {
+		auto& submit = const_cast<VkSubmitInfo&>(pSubmits[sbmtIdx]);
+		submit.waitSemaphoreCount = filterWaitSemaphores(submit.waitSemaphoreCount, submit.pWaitSemaphores, submit.pWaitDstStageMask);
+
+		auto* pCmdBuffs = const_cast<VkCommandBuffer*>(submit.pCommandBuffers);
+		uint32_t cbCnt = 0;
+		for (uint32_t cbIdx = 0; pCmdBuffs && cbIdx < submit.commandBufferCount; cbIdx++) {
+			if (_recordedCommandBuffers.count(pCmdBuffs[cbIdx])) {
+				pCmdBuffs[cbCnt++] = pCmdBuffs[cbIdx];
+			} else {
+				_skippedCommandBufferCount++;
+			}
+		}
+		submit.commandBufferCount = cbCnt;
+
+		for (uint32_t semIdx = 0; submit.pSignalSemaphores && semIdx < submit.signalSemaphoreCount; semIdx++) {
+			_signalingSemaphores.insert(submit.pSignalSemaphores[semIdx]);
+		}
+	}
+	if (fence) { _signalingFences.insert(fence); }
+
+	timeCall([&]() { vkQueueSubmit(queue, sbmtCnt, pSubmits, fence); });
+}
+
+// Removes the semaphores that have not been signaled from the specified arrays, and returns the number remaining.
+uint32_t MoltenVKCallReplayer::filterWaitSemaphores(uint32_t semaphoreCount, const VkSemaphore* pSemaphores, const VkPipelineStageFlags* pWaitStages) {
+	if ( !pSemaphores ) { return 0; }
+
+	auto* pSems = const_cast<VkSemaphore*>(pSemaphores);
+	auto* pStages = const_cast<VkPipelineStageFlags*>(pWaitStages);
+	uint32_t semCnt = 0;
+	for (uint32_t semIdx = 0; semIdx < semaphoreCount; semIdx++) {
+		if (_signalingSemaphores.erase(pSems[semIdx])) {
+			if (pStages) { pStages[semCnt] = pStages[semIdx]; }
+			pSems[semCnt++] = pSems[semIdx];
+		} else {
+			_skippedWaitCount++;
+		}
+	}
+	return semCnt;
+}
+
+
+#pragma mark Memory
+
+// The memory contents are not recorded, so the mapped memory is not populated.
+void MoltenVKCallReplayer::replayMapMemory() {
+	VkDevice device = VK_NULL_HANDLE;
+	VkDeviceMemory mem = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	VkMemoryMapFlags flags = 0;
+	if ( !readArgs(device, mem, offset, size, flags) || !mem ) { return; }
+
+	void* pData = nullptr;
+	timeCall([&]() { vkMapMemory(device, mem, offset, size, flags, &pData); });
+}
+
+void MoltenVKCallReplayer::replayUnmapMemory() {
+	VkDevice device = VK_NULL_HANDLE;
+	VkDeviceMemory mem = VK_NULL_HANDLE;
+	uint64_t contentHash = 0;
+	if ( !readArgs(device, mem, contentHash) || !mem ) { return; }
+
+	timeCall([&]() { vkUnmapMemory(device, mem); });
+}
+
+void MoltenVKCallReplayer::replayFlushMappedMemoryRanges() {
+	VkDevice device = VK_NULL_HANDLE;
+	uint32_t memRangeCount = 0;
+	const VkMappedMemoryRange* pMemRanges = nullptr;
+	uint64_t contentHash = 0;
+	if ( !readArgs(device, memRangeCount, pMemRanges, contentHash) || !pMemRanges ) { return; }
+
+	timeCall([&]() { vkFlushMappedMemoryRanges(device, memRangeCount, pMemRanges); });
+}
+
+
+#pragma mark Synchronization
+
+// Newly created fences and semaphores may reuse the handles of destroyed ones, so their signaled state is reset.
+void MoltenVKCallReplayer::replayCreateFence() {
+	VkDevice device = VK_NULL_HANDLE;
+	const VkFenceCreateInfo* pCreateInfo = nullptr;
+	const VkAllocationCallbacks* pAllocator = nullptr;
+	VkFence* pFence = nullptr;
+	if ( !readArgs(device, pCreateInfo, pAllocator, pFence) || !pCreateInfo || !pFence ) { return; }
+
+	timeCall([&]() { vkCreateFence(device, pCreateInfo, pAllocator, pFence); });
+	_reader.mapOutputHandles();
+	if (mvkIsAnyFlagEnabled(pCreateInfo->flags, VK_FENCE_CREATE_SIGNALED_BIT)) {
+		_signalingFences.insert(*pFence);
+	} else {
+		_signalingFences.erase(*pFence);
+	}
+}
+
+void MoltenVKCallReplayer::replayResetFences() {
+	VkDevice device = VK_NULL_HANDLE;
+	uint32_t fenceCount = 0;
+	const VkFence* pFences = nullptr;
+	if ( !readArgs(device, fenceCount, pFences) || !pFences ) { return; }
+
+	for (uint32_t fenceIdx = 0; fenceIdx < fenceCount; fenceIdx++) { _signalingFences.erase(pFences[fenceIdx]); }
+	timeCall([&]() { vkResetFences(device, fenceCount, pFences); });
+}
+
+// Fences that were submitted before the recorded frames will never be signaled during the replay, so they are not waited on.
+void MoltenVKCallReplayer::replayWaitForFences() {
+	VkDevice device = VK_NULL_HANDLE;
+	uint32_t fenceCount = 0;
+	const VkFence* pFences = nullptr;
+	VkBool32 waitAll = VK_FALSE;
+	uint64_t timeout = 0;
+	if ( !readArgs(device, fenceCount, pFences, waitAll, timeout) || !pFences ) { return; }
+
+	auto* pWaitFences = const_cast<VkFence*>(pFences);
+	uint32_t waitCnt = 0;
+	for (uint32_t fenceIdx = 0; fenceIdx < fenceCount; fenceIdx++) {
+		if (_signalingFences.count(pFences[fenceIdx])) {
+			pWaitFences[waitCnt++] = pFences[fenceIdx];
+		} else {
+			_skippedWaitCount++;
+		}
+	}
+	if ( !waitCnt ) { return; }
+
+	timeCall([&]() { vkWaitForFences(device, waitCnt, pWaitFences, waitAll, timeout); });
+}
+
+void MoltenVKCallReplayer::replayCreateSemaphore() {
+	VkDevice device = VK_NULL_HANDLE;
+	const VkSemaphoreCreateInfo* pCreateInfo = nullptr;
+	const VkAllocationCallbacks* pAllocator = nullptr;
+	VkSemaphore* pSemaphore = nullptr;
+	if ( !readArgs(device, pCreateInfo, pAllocator, pSemaphore) || !pCreateInfo || !pSemaphore ) { return; }
+
+	timeCall([&]() { vkCreateSemaphore(device, pCreateInfo, pAllocator, pSemaphore); });
+	_reader.mapOutputHandles();
+	_signalingSemaphores.erase(*pSemaphore);
+}
+
+// Signals the semaphore and fence, as the presentation engine does when a swapchain image is acquired.
+void MoltenVKCallReplayer::signalOnQueue(VkSemaphore semaphore, VkFence fence) {
+	if ( !_queue || !(semaphore || fence) ) { return; }
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.signalSemaphoreCount = semaphore ? 1 : 0;
+	submitInfo.pSignalSemaphores = &semaphore;
+	vkQueueSubmit(_queue, 1, &submitInfo, fence);
+
+	if (semaphore) { _signalingSemaphores.insert(semaphore); }
+	if (fence) { _signalingFences.insert(fence); }
+}
+
+
+#pragma mark Command buffers
+
+void MoltenVKCallReplayer::replayAllocateCommandBuffers() {
+	VkDevice device = VK_NULL_HANDLE;
+	const VkCommandBufferAllocateInfo* pAllocateInfo = nullptr;
+	VkCommandBuffer* pCommandBuffers = nullptr;
+	if ( !readArgs(device, pAllocateInfo, pCommandBuffers) || !pAllocateInfo || !pCommandBuffers ) { return; }
+
+	VkResult rslt = VK_SUCCESS;
+	timeCall([&]() { rslt = vkAllocateCommandBuffers(device, pAllocateInfo, pCommandBuffers); });
+	if (rslt != VK_SUCCESS) { return; }
+
+	_reader.mapOutputHandles();
+	for (uint32_t cbIdx = 0; cbIdx < pAllocateInfo->commandBufferCount; cbIdx++) {
+		_recordedCommandBuffers.erase(pCommandBuffers[cbIdx]);
+	}
+}
+
+void MoltenVKCallReplayer::replayFreeCommandBuffers() {
+	VkDevice device = VK_NULL_HANDLE;
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	uint32_t commandBufferCount = 0;
+	const VkCommandBuffer* pCommandBuffers = nullptr;
+	if ( !readArgs(device, commandPool, commandBufferCount, pCommandBuffers) || !pCommandBuffers ) { return; }
+
+	for (uint32_t cbIdx = 0; cbIdx < commandBufferCount; cbIdx++) { _recordedCommandBuffers.erase(pCommandBuffers[cbIdx]); }
+	timeCall([&]() { vkFreeCommandBuffers(device, commandPool, commandBufferCount, pCommandBuffers); });
+}
+
+// Only the flags and the inheritance info of the begin info are recorded.
+void MoltenVKCallReplayer::replayBeginCommandBuffer() {
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	VkCommandBufferUsageFlags flags = 0;
+	const VkCommandBufferInheritanceInfo* pInheritanceInfo = nullptr;
+	if ( !readArgs(commandBuffer, flags, pInheritanceInfo) || !commandBuffer ) { return; }
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = flags;
+	beginInfo.pInheritanceInfo = pInheritanceInfo;
+	timeCall([&]() { vkBeginCommandBuffer(commandBuffer, &beginInfo); });
+	_recordedCommandBuffers.insert(commandBuffer);
+}
+
+
+#pragma mark Descriptor update templates
+
+// The template entries are retained, because they describe the layout of the data recorded by each update.
+void MoltenVKCallReplayer::replayCreateDescriptorUpdateTemplate() {
+	VkDevice device = VK_NULL_HANDLE;
+	const VkDescriptorUpdateTemplateCreateInfoKHR* pCreateInfo = nullptr;
+	const VkAllocationCallbacks* pAllocator = nullptr;
+	VkDescriptorUpdateTemplateKHR* pDescriptorUpdateTemplate = nullptr;
+	if ( !readArgs(device, pCreateInfo, pAllocator, pDescriptorUpdateTemplate) || !pCreateInfo || !pDescriptorUpdateTemplate ) { return; }
+
+	VkResult rslt = VK_SUCCESS;
+	timeCall([&]() { rslt = vkCreateDescriptorUpdateTemplateKHR(device, pCreateInfo, pAllocator, pDescriptorUpdateTemplate); });
+	if (rslt != VK_SUCCESS) { return; }
+
+	_reader.mapOutputHandles();
+	auto& entries = _descriptorUpdateTemplateEntries[*pDescriptorUpdateTemplate];
+	entries.clear();
+	if (pCreateInfo->pDescriptorUpdateEntries) {
+		entries.assign(pCreateInfo->pDescriptorUpdateEntries,
+					   pCreateInfo->pDescriptorUpdateEntries + pCreateInfo->descriptorUpdateEntryCount);
+	}
+}
+
+// The data of each template entry is recorded in entry order, and is laid out here as the template entry describes.
+void MoltenVKCallReplayer::replayUpdateDescriptorSetWithTemplate() {
+	VkDevice device = VK_NULL_HANDLE;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	VkDescriptorUpdateTemplateKHR descriptorUpdateTemplate = VK_NULL_HANDLE;
+	if ( !readArgs(device, descriptorSet, descriptorUpdateTemplate) ) { return; }
+
+	auto iter = _descriptorUpdateTemplateEntries.find(descriptorUpdateTemplate);
+	if (iter == _descriptorUpdateTemplateEntries.end()) { return; }
+	auto& entries = iter->second;
+
+	size_t dataSize = 0;
+	for (auto& entry : entries) {
+		size_t elemSize = 0;
+		if (entry.descriptorType == VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT) {
+			dataSize = max(dataSize, entry.offset + entry.descriptorCount);
+			continue;
+		}
+		if (mvkIsImageDescriptorType(entry.descriptorType)) { elemSize = sizeof(VkDescriptorImageInfo); }
+		if (mvkIsBufferDescriptorType(entry.descriptorType)) { elemSize = sizeof(VkDescriptorBufferInfo); }
+		if (mvkIsTexelBufferDescriptorType(entry.descriptorType)) { elemSize = sizeof(VkBufferView); }
+		if (entry.descriptorCount && elemSize) {
+			dataSize = max(dataSize, entry.offset + entry.stride * (entry.descriptorCount - 1) + elemSize);
+		}
+	}
+
+	vector<uint8_t> data(dataSize);
+	for (auto& entry : entries) {
+		uint8_t* pEntData = data.data() + entry.offset;
+		uint32_t elemCnt = 0;
+		_reader.value(elemCnt);
+		if (elemCnt > entry.descriptorCount) {
+			_invalidCallCount++;
+			return;
+		}
+
+		if (entry.descriptorType == VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT) {
+			_reader.bytes(pEntData, elemCnt);
+			continue;
+		}
+		for (uint32_t elemIdx = 0; elemIdx < elemCnt; elemIdx++) {
+			void* pElem = pEntData + entry.stride * elemIdx;
+			if (mvkIsImageDescriptorType(entry.descriptorType)) {
+				mvkSerializeElement(_reader, *(VkDescriptorImageInfo*)pElem);
+			} else if (mvkIsBufferDescriptorType(entry.descriptorType)) {
+				mvkSerializeElement(_reader, *(VkDescriptorBufferInfo*)pElem);
+			} else {
+				mvkSerializeElement(_reader, *(VkBufferView*)pElem);
+			}
+		}
+	}
+	if ( !_reader.isValid() || !_reader.isAtEnd() ) {
+		_invalidCallCount++;
+		return;
+	}
+
+	timeCall([&]() { vkUpdateDescriptorSetWithTemplateKHR(device, descriptorSet, descriptorUpdateTemplate, data.data()); });
+}
+
+
+#pragma mark Swapchains
+
+// Swapchains are simulated with offscreen images, and the handle of each swapchain is its MVKCallReplaySwapchain.
+// Because these calls do not replay the MoltenVK swapchain, they are not timed, and are reported as skipped.
+void MoltenVKCallReplayer::replayCreateSwapchain() {
+	VkDevice device = VK_NULL_HANDLE;
+	const VkSwapchainCreateInfoKHR* pCreateInfo = nullptr;
+	const VkAllocationCallbacks* pAllocator = nullptr;
+	VkSwapchainKHR* pSwapchain = nullptr;
+	if ( !readArgs(device, pCreateInfo, pAllocator, pSwapchain) || !device || !pCreateInfo || !pSwapchain ) { return; }
+
+	auto* pReplaySwapchain = new MVKCallReplaySwapchain();
+	pReplaySwapchain->device = device;
+	pReplaySwapchain->createInfo = *pCreateInfo;
+	pReplaySwapchain->createInfo.pQueueFamilyIndices = nullptr;
+	_swapchains.push_back(pReplaySwapchain);
+
+	*pSwapchain = (VkSwapchainKHR)(uintptr_t)pReplaySwapchain;
+	_reader.mapOutputHandles();
+}
+
+void MoltenVKCallReplayer::replayDestroySwapchain() {
+	VkDevice device = VK_NULL_HANDLE;
+	VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+	const VkAllocationCallbacks* pAllocator = nullptr;
+	if ( !readArgs(device, swapchain, pAllocator) || !swapchain ) { return; }
+
+	destroySwapchain((MVKCallReplaySwapchain*)(uintptr_t)swapchain);
+}
+
+void MoltenVKCallReplayer::replayGetSwapchainImages() {
+	VkDevice device = VK_NULL_HANDLE;
+	VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+	uint32_t* pCount = nullptr;
+	VkImage* pSwapchainImages = nullptr;
+	if ( !readArgs(device, swapchain, pCount, pSwapchainImages) || !swapchain || !pCount || !pSwapchainImages ) { return; }
+
+	auto* pReplaySwapchain = (MVKCallReplaySwapchain*)(uintptr_t)swapchain;
+	for (uint32_t imgIdx = 0; imgIdx < *pCount; imgIdx++) {
+		if (imgIdx >= pReplaySwapchain->images.size() && !addSwapchainImage(pReplaySwapchain)) { break; }
+		pSwapchainImages[imgIdx] = pReplaySwapchain->images[imgIdx];
+	}
+	_reader.mapOutputHandles();
+}
+
+void MoltenVKCallReplayer::replayAcquireNextImage() {
+	VkDevice device = VK_NULL_HANDLE;
+	VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+	uint64_t timeout = 0;
+	VkSemaphore semaphore = VK_NULL_HANDLE;
+	VkFence fence = VK_NULL_HANDLE;
+	uint32_t* pImageIndex = nullptr;
+	if ( !readArgs(device, swapchain, timeout, semaphore, fence, pImageIndex) ) { return; }
+
+	signalOnQueue(semaphore, fence);
+}
+
+// Nothing is presented, but the presentation waits on the semaphores, so the queue waits on them, as it would when presenting.
+void MoltenVKCallReplayer::replayQueuePresent() {
+	_isFrameEnd = true;
+
+	VkQueue queue = VK_NULL_HANDLE;
+	const VkPresentInfoKHR* pPresentInfo = nullptr;
+	if ( !readArgs(queue, pPresentInfo) || !queue || !pPresentInfo ) { return; }
+
+	uint32_t waitCnt = filterWaitSemaphores(pPresentInfo->waitSemaphoreCount, pPresentInfo->pWaitSemaphores, nullptr);
+	if ( !waitCnt ) { return; }
+
+	vector<VkPipelineStageFlags> waitStages(waitCnt, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.waitSemaphoreCount = waitCnt;
+	submitInfo.pWaitSemaphores = pPresentInfo->pWaitSemaphores;
+	submitInfo.pWaitDstStageMask = waitStages.data();
+	timeCall([&]() { vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE); });
+}
+
+bool MoltenVKCallReplayer::addSwapchainImage(MVKCallReplaySwapchain* pSwapchain) {
+	const VkSwapchainCreateInfoKHR& scInfo = pSwapchain->createInfo;
+	VkDevice device = pSwapchain->device;
+
+	VkImageCreateInfo imgInfo = {};
+	imgInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imgInfo.imageType = VK_IMAGE_TYPE_2D;
+	imgInfo.format = scInfo.imageFormat;
+	imgInfo.extent = { scInfo.imageExtent.width, scInfo.imageExtent.height, 1 };
+	imgInfo.mipLevels = 1;
+	imgInfo.arrayLayers = scInfo.imageArrayLayers;
+	imgInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imgInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imgInfo.usage = scInfo.imageUsage;
+	imgInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	VkImage image = VK_NULL_HANDLE;
+	if (vkCreateImage(device, &imgInfo, nullptr, &image) != VK_SUCCESS) {
+		log("Could not create an image to replace a swapchain image.");
+		return false;
+	}
+
+	VkMemoryRequirements memReqs;
+	vkGetImageMemoryRequirements(device, image, &memReqs);
+	VkMemoryAllocateInfo memInfo = {};
+	memInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memInfo.allocationSize = memReqs.size;
+	memInfo.memoryTypeIndex = getMemoryTypeIndex(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	VkDeviceMemory imageMemory = VK_NULL_HANDLE;
+	if (vkAllocateMemory(device, &memInfo, nullptr, &imageMemory) != VK_SUCCESS) {
+		log("Could not allocate memory for an image to replace a swapchain image.");
+		vkDestroyImage(device, image, nullptr);
+		return false;
+	}
+	vkBindImageMemory(device, image, imageMemory, 0);
+
+	pSwapchain->images.push_back(image);
+	pSwapchain->imageMemories.push_back(imageMemory);
+	return true;
+}
+
+void MoltenVKCallReplayer::destroySwapchain(MVKCallReplaySwapchain* pSwapchain) {
+	auto iter = find(_swapchains.begin(), _swapchains.end(), pSwapchain);
+	if (iter == _swapchains.end()) { return; }
+	_swapchains.erase(iter);
+
+	for (auto image : pSwapchain->images) { vkDestroyImage(pSwapchain->device, image, nullptr); }
+	for (auto imageMemory : pSwapchain->imageMemories) { vkFreeMemory(pSwapchain->device, imageMemory, nullptr); }
+	delete pSwapchain;
+}
+
+
+#pragma mark Results
+
+// Writes one line of JSON, appending to the output file if one was specified, or to stdout otherwise.
+bool MoltenVKCallReplayer::writeResults() {
+	FILE* pFile = _outputFilePath.empty() ? stdout : fopen(_outputFilePath.c_str(), "a");
+	if ( !pFile ) {
+		string errMsg = "Could not open output file " + _outputFilePath;
+		log(errMsg.c_str());
+		return false;
+	}
+
+	fprintf(pFile, "{\"moltenVKVersion\":\"%d.%d.%d\",\"gpu\":\"%s\",\"timestamp\":%.0f,\"recording\":\"%s\"",
+			MVK_VERSION_MAJOR, MVK_VERSION_MINOR, MVK_VERSION_PATCH,
+			mvkGetJSONEscapedString(_physicalDeviceProperties.deviceName).c_str(),
+			[NSDate date].timeIntervalSince1970, mvkGetJSONEscapedString(_recordingFilePath.c_str()).c_str());
+	fprintf(pFile, ",\"recordedCalls\":%llu,\"droppedCalls\":%llu,\"replayedCalls\":%llu,\"skippedCalls\":%llu,\"invalidCalls\":%llu",
+			(unsigned long long)_fileHeader.callCount, (unsigned long long)_fileHeader.droppedCount,
+			(unsigned long long)_replayedCallCount, (unsigned long long)_skippedCallCount, (unsigned long long)_invalidCallCount);
+	fprintf(pFile, ",\"skippedCommandBuffers\":%llu,\"skippedWaits\":%llu",
+			(unsigned long long)_skippedCommandBufferCount, (unsigned long long)_skippedWaitCount);
+
+	fprintf(pFile, ",\"frames\":[");
+	const char* sep = "";
+	for (auto& frame : _frames) {
+		fprintf(pFile, "%s{\"recorded\":%.6f,\"replayed\":%.6f,\"recordedCalls\":%.6f,\"replayedCalls\":%.6f}",
+				sep, frame.recordedDuration, frame.replayedDuration, frame.recordedCallDuration, frame.replayedCallDuration);
+		sep = ",";
+	}
+
+	fprintf(pFile, "],\"functions\":[");
+	sep = "";
+	for (auto& func : _functions) {
+		if ( !func.recordedCount ) { continue; }
+
+		fprintf(pFile, "%s{\"name\":\"%s\",\"calls\":%llu,\"replayedCalls\":%llu,\"skippedCalls\":%llu,\"recorded\":%.6f,\"replayed\":%.6f}",
+				sep, mvkGetJSONEscapedString(func.name.c_str()).c_str(), (unsigned long long)func.recordedCount,
+				(unsigned long long)func.replayedCount, (unsigned long long)func.skippedCount,
+				func.recordedDuration, func.replayedDuration);
+		sep = ",";
+	}
+	fprintf(pFile, "]}\n");
+
+	if (pFile != stdout) { fclose(pFile); }
+	return true;
+}
+
+
+#pragma mark Vulkan
+
+bool MoltenVKCallReplayer::initVulkan() {
+	VkApplicationInfo appInfo = {};
+	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pApplicationName = _processName.c_str();
+	appInfo.apiVersion = VK_API_VERSION_1_0;
+
+	VkInstanceCreateInfo instInfo = {};
+	instInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	instInfo.pApplicationInfo = &appInfo;
+	if (vkCreateInstance(&instInfo, nullptr, &_instance) != VK_SUCCESS) {
+		log("Could not create a VkInstance.");
+		return false;
+	}
+
+	uint32_t gpuCnt = 1;
+	vkEnumeratePhysicalDevices(_instance, &gpuCnt, &_physicalDevice);
+	if ( !gpuCnt ) {
+		log("Could not find a GPU.");
+		return false;
+	}
+	vkGetPhysicalDeviceProperties(_physicalDevice, &_physicalDeviceProperties);
+	vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &_memoryProperties);
+
+	return true;
+}
+
+uint32_t MoltenVKCallReplayer::getMemoryTypeIndex(uint32_t memTypeBits, VkMemoryPropertyFlags memFlags) {
+	for (uint32_t mtIdx = 0; mtIdx < _memoryProperties.memoryTypeCount; mtIdx++) {
+		if (mvkIsAnyFlagEnabled(memTypeBits, 1U << mtIdx) &&
+			mvkAreAllFlagsEnabled(_memoryProperties.memoryTypes[mtIdx].propertyFlags, memFlags)) {
+			return mtIdx;
+		}
+	}
+	return 0;
+}
+
+// Objects created by the recording, and not destroyed by it, are released with the device.
+void MoltenVKCallReplayer::destroyVulkan() {
+	if (_device) {
+		vkDeviceWaitIdle(_device);
+		auto swapchains = _swapchains;
+		for (auto* pSwapchain : swapchains) { destroySwapchain(pSwapchain); }
+		vkDestroyDevice(_device, nullptr);
+		_device = VK_NULL_HANDLE;
+	}
+	if (_instance) {
+		vkDestroyInstance(_instance, nullptr);
+		_instance = VK_NULL_HANDLE;
+	}
+}
+
+
+#pragma mark Command line
+
+void MoltenVKCallReplayer::log(const char* logMsg) {
+	fprintf(stderr, "%s\n", logMsg);
+}
+
+void MoltenVKCallReplayer::showUsage() {
+	string line = "\n\e[1m" + _processName + "\e[0m replays a recording of Vulkan calls, made by setting the";
+	log(line.c_str());
+	log("MVK_CONFIG_CALL_RECORD_FILE environment variable, and writes the recorded and replayed");
+	log("durations of the calls as a single line of JSON. All durations are in milliseconds.");
+	log("\nUsage:");
+	line = "  " + _processName + " [options] \"recordingFile\"";
+	log(line.c_str());
+	log("\nOptions:");
+	log("  -o \"outFile\"       - Appends the results to the specified file, instead of");
+	log("                       writing them to stdout.");
+	log("  -v                 - Logs each call whose parameters could not be read.");
+	log("  -h                 - Displays this message.");
+	log("");
+}
+
+bool MoltenVKCallReplayer::parseArgs(int argc, const char* argv[]) {
+	if (argc == 0) { return false; }
+
+	string execPath(argv[0]);
+	size_t sepPos = execPath.find_last_of('/');
+	_processName = (sepPos == string::npos) ? execPath : execPath.substr(sepPos + 1);
+
+	for (int argIdx = 1; argIdx < argc; argIdx++) {
+		string arg = argv[argIdx];
+		bool hasParam = argIdx + 1 < argc;
+
+		if (arg == "-o" && hasParam) {
+			_outputFilePath = argv[++argIdx];
+			continue;
+		}
+		if (arg == "-v") {
+			_isVerbose = true;
+			continue;
+		}
+		if (arg[0] != '-' && _recordingFilePath.empty()) {
+			_recordingFilePath = arg;
+			continue;
+		}
+		return false;
+	}
+	return !_recordingFilePath.empty();
+}
+
+MoltenVKCallReplayer::MoltenVKCallReplayer(int argc, const char* argv[]) {
+	_isVerbose = false;
+	_isActive = parseArgs(argc, argv);
+	if ( !_isActive ) { showUsage(); }
+}
+
+MoltenVKCallReplayer::~MoltenVKCallReplayer() {
+	destroyVulkan();
+}
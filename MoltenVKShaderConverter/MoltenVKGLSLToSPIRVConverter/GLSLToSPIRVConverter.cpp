@@ -23,6 +23,7 @@
 #include "MVKStrings.h"
 #include <glslang/SPIRV/GlslangToSpv.h>
 #include <sstream>
+#include <mutex>
 
 using namespace std;
 using namespace mvk;
@@ -34,6 +35,9 @@ using namespace mvk;
 /** Configures the specified limit resources structure used by the GLSL compiler. */
 void configureGLSLCompilerResources(TBuiltInResource* glslCompilerResources);
 
+/** Returns the limit resources used by the GLSL compiler, which are configured once and shared by all conversions. */
+static const TBuiltInResource& getGLSLCompilerResources();
+
 /** Returns the GLSL compiler language type corresponding to the specified MoltenVK shader stage. */
 EShLanguage eshLanguageFromMVKGLSLConversionShaderStage(const MVKGLSLConversionShaderStage mvkShaderStage);
 
@@ -59,13 +63,14 @@ MVK_PUBLIC_SYMBOL bool GLSLToSPIRVConverter::convert(MVKGLSLConversionShaderStag
 	_resultLog.clear();
 	_spirv.clear();
 
+	initializeProcess();
+
 	if (shouldLogGLSL) { logGLSL("Converting"); }
 
 	EShMessages messages = (EShMessages)(EShMsgDefault | EShMsgSpvRules | EShMsgVulkanRules);
 
 	EShLanguage stage = eshLanguageFromMVKGLSLConversionShaderStage(shaderStage);
-	TBuiltInResource glslCompilerResources;
-	configureGLSLCompilerResources(&glslCompilerResources);
+	const TBuiltInResource& glslCompilerResources = getGLSLCompilerResources();
 	std::vector<std::unique_ptr<glslang::TShader>> glslShaders;
 	const char *glslStrings[1];
 	glslang::TProgram glslProgram;
@@ -153,6 +158,16 @@ void GLSLToSPIRVConverter::logGLSL(const char* opDesc) {
 #pragma mark -
 #pragma mark Support functions
 
+// Function-local static initialization is thread-safe, so concurrent conversions share a single copy.
+static const TBuiltInResource& getGLSLCompilerResources() {
+	static const TBuiltInResource glslCompilerResources = []() {
+		TBuiltInResource rez;
+		configureGLSLCompilerResources(&rez);
+		return rez;
+	}();
+	return glslCompilerResources;
+}
+
 void configureGLSLCompilerResources(TBuiltInResource* glslCompilerResources) {
 	glslCompilerResources->maxLights = 32;
 	glslCompilerResources->maxClipPlanes = 6;
@@ -263,18 +278,19 @@ EShLanguage eshLanguageFromMVKGLSLConversionShaderStage(const MVKGLSLConversionS
 
 #pragma mark Library initialization
 
+static std::once_flag _glslangInitFlag;
+
+MVK_PUBLIC_SYMBOL void GLSLToSPIRVConverter::initializeProcess() {
+	std::call_once(_glslangInitFlag, []() { glslang::InitializeProcess(); });
+}
+
 /**
  * Called automatically when the framework is loaded and initialized.
  *
- * Initialize the
+ * Initialize the GLSL compiler, before any conversions are started on other threads.
  */
-static bool _wasShaderConverterInitialized = false;
 __attribute__((constructor)) static void MVKShaderConverterInit() {
-	if (_wasShaderConverterInitialized ) { return; }
-
-	glslang::InitializeProcess();
-
-	_wasShaderConverterInitialized = true;
+	GLSLToSPIRVConverter::initializeProcess();
 }
 
 
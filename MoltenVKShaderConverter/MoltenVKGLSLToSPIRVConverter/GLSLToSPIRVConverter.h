@@ -30,11 +30,26 @@ namespace mvk {
 #pragma mark -
 #pragma mark GLSLToSPIRVConverter
 
-	/** Converts GLSL code to SPIR-V code. */
+	/**
+	 * Converts GLSL code to SPIR-V code.
+	 *
+	 * Separate instances of this class may be used concurrently from different threads,
+	 * to convert several shaders in parallel. A single instance is not thread-safe.
+	 */
 	class GLSLToSPIRVConverter {
 
 	public:
 
+		/**
+		 * Initializes the GLSL compiler for use by this process.
+		 *
+		 * This function is called automatically when the library is loaded, and by each conversion,
+		 * but can be called explicitly to ensure initialization occurs before conversions are
+		 * started on several threads. Only the first call has any effect, and it is safe to call
+		 * this function from any thread.
+		 */
+		static void initializeProcess();
+
 		/** Sets the GLSL source code that is to be converted to the specified string. */
 		void setGLSL(const std::string& glslSrc);
 
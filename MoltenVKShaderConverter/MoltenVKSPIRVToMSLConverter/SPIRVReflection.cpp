@@ -27,86 +27,134 @@ static const char missingWindingErr[] = "Neither tessellation shader specifies a
 static const char missingPartitionErr[] = "Neither tessellation shader specifies a partition mode (SpacingEqual, SpacingFractionalOdd, or SpacingFractionalEven).";
 static const char missingOutputVerticesErr[] = "Neither tessellation shader specifies the number of output control points.";
 
-/** Given a tessellation control shader and a tessellation evaluation shader, both in SPIR-V format, returns tessellation reflection data. */
-bool getTessReflectionData(const std::vector<uint32_t>& tesc, const std::string& tescEntryName, const std::vector<uint32_t>& tese, const std::string& teseEntryName, SPIRVTessReflectionData& reflectData, std::string& errorLog) {
-#ifndef SPIRV_CROSS_EXCEPTIONS_TO_ASSERTIONS
-	try {
-#endif
-		SPIRV_CROSS_NAMESPACE::CompilerReflection tescReflect(tesc);
-		SPIRV_CROSS_NAMESPACE::CompilerReflection teseReflect(tese);
+// Extracts the execution modes of the entry point compiled by the reflection compiler.
+static void populateExecutionModes(SPIRV_CROSS_NAMESPACE::CompilerReflection& reflect, SPIRVEntryPointReflectionData& reflectData) {
+	const SPIRV_CROSS_NAMESPACE::Bitset& modes = reflect.get_execution_mode_bitset();
+
+	if (modes.get(spv::ExecutionModeTriangles)) {
+		reflectData.patchKind = spv::ExecutionModeTriangles;
+	} else if (modes.get(spv::ExecutionModeQuads)) {
+		reflectData.patchKind = spv::ExecutionModeQuads;
+	} else if (modes.get(spv::ExecutionModeIsolines)) {
+		reflectData.patchKind = spv::ExecutionModeIsolines;
+	}
 
-		if (!tescEntryName.empty()) {
-			tescReflect.set_entry_point(tescEntryName, spv::ExecutionModelTessellationControl);
-		}
-		if (!teseEntryName.empty()) {
-			teseReflect.set_entry_point(teseEntryName, spv::ExecutionModelTessellationEvaluation);
-		}
+	if (modes.get(spv::ExecutionModeVertexOrderCw)) {
+		reflectData.windingOrder = spv::ExecutionModeVertexOrderCw;
+	} else if (modes.get(spv::ExecutionModeVertexOrderCcw)) {
+		reflectData.windingOrder = spv::ExecutionModeVertexOrderCcw;
+	}
 
-		tescReflect.compile();
-		teseReflect.compile();
-
-		const SPIRV_CROSS_NAMESPACE::Bitset& tescModes = tescReflect.get_execution_mode_bitset();
-		const SPIRV_CROSS_NAMESPACE::Bitset& teseModes = teseReflect.get_execution_mode_bitset();
-
-		// Extract the parameters from the shaders.
-		if (tescModes.get(spv::ExecutionModeTriangles)) {
-			reflectData.patchKind = spv::ExecutionModeTriangles;
-		} else if (tescModes.get(spv::ExecutionModeQuads)) {
-			reflectData.patchKind = spv::ExecutionModeQuads;
-		} else if (tescModes.get(spv::ExecutionModeIsolines)) {
-			reflectData.patchKind = spv::ExecutionModeIsolines;
-		} else if (teseModes.get(spv::ExecutionModeTriangles)) {
-			reflectData.patchKind = spv::ExecutionModeTriangles;
-		} else if (teseModes.get(spv::ExecutionModeQuads)) {
-			reflectData.patchKind = spv::ExecutionModeQuads;
-		} else if (teseModes.get(spv::ExecutionModeIsolines)) {
-			reflectData.patchKind = spv::ExecutionModeIsolines;
-		} else {
-			errorLog = missingPatchInputErr;
-			return false;
-		}
+	reflectData.pointMode = modes.get(spv::ExecutionModePointMode);
 
-		if (tescModes.get(spv::ExecutionModeVertexOrderCw)) {
-			reflectData.windingOrder = spv::ExecutionModeVertexOrderCw;
-		} else if (tescModes.get(spv::ExecutionModeVertexOrderCcw)) {
-			reflectData.windingOrder = spv::ExecutionModeVertexOrderCcw;
-		} else if (teseModes.get(spv::ExecutionModeVertexOrderCw)) {
-			reflectData.windingOrder = spv::ExecutionModeVertexOrderCw;
-		} else if (teseModes.get(spv::ExecutionModeVertexOrderCcw)) {
-			reflectData.windingOrder = spv::ExecutionModeVertexOrderCcw;
-		} else {
-			errorLog = missingWindingErr;
-			return false;
-		}
+	if (modes.get(spv::ExecutionModeSpacingEqual)) {
+		reflectData.partitionMode = spv::ExecutionModeSpacingEqual;
+	} else if (modes.get(spv::ExecutionModeSpacingFractionalEven)) {
+		reflectData.partitionMode = spv::ExecutionModeSpacingFractionalEven;
+	} else if (modes.get(spv::ExecutionModeSpacingFractionalOdd)) {
+		reflectData.partitionMode = spv::ExecutionModeSpacingFractionalOdd;
+	}
 
-		reflectData.pointMode = tescModes.get(spv::ExecutionModePointMode) || teseModes.get(spv::ExecutionModePointMode);
-
-		if (tescModes.get(spv::ExecutionModeSpacingEqual)) {
-			reflectData.partitionMode = spv::ExecutionModeSpacingEqual;
-		} else if (tescModes.get(spv::ExecutionModeSpacingFractionalEven)) {
-			reflectData.partitionMode = spv::ExecutionModeSpacingFractionalEven;
-		} else if (tescModes.get(spv::ExecutionModeSpacingFractionalOdd)) {
-			reflectData.partitionMode = spv::ExecutionModeSpacingFractionalOdd;
-		} else if (teseModes.get(spv::ExecutionModeSpacingEqual)) {
-			reflectData.partitionMode = spv::ExecutionModeSpacingEqual;
-		} else if (teseModes.get(spv::ExecutionModeSpacingFractionalEven)) {
-			reflectData.partitionMode = spv::ExecutionModeSpacingFractionalEven;
-		} else if (teseModes.get(spv::ExecutionModeSpacingFractionalOdd)) {
-			reflectData.partitionMode = spv::ExecutionModeSpacingFractionalOdd;
+	if (modes.get(spv::ExecutionModeOutputVertices)) {
+		reflectData.numControlPoints = reflect.get_execution_mode_argument(spv::ExecutionModeOutputVertices);
+	}
+
+	if (modes.get(spv::ExecutionModeLocalSize)) {
+		reflectData.workgroupSize.width = reflect.get_execution_mode_argument(spv::ExecutionModeLocalSize, 0);
+		reflectData.workgroupSize.height = reflect.get_execution_mode_argument(spv::ExecutionModeLocalSize, 1);
+		reflectData.workgroupSize.depth = reflect.get_execution_mode_argument(spv::ExecutionModeLocalSize, 2);
+	}
+}
+
+// Extracts the outputs of the entry point compiled by the reflection compiler, sorted by location.
+static void populateShaderOutputs(const SPIRV_CROSS_NAMESPACE::ParsedIR& ir, SPIRV_CROSS_NAMESPACE::CompilerReflection& reflect, spv::ExecutionModel model, std::vector<SPIRVShaderOutput>& outputs) {
+	outputs.clear();
+
+	auto addSat = [](uint32_t a, uint32_t b) { return a == uint32_t(-1) ? a : a + b; };
+	ir.for_each_typed_id<SPIRV_CROSS_NAMESPACE::SPIRVariable>([&reflect, &outputs, model, addSat](uint32_t varID, const SPIRV_CROSS_NAMESPACE::SPIRVariable& var) {
+		if (var.storage != spv::StorageClassOutput) { return; }
+
+		bool isUsed = true;
+		const auto* type = &reflect.get_type(reflect.get_type_from_variable(varID).parent_type);
+		bool patch = reflect.has_decoration(varID, spv::DecorationPatch);
+		auto biType = spv::BuiltInMax;
+		if (reflect.has_decoration(varID, spv::DecorationBuiltIn)) {
+			biType = (spv::BuiltIn)reflect.get_decoration(varID, spv::DecorationBuiltIn);
+			isUsed = reflect.has_active_builtin(biType, var.storage);
+		}
+		uint32_t loc = -1;
+		if (reflect.has_decoration(varID, spv::DecorationLocation)) {
+			loc = reflect.get_decoration(varID, spv::DecorationLocation);
+		}
+		if (model == spv::ExecutionModelTessellationControl && !patch)
+			type = &reflect.get_type(type->parent_type);
+
+		if (type->basetype == SPIRV_CROSS_NAMESPACE::SPIRType::Struct) {
+			for (uint32_t i = 0; i < type->member_types.size(); i++) {
+				// Each member may have a location decoration. If not, each member
+				// gets an incrementing location.
+				uint32_t memberLoc = addSat(loc, i);
+				if (reflect.has_member_decoration(type->self, i, spv::DecorationLocation)) {
+					memberLoc = reflect.get_member_decoration(type->self, i, spv::DecorationLocation);
+				}
+				patch = reflect.has_member_decoration(type->self, i, spv::DecorationPatch);
+				if (reflect.has_member_decoration(type->self, i, spv::DecorationBuiltIn)) {
+					biType = (spv::BuiltIn)reflect.get_member_decoration(type->self, i, spv::DecorationBuiltIn);
+					isUsed = reflect.has_active_builtin(biType, var.storage);
+				}
+				const SPIRV_CROSS_NAMESPACE::SPIRType& memberType = reflect.get_type(type->member_types[i]);
+				if (memberType.columns > 1) {
+					for (uint32_t i = 0; i < memberType.columns; i++) {
+						outputs.push_back({memberType.basetype, memberType.vecsize, addSat(memberLoc, i), biType, patch, isUsed});
+					}
+				} else if (!memberType.array.empty()) {
+					for (uint32_t i = 0; i < memberType.array[0]; i++) {
+						outputs.push_back({memberType.basetype, memberType.vecsize, addSat(memberLoc, i), biType, patch, isUsed});
+					}
+				} else {
+					outputs.push_back({memberType.basetype, memberType.vecsize, memberLoc, biType, patch, isUsed});
+				}
+			}
+		} else if (type->columns > 1) {
+			for (uint32_t i = 0; i < type->columns; i++) {
+				outputs.push_back({type->basetype, type->vecsize, addSat(loc, i), biType, patch, isUsed});
+			}
+		} else if (!type->array.empty()) {
+			for (uint32_t i = 0; i < type->array[0]; i++) {
+				outputs.push_back({type->basetype, type->vecsize, addSat(loc, i), biType, patch, isUsed});
+			}
 		} else {
-			errorLog = missingPartitionErr;
-			return false;
+			outputs.push_back({type->basetype, type->vecsize, loc, biType, patch, isUsed});
 		}
+	});
+	// Sort outputs by ascending location.
+	std::stable_sort(outputs.begin(), outputs.end(), [](const SPIRVShaderOutput& a, const SPIRVShaderOutput& b) {
+		return a.location < b.location;
+	});
+	// Assign locations to outputs that don't have one.
+	uint32_t loc = -1;
+	for (SPIRVShaderOutput& out : outputs) {
+		if (out.location == uint32_t(-1)) { out.location = loc + 1; }
+		loc = out.location;
+	}
+}
 
-		if (tescModes.get(spv::ExecutionModeOutputVertices)) {
-			reflectData.numControlPoints = tescReflect.get_execution_mode_argument(spv::ExecutionModeOutputVertices);
-		} else if (teseModes.get(spv::ExecutionModeOutputVertices)) {
-			reflectData.numControlPoints = teseReflect.get_execution_mode_argument(spv::ExecutionModeOutputVertices);
-		} else {
-			errorLog = missingOutputVerticesErr;
-			return false;
+// Extracts the execution modes, and optionally the outputs, of the entry point from the parsed IR.
+static bool getReflectionData(const SPIRV_CROSS_NAMESPACE::ParsedIR& ir, spv::ExecutionModel model, const std::string& entryName, SPIRVEntryPointReflectionData& reflectData, bool shouldGetOutputs, std::string& errorLog) {
+#ifndef SPIRV_CROSS_EXCEPTIONS_TO_ASSERTIONS
+	try {
+#endif
+		SPIRV_CROSS_NAMESPACE::CompilerReflection reflect(ir);
+		if (!entryName.empty()) {
+			reflect.set_entry_point(entryName, model);
 		}
+		reflect.compile();
 
+		populateExecutionModes(reflect, reflectData);
+		if (shouldGetOutputs) {
+			reflect.update_active_builtins();
+			populateShaderOutputs(ir, reflect, model, reflectData.outputs);
+		}
 		return true;
 
 #ifndef SPIRV_CROSS_EXCEPTIONS_TO_ASSERTIONS
@@ -117,90 +165,15 @@ bool getTessReflectionData(const std::vector<uint32_t>& tesc, const std::string&
 #endif
 }
 
-/** Given a shader in SPIR-V format, returns output reflection data. */
-bool getShaderOutputs(const std::vector<uint32_t>& spirv, spv::ExecutionModel model, const std::string& entryName, std::vector<SPIRVShaderOutput>& outputs, std::string& errorLog) {
+// Parses the SPIR-V once, and extracts the execution modes, and optionally the outputs, of the entry point.
+static bool getReflectionData(const std::vector<uint32_t>& spirv, spv::ExecutionModel model, const std::string& entryName, SPIRVEntryPointReflectionData& reflectData, bool shouldGetOutputs, std::string& errorLog) {
 #ifndef SPIRV_CROSS_EXCEPTIONS_TO_ASSERTIONS
 	try {
 #endif
 		SPIRV_CROSS_NAMESPACE::Parser parser(spirv);
 		parser.parse();
-		SPIRV_CROSS_NAMESPACE::CompilerReflection reflect(parser.get_parsed_ir());
-		if (!entryName.empty()) {
-			reflect.set_entry_point(entryName, model);
-		}
-		reflect.compile();
-		reflect.update_active_builtins();
-
-		outputs.clear();
+		return getReflectionData(parser.get_parsed_ir(), model, entryName, reflectData, shouldGetOutputs, errorLog);
 
-		auto addSat = [](uint32_t a, uint32_t b) { return a == uint32_t(-1) ? a : a + b; };
-		parser.get_parsed_ir().for_each_typed_id<SPIRV_CROSS_NAMESPACE::SPIRVariable>([&reflect, &outputs, model, addSat](uint32_t varID, const SPIRV_CROSS_NAMESPACE::SPIRVariable& var) {
-			if (var.storage != spv::StorageClassOutput) { return; }
-
-			bool isUsed = true;
-			const auto* type = &reflect.get_type(reflect.get_type_from_variable(varID).parent_type);
-			bool patch = reflect.has_decoration(varID, spv::DecorationPatch);
-			auto biType = spv::BuiltInMax;
-			if (reflect.has_decoration(varID, spv::DecorationBuiltIn)) {
-				biType = (spv::BuiltIn)reflect.get_decoration(varID, spv::DecorationBuiltIn);
-				isUsed = reflect.has_active_builtin(biType, var.storage);
-			}
-			uint32_t loc = -1;
-			if (reflect.has_decoration(varID, spv::DecorationLocation)) {
-				loc = reflect.get_decoration(varID, spv::DecorationLocation);
-			}
-			if (model == spv::ExecutionModelTessellationControl && !patch)
-				type = &reflect.get_type(type->parent_type);
-
-			if (type->basetype == SPIRV_CROSS_NAMESPACE::SPIRType::Struct) {
-				for (uint32_t i = 0; i < type->member_types.size(); i++) {
-					// Each member may have a location decoration. If not, each member
-					// gets an incrementing location.
-					uint32_t memberLoc = addSat(loc, i);
-					if (reflect.has_member_decoration(type->self, i, spv::DecorationLocation)) {
-						memberLoc = reflect.get_member_decoration(type->self, i, spv::DecorationLocation);
-					}
-					patch = reflect.has_member_decoration(type->self, i, spv::DecorationPatch);
-					if (reflect.has_member_decoration(type->self, i, spv::DecorationBuiltIn)) {
-						biType = (spv::BuiltIn)reflect.get_member_decoration(type->self, i, spv::DecorationBuiltIn);
-						isUsed = reflect.has_active_builtin(biType, var.storage);
-					}
-					const SPIRV_CROSS_NAMESPACE::SPIRType& memberType = reflect.get_type(type->member_types[i]);
-					if (memberType.columns > 1) {
-						for (uint32_t i = 0; i < memberType.columns; i++) {
-							outputs.push_back({memberType.basetype, memberType.vecsize, addSat(memberLoc, i), biType, patch, isUsed});
-						}
-					} else if (!memberType.array.empty()) {
-						for (uint32_t i = 0; i < memberType.array[0]; i++) {
-							outputs.push_back({memberType.basetype, memberType.vecsize, addSat(memberLoc, i), biType, patch, isUsed});
-						}
-					} else {
-						outputs.push_back({memberType.basetype, memberType.vecsize, memberLoc, biType, patch, isUsed});
-					}
-				}
-			} else if (type->columns > 1) {
-				for (uint32_t i = 0; i < type->columns; i++) {
-					outputs.push_back({type->basetype, type->vecsize, addSat(loc, i), biType, patch, isUsed});
-				}
-			} else if (!type->array.empty()) {
-				for (uint32_t i = 0; i < type->array[0]; i++) {
-					outputs.push_back({type->basetype, type->vecsize, addSat(loc, i), biType, patch, isUsed});
-				}
-			} else {
-				outputs.push_back({type->basetype, type->vecsize, loc, biType, patch, isUsed});
-			}
-		});
-		// Sort outputs by ascending location.
-		std::stable_sort(outputs.begin(), outputs.end(), [](const SPIRVShaderOutput& a, const SPIRVShaderOutput& b) {
-			return a.location < b.location;
-		});
-		// Assign locations to outputs that don't have one.
-		uint32_t loc = -1;
-		for (SPIRVShaderOutput& out : outputs) {
-			if (out.location == uint32_t(-1)) { out.location = loc + 1; }
-			loc = out.location;
-		}
-		return true;
 #ifndef SPIRV_CROSS_EXCEPTIONS_TO_ASSERTIONS
 	} catch (SPIRV_CROSS_NAMESPACE::CompilerError& ex) {
 		errorLog = ex.what();
@@ -209,4 +182,63 @@ bool getShaderOutputs(const std::vector<uint32_t>& spirv, spv::ExecutionModel mo
 #endif
 }
 
+/** Given a tessellation control shader and a tessellation evaluation shader, both in SPIR-V format, returns tessellation reflection data. */
+bool getTessReflectionData(const std::vector<uint32_t>& tesc, const std::string& tescEntryName, const std::vector<uint32_t>& tese, const std::string& teseEntryName, SPIRVTessReflectionData& reflectData, std::string& errorLog) {
+	SPIRVEntryPointReflectionData tescReflectData, teseReflectData;
+	return (getReflectionData(tesc, spv::ExecutionModelTessellationControl, tescEntryName, tescReflectData, false, errorLog) &&
+			getReflectionData(tese, spv::ExecutionModelTessellationEvaluation, teseEntryName, teseReflectData, false, errorLog) &&
+			getTessReflectionData(tescReflectData, teseReflectData, reflectData, errorLog));
+}
+
+/** Given the reflection data of a tessellation control shader and a tessellation evaluation shader, returns tessellation reflection data. */
+bool getTessReflectionData(const SPIRVEntryPointReflectionData& tescReflectData, const SPIRVEntryPointReflectionData& teseReflectData, SPIRVTessReflectionData& reflectData, std::string& errorLog) {
+
+	// Extract the parameters from the shaders, preferring those of the tessellation control shader.
+	reflectData.patchKind = (tescReflectData.patchKind != spv::ExecutionModeMax) ? tescReflectData.patchKind : teseReflectData.patchKind;
+	if (reflectData.patchKind == spv::ExecutionModeMax) {
+		errorLog = missingPatchInputErr;
+		return false;
+	}
+
+	reflectData.windingOrder = (tescReflectData.windingOrder != spv::ExecutionModeMax) ? tescReflectData.windingOrder : teseReflectData.windingOrder;
+	if (reflectData.windingOrder == spv::ExecutionModeMax) {
+		errorLog = missingWindingErr;
+		return false;
+	}
+
+	reflectData.pointMode = tescReflectData.pointMode || teseReflectData.pointMode;
+
+	reflectData.partitionMode = (tescReflectData.partitionMode != spv::ExecutionModeMax) ? tescReflectData.partitionMode : teseReflectData.partitionMode;
+	if (reflectData.partitionMode == spv::ExecutionModeMax) {
+		errorLog = missingPartitionErr;
+		return false;
+	}
+
+	reflectData.numControlPoints = tescReflectData.numControlPoints ? tescReflectData.numControlPoints : teseReflectData.numControlPoints;
+	if ( !reflectData.numControlPoints ) {
+		errorLog = missingOutputVerticesErr;
+		return false;
+	}
+
+	return true;
+}
+
+/** Given a shader in SPIR-V format, returns output reflection data. */
+bool getShaderOutputs(const std::vector<uint32_t>& spirv, spv::ExecutionModel model, const std::string& entryName, std::vector<SPIRVShaderOutput>& outputs, std::string& errorLog) {
+	SPIRVEntryPointReflectionData reflectData;
+	if ( !getReflectionData(spirv, model, entryName, reflectData, true, errorLog) ) { return false; }
+	outputs = std::move(reflectData.outputs);
+	return true;
+}
+
+/** Given a shader in SPIR-V format, returns reflection data for the entry point, with the specified name, of the specified execution model. */
+bool getEntryPointReflectionData(const std::vector<uint32_t>& spirv, spv::ExecutionModel model, const std::string& entryName, SPIRVEntryPointReflectionData& reflectData, std::string& errorLog) {
+	return getReflectionData(spirv, model, entryName, reflectData, true, errorLog);
+}
+
+/** Given a shader already parsed into SPIRV-Cross IR, returns reflection data for the entry point, with the specified name, of the specified execution model. */
+bool getEntryPointReflectionData(const SPIRV_CROSS_NAMESPACE::ParsedIR& ir, spv::ExecutionModel model, const std::string& entryName, SPIRVEntryPointReflectionData& reflectData, std::string& errorLog) {
+	return getReflectionData(ir, model, entryName, reflectData, true, errorLog);
+}
+
 }
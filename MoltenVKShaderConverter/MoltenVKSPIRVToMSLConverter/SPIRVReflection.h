@@ -21,6 +21,7 @@
 
 #include <SPIRV-Cross/spirv.hpp>
 #include <SPIRV-Cross/spirv_common.hpp>
+#include <SPIRV-Cross/spirv_cross_parsed_ir.hpp>
 #include <string>
 #include <vector>
 
@@ -71,14 +72,57 @@ namespace mvk {
 		bool isUsed;
 	};
 
+#pragma mark -
+#pragma mark SPIRVEntryPointReflectionData
+
+	/**
+	 * Reflection data for a single entry point of a shader. This contains the execution modes and outputs
+	 * of the entry point, and can be retained and reused by all pipelines that use the entry point.
+	 */
+	struct SPIRVEntryPointReflectionData {
+		/** The partition mode, one of SpacingEqual, SpacingFractionalEven, or SpacingFractionalOdd, or ExecutionModeMax if not specified. */
+		spv::ExecutionMode partitionMode = spv::ExecutionModeMax;
+
+		/** The winding order of generated triangles, one of VertexOrderCw or VertexOrderCcw, or ExecutionModeMax if not specified. */
+		spv::ExecutionMode windingOrder = spv::ExecutionModeMax;
+
+		/** Whether or not tessellation should produce points instead of lines or triangles. */
+		bool pointMode = false;
+
+		/** The kind of patch expected as input, one of Triangles, Quads, or Isolines, or ExecutionModeMax if not specified. */
+		spv::ExecutionMode patchKind = spv::ExecutionModeMax;
+
+		/** The number of control points output by a tessellation control shader, or zero if not specified. */
+		uint32_t numControlPoints = 0;
+
+		/** The number of threads in a compute workgroup, per dimension, as declared by the LocalSize execution mode. */
+		struct {
+			uint32_t width = 1;
+			uint32_t height = 1;
+			uint32_t depth = 1;
+		} workgroupSize;
+
+		/** The outputs of the entry point, sorted by location. */
+		std::vector<SPIRVShaderOutput> outputs;
+	};
+
 #pragma mark -
 #pragma mark Functions
 
 	/** Given a tessellation control shader and a tessellation evaluation shader, both in SPIR-V format, returns tessellation reflection data. */
 	bool getTessReflectionData(const std::vector<uint32_t>& tesc, const std::string& tescEntryName, const std::vector<uint32_t>& tese, const std::string& teseEntryName, SPIRVTessReflectionData& reflectData, std::string& errorLog);
 
+	/** Given the reflection data of a tessellation control shader and a tessellation evaluation shader, returns tessellation reflection data. */
+	bool getTessReflectionData(const SPIRVEntryPointReflectionData& tescReflectData, const SPIRVEntryPointReflectionData& teseReflectData, SPIRVTessReflectionData& reflectData, std::string& errorLog);
+
 	/** Given a shader in SPIR-V format, returns output reflection data. */
 	bool getShaderOutputs(const std::vector<uint32_t>& spirv, spv::ExecutionModel model, const std::string& entryName, std::vector<SPIRVShaderOutput>& outputs, std::string& errorLog);
 
+	/** Given a shader in SPIR-V format, returns reflection data for the entry point, with the specified name, of the specified execution model. */
+	bool getEntryPointReflectionData(const std::vector<uint32_t>& spirv, spv::ExecutionModel model, const std::string& entryName, SPIRVEntryPointReflectionData& reflectData, std::string& errorLog);
+
+	/** Given a shader already parsed into SPIRV-Cross IR, returns reflection data for the entry point, with the specified name, of the specified execution model. */
+	bool getEntryPointReflectionData(const SPIRV_CROSS_NAMESPACE::ParsedIR& ir, spv::ExecutionModel model, const std::string& entryName, SPIRVEntryPointReflectionData& reflectData, std::string& errorLog);
+
 }
 #endif
@@ -21,6 +21,7 @@
 #include "MVKStrings.h"
 #include "FileSupport.h"
 #include "SPIRVSupport.h"
+#include <SPIRV-Cross/spirv_parser.hpp>
 #include <fstream>
 
 using namespace mvk;
@@ -38,6 +39,12 @@ bool containsMatching(const vector<T>& vec, const T& val) {
     return false;
 }
 
+// Combines the hash of the value into the hash seed.
+template<class T>
+static inline void hashCombine(size_t& seed, const T& val) {
+	seed ^= std::hash<T>()(val) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
 MVK_PUBLIC_SYMBOL bool SPIRVToMSLConversionOptions::matches(const SPIRVToMSLConversionOptions& other) const {
 	if (entryPointStage != other.entryPointStage) { return false; }
 	if (entryPointName != other.entryPointName) { return false; }
@@ -64,13 +71,51 @@ MVK_PUBLIC_SYMBOL bool SPIRVToMSLConversionOptions::matches(const SPIRVToMSLConv
 	if (!!mslOptions.swizzle_texture_samples != !!other.mslOptions.swizzle_texture_samples) { return false; }
 	if (!!mslOptions.tess_domain_origin_lower_left != !!other.mslOptions.tess_domain_origin_lower_left) { return false; }
 	if (mslOptions.argument_buffers != other.mslOptions.argument_buffers) { return false; }
+	if (!!mslOptions.force_active_argument_buffer_resources != !!other.mslOptions.force_active_argument_buffer_resources) { return false; }
 	if (mslOptions.pad_fragment_output_components != other.mslOptions.pad_fragment_output_components) { return false; }
 	if (mslOptions.texture_buffer_native != other.mslOptions.texture_buffer_native) { return false; }
 	if (mslOptions.texture_1D_as_2D != other.mslOptions.texture_1D_as_2D) { return false; }
+	if (!!mslOptions.ios_use_framebuffer_fetch_subpasses != !!other.mslOptions.ios_use_framebuffer_fetch_subpasses) { return false; }
 
 	return true;
 }
 
+// Must be kept aligned with matches().
+MVK_PUBLIC_SYMBOL size_t SPIRVToMSLConversionOptions::hash() const {
+	size_t h = 0;
+	hashCombine(h, (uint32_t)entryPointStage);
+	hashCombine(h, entryPointName);
+	hashCombine(h, (uint32_t)tessPatchKind);
+	hashCombine(h, numTessControlPoints);
+	hashCombine(h, !!shouldFlipVertexY);
+
+	hashCombine(h, (uint32_t)mslOptions.platform);
+	hashCombine(h, mslOptions.msl_version);
+	hashCombine(h, mslOptions.texel_buffer_texture_width);
+	hashCombine(h, mslOptions.swizzle_buffer_index);
+	hashCombine(h, mslOptions.indirect_params_buffer_index);
+	hashCombine(h, mslOptions.shader_output_buffer_index);
+	hashCombine(h, mslOptions.shader_patch_output_buffer_index);
+	hashCombine(h, mslOptions.shader_tess_factor_buffer_index);
+	hashCombine(h, mslOptions.buffer_size_buffer_index);
+	hashCombine(h, mslOptions.shader_input_wg_index);
+	hashCombine(h, mslOptions.enable_frag_output_mask);
+	hashCombine(h, !!mslOptions.enable_point_size_builtin);
+	hashCombine(h, !!mslOptions.enable_frag_depth_builtin);
+	hashCombine(h, !!mslOptions.enable_frag_stencil_ref_builtin);
+	hashCombine(h, !!mslOptions.disable_rasterization);
+	hashCombine(h, !!mslOptions.capture_output_to_buffer);
+	hashCombine(h, !!mslOptions.swizzle_texture_samples);
+	hashCombine(h, !!mslOptions.tess_domain_origin_lower_left);
+	hashCombine(h, !!mslOptions.argument_buffers);
+	hashCombine(h, !!mslOptions.force_active_argument_buffer_resources);
+	hashCombine(h, !!mslOptions.pad_fragment_output_components);
+	hashCombine(h, !!mslOptions.texture_buffer_native);
+	hashCombine(h, !!mslOptions.texture_1D_as_2D);
+	hashCombine(h, !!mslOptions.ios_use_framebuffer_fetch_subpasses);
+	return h;
+}
+
 MVK_PUBLIC_SYMBOL std::string SPIRVToMSLConversionOptions::printMSLVersion(uint32_t mslVersion, bool includePatch) {
 	string verStr;
 
@@ -112,6 +157,19 @@ MVK_PUBLIC_SYMBOL bool MSLVertexAttribute::matches(const MSLVertexAttribute& oth
 	return true;
 }
 
+// Must be kept aligned with matches().
+MVK_PUBLIC_SYMBOL size_t MSLVertexAttribute::hash() const {
+	size_t h = 0;
+	hashCombine(h, vertexAttribute.location);
+	hashCombine(h, vertexAttribute.msl_buffer);
+	hashCombine(h, vertexAttribute.msl_offset);
+	hashCombine(h, vertexAttribute.msl_stride);
+	hashCombine(h, (uint32_t)vertexAttribute.format);
+	hashCombine(h, (uint32_t)vertexAttribute.builtin);
+	hashCombine(h, !!vertexAttribute.per_instance);
+	return h;
+}
+
 MVK_PUBLIC_SYMBOL bool mvk::MSLResourceBinding::matches(const MSLResourceBinding& other) const {
 	if (resourceBinding.stage != other.resourceBinding.stage) { return false; }
 	if (resourceBinding.desc_set != other.resourceBinding.desc_set) { return false; }
@@ -144,6 +202,19 @@ MVK_PUBLIC_SYMBOL bool mvk::MSLResourceBinding::matches(const MSLResourceBinding
 	return true;
 }
 
+// Must be kept aligned with matches(). The content of any constexpr sampler is left out of the hash.
+MVK_PUBLIC_SYMBOL size_t mvk::MSLResourceBinding::hash() const {
+	size_t h = 0;
+	hashCombine(h, (uint32_t)resourceBinding.stage);
+	hashCombine(h, resourceBinding.desc_set);
+	hashCombine(h, resourceBinding.binding);
+	hashCombine(h, resourceBinding.msl_buffer);
+	hashCombine(h, resourceBinding.msl_texture);
+	hashCombine(h, resourceBinding.msl_sampler);
+	hashCombine(h, requiresConstExprSampler);
+	return h;
+}
+
 MVK_PUBLIC_SYMBOL bool SPIRVToMSLConversionConfiguration::stageSupportsVertexAttributes() const {
 	return (options.entryPointStage == spv::ExecutionModelVertex ||
 			options.entryPointStage == spv::ExecutionModelTessellationControl ||
@@ -166,6 +237,14 @@ MVK_PUBLIC_SYMBOL bool SPIRVToMSLConversionConfiguration::isVertexBufferUsed(uin
     return false;
 }
 
+MVK_PUBLIC_SYMBOL bool SPIRVToMSLConversionConfiguration::isResourceUsed(spv::ExecutionModel stage, uint32_t descSet, uint32_t binding) const {
+	for (auto& rb : resourceBindings) {
+		auto& rbb = rb.resourceBinding;
+		if (rbb.stage == stage && rbb.desc_set == descSet && rbb.binding == binding) { return rb.isUsedByShader; }
+	}
+	return false;
+}
+
 MVK_PUBLIC_SYMBOL void SPIRVToMSLConversionConfiguration::markAllAttributesAndResourcesUsed() {
 	if (stageSupportsVertexAttributes()) {
 		for (auto& va : vertexAttributes) { va.isUsedByShader = true; }
@@ -192,6 +271,19 @@ MVK_PUBLIC_SYMBOL bool SPIRVToMSLConversionConfiguration::matches(const SPIRVToM
 }
 
 
+MVK_PUBLIC_SYMBOL uint64_t SPIRVToMSLConversionConfiguration::getBindingSignature(bool usedOnly) const {
+	uint64_t sig = 0;
+	if (stageSupportsVertexAttributes()) {
+		for (const auto& va : vertexAttributes) {
+			if (va.isUsedByShader || !usedOnly) { sig |= 1ULL << (va.hash() % 64); }
+		}
+	}
+	for (const auto& rb : resourceBindings) {
+		if (rb.isUsedByShader || !usedOnly) { sig |= 1ULL << (rb.hash() % 64); }
+	}
+	return sig;
+}
+
 MVK_PUBLIC_SYMBOL void SPIRVToMSLConversionConfiguration::alignWith(const SPIRVToMSLConversionConfiguration& srcContext) {
 
 	if (stageSupportsVertexAttributes()) {
@@ -221,6 +313,32 @@ MVK_PUBLIC_SYMBOL void SPIRVToMSLConverter::setSPIRV(const uint32_t* spirvCode,
 	for (size_t i = 0; i < length; i++) {
 		_spirv.push_back(spirvCode[i]);
 	}
+	_parsedIR.reset();
+}
+
+MVK_PUBLIC_SYMBOL const SPIRV_CROSS_NAMESPACE::ParsedIR& SPIRVToMSLConverter::getParsedIR() {
+	if ( !_parsedIR ) {
+		SPIRV_CROSS_NAMESPACE::Parser parser(_spirv.data(), _spirv.size());
+		parser.parse();
+		_parsedIR.reset(new SPIRV_CROSS_NAMESPACE::ParsedIR(std::move(parser.get_parsed_ir())));
+	}
+	return *_parsedIR;
+}
+
+MVK_PUBLIC_SYMBOL bool SPIRVToMSLConverter::getEntryPointReflectionData(spv::ExecutionModel model,
+																		const string& entryName,
+																		SPIRVEntryPointReflectionData& reflectData,
+																		string& errorLog) {
+#ifndef SPIRV_CROSS_EXCEPTIONS_TO_ASSERTIONS
+	try {
+#endif
+		return mvk::getEntryPointReflectionData(getParsedIR(), model, entryName, reflectData, errorLog);
+#ifndef SPIRV_CROSS_EXCEPTIONS_TO_ASSERTIONS
+	} catch (SPIRV_CROSS_NAMESPACE::CompilerError& ex) {
+		errorLog = ex.what();
+		return false;
+	}
+#endif
 }
 
 MVK_PUBLIC_SYMBOL bool SPIRVToMSLConverter::convert(SPIRVToMSLConversionConfiguration& context,
@@ -245,7 +363,7 @@ MVK_PUBLIC_SYMBOL bool SPIRVToMSLConverter::convert(SPIRVToMSLConversionConfigur
 #ifndef SPIRV_CROSS_EXCEPTIONS_TO_ASSERTIONS
 	try {
 #endif
-		pMSLCompiler = new SPIRV_CROSS_NAMESPACE::CompilerMSL(_spirv);
+		pMSLCompiler = new SPIRV_CROSS_NAMESPACE::CompilerMSL(getParsedIR());
 
 		if (context.options.hasEntryPoint()) {
 			pMSLCompiler->set_entry_point(context.options.entryPointName, context.options.entryPointStage);
@@ -334,7 +452,7 @@ MVK_PUBLIC_SYMBOL bool SPIRVToMSLConverter::convert(SPIRVToMSLConversionConfigur
 #ifndef SPIRV_CROSS_EXCEPTIONS_TO_ASSERTIONS
 		try {
 #endif
-			pGLSLCompiler = new SPIRV_CROSS_NAMESPACE::CompilerGLSL(_spirv);
+			pGLSLCompiler = new SPIRV_CROSS_NAMESPACE::CompilerGLSL(getParsedIR());
 			auto options = pGLSLCompiler->get_common_options();
 			options.vulkan_semantics = true;
 			options.separate_shader_objects = true;
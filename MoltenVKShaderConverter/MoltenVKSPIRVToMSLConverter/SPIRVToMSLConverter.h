@@ -21,8 +21,10 @@
 
 #include <SPIRV-Cross/spirv.hpp>
 #include <SPIRV-Cross/spirv_msl.hpp>
+#include "SPIRVReflection.h"
 #include <string>
 #include <vector>
+#include <memory>
 #include <unordered_map>
 
 namespace mvk {
@@ -50,6 +52,12 @@ namespace mvk {
 		 */
 		bool matches(const SPIRVToMSLConversionOptions& other) const;
 
+		/**
+		 * Returns a hash of the elements compared by matches().
+		 * Options that match each other have the same hash.
+		 */
+		std::size_t hash() const;
+
 		bool hasEntryPoint() const {
 			return !entryPointName.empty() && entryPointStage != spv::ExecutionModelMax;
 		}
@@ -82,6 +90,9 @@ namespace mvk {
 		 */
 		bool matches(const MSLVertexAttribute& other) const;
 
+		/** Returns a hash of the elements compared by matches(). */
+		std::size_t hash() const;
+
 	} MSLVertexAttribute;
 
 	/**
@@ -116,6 +127,9 @@ namespace mvk {
 		 */
 		bool matches(const MSLResourceBinding& other) const;
 
+		/** Returns a hash of the elements compared by matches(). */
+		std::size_t hash() const;
+
 	} MSLResourceBinding;
 
 	/**
@@ -138,6 +152,9 @@ namespace mvk {
         /** Returns whether the vertex buffer at the specified Metal binding index is used by the shader. */
         bool isVertexBufferUsed(uint32_t mslBuffer) const;
 
+		/** Returns whether the resource at the specified descriptor set and binding, in the specified stage, is used by the shader. */
+		bool isResourceUsed(spv::ExecutionModel stage, uint32_t descSet, uint32_t binding) const;
+
 		/** Marks all vertex attributes and resources as being used by the shader. */
 		void markAllAttributesAndResourcesUsed();
 
@@ -150,6 +167,18 @@ namespace mvk {
          */
         bool matches(const SPIRVToMSLConversionConfiguration& other) const;
 
+		/**
+		 * Returns a signature of the vertex attributes and resource bindings of this configuration,
+		 * in which each is represented by a bit selected by its hash. If usedOnly is true, only the
+		 * vertex attributes and resource bindings that are used by the shader are included.
+		 *
+		 * This configuration cannot match the other configuration if the signature of the used
+		 * elements of this configuration contains any bits that are not in the full signature of
+		 * the other configuration, which allows most non-matching configurations to be rejected
+		 * without calling matches().
+		 */
+		uint64_t getBindingSignature(bool usedOnly) const;
+
         /** Aligns certain aspects of this configuration with the source context. */
         void alignWith(const SPIRVToMSLConversionConfiguration& srcContext);
 
@@ -220,7 +249,7 @@ namespace mvk {
 	public:
 
 		/** Sets the SPIRV code. */
-		void setSPIRV(const std::vector<uint32_t>& spirv) { _spirv = spirv; }
+		void setSPIRV(const std::vector<uint32_t>& spirv) { _spirv = spirv; _parsedIR.reset(); }
 
 		/**
 		 * Sets the SPIRV code from the specified array of values.
@@ -234,6 +263,26 @@ namespace mvk {
 		/** Returns whether the SPIR-V code has been set. */
 		bool hasSPIRV() { return !_spirv.empty(); }
 
+		/**
+		 * Returns the SPIR-V code, set by one of the setSPIRV() functions, parsed into SPIRV-Cross
+		 * intermediate representation. The SPIR-V is parsed on the first call after it is set,
+		 * and the parsed IR is retained and reused by all subsequent conversions, each of which
+		 * clones its compiler from it, instead of parsing the SPIR-V again.
+		 *
+		 * Unless SPIRV_CROSS_EXCEPTIONS_TO_ASSERTIONS is defined, a CompilerError is thrown if
+		 * the SPIR-V cannot be parsed, and the parse is attempted again on the next call.
+		 */
+		const SPIRV_CROSS_NAMESPACE::ParsedIR& getParsedIR();
+
+		/**
+		 * Populates reflection data for the entry point, with the specified name, of the specified execution model,
+		 * from the IR returned by getParsedIR(). Returns false, and populates errorLog, if reflection fails.
+		 */
+		bool getEntryPointReflectionData(spv::ExecutionModel model,
+										 const std::string& entryName,
+										 SPIRVEntryPointReflectionData& reflectData,
+										 std::string& errorLog);
+
 		/**
 		 * Converts SPIR-V code, set using setSPIRV() to MSL code, which can be retrieved using getMSL().
 		 *
@@ -293,6 +342,7 @@ namespace mvk {
 		void populateEntryPoint(SPIRV_CROSS_NAMESPACE::Compiler* pCompiler, SPIRVToMSLConversionOptions& options);
 
 		std::vector<uint32_t> _spirv;
+		std::unique_ptr<SPIRV_CROSS_NAMESPACE::ParsedIR> _parsedIR;
 		std::string _msl;
 		std::string _resultLog;
 		SPIRVToMSLConversionResults _shaderConversionResults;
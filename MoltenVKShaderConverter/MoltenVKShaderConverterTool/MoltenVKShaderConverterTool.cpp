@@ -23,6 +23,9 @@
 #include "SPIRVToMSLConverter.h"
 #include "SPIRVSupport.h"
 #include "MVKOSExtensions.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 using namespace std;
 using namespace mvk;
@@ -43,12 +46,13 @@ static const char* _defaultSPIRVShaderExtns = "spv spirv";
 
 uint64_t MVKPerformanceTracker::getTimestamp() { return mvkGetTimestamp(); }
 
-void MVKPerformanceTracker::accumulate(uint64_t startTime, uint64_t endTime) {
+double MVKPerformanceTracker::accumulate(uint64_t startTime, uint64_t endTime) {
 	double currInterval = mvkGetElapsedMilliseconds(startTime, endTime);
 	minimumDuration = (minimumDuration == 0.0) ? currInterval : min(currInterval, minimumDuration);
 	maximumDuration = max(currInterval, maximumDuration);
 	double totalInterval = (averageDuration * count++) + currInterval;
 	averageDuration = totalInterval / count;
+	return currInterval;
 }
 
 
@@ -62,8 +66,10 @@ int MoltenVKShaderConverterTool::run() {
 	bool success = false;
 	if ( !_directoryPath.empty() ) {
 		string errMsg;
+		_batchFilePaths.clear();
 		success = iterateDirectory(_directoryPath, *this, _shouldUseDirectoryRecursion, errMsg);
 		if ( !success ) { log(errMsg.data()); }
+		success = processFiles(_batchFilePaths) && success;
 	} else {
 		if (_shouldReadGLSL) {
 			success = convertGLSL(_glslInFilePath, _spvOutFilePath, _mslOutFilePath, _shaderStage);
@@ -78,26 +84,77 @@ int MoltenVKShaderConverterTool::run() {
 	return success ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
+// Collects the files to be converted, so they can be converted in parallel once the directory has been iterated.
 bool MoltenVKShaderConverterTool::processFile(string filePath) {
 	string absPath = absolutePath(filePath);
-	string emptyPath;
-
 	string pathExtn = pathExtension(absPath);
+	if ((_shouldReadGLSL && isGLSLFileExtension(pathExtn)) || (_shouldReadSPIRV && isSPIRVFileExtension(pathExtn))) {
+		_batchFilePaths.push_back(absPath);
+	}
+	return true;
+}
+
+// Each thread repeatedly claims the next unconverted file until all files have been claimed.
+bool MoltenVKShaderConverterTool::processFiles(const vector<string>& filePaths) {
+	size_t fileCnt = filePaths.size();
+	vector<MVKFileConversionReport> fileReports(fileCnt);
+	atomic<size_t> nextFileIdx(0);
+	atomic<bool> success(true);
+
+	auto convertFiles = [&]() {
+		size_t fileIdx;
+		while ((fileIdx = nextFileIdx++) < fileCnt) {
+			MVKFileConversionReport& fileRpt = fileReports[fileIdx];
+			fileRpt.filePath = filePaths[fileIdx];
+			uint64_t startTime = mvkGetTimestamp();
+			fileRpt.wasSuccessful = convertFile(fileRpt.filePath, &fileRpt);
+			fileRpt.totalDuration = mvkGetElapsedMilliseconds(startTime);
+			if ( !fileRpt.wasSuccessful ) { success = false; }
+		}
+	};
+
+	// Ensure the GLSL compiler is initialized before conversions start on several threads
+	if (_shouldReadGLSL) { GLSLToSPIRVConverter::initializeProcess(); }
+
+	uint64_t startTime = mvkGetTimestamp();
+	vector<thread> threads;
+	size_t threadCnt = min<size_t>(_jobCount, fileCnt);
+	for (size_t thrdIdx = 1; thrdIdx < threadCnt; thrdIdx++) { threads.emplace_back(convertFiles); }
+	convertFiles();
+	for (auto& thrd : threads) { thrd.join(); }
+
+	if (_shouldReportPerformance) { reportBatchPerformance(fileReports, mvkGetElapsedMilliseconds(startTime)); }
+
+	return success;
+}
+
+bool MoltenVKShaderConverterTool::convertFile(string filePath, MVKFileConversionReport* pReport) {
+	string emptyPath;
+	string pathExtn = pathExtension(filePath);
 	if (_shouldReadGLSL && isGLSLFileExtension(pathExtn)) {
-		return convertGLSL(absPath, emptyPath, emptyPath, kMVKGLSLConversionShaderStageAuto);
+		return convertGLSL(filePath, emptyPath, emptyPath, kMVKGLSLConversionShaderStageAuto, pReport);
 	} else if (_shouldReadSPIRV && isSPIRVFileExtension(pathExtn)) {
-		return convertSPIRV(absPath, emptyPath);
+		return convertSPIRV(filePath, emptyPath, pReport);
 	}
 
 	return true;
 }
 
+// Accumulates the activity into the tracker, which may be shared by several conversion threads,
+// and returns the duration of the activity, in milliseconds.
+double MoltenVKShaderConverterTool::accumulatePerformance(MVKPerformanceTracker& tracker, uint64_t startTime) {
+	uint64_t endTime = tracker.getTimestamp();
+	lock_guard<mutex> lock(_performanceLock);
+	return tracker.accumulate(startTime, endTime);
+}
+
 // Read GLSL code from a GLSL file, convert to SPIR-V, and optionally MSL,
 // and write the SPIR-V and/or MSL code to files.
 bool MoltenVKShaderConverterTool::convertGLSL(string& glslInFile,
 											string& spvOutFile,
 											string& mslOutFile,
-											MVKGLSLConversionShaderStage shaderStage) {
+											MVKGLSLConversionShaderStage shaderStage,
+											MVKFileConversionReport* pReport) {
 	string path;
 	vector<char> fileContents;
 	string glslCode;
@@ -136,7 +193,8 @@ bool MoltenVKShaderConverterTool::convertGLSL(string& glslInFile,
 
 	uint64_t startTime = _glslConversionPerformance.getTimestamp();
 	bool wasConverted = glslConverter.convert(shaderStage, _shouldLogConversions, _shouldLogConversions);
-	_glslConversionPerformance.accumulate(startTime);
+	double glslDuration = accumulatePerformance(_glslConversionPerformance, startTime);
+	if (pReport) { pReport->glslConversionDuration = glslDuration; }
 
 	if (wasConverted) {
 		if (_shouldLogConversions) { log(glslConverter.getResultLog().data()); }
@@ -171,11 +229,11 @@ bool MoltenVKShaderConverterTool::convertGLSL(string& glslInFile,
 		}
 	}
 
-	return convertSPIRV(spv, glslInFile, mslOutFile, false);
+	return convertSPIRV(spv, glslInFile, mslOutFile, false, pReport);
 }
 
 // Read SPIR-V code from a SPIR-V file, convert to MSL, and write the MSL code to files.
-bool MoltenVKShaderConverterTool::convertSPIRV(string& spvInFile, string& mslOutFile) {
+bool MoltenVKShaderConverterTool::convertSPIRV(string& spvInFile, string& mslOutFile, MVKFileConversionReport* pReport) {
 	string path;
 	vector<char> fileContents;
 	vector<uint32_t> spv;
@@ -198,14 +256,15 @@ bool MoltenVKShaderConverterTool::convertSPIRV(string& spvInFile, string& mslOut
 	}
 	bytesToSPIRV(fileContents, spv);
 
-	return convertSPIRV(spv, spvInFile, mslOutFile, _shouldLogConversions);
+	return convertSPIRV(spv, spvInFile, mslOutFile, _shouldLogConversions, pReport);
 }
 
 // Read SPIR-V code from an array, convert to MSL, and write the MSL code to files.
 bool MoltenVKShaderConverterTool::convertSPIRV(const vector<uint32_t>& spv,
 											   string& inFile,
 											   string& mslOutFile,
-											   bool shouldLogSPV) {
+											   bool shouldLogSPV,
+											   MVKFileConversionReport* pReport) {
 	if ( !_shouldWriteMSL ) { return true; }
 
 	// Derive the context under which conversion will occur
@@ -219,7 +278,8 @@ bool MoltenVKShaderConverterTool::convertSPIRV(const vector<uint32_t>& spv,
 
 	uint64_t startTime = _spvConversionPerformance.getTimestamp();
 	bool wasConverted = spvConverter.convert(mslContext, shouldLogSPV, _shouldLogConversions, (_shouldLogConversions && shouldLogSPV));
-	_spvConversionPerformance.accumulate(startTime);
+	double spvDuration = accumulatePerformance(_spvConversionPerformance, startTime);
+	if (pReport) { pReport->spvConversionDuration = spvDuration; }
 
 	if (wasConverted) {
 		if (_shouldLogConversions) { log(spvConverter.getResultLog().data()); }
@@ -235,14 +295,21 @@ bool MoltenVKShaderConverterTool::convertSPIRV(const vector<uint32_t>& spv,
 	if (mslOutFile.empty()) { path = pathWithExtension(inFile, "metal", _shouldIncludeOrigPathExtn, _origPathExtnSep); }
 	const string& msl = spvConverter.getMSL();
 
-	string compileErrMsg;
-	bool wasCompiled = compile(msl, compileErrMsg, _mslVersionMajor, _mslVersionMinor, _mslVersionPatch);
-	if (compileErrMsg.size() > 0) {
-		string preamble = wasCompiled ? "is valid but the validation compilation produced warnings: " : "failed a validation compilation: ";
-		compileErrMsg = "Generated MSL " + preamble + compileErrMsg;
-		log(compileErrMsg.c_str());
-	} else {
-		log("Generated MSL was validated by a successful compilation with no warnings.");
+	// If a Metal library is to be written, compiling it validates the MSL instead.
+	bool wasCompiled;
+	startTime = _mslCompilePerformance.getTimestamp();
+	if ( !_shouldWriteMetalLib ) {
+		string compileErrMsg;
+		wasCompiled = compile(msl, compileErrMsg, _mslVersionMajor, _mslVersionMinor, _mslVersionPatch);
+		double compileDuration = accumulatePerformance(_mslCompilePerformance, startTime);
+		if (pReport) { pReport->mslCompileDuration = compileDuration; }
+		if (compileErrMsg.size() > 0) {
+			string preamble = wasCompiled ? "is valid but the validation compilation produced warnings: " : "failed a validation compilation: ";
+			compileErrMsg = "Generated MSL " + preamble + compileErrMsg;
+			log(compileErrMsg.c_str());
+		} else {
+			log("Generated MSL was validated by a successful compilation with no warnings.");
+		}
 	}
 
 	vector<char> fileContents;
@@ -251,12 +318,30 @@ bool MoltenVKShaderConverterTool::convertSPIRV(const vector<uint32_t>& spv,
 	if (writeFile(path, fileContents, writeErrMsg)) {
 		string logMsg = "Saved MSL to file: " + fileName(path);
 		log(logMsg.c_str());
-		return true;
 	} else {
 		writeErrMsg = "Could not write MSL file. " + writeErrMsg;
 		log(writeErrMsg.c_str());
 		return false;
 	}
+
+	// Compile the saved MSL file to a Metal library file alongside it
+	if (_shouldWriteMetalLib) {
+		string libPath = pathWithExtension(path, "metallib", false, _origPathExtnSep);
+		bool isIOS = (_mslPlatform == SPIRV_CROSS_NAMESPACE::CompilerMSL::Options::iOS);
+		string libErrMsg;
+		wasCompiled = compileToMetalLib(path, libPath, libErrMsg, isIOS, _mslVersionMajor, _mslVersionMinor);
+		double compileDuration = accumulatePerformance(_mslCompilePerformance, startTime);
+		if (pReport) { pReport->mslCompileDuration = compileDuration; }
+		if (wasCompiled) {
+			string logMsg = "Saved Metal library to file: " + fileName(libPath);
+			log(logMsg.c_str());
+		} else {
+			libErrMsg = "Could not compile generated MSL to a Metal library: " + libErrMsg;
+			log(libErrMsg.c_str());
+			return false;
+		}
+	}
+	return true;
 }
 
 MVKGLSLConversionShaderStage MoltenVKShaderConverterTool::shaderStageFromFileExtension(string& pathExtension) {
@@ -278,9 +363,12 @@ bool MoltenVKShaderConverterTool::isSPIRVFileExtension(string& pathExtension) {
 	return false;
 }
 
-// Log the specified message to the console.
+// Log the specified message to the console. Messages from several conversion threads are not interleaved.
 void MoltenVKShaderConverterTool::log(const char* logMsg) {
-	if ( !_quietMode ) { printf("%s\n", logMsg); }
+	if ( !_quietMode ) {
+		lock_guard<mutex> lock(_logLock);
+		printf("%s\n", logMsg);
+	}
 }
 
 // Display usage information about this application on the console.
@@ -319,6 +407,9 @@ void MoltenVKShaderConverterTool::showUsage() {
 	log("                       The optional mslOutFile parameter specifies the path to a single");
 	log("                       file to contain the MSL code. When using the -d option,");
 	log("                       the mslOutFile parameter is ignored.");
+	log("  -ml                - (when using -mo) Also compile the MSL to a Metal library (.metallib)");
+	log("                       file, using the offline Metal compiler, in place of the validation");
+	log("                       compilation of the MSL.");
 	log("  -mv mslVersion     - MSL version to output.");
 	log("                       Must be in form n[.n][.n] (eg. 2, 2.1, or 2.1.0).");
 	log("                       Defaults to the most recent MSL version for the platform");
@@ -351,7 +442,11 @@ void MoltenVKShaderConverterTool::showUsage() {
 	log("  -sx \"fileExtns\"    - List of SPIR-V shader file extensions.");
 	log("                       May be omitted for defaults (\"spv spirv\").");
 	log("  -l                 - Log the conversion results to the console (to aid debugging).");
-	log("  -p                 - Log the performance of the shader conversions.");
+	log("  -j [jobCount]      - (when using -d) Convert files in parallel, using jobCount threads.");
+	log("                       The jobCount may be omitted to use one thread per CPU core.");
+	log("  -p                 - Log the performance of the shader conversions. When using the -d");
+	log("                       option, also log the performance of each file, the slowest files,");
+	log("                       and the overall conversion throughput.");
 	log("  -q                 - Quiet mode. Stops logging of informational messages.");
 	log("");
 
@@ -363,6 +458,7 @@ void MoltenVKShaderConverterTool::reportPerformance() {
 
 	if (_shouldReadGLSL) { reportPerformance(_glslConversionPerformance, "GLSL to SPIR-V"); }
 	reportPerformance(_spvConversionPerformance, "SPIR-V to MSL");
+	if (_mslCompilePerformance.count) { reportPerformance(_mslCompilePerformance, "MSL to Metal library"); }
 }
 
 void MoltenVKShaderConverterTool::reportPerformance(MVKPerformanceTracker& shaderCompilationEvent, string eventDescription) {
@@ -382,6 +478,52 @@ void MoltenVKShaderConverterTool::reportPerformance(MVKPerformanceTracker& shade
 }
 
 
+// The number of slowest files to list in the batch performance report.
+static const size_t kMVKSlowestFileReportCount = 10;
+
+// Returns a string describing the durations of the conversion activities of the file.
+static string fileReportString(const MVKFileConversionReport& fileRpt) {
+	string rptStr = fileName(fileRpt.filePath);
+	rptStr += fileRpt.wasSuccessful ? "" : " (failed)";
+	rptStr += " total: " + to_string(fileRpt.totalDuration) + " ms";
+	if (fileRpt.glslConversionDuration) { rptStr += ", GLSL to SPIR-V: " + to_string(fileRpt.glslConversionDuration) + " ms"; }
+	if (fileRpt.spvConversionDuration) { rptStr += ", SPIR-V to MSL: " + to_string(fileRpt.spvConversionDuration) + " ms"; }
+	if (fileRpt.mslCompileDuration) { rptStr += ", MSL compile: " + to_string(fileRpt.mslCompileDuration) + " ms"; }
+	return rptStr;
+}
+
+void MoltenVKShaderConverterTool::reportBatchPerformance(vector<MVKFileConversionReport>& fileReports, double elapsedDuration) {
+	if (fileReports.empty()) { return; }
+
+	log("Performance of each file:");
+	for (auto& fileRpt : fileReports) { log(("  " + fileReportString(fileRpt)).c_str()); }
+
+	sort(fileReports.begin(), fileReports.end(), [](const MVKFileConversionReport& a, const MVKFileConversionReport& b) {
+		return a.totalDuration > b.totalDuration;
+	});
+	log("Slowest files:");
+	size_t slowCnt = min(kMVKSlowestFileReportCount, fileReports.size());
+	for (size_t rptIdx = 0; rptIdx < slowCnt; rptIdx++) { log(("  " + fileReportString(fileReports[rptIdx])).c_str()); }
+
+	double totalFileDuration = 0.0;
+	for (auto& fileRpt : fileReports) { totalFileDuration += fileRpt.totalDuration; }
+
+	string logMsg;
+	logMsg += "Converted ";
+	logMsg += to_string(fileReports.size());
+	logMsg += " files using ";
+	logMsg += to_string(min<size_t>(_jobCount, fileReports.size()));
+	logMsg += " threads in ";
+	logMsg += to_string(elapsedDuration);
+	logMsg += " ms (";
+	logMsg += to_string(elapsedDuration ? (fileReports.size() * 1000.0 / elapsedDuration) : 0.0);
+	logMsg += " files per second, ";
+	logMsg += to_string(totalFileDuration);
+	logMsg += " ms of total conversion time).\n";
+	log(logMsg.c_str());
+}
+
+
 #pragma mark Construction
 
 MoltenVKShaderConverterTool::MoltenVKShaderConverterTool(int argc, const char* argv[]) {
@@ -396,6 +538,7 @@ MoltenVKShaderConverterTool::MoltenVKShaderConverterTool(int argc, const char* a
 	_shouldReadSPIRV = false;
 	_shouldWriteSPIRV = false;
 	_shouldWriteMSL = false;
+	_shouldWriteMetalLib = false;
 	_shouldCombineGLSLAndMSL = false;
     _shouldFlipVertexY = true;
 	_shouldIncludeOrigPathExtn = true;
@@ -403,6 +546,7 @@ MoltenVKShaderConverterTool::MoltenVKShaderConverterTool(int argc, const char* a
 	_shouldReportPerformance = false;
 	_shouldOutputAsHeaders = false;
 	_quietMode = false;
+	_jobCount = 1;
 
 	_mslVersionMajor = 2;
 	_mslVersionMinor = 2;
@@ -461,6 +605,11 @@ bool MoltenVKShaderConverterTool::parseArgs(int argc, const char* argv[]) {
 			continue;
 		}
 
+		if(equal(arg, "-ml", true)) {
+			_shouldWriteMetalLib = true;
+			continue;
+		}
+
 		if (equal(arg, "-mv", true)) {
 			int optIdx = argIdx;
 			string mslVerStr;
@@ -585,6 +734,14 @@ bool MoltenVKShaderConverterTool::parseArgs(int argc, const char* argv[]) {
 			continue;
 		}
 
+		if (equal(arg, "-j", true)) {
+			string jobCntStr;
+			argIdx = optionalParam(jobCntStr, argIdx, argc, argv);
+			_jobCount = jobCntStr.empty() ? thread::hardware_concurrency() : (uint32_t)strtol(jobCntStr.c_str(), nullptr, 0);
+			_jobCount = max(_jobCount, 1U);
+			continue;
+		}
+
 		if(equal(arg, "-p", true)) {
 			_shouldReportPerformance = true;
 			continue;
@@ -23,6 +23,7 @@
 #include "SPIRVToMSLConverter.h"
 #include <string>
 #include <vector>
+#include <mutex>
 
 
 namespace mvk {
@@ -34,9 +35,19 @@ namespace mvk {
 		double maximumDuration = 0.0;
 
 		uint64_t getTimestamp();
-		void accumulate(uint64_t startTime, uint64_t endTime = 0);
+		double accumulate(uint64_t startTime, uint64_t endTime = 0);
 	} MVKPerformanceTracker;
 
+	/** The durations, in milliseconds, of the conversion activities for a single file. */
+	typedef struct {
+		std::string filePath;
+		double glslConversionDuration = 0.0;
+		double spvConversionDuration = 0.0;
+		double mslCompileDuration = 0.0;
+		double totalDuration = 0.0;
+		bool wasSuccessful = false;
+	} MVKFileConversionReport;
+
 #pragma mark -
 #pragma mark MoltenVKShaderConverterTool
 
@@ -47,13 +58,21 @@ namespace mvk {
 
 		/**
 		 * Called automatically during the conversion of all the files in a directory. 
-		 * Processes the specified file (which can contain either GLSL or SPIR-V code.
+		 * Adds the specified file to the batch of files to be converted, if the file
+		 * contains either GLSL or SPIR-V code. The batch is converted by processFiles().
 		 *
-		 * Returns false if the file is of the right type to be converted, but failed
-		 * to be converted correctly. Returns true otherwise.
+		 * Always returns true.
 		 */
 		bool processFile(std::string filePath);
 
+		/**
+		 * Converts each of the specified files, across the number of threads specified by the -j option.
+		 *
+		 * Returns false if any of the files is of the right type to be converted,
+		 * but failed to be converted correctly. Returns true otherwise.
+		 */
+		bool processFiles(const std::vector<std::string>& filePaths);
+
 		/** 
 		 * Run the converter based on command line arguments.
 		 * Returns zero if all went well, or an error code if not.
@@ -67,16 +86,21 @@ namespace mvk {
 		MVKGLSLConversionShaderStage shaderStageFromFileExtension(std::string& pathExtension);
 		bool isGLSLFileExtension(std::string& pathExtension);
 		bool isSPIRVFileExtension(std::string& pathExtension);
+		bool convertFile(std::string filePath, MVKFileConversionReport* pReport);
 		bool convertGLSL(std::string& glslInFile,
 						 std::string& spvOutFile,
 						 std::string& mslOutFile,
-						 MVKGLSLConversionShaderStage shaderStage);
+						 MVKGLSLConversionShaderStage shaderStage,
+						 MVKFileConversionReport* pReport = nullptr);
 		bool convertSPIRV(std::string& spvInFile,
-						  std::string& mslOutFile);
+						  std::string& mslOutFile,
+						  MVKFileConversionReport* pReport = nullptr);
 		bool convertSPIRV(const std::vector<uint32_t>& spv,
 						  std::string& inFile,
 						  std::string& mslOutFile,
-						  bool shouldLogSPV);
+						  bool shouldLogSPV,
+						  MVKFileConversionReport* pReport);
+		double accumulatePerformance(MVKPerformanceTracker& tracker, uint64_t startTime);
 		bool parseArgs(int argc, const char* argv[]);
 		void log(const char* logMsg);
 		void showUsage();
@@ -88,6 +112,7 @@ namespace mvk {
 		void reportPerformance();
 		void reportPerformance(MVKPerformanceTracker& shaderCompilationEvent,
 							   std::string eventDescription);
+		void reportBatchPerformance(std::vector<MVKFileConversionReport>& fileReports, double elapsedDuration);
 
 		std::string _processName;
 		std::string _directoryPath;
@@ -104,6 +129,11 @@ namespace mvk {
 		MVKGLSLConversionShaderStage _shaderStage;
 		MVKPerformanceTracker _glslConversionPerformance;
 		MVKPerformanceTracker _spvConversionPerformance;
+		MVKPerformanceTracker _mslCompilePerformance;
+		std::vector<std::string> _batchFilePaths;
+		std::mutex _logLock;
+		std::mutex _performanceLock;
+		uint32_t _jobCount;
 		uint32_t _mslVersionMajor;
 		uint32_t _mslVersionMinor;
 		uint32_t _mslVersionPatch;
@@ -114,6 +144,7 @@ namespace mvk {
 		bool _shouldReadSPIRV;
 		bool _shouldWriteSPIRV;
 		bool _shouldWriteMSL;
+		bool _shouldWriteMetalLib;
 		bool _shouldCombineGLSLAndMSL;
         bool _shouldFlipVertexY;
 		bool _shouldIncludeOrigPathExtn;
@@ -54,4 +54,19 @@ namespace mvk {
 				 uint32_t mslVersionMinor = 0,
 				 uint32_t mslVersionPoint = 0);
 
+	/**
+	 * Uses the offline Metal compiler to compile the MSL source code file at the specified path
+	 * into a Metal library file at the specified path, and returns whether it was successful.
+	 * The isIOS parameter indicates whether the library should be compiled for iOS or macOS.
+	 *
+	 * If unsuccessful, the return value will be false and the errMsg will contain an
+	 * error message. Otherwise the return value will be true and the errMsg will be empty.
+	 */
+	bool compileToMetalLib(const std::string& mslFilePath,
+						   const std::string& metalLibFilePath,
+						   std::string& errMsg,
+						   bool isIOS,
+						   uint32_t mslVersionMajor,
+						   uint32_t mslVersionMinor = 0);
+
 }
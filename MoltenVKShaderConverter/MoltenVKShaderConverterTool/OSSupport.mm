@@ -101,3 +101,35 @@ bool mvk::compile(const string& mslSourceCode,
 		return !!mtlLib;
 	}
 }
+
+bool mvk::compileToMetalLib(const string& mslFilePath,
+							const string& metalLibFilePath,
+							string& errMsg,
+							bool isIOS,
+							uint32_t mslVersionMajor,
+							uint32_t mslVersionMinor) {
+	@autoreleasepool {
+		NSString* mslStd = [NSString stringWithFormat: @"-std=%s-metal%d.%d", isIOS ? "ios" : "macos", mslVersionMajor, mslVersionMinor];
+		NSPipe* errPipe = [NSPipe pipe];
+		NSTask* task = [[NSTask new] autorelease];
+		task.launchPath = @"/usr/bin/xcrun";
+		task.arguments = @[@"-sdk", isIOS ? @"iphoneos" : @"macosx", @"metal", mslStd,
+						   @(mslFilePath.c_str()), @"-o", @(metalLibFilePath.c_str())];
+		task.standardError = errPipe;
+
+		@try {
+			[task launch];
+		} @catch (NSException* ex) {
+			errMsg = [NSString stringWithFormat: @"Could not run the Metal compiler: %@", ex.reason].UTF8String;
+			return false;
+		}
+
+		// Read before waiting, so a large error log cannot fill the pipe and block the compiler.
+		NSData* errData = [errPipe.fileHandleForReading readDataToEndOfFile];
+		[task waitUntilExit];
+
+		bool wasCompiled = (task.terminationStatus == 0);
+		errMsg = wasCompiled ? "" : [[[NSString alloc] initWithData: errData encoding: NSUTF8StringEncoding] autorelease].UTF8String;
+		return wasCompiled;
+	}
+}
@@ -0,0 +1,66 @@
+#!/bin/bash
+
+# Precompile the MoltenVK command shaders into Metal libraries for the platform being built,
+# and record them as a derived header file suitable for including in a build.
+#
+# The command shaders, and the host structures that MoltenVK shares with them, depend on the
+# MSL version, so a separate library is compiled for each MSL version the platform supports.
+# At runtime, MoltenVK loads the library matching the MSL version of the device, and falls back
+# to compiling the command shaders from MSL source if no library was recorded for that version.
+# MSL versions that the available Metal compiler does not support are skipped.
+
+SRC_FILE="${SRCROOT}/MoltenVK/Commands/MVKCommandPipelineStateFactoryShaderSource.h"
+HDR_FILE="${DERIVED_FILE_DIR}/mvkCmdShaderLibraryDerived.h"
+TMP_DIR="${DERIVED_FILE_DIR}/mvkCmdShaderLibrary"
+
+case "${PLATFORM_NAME}" in
+	macosx)
+		MTL_SDK=macosx
+		MTL_STD=macos-metal
+		MTL_VER_MIN="-mmacosx-version-min=${MACOSX_DEPLOYMENT_TARGET}"
+		MSL_VERSIONS="1.1 1.2 2.0 2.1 2.2 2.3"
+		;;
+	iphoneos)
+		MTL_SDK=iphoneos
+		MTL_STD=ios-metal
+		MTL_VER_MIN="-mios-version-min=${IPHONEOS_DEPLOYMENT_TARGET}"
+		MSL_VERSIONS="1.0 1.1 1.2 2.0 2.1 2.2 2.3"
+		;;
+	*)
+		MTL_SDK=""
+		MSL_VERSIONS=""
+		;;
+esac
+
+mkdir -p "${TMP_DIR}"
+
+echo "// Auto-generated by MoltenVK" > "${HDR_FILE}"
+
+# Extract the MSL from the string literal in the source header, stripping the line continuations.
+sed -n '/@"/,/^";/p' "${SRC_FILE}" | sed -e '1d' -e '$d' -e 's/[[:space:]]*\\n\\$//' > "${TMP_DIR}/mvkCmdShaders.metal"
+
+# Compile a library for each MSL version, recording each as a byte array.
+# Each MSL version is identified by the same number used by SPIRVToMSLConversionOptions::mslVersion.
+LIB_ENTRIES=""
+for MSL_VER in ${MSL_VERSIONS}; do
+	MSL_VER_NUM=$(( ${MSL_VER%.*} * 10000 + ${MSL_VER#*.} * 100 ))
+	LIB_NAME="mvkCmdShaders_${MSL_VER_NUM}"
+	if xcrun -sdk ${MTL_SDK} metal ${MTL_VER_MIN} -std=${MTL_STD}${MSL_VER} -c "${TMP_DIR}/mvkCmdShaders.metal" -o "${TMP_DIR}/${LIB_NAME}.air" 2> /dev/null \
+		&& xcrun -sdk ${MTL_SDK} metallib "${TMP_DIR}/${LIB_NAME}.air" -o "${TMP_DIR}/${LIB_NAME}.metallib"; then
+		echo "static const unsigned char _MVKStaticCmdShaderLibrary_${MSL_VER_NUM}[] = {" >> "${HDR_FILE}"
+		xxd -i < "${TMP_DIR}/${LIB_NAME}.metallib" >> "${HDR_FILE}"
+		echo "};" >> "${HDR_FILE}"
+		LIB_ENTRIES="${LIB_ENTRIES}	{ ${MSL_VER_NUM}, _MVKStaticCmdShaderLibrary_${MSL_VER_NUM}, sizeof(_MVKStaticCmdShaderLibrary_${MSL_VER_NUM}) },\n"
+	fi
+done
+
+if test -n "${LIB_ENTRIES}"; then
+	echo "static const MVKStaticCmdShaderLibrary _MVKStaticCmdShaderLibraries[] = {" >> "${HDR_FILE}"
+	printf "${LIB_ENTRIES}" >> "${HDR_FILE}"
+	echo "};" >> "${HDR_FILE}"
+	echo "static const size_t _MVKStaticCmdShaderLibraryCount = sizeof(_MVKStaticCmdShaderLibraries) / sizeof(MVKStaticCmdShaderLibrary);" >> "${HDR_FILE}"
+else
+	echo "warning: Could not precompile MoltenVK command shaders. They will be compiled at runtime."
+	echo "static const MVKStaticCmdShaderLibrary* _MVKStaticCmdShaderLibraries = nullptr;" >> "${HDR_FILE}"
+	echo "static const size_t _MVKStaticCmdShaderLibraryCount = 0;" >> "${HDR_FILE}"
+fi